@@ -0,0 +1,28 @@
+SKILL = {
+    name = "gpio_toggle",
+    version = "1.0.0",
+    author = "agent",
+    description = "Control GPIO pin",
+    classification = { category="hardware", type="actuator", bus="gpio" },
+    permissions = { gpio={"18"} } -- Example pin
+}
+
+local PIN = 18
+
+function set_state(on)
+    hw.gpio_set_mode(PIN, "output")
+    hw.gpio_write(PIN, on and 1 or 0)
+    return true
+end
+
+TOOLS = {
+    {
+        name = "set_led",
+        description = "Turn LED on or off",
+        parameters = { type="object", properties={ on={type="boolean"} }, required={"on"} },
+        handler = function(args)
+            set_state(args.on)
+            return { ok=true, state=args.on }
+        end
+    }
+}
@@ -0,0 +1,34 @@
+SKILL = {
+    name = "i2c_sensor_demo",
+    version = "1.0.0",
+    author = "agent",
+    description = "Reads generic I2C register",
+    classification = { category="hardware", type="sensor", bus="i2c" },
+    permissions = { i2c={"i2c0"} }
+}
+
+function read_reg(reg)
+    -- Assuming i2c0 is configured. addr=0x40 example
+    local dev_addr = 0x40
+    local i2c_num = 0
+    -- Write register address
+    local ok = hw.i2c_init("i2c0")
+    if not ok then return nil, "i2c init failed" end
+    -- Read 1 byte from register
+    local data = hw.i2c_read("i2c0", dev_addr, reg, 1)
+    if not data then return nil, "read failed" end
+    return string.byte(data, 1)
+end
+
+TOOLS = {
+    {
+        name = "read_value",
+        description = "Read sensor value from register",
+        parameters = { type="object", properties={ reg={type="integer"} }, required={"reg"} },
+        handler = function(args)
+            local val, err = read_reg(args.reg)
+            if err then return { error=err } end
+            return { value=val }
+        end
+    }
+}
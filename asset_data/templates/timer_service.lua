@@ -0,0 +1,28 @@
+SKILL = {
+    name = "timer_demo",
+    version = "1.0.0",
+    author = "agent",
+    description = "Runs a task every 5 seconds",
+    classification = { category="software", type="service", bus="none" }
+}
+
+local count = 0
+
+function on_timer()
+    count = count + 1
+    print("Timer tick: " .. count)
+end
+
+-- Start periodic timer every 5000ms
+local timer_id = hw.timer_every(5000, on_timer)
+
+TOOLS = {
+    {
+        name = "get_count",
+        description = "Get current timer tick count",
+        parameters = { type="object", properties={}, required={} },
+        handler = function(args)
+            return { count=count }
+        end
+    }
+}
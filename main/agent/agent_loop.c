@@ -1,15 +1,20 @@
 ﻿#include "agent_loop.h"
 #include "agent/context_builder.h"
+#include "agent/tool_pool.h"
 #include "mimi_config.h"
 #include "bus/message_bus.h"
 #include "llm/llm_proxy.h"
 #include "memory/session_mgr.h"
+#include "memory/memory_index.h"
 #include "tools/tool_registry.h"
 #include "telegram/telegram_bot.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "rgb/rgb.h"
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
@@ -22,6 +27,33 @@ static const char *TAG = "agent";
 
 #define TOOL_OUTPUT_SIZE  (8 * 1024)
 
+/* Per-worker PSRAM scratch for one turn: the user prompt with recalled
+ * memory, tool call outputs and the reply text. Bump-allocated and reset
+ * when the next message starts, so a turn makes no heap churn for these;
+ * requests that do not fit fall back to the heap. */
+typedef struct {
+    char *base;
+    size_t size;
+    size_t used;
+} agent_arena_t;
+
+static void *turn_alloc(agent_arena_t *a, size_t size)
+{
+    size_t need = (size + 7) & ~(size_t)7;
+    if (need <= a->size - a->used) {
+        void *p = a->base + a->used;
+        a->used += need;
+        return p;
+    }
+    return heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+}
+
+static void turn_free(agent_arena_t *a, void *p)
+{
+    char *c = p;
+    if (c < a->base || c >= a->base + a->size) free(p);
+}
+
 static bool contains_ci(const char *s, const char *needle)
 {
     if (!s || !needle) return false;
@@ -168,9 +200,13 @@ static void send_status_msg(const char *channel, const char *chat_id, const char
 }
 
 /* Build the user message with tool_result blocks */
-static cJSON *build_tool_results(const llm_response_t *resp, char *tool_output, size_t tool_output_size, const char *channel, const char *chat_id)
+static cJSON *build_tool_results(const llm_response_t *resp, agent_arena_t *arena, const char *channel, const char *chat_id)
 {
     cJSON *content = cJSON_CreateArray();
+    tool_job_t jobs[MIMI_MAX_TOOL_CALLS];
+    const llm_tool_call_t *job_calls[MIMI_MAX_TOOL_CALLS];
+    int job_count = 0;
+    size_t mark = arena->used;
 
     for (int i = 0; i < resp->call_count; i++) {
         const llm_tool_call_t *call = &resp->calls[i];
@@ -184,21 +220,46 @@ static cJSON *build_tool_results(const llm_response_t *resp, char *tool_output,
         snprintf(status_buf, sizeof(status_buf), "Using tool: %s...", call->name);
         send_status_msg(channel, chat_id, status_buf);
 
-        /* Execute tool */
-        tool_output[0] = '\0';
-        const char *input_json = (call->input && call->input[0]) ? call->input : "{}";
-        tool_registry_execute(call->name, input_json, tool_output, tool_output_size);
+        /* Each call gets its own output buffer so calls can run concurrently */
+        tool_job_t *job = &jobs[job_count];
+        job->name = call->name;
+        job->input_json = (call->input && call->input[0]) ? call->input : "{}";
+        job->output = turn_alloc(arena, TOOL_OUTPUT_SIZE);
+        job->output_size = TOOL_OUTPUT_SIZE;
+        job->err = ESP_OK;
+        job_calls[job_count++] = call;
+    }
+
+    /* If a buffer could not be allocated, only the calls before it run */
+    int run_count = job_count;
+    for (int k = 0; k < job_count; k++) {
+        if (!jobs[k].output) {
+            ESP_LOGE(TAG, "No memory for tool %s output", jobs[k].name);
+            run_count = k;
+            break;
+        }
+    }
+    tool_pool_run(jobs, run_count);
 
-        ESP_LOGI(TAG, "Tool %s result: %d bytes", call->name, (int)strlen(tool_output));
+    for (int k = 0; k < job_count; k++) {
+        const llm_tool_call_t *call = job_calls[k];
+        const char *result = (k < run_count) ? jobs[k].output : "Error: out of memory";
+
+        ESP_LOGI(TAG, "Tool %s result: %d bytes", call->name, (int)strlen(result));
 
         /* Build tool_result block */
         cJSON *result_block = cJSON_CreateObject();
         cJSON_AddStringToObject(result_block, "type", "tool_result");
         cJSON_AddStringToObject(result_block, "tool_use_id", call->id);
-        cJSON_AddStringToObject(result_block, "content", tool_output);
+        cJSON_AddStringToObject(result_block, "content", result);
         cJSON_AddItemToArray(content, result_block);
     }
 
+    for (int k = 0; k < job_count; k++) {
+        if (jobs[k].output) turn_free(arena, jobs[k].output);
+    }
+    /* Outputs are copied into the cJSON tree; the next iteration reuses them */
+    arena->used = mark;
     return content;
 }
 
@@ -314,268 +375,623 @@ static void status_sender_cb(const char *status_text, void *arg)
     }
 }
 
-void agent_loop_task(void *pvParameters)
-{
-    ESP_LOGI(TAG, "Agent loop started on core %d", xPortGetCoreID());
+/* ── Workers ─────────────────────────────────────────────────── */
 
-    /* Allocate large buffers from PSRAM */
-    char *system_prompt = heap_caps_calloc(1, MIMI_CONTEXT_BUF_SIZE, MALLOC_CAP_SPIRAM);
-    char *history_json = heap_caps_calloc(1, MIMI_LLM_STREAM_BUF_SIZE, MALLOC_CAP_SPIRAM);
-    char *tool_output = heap_caps_calloc(1, TOOL_OUTPUT_SIZE, MALLOC_CAP_SPIRAM);
+/* Workers take one message at a time. The dispatcher leaves the backlog
+ * in the priority inbox and pops a message only when a worker is free
+ * and the message's conversation is not already running on another, so
+ * turns of one conversation never overlap or reorder, a long turn never
+ * holds up other chats, and cron backpressure sees the real backlog. */
+typedef struct {
+    int id;
+    QueueHandle_t queue;        /* mailbox, one message */
+    agent_arena_t arena;
+    bool busy;                  /* under s_route_lock */
+    uint32_t key;               /* conversation running, when busy */
+} agent_worker_t;
+
+static agent_worker_t s_workers[MIMI_AGENT_WORKERS];
+static int s_worker_count = 0;
+static SemaphoreHandle_t s_route_lock = NULL;
+static SemaphoreHandle_t s_llm_slots = NULL;
+static int s_busy_workers = 0;
+
+static uint32_t conversation_key(const mimi_msg_t *msg)
+{
+    uint32_t h = 2166136261u;
+    for (const char *p = msg->channel; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619u;
+    }
+    h = (h ^ ':') * 16777619u;
+    for (const char *p = msg->chat_id; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619u;
+    }
+    return h;
+}
 
-    if (!system_prompt || !history_json || !tool_output) {
-        ESP_LOGE(TAG, "Failed to allocate PSRAM buffers");
-        vTaskDelete(NULL);
-        return;
+/* Inbox filter for the dispatcher, run under the bus lock: claim a free
+ * worker for `msg` unless its conversation is running elsewhere. */
+static bool route_claim(const mimi_msg_t *msg, void *arg)
+{
+    agent_worker_t **out = (agent_worker_t **)arg;
+    uint32_t key = conversation_key(msg);
+    agent_worker_t *idle = NULL;
+
+    xSemaphoreTake(s_route_lock, portMAX_DELAY);
+    for (int i = 0; i < s_worker_count; i++) {
+        agent_worker_t *w = &s_workers[i];
+        if (w->busy && w->key == key) {
+            idle = NULL;
+            break;
+        }
+        if (!w->busy && !idle) idle = w;
+    }
+    if (idle) {
+        idle->busy = true;
+        idle->key = key;
     }
+    xSemaphoreGive(s_route_lock);
 
-    while (1) {
-        mimi_msg_t msg;
-        esp_err_t err = message_bus_pop_inbound_prefer_websocket(&msg, UINT32_MAX);
-        if (err != ESP_OK) continue;
+    *out = idle;
+    return idle != NULL;
+}
 
-        ESP_LOGI(TAG, "Processing message from %s:%s", msg.channel, msg.chat_id);
+static void route_release(agent_worker_t *w)
+{
+    xSemaphoreTake(s_route_lock, portMAX_DELAY);
+    w->busy = false;
+    xSemaphoreGive(s_route_lock);
+    /* Messages passed over for this worker or conversation may go now */
+    message_bus_inbound_wake();
+}
 
-        /* Breathing RGB effect while agent is processing */
-        rgb_start_breathing(0, 128, 255, 1800);
+/* Breathing RGB effect while any worker is processing */
+static void busy_enter(void)
+{
+    xSemaphoreTake(s_route_lock, portMAX_DELAY);
+    if (s_busy_workers++ == 0) rgb_start_breathing(0, 128, 255, 1800);
+    xSemaphoreGive(s_route_lock);
+}
 
-        /* 1. Build system prompt */
-        context_build_system_prompt(system_prompt, MIMI_CONTEXT_BUF_SIZE);
+static void busy_leave(void)
+{
+    xSemaphoreTake(s_route_lock, portMAX_DELAY);
+    if (--s_busy_workers == 0) {
+        /* Stop breathing and turn off RGB LED when idle */
+        rgb_stop_breathing();
+        rgb_set(0, 0, 0);
+    }
+    xSemaphoreGive(s_route_lock);
+}
 
-        /* 2. Load session history into cJSON array */
-        session_get_history_json(msg.chat_id, history_json,
-                                 MIMI_LLM_STREAM_BUF_SIZE, MIMI_AGENT_MAX_HISTORY);
+static void llm_slot_take(const agent_worker_t *w)
+{
+    if (xSemaphoreTake(s_llm_slots, 0) != pdTRUE) {
+        ESP_LOGI(TAG, "Worker %d waiting for an LLM slot", w->id);
+        xSemaphoreTake(s_llm_slots, portMAX_DELAY);
+    }
+}
 
-        cJSON *messages = cJSON_Parse(history_json);
-        if (!messages) messages = cJSON_CreateArray();
+/* ── History compaction ────────────────────────────────────────── */
 
-        /* 3. Append current user message */
-        cJSON *user_msg = cJSON_CreateObject();
-        cJSON_AddStringToObject(user_msg, "role", "user");
-        cJSON_AddStringToObject(user_msg, "content", msg.content);
-        cJSON_AddItemToArray(messages, user_msg);
+#if CONFIG_MIMI_ENABLE_HISTORY_COMPACTION
+#define COMPACT_INPUT_SIZE  (8 * 1024)
+#define COMPACT_PIECE_MAX   600
 
-        /* 4. ReAct loop */
-        char *final_text = NULL;
-        int iteration = 0;
-        bool is_ws = (strcmp(msg.channel, "websocket") == 0);
-        bool use_stream = is_ws && llm_get_streaming();
+static QueueHandle_t s_compact_queue = NULL;
 
-        while (iteration < MIMI_AGENT_MAX_TOOL_ITER) {
-            const char *tools_json = tool_registry_get_tools_json();
+static const char *COMPACT_PROMPT =
+    "You maintain a running summary of a chat between a user and an AI assistant. "
+    "Merge the previous summary (if any) and the new messages into one updated summary "
+    "of at most 200 words. Keep facts about the user, decisions, open tasks and tool "
+    "results worth reusing; drop greetings and filler. Reply with the summary only.";
 
-            /* Send "working" indicator before each API call */
-            agent_stream_ctx_t stream_ctx = {0};
-            
-            /* Always populate ctx for status messages on WebSocket */
-            if (is_ws) {
-                strncpy(stream_ctx.channel, msg.channel, sizeof(stream_ctx.channel) - 1);
-                strncpy(stream_ctx.chat_id, msg.chat_id, sizeof(stream_ctx.chat_id) - 1);
-            }
-            if (!is_ws) {
-                if (strcmp(msg.channel, MIMI_CHAN_TELEGRAM) == 0) {
-                    /* Telegram: use native typing indicator */
-                    telegram_send_chat_action(msg.chat_id, "typing");
-                } else if (strcmp(msg.channel, MIMI_CHAN_SYSTEM) == 0) {
-                    /* System channel: suppress verbose status spam in logs */
-                } else {
-                    /* Other non-streaming channels: send working text */
-                    static const char *working_phrases[] = {
-                        "mimi\xF0\x9F\x98\x97is working...",
-                        "mimi\xF0\x9F\x90\xBE is thinking...",
-                        "mimi\xF0\x9F\x92\xAD is pondering...",
-                        "mimi\xF0\x9F\x8C\x99 is on it...",
-                        "mimi\xE2\x9C\xA8 is cooking...",
-                    };
-                    const int phrase_count = sizeof(working_phrases) / sizeof(working_phrases[0]);
-                    mimi_msg_t status = {0};
-                    strncpy(status.channel, msg.channel, sizeof(status.channel) - 1);
-                    strncpy(status.chat_id, msg.chat_id, sizeof(status.chat_id) - 1);
-                    const char *phrase = working_phrases[esp_random() % phrase_count];
-                    size_t plen = strlen(phrase);
-                    status.content = heap_caps_malloc(plen + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                    if (status.content) memcpy(status.content, phrase, plen + 1);
-                    if (status.content) message_bus_push_outbound(&status);
-                }
-            }
+static void compact_append(char *buf, size_t *len, const char *prefix, const char *text)
+{
+    if (!text || *len >= COMPACT_INPUT_SIZE - 1) return;
+    size_t take = strlen(text);
+    if (take > COMPACT_PIECE_MAX) take = COMPACT_PIECE_MAX;
+    int n = snprintf(buf + *len, COMPACT_INPUT_SIZE - *len, "%s%.*s\n", prefix, (int)take, text);
+    if (n < 0) return;
+    *len += (size_t)n;
+    if (*len > COMPACT_INPUT_SIZE - 1) *len = COMPACT_INPUT_SIZE - 1;
+}
 
-            /* Set status callback for HTTP progress */
-            if (is_ws) {
-                llm_set_status_cb(status_sender_cb, &stream_ctx);
-                /* Send initial connecting status */
-                status_sender_cb("Connecting...", &stream_ctx);
+/* Flatten the summary and messages into one plain-text request; tool
+ * blocks become tagged lines and every piece is capped */
+static char *compact_transcript(const char *summary, const cJSON *msgs)
+{
+    char *buf = heap_caps_malloc(COMPACT_INPUT_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) return NULL;
+    size_t len = 0;
+    buf[0] = '\0';
+
+    if (summary) compact_append(buf, &len, "Previous summary:\n", summary);
+    compact_append(buf, &len, "", "New messages:");
+
+    const cJSON *m;
+    cJSON_ArrayForEach(m, msgs) {
+        const char *role = cJSON_GetStringValue(cJSON_GetObjectItem(m, "role"));
+        const char *who = (role && strcmp(role, "assistant") == 0) ? "Assistant: " : "User: ";
+        const cJSON *content = cJSON_GetObjectItem(m, "content");
+        if (cJSON_IsString(content)) {
+            compact_append(buf, &len, who, content->valuestring);
+            continue;
+        }
+        const cJSON *block;
+        cJSON_ArrayForEach(block, content) {
+            const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(block, "type"));
+            if (!type) continue;
+            if (strcmp(type, "text") == 0) {
+                compact_append(buf, &len, who, cJSON_GetStringValue(cJSON_GetObjectItem(block, "text")));
+            } else if (strcmp(type, "tool_use") == 0) {
+                compact_append(buf, &len, "[tool call] ", cJSON_GetStringValue(cJSON_GetObjectItem(block, "name")));
+            } else if (strcmp(type, "tool_result") == 0) {
+                compact_append(buf, &len, "[tool result] ", cJSON_GetStringValue(cJSON_GetObjectItem(block, "content")));
             }
+        }
+    }
+    return buf;
+}
 
-            llm_response_t resp;
+/* One tool-less LLM call; returns the new summary or NULL */
+static char *compact_summarize(const char *input)
+{
+    cJSON *req = cJSON_CreateArray();
+    cJSON *user = cJSON_CreateObject();
+    cJSON_AddStringToObject(user, "role", "user");
+    cJSON_AddStringToObject(user, "content", input);
+    cJSON_AddItemToArray(req, user);
+
+    llm_response_t resp;
+    xSemaphoreTake(s_llm_slots, portMAX_DELAY);
+    esp_err_t err = llm_chat_tools(COMPACT_PROMPT, req, NULL, &resp);
+    xSemaphoreGive(s_llm_slots);
+    cJSON_Delete(req);
+
+    char *summary = NULL;
+    if (err == ESP_OK && resp.text && resp.text_len > 0) {
+        size_t len = resp.text_len;
+        if (len > MIMI_SESSION_SUMMARY_MAX) {
+            len = MIMI_SESSION_SUMMARY_MAX;
+            while (len > 0 && ((unsigned char)resp.text[len] & 0xC0) == 0x80) len--;
+        }
+        summary = heap_caps_malloc(len + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (summary) {
+            memcpy(summary, resp.text, len);
+            summary[len] = '\0';
+        }
+    } else {
+        ESP_LOGW(TAG, "Compaction call failed: %s", esp_err_to_name(err));
+    }
+    llm_response_free(&resp);
+    return summary;
+}
 
-            if (use_stream) {
-                /* Streaming path: tokens arrive via callback */
-                err = llm_chat_stream(system_prompt, messages, tools_json, 
-                                      stream_token_cb, &stream_ctx, &resp);
-            } else {
-                /* Non-streaming path: full response at once */
-                err = llm_chat_tools(system_prompt, messages, tools_json, &resp);
-            }
+static void compact_task(void *arg)
+{
+    char chat_id[32];
+    while (1) {
+        if (xQueueReceive(s_compact_queue, chat_id, portMAX_DELAY) != pdTRUE) continue;
 
-            /* Clear status callback */
-            if (is_ws) llm_set_status_cb(NULL, NULL);
+        char *old_summary = NULL;
+        cJSON *msgs = NULL;
+        uint32_t upto = 0;
+        if (session_compact_begin(chat_id, &old_summary, &msgs, &upto) != ESP_OK) continue;
 
-            /* Flush any remaining tokens */
-            if (use_stream) stream_flush(&stream_ctx);
+        int count = cJSON_GetArraySize(msgs);
+        char *input = compact_transcript(old_summary, msgs);
+        free(old_summary);
+        cJSON_Delete(msgs);
 
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "LLM call failed: %s", esp_err_to_name(err));
-                break;
-            }
+        char *summary = input ? compact_summarize(input) : NULL;
+        free(input);
 
-            if (!resp.tool_use) {
-                // LLM did not call any tool. Do NOT auto-execute fallback actions.
-                // If user wants audio/music, LLM should call audio_play_url with a proper URL.
-                // We just pass through the LLM's text response.
-                ESP_LOGW(TAG, "LLM returned no tool call - not applying fallback (LLM should use audio_play_url)");
+        if (session_compact_end(chat_id, summary, upto) == ESP_OK && summary) {
+            ESP_LOGI(TAG, "Compacted %d messages of %s into a %u byte summary",
+                     count, chat_id, (unsigned)strlen(summary));
+        }
+        free(summary);
+    }
+}
 
-                if (resp.text && resp.text_len > 0) {
-                    size_t tlen = resp.text_len;
-                    final_text = heap_caps_malloc(tlen + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                    if (final_text) { memcpy(final_text, resp.text, tlen); final_text[tlen] = '\0'; }
-                }
-                llm_response_free(&resp);
-                break;
+static void compact_request(const char *chat_id)
+{
+    char key[32] = {0};
+    strncpy(key, chat_id, sizeof(key) - 1);
+    if (!s_compact_queue || xQueueSend(s_compact_queue, key, 0) != pdTRUE) {
+        /* Drop the request; the next outgrown load asks again */
+        session_compact_end(chat_id, NULL, 0);
+    }
+}
+#endif
+
+#if CONFIG_MIMI_ENABLE_MEMORY_INDEX
+/* The user's text prefixed with the memory snippets most relevant to it,
+ * or NULL when nothing matches */
+static char *recall_memory(agent_arena_t *arena, const char *text)
+{
+    static const char head[] = "<memory>\n";
+    static const char tail[] = "</memory>\n\n";
+
+    char *notes = memory_index_recall(text, MIMI_MEMORY_RECALL_BYTES);
+    if (!notes) return NULL;
+
+    size_t nlen = strlen(notes);
+    size_t tlen = strlen(text);
+    char *out = turn_alloc(arena, sizeof(head) - 1 + nlen + sizeof(tail) - 1 + tlen + 1);
+    if (out) {
+        char *p = out;
+        memcpy(p, head, sizeof(head) - 1);
+        p += sizeof(head) - 1;
+        memcpy(p, notes, nlen);
+        p += nlen;
+        memcpy(p, tail, sizeof(tail) - 1);
+        p += sizeof(tail) - 1;
+        memcpy(p, text, tlen + 1);
+    }
+    free(notes);
+    return out;
+}
+#endif
+
+static void agent_process_message(agent_worker_t *w, mimi_msg_t *msg)
+{
+    ESP_LOGI(TAG, "Processing message from %s:%s", msg->channel, msg->chat_id);
+
+    /* 1. Get system prompt (cached, rebuilt only when sources change) */
+    const char *cached_prompt = context_acquire_system_prompt(NULL);
+    const char *system_prompt = cached_prompt ? cached_prompt : "";
+
+    /* 2. Load session history (hot sessions come parsed from the cache),
+     *    packed to the input-token budget */
+    bool outgrown = false;
+    cJSON *messages = session_get_history(msg->chat_id, MIMI_AGENT_MAX_HISTORY,
+                                          MIMI_AGENT_HISTORY_TOKENS, &outgrown);
+    if (!messages) messages = cJSON_CreateArray();
+    int turn_start = cJSON_GetArraySize(messages);
+
+    /* 3. Append current user message, with relevant memory recalled
+     *    into this request only */
+    cJSON *user_msg = cJSON_CreateObject();
+    cJSON_AddStringToObject(user_msg, "role", "user");
+#if CONFIG_MIMI_ENABLE_MEMORY_INDEX
+    char *recalled = recall_memory(&w->arena, msg->content);
+    cJSON_AddStringToObject(user_msg, "content", recalled ? recalled : msg->content);
+    if (recalled) turn_free(&w->arena, recalled);
+#else
+    cJSON_AddStringToObject(user_msg, "content", msg->content);
+#endif
+    cJSON_AddItemToArray(messages, user_msg);
+
+    /* 4. ReAct loop */
+    esp_err_t err = ESP_OK;
+    char *final_text = NULL;
+    int iteration = 0;
+    bool is_ws = (strcmp(msg->channel, "websocket") == 0);
+    bool use_stream = is_ws && llm_get_streaming();
+
+    while (iteration < MIMI_AGENT_MAX_TOOL_ITER) {
+        /* Pinned until the call returns, retries included */
+        const char *tools_json = tool_registry_acquire_tools_json();
+
+        /* Send "working" indicator before each API call */
+        agent_stream_ctx_t stream_ctx = {0};
+        
+        /* Always populate ctx for status messages on WebSocket */
+        if (is_ws) {
+            strncpy(stream_ctx.channel, msg->channel, sizeof(stream_ctx.channel) - 1);
+            strncpy(stream_ctx.chat_id, msg->chat_id, sizeof(stream_ctx.chat_id) - 1);
+        }
+        if (!is_ws) {
+            if (strcmp(msg->channel, MIMI_CHAN_TELEGRAM) == 0) {
+                /* Telegram: use native typing indicator */
+                telegram_send_chat_action(msg->chat_id, "typing");
+            } else if (strcmp(msg->channel, MIMI_CHAN_SYSTEM) == 0) {
+                /* System channel: suppress verbose status spam in logs */
+            } else {
+                /* Other non-streaming channels: send working text */
+                static const char *working_phrases[] = {
+                    "mimi\xF0\x9F\x98\x97is working...",
+                    "mimi\xF0\x9F\x90\xBE is thinking...",
+                    "mimi\xF0\x9F\x92\xAD is pondering...",
+                    "mimi\xF0\x9F\x8C\x99 is on it...",
+                    "mimi\xE2\x9C\xA8 is cooking...",
+                };
+                const int phrase_count = sizeof(working_phrases) / sizeof(working_phrases[0]);
+                mimi_msg_t status = {0};
+                strncpy(status.channel, msg->channel, sizeof(status.channel) - 1);
+                strncpy(status.chat_id, msg->chat_id, sizeof(status.chat_id) - 1);
+                const char *phrase = working_phrases[esp_random() % phrase_count];
+                size_t plen = strlen(phrase);
+                status.content = heap_caps_malloc(plen + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+                if (status.content) memcpy(status.content, phrase, plen + 1);
+                if (status.content) message_bus_push_outbound(&status);
             }
+        }
 
-            ESP_LOGI(TAG, "Tool use iteration %d: %d calls", iteration + 1, resp.call_count);
+        /* Set status callback for HTTP progress */
+        if (is_ws) {
+            llm_set_status_cb(status_sender_cb, &stream_ctx);
+            /* Send initial connecting status */
+            status_sender_cb("Connecting...", &stream_ctx);
+        }
 
-            /* Append assistant message with content array */
-            cJSON *asst_msg = cJSON_CreateObject();
-            cJSON_AddStringToObject(asst_msg, "role", "assistant");
-            cJSON_AddItemToObject(asst_msg, "content", build_assistant_content(&resp));
-            cJSON_AddItemToArray(messages, asst_msg);
+        llm_response_t resp;
 
-            /* Execute tools and append results */
-            cJSON *tool_results = build_tool_results(&resp, tool_output, TOOL_OUTPUT_SIZE, msg.channel, msg.chat_id);
-            cJSON *result_msg = cJSON_CreateObject();
-            cJSON_AddStringToObject(result_msg, "role", "user");
-            cJSON_AddItemToObject(result_msg, "content", tool_results);
-            cJSON_AddItemToArray(messages, result_msg);
+        llm_slot_take(w);
+        if (use_stream) {
+            /* Streaming path: tokens arrive via callback */
+            err = llm_chat_stream(system_prompt, messages, tools_json,
+                                  stream_token_cb, &stream_ctx, &resp);
+        } else {
+            /* Non-streaming path: full response at once */
+            err = llm_chat_tools(system_prompt, messages, tools_json, &resp);
+        }
+        xSemaphoreGive(s_llm_slots);
+        tool_registry_release_tools_json(tools_json);
 
-            log_heap_snapshot("after_tool_iteration");
-            llm_response_free(&resp);
-            iteration++;
+        /* Clear status callback */
+        if (is_ws) llm_set_status_cb(NULL, NULL);
+
+        /* Flush any remaining tokens */
+        if (use_stream) stream_flush(&stream_ctx);
+
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "LLM call failed: %s", esp_err_to_name(err));
+            break;
         }
 
-        cJSON_Delete(messages);
+        if (!resp.tool_use) {
+            // LLM did not call any tool. Do NOT auto-execute fallback actions.
+            // If user wants audio/music, LLM should call audio_play_url with a proper URL.
+            // We just pass through the LLM's text response.
+            ESP_LOGW(TAG, "LLM returned no tool call - not applying fallback (LLM should use audio_play_url)");
 
-        if (!final_text && iteration >= MIMI_AGENT_MAX_TOOL_ITER) {
-            const char *limit_msg = "The task is still running and reached the current tool-iteration limit. Please retry or simplify the request.";
-            size_t mlen = strlen(limit_msg);
-            final_text = heap_caps_malloc(mlen + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-            if (final_text) {
-                memcpy(final_text, limit_msg, mlen + 1);
+            if (resp.text && resp.text_len > 0) {
+                size_t tlen = resp.text_len;
+                final_text = turn_alloc(&w->arena, tlen + 1);
+                if (final_text) { memcpy(final_text, resp.text, tlen); final_text[tlen] = '\0'; }
             }
-            ESP_LOGW(TAG, "Reached tool iteration limit: %d", MIMI_AGENT_MAX_TOOL_ITER);
+            llm_response_free(&resp);
+            break;
         }
 
-        /* 5. Send response */
-        if (final_text && final_text[0]) {
-            /* Save to session (only user text + final assistant text) */
-            session_append(msg.chat_id, "user", msg.content);
-            session_append(msg.chat_id, "assistant", final_text);
-
-            /* Push response to outbound */
-            if (is_ws) {
-                if (!use_stream) {
-                    /* Non-streaming on WebSocket: send full text as JSON response */
-                    cJSON *rjson = cJSON_CreateObject();
-                    cJSON_AddStringToObject(rjson, "type", "response");
-                    cJSON_AddStringToObject(rjson, "content", final_text);
-                    cJSON_AddStringToObject(rjson, "chat_id", msg.chat_id);
-                    char *rstr = cJSON_PrintUnformatted(rjson);
-                    cJSON_Delete(rjson);
-                    if (rstr) {
-                        mimi_msg_t out = {0};
-                        strncpy(out.channel, msg.channel, sizeof(out.channel) - 1);
-                        strncpy(out.chat_id, msg.chat_id, sizeof(out.chat_id) - 1);
-                        size_t rlen = strlen(rstr);
-                        out.content = heap_caps_malloc(rlen + 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                        if (out.content) {
-                            out.content[0] = '\x1F';
-                            memcpy(out.content + 1, rstr, rlen);
-                            out.content[rlen + 1] = '\0';
-                            message_bus_push_outbound(&out);
-                        }
-                        free(rstr);
-                    }
-                }
-                /* Send done marker for WS (needed for both modes to stop thinking animation) */
-                mimi_msg_t done = {0};
-                strncpy(done.channel, msg.channel, sizeof(done.channel) - 1);
-                strncpy(done.chat_id, msg.chat_id, sizeof(done.chat_id) - 1);
-                /* Build done marker directly in PSRAM */
-                char json_buf[128];
-                int jlen = snprintf(json_buf, sizeof(json_buf),
-                    "{\"type\":\"done\",\"chat_id\":\"%s\"}", msg.chat_id);
-                if (jlen > 0) {
-                    done.content = heap_caps_malloc(jlen + 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                    if (done.content) {
-                        done.content[0] = '\x1F';
-                        memcpy(done.content + 1, json_buf, jlen);
-                        done.content[jlen + 1] = '\0';
-                        message_bus_push_outbound(&done);
+        ESP_LOGI(TAG, "Tool use iteration %d: %d calls", iteration + 1, resp.call_count);
+
+        /* Append assistant message with content array */
+        cJSON *asst_msg = cJSON_CreateObject();
+        cJSON_AddStringToObject(asst_msg, "role", "assistant");
+        cJSON_AddItemToObject(asst_msg, "content", build_assistant_content(&resp));
+        cJSON_AddItemToArray(messages, asst_msg);
+
+        /* Execute tools and append results */
+        cJSON *tool_results = build_tool_results(&resp, &w->arena, msg->channel, msg->chat_id);
+        cJSON *result_msg = cJSON_CreateObject();
+        cJSON_AddStringToObject(result_msg, "role", "user");
+        cJSON_AddItemToObject(result_msg, "content", tool_results);
+        cJSON_AddItemToArray(messages, result_msg);
+
+        log_heap_snapshot("after_tool_iteration");
+        llm_response_free(&resp);
+        iteration++;
+    }
+
+    context_release_system_prompt(cached_prompt);
+
+    if (!final_text && iteration >= MIMI_AGENT_MAX_TOOL_ITER) {
+        const char *limit_msg = "The task is still running and reached the current tool-iteration limit. Please retry or simplify the request.";
+        size_t mlen = strlen(limit_msg);
+        final_text = turn_alloc(&w->arena, mlen + 1);
+        if (final_text) {
+            memcpy(final_text, limit_msg, mlen + 1);
+        }
+        ESP_LOGW(TAG, "Reached tool iteration limit: %d", MIMI_AGENT_MAX_TOOL_ITER);
+    }
+
+    /* 5. Send response */
+    if (final_text && final_text[0]) {
+        /* Save to session: user text + final assistant text, and with
+         * transcripts the tool_use / tool_result turns in between */
+#if CONFIG_MIMI_ENABLE_SESSION_TRANSCRIPTS
+#if CONFIG_MIMI_ENABLE_MEMORY_INDEX
+        /* Recalled memory is per-request context, not part of the chat */
+        cJSON_ReplaceItemInObject(user_msg, "content", cJSON_CreateString(msg->content));
+#endif
+        const cJSON *turn_msg = cJSON_GetArrayItem(messages, turn_start);
+        for (; turn_msg; turn_msg = turn_msg->next) {
+            session_append_message(msg->chat_id, turn_msg);
+        }
+#else
+        (void)turn_start;
+        session_append(msg->chat_id, "user", msg->content);
+#endif
+        session_append(msg->chat_id, "assistant", final_text);
+
+        /* Push response to outbound */
+        if (is_ws) {
+            if (!use_stream) {
+                /* Non-streaming on WebSocket: send full text as JSON response */
+                cJSON *rjson = cJSON_CreateObject();
+                cJSON_AddStringToObject(rjson, "type", "response");
+                cJSON_AddStringToObject(rjson, "content", final_text);
+                cJSON_AddStringToObject(rjson, "chat_id", msg->chat_id);
+                char *rstr = cJSON_PrintUnformatted(rjson);
+                cJSON_Delete(rjson);
+                if (rstr) {
+                    mimi_msg_t out = {0};
+                    strncpy(out.channel, msg->channel, sizeof(out.channel) - 1);
+                    strncpy(out.chat_id, msg->chat_id, sizeof(out.chat_id) - 1);
+                    size_t rlen = strlen(rstr);
+                    out.content = heap_caps_malloc(rlen + 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+                    if (out.content) {
+                        out.content[0] = '\x1F';
+                        memcpy(out.content + 1, rstr, rlen);
+                        out.content[rlen + 1] = '\0';
+                        message_bus_push_outbound(&out);
                     }
+                    free(rstr);
                 }
-            } else {
-                /* Non-WebSocket channels: send full text */
-                mimi_msg_t out = {0};
-                strncpy(out.channel, msg.channel, sizeof(out.channel) - 1);
-                strncpy(out.chat_id, msg.chat_id, sizeof(out.chat_id) - 1);
-                size_t ftlen = strlen(final_text);
-                out.content = heap_caps_malloc(ftlen + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                if (out.content) {
-                    memcpy(out.content, final_text, ftlen + 1);
-                    message_bus_push_outbound(&out);
+            }
+            /* Send done marker for WS (needed for both modes to stop thinking animation) */
+            mimi_msg_t done = {0};
+            strncpy(done.channel, msg->channel, sizeof(done.channel) - 1);
+            strncpy(done.chat_id, msg->chat_id, sizeof(done.chat_id) - 1);
+            /* Build done marker directly in PSRAM */
+            char json_buf[128];
+            int jlen = snprintf(json_buf, sizeof(json_buf),
+                "{\"type\":\"done\",\"chat_id\":\"%s\"}", msg->chat_id);
+            if (jlen > 0) {
+                done.content = heap_caps_malloc(jlen + 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+                if (done.content) {
+                    done.content[0] = '\x1F';
+                    memcpy(done.content + 1, json_buf, jlen);
+                    done.content[jlen + 1] = '\0';
+                    message_bus_push_outbound(&done);
                 }
             }
-            free(final_text);
         } else {
-            /* Error or empty response */
-            free(final_text);
+            /* Non-WebSocket channels: send full text */
             mimi_msg_t out = {0};
-            strncpy(out.channel, msg.channel, sizeof(out.channel) - 1);
-            strncpy(out.chat_id, msg.chat_id, sizeof(out.chat_id) - 1);
-            const char *errmsg = "Sorry, I encountered an error.";
-            out.content = heap_caps_malloc(strlen(errmsg) + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-            if (out.content) memcpy(out.content, errmsg, strlen(errmsg) + 1);
+            strncpy(out.channel, msg->channel, sizeof(out.channel) - 1);
+            strncpy(out.chat_id, msg->chat_id, sizeof(out.chat_id) - 1);
+            size_t ftlen = strlen(final_text);
+            out.content = heap_caps_malloc(ftlen + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
             if (out.content) {
+                memcpy(out.content, final_text, ftlen + 1);
                 message_bus_push_outbound(&out);
             }
         }
+        turn_free(&w->arena, final_text);
+    } else {
+        /* Error or empty response */
+        turn_free(&w->arena, final_text);
+        mimi_msg_t out = {0};
+        strncpy(out.channel, msg->channel, sizeof(out.channel) - 1);
+        strncpy(out.chat_id, msg->chat_id, sizeof(out.chat_id) - 1);
+        const char *errmsg = "Sorry, I encountered an error.";
+        out.content = heap_caps_malloc(strlen(errmsg) + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (out.content) memcpy(out.content, errmsg, strlen(errmsg) + 1);
+        if (out.content) {
+            message_bus_push_outbound(&out);
+        }
+    }
 
-        /* Free inbound message content */
-        free(msg.content);
+    cJSON_Delete(messages);
 
-        /* Stop breathing and turn off RGB LED when idle */
-        rgb_stop_breathing();
-        rgb_set(0, 0, 0);
+    /* Summarize what fell out of the window once the reply is out */
+#if CONFIG_MIMI_ENABLE_HISTORY_COMPACTION
+    if (outgrown) compact_request(msg->chat_id);
+#else
+    (void)outgrown;
+#endif
+
+    /* Free inbound message content */
+    free(msg->content);
+}
+
+static void agent_worker_task(void *arg)
+{
+    agent_worker_t *w = (agent_worker_t *)arg;
+    ESP_LOGI(TAG, "Agent worker %d started on core %d", w->id, xPortGetCoreID());
+
+    while (1) {
+        mimi_msg_t msg;
+        if (xQueueReceive(w->queue, &msg, portMAX_DELAY) != pdTRUE) continue;
+
+        busy_enter();
+        w->arena.used = 0;
+        agent_process_message(w, &msg);
+        route_release(w);
+        busy_leave();
 
         /* Log memory status */
         log_heap_snapshot("after_message");
     }
 }
 
+static void agent_dispatch_task(void *pvParameters)
+{
+    ESP_LOGI(TAG, "Agent dispatcher started, %d workers", s_worker_count);
+
+    while (1) {
+        mimi_msg_t msg;
+        agent_worker_t *w = NULL;
+        esp_err_t err = message_bus_pop_inbound_match(&msg, route_claim, &w, UINT32_MAX);
+        if (err != ESP_OK) continue;
+
+        ESP_LOGI(TAG, "Routing %s:%s to worker %d", msg.channel, msg.chat_id, w->id);
+        /* The worker was idle, so its mailbox is empty */
+        xQueueSend(w->queue, &msg, 0);
+    }
+}
+
 esp_err_t agent_loop_init(void)
 {
+    esp_err_t err = context_builder_init();
+    if (err != ESP_OK) return err;
     ESP_LOGI(TAG, "Agent loop initialized");
     return ESP_OK;
 }
 
 esp_err_t agent_loop_start(void)
 {
+    if (tool_pool_start() != ESP_OK) {
+        ESP_LOGW(TAG, "Tool pool unavailable, tool calls will run sequentially");
+    }
+
+    s_route_lock = xSemaphoreCreateMutex();
+    s_llm_slots = xSemaphoreCreateCounting(MIMI_LLM_MAX_INFLIGHT, MIMI_LLM_MAX_INFLIGHT);
+    if (!s_route_lock || !s_llm_slots) return ESP_ERR_NO_MEM;
+
+    for (int i = 0; i < MIMI_AGENT_WORKERS; i++) {
+        agent_worker_t *w = &s_workers[s_worker_count];
+        memset(w, 0, sizeof(*w));
+        w->id = i;
+
+        /* Allocate large buffers from PSRAM */
+        w->arena.size = MIMI_AGENT_ARENA_SIZE;
+        w->arena.base = heap_caps_malloc(w->arena.size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        w->queue = xQueueCreate(1, sizeof(mimi_msg_t));
+        if (!w->arena.base || !w->queue) {
+            ESP_LOGE(TAG, "Failed to allocate agent worker %d", i);
+            free(w->arena.base);
+            if (w->queue) vQueueDelete(w->queue);
+            break;
+        }
+
+        char name[16];
+        snprintf(name, sizeof(name), "agent_w%d", i);
+        if (xTaskCreatePinnedToCore(agent_worker_task, name,
+                                    MIMI_AGENT_STACK, w,
+                                    MIMI_AGENT_PRIO, NULL, MIMI_AGENT_CORE) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to start agent worker %d", i);
+            free(w->arena.base);
+            vQueueDelete(w->queue);
+            break;
+        }
+        s_worker_count++;
+    }
+
+    if (s_worker_count == 0) return ESP_FAIL;
+
+#if CONFIG_MIMI_ENABLE_HISTORY_COMPACTION
+    s_compact_queue = xQueueCreate(MIMI_AGENT_COMPACT_QUEUE_LEN, 32);
+    if (!s_compact_queue ||
+        xTaskCreatePinnedToCore(compact_task, "agent_compact",
+                                MIMI_AGENT_COMPACT_STACK, NULL,
+                                MIMI_AGENT_COMPACT_PRIO, NULL, MIMI_AGENT_CORE) != pdPASS) {
+        /* History is still trimmed to the budget, just not summarized */
+        ESP_LOGW(TAG, "History compaction unavailable");
+        if (s_compact_queue) vQueueDelete(s_compact_queue);
+        s_compact_queue = NULL;
+    }
+#endif
+
     BaseType_t ret = xTaskCreatePinnedToCore(
-        agent_loop_task, "agent_loop",
-        MIMI_AGENT_STACK, NULL,
+        agent_dispatch_task, "agent_loop",
+        MIMI_AGENT_DISPATCH_STACK, NULL,
         MIMI_AGENT_PRIO, NULL, MIMI_AGENT_CORE);
 
     return (ret == pdPASS) ? ESP_OK : ESP_FAIL;
 }
-
-
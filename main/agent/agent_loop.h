@@ -8,7 +8,10 @@
 esp_err_t agent_loop_init(void);
 
 /**
- * Start the agent loop task (runs on Core 1).
- * Consumes from inbound queue, calls Claude API, pushes to outbound queue.
+ * Start the agent dispatcher and MIMI_AGENT_WORKERS worker tasks (Core 1).
+ * The dispatcher pops an inbound message, in priority order, only when a
+ * worker is idle and no other worker is running that conversation; the
+ * backlog stays in the inbox. Workers call the LLM (at most
+ * MIMI_LLM_MAX_INFLIGHT at once) and push to the outbound queue.
  */
 esp_err_t agent_loop_start(void);
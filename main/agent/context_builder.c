@@ -3,83 +3,271 @@
 #include "memory/memory_store.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
+#include <time.h>
+#include <sys/stat.h>
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "cJSON.h"
 
 static const char *TAG = "context";
 
-static size_t append_file(char *buf, size_t size, size_t offset, const char *path, const char *header)
+/* ── Cached prompt ─────────────────────────────────────────────
+ *
+ * The prompt is a fixed preamble followed by sections loaded from SPIFFS.
+ * Sections are kept in PSRAM and reloaded only when memory_note_write()
+ * marks their source dirty, when the date rolls over (daily note), or when
+ * the periodic revalidation sees a changed mtime/size (writers that bypass
+ * the hooks). The assembled prompt is an immutable refcounted buffer, so a
+ * worker can keep using its copy while another turn triggers a rebuild.
+ */
+
+static const char s_preamble[] =
+    "# Esp32Claw\n"
+    "You are Esp32Claw on ESP32-S3. Be helpful, accurate, and concise.\n\n"
+    "## Tools\n"
+    "- web_search: Search web for facts/news.\n"
+    "- get_current_time: Get date/time. Use this instead of guessing.\n"
+    "- read_file: Read SPIFFS file (by offset or line range for big files).\n"
+    "- grep_file: Find lines in a SPIFFS file.\n"
+    "- write_file: Write/overwrite SPIFFS file.\n"
+    "- edit_file: Find/replace in SPIFFS file.\n"
+    "- list_dir: List SPIFFS files.\n"
+#if CONFIG_MIMI_ENABLE_MEMORY_INDEX
+    "- memory_search: Search long-term memory and all daily notes.\n"
+#endif
+    "- cron_add: Schedule tasks.\n"
+    "- cron_list: List tasks.\n"
+    "- cron_remove: Remove task.\n"
+    "- set_timezone: Set system timezone.\n\n"
+    "## Audio Tools - IMPORTANT\n"
+    "- audio_play_url: Play audio/music from a URL (MP3). Use this for ALL music/sound playback requests.\n"
+    "- audio_stop: Stop current audio playback.\n"
+    "- audio_status: Playback state, buffer levels and underrun counts.\n"
+    "- audio_volume: Set volume (0-100).\n"
+    "- audio_test_tone: [DEBUG ONLY] Only use when user explicitly asks to test speaker hardware. NOT for normal playback.\n\n"
+    "## Tool Call Discipline\n"
+    "- Never claim a real-world action was executed unless a tool call was actually made.\n"
+    "- For hardware actions (audio/play/test/volume/gpio/network), you MUST call tools instead of only replying with text.\n"
+    "- When user asks to play music/sounds, ALWAYS use audio_play_url with a valid URL.\n"
+    "- ONLY use audio_test_tone if user explicitly says \"test speaker\" or \"test sound hardware\".\n\n"
+    "## Lua Skill Runtime Notes\n"
+    "- In Lua skills, only these runtime namespaces are available: hw, console, agent, struct.\n"
+    "- Do NOT use legacy namespaces like mimi.* or rgb.*.\n"
+    "- Timer APIs are: hw.timer_every, hw.timer_once, hw.timer_cancel.\n\n"
+    "## Memory\n"
+    "- Long-term: /spiffs/memory/MEMORY.md\n"
+    "- Daily: /spiffs/memory/daily/<YYYY-MM-DD>.md\n"
+    "Update MEMORY.md with new user info. Append daily notes for important events.\n"
+#if CONFIG_MIMI_ENABLE_MEMORY_INDEX
+    "Notes relevant to a message are recalled into it; use memory_search for anything else.\n"
+#endif
+    "Always read_file before writing.\n";
+
+typedef struct {
+    uint32_t refs;
+    size_t len;
+    char text[];
+} prompt_buf_t;
+
+typedef struct {
+    uint32_t src;           /* MEMORY_SRC_* */
+    const char *title;
+    size_t max_len;
+    bool note;              /* skipped when empty, newline-terminated */
+    char path[64];
+    char *text;             /* PSRAM, NULL when missing or empty */
+    size_t len;
+    bool present;
+    time_t mtime;
+    off_t size;
+} prompt_section_t;
+
+static prompt_section_t s_sections[] = {
+    { .src = MEMORY_SRC_SOUL,  .title = "Personality",        .max_len = MIMI_CONTEXT_BUF_SIZE, .path = MIMI_SOUL_FILE },
+    { .src = MEMORY_SRC_USER,  .title = "User Info",          .max_len = MIMI_CONTEXT_BUF_SIZE, .path = MIMI_USER_FILE },
+#if !CONFIG_MIMI_ENABLE_MEMORY_INDEX
+    /* With the index, memory is recalled per turn instead */
+    { .src = MEMORY_SRC_LONG,  .title = "Long-term Memory",   .max_len = 4095, .note = true, .path = MIMI_MEMORY_FILE },
+    { .src = MEMORY_SRC_DAILY, .title = "Recent Notes",       .max_len = 2047, .note = true },
+#endif
+};
+#define SECTION_COUNT  (sizeof(s_sections) / sizeof(s_sections[0]))
+
+static SemaphoreHandle_t s_lock = NULL;
+static prompt_buf_t *s_current = NULL;
+static int64_t s_last_validate_us = 0;
+
+static void daily_note_path(char *buf, size_t size)
 {
-    FILE *f = fopen(path, "r");
-    if (!f) return offset;
+    time_t now;
+    time(&now);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    char date_str[16];
+    strftime(date_str, sizeof(date_str), "%Y-%m-%d", &tm);
+    snprintf(buf, size, "%s/%s.md", MIMI_SPIFFS_MEMORY_DIR, date_str);
+}
 
-    if (header && offset < size - 1) {
-        offset += snprintf(buf + offset, size - offset, "\n## %s\n\n", header);
-    }
+static bool section_stale(const prompt_section_t *sec)
+{
+    struct stat st;
+    if (stat(sec->path, &st) != 0) return sec->present;
+    return !sec->present || st.st_mtime != sec->mtime || st.st_size != sec->size;
+}
+
+static void section_load(prompt_section_t *sec)
+{
+    free(sec->text);
+    sec->text = NULL;
+    sec->len = 0;
+    sec->present = false;
+
+    struct stat st;
+    if (stat(sec->path, &st) != 0) return;
+    FILE *f = fopen(sec->path, "r");
+    if (!f) return;
+
+    sec->present = true;
+    sec->mtime = st.st_mtime;
+    sec->size = st.st_size;
 
-    size_t n = fread(buf + offset, 1, size - offset - 1, f);
-    offset += n;
-    buf[offset] = '\0';
+    size_t cap = (size_t)st.st_size < sec->max_len ? (size_t)st.st_size : sec->max_len;
+    if (cap > 0) {
+        sec->text = heap_caps_malloc(cap + 1, MALLOC_CAP_SPIRAM);
+        if (sec->text) {
+            sec->len = fread(sec->text, 1, cap, f);
+            sec->text[sec->len] = '\0';
+        }
+    }
     fclose(f);
-    return offset;
 }
 
-esp_err_t context_build_system_prompt(char *buf, size_t size)
+static size_t prompt_append(char *buf, size_t size, size_t off, const char *data, size_t len)
+{
+    if (off >= size - 1) return off;
+    if (len > size - 1 - off) len = size - 1 - off;
+    memcpy(buf + off, data, len);
+    return off + len;
+}
+
+static prompt_buf_t *prompt_assemble(void)
+{
+    const size_t size = MIMI_CONTEXT_BUF_SIZE;
+    prompt_buf_t *p = heap_caps_malloc(sizeof(prompt_buf_t) + size, MALLOC_CAP_SPIRAM);
+    if (!p) return NULL;
+
+    size_t off = prompt_append(p->text, size, 0, s_preamble, sizeof(s_preamble) - 1);
+    for (size_t i = 0; i < SECTION_COUNT; i++) {
+        const prompt_section_t *sec = &s_sections[i];
+        if (!sec->present || (sec->note && sec->len == 0)) continue;
+
+        char head[48];
+        int hlen = snprintf(head, sizeof(head), "\n## %s\n\n", sec->title);
+        off = prompt_append(p->text, size, off, head, (size_t)hlen);
+        if (sec->text) off = prompt_append(p->text, size, off, sec->text, sec->len);
+        if (sec->note) off = prompt_append(p->text, size, off, "\n", 1);
+    }
+    p->text[off] = '\0';
+    p->len = off;
+    p->refs = 1;    /* held by the cache */
+
+    /* Shrink to fit; the PSRAM block would otherwise stay at 16 KB */
+    prompt_buf_t *fit = heap_caps_realloc(p, sizeof(prompt_buf_t) + off + 1, MALLOC_CAP_SPIRAM);
+    return fit ? fit : p;
+}
+
+static void prompt_unref(prompt_buf_t *p)
 {
-    size_t off = 0;
-
-    off += snprintf(buf + off, size - off,
-        "# Esp32Claw\n"
-        "You are Esp32Claw on ESP32-S3. Be helpful, accurate, and concise.\n\n"
-        "## Tools\n"
-        "- web_search: Search web for facts/news.\n"
-        "- get_current_time: Get date/time. Use this instead of guessing.\n"
-        "- read_file: Read SPIFFS file.\n"
-        "- write_file: Write/overwrite SPIFFS file.\n"
-        "- edit_file: Find/replace in SPIFFS file.\n"
-        "- list_dir: List SPIFFS files.\n"
-        "- cron_add: Schedule tasks.\n"
-        "- cron_list: List tasks.\n"
-        "- cron_remove: Remove task.\n"
-        "- set_timezone: Set system timezone.\n\n"
-        "## Audio Tools - IMPORTANT\n"
-        "- audio_play_url: Play audio/music from a URL (MP3). Use this for ALL music/sound playback requests.\n"
-        "- audio_stop: Stop current audio playback.\n"
-        "- audio_volume: Set volume (0-100).\n"
-        "- audio_test_tone: [DEBUG ONLY] Only use when user explicitly asks to test speaker hardware. NOT for normal playback.\n\n"
-        "## Tool Call Discipline\n"
-        "- Never claim a real-world action was executed unless a tool call was actually made.\n"
-        "- For hardware actions (audio/play/test/volume/gpio/network), you MUST call tools instead of only replying with text.\n"
-        "- When user asks to play music/sounds, ALWAYS use audio_play_url with a valid URL.\n"
-        "- ONLY use audio_test_tone if user explicitly says \"test speaker\" or \"test sound hardware\".\n\n"
-        "## Lua Skill Runtime Notes\n"
-        "- In Lua skills, only these runtime namespaces are available: hw, console, agent, struct.\n"
-        "- Do NOT use legacy namespaces like mimi.* or rgb.*.\n"
-        "- Timer APIs are: hw.timer_every, hw.timer_once, hw.timer_cancel.\n\n"
-        "## Memory\n"
-        "- Long-term: /spiffs/memory/MEMORY.md\n"
-        "- Daily: /spiffs/memory/daily/<YYYY-MM-DD>.md\n"
-        "Update MEMORY.md with new user info. Append daily notes for important events.\n"
-        "Always read_file before writing.\n");
-
-    /* Bootstrap files */
-    off = append_file(buf, size, off, MIMI_SOUL_FILE, "Personality");
-    off = append_file(buf, size, off, MIMI_USER_FILE, "User Info");
-
-    /* Long-term memory */
-    char mem_buf[4096];
-    if (memory_read_long_term(mem_buf, sizeof(mem_buf)) == ESP_OK && mem_buf[0]) {
-        off += snprintf(buf + off, size - off, "\n## Long-term Memory\n\n%s\n", mem_buf);
+    if (p && --p->refs == 0) free(p);
+}
+
+esp_err_t context_builder_init(void)
+{
+    if (s_lock) return ESP_OK;
+    s_lock = xSemaphoreCreateMutex();
+    return s_lock ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+const char *context_acquire_system_prompt(size_t *len)
+{
+    if (!s_lock && context_builder_init() != ESP_OK) return NULL;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    uint32_t dirty = memory_take_dirty();
+    int64_t now = esp_timer_get_time();
+    bool revalidate = !s_current ||
+                      now - s_last_validate_us >= (int64_t)MIMI_CONTEXT_REVALIDATE_MS * 1000;
+    uint32_t reloaded = 0;
+
+    char daily[64];
+    daily_note_path(daily, sizeof(daily));
+
+    for (size_t i = 0; i < SECTION_COUNT; i++) {
+        prompt_section_t *sec = &s_sections[i];
+        bool reload = !s_current || (dirty & sec->src);
+        if (sec->src == MEMORY_SRC_DAILY && strcmp(sec->path, daily) != 0) {
+            strncpy(sec->path, daily, sizeof(sec->path) - 1);
+            reload = true;
+        }
+        if (!reload && revalidate) reload = section_stale(sec);
+        if (reload) {
+            section_load(sec);
+            reloaded |= sec->src;
+        }
+    }
+    if (revalidate) s_last_validate_us = now;
+
+    if (reloaded || !s_current) {
+        int64_t t0 = esp_timer_get_time();
+        prompt_buf_t *p = prompt_assemble();
+        if (p) {
+            prompt_unref(s_current);
+            s_current = p;
+            ESP_LOGI(TAG, "System prompt rebuilt: %d bytes (sources 0x%x) in %lld ms",
+                     (int)p->len, (unsigned)reloaded,
+                     (long long)((esp_timer_get_time() - t0) / 1000));
+        } else {
+            ESP_LOGE(TAG, "No memory for system prompt, keeping previous");
+        }
     }
 
-    /* Recent daily notes (last 1 day) */
-    char recent_buf[2048];
-    if (memory_read_recent(recent_buf, sizeof(recent_buf), 1) == ESP_OK && recent_buf[0]) {
-        off += snprintf(buf + off, size - off, "\n## Recent Notes\n\n%s\n", recent_buf);
+    const char *text = NULL;
+    if (s_current) {
+        s_current->refs++;
+        text = s_current->text;
+        if (len) *len = s_current->len;
     }
+    xSemaphoreGive(s_lock);
+    return text;
+}
 
-    ESP_LOGI(TAG, "System prompt built: %d bytes", (int)off);
+void context_release_system_prompt(const char *prompt)
+{
+    if (!prompt) return;
+    prompt_buf_t *p = (prompt_buf_t *)(prompt - offsetof(prompt_buf_t, text));
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    prompt_unref(p);
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t context_build_system_prompt(char *buf, size_t size)
+{
+    size_t len = 0;
+    const char *prompt = context_acquire_system_prompt(&len);
+    if (!prompt) {
+        buf[0] = '\0';
+        return ESP_ERR_NO_MEM;
+    }
+    if (len > size - 1) len = size - 1;
+    memcpy(buf, prompt, len);
+    buf[len] = '\0';
+    context_release_system_prompt(prompt);
     return ESP_OK;
 }
 
@@ -4,8 +4,32 @@
 #include <stddef.h>
 
 /**
- * Build the system prompt from bootstrap files (SOUL.md, USER.md)
- * and memory context (MEMORY.md + recent daily notes).
+ * Initialize the prompt cache. Called once before agent workers start.
+ */
+esp_err_t context_builder_init(void);
+
+/**
+ * Get the system prompt built from bootstrap files (SOUL.md, USER.md)
+ * and memory context (MEMORY.md + recent daily notes). With
+ * CONFIG_MIMI_ENABLE_MEMORY_INDEX memory is left out; the agent recalls
+ * relevant snippets per turn instead.
+ *
+ * The prompt is cached; sources are re-read only when they changed, so
+ * typical calls do no filesystem I/O. The returned buffer is immutable
+ * and stays valid until released, even if the cache is rebuilt meanwhile.
+ *
+ * @param len  Optional, receives the prompt length
+ * @return Prompt text, or NULL if out of memory
+ */
+const char *context_acquire_system_prompt(size_t *len);
+
+/**
+ * Release a prompt returned by context_acquire_system_prompt(). NULL is ignored.
+ */
+void context_release_system_prompt(const char *prompt);
+
+/**
+ * Copy the current system prompt into a caller buffer.
  *
  * @param buf   Output buffer (caller allocates, recommend MIMI_CONTEXT_BUF_SIZE)
  * @param size  Buffer size
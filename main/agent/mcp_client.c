@@ -4,6 +4,8 @@
 #include <string.h>
 #include <stdlib.h>
 #include "cJSON.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 #if CONFIG_MIMI_ENABLE_MCP && __has_include("esp_websocket_client.h")
 #define MIMI_MCP_IMPL_ENABLED 1
@@ -28,40 +30,50 @@ struct mcp_client_t {
     bool connected;
     int next_id;
     mcp_pending_req_t *pending_reqs;
+    SemaphoreHandle_t lock;     /* guards next_id and pending_reqs: tools may call in parallel */
 };
 
-static void mcp_handle_response(mcp_client_t *client, int id, cJSON *root)
+/* Unlink the pending request with this id, or NULL */
+static mcp_pending_req_t *mcp_take_pending(mcp_client_t *client, int id)
 {
+    xSemaphoreTake(client->lock, portMAX_DELAY);
     mcp_pending_req_t *prev = NULL;
     mcp_pending_req_t *curr = client->pending_reqs;
-
-    while (curr) {
-        if (curr->id == id) {
-            /* Found request */
-            if (prev) prev->next = curr->next;
-            else client->pending_reqs = curr->next;
-            
-            cJSON *result = cJSON_GetObjectItem(root, "result");
-            cJSON *error = cJSON_GetObjectItem(root, "error");
-            
-            /* Construct response string subset for callback */
-            char *res_str = NULL;
-            if (error) res_str = cJSON_PrintUnformatted(error);
-            else if (result) res_str = cJSON_PrintUnformatted(result);
-            else res_str = strdup("{}");
-
-            if (curr->cb) {
-                curr->cb(curr->ctx, id, res_str ? res_str : "{}", error ? ESP_FAIL : ESP_OK);
-            }
-            
-            if (res_str) free(res_str);
-            free(curr);
-            return;
-        }
+    while (curr && curr->id != id) {
         prev = curr;
         curr = curr->next;
     }
-    ESP_LOGW(TAG, "Response for unknown ID: %d", id);
+    if (curr) {
+        if (prev) prev->next = curr->next;
+        else client->pending_reqs = curr->next;
+    }
+    xSemaphoreGive(client->lock);
+    return curr;
+}
+
+static void mcp_handle_response(mcp_client_t *client, int id, cJSON *root)
+{
+    mcp_pending_req_t *curr = mcp_take_pending(client, id);
+    if (!curr) {
+        ESP_LOGW(TAG, "Response for unknown ID: %d", id);
+        return;
+    }
+
+    cJSON *result = cJSON_GetObjectItem(root, "result");
+    cJSON *error = cJSON_GetObjectItem(root, "error");
+
+    /* Construct response string subset for callback */
+    char *res_str = NULL;
+    if (error) res_str = cJSON_PrintUnformatted(error);
+    else if (result) res_str = cJSON_PrintUnformatted(result);
+    else res_str = strdup("{}");
+
+    if (curr->cb) {
+        curr->cb(curr->ctx, id, res_str ? res_str : "{}", error ? ESP_FAIL : ESP_OK);
+    }
+
+    if (res_str) free(res_str);
+    free(curr);
 }
 
 static void ws_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
@@ -81,9 +93,13 @@ static void ws_event_handler(void *handler_args, esp_event_base_t base, int32_t
             ESP_LOGI(TAG, "Disconnected from %s", client->config.url);
             client->connected = false;
             /* Clear pending requests with error */
-            while (client->pending_reqs) {
-                mcp_pending_req_t *req = client->pending_reqs;
-                client->pending_reqs = req->next;
+            xSemaphoreTake(client->lock, portMAX_DELAY);
+            mcp_pending_req_t *pending = client->pending_reqs;
+            client->pending_reqs = NULL;
+            xSemaphoreGive(client->lock);
+            while (pending) {
+                mcp_pending_req_t *req = pending;
+                pending = req->next;
                 if (req->cb) req->cb(req->ctx, req->id, NULL, ESP_FAIL);
                 free(req);
             }
@@ -131,6 +147,11 @@ mcp_client_t *mcp_client_create(const mcp_client_config_t *config)
 
     client->config = *config;
     client->next_id = 1;
+    client->lock = xSemaphoreCreateMutex();
+    if (!client->lock) {
+        free(client);
+        return NULL;
+    }
     
     /* Config WS Client */
     esp_websocket_client_config_t ws_cfg = {
@@ -142,6 +163,7 @@ mcp_client_t *mcp_client_create(const mcp_client_config_t *config)
 
     client->ws_handle = esp_websocket_client_init(&ws_cfg);
     if (!client->ws_handle) {
+        vSemaphoreDelete(client->lock);
         free(client);
         return NULL;
     }
@@ -164,6 +186,7 @@ void mcp_client_destroy(mcp_client_t *client)
         client->pending_reqs = req->next;
         free(req);
     }
+    vSemaphoreDelete(client->lock);
     free(client);
 }
 
@@ -195,19 +218,20 @@ esp_err_t mcp_client_send_request(mcp_client_t *client, const char *method, cons
 {
     if (!client || !client->connected) return ESP_FAIL;
 
-    int id = client->next_id++;
-    
     /* Create Pending Req */
     mcp_pending_req_t *req = calloc(1, sizeof(mcp_pending_req_t));
     if (!req) return ESP_ERR_NO_MEM;
     
-    req->id = id;
     req->cb = cb;
     req->ctx = ctx;
     
     /* Prepend to list */
+    xSemaphoreTake(client->lock, portMAX_DELAY);
+    int id = client->next_id++;
+    req->id = id;
     req->next = client->pending_reqs;
     client->pending_reqs = req;
+    xSemaphoreGive(client->lock);
 
     /* Build JSON */
     cJSON *root = cJSON_CreateObject();
@@ -227,14 +251,8 @@ esp_err_t mcp_client_send_request(mcp_client_t *client, const char *method, cons
     cJSON_Delete(root);
     
     if (err != ESP_OK) {
-        /* Remove from list if send failed */
-        if (client->pending_reqs == req) {
-            client->pending_reqs = req->next;
-        } else {
-            /* This simple removal logic assumes single thread or no race during immediate fail.
-               Realistically, need lock. For now, on ESP32 single core task, acceptable. */
-        }
-        free(req);
+        /* Remove from list if send failed (a disconnect may have taken it already) */
+        free(mcp_take_pending(client, id));
     }
     
     return err;
@@ -1,11 +1,13 @@
 #include "agent/mcp_manager.h"
 #include "agent/mcp_client.h"
 #include "tools/tool_registry.h"
+#include "memory/kv_store.h"
 #include "cJSON.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include "freertos/FreeRTOS.h"
@@ -14,7 +16,7 @@
 
 static const char *TAG = "mcp_mgr";
 
-#define CONFIG_PATH "/spiffs/config/mcp_sources.json"
+#define CONFIG_PATH "/spiffs/config/mcp_sources.json"    /* legacy, imported once */
 #define MAX_SOURCES 4
 
 typedef struct {
@@ -29,6 +31,7 @@ typedef struct {
     /* Phase 10: Dynamic Tools Support */
     char *cached_tools_json; /* The JSON array of tools string [{},{}] */
     int cached_tools_count;
+    char **cached_tool_names; /* cached_tools_count names, in array order */
 } mcp_source_t;
 
 static mcp_source_t s_sources[MAX_SOURCES];
@@ -36,33 +39,52 @@ static int s_source_id_counter = 1;
 static bool s_mcp_started = false;
 
 /* Forward decls */
-static void save_config(void);
 static void mcp_source_clear_tools(mcp_source_t *src);
 
 /* ── Tool Provider Implementation ────────────────────────────────── */
 
+/* Span of a cached "[...]" array without its brackets; 0 if empty */
+static size_t tools_array_body(const char *json, const char **body)
+{
+    const char *open = strchr(json, '[');
+    const char *close = strrchr(json, ']');
+    if (!open || !close || close <= open) return 0;
+    open++;
+    while (open < close && (*open == ' ' || *open == '\n' || *open == '\r' || *open == '\t')) open++;
+    *body = open;
+    return (size_t)(close - open);
+}
+
 static char *mcp_provider_get_tools_json(void)
 {
-    cJSON *arr = cJSON_CreateArray();
-    
+    /* Each source already caches a serialized array; splice them
+     * together instead of parsing and re-printing every tool. */
+    size_t total = 2;
     for (int i = 0; i < MAX_SOURCES; i++) {
         mcp_source_t *src = &s_sources[i];
+        const char *body;
         if (src->id != 0 && src->client && src->cached_tools_json) {
-            cJSON *src_tools = cJSON_Parse(src->cached_tools_json);
-            if (src_tools) {
-                if (cJSON_IsArray(src_tools)) {
-                     cJSON *item = NULL;
-                     cJSON_ArrayForEach(item, src_tools) {
-                         cJSON_AddItemToArray(arr, cJSON_Duplicate(item, true));
-                     }
-                }
-                cJSON_Delete(src_tools);
-            }
+            total += tools_array_body(src->cached_tools_json, &body) + 1;
         }
     }
-    
-    char *json = cJSON_PrintUnformatted(arr);
-    cJSON_Delete(arr);
+
+    char *json = heap_caps_malloc(total + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!json) return NULL;
+
+    size_t off = 0;
+    json[off++] = '[';
+    for (int i = 0; i < MAX_SOURCES; i++) {
+        mcp_source_t *src = &s_sources[i];
+        const char *body;
+        if (src->id == 0 || !src->client || !src->cached_tools_json) continue;
+        size_t n = tools_array_body(src->cached_tools_json, &body);
+        if (n == 0) continue;
+        if (off > 1) json[off++] = ',';
+        memcpy(json + off, body, n);
+        off += n;
+    }
+    json[off++] = ']';
+    json[off] = '\0';
     return json;
 }
 
@@ -94,42 +116,9 @@ static void on_tool_call_result(void *ctx, int id, const char *json_result, esp_
     xSemaphoreGive(tctx->sema);
 }
 
-static esp_err_t mcp_provider_execute_tool(const char *tool_name, const char *input_json, char *output, size_t output_size)
+static esp_err_t mcp_source_call_tool(mcp_source_t *target_src, const char *tool_name,
+                                      const char *input_json, char *output, size_t output_size)
 {
-    /* Find which source has this tool */
-    mcp_source_t *target_src = NULL;
-
-    for (int i = 0; i < MAX_SOURCES; i++) {
-        mcp_source_t *src = &s_sources[i];
-        if (src->id != 0 && src->client && src->cached_tools_json) {
-            /* Quick check if tool is in this source's cache */
-            /* We have to parse to be sure, or string search? String search might match partial args */
-            /* Let's parse. Optimization: keep a list of names? For now parse. Phase 10 MVP */
-            cJSON *tools = cJSON_Parse(src->cached_tools_json);
-            if (tools) {
-                bool found = false;
-                cJSON *item = NULL;
-                cJSON_ArrayForEach(item, tools) {
-                    cJSON *nm = cJSON_GetObjectItem(item, "name");
-                    if (nm && cJSON_IsString(nm) && strcmp(nm->valuestring, tool_name) == 0) {
-                        found = true;
-                        break;
-                    }
-                }
-                cJSON_Delete(tools);
-                if (found) {
-                    target_src = src;
-                    break;
-                }
-            }
-        }
-    }
-
-    if (!target_src) {
-        return ESP_ERR_NOT_FOUND;
-    }
-
-    /* Execute on target source */
     tool_exec_ctx_t tctx = {
         .sema = xSemaphoreCreateBinary(),
         .output_buf = output,
@@ -159,10 +148,54 @@ static esp_err_t mcp_provider_execute_tool(const char *tool_name, const char *in
     return ESP_OK;
 }
 
+static esp_err_t mcp_provider_execute_tool(const char *tool_name, const char *input_json, char *output, size_t output_size)
+{
+    /* Find which source has this tool */
+    mcp_source_t *target_src = NULL;
+
+    for (int i = 0; i < MAX_SOURCES && !target_src; i++) {
+        mcp_source_t *src = &s_sources[i];
+        if (src->id == 0 || !src->client || !src->cached_tool_names) continue;
+        for (int t = 0; t < src->cached_tools_count; t++) {
+            if (strcmp(src->cached_tool_names[t], tool_name) == 0) {
+                target_src = src;
+                break;
+            }
+        }
+    }
+
+    if (!target_src) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    return mcp_source_call_tool(target_src, tool_name, input_json, output, output_size);
+}
+
+/* Index into the spliced array from mcp_provider_get_tools_json():
+ * sources contribute their cached tools in slot order. The index may
+ * predate a source's latest tools/list, so the slot must still hold the
+ * named tool; if not, the registry falls back to a lookup by name. */
+static esp_err_t mcp_provider_execute_tool_at(int index, const char *tool_name, const char *input_json,
+                                              char *output, size_t output_size)
+{
+    for (int i = 0; i < MAX_SOURCES; i++) {
+        mcp_source_t *src = &s_sources[i];
+        if (src->id == 0 || !src->client || !src->cached_tool_names) continue;
+        if (index < src->cached_tools_count) {
+            if (strcmp(src->cached_tool_names[index], tool_name) != 0) return ESP_ERR_NOT_FOUND;
+            return mcp_source_call_tool(src, tool_name, input_json, output, output_size);
+        }
+        index -= src->cached_tools_count;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
 static const tool_provider_t s_mcp_provider = {
     .name = "mcp",
     .get_tools_json = mcp_provider_get_tools_json,
-    .execute_tool = mcp_provider_execute_tool
+    .execute_tool = mcp_provider_execute_tool,
+    .execute_tool_at = mcp_provider_execute_tool_at,
+    .parallel_safe = true
 };
 
 /* ── Tool Registration Logic ─────────────────────────────────────── */
@@ -173,9 +206,37 @@ static void mcp_source_clear_tools(mcp_source_t *src)
         free(src->cached_tools_json);
         src->cached_tools_json = NULL;
     }
+    free(src->cached_tool_names);
+    src->cached_tool_names = NULL;
     src->cached_tools_count = 0;
 }
 
+/* Names of a tools array in order, in one allocation: the pointer
+ * table followed by the strings it points into */
+static char **tool_names_build(const cJSON *tools, int count)
+{
+    size_t size = (size_t)count * sizeof(char *);
+    const cJSON *item;
+    cJSON_ArrayForEach(item, tools) {
+        const char *nm = cJSON_GetStringValue(cJSON_GetObjectItem(item, "name"));
+        size += (nm ? strlen(nm) : 0) + 1;
+    }
+
+    char **names = heap_caps_malloc(size + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!names) return NULL;
+
+    char *p = (char *)(names + count);
+    int i = 0;
+    cJSON_ArrayForEach(item, tools) {
+        const char *nm = cJSON_GetStringValue(cJSON_GetObjectItem(item, "name"));
+        size_t n = nm ? strlen(nm) : 0;
+        memcpy(p, nm ? nm : "", n + 1);
+        names[i++] = p;
+        p += n + 1;
+    }
+    return names;
+}
+
 static void handle_tools_list_response(mcp_source_t *src, const char *json_result)
 {
     cJSON *root = cJSON_Parse(json_result);
@@ -189,8 +250,17 @@ static void handle_tools_list_response(mcp_source_t *src, const char *json_resul
 
     /* Update Cache */
     mcp_source_clear_tools(src);
+    int count = cJSON_GetArraySize(tools);
     src->cached_tools_json = cJSON_PrintUnformatted(tools);
-    src->cached_tools_count = cJSON_GetArraySize(tools);
+    src->cached_tool_names = tool_names_build(tools, count);
+    if (!src->cached_tools_json || !src->cached_tool_names) {
+        ESP_LOGE(TAG, "Out of memory caching tools from %s", src->name);
+        mcp_source_clear_tools(src);
+        tool_registry_rebuild_json();
+        cJSON_Delete(root);
+        return;
+    }
+    src->cached_tools_count = count;
 
     ESP_LOGI(TAG, "Cached %d tools from %s", src->cached_tools_count, src->name);
     
@@ -254,12 +324,57 @@ static int add_source_internal(const char *name, const char *transport, const ch
     src->enabled = true;
     src->client = NULL;
     src->cached_tools_json = NULL;
+    src->cached_tool_names = NULL;
     src->cached_tools_count = 0;
 
     return src->id;
 }
 
-static void load_config(void)
+/* Each source is one record, "mcp/<id>", in the journaled store; the
+ * JSON file older firmware wrote is imported once and removed. */
+#define SOURCE_KEY_PREFIX "mcp/"
+
+static bool source_from_json(const cJSON *item, int id)
+{
+    cJSON *name = cJSON_GetObjectItem(item, "name");
+    cJSON *trans = cJSON_GetObjectItem(item, "transport");
+    cJSON *url = cJSON_GetObjectItem(item, "url");
+    cJSON *auto_conn = cJSON_GetObjectItem(item, "auto_connect");
+
+    if (!cJSON_IsString(name) || !cJSON_IsString(url) || !cJSON_IsString(trans)) return false;
+    return add_source_internal(name->valuestring, trans->valuestring, url->valuestring,
+                               cJSON_IsTrue(auto_conn), id) > 0;
+}
+
+static void persist_source(const mcp_source_t *src)
+{
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddStringToObject(item, "name", src->name);
+    cJSON_AddStringToObject(item, "transport", src->transport);
+    cJSON_AddStringToObject(item, "url", src->url);
+    cJSON_AddBoolToObject(item, "auto_connect", src->auto_connect);
+
+    char *str = cJSON_PrintUnformatted(item);
+    cJSON_Delete(item);
+    if (!str) return;
+
+    char key[KV_KEY_MAX];
+    snprintf(key, sizeof(key), SOURCE_KEY_PREFIX "%d", src->id);
+    esp_err_t err = kv_store_set_str(key, str);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save source %s: %s", src->name, esp_err_to_name(err));
+    }
+    free(str);
+}
+
+static void forget_source(int id)
+{
+    char key[KV_KEY_MAX];
+    snprintf(key, sizeof(key), SOURCE_KEY_PREFIX "%d", id);
+    kv_store_delete(key);
+}
+
+static void import_legacy_config(void)
 {
     FILE *f = fopen(CONFIG_PATH, "r");
     if (!f) return;
@@ -278,51 +393,59 @@ static void load_config(void)
             cJSON *item = NULL;
             cJSON_ArrayForEach(item, arr) {
                 cJSON *id = cJSON_GetObjectItem(item, "id");
-                cJSON *name = cJSON_GetObjectItem(item, "name");
-                cJSON *trans = cJSON_GetObjectItem(item, "transport");
-                cJSON *url = cJSON_GetObjectItem(item, "url");
-                cJSON *auto_conn = cJSON_GetObjectItem(item, "auto_connect");
-                
-                if (name && url && trans) {
-                    add_source_internal(name->valuestring, trans->valuestring, url->valuestring, 
-                                        cJSON_IsTrue(auto_conn), id ? id->valueint : 0);
-                }
+                source_from_json(item, id ? id->valueint : 0);
             }
             cJSON_Delete(root);
         }
         free(data);
     }
     fclose(f);
+
+    for (int i = 0; i < MAX_SOURCES; i++) {
+        if (s_sources[i].id != 0) persist_source(&s_sources[i]);
+    }
+    remove(CONFIG_PATH);
+    ESP_LOGI(TAG, "Imported MCP sources from %s", CONFIG_PATH);
 }
 
-static void save_config(void)
+typedef struct {
+    int ids[MAX_SOURCES];
+    char *json[MAX_SOURCES];
+    int count;
+} loaded_sources_t;
+
+/* Runs under the store lock: only copy records out */
+static bool load_source_cb(const char *key, const void *value, size_t len, void *arg)
 {
-    cJSON *root = cJSON_CreateObject();
-    cJSON *arr = cJSON_CreateArray();
-    cJSON_AddItemToObject(root, "sources", arr);
-    
-    for (int i = 0; i < MAX_SOURCES; i++) {
-        if (s_sources[i].id != 0) {
-            cJSON *item = cJSON_CreateObject();
-            cJSON_AddNumberToObject(item, "id", s_sources[i].id);
-            cJSON_AddStringToObject(item, "name", s_sources[i].name);
-            cJSON_AddStringToObject(item, "transport", s_sources[i].transport);
-            cJSON_AddStringToObject(item, "url", s_sources[i].url);
-            cJSON_AddBoolToObject(item, "auto_connect", s_sources[i].auto_connect);
-            cJSON_AddItemToArray(arr, item);
-        }
+    loaded_sources_t *ls = arg;
+    if (ls->count >= MAX_SOURCES) return false;
+
+    char *json = malloc(len + 1);
+    if (!json) return false;
+    memcpy(json, value, len);
+    json[len] = '\0';
+    ls->ids[ls->count] = atoi(key + strlen(SOURCE_KEY_PREFIX));
+    ls->json[ls->count++] = json;
+    return true;
+}
+
+static void load_config(void)
+{
+    if (!kv_store_has_prefix(SOURCE_KEY_PREFIX)) {
+        import_legacy_config();
+        return;
     }
-    
-    char *str = cJSON_Print(root);
-    if (str) {
-        FILE *f = fopen(CONFIG_PATH, "w");
-        if (f) {
-            fprintf(f, "%s", str);
-            fclose(f);
+
+    loaded_sources_t ls = {0};
+    kv_store_foreach(SOURCE_KEY_PREFIX, load_source_cb, &ls);
+    for (int i = 0; i < ls.count; i++) {
+        cJSON *item = cJSON_Parse(ls.json[i]);
+        if (!item || !source_from_json(item, ls.ids[i])) {
+            ESP_LOGW(TAG, "Skipping unreadable source record %d", ls.ids[i]);
         }
-        free(str);
+        cJSON_Delete(item);
+        free(ls.json[i]);
     }
-    cJSON_Delete(root);
 }
 
 /* ── Manager API ─────────────────────────────────────────────────── */
@@ -350,7 +473,9 @@ int mcp_manager_add_source(const char *name, const char *transport, const char *
 {
     int id = add_source_internal(name, transport, url, auto_connect, 0);
     if (id > 0) {
-        save_config();
+        for (int i = 0; i < MAX_SOURCES; i++) {
+            if (s_sources[i].id == id) persist_source(&s_sources[i]);
+        }
         if (auto_connect && s_mcp_started) {
             mcp_manager_source_action(id, "connect");
         }
@@ -365,7 +490,7 @@ esp_err_t mcp_manager_remove_source(int id)
             mcp_manager_source_action(id, "disconnect");
             /* Clear config */
             memset(&s_sources[i], 0, sizeof(mcp_source_t));
-            save_config();
+            forget_source(id);
             return ESP_OK;
         }
     }
@@ -453,7 +578,8 @@ esp_err_t mcp_manager_source_action(int id, const char *action)
             mcp_client_disconnect(src->client);
             mcp_client_destroy(src->client);
             src->client = NULL;
-            on_disconnect(NULL); /* Cleanup */
+            mcp_source_clear_tools(src);
+            tool_registry_rebuild_json();
         }
         return ESP_OK;
     }
@@ -5,7 +5,7 @@
 
 /**
  * Initialize MCP Manager.
- * Loads configuration from /spiffs/config/mcp_sources.json but does NOT connect.
+ * Loads the saved sources from the config store but does NOT connect.
  */
 esp_err_t mcp_manager_init(void);
 
@@ -0,0 +1,106 @@
+#include "tool_pool.h"
+#include "mimi_config.h"
+#include "tools/tool_registry.h"
+
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "tool_pool";
+
+typedef struct {
+    tool_job_t *job;
+    SemaphoreHandle_t done;
+} tool_work_t;
+
+static QueueHandle_t s_work_queue = NULL;
+static int s_worker_count = 0;
+
+static void run_job(tool_job_t *job)
+{
+    job->output[0] = '\0';
+    job->err = tool_registry_execute(job->name, job->input_json,
+                                     job->output, job->output_size);
+}
+
+static void tool_worker_task(void *arg)
+{
+    tool_work_t work;
+    while (1) {
+        if (xQueueReceive(s_work_queue, &work, portMAX_DELAY) == pdTRUE) {
+            run_job(work.job);
+            xSemaphoreGive(work.done);
+        }
+    }
+}
+
+esp_err_t tool_pool_start(void)
+{
+    if (s_work_queue) return ESP_OK;
+
+    s_work_queue = xQueueCreate(MIMI_MAX_TOOL_CALLS, sizeof(tool_work_t));
+    if (!s_work_queue) return ESP_ERR_NO_MEM;
+
+    for (int i = 0; i < MIMI_TOOL_WORKERS; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "tool_w%d", i);
+        if (xTaskCreatePinnedToCore(tool_worker_task, name,
+                                    MIMI_TOOL_WORKER_STACK, NULL,
+                                    MIMI_TOOL_WORKER_PRIO, NULL,
+                                    MIMI_TOOL_WORKER_CORE) != pdPASS) {
+            ESP_LOGW(TAG, "Failed to start tool worker %d", i);
+            break;
+        }
+        s_worker_count++;
+    }
+
+    ESP_LOGI(TAG, "Tool pool started: %d workers", s_worker_count);
+    return ESP_OK;
+}
+
+void tool_pool_run(tool_job_t *jobs, int count)
+{
+    SemaphoreHandle_t done = NULL;
+    if (s_worker_count > 0 && count > 1) {
+        done = xSemaphoreCreateCounting(count, 0);
+    }
+
+    int i = 0;
+    while (i < count) {
+        int end = i + 1;
+        if (done && tool_registry_is_parallel_safe(jobs[i].name)) {
+            while (end < count && tool_registry_is_parallel_safe(jobs[end].name)) end++;
+        }
+
+        if (end - i == 1) {
+            run_job(&jobs[i++]);
+            continue;
+        }
+
+        /* Hand all but the first call to the workers, run the first here */
+        int64_t start = esp_timer_get_time();
+        int queued = 0;
+        for (int k = i + 1; k < end; k++) {
+            tool_work_t work = { .job = &jobs[k], .done = done };
+            if (xQueueSend(s_work_queue, &work, 0) == pdTRUE) {
+                queued++;
+            } else {
+                run_job(&jobs[k]);
+            }
+        }
+        run_job(&jobs[i]);
+        for (int k = 0; k < queued; k++) {
+            xSemaphoreTake(done, portMAX_DELAY);
+        }
+
+        ESP_LOGI(TAG, "Ran %d tool calls in parallel in %lld ms",
+                 end - i, (long long)((esp_timer_get_time() - start) / 1000));
+        i = end;
+    }
+
+    if (done) vSemaphoreDelete(done);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+
+/* One tool call of a ReAct iteration, with its own output buffer */
+typedef struct {
+    const char *name;
+    const char *input_json;
+    char *output;
+    size_t output_size;
+    esp_err_t err;          /* set by tool_pool_run */
+} tool_job_t;
+
+/**
+ * Start the tool worker tasks.
+ */
+esp_err_t tool_pool_start(void);
+
+/**
+ * Execute a batch of tool calls and return when all are done.
+ * Consecutive parallel-safe calls run concurrently (one on the calling
+ * task, the rest on the workers); an exclusive call waits for the calls
+ * before it and runs alone. Outputs stay in their own job slots, so the
+ * caller reads results back in the original order.
+ */
+void tool_pool_run(tool_job_t *jobs, int count);
@@ -0,0 +1,193 @@
+#include "assets/asset_store.h"
+#include "mimi_config.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "rom/miniz.h"
+
+static const char *TAG = "assets";
+
+/* Image layout; must match tools/pack_assets.py */
+#define ASSET_MAGIC       0x5453414D    /* 'MAST' */
+#define ASSET_VERSION     1
+#define ASSET_FLAG_GZIP   (1u << 0)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t total_size;
+    uint32_t crc;           /* over everything after this header */
+} asset_header_t;
+
+typedef struct {
+    char name[40];
+    uint32_t offset;
+    uint32_t size;
+    uint32_t raw_size;
+    uint32_t etag;
+    uint32_t flags;
+    uint32_t reserved;
+} asset_entry_t;
+
+_Static_assert(sizeof(asset_header_t) == 16, "asset header layout");
+_Static_assert(sizeof(asset_entry_t) == 64, "asset entry layout");
+
+static const uint8_t *s_base;
+static const asset_entry_t *s_entries;
+static int s_count;
+
+/* Check a mapped image and make it the store's */
+static esp_err_t image_use(const uint8_t *base, size_t avail, const char *source)
+{
+    asset_header_t h;
+    if (avail < sizeof(h)) return ESP_ERR_INVALID_SIZE;
+    memcpy(&h, base, sizeof(h));
+    if (h.magic != ASSET_MAGIC || h.version != ASSET_VERSION ||
+        h.total_size < sizeof(h) + (size_t)h.count * sizeof(asset_entry_t) ||
+        h.total_size > avail) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (esp_rom_crc32_le(0, base + sizeof(h), h.total_size - sizeof(h)) != h.crc) {
+        ESP_LOGE(TAG, "Asset image CRC mismatch (%s)", source);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    const asset_entry_t *entries = (const asset_entry_t *)(base + sizeof(h));
+    for (int i = 0; i < h.count; i++) {
+        if (entries[i].offset > h.total_size ||
+            entries[i].size > h.total_size - entries[i].offset ||
+            entries[i].name[sizeof(entries[i].name) - 1] != '\0') {
+            ESP_LOGE(TAG, "Asset index entry %d out of range (%s)", i, source);
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+
+    s_base = base;
+    s_entries = entries;
+    s_count = h.count;
+    ESP_LOGI(TAG, "Assets from %s: %d files, %u bytes", source, s_count, (unsigned)h.total_size);
+    return ESP_OK;
+}
+
+#if CONFIG_MIMI_ASSETS_PARTITION
+esp_err_t asset_store_init(void)
+{
+    const esp_partition_t *part = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, MIMI_ASSETS_PARTITION_SUBTYPE, MIMI_ASSETS_PARTITION_LABEL);
+    if (!part) {
+        ESP_LOGW(TAG, "No '%s' partition; web UI and templates unavailable",
+                 MIMI_ASSETS_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    asset_header_t h;
+    esp_err_t err = esp_partition_read(part, 0, &h, sizeof(h));
+    if (err != ESP_OK) return err;
+    if (h.magic != ASSET_MAGIC || h.total_size > part->size) {
+        ESP_LOGW(TAG, "Asset partition not flashed (run idf.py flash)");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Map only the image, not the whole partition; the mapping stays for
+     * the life of the firmware */
+    const void *ptr;
+    esp_partition_mmap_handle_t handle;
+    err = esp_partition_mmap(part, 0, h.total_size, ESP_PARTITION_MMAP_DATA, &ptr, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "mmap failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    err = image_use(ptr, h.total_size, "partition");
+    if (err != ESP_OK) esp_partition_munmap(handle);
+    return err;
+}
+#else
+/* Packed at build time and linked into the app (main/CMakeLists.txt) */
+extern const uint8_t assets_bin_start[] asm("_binary_assets_bin_start");
+extern const uint8_t assets_bin_end[] asm("_binary_assets_bin_end");
+
+esp_err_t asset_store_init(void)
+{
+    return image_use(assets_bin_start, assets_bin_end - assets_bin_start, "app image");
+}
+#endif
+
+bool asset_store_find(const char *name, asset_t *out)
+{
+    if (!name) return false;
+
+    /* Index is sorted by name */
+    int lo = 0, hi = s_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = strcmp(name, s_entries[mid].name);
+        if (cmp == 0) {
+            const asset_entry_t *e = &s_entries[mid];
+            out->data = s_base + e->offset;
+            out->size = e->size;
+            out->raw_size = e->raw_size;
+            out->etag = e->etag;
+            out->gzip = (e->flags & ASSET_FLAG_GZIP) != 0;
+            return true;
+        }
+        if (cmp < 0) hi = mid - 1;
+        else lo = mid + 1;
+    }
+    return false;
+}
+
+/* Span of the deflate stream inside a gzip member */
+static bool gzip_payload(const uint8_t *p, size_t len, const uint8_t **deflate, size_t *deflate_len)
+{
+    if (len < 18 || p[0] != 0x1f || p[1] != 0x8b || p[2] != 8) return false;
+    uint8_t flg = p[3];
+    size_t off = 10;
+    if (flg & 0x04) {                               /* FEXTRA */
+        if (off + 2 > len) return false;
+        off += 2 + (p[off] | (p[off + 1] << 8));
+    }
+    for (int bit = 0x08; bit <= 0x10; bit <<= 1) {  /* FNAME, FCOMMENT */
+        if (!(flg & bit)) continue;
+        while (off < len && p[off]) off++;
+        off++;
+    }
+    if (flg & 0x02) off += 2;                       /* FHCRC */
+    if (off + 8 > len) return false;
+
+    *deflate = p + off;
+    *deflate_len = len - off - 8;                   /* CRC32 + ISIZE trailer */
+    return true;
+}
+
+char *asset_store_read_text(const char *name)
+{
+    asset_t a;
+    if (!asset_store_find(name, &a)) return NULL;
+
+    char *text = heap_caps_malloc(a.raw_size + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!text) return NULL;
+
+    size_t n = a.size;
+    if (a.gzip) {
+        const uint8_t *deflate;
+        size_t deflate_len;
+        n = gzip_payload(a.data, a.size, &deflate, &deflate_len)
+            ? tinfl_decompress_mem_to_mem(text, a.raw_size, deflate, deflate_len, 0)
+            : TINFL_DECOMPRESS_MEM_TO_MEM_FAILED;
+    } else {
+        memcpy(text, a.data, a.size);
+    }
+
+    if (n != a.raw_size || esp_rom_crc32_le(0, (const uint8_t *)text, n) != a.etag) {
+        ESP_LOGE(TAG, "Asset %s is corrupt", name);
+        free(text);
+        return NULL;
+    }
+    text[n] = '\0';
+    return text;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ── Read-only asset partition ────────────────────────────────────
+ *
+ * The web UI and skill templates are packed on the host by
+ * tools/pack_assets.py from asset_data/ and linked into the app image,
+ * or with CONFIG_MIMI_ASSETS_PARTITION flashed to the "assets" partition
+ * and memory-mapped once. Either way assets are served straight from
+ * flash without copies; text assets are stored gzip'd and sent to
+ * browsers as is.
+ */
+
+typedef struct {
+    const uint8_t *data;    /* mapped flash, valid until reboot */
+    size_t size;            /* stored bytes */
+    size_t raw_size;        /* bytes once inflated */
+    uint32_t etag;          /* CRC32 of the raw content */
+    bool gzip;              /* data is a gzip member */
+} asset_t;
+
+/**
+ * Check the asset image (mapping the partition if assets live there).
+ * Leaves the store empty (every lookup fails) if it is missing or invalid.
+ */
+esp_err_t asset_store_init(void);
+
+/**
+ * Look up an asset by its path below asset_data/, e.g. "www/index.html".
+ */
+bool asset_store_find(const char *name, asset_t *out);
+
+/**
+ * Inflate an asset into a NUL-terminated PSRAM string.
+ * @return String the caller must free(), or NULL if missing or corrupt
+ */
+char *asset_store_read_text(const char *name);
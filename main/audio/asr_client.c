@@ -1,119 +1,96 @@
 #include "audio/asr_client.h"
+#include "audio/audio.h"
+#include "audio/spsc_ring.h"
 #include "llm/llm_proxy.h"   // To get config from getters if exposed, or we can just extern them
+#include "mimi_config.h"
 #include "esp_http_client.h"
+#include "esp_crt_bundle.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "cJSON.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "asr_client";
 
-// Use getters from llm_proxy.h instead of extern arrays
+#define BOUNDARY "----Esp32ClawBoundary123456"
 
-esp_err_t asr_recognize(const uint8_t *audio_data, size_t len, char **out_text) {
-    const char *api_key = llm_get_openai_api_key_audio();
-    const char *endpoint = llm_get_asr_endpoint();
-
-    if (!audio_data || len == 0 || !out_text) return ESP_ERR_INVALID_ARG;
-    if (!endpoint || strlen(endpoint) == 0) {
-        ESP_LOGE(TAG, "ASR endpoint not configured");
-        return ESP_ERR_INVALID_STATE;
-    }
-    if (!endpoint || strlen(endpoint) == 0) {
-        ESP_LOGE(TAG, "ASR endpoint not configured");
-        return ESP_ERR_INVALID_STATE;
-    }
+static const char PART_MODEL[] =
+    "--" BOUNDARY "\r\n"
+    "Content-Disposition: form-data; name=\"model\"\r\n\r\n"
+    "whisper-1\r\n";
 
-    ESP_LOGI(TAG, "Sending %d bytes of audio to ASR endpoint: %s", len, endpoint);
+static const char PART_FILE[] =
+    "--" BOUNDARY "\r\n"
+    "Content-Disposition: form-data; name=\"file\"; filename=\"audio.wav\"\r\n"
+    "Content-Type: audio/wav\r\n\r\n";
 
-    // Build standard HTTP client request for multipart/form-data
-    esp_http_client_config_t config = {
-        .url = endpoint,
-        .timeout_ms = 30000,
-        .method = HTTP_METHOD_POST
-    };
-
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) return ESP_FAIL;
+static const char PART_END[] = "\r\n--" BOUNDARY "--\r\n";
 
-    // Boundary for multipart/form-data
-    const char *boundary = "----Esp32ClawBoundary123456";
-    char content_type[128];
-    snprintf(content_type, sizeof(content_type), "multipart/form-data; boundary=%s", boundary);
+struct asr_stream {
+    spsc_ring_t ring;
+    uint32_t sample_rate;
+    SemaphoreHandle_t done;
+    SemaphoreHandle_t wake;         /* audio queued or recording ended */
+    atomic_int refs;                /* caller + upload task */
+    atomic_bool ended;              /* no more audio coming */
+    atomic_bool aborted;
+    atomic_bool failed;
+    esp_err_t result;
+    char *text;
+    size_t dropped;                 /* bytes lost to a full ring */
+    int64_t end_us;                 /* when the caller stopped recording */
+};
 
-    esp_http_client_set_header(client, "Content-Type", content_type);
-    if (api_key && strlen(api_key) > 0) {
-        char auth_header[256];
-        snprintf(auth_header, sizeof(auth_header), "Bearer %s", api_key);
-        esp_http_client_set_header(client, "Authorization", auth_header);
-    }
+static void stream_release(asr_stream_t *s)
+{
+    if (atomic_fetch_sub(&s->refs, 1) != 1) return;
+    spsc_ring_free(&s->ring);
+    vSemaphoreDelete(s->done);
+    vSemaphoreDelete(s->wake);
+    free(s->text);
+    free(s);
+}
 
-    // Build the payload
-    // Part 1: model
-    const char *part1 = 
-        "------Esp32ClawBoundary123456\r\n"
-        "Content-Disposition: form-data; name=\"model\"\r\n\r\n"
-        "whisper-1\r\n";
-    
-    // Part 2: file header
-    const char *part2 = 
-        "------Esp32ClawBoundary123456\r\n"
-        "Content-Disposition: form-data; name=\"file\"; filename=\"audio.wav\"\r\n"
-        "Content-Type: audio/wav\r\n\r\n";
-    
-    // Part 3: Footer
-    const char *part3 = "\r\n------Esp32ClawBoundary123456--\r\n";
-
-    // Create a valid WAV header for the audio_data (assuming 16k 16-bit mono)
-    // We just send raw PCM wrapped in a basic WAV header since OpenAI needs .wav format
-    uint8_t wav_header[44] = {
-        'R', 'I', 'F', 'F', // ChunkID
-        0, 0, 0, 0,         // ChunkSize (len + 36)
-        'W', 'A', 'V', 'E', // Format
-        'f', 'm', 't', ' ', // Subchunk1ID
-        16, 0, 0, 0,        // Subchunk1Size (16 for PCM)
-        1, 0,               // AudioFormat (1 for PCM)
-        1, 0,               // NumChannels (1 mono)
-        0x80, 0x3E, 0x00, 0x00, // SampleRate (16000)
-        0x00, 0x7D, 0x00, 0x00, // ByteRate (16000 * 1 * 2 = 32000)
-        2, 0,               // BlockAlign (1 * 2)
-        16, 0,              // BitsPerSample (16)
-        'd', 'a', 't', 'a', // Subchunk2ID
-        0, 0, 0, 0          // Subchunk2Size (len)
+/* Streamed WAV: RIFF and data sizes unknown */
+static void wav_header(uint8_t h[44], uint32_t rate)
+{
+    uint32_t byte_rate = rate * 2;
+    memcpy(h, "RIFF\xff\xff\xff\xff" "WAVEfmt ", 16);
+    const uint8_t fmt[20] = {
+        16, 0, 0, 0,                // Subchunk1Size (16 for PCM)
+        1, 0,                       // AudioFormat (1 for PCM)
+        1, 0,                       // NumChannels (1 mono)
+        rate & 0xFF, (rate >> 8) & 0xFF, (rate >> 16) & 0xFF, rate >> 24,
+        byte_rate & 0xFF, (byte_rate >> 8) & 0xFF, (byte_rate >> 16) & 0xFF, byte_rate >> 24,
+        2, 0,                       // BlockAlign (1 * 2)
+        16, 0,                      // BitsPerSample (16)
     };
-    uint32_t chunk_size = len + 36;
-    wav_header[4] = chunk_size & 0xFF;
-    wav_header[5] = (chunk_size >> 8) & 0xFF;
-    wav_header[6] = (chunk_size >> 16) & 0xFF;
-    wav_header[7] = (chunk_size >> 24) & 0xFF;
-
-    wav_header[40] = len & 0xFF;
-    wav_header[41] = (len >> 8) & 0xFF;
-    wav_header[42] = (len >> 16) & 0xFF;
-    wav_header[43] = (len >> 24) & 0xFF;
-
-    int total_len = strlen(part1) + strlen(part2) + sizeof(wav_header) + len + strlen(part3);
-
-    // Because this is chunked or we can just send it manually, let's open stream
-    esp_http_client_open(client, total_len);
-    esp_http_client_write(client, part1, strlen(part1));
-    esp_http_client_write(client, part2, strlen(part2));
-    esp_http_client_write(client, (const char *)wav_header, sizeof(wav_header));
-    
-    // Write audio payload in chunks to avoid watchdog
-    size_t written = 0;
-    while (written < len) {
-        size_t to_write = (len - written > 2048) ? 2048 : len - written;
-        esp_http_client_write(client, (const char *)audio_data + written, to_write);
-        written += to_write;
-    }
+    memcpy(h + 16, fmt, sizeof(fmt));
+    memcpy(h + 36, "data\xff\xff\xff\xff", 8);
+}
 
-    esp_http_client_write(client, part3, strlen(part3));
-    
+/* One chunk of a chunked-transfer body; len 0 writes the terminator */
+static esp_err_t write_chunk(esp_http_client_handle_t client, const void *data, size_t len)
+{
+    char size_line[12];
+    int n = snprintf(size_line, sizeof(size_line), "%x\r\n", (unsigned)len);
+    if (esp_http_client_write(client, size_line, n) != n) return ESP_FAIL;
+    if (len && esp_http_client_write(client, data, len) != (int)len) return ESP_FAIL;
+    if (esp_http_client_write(client, "\r\n", 2) != 2) return ESP_FAIL;
+    return ESP_OK;
+}
+
+static esp_err_t read_transcript(esp_http_client_handle_t client, char **out_text)
+{
     int content_length = esp_http_client_fetch_headers(client);
     if (content_length < 0) {
         ESP_LOGE(TAG, "HTTP client fetch headers failed");
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
         return ESP_FAIL;
     }
 
@@ -124,35 +101,205 @@ esp_err_t asr_recognize(const uint8_t *audio_data, size_t len, char **out_text)
         char err_buf[256] = {0};
         esp_http_client_read(client, err_buf, sizeof(err_buf) - 1);
         ESP_LOGE(TAG, "ASR Error: %s", err_buf);
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
         return ESP_FAIL;
     }
 
     char *resp_buf = malloc(4096);
-    if (!resp_buf) {
-        esp_http_client_close(client);
+    if (!resp_buf) return ESP_ERR_NO_MEM;
+
+    int total = 0;
+    while (total < 4095) {
+        int r = esp_http_client_read(client, resp_buf + total, 4095 - total);
+        if (r <= 0) break;
+        total += r;
+    }
+    resp_buf[total] = '\0';
+
+    cJSON *root = cJSON_Parse(resp_buf);
+    if (root) {
+        cJSON *text = cJSON_GetObjectItem(root, "text");
+        if (text && cJSON_IsString(text)) {
+            *out_text = strdup(text->valuestring);
+        }
+        cJSON_Delete(root);
+    }
+    free(resp_buf);
+    return *out_text ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t upload(asr_stream_t *s)
+{
+    const char *api_key = llm_get_openai_api_key_audio();
+    const char *endpoint = llm_get_asr_endpoint();
+
+    esp_http_client_config_t config = {
+        .url = endpoint,
+        .timeout_ms = 30000,
+        .method = HTTP_METHOD_POST,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) return ESP_FAIL;
+
+    esp_http_client_set_header(client, "Content-Type", "multipart/form-data; boundary=" BOUNDARY);
+    if (api_key && strlen(api_key) > 0) {
+        char auth_header[256];
+        snprintf(auth_header, sizeof(auth_header), "Bearer %s", api_key);
+        esp_http_client_set_header(client, "Authorization", auth_header);
+    }
+
+    // Length -1: Transfer-Encoding: chunked, framed by write_chunk()
+    esp_err_t err = esp_http_client_open(client, -1);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ASR connect failed: %s", esp_err_to_name(err));
         esp_http_client_cleanup(client);
-        return ESP_ERR_NO_MEM;
+        return err;
+    }
+
+    uint8_t header[sizeof(PART_MODEL) - 1 + sizeof(PART_FILE) - 1 + 44];
+    size_t hlen = 0;
+    memcpy(header, PART_MODEL, sizeof(PART_MODEL) - 1);
+    hlen += sizeof(PART_MODEL) - 1;
+    memcpy(header + hlen, PART_FILE, sizeof(PART_FILE) - 1);
+    hlen += sizeof(PART_FILE) - 1;
+    wav_header(header + hlen, s->sample_rate);
+    hlen += 44;
+    err = write_chunk(client, header, hlen);
+
+    // Drain the ring as audio arrives; coalesce to a few frames per chunk
+    size_t sent = 0;
+    while (err == ESP_OK && !atomic_load(&s->aborted)) {
+        bool ended = atomic_load(&s->ended);
+        size_t level = spsc_ring_level(&s->ring);
+        if (level == 0 && ended) break;
+        if (level < MIMI_ASR_CHUNK_BYTES && !ended) {
+            xSemaphoreTake(s->wake, pdMS_TO_TICKS(100));
+            continue;
+        }
+        const uint8_t *pcm;
+        size_t n = spsc_ring_read_span(&s->ring, MIMI_ASR_CHUNK_BYTES, &pcm);
+        err = write_chunk(client, pcm, n);
+        spsc_ring_consume(&s->ring, n);
+        sent += n;
+    }
+
+    if (err == ESP_OK && !atomic_load(&s->aborted)) {
+        err = write_chunk(client, PART_END, sizeof(PART_END) - 1);
+        if (err == ESP_OK) err = write_chunk(client, NULL, 0);
+        if (err == ESP_OK) {
+            err = read_transcript(client, &s->text);
+            ESP_LOGI(TAG, "Uploaded %u bytes; transcript %u ms after end of speech",
+                     (unsigned)sent, (unsigned)((esp_timer_get_time() - s->end_us) / 1000));
+        }
+    } else if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ASR upload failed after %u bytes", (unsigned)sent);
     }
-    
-    int read_len = esp_http_client_read(client, resp_buf, 4095);
+
     esp_http_client_close(client);
     esp_http_client_cleanup(client);
+    return atomic_load(&s->aborted) ? ESP_ERR_INVALID_STATE : err;
+}
 
-    if (read_len > 0) {
-        resp_buf[read_len] = '\0';
-        cJSON *root = cJSON_Parse(resp_buf);
-        if (root) {
-            cJSON *text = cJSON_GetObjectItem(root, "text");
-            if (text && cJSON_IsString(text)) {
-                *out_text = strdup(text->valuestring);
-            }
-            cJSON_Delete(root);
-        }
+static void upload_task(void *arg)
+{
+    asr_stream_t *s = arg;
+    s->result = upload(s);
+    if (s->result != ESP_OK) atomic_store(&s->failed, true);
+    xSemaphoreGive(s->done);
+    stream_release(s);
+    vTaskDelete(NULL);
+}
+
+esp_err_t asr_stream_begin(uint32_t sample_rate, asr_stream_t **out)
+{
+    const char *endpoint = llm_get_asr_endpoint();
+    if (!out) return ESP_ERR_INVALID_ARG;
+    if (!endpoint || strlen(endpoint) == 0) {
+        ESP_LOGE(TAG, "ASR endpoint not configured");
+        return ESP_ERR_INVALID_STATE;
     }
-    free(resp_buf);
 
-    if (*out_text) return ESP_OK;
-    return ESP_FAIL;
+    asr_stream_t *s = calloc(1, sizeof(*s));
+    if (!s) return ESP_ERR_NO_MEM;
+    s->sample_rate = sample_rate;
+    s->done = xSemaphoreCreateBinary();
+    s->wake = xSemaphoreCreateBinary();
+    if (!s->done || !s->wake || spsc_ring_init(&s->ring, MIMI_ASR_RING_SIZE, 0) != ESP_OK) {
+        if (s->done) vSemaphoreDelete(s->done);
+        if (s->wake) vSemaphoreDelete(s->wake);
+        free(s);
+        return ESP_ERR_NO_MEM;
+    }
+    atomic_store(&s->refs, 2);
+
+    ESP_LOGI(TAG, "Streaming audio to ASR endpoint: %s", endpoint);
+    if (xTaskCreatePinnedToCore(upload_task, "asr_upload", MIMI_ASR_TASK_STACK, s,
+                                MIMI_ASR_TASK_PRIO, NULL, MIMI_ASR_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create ASR upload task");
+        atomic_store(&s->refs, 1);
+        stream_release(s);
+        return ESP_FAIL;
+    }
+    *out = s;
+    return ESP_OK;
+}
+
+esp_err_t asr_stream_write(asr_stream_t *s, const int16_t *pcm, size_t samples)
+{
+    if (atomic_load(&s->failed)) return ESP_FAIL;
+
+    size_t len = samples * sizeof(int16_t);
+    size_t n = spsc_ring_write(&s->ring, pcm, len);
+    if (n < len) {
+        // Upload is more than a ring behind; keep recording, lose the excess
+        if (s->dropped == 0) ESP_LOGW(TAG, "ASR upload falling behind; dropping audio");
+        s->dropped += len - n;
+    }
+    xSemaphoreGive(s->wake);
+    return ESP_OK;
+}
+
+esp_err_t asr_stream_finish(asr_stream_t *s, char **out_text)
+{
+    s->end_us = esp_timer_get_time();
+    atomic_store(&s->ended, true);
+    xSemaphoreGive(s->wake);
+
+    xSemaphoreTake(s->done, portMAX_DELAY);
+    esp_err_t err = s->result;
+    if (s->dropped) ESP_LOGW(TAG, "%u bytes of audio were dropped", (unsigned)s->dropped);
+    if (err == ESP_OK && out_text) {
+        *out_text = s->text;
+        s->text = NULL;
+    }
+    stream_release(s);
+    return err;
+}
+
+void asr_stream_abort(asr_stream_t *s)
+{
+    // The upload task notices between chunks and releases its reference
+    atomic_store(&s->aborted, true);
+    atomic_store(&s->ended, true);
+    xSemaphoreGive(s->wake);
+    stream_release(s);
+}
+
+esp_err_t asr_recognize(const uint8_t *audio_data, size_t len, char **out_text)
+{
+    if (!audio_data || len == 0 || !out_text) return ESP_ERR_INVALID_ARG;
+
+    asr_stream_t *s;
+    esp_err_t err = asr_stream_begin(AUDIO_SAMPLE_RATE, &s);
+    if (err != ESP_OK) return err;
+
+    // The clip may exceed the ring; feed it as the upload drains
+    size_t off = 0;
+    while (off < len && !atomic_load(&s->failed)) {
+        size_t n = spsc_ring_write(&s->ring, audio_data + off, len - off);
+        off += n;
+        xSemaphoreGive(s->wake);
+        if (off < len) vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return asr_stream_finish(s, out_text);
 }
@@ -8,10 +8,43 @@
 extern "C" {
 #endif
 
+/*
+ * Streaming recognition: the WAV body is uploaded with chunked transfer
+ * encoding while the caller is still recording. A background task opens
+ * the connection (overlapping the TLS handshake with speech) and drains a
+ * PSRAM ring, so a slow network never stalls the microphone. The WAV
+ * header declares an unknown length (0xFFFFFFFF), which decoders read as
+ * "until end of stream".
+ */
+typedef struct asr_stream asr_stream_t;
+
+/**
+ * @brief Start an upload of 16-bit mono PCM at the given rate.
+ */
+esp_err_t asr_stream_begin(uint32_t sample_rate, asr_stream_t **out);
+
+/**
+ * @brief Queue captured PCM; never blocks on the network.
+ * @return ESP_FAIL once the upload has failed (recording can stop early)
+ */
+esp_err_t asr_stream_write(asr_stream_t *s, const int16_t *pcm, size_t samples);
+
+/**
+ * @brief Close the body and wait for the transcript. Frees the stream.
+ *
+ * @param out_text Recognized text, to be freed by the caller
+ */
+esp_err_t asr_stream_finish(asr_stream_t *s, char **out_text);
+
+/**
+ * @brief Drop the upload without waiting for a transcript. Frees the stream.
+ */
+void asr_stream_abort(asr_stream_t *s);
+
 /**
  * @brief Send raw I2S audio data to the ASR endpoint and get recognized text
- * 
- * @param audio_data Pointer to the raw PCM data
+ *
+ * @param audio_data Pointer to the raw PCM data (AUDIO_SAMPLE_RATE, mono)
  * @param len Length of the data in bytes
  * @param out_text Pointer to a char pointer that will hold the result. Must be freed by caller.
  * @return esp_err_t ESP_OK on success
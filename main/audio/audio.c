@@ -1,4 +1,5 @@
 #include "audio.h"
+#include "audio_dsp.h"
 #include "../mimi_config.h"
 
 #include <string.h>
@@ -282,20 +283,17 @@ esp_err_t audio_speaker_write(const uint8_t *data, size_t len)
         return ret;
     }
 
-    const int gain = s_volume_percent;
+    const int16_t gain = audio_dsp_gain_from_percent(s_volume_percent);
     const int16_t *in = (const int16_t *)data;
     size_t samples = len / sizeof(int16_t);
     size_t offset = 0;
-    int16_t tmp[128];
+    // Start tmp at the input's offset within 16 bytes so the vector path
+    // sees both buffers aligned alike
+    int16_t tmp_buf[256 + AUDIO_DSP_ALIGN / sizeof(int16_t)] __attribute__((aligned(AUDIO_DSP_ALIGN)));
+    int16_t *tmp = tmp_buf + ((uintptr_t)in & (AUDIO_DSP_ALIGN - 1)) / sizeof(int16_t);
     while (offset < samples) {
-        size_t n = (samples - offset) > 128 ? 128 : (samples - offset);
-        for (size_t i = 0; i < n; i++) {
-            int32_t v = (int32_t)in[offset + i];
-            v = (v * gain) / 100;
-            if (v > 32767) v = 32767;
-            if (v < -32768) v = -32768;
-            tmp[i] = (int16_t)v;
-        }
+        size_t n = (samples - offset) > 256 ? 256 : (samples - offset);
+        audio_dsp_gain_q15(tmp, in + offset, n, gain);
         size_t bytes_written = 0;
         esp_err_t ret = i2s_write(AUDIO_SPK_I2S_PORT, tmp, n * sizeof(int16_t), &bytes_written, portMAX_DELAY);
         if (ret != ESP_OK) {
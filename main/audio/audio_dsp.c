@@ -0,0 +1,337 @@
+#include "audio/audio_dsp.h"
+
+#include "sdkconfig.h"
+#include "mimi_config.h"
+
+#include <stdbool.h>
+
+static inline int16_t sat16(int32_t v)
+{
+    if (v > 32767) return 32767;
+    if (v < -32768) return -32768;
+    return (int16_t)v;
+}
+
+static inline int16_t clamp_gain(int16_t gain)
+{
+    /* Q15 gains stay within [0, 1), which keeps every product in range */
+    return gain < 0 ? 0 : gain;
+}
+
+/* ── Scalar references ──────────────────────────────────────── */
+
+void audio_dsp_gain_q15_ref(int16_t *dst, const int16_t *src, size_t n, int16_t gain)
+{
+    gain = clamp_gain(gain);
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = sat16(((int32_t)src[i] * gain) >> 15);
+    }
+}
+
+void audio_dsp_mix_q15_ref(int16_t *acc, const int16_t *src, size_t n, int16_t gain)
+{
+    gain = clamp_gain(gain);
+    for (size_t i = 0; i < n; i++) {
+        acc[i] = sat16((int32_t)acc[i] + (((int32_t)src[i] * gain) >> 15));
+    }
+}
+
+void audio_dsp_downmix_stereo_ref(int16_t *mono, const int16_t *stereo, size_t frames)
+{
+    for (size_t i = 0; i < frames; i++) {
+        mono[i] = (int16_t)((stereo[2 * i] >> 1) + (stereo[2 * i + 1] >> 1));
+    }
+}
+
+uint64_t audio_dsp_energy_ref(const int16_t *src, size_t n)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += (uint64_t)((int32_t)src[i] * src[i]);
+    }
+    return sum;
+}
+
+/* ── ESP32-S3 vector kernels ────────────────────────────────────
+ *
+ * Eight lanes of 16 bits per q register. EE.VMUL.S16 shifts each 32-bit
+ * product right by SAR, which is set to 15 for Q15; with gains below 1
+ * the result always fits, so it equals the reference's shift-and-clamp.
+ * Each kernel is one asm block, so no q register outlives a statement.
+ *
+ * The loopgtz loops overwrite LBEG/LEND/LCOUNT, and neither those nor
+ * q0-q3 can be listed as clobbers, so a hardware loop the compiler
+ * wraps around an inlined kernel would break. The kernels are kept out
+ * of line to make that less likely, and the option is off by default;
+ * see MIMI_AUDIO_DSP_PIE in Kconfig.
+ */
+#if CONFIG_MIMI_AUDIO_DSP_PIE
+
+static inline bool aligned16(const void *p)
+{
+    return ((uintptr_t)p & (AUDIO_DSP_ALIGN - 1)) == 0;
+}
+
+/* blocks of 8 samples */
+static void __attribute__((noinline)) gain_pie(int16_t *dst, const int16_t *src, size_t blocks, const int16_t *gain)
+{
+    __asm__ volatile (
+        "movi.n         a8, 15\n"
+        "wsr.sar        a8\n"
+        "ee.vldbc.16    q1, %[g]\n"
+        "loopgtz        %[n], 1f\n"
+        "ee.vld.128.ip  q0, %[s], 16\n"
+        "ee.vmul.s16    q2, q0, q1\n"
+        "ee.vst.128.ip  q2, %[d], 16\n"
+        "1:\n"
+        : [s] "+r"(src), [d] "+r"(dst)
+        : [n] "r"(blocks), [g] "r"(gain)
+        : "a8", "memory");
+}
+
+static void __attribute__((noinline)) mix_pie(int16_t *acc, const int16_t *src, size_t blocks, const int16_t *gain)
+{
+    __asm__ volatile (
+        "movi.n         a8, 15\n"
+        "wsr.sar        a8\n"
+        "ee.vldbc.16    q1, %[g]\n"
+        "loopgtz        %[n], 1f\n"
+        "ee.vld.128.ip  q0, %[s], 16\n"
+        "ee.vld.128.ip  q3, %[a], 0\n"
+        "ee.vmul.s16    q2, q0, q1\n"
+        "ee.vadds.s16   q3, q3, q2\n"
+        "ee.vst.128.ip  q3, %[a], 16\n"
+        "1:\n"
+        : [s] "+r"(src), [a] "+r"(acc)
+        : [n] "r"(blocks), [g] "r"(gain)
+        : "a8", "memory");
+}
+
+/* blocks of 8 output samples (16 input) */
+static void __attribute__((noinline)) downmix_pie(int16_t *mono, const int16_t *stereo, size_t blocks)
+{
+    static const int16_t half = 16384;      /* x * 0.5 in Q15 == x >> 1 */
+    __asm__ volatile (
+        "movi.n         a8, 15\n"
+        "wsr.sar        a8\n"
+        "ee.vldbc.16    q3, %[h]\n"
+        "loopgtz        %[n], 1f\n"
+        "ee.vld.128.ip  q0, %[s], 16\n"
+        "ee.vld.128.ip  q1, %[s], 16\n"
+        "ee.vunzip.16   q0, q1\n"           /* q0 = L0..L7, q1 = R0..R7 */
+        "ee.vmul.s16    q0, q0, q3\n"
+        "ee.vmul.s16    q1, q1, q3\n"
+        "ee.vadds.s16   q2, q0, q1\n"
+        "ee.vst.128.ip  q2, %[d], 16\n"
+        "1:\n"
+        : [s] "+r"(stereo), [d] "+r"(mono)
+        : [n] "r"(blocks), [h] "r"(&half)
+        : "a8", "memory");
+}
+
+/* At most 32 blocks: 256 full-scale squares fit the 40-bit ACCX */
+#define ENERGY_PIE_MAX_BLOCKS 32
+
+static uint64_t __attribute__((noinline)) energy_pie(const int16_t *src, size_t blocks)
+{
+    uint32_t lo, hi;
+    __asm__ volatile (
+        "ee.zero.accx\n"
+        "loopgtz        %[n], 1f\n"
+        "ee.vld.128.ip  q0, %[s], 16\n"
+        "ee.vmulas.s16.accx q0, q0\n"
+        "1:\n"
+        "rur.accx_0     %[lo]\n"
+        "rur.accx_1     %[hi]\n"
+        : [s] "+r"(src), [lo] "=r"(lo), [hi] "=r"(hi)
+        : [n] "r"(blocks)
+        : "memory");
+    return ((uint64_t)(hi & 0xff) << 32) | lo;
+}
+
+#endif // CONFIG_MIMI_AUDIO_DSP_PIE
+
+/* ── Dispatch + portable loops ──────────────────────────────── */
+
+int16_t audio_dsp_gain_from_percent(int percent)
+{
+    if (percent <= 0) return 0;
+    if (percent >= 100) return AUDIO_DSP_Q15_ONE;
+    return (int16_t)((percent * AUDIO_DSP_Q15_ONE + 50) / 100);
+}
+
+void audio_dsp_gain_q15(int16_t *dst, const int16_t *src, size_t n, int16_t gain)
+{
+    gain = clamp_gain(gain);
+    size_t i = 0;
+
+#if CONFIG_MIMI_AUDIO_DSP_PIE
+    if ((((uintptr_t)dst ^ (uintptr_t)src) & (AUDIO_DSP_ALIGN - 1)) == 0) {
+        for (; i < n && !aligned16(dst + i); i++) {
+            dst[i] = (int16_t)(((int32_t)src[i] * gain) >> 15);
+        }
+        size_t blocks = (n - i) / 8;
+        gain_pie(dst + i, src + i, blocks, &gain);
+        i += blocks * 8;
+    }
+#endif
+
+    for (; i + 4 <= n; i += 4) {
+        int32_t a = src[i], b = src[i + 1], c = src[i + 2], d = src[i + 3];
+        dst[i]     = (int16_t)((a * gain) >> 15);
+        dst[i + 1] = (int16_t)((b * gain) >> 15);
+        dst[i + 2] = (int16_t)((c * gain) >> 15);
+        dst[i + 3] = (int16_t)((d * gain) >> 15);
+    }
+    for (; i < n; i++) {
+        dst[i] = (int16_t)(((int32_t)src[i] * gain) >> 15);
+    }
+}
+
+void audio_dsp_mix_q15(int16_t *acc, const int16_t *src, size_t n, int16_t gain)
+{
+    gain = clamp_gain(gain);
+    size_t i = 0;
+
+#if CONFIG_MIMI_AUDIO_DSP_PIE
+    if ((((uintptr_t)acc ^ (uintptr_t)src) & (AUDIO_DSP_ALIGN - 1)) == 0) {
+        for (; i < n && !aligned16(acc + i); i++) {
+            acc[i] = sat16((int32_t)acc[i] + (((int32_t)src[i] * gain) >> 15));
+        }
+        size_t blocks = (n - i) / 8;
+        mix_pie(acc + i, src + i, blocks, &gain);
+        i += blocks * 8;
+    }
+#endif
+
+    for (; i + 4 <= n; i += 4) {
+        int32_t a = ((int32_t)src[i] * gain) >> 15;
+        int32_t b = ((int32_t)src[i + 1] * gain) >> 15;
+        int32_t c = ((int32_t)src[i + 2] * gain) >> 15;
+        int32_t d = ((int32_t)src[i + 3] * gain) >> 15;
+        acc[i]     = sat16(acc[i] + a);
+        acc[i + 1] = sat16(acc[i + 1] + b);
+        acc[i + 2] = sat16(acc[i + 2] + c);
+        acc[i + 3] = sat16(acc[i + 3] + d);
+    }
+    for (; i < n; i++) {
+        acc[i] = sat16((int32_t)acc[i] + (((int32_t)src[i] * gain) >> 15));
+    }
+}
+
+void audio_dsp_downmix_stereo(int16_t *mono, const int16_t *stereo, size_t frames)
+{
+    size_t i = 0;
+
+#if CONFIG_MIMI_AUDIO_DSP_PIE
+    /* In place the writes trail the reads by half a block */
+    if (aligned16(mono) && aligned16(stereo)) {
+        size_t blocks = frames / 8;
+        downmix_pie(mono, stereo, blocks);
+        i = blocks * 8;
+    }
+#endif
+
+    for (; i + 2 <= frames; i += 2) {
+        int32_t l0 = stereo[2 * i],     r0 = stereo[2 * i + 1];
+        int32_t l1 = stereo[2 * i + 2], r1 = stereo[2 * i + 3];
+        mono[i]     = (int16_t)((l0 >> 1) + (r0 >> 1));
+        mono[i + 1] = (int16_t)((l1 >> 1) + (r1 >> 1));
+    }
+    if (i < frames) {
+        mono[i] = (int16_t)((stereo[2 * i] >> 1) + (stereo[2 * i + 1] >> 1));
+    }
+}
+
+uint64_t audio_dsp_energy(const int16_t *src, size_t n)
+{
+    uint64_t sum = 0;
+    size_t i = 0;
+
+#if CONFIG_MIMI_AUDIO_DSP_PIE
+    if (((uintptr_t)src & 1) == 0) {
+        for (; i < n && !aligned16(src + i); i++) {
+            sum += (uint64_t)((int32_t)src[i] * src[i]);
+        }
+        size_t blocks = (n - i) / 8;
+        while (blocks) {
+            size_t b = blocks > ENERGY_PIE_MAX_BLOCKS ? ENERGY_PIE_MAX_BLOCKS : blocks;
+            sum += energy_pie(src + i, b);
+            i += b * 8;
+            blocks -= b;
+        }
+    }
+#endif
+
+    /* Two squares (at most 2^30 each) fit a uint32 before widening */
+    for (; i + 2 <= n; i += 2) {
+        uint32_t a = (uint32_t)((int32_t)src[i] * src[i]);
+        uint32_t b = (uint32_t)((int32_t)src[i + 1] * src[i + 1]);
+        sum += (uint64_t)a + b;
+    }
+    if (i < n) {
+        sum += (uint64_t)((int32_t)src[i] * src[i]);
+    }
+    return sum;
+}
+
+static uint32_t isqrt64(uint64_t v)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+uint32_t audio_dsp_rms(const int16_t *src, size_t n)
+{
+    if (n == 0) return 0;
+    return isqrt64(audio_dsp_energy(src, n) / n);
+}
+
+/* ── Sample-rate conversion ─────────────────────────────────── */
+
+void audio_dsp_src_init(audio_dsp_src_t *s, uint32_t in_rate, uint32_t out_rate)
+{
+    s->step = (uint32_t)(((uint64_t)in_rate << 16) / out_rate);
+    s->pos = 1u << 16;      /* first output lands on the first input */
+    s->prev = 0;
+}
+
+size_t audio_dsp_src_out_len(const audio_dsp_src_t *s, size_t n_in)
+{
+    uint64_t end = (uint64_t)n_in << 16;
+    if (s->pos >= end) return 0;
+    return (size_t)((end - s->pos + s->step - 1) / s->step);
+}
+
+size_t audio_dsp_src_run(audio_dsp_src_t *s, const int16_t *in, size_t n_in, int16_t *out)
+{
+    if (n_in == 0) return 0;
+
+    /* Position p interpolates between in[p - 1] and in[p], in[-1] being
+     * the previous block's last sample */
+    uint64_t end = (uint64_t)n_in << 16;
+    uint64_t pos = s->pos;
+    size_t n = 0;
+    while (pos < end) {
+        size_t idx = (size_t)(pos >> 16);
+        int32_t a = idx ? in[idx - 1] : s->prev;
+        int32_t b = in[idx];
+        int32_t frac = (int32_t)((pos >> 1) & 0x7fff);
+        out[n++] = (int16_t)(a + (((b - a) * frac) >> 15));
+        pos += s->step;
+    }
+    s->pos = (uint32_t)(pos - end);
+    s->prev = in[n_in - 1];
+    return n;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ── PCM kernels ──────────────────────────────────────────────────
+ *
+ * 16-bit signed PCM. Every kernel has a plain scalar reference
+ * (audio_dsp_*_ref) that defines its exact output; the dispatching
+ * version is an unrolled portable loop, or the ESP32-S3 vector (PIE)
+ * path when CONFIG_MIMI_AUDIO_DSP_PIE is set, and must match the
+ * reference bit for bit.
+ *
+ * Vector paths need 16-byte aligned buffers (see AUDIO_DSP_ALIGN); with
+ * misaligned buffers the kernels still work, on the portable loop.
+ * dst may equal src everywhere.
+ */
+
+#define AUDIO_DSP_ALIGN     16
+#define AUDIO_DSP_Q15_ONE   32767
+
+/** Volume 0-100 % as a Q15 gain. */
+int16_t audio_dsp_gain_from_percent(int percent);
+
+/** dst[i] = (src[i] * gain) >> 15, saturated. */
+void audio_dsp_gain_q15(int16_t *dst, const int16_t *src, size_t n, int16_t gain);
+
+/** acc[i] = acc[i] + ((src[i] * gain) >> 15), saturated. */
+void audio_dsp_mix_q15(int16_t *acc, const int16_t *src, size_t n, int16_t gain);
+
+/**
+ * Interleaved stereo to mono: (L >> 1) + (R >> 1). Halving each channel
+ * first keeps the sum in range, so no clamp is needed.
+ */
+void audio_dsp_downmix_stereo(int16_t *mono, const int16_t *stereo, size_t frames);
+
+/** Sum of squares. */
+uint64_t audio_dsp_energy(const int16_t *src, size_t n);
+
+/** Integer RMS: floor(sqrt(energy / n)). 0 for an empty buffer. */
+uint32_t audio_dsp_rms(const int16_t *src, size_t n);
+
+/* Linear-interpolating sample-rate converter, streaming. Portable only. */
+typedef struct {
+    uint32_t step;      /* input samples per output sample, Q16 */
+    uint32_t pos;       /* next output position, Q16, from `prev` */
+    int16_t prev;       /* last input sample of the previous call */
+} audio_dsp_src_t;
+
+void audio_dsp_src_init(audio_dsp_src_t *s, uint32_t in_rate, uint32_t out_rate);
+
+/** Output samples the next audio_dsp_src_run() of n_in samples will produce. */
+size_t audio_dsp_src_out_len(const audio_dsp_src_t *s, size_t n_in);
+
+/**
+ * Convert a block; out must hold audio_dsp_src_out_len(s, n_in) samples.
+ * @return Samples written
+ */
+size_t audio_dsp_src_run(audio_dsp_src_t *s, const int16_t *in, size_t n_in, int16_t *out);
+
+/* Scalar references */
+void audio_dsp_gain_q15_ref(int16_t *dst, const int16_t *src, size_t n, int16_t gain);
+void audio_dsp_mix_q15_ref(int16_t *acc, const int16_t *src, size_t n, int16_t gain);
+void audio_dsp_downmix_stereo_ref(int16_t *mono, const int16_t *stereo, size_t frames);
+uint64_t audio_dsp_energy_ref(const int16_t *src, size_t n);
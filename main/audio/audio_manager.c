@@ -37,15 +37,7 @@ static audio_event_iface_handle_t s_evt = NULL;
 #include "audio.h"
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
-
-// MINIMP3_IMPLEMENTATION must be defined in exactly one C file
-#define MINIMP3_IMPLEMENTATION
-#include "minimp3.h"
 #include <string.h>
-
-static TaskHandle_t s_mp3_task = NULL;
-static volatile bool s_mp3_stop = false;
-static char *s_current_url = NULL;
 #endif // MIMI_HAS_ADF
 
 static bool s_is_playing = false;
@@ -78,46 +70,31 @@ static audio_element_handle_t create_mp3_decoder(void)
 #endif
 
 #if !MIMI_HAS_ADF
-static bool wait_mp3_task_exit(uint32_t timeout_ms)
-{
-    uint32_t waited = 0;
-    while (s_mp3_task != NULL && waited < timeout_ms) {
-        vTaskDelay(pdMS_TO_TICKS(20));
-        waited += 20;
-    }
-    return (s_mp3_task == NULL);
-}
+/* HTTP source for mp3_stream; runs in its fetch task */
+typedef struct {
+    char *url;
+    esp_http_client_handle_t client;
+} http_source_t;
 
-static void mp3_player_task(void *pvParameters)
+static esp_err_t http_source_open(void *ctx)
 {
-    ESP_LOGI(TAG, "Native MP3 player task started");
-    s_is_playing = true;
-
-    char *url_snapshot = NULL;
-    if (s_current_url) {
-        url_snapshot = strdup(s_current_url);
-    }
-    if (!url_snapshot) {
-        ESP_LOGE(TAG, "No URL to play");
-        goto cleanup;
-    }
-    
+    http_source_t *src = ctx;
     esp_http_client_config_t config = {
-        .url = url_snapshot,
+        .url = src->url,
         .buffer_size = 4096,
         .timeout_ms = 15000,
         .crt_bundle_attach = esp_crt_bundle_attach,
     };
-    
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) {
+
+    src->client = esp_http_client_init(&config);
+    if (!src->client) {
         ESP_LOGE(TAG, "Failed to init HTTP client");
-        goto cleanup;
+        return ESP_FAIL;
     }
 
     esp_err_t err = ESP_FAIL;
     for (int attempt = 1; attempt <= 3; attempt++) {
-        err = esp_http_client_open(client, 0);
+        err = esp_http_client_open(src->client, 0);
         if (err == ESP_OK) {
             break;
         }
@@ -126,105 +103,57 @@ static void mp3_player_task(void *pvParameters)
     }
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to open HTTP connection after retries: %s", esp_err_to_name(err));
-        goto cleanup_client;
+        return err;
     }
-    
-    int content_length = esp_http_client_fetch_headers(client);
+
+    int content_length = esp_http_client_fetch_headers(src->client);
     ESP_LOGI(TAG, "HTTP stream opened, length: %d", content_length);
+    return ESP_OK;
+}
 
-    mp3dec_t *mp3d = calloc(1, sizeof(mp3dec_t));
-    if (!mp3d) {
-        ESP_LOGE(TAG, "Failed to allocate MP3 decoder");
-        goto cleanup_client;
-    }
-    mp3dec_init(mp3d);
-    
-    #define MP3_BUF_SIZE 16384
-    uint8_t *in_buf = malloc(MP3_BUF_SIZE);
-    short *pcm = malloc(MINIMP3_MAX_SAMPLES_PER_FRAME * sizeof(short) * 2);
-    
-    if (!in_buf || !pcm) {
-        ESP_LOGE(TAG, "Failed to allocate MP3 buffers");
-        if(mp3d) free(mp3d);
-        if(in_buf) free(in_buf);
-        if(pcm) free(pcm);
-        goto cleanup_client;
+static int http_source_read(void *ctx, uint8_t *buf, size_t len)
+{
+    http_source_t *src = ctx;
+    for (int idle = 0; idle < 50; idle++) {
+        int n = esp_http_client_read(src->client, (char *)buf, len);
+        if (n != 0) return n;
+        if (esp_http_client_is_complete_data_received(src->client)) return 0;
+        // No data yet; the ring keeps the speaker fed meanwhile
+        vTaskDelay(pdMS_TO_TICKS(20));
     }
+    ESP_LOGE(TAG, "HTTP stream stalled");
+    return -1;
+}
 
-    int bytes_in_buf = 0;
-    bool eof = false;
-    bool rate_set = false;
-    mp3dec_frame_info_t info;
-
-    while (!s_mp3_stop && !eof) {
-        // Read more data if buffer is less than half full
-        if (bytes_in_buf < MP3_BUF_SIZE / 2) {
-            int to_read = MP3_BUF_SIZE - bytes_in_buf;
-            int read_len = esp_http_client_read(client, (char*)in_buf + bytes_in_buf, to_read);
-            if (read_len < 0) {
-                ESP_LOGE(TAG, "HTTP read error");
-                break;
-            } else if (read_len == 0) {
-                if (esp_http_client_is_complete_data_received(client)) {
-                    eof = true;
-                }
-            } else {
-                bytes_in_buf += read_len;
-            }
-        }
-
-        if (bytes_in_buf == 0 && eof) break; 
+static void http_source_close(void *ctx)
+{
+    http_source_t *src = ctx;
+    if (src->client) {
+        esp_http_client_cleanup(src->client);
+        src->client = NULL;
+    }
+}
 
-        int samples = mp3dec_decode_frame(mp3d, in_buf, bytes_in_buf, pcm, &info);
-        
-        if (info.frame_bytes > 0 && info.frame_bytes <= bytes_in_buf) {
-            bytes_in_buf -= info.frame_bytes;
-            memmove(in_buf, in_buf + info.frame_bytes, bytes_in_buf);
-        } else if (info.frame_bytes == 0) {
-            if (eof) break;
-            vTaskDelay(pdMS_TO_TICKS(10));
-            continue;
-        }
+static esp_err_t speaker_begin(void *ctx, int sample_rate)
+{
+    audio_set_sample_rate(sample_rate);
+    return audio_speaker_start();
+}
 
-        if (samples > 0) {
-            if (!rate_set) {
-                ESP_LOGI(TAG, "MP3 format: %d Hz, %d channels", info.hz, info.channels);
-                audio_set_sample_rate(info.hz);
-                rate_set = true;
-            }
-
-            if (info.channels == 2) {
-                for (int i = 0; i < samples; i++) {
-                    pcm[i] = (short)(((int)pcm[i*2] + (int)pcm[i*2 + 1]) / 2);
-                }
-            }
-
-            // Ensure speaker is started before writing
-            extern esp_err_t audio_speaker_start(void);
-            audio_speaker_start();
-
-            esp_err_t wr_err = audio_speaker_write((uint8_t*)pcm, samples * sizeof(short));
-            if (wr_err != ESP_OK) {
-                ESP_LOGW(TAG, "Speaker write error: %s", esp_err_to_name(wr_err));
-            }
-        }
-        // Yield enough time for Wi-Fi and LwIP to process packets to avoid connection drops
-        vTaskDelay(pdMS_TO_TICKS(5));
+static esp_err_t speaker_write(void *ctx, const int16_t *pcm, size_t samples)
+{
+    esp_err_t err = audio_speaker_write((const uint8_t *)pcm, samples * sizeof(int16_t));
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Speaker write error: %s", esp_err_to_name(err));
     }
+    return err;
+}
 
-    if(mp3d) free(mp3d);
-    free(in_buf);
-    free(pcm);
-
-cleanup_client:
-    esp_http_client_cleanup(client);
-    
-cleanup:
-    ESP_LOGI(TAG, "MP3 player task finished");
-    if (url_snapshot) free(url_snapshot);
-    s_is_playing = false;
-    s_mp3_task = NULL;
-    vTaskDelete(NULL);
+static void http_source_free(void *ctx)
+{
+    http_source_t *src = ctx;
+    free(src->url);
+    free(src);
 }
 #endif // !MIMI_HAS_ADF
 
@@ -290,10 +219,8 @@ static void _audio_stop_pipeline(void)
     audio_pipeline_terminate(s_pipeline);
     audio_pipeline_unlink(s_pipeline);
 #else
-    if (s_mp3_task != NULL) {
-        s_mp3_stop = true;
-        // The background task will stop on the next iteration and clear playing state.
-    }
+    // Stream stages stop on their next wait and free their buffers.
+    mp3_stream_stop();
 #endif
     s_is_playing = false;
 }
@@ -301,7 +228,7 @@ static void _audio_stop_pipeline(void)
 esp_err_t audio_manager_play_url(const char *url)
 {
     // Ensure previous playback is stopped cleanly
-    if (s_is_playing) {
+    if (audio_manager_is_playing()) {
         _audio_stop_pipeline();
         // Give time for previous task to fully exit
         vTaskDelay(pdMS_TO_TICKS(100));
@@ -327,35 +254,36 @@ esp_err_t audio_manager_play_url(const char *url)
     s_is_playing = true;
     return ESP_OK;
 #else
-    // Stop old playback task first and wait for a clean handover.
-    if (s_mp3_task != NULL) {
-        s_mp3_stop = true;
-        if (!wait_mp3_task_exit(3000)) {
-            ESP_LOGE(TAG, "Previous MP3 task did not exit in time");
-            return ESP_ERR_TIMEOUT;
-        }
+    // Stop the old stream first and wait for a clean handover.
+    if (mp3_stream_active()) {
+        mp3_stream_stop();
     }
-
-    s_mp3_stop = false;
-    if (s_current_url) {
-        free(s_current_url);
-        s_current_url = NULL;
+    if (!mp3_stream_wait(3000)) {
+        ESP_LOGE(TAG, "Previous MP3 stream did not exit in time");
+        return ESP_ERR_TIMEOUT;
     }
-    s_current_url = strdup(url);
-    if (!s_current_url) {
+
+    http_source_t *src = calloc(1, sizeof(*src));
+    if (!src || !(src->url = strdup(url))) {
         ESP_LOGE(TAG, "Failed to allocate URL");
+        free(src);
         return ESP_ERR_NO_MEM;
     }
 
-    // Lower priority to 3 so it doesn't starve the LwIP/Wi-Fi stack
-    if (xTaskCreate(mp3_player_task, "mp3_player", 16384, NULL, 3, &s_mp3_task) == pdPASS) {
-        return ESP_OK;
-    } else {
-        ESP_LOGE(TAG, "Failed to create mp3_player task");
-        free(s_current_url);
-        s_current_url = NULL;
-        return ESP_FAIL;
+    mp3_stream_io_t io = {
+        .ctx = src,
+        .open = http_source_open,
+        .read = http_source_read,
+        .close = http_source_close,
+        .begin = speaker_begin,
+        .write = speaker_write,
+        .done = http_source_free,
+    };
+    esp_err_t err = mp3_stream_start(&io);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start MP3 stream: %s", esp_err_to_name(err));
     }
+    return err;
 #endif
 }
 
@@ -368,12 +296,12 @@ esp_err_t audio_manager_play_file(const char *path)
 
 esp_err_t audio_manager_stop(void)
 {
-    if (s_is_playing) {
+    if (audio_manager_is_playing()) {
         ESP_LOGI(TAG, "Stopping playback");
         _audio_stop_pipeline();
 #if !MIMI_HAS_ADF
-        if (!wait_mp3_task_exit(3000)) {
-            ESP_LOGW(TAG, "MP3 task still running after stop timeout");
+        if (!mp3_stream_wait(3000)) {
+            ESP_LOGW(TAG, "MP3 stream still running after stop timeout");
         }
 #endif
     }
@@ -418,5 +346,19 @@ int audio_manager_get_volume(void)
 
 bool audio_manager_is_playing(void)
 {
+#if MIMI_HAS_ADF
     return s_is_playing;
+#else
+    return mp3_stream_active();
+#endif
+}
+
+esp_err_t audio_manager_get_stream_stats(mp3_stream_stats_t *out)
+{
+#if MIMI_HAS_ADF
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    mp3_stream_get_stats(out);
+    return ESP_OK;
+#endif
 }
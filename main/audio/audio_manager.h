@@ -2,6 +2,7 @@
 #define AUDIO_MANAGER_H
 
 #include "esp_err.h"
+#include "audio/mp3_stream.h"
 #include <stdbool.h>
 
 #ifdef __cplusplus
@@ -35,6 +36,10 @@ int audio_manager_get_volume(void);
 // Check if audio is currently playing
 bool audio_manager_is_playing(void);
 
+// Buffer levels and underrun counters of the current (or last) stream;
+// ESP_ERR_NOT_SUPPORTED on the ESP-ADF path
+esp_err_t audio_manager_get_stream_stats(mp3_stream_stats_t *out);
+
 #ifdef __cplusplus
 }
 #endif
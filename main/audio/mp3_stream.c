@@ -0,0 +1,366 @@
+#include "audio/mp3_stream.h"
+#include "audio/spsc_ring.h"
+#include "audio/audio_dsp.h"
+#include "mimi_config.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+// MINIMP3_IMPLEMENTATION must be defined in exactly one C file
+#define MINIMP3_IMPLEMENTATION
+#include "minimp3.h"
+
+static const char *TAG = "mp3_stream";
+
+/* Decode window: two of the largest frames, since minimp3 confirms sync
+ * against the following header. Also the input ring's unwrap slack. */
+#define DECODE_WINDOW   (2 * 2304)
+#define SINK_CHUNK      1024            /* bytes per output write, ~12 ms */
+#define WAIT_TICKS      pdMS_TO_TICKS(50)
+
+static mp3_stream_io_t s_io;
+static spsc_ring_t s_in;
+static spsc_ring_t s_pcm;
+static mp3_stream_stats_t s_stats;
+
+static TaskHandle_t s_fetch_task;
+static TaskHandle_t s_decode_task;
+static TaskHandle_t s_sink_task;
+
+static atomic_bool s_stop;
+static atomic_bool s_fetch_eof;
+static atomic_bool s_fetch_paused;
+static atomic_bool s_decode_eof;
+static atomic_int s_rate;
+static atomic_int s_active;             /* stage loops still running */
+static atomic_int s_alive;              /* stage tasks not yet deleted */
+
+static void wake(TaskHandle_t task)
+{
+    if (task) xTaskNotifyGive(task);
+}
+
+static void finish(void)
+{
+    const mp3_stream_stats_t *st = &s_stats;
+    ESP_LOGI(TAG, "Stream ended: %u frames, %u bytes in, %u Hz, "
+             "underruns in/pcm %u/%u, min input level %u, decode avg/max %u/%u us",
+             (unsigned)st->frames_decoded, (unsigned)st->bytes_fetched, (unsigned)st->sample_rate,
+             (unsigned)st->in_underruns, (unsigned)st->pcm_underruns,
+             (unsigned)(st->in_level_min == UINT32_MAX ? 0 : st->in_level_min),
+             (unsigned)(st->frames_decoded ? st->decode_us_total / st->frames_decoded : 0),
+             (unsigned)st->decode_us_max);
+
+    s_fetch_task = s_decode_task = s_sink_task = NULL;
+    spsc_ring_free(&s_in);
+    spsc_ring_free(&s_pcm);
+    if (s_io.done) s_io.done(s_io.ctx);
+}
+
+/* The last stage out tears the stream down. The others linger until then,
+ * so nobody ever notifies a deleted task. */
+static void stage_exit(void)
+{
+    if (atomic_fetch_sub(&s_active, 1) == 1) finish();
+    while (atomic_load(&s_active) > 0) vTaskDelay(pdMS_TO_TICKS(10));
+    atomic_fetch_sub(&s_alive, 1);
+    vTaskDelete(NULL);
+}
+
+/* A stage whose task could not be created */
+static void abandon_stage(void)
+{
+    if (atomic_fetch_sub(&s_active, 1) == 1) finish();
+    atomic_fetch_sub(&s_alive, 1);
+}
+
+/* ── Fetch: source → input ring ─────────────────────────────── */
+
+static void fetch_task(void *arg)
+{
+    if (s_io.open(s_io.ctx) != ESP_OK) {
+        ESP_LOGE(TAG, "Source open failed");
+        goto out;
+    }
+
+    while (!atomic_load(&s_stop)) {
+        /* Hysteresis: pause at the high watermark, resume at the low one,
+         * so reads come in large bursts rather than a frame at a time */
+        size_t level = spsc_ring_level(&s_in);
+        if (atomic_load(&s_fetch_paused) ? level > MIMI_MP3_IN_LOW_WATER
+                                         : level >= MIMI_MP3_IN_HIGH_WATER) {
+            atomic_store(&s_fetch_paused, true);
+            ulTaskNotifyTake(pdTRUE, WAIT_TICKS);
+            continue;
+        }
+        atomic_store(&s_fetch_paused, false);
+
+        uint8_t *dst;
+        size_t span = spsc_ring_write_span(&s_in, &dst);
+        if (span > MIMI_MP3_FETCH_CHUNK) span = MIMI_MP3_FETCH_CHUNK;
+        if (span == 0) {
+            ulTaskNotifyTake(pdTRUE, WAIT_TICKS);
+            continue;
+        }
+
+        int n = s_io.read(s_io.ctx, dst, span);
+        if (n < 0) {
+            ESP_LOGE(TAG, "Source read error");
+            break;
+        }
+        if (n == 0) break;
+        spsc_ring_produce(&s_in, n);
+        s_stats.bytes_fetched += n;
+        wake(s_decode_task);
+    }
+
+out:
+    s_io.close(s_io.ctx);
+    atomic_store(&s_fetch_eof, true);
+    wake(s_decode_task);
+    stage_exit();
+}
+
+/* ── Decode: input ring → PCM ring ──────────────────────────── */
+
+static void push_pcm(const int16_t *pcm, size_t samples)
+{
+    const uint8_t *src = (const uint8_t *)pcm;
+    size_t len = samples * sizeof(int16_t), off = 0;
+    while (off < len && !atomic_load(&s_stop)) {
+        size_t n = spsc_ring_write(&s_pcm, src + off, len - off);
+        if (n) {
+            off += n;
+            wake(s_sink_task);
+        }
+        if (off < len) ulTaskNotifyTake(pdTRUE, WAIT_TICKS);
+    }
+}
+
+static void decode_task(void *arg)
+{
+    mp3dec_t *dec = calloc(1, sizeof(mp3dec_t));
+    int16_t *pcm = heap_caps_aligned_alloc(AUDIO_DSP_ALIGN,
+                                           MINIMP3_MAX_SAMPLES_PER_FRAME * sizeof(int16_t),
+                                           MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!dec || !pcm) {
+        ESP_LOGE(TAG, "Failed to allocate MP3 decoder");
+        atomic_store(&s_stop, true);
+        goto out;
+    }
+    mp3dec_init(dec);
+
+    bool buffering = true, started = false;
+    while (!atomic_load(&s_stop)) {
+        bool eof = atomic_load(&s_fetch_eof);
+        size_t level = spsc_ring_level(&s_in);
+
+        /* Prefetch to the low watermark at start and after running dry */
+        if (buffering) {
+            if (level < MIMI_MP3_IN_LOW_WATER && !eof) {
+                ulTaskNotifyTake(pdTRUE, WAIT_TICKS);
+                continue;
+            }
+            buffering = false;
+        } else if (started && !eof && level < s_stats.in_level_min) {
+            s_stats.in_level_min = level;
+        }
+
+        const uint8_t *frame;
+        size_t avail = spsc_ring_read_span(&s_in, DECODE_WINDOW, &frame);
+        mp3dec_frame_info_t info;
+        int64_t t0 = esp_timer_get_time();
+        int samples = avail ? mp3dec_decode_frame(dec, frame, avail, pcm, &info) : 0;
+        uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+
+        /* Given less than a frame, minimp3 reports the whole span as
+         * skipped; mid-stream that is a dry ring, not garbage */
+        bool short_span = avail < DECODE_WINDOW && samples == 0 && !eof;
+        if (avail == 0 || info.frame_bytes == 0 || short_span) {
+            /* Not one whole frame queued */
+            if (eof) break;
+            if (avail < DECODE_WINDOW) {
+                if (started) s_stats.in_underruns++;
+                buffering = true;
+            } else {
+                spsc_ring_consume(&s_in, 1);    /* unsyncable window; cannot happen */
+            }
+            continue;
+        }
+
+        /* Frames are decoded straight out of the ring; release them now */
+        spsc_ring_consume(&s_in, info.frame_bytes);
+        if (atomic_load(&s_fetch_paused) &&
+            spsc_ring_level(&s_in) <= MIMI_MP3_IN_LOW_WATER) {
+            wake(s_fetch_task);
+        }
+
+        if (samples == 0) {
+            s_stats.bytes_skipped += info.frame_bytes;
+            continue;
+        }
+
+        s_stats.frames_decoded++;
+        s_stats.decode_us_total += us;
+        if (us > s_stats.decode_us_max) s_stats.decode_us_max = us;
+        if (!started) {
+            ESP_LOGI(TAG, "MP3 format: %d Hz, %d channels", info.hz, info.channels);
+            s_stats.sample_rate = info.hz;
+            atomic_store(&s_rate, info.hz);
+            started = true;
+        }
+
+        if (info.channels == 2) {
+            audio_dsp_downmix_stereo(pcm, pcm, samples);
+        }
+        push_pcm(pcm, samples);
+    }
+
+out:
+    free(dec);
+    heap_caps_free(pcm);
+    atomic_store(&s_decode_eof, true);
+    wake(s_sink_task);
+    wake(s_fetch_task);
+    stage_exit();
+}
+
+/* ── Sink: PCM ring → output ────────────────────────────────── */
+
+static void sink_task(void *arg)
+{
+    bool priming = true, begun = false, dry = false;
+
+    while (!atomic_load(&s_stop)) {
+        bool eof = atomic_load(&s_decode_eof);
+        if (priming) {
+            if (spsc_ring_level(&s_pcm) < MIMI_MP3_PCM_START && !eof) {
+                ulTaskNotifyTake(pdTRUE, WAIT_TICKS);
+                continue;
+            }
+            priming = false;
+        }
+
+        const uint8_t *p;
+        size_t n = spsc_ring_read_span(&s_pcm, SINK_CHUNK, &p) & ~(size_t)1;
+        if (n == 0) {
+            if (eof) break;
+            /* Ran dry mid-stream: count the gap once, then re-prime */
+            if (!dry) s_stats.pcm_underruns++;
+            dry = priming = true;
+            continue;
+        }
+        dry = false;
+
+        if (!begun) {
+            if (s_io.begin(s_io.ctx, atomic_load(&s_rate)) != ESP_OK) {
+                ESP_LOGE(TAG, "Sink begin failed");
+                atomic_store(&s_stop, true);
+                break;
+            }
+            begun = true;
+        }
+        s_io.write(s_io.ctx, (const int16_t *)p, n / sizeof(int16_t));
+        spsc_ring_consume(&s_pcm, n);
+        s_stats.samples_out += n / sizeof(int16_t);
+        wake(s_decode_task);
+    }
+
+    stage_exit();
+}
+
+/* ── Control ────────────────────────────────────────────────── */
+
+esp_err_t mp3_stream_start(const mp3_stream_io_t *io)
+{
+    if (!io || !io->open || !io->read || !io->close || !io->begin || !io->write) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (atomic_load(&s_alive) > 0) return ESP_ERR_INVALID_STATE;
+
+    s_io = *io;
+    if (spsc_ring_init(&s_in, MIMI_MP3_IN_RING_SIZE, DECODE_WINDOW) != ESP_OK ||
+        spsc_ring_init(&s_pcm, MIMI_MP3_PCM_RING_SIZE, SINK_CHUNK) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to allocate stream rings");
+        spsc_ring_free(&s_in);
+        spsc_ring_free(&s_pcm);
+        if (s_io.done) s_io.done(s_io.ctx);
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.in_size = s_in.size;
+    s_stats.pcm_size = s_pcm.size;
+    s_stats.in_level_min = UINT32_MAX;
+    atomic_store(&s_stop, false);
+    atomic_store(&s_fetch_eof, false);
+    atomic_store(&s_fetch_paused, false);
+    atomic_store(&s_decode_eof, false);
+    atomic_store(&s_rate, 0);
+    atomic_store(&s_active, 3);
+    atomic_store(&s_alive, 3);
+
+    /* Downstream first, so each stage's consumer exists when it starts */
+    int created = 0;
+    if (xTaskCreatePinnedToCore(sink_task, "mp3_sink", MIMI_MP3_SINK_STACK, NULL,
+                                MIMI_MP3_SINK_PRIO, &s_sink_task, MIMI_MP3_SINK_CORE) == pdPASS) {
+        created++;
+        if (xTaskCreatePinnedToCore(decode_task, "mp3_decode", MIMI_MP3_DECODE_STACK, NULL,
+                                    MIMI_MP3_DECODE_PRIO, &s_decode_task,
+                                    MIMI_MP3_DECODE_CORE) == pdPASS) {
+            created++;
+            if (xTaskCreatePinnedToCore(fetch_task, "mp3_fetch", MIMI_MP3_FETCH_STACK, NULL,
+                                        MIMI_MP3_FETCH_PRIO, &s_fetch_task,
+                                        MIMI_MP3_FETCH_CORE) == pdPASS) {
+                created++;
+            }
+        }
+    }
+    if (created < 3) {
+        ESP_LOGE(TAG, "Failed to create stream tasks");
+        atomic_store(&s_stop, true);
+        for (int i = created; i < 3; i++) abandon_stage();
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void mp3_stream_stop(void)
+{
+    /* Every stage wait times out within WAIT_TICKS; no wake needed (a
+     * handle read here could belong to a task that is about to exit) */
+    atomic_store(&s_stop, true);
+}
+
+bool mp3_stream_wait(uint32_t timeout_ms)
+{
+    uint32_t waited = 0;
+    while (atomic_load(&s_alive) > 0 && waited < timeout_ms) {
+        vTaskDelay(pdMS_TO_TICKS(20));
+        waited += 20;
+    }
+    return atomic_load(&s_alive) == 0;
+}
+
+bool mp3_stream_active(void)
+{
+    return atomic_load(&s_active) > 0;
+}
+
+void mp3_stream_get_stats(mp3_stream_stats_t *out)
+{
+    *out = s_stats;
+    if (out->in_level_min == UINT32_MAX) out->in_level_min = 0;
+    if (mp3_stream_active()) {
+        out->in_level = spsc_ring_level(&s_in);
+        out->pcm_level = spsc_ring_level(&s_pcm);
+    } else {
+        out->in_level = out->pcm_level = 0;
+    }
+}
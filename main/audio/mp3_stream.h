@@ -0,0 +1,78 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* ── Three-stage MP3 stream ───────────────────────────────────────
+ *
+ *   fetch task ──► input ring ──► decode task ──► PCM ring ──► sink task
+ *
+ * The fetch task fills the compressed ring from the source, pausing above
+ * the high watermark and resuming below the low one. The decoder waits for
+ * the low watermark before starting (and again after running dry), decodes
+ * frames in place from the ring and queues mono PCM. The sink task drains
+ * PCM to the output at device pace. Network stalls shorter than the input
+ * ring are absorbed without a gap.
+ *
+ * Source and sink are callbacks so the same pipeline runs against HTTP +
+ * I2S on the device, or a file and a null sink for measurement.
+ * One stream at a time.
+ */
+
+typedef struct {
+    void *ctx;
+
+    /* Source, called from the fetch task */
+    esp_err_t (*open)(void *ctx);
+    int (*read)(void *ctx, uint8_t *buf, size_t len);   /* >0 bytes, 0 end, <0 error */
+    void (*close)(void *ctx);                            /* also after a failed open */
+
+    /* Sink, called from the sink task */
+    esp_err_t (*begin)(void *ctx, int sample_rate);     /* before the first write */
+    esp_err_t (*write)(void *ctx, const int16_t *pcm, size_t samples);   /* mono, may block */
+
+    /* Called once from the last stage to exit; ctx may be freed here */
+    void (*done)(void *ctx);
+} mp3_stream_io_t;
+
+typedef struct {
+    uint32_t in_level;          /* bytes queued now */
+    uint32_t in_size;
+    uint32_t in_level_min;      /* lowest level seen while playing */
+    uint32_t pcm_level;
+    uint32_t pcm_size;
+    uint32_t bytes_fetched;
+    uint32_t bytes_skipped;     /* ID3 tags and garbage between frames */
+    uint32_t frames_decoded;
+    uint32_t samples_out;
+    uint32_t in_underruns;      /* decoder ran dry and rebuffered */
+    uint32_t pcm_underruns;     /* output ran dry: audible gaps */
+    uint32_t decode_us_total;
+    uint32_t decode_us_max;     /* slowest single frame */
+    int sample_rate;
+} mp3_stream_stats_t;
+
+/**
+ * Start the three stage tasks. Fails if a stream is still running.
+ */
+esp_err_t mp3_stream_start(const mp3_stream_io_t *io);
+
+/**
+ * Ask every stage to stop; returns without waiting.
+ */
+void mp3_stream_stop(void);
+
+/**
+ * Wait for all stages to exit.
+ * @return true once the stream is idle
+ */
+bool mp3_stream_wait(uint32_t timeout_ms);
+
+bool mp3_stream_active(void);
+
+/**
+ * Snapshot of the current (or last) stream's counters.
+ */
+void mp3_stream_get_stats(mp3_stream_stats_t *out);
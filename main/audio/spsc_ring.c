@@ -0,0 +1,105 @@
+#include "audio/spsc_ring.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include "esp_heap_caps.h"
+
+esp_err_t spsc_ring_init(spsc_ring_t *r, size_t size, size_t slack)
+{
+    size_t pow2 = 1;
+    while (pow2 < size) pow2 <<= 1;
+
+    r->buf = heap_caps_malloc(pow2 + slack, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!r->buf) return ESP_ERR_NO_MEM;
+    r->size = pow2;
+    r->slack = slack;
+    spsc_ring_reset(r);
+    return ESP_OK;
+}
+
+void spsc_ring_free(spsc_ring_t *r)
+{
+    free(r->buf);
+    r->buf = NULL;
+    r->size = 0;
+}
+
+void spsc_ring_reset(spsc_ring_t *r)
+{
+    atomic_store_explicit(&r->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, 0, memory_order_relaxed);
+}
+
+/* Safe from either side or a third task: tail is read first, so head is
+ * never older than it. Both may move in between, which only the clamp
+ * can bound. */
+size_t spsc_ring_level(spsc_ring_t *r)
+{
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    size_t level = head - tail;
+    return level < r->size ? level : r->size;
+}
+
+size_t spsc_ring_space(spsc_ring_t *r)
+{
+    return r->size - spsc_ring_level(r);
+}
+
+size_t spsc_ring_write_span(spsc_ring_t *r, uint8_t **ptr)
+{
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    size_t off = head & (r->size - 1);
+    size_t space = r->size - (head - tail);
+    size_t contig = r->size - off;
+
+    *ptr = r->buf + off;
+    return space < contig ? space : contig;
+}
+
+void spsc_ring_produce(spsc_ring_t *r, size_t n)
+{
+    atomic_fetch_add_explicit(&r->head, n, memory_order_release);
+}
+
+size_t spsc_ring_write(spsc_ring_t *r, const void *data, size_t len)
+{
+    const uint8_t *src = data;
+    size_t done = 0;
+    while (done < len) {
+        uint8_t *dst;
+        size_t n = spsc_ring_write_span(r, &dst);
+        if (n == 0) break;
+        if (n > len - done) n = len - done;
+        memcpy(dst, src + done, n);
+        spsc_ring_produce(r, n);
+        done += n;
+    }
+    return done;
+}
+
+size_t spsc_ring_read_span(spsc_ring_t *r, size_t want, const uint8_t **ptr)
+{
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    size_t off = tail & (r->size - 1);
+    size_t n = head - tail;
+    if (n > want) n = want;
+
+    *ptr = r->buf + off;
+    size_t contig = r->size - off;
+    if (n <= contig) return n;
+
+    /* Unwrap: the bytes at the start of the buffer are already written,
+     * and the producer never touches the slack area */
+    size_t wrapped = n - contig;
+    if (wrapped > r->slack) wrapped = r->slack;
+    memcpy(r->buf + r->size, r->buf, wrapped);
+    return contig + wrapped;
+}
+
+void spsc_ring_consume(spsc_ring_t *r, size_t n)
+{
+    atomic_fetch_add_explicit(&r->tail, n, memory_order_release);
+}
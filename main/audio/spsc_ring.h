@@ -0,0 +1,69 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* ── Single-producer / single-consumer byte ring ──────────────────
+ *
+ * Lock-free between exactly one writer task and one reader task: each
+ * side only advances its own counter. Both sides can work in place
+ * through spans instead of copying. A read span that would wrap is made
+ * contiguous by copying its wrapped head into `slack` spare bytes past
+ * the end of the buffer, so a reader that needs whole records (an MP3
+ * frame) pays one short copy at the wrap point instead of a memmove
+ * per record.
+ */
+
+typedef struct {
+    uint8_t *buf;               /* size + slack bytes, PSRAM */
+    size_t size;                /* power of two */
+    size_t slack;
+    atomic_size_t head;         /* total bytes written */
+    atomic_size_t tail;         /* total bytes read */
+} spsc_ring_t;
+
+/**
+ * Allocate the buffer. `size` is rounded up to a power of two.
+ */
+esp_err_t spsc_ring_init(spsc_ring_t *r, size_t size, size_t slack);
+
+void spsc_ring_free(spsc_ring_t *r);
+
+/**
+ * Empty the ring. Only while neither side is using it.
+ */
+void spsc_ring_reset(spsc_ring_t *r);
+
+/** Bytes ready to read. */
+size_t spsc_ring_level(spsc_ring_t *r);
+
+/** Bytes that can be written. */
+size_t spsc_ring_space(spsc_ring_t *r);
+
+/* Producer side */
+
+/**
+ * Contiguous free region; fill it and call spsc_ring_produce().
+ * @return Its length (0 when full)
+ */
+size_t spsc_ring_write_span(spsc_ring_t *r, uint8_t **ptr);
+void spsc_ring_produce(spsc_ring_t *r, size_t n);
+
+/**
+ * Copy in as much of data as fits.
+ * @return Bytes written
+ */
+size_t spsc_ring_write(spsc_ring_t *r, const void *data, size_t len);
+
+/* Consumer side */
+
+/**
+ * Up to `want` readable bytes as one contiguous span, unwrapping through
+ * the slack area when needed (at most `slack` bytes past the wrap).
+ * Release them with spsc_ring_consume().
+ * @return Span length (0 when empty)
+ */
+size_t spsc_ring_read_span(spsc_ring_t *r, size_t want, const uint8_t **ptr);
+void spsc_ring_consume(spsc_ring_t *r, size_t n);
@@ -1,71 +1,150 @@
 #include "audio/tts_client.h"
 #include "audio/audio.h" // Legacy I2S driver for direct PCM writes
+#include "audio/audio_manager.h"
+#include "audio/spsc_ring.h"
 #include "llm/llm_proxy.h"
+#include "mimi_config.h"
 #include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "cJSON.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "tts_client";
 
-// Expose these from llm_proxy
-// extern char s_openai_api_key_audio[];
-// extern char s_tts_endpoint[];
-
-// Helper to handle the audio stream coming back from OpenAI
-// We request PCM, 24kHz or 16k, so we can just blast it into i2s_write
-static esp_err_t _http_event_handle_tts(esp_http_client_event_t *evt) {
-    switch (evt->event_id) {
-        case HTTP_EVENT_ON_DATA:
-            if (evt->data_len > 0) {
-                // OpenAI returns raw PCM or WAV if we select it
-                // We just stream evt->data directly to the I2S speaker buffer
-                
-                // For a robust implementation, we might want to skip the 44-byte WAV header
-                // But as a quick MVP we can push it all.
-                
-                // I2S write block
-                audio_speaker_write((const uint8_t *)evt->data, (size_t)evt->data_len);
-            }
-            break;
-        default:
-            break;
+// OpenAI "pcm" responses are 24 kHz 16-bit mono
+#define TTS_SAMPLE_RATE     24000
+#define PLAY_CHUNK          1024            /* bytes per speaker write, ~21 ms */
+#define WAIT_TICKS          pdMS_TO_TICKS(50)
+
+struct tts_stream {
+    spsc_ring_t pcm;                /* jitter buffer: fetch → playback */
+    QueueHandle_t sentences;        /* char *; NULL marks the end of text */
+    SemaphoreHandle_t done;         /* playback finished */
+    SemaphoreHandle_t wake;         /* PCM queued or fetch state changed */
+    SemaphoreHandle_t space;        /* PCM consumed */
+    atomic_int refs;                /* caller + fetch task + playback task */
+    atomic_bool fetch_done;         /* end of text reached and fetched */
+    atomic_bool fetch_idle;         /* waiting for the next sentence */
+    atomic_bool aborted;
+    esp_err_t result;               /* first synthesis error */
+    char *pending;                  /* text not yet cut into a sentence */
+    size_t pending_len;
+    uint32_t sentences_queued;
+    uint32_t underruns;
+    int64_t begin_us;
+};
+
+static void stream_release(tts_stream_t *s)
+{
+    if (atomic_fetch_sub(&s->refs, 1) != 1) return;
+    spsc_ring_free(&s->pcm);
+    vQueueDelete(s->sentences);
+    vSemaphoreDelete(s->done);
+    vSemaphoreDelete(s->wake);
+    vSemaphoreDelete(s->space);
+    free(s->pending);
+    free(s);
+}
+
+/* ── Sentence segmentation (caller's task) ──────────────────── */
+
+static void queue_sentence(tts_stream_t *s, const char *text, size_t len)
+{
+    // Markdown emphasis and headings would be read out literally
+    char *out = heap_caps_malloc(len + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!out) return;
+    size_t n = 0;
+    bool speakable = false;
+    for (size_t i = 0; i < len; i++) {
+        char c = text[i];
+        if (c == '*' || c == '#' || c == '`') continue;
+        if ((unsigned char)c > ' ') speakable = true;
+        out[n++] = c;
     }
-    return ESP_OK;
+    out[n] = '\0';
+    if (!speakable) {
+        free(out);
+        return;
+    }
+    s->sentences_queued++;
+    xQueueSend(s->sentences, &out, portMAX_DELAY);
 }
 
-esp_err_t tts_speak(const char *text) {
-    const char *api_key = llm_get_openai_api_key_audio();
-    const char *endpoint = llm_get_tts_endpoint();
+/* Length of a sentence ending at the last byte, or 0 */
+static size_t sentence_end(const char *p, size_t len)
+{
+    char c = p[len - 1];
+    if (c == '\n') return len;
+    // ". " rather than "." so decimals and most abbreviations stay whole
+    if ((c == ' ' || c == '\t') && len >= 2 &&
+        (p[len - 2] == '.' || p[len - 2] == '!' || p[len - 2] == '?' || p[len - 2] == ';')) {
+        return len;
+    }
+    // Full-width 。！？ end a sentence on their own
+    if (len >= 3) {
+        const unsigned char *u = (const unsigned char *)p + len - 3;
+        if ((u[0] == 0xE3 && u[1] == 0x80 && u[2] == 0x82) ||
+            (u[0] == 0xEF && u[1] == 0xBC && (u[2] == 0x81 || u[2] == 0x9F))) {
+            return len;
+        }
+    }
+    return 0;
+}
 
-    if (!text || strlen(text) == 0) return ESP_ERR_INVALID_ARG;
-    if (!endpoint || strlen(endpoint) == 0) {
-        ESP_LOGE(TAG, "TTS endpoint not configured");
-        return ESP_ERR_INVALID_STATE;
+/* An over-long run without punctuation: split at the last space or comma
+ * in its second half, else at the last UTF-8 character boundary. */
+static size_t forced_cut(const char *p, size_t len)
+{
+    for (size_t i = len; i > len / 2; i--) {
+        if (p[i - 1] == ' ' || p[i - 1] == ',') return i;
     }
+    size_t i = len;
+    while (i > 0 && ((unsigned char)p[i - 1] & 0xC0) == 0x80) i--;
+    return (i > 0 && (unsigned char)p[i - 1] >= 0xC0) ? i - 1 : len;
+}
 
-    ESP_LOGI(TAG, "Sending text to TTS: %.50s...", text);
+void tts_stream_feed(tts_stream_t *s, const char *text)
+{
+    if (!s || !text || atomic_load(&s->aborted)) return;
 
-    // Stop any ongoing MP3 playback first
-    extern esp_err_t audio_manager_stop(void);
-    audio_manager_stop();
+    for (; *text; text++) {
+        s->pending[s->pending_len++] = *text;
+        size_t cut = sentence_end(s->pending, s->pending_len);
+        if (!cut && s->pending_len >= MIMI_TTS_SENTENCE_MAX) {
+            cut = forced_cut(s->pending, s->pending_len);
+        }
+        if (cut) {
+            queue_sentence(s, s->pending, cut);
+            memmove(s->pending, s->pending + cut, s->pending_len - cut);
+            s->pending_len -= cut;
+        }
+    }
+}
 
-    // Start speaker and force 24kHz sample rate (OpenAI standard for PCM)
-    audio_speaker_start();
-    audio_set_sample_rate(24000);
+/* ── Fetch: sentence → TTS request → jitter buffer ──────────── */
 
+static esp_http_client_handle_t client_create(void)
+{
+    const char *api_key = llm_get_openai_api_key_audio();
     esp_http_client_config_t config = {
-        .url = endpoint,
+        .url = llm_get_tts_endpoint(),
         .timeout_ms = 30000,
         .method = HTTP_METHOD_POST,
-        .event_handler = _http_event_handle_tts
+        .crt_bundle_attach = esp_crt_bundle_attach,
     };
-
     esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) {
-        audio_speaker_stop();
-        return ESP_FAIL;
-    }
+    if (!client) return NULL;
 
     esp_http_client_set_header(client, "Content-Type", "application/json");
     if (api_key && strlen(api_key) > 0) {
@@ -73,7 +152,53 @@ esp_err_t tts_speak(const char *text) {
         snprintf(auth_header, sizeof(auth_header), "Bearer %s", api_key);
         esp_http_client_set_header(client, "Authorization", auth_header);
     }
+    return client;
+}
+
+/* Stream one response body into the ring; waits for room, so a slow
+ * listener holds back the download rather than dropping audio. */
+static esp_err_t read_pcm(tts_stream_t *s, esp_http_client_handle_t client, size_t *got)
+{
+    while (!atomic_load(&s->aborted)) {
+        uint8_t *dst;
+        size_t span = spsc_ring_write_span(&s->pcm, &dst);
+        if (span == 0) {
+            xSemaphoreTake(s->space, WAIT_TICKS);
+            continue;
+        }
+        if (span > MIMI_TTS_READ_CHUNK) span = MIMI_TTS_READ_CHUNK;
+
+        int n = esp_http_client_read(client, (char *)dst, span);
+        if (n < 0) return ESP_FAIL;
+        if (n == 0) break;
+        spsc_ring_produce(&s->pcm, n);
+        *got += n;
+        xSemaphoreGive(s->wake);
+    }
+    return ESP_OK;
+}
 
+static esp_err_t synthesize(tts_stream_t *s, esp_http_client_handle_t client,
+                            const char *body, size_t *got)
+{
+    int len = strlen(body);
+    esp_err_t err = esp_http_client_open(client, len);
+    if (err != ESP_OK) return err;
+    if (esp_http_client_write(client, body, len) != len) return ESP_FAIL;
+    if (esp_http_client_fetch_headers(client) < 0) return ESP_FAIL;
+
+    int status_code = esp_http_client_get_status_code(client);
+    if (status_code != 200) {
+        char err_buf[256] = {0};
+        esp_http_client_read(client, err_buf, sizeof(err_buf) - 1);
+        ESP_LOGE(TAG, "TTS HTTP Status %d: %s", status_code, err_buf);
+        return ESP_FAIL;
+    }
+    return read_pcm(s, client, got);
+}
+
+static char *request_body(const char *text)
+{
     cJSON *body = cJSON_CreateObject();
     cJSON_AddStringToObject(body, "model", "tts-1");
     cJSON_AddStringToObject(body, "input", text);
@@ -81,34 +206,205 @@ esp_err_t tts_speak(const char *text) {
     // Request raw PCM to avoid having to decode MP3
     // OpenAI supports: mp3, opus, aac, flac, wav, pcm
     cJSON_AddStringToObject(body, "response_format", "pcm");
-    
-    char *post_data = cJSON_PrintUnformatted(body);
+    char *json = cJSON_PrintUnformatted(body);
     cJSON_Delete(body);
-    
-    if (!post_data) {
+    return json;
+}
+
+static void fetch_task(void *arg)
+{
+    tts_stream_t *s = arg;
+    esp_http_client_handle_t client = NULL;
+    char *text;
+
+    while (xQueueReceive(s->sentences, &text, portMAX_DELAY) == pdTRUE && text) {
+        atomic_store(&s->fetch_idle, false);
+        char *body = atomic_load(&s->aborted) ? NULL : request_body(text);
+        if (body) {
+            ESP_LOGI(TAG, "Sending text to TTS: %.50s", text);
+            // The connection is kept alive between sentences; if the server
+            // dropped it, reconnect once before any audio arrived
+            size_t got = 0;
+            esp_err_t err = ESP_FAIL;
+            for (int attempt = 0; attempt < 2 && err != ESP_OK && got == 0; attempt++) {
+                if (!client) client = client_create();
+                if (!client) break;
+                err = synthesize(s, client, body, &got);
+                if (err != ESP_OK) {
+                    esp_http_client_cleanup(client);
+                    client = NULL;
+                }
+            }
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "TTS failed for sentence %.30s", text);
+                if (s->result == ESP_OK) s->result = err;
+            }
+            free(body);
+        }
+        free(text);
+
+        if (uxQueueMessagesWaiting(s->sentences) == 0) atomic_store(&s->fetch_idle, true);
+        xSemaphoreGive(s->wake);
+    }
+
+    if (client) {
+        esp_http_client_close(client);
         esp_http_client_cleanup(client);
+    }
+    atomic_store(&s->fetch_done, true);
+    xSemaphoreGive(s->wake);
+    stream_release(s);
+    vTaskDelete(NULL);
+}
+
+/* ── Playback: jitter buffer → speaker ──────────────────────── */
+
+static void play_task(void *arg)
+{
+    tts_stream_t *s = arg;
+    bool priming = true, started = false, dry = false;
+
+    while (!atomic_load(&s->aborted)) {
+        bool done = atomic_load(&s->fetch_done);
+        bool idle = done || atomic_load(&s->fetch_idle);
+        size_t level = spsc_ring_level(&s->pcm);
+
+        // Build up MIMI_TTS_JITTER_START before speaking, unless nothing
+        // more is on its way (a short sentence, or the end)
+        if (priming) {
+            if (level < MIMI_TTS_JITTER_START && !(idle && level >= sizeof(int16_t))) {
+                if (done) break;
+                xSemaphoreTake(s->wake, WAIT_TICKS);
+                continue;
+            }
+            priming = false;
+        }
+
+        const uint8_t *p;
+        size_t n = spsc_ring_read_span(&s->pcm, PLAY_CHUNK, &p) & ~(size_t)1;
+        if (n == 0) {
+            if (done) break;
+            // A stall inside a sentence counts; waiting on the LLM does not
+            if (!dry && !idle) s->underruns++;
+            dry = priming = true;
+            continue;
+        }
+        dry = false;
+
+        if (!started) {
+            // Start speaker and force 24kHz sample rate (OpenAI standard for PCM)
+            audio_speaker_start();
+            audio_set_sample_rate(TTS_SAMPLE_RATE);
+            ESP_LOGI(TAG, "First audio %u ms after start",
+                     (unsigned)((esp_timer_get_time() - s->begin_us) / 1000));
+            started = true;
+        }
+        audio_speaker_write(p, n);
+        spsc_ring_consume(&s->pcm, n);
+        xSemaphoreGive(s->space);
+    }
+
+    if (started) {
+        vTaskDelay(pdMS_TO_TICKS(100)); // drain remaining I2S buffer
         audio_speaker_stop();
+    }
+    xSemaphoreGive(s->done);
+    stream_release(s);
+    vTaskDelete(NULL);
+}
+
+/* ── Control ────────────────────────────────────────────────── */
+
+esp_err_t tts_stream_begin(tts_stream_t **out)
+{
+    const char *endpoint = llm_get_tts_endpoint();
+    if (!out) return ESP_ERR_INVALID_ARG;
+    if (!endpoint || strlen(endpoint) == 0) {
+        ESP_LOGE(TAG, "TTS endpoint not configured");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    tts_stream_t *s = calloc(1, sizeof(*s));
+    if (!s) return ESP_ERR_NO_MEM;
+    s->sentences = xQueueCreate(MIMI_TTS_QUEUE_LEN, sizeof(char *));
+    s->done = xSemaphoreCreateBinary();
+    s->wake = xSemaphoreCreateBinary();
+    s->space = xSemaphoreCreateBinary();
+    s->pending = heap_caps_malloc(MIMI_TTS_SENTENCE_MAX, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!s->sentences || !s->done || !s->wake || !s->space || !s->pending ||
+        spsc_ring_init(&s->pcm, MIMI_TTS_RING_SIZE, 0) != ESP_OK) {
+        if (s->sentences) vQueueDelete(s->sentences);
+        if (s->done) vSemaphoreDelete(s->done);
+        if (s->wake) vSemaphoreDelete(s->wake);
+        if (s->space) vSemaphoreDelete(s->space);
+        free(s->pending);
+        free(s);
         return ESP_ERR_NO_MEM;
     }
+    atomic_store(&s->fetch_idle, true);
+    s->begin_us = esp_timer_get_time();
 
-    esp_http_client_set_post_field(client, post_data, strlen(post_data));
+    // Stop any ongoing MP3 playback first
+    audio_manager_stop();
 
-    esp_err_t err = esp_http_client_perform(client);
-    
-    if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
-        ESP_LOGI(TAG, "TTS HTTP Status = %d", status_code);
-        if (status_code != 200) {
-            err = ESP_FAIL;
-        }
-    } else {
-        ESP_LOGE(TAG, "TTS HTTP Perform failed: %s", esp_err_to_name(err));
+    // Playback first: once fetch runs it may fill the ring
+    atomic_store(&s->refs, 3);
+    if (xTaskCreatePinnedToCore(play_task, "tts_play", MIMI_TTS_PLAY_STACK, s,
+                                MIMI_TTS_PLAY_PRIO, NULL, MIMI_TTS_PLAY_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create TTS playback task");
+        atomic_store(&s->refs, 1);
+        stream_release(s);
+        return ESP_FAIL;
     }
+    if (xTaskCreatePinnedToCore(fetch_task, "tts_fetch", MIMI_TTS_FETCH_STACK, s,
+                                MIMI_TTS_FETCH_PRIO, NULL, MIMI_TTS_FETCH_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create TTS fetch task");
+        // Playback ends once it sees the fetch side done
+        atomic_store(&s->aborted, true);
+        atomic_store(&s->fetch_done, true);
+        atomic_fetch_sub(&s->refs, 1);
+        stream_release(s);
+        return ESP_FAIL;
+    }
+    *out = s;
+    return ESP_OK;
+}
+
+esp_err_t tts_stream_finish(tts_stream_t *s)
+{
+    if (s->pending_len) queue_sentence(s, s->pending, s->pending_len);
+    s->pending_len = 0;
+    char *end = NULL;
+    xQueueSend(s->sentences, &end, portMAX_DELAY);
 
-    free(post_data);
-    esp_http_client_cleanup(client);
-    
-    vTaskDelay(pdMS_TO_TICKS(100)); // drain remaining I2S buffer
-    audio_speaker_stop();
+    xSemaphoreTake(s->done, portMAX_DELAY);
+    esp_err_t err = s->result;
+    ESP_LOGI(TAG, "Spoke %u sentences in %u ms, %u jitter buffer underruns",
+             (unsigned)s->sentences_queued,
+             (unsigned)((esp_timer_get_time() - s->begin_us) / 1000),
+             (unsigned)s->underruns);
+    stream_release(s);
     return err;
 }
+
+void tts_stream_abort(tts_stream_t *s)
+{
+    // Both tasks notice within WAIT_TICKS; fetch skips what is queued
+    atomic_store(&s->aborted, true);
+    char *end = NULL;
+    xQueueSend(s->sentences, &end, portMAX_DELAY);
+    xSemaphoreGive(s->wake);
+    xSemaphoreGive(s->space);
+    stream_release(s);
+}
+
+esp_err_t tts_speak(const char *text)
+{
+    if (!text || strlen(text) == 0) return ESP_ERR_INVALID_ARG;
+
+    tts_stream_t *s;
+    esp_err_t err = tts_stream_begin(&s);
+    if (err != ESP_OK) return err;
+    tts_stream_feed(s, text);
+    return tts_stream_finish(s);
+}
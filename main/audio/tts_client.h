@@ -6,9 +6,43 @@
 extern "C" {
 #endif
 
+/*
+ * Sentence-pipelined speech: text is fed in arbitrary fragments (LLM
+ * tokens), cut into sentences, and each sentence is a separate TTS
+ * request. A fetch task downloads sentence N+1 while a playback task is
+ * still speaking sentence N, through a PSRAM jitter buffer that absorbs
+ * network stalls. Speech starts as soon as the first sentence is
+ * complete, not when the whole reply is.
+ */
+typedef struct tts_stream tts_stream_t;
+
+/**
+ * @brief Start a speech stream; stops any music playback.
+ */
+esp_err_t tts_stream_begin(tts_stream_t **out);
+
+/**
+ * @brief Add text. Complete sentences are queued for synthesis at once;
+ * blocks only if MIMI_TTS_QUEUE_LEN sentences are already waiting.
+ */
+void tts_stream_feed(tts_stream_t *s, const char *text);
+
+/**
+ * @brief Speak any trailing partial sentence and wait until playback
+ * has finished. Frees the stream.
+ *
+ * @return ESP_OK, or the first synthesis error (other sentences still play)
+ */
+esp_err_t tts_stream_finish(tts_stream_t *s);
+
+/**
+ * @brief Stop speaking and drop queued text without waiting. Frees the stream.
+ */
+void tts_stream_abort(tts_stream_t *s);
+
 /**
  * @brief Send text to the TTS endpoint and stream audio to the speaker
- * 
+ *
  * @param text The text to convert to speech
  * @return esp_err_t ESP_OK on success
  */
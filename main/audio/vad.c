@@ -0,0 +1,146 @@
+#include "audio/vad.h"
+#include "audio/audio_dsp.h"
+#include "mimi_config.h"
+
+#include <string.h>
+
+/* Noise floor tracking, per frame (Q4 shifts). Downward is fast so the
+ * floor snaps to a quieter room; upward is slow so the onset of speech
+ * is not absorbed. The very slow rise during speech frames lets a noise
+ * step (a fan switching on) eventually stop reading as speech. */
+#define FLOOR_DOWN_SHIFT    3
+#define FLOOR_UP_SHIFT      5
+#define FLOOR_CREEP_SHIFT   11
+
+static uint32_t ms_to_samples(const vad_t *v, uint32_t ms)
+{
+    return (uint32_t)((uint64_t)ms * v->cfg.sample_rate / 1000);
+}
+
+/* Crossings of a +-band deadzone rather than of zero: noise riding on a
+ * voiced waveform would otherwise add crossings at every slow swing. */
+static uint32_t zero_crossings(const int16_t *pcm, size_t n, int32_t band)
+{
+    uint32_t zc = 0;
+    int side = 0;
+    for (size_t i = 0; i < n; i++) {
+        int s = pcm[i] > band ? 1 : pcm[i] < -band ? -1 : 0;
+        if (s != 0 && s != side) {
+            zc += side != 0;
+            side = s;
+        }
+    }
+    return zc;
+}
+
+static void track_floor(vad_t *v, uint32_t rms, bool speech)
+{
+    uint32_t x = rms << 4;
+    if (x < v->floor_q4) {
+        if (!speech) v->floor_q4 -= (v->floor_q4 - x) >> FLOOR_DOWN_SHIFT;
+    } else {
+        v->floor_q4 += (x - v->floor_q4) >> (speech ? FLOOR_CREEP_SHIFT : FLOOR_UP_SHIFT);
+    }
+}
+
+static bool classify(vad_t *v, const int16_t *pcm, size_t n)
+{
+    uint32_t rms = audio_dsp_rms(pcm, n);
+    uint32_t zc = zero_crossings(pcm, n, (int32_t)(v->floor_q4 >> 4));
+    uint32_t zcr_hz = (uint32_t)((uint64_t)zc * v->cfg.sample_rate / n);
+
+    uint32_t thresh = (uint32_t)(((uint64_t)v->floor_q4 * v->cfg.snr_pct / 100) >> 4);
+    if (thresh < v->cfg.min_rms) thresh = v->cfg.min_rms;
+
+    // Loud enough, and either voiced (low ZCR) or well clear of the floor
+    // so unvoiced consonants still count
+    bool speech = rms > thresh && (zcr_hz <= v->cfg.zcr_max_hz || rms > 2 * thresh);
+
+    // The floor only learns from gaps outside an utterance's hangover
+    track_floor(v, rms, speech || vad_in_speech(v));
+
+    v->last_rms = rms;
+    v->last_zcr_hz = zcr_hz;
+    v->frame_speech = speech;
+    return speech;
+}
+
+void vad_config_default(vad_config_t *cfg, uint32_t sample_rate)
+{
+    cfg->sample_rate = sample_rate;
+    cfg->frame_ms = MIMI_VAD_FRAME_MS;
+    cfg->start_ms = MIMI_VAD_START_MS;
+    cfg->hangover_ms = MIMI_VAD_HANGOVER_MS;
+    cfg->endpoint_ms = MIMI_VOICE_ENDPOINT_MS;
+    cfg->snr_pct = MIMI_VAD_SNR_PCT;
+    cfg->min_rms = MIMI_VAD_MIN_RMS;
+    cfg->zcr_max_hz = MIMI_VAD_ZCR_MAX_HZ;
+}
+
+void vad_init(vad_t *v, const vad_config_t *cfg, uint32_t noise_floor)
+{
+    memset(v, 0, sizeof(*v));
+    v->cfg = *cfg;
+    v->frame_samples = ms_to_samples(v, cfg->frame_ms);
+    if (v->frame_samples == 0) v->frame_samples = 1;
+    v->floor_q4 = (noise_floor ? noise_floor : cfg->min_rms) << 4;
+}
+
+void vad_reset(vad_t *v)
+{
+    v->speech_run = 0;
+    v->silence_run = 0;
+    v->active = false;
+    v->frame_speech = false;
+}
+
+vad_event_t vad_process(vad_t *v, const int16_t *pcm, size_t n)
+{
+    vad_event_t ev = VAD_EVENT_NONE;
+    uint32_t start = ms_to_samples(v, v->cfg.start_ms);
+    uint32_t endpoint = ms_to_samples(v, v->cfg.endpoint_ms);
+
+    while (n > 0) {
+        size_t len = n < v->frame_samples ? n : v->frame_samples;
+        bool prev = v->frame_speech;
+        bool speech = classify(v, pcm, len);
+        pcm += len;
+        n -= len;
+
+        if (!v->active) {
+            // Gaps between syllables wear the run down rather than clear it
+            if (speech) v->speech_run += len;
+            else v->speech_run = v->speech_run > len ? v->speech_run - len : 0;
+            if (v->speech_run >= start) {
+                v->active = true;
+                v->silence_run = 0;
+                ev = VAD_EVENT_START;
+            }
+        } else {
+            // A lone loud frame (a knock, a noise spike) does not restart
+            // the endpoint clock; two in a row do
+            v->silence_run = (speech && prev) ? 0 : v->silence_run + len;
+            if (v->silence_run >= endpoint) {
+                v->active = false;
+                v->speech_run = 0;
+                ev = VAD_EVENT_END;
+            }
+        }
+    }
+    return ev;
+}
+
+bool vad_in_speech(const vad_t *v)
+{
+    return v->active && v->silence_run < ms_to_samples(v, v->cfg.hangover_ms);
+}
+
+bool vad_active(const vad_t *v)
+{
+    return v->active;
+}
+
+uint32_t vad_noise_floor(const vad_t *v)
+{
+    return v->floor_q4 >> 4;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* ── Voice activity detection ─────────────────────────────────────
+ *
+ * Frame-based detector for 16-bit mono PCM. Each frame is classified
+ * from its RMS against an adaptive noise floor and its zero-crossing
+ * rate (broadband hiss crosses zero far more often than voiced speech).
+ * A small state machine turns frame decisions into utterance events:
+ *
+ *   start_ms     speech needed before VAD_EVENT_START
+ *   hangover_ms  gap still reported as speech (vad_in_speech)
+ *   endpoint_ms  trailing non-speech that raises VAD_EVENT_END
+ *
+ * The noise floor follows quiet frames quickly downwards and slowly
+ * upwards, and is all but frozen while speech (plus hangover) is active.
+ * Not thread-safe; one detector per task.
+ */
+
+typedef struct {
+    uint32_t sample_rate;
+    uint16_t frame_ms;          /* classification frame */
+    uint16_t start_ms;
+    uint16_t hangover_ms;
+    uint16_t endpoint_ms;
+    uint16_t snr_pct;           /* speech above floor * snr_pct / 100 */
+    uint16_t min_rms;           /* never speech below this; floor seed */
+    uint16_t zcr_max_hz;        /* zero crossings/s above this are noise */
+} vad_config_t;
+
+typedef enum {
+    VAD_EVENT_NONE = 0,
+    VAD_EVENT_START,            /* utterance began */
+    VAD_EVENT_END,              /* utterance ended (endpoint) */
+} vad_event_t;
+
+typedef struct {
+    vad_config_t cfg;
+    uint32_t frame_samples;
+    uint32_t floor_q4;          /* noise floor RMS, Q4 */
+    uint32_t speech_run;        /* consecutive speech samples before start */
+    uint32_t silence_run;       /* non-speech samples since last speech */
+    bool active;                /* between START and END */
+    bool frame_speech;          /* last frame's raw decision */
+    uint32_t last_rms;
+    uint32_t last_zcr_hz;
+} vad_t;
+
+/** Defaults from mimi_config.h (MIMI_VAD_*) for the given rate. */
+void vad_config_default(vad_config_t *cfg, uint32_t sample_rate);
+
+/**
+ * @param noise_floor Initial floor RMS, e.g. from vad_noise_floor() of a
+ *                    detector that has been listening; 0 seeds min_rms.
+ */
+void vad_init(vad_t *v, const vad_config_t *cfg, uint32_t noise_floor);
+
+/** Drop utterance state; the noise floor is kept. */
+void vad_reset(vad_t *v);
+
+/**
+ * Feed any number of samples; they are classified in frame_ms frames
+ * (a short tail is classified as a frame of its own).
+ * @return START or END if one occurred in this block, else NONE
+ */
+vad_event_t vad_process(vad_t *v, const int16_t *pcm, size_t n);
+
+/** Inside an utterance and not past the hangover. */
+bool vad_in_speech(const vad_t *v);
+
+/** Between START and END. */
+bool vad_active(const vad_t *v);
+
+uint32_t vad_noise_floor(const vad_t *v);
@@ -1,5 +1,9 @@
 #include "audio/voice_manager.h"
 #include "audio.h"
+#include "audio/audio_dsp.h"
+#include "audio/asr_client.h"
+#include "audio/tts_client.h"
+#include "audio/vad.h"
 #include "llm/llm_proxy.h"
 #include "esp_log.h"
 #include "esp_timer.h"
@@ -8,22 +12,13 @@
 #include "esp_heap_caps.h"
 #include "cJSON.h"
 
-// Forward declarations for ASR/TTS clients to be implemented
-esp_err_t asr_recognize(const uint8_t *audio_data, size_t len, char **out_text);
-esp_err_t tts_speak(const char *text);
-
-#include <math.h>
-
-// Configurable VAD params
-#define VAD_ENERGY_THRESHOLD 3000  // Normal talking is ~1000-5000 RMS
-#define VAD_DURATION_MS 300 // Duration of loud noise to trigger wake
-
 static const char *TAG = "voice_mgr";
 
 static voice_state_t s_current_state = VOICE_STATE_IDLE;
 static TaskHandle_t s_voice_task = NULL;
 static TaskHandle_t s_vad_task = NULL;
 static bool s_vad_enabled = false;
+static uint32_t s_noise_floor = 0;   // carried between the wake VAD and recording
 
 // Helper to set state
 static void set_state(voice_state_t new_state) {
@@ -31,118 +26,129 @@ static void set_state(voice_state_t new_state) {
     ESP_LOGI(TAG, "Voice State -> %d", new_state);
 }
 
-// Helper to interact with the LLM via llm_proxy
-static esp_err_t proxy_llm_request(const char *user_text, char **out_response) {
-    if (!user_text || !out_response) return ESP_ERR_INVALID_ARG;
-    
-    // Size check for LLM response buffer
-    size_t llm_resp_size = 4096;
-    char *resp_buf = heap_caps_calloc(1, llm_resp_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!resp_buf) {
-        ESP_LOGE(TAG, "Failed to allocate LLM response buffer");
-        return ESP_ERR_NO_MEM;
+static void on_llm_token(const char *token, void *ctx) {
+    if (s_current_state == VOICE_STATE_PROCESSING) {
+        set_state(VOICE_STATE_SPEAKING);
     }
+    tts_stream_feed((tts_stream_t *)ctx, token);
+}
+
+// Stream the LLM reply into TTS: speech starts with the first complete
+// sentence while the rest of the reply is still being generated
+static esp_err_t speak_llm_reply(const char *user_text) {
+    if (!user_text) return ESP_ERR_INVALID_ARG;
 
-    // Convert text into JSON format expected by llm_chat
     cJSON *messages = cJSON_CreateArray();
     cJSON *msg = cJSON_CreateObject();
     cJSON_AddStringToObject(msg, "role", "user");
     cJSON_AddStringToObject(msg, "content", user_text);
     cJSON_AddItemToArray(messages, msg);
-    
-    char *messages_json = cJSON_PrintUnformatted(messages);
-    cJSON_Delete(messages);
 
-    if (!messages_json) {
-        free(resp_buf);
-        return ESP_ERR_NO_MEM;
+    tts_stream_t *tts = NULL;
+    esp_err_t err = tts_stream_begin(&tts);
+    if (err != ESP_OK) {
+        cJSON_Delete(messages);
+        return err;
     }
 
     ESP_LOGI(TAG, "Sending text to LLM: %s", user_text);
-    esp_err_t err = llm_chat("You are a helpful voice assistant.", messages_json, resp_buf, llm_resp_size);
-    free(messages_json);
+    llm_response_t resp;
+    err = llm_chat_stream("You are a helpful voice assistant.", messages, NULL,
+                          on_llm_token, tts, &resp);
+    cJSON_Delete(messages);
 
-    if (err == ESP_OK) {
-        *out_response = strdup(resp_buf);
-    } else {
+    if (err != ESP_OK) {
         ESP_LOGE(TAG, "LLM Chat failed: %s", esp_err_to_name(err));
+        tts_stream_abort(tts);
+        return err;
     }
+    ESP_LOGI(TAG, "LLM Response: %s", resp.text ? resp.text : "");
+    llm_response_free(&resp);
+    return tts_stream_finish(tts);
+}
+
+// Record one utterance into an ASR upload; ends on trailing silence.
+// Returns false if nothing worth recognizing was said (or cancelled).
+static bool record_utterance(asr_stream_t *asr) {
+    int16_t frame[512] __attribute__((aligned(AUDIO_DSP_ALIGN)));
+    const uint32_t bytes_per_ms = AUDIO_SAMPLE_RATE * sizeof(int16_t) / 1000;
+    uint32_t elapsed_ms = 0;
+    bool heard = false;
+
+    vad_config_t cfg;
+    vad_config_default(&cfg, AUDIO_SAMPLE_RATE);
+    vad_t vad;
+    vad_init(&vad, &cfg, s_noise_floor);
+
+    audio_mic_start();
+    while (s_current_state == VOICE_STATE_LISTENING) {
+        int chunk_read = audio_mic_read((uint8_t *)frame, sizeof(frame));
+        if (chunk_read <= 0) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            elapsed_ms += 10;
+        } else {
+            size_t samples = (size_t)chunk_read / sizeof(int16_t);
+            if (asr_stream_write(asr, frame, samples) != ESP_OK) {
+                ESP_LOGE(TAG, "ASR upload failed while recording");
+                break;
+            }
+            elapsed_ms += (uint32_t)chunk_read / bytes_per_ms;
+            vad_event_t ev = vad_process(&vad, frame, samples);
+            if (ev == VAD_EVENT_START) {
+                heard = true;
+            } else if (ev == VAD_EVENT_END) {
+                ESP_LOGI(TAG, "End of speech after %u ms", (unsigned)elapsed_ms);
+                break;
+            }
+        }
 
-    free(resp_buf);
-    return err;
+        if (!heard && elapsed_ms >= MIMI_VOICE_NO_SPEECH_MS) {
+            ESP_LOGI(TAG, "No speech heard");
+            break;
+        }
+        if (elapsed_ms >= MIMI_VOICE_MAX_RECORD_MS) {
+            ESP_LOGW(TAG, "Utterance hit the %d ms cap", MIMI_VOICE_MAX_RECORD_MS);
+            break;
+        }
+    }
+    audio_mic_stop();
+    s_noise_floor = vad_noise_floor(&vad);
+    return heard && s_current_state == VOICE_STATE_LISTENING;
 }
 
 static void voice_task(void *arg) {
     while (1) {
         if (s_current_state == VOICE_STATE_LISTENING) {
-            ESP_LOGI(TAG, "Start Listening... (10 seconds timeout)");
-
-            // We will capture 3 seconds of audio to PSRAM
-            // Note: 16000 Hz, 16-bit, mono = 32000 bytes/sec
-            // 3 seconds = ~96KB
-            size_t duration_sec = 3;
-            size_t bytes_per_sec = 16000 * 2 * 1; 
-            size_t max_capture_size = duration_sec * bytes_per_sec;
-            
-            uint8_t *audio_buf = heap_caps_malloc(max_capture_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-            if (!audio_buf) {
-                ESP_LOGE(TAG, "Failed to allocate PSRAM for ASR recording");
+            ESP_LOGI(TAG, "Start Listening... (ends on silence)");
+
+            // The upload starts now and runs while the user speaks
+            asr_stream_t *asr = NULL;
+            esp_err_t err = asr_stream_begin(AUDIO_SAMPLE_RATE, &asr);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to start ASR stream: %s", esp_err_to_name(err));
                 set_state(VOICE_STATE_IDLE);
                 continue;
             }
 
-            // Record from I2S mic
-            size_t total_read = 0;
-
-            // Optional: Start a beep here to indicate listening
-
-            uint64_t start_time = esp_timer_get_time() / 1000ULL;
-            audio_mic_start();
-            while (s_current_state == VOICE_STATE_LISTENING && total_read < max_capture_size) {
-                int chunk_read = audio_mic_read(audio_buf + total_read, 1024);
-                if (chunk_read > 0) {
-                    total_read += (size_t)chunk_read;
-                } else {
-                    vTaskDelay(pdMS_TO_TICKS(10));
+            if (!record_utterance(asr)) {
+                asr_stream_abort(asr);
+                if (s_current_state == VOICE_STATE_LISTENING) {
+                    set_state(VOICE_STATE_IDLE);
                 }
-
-                if (esp_timer_get_time() / 1000ULL - start_time > duration_sec * 1000 + 1000) {
-                     break; // Safety timeout
-                }
-            }
-            audio_mic_stop();
-            
-            ESP_LOGI(TAG, "Captured %d bytes of audio", total_read);
-
-            if (s_current_state != VOICE_STATE_LISTENING) {
-                 // Cancelled
-                 free(audio_buf);
-                 continue;
+                continue;
             }
 
             set_state(VOICE_STATE_PROCESSING);
 
-            // 1. ASR
+            // 1. ASR: only the tail of the upload remains
             char *recognized_text = NULL;
-            ESP_LOGI(TAG, "Sending to ASR...");
-            esp_err_t err = asr_recognize(audio_buf, total_read, &recognized_text);
-            free(audio_buf);
+            err = asr_stream_finish(asr, &recognized_text);
 
             if (err == ESP_OK && recognized_text && strlen(recognized_text) > 0) {
                  ESP_LOGI(TAG, "ASR Result: %s", recognized_text);
                  
-                 // 2. LLM
-                 char *llm_resp = NULL;
-                 err = proxy_llm_request(recognized_text, &llm_resp);
-
-                 if (err == ESP_OK && llm_resp) {
-                     ESP_LOGI(TAG, "LLM Response: %s", llm_resp);
-                     
-                     // 3. TTS
-                     set_state(VOICE_STATE_SPEAKING);
-                     tts_speak(llm_resp);
-                     free(llm_resp);
-                 }
+                 // 2+3. LLM and TTS, overlapped sentence by sentence
+                 speak_llm_reply(recognized_text);
             } else {
                 ESP_LOGE(TAG, "ASR recognition failed or empty");
             }
@@ -157,14 +163,18 @@ static void voice_task(void *arg) {
 static void vad_task(void *arg) {
     ESP_LOGI(TAG, "VAD background task started");
     const int chunk_size = 1024;
-    int16_t *buf = heap_caps_malloc(chunk_size, MALLOC_CAP_SPIRAM);
+    int16_t *buf = heap_caps_aligned_alloc(AUDIO_DSP_ALIGN, chunk_size, MALLOC_CAP_SPIRAM);
     if (!buf) {
         ESP_LOGE(TAG, "Failed to allocate VAD buffer");
         vTaskDelete(NULL);
     }
 
-    uint32_t active_ticks = 0;
-    const uint32_t required_ticks = VAD_DURATION_MS / 10; // Assuming ~10ms per loop
+    // Waking needs a longer run of speech than continuing an utterance
+    vad_config_t cfg;
+    vad_config_default(&cfg, AUDIO_SAMPLE_RATE);
+    cfg.start_ms = MIMI_VAD_WAKE_MS;
+    vad_t vad;
+    vad_init(&vad, &cfg, s_noise_floor);
     bool last_vad_enabled = false;
 
     while (1) {
@@ -174,7 +184,7 @@ static void vad_task(void *arg) {
             }
             last_vad_enabled = s_vad_enabled;
             vTaskDelay(pdMS_TO_TICKS(100));
-            active_ticks = 0;
+            vad_init(&vad, &cfg, s_noise_floor);  // pick up the floor seen while recording
             continue;
         }
         last_vad_enabled = s_vad_enabled;
@@ -183,22 +193,13 @@ static void vad_task(void *arg) {
         // Try to read a small chunk from mic
         int read_bytes = audio_mic_read((uint8_t*)buf, chunk_size);
         if (read_bytes > 0) {
-            int samples = read_bytes / 2;
-            int64_t sum_squares = 0;
-            for (int i=0; i < samples; i++) {
-                sum_squares += buf[i] * buf[i];
-            }
-            int32_t rms = (int32_t)sqrt(sum_squares / samples);
-
-            if (rms > VAD_ENERGY_THRESHOLD) {
-                active_ticks++;
-                if (active_ticks >= required_ticks) {
-                    ESP_LOGI(TAG, "VAD Triggered! (RMS: %ld > %d)", (long)rms, VAD_ENERGY_THRESHOLD);
-                    active_ticks = 0;
-                    voice_manager_start_listening();
-                }
-            } else {
-                active_ticks = 0; // reset if quiet
+            vad_event_t ev = vad_process(&vad, buf, read_bytes / 2);
+            s_noise_floor = vad_noise_floor(&vad);
+            if (ev == VAD_EVENT_START) {
+                ESP_LOGI(TAG, "VAD Triggered! (RMS: %u, noise floor: %u)",
+                         (unsigned)vad.last_rms, (unsigned)s_noise_floor);
+                vad_reset(&vad);
+                voice_manager_start_listening();
             }
         }
         vTaskDelay(pdMS_TO_TICKS(10));
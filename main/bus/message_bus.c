@@ -1,141 +1,326 @@
 #include "message_bus.h"
 #include "mimi_config.h"
 #include "esp_log.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include <string.h>
 
 static const char *TAG = "bus";
 
-static QueueHandle_t s_inbound_queue;
+/* ── Inbound priority inbox ───────────────────────────────────────
+ *
+ * Fixed slot pool with one FIFO list per priority class, all under a
+ * mutex. Two counting semaphores track used and free slots so push and
+ * pop can block like a queue; items is given under the mutex, so a
+ * holder of the mutex that takes it never waits. A filtered pop that
+ * passes everything over waits on a changed signal instead. Per-channel and per-(channel, chat_id)
+ * counters answer the membership queries without touching the slots
+ * in the common case.
+ *
+ * Classes are served in priority order, except that a class whose oldest
+ * message has waited MIMI_BUS_INBOUND_AGE_MS goes first: a steady stream
+ * of chat turns delays cron and heartbeat events but cannot starve them.
+ */
+
+typedef enum {
+    BUS_CLASS_INTERACTIVE = 0,  /* websocket: a user is watching the stream */
+    BUS_CLASS_NORMAL,           /* telegram, cli and unknown channels */
+    BUS_CLASS_BACKGROUND,       /* system: cron, heartbeat, skill events */
+    BUS_CLASS_COUNT,
+} bus_class_t;
+
+typedef enum {
+    BUS_CHAN_TELEGRAM = 0,
+    BUS_CHAN_WEBSOCKET,
+    BUS_CHAN_CLI,
+    BUS_CHAN_SYSTEM,
+    BUS_CHAN_OTHER,
+    BUS_CHAN_COUNT,
+} bus_chan_t;
+
+#define BUS_KEY_BUCKETS 64      /* (channel, chat_id) hash buckets */
+
+typedef struct {
+    mimi_msg_t msg;
+    uint32_t key_hash;
+    TickType_t queued;          /* tick of the push, for aging */
+    uint8_t chan;
+    int16_t next;               /* next slot in the same list, -1 = end */
+} bus_slot_t;
+
+static bus_slot_t s_slots[MIMI_BUS_INBOUND_DEPTH];
+static int16_t s_head[BUS_CLASS_COUNT];
+static int16_t s_tail[BUS_CLASS_COUNT];
+static int16_t s_free_head;
+static int s_inbound_count = 0;
+static uint16_t s_chan_count[BUS_CHAN_COUNT];
+static uint16_t s_key_count[BUS_KEY_BUCKETS];   /* up to MIMI_BUS_INBOUND_DEPTH each */
+
+static SemaphoreHandle_t s_inbound_lock;
+static SemaphoreHandle_t s_inbound_items;
+static SemaphoreHandle_t s_inbound_space;
+static SemaphoreHandle_t s_inbound_changed;
+
 static QueueHandle_t s_outbound_queue;
 
+static bus_chan_t bus_chan_of(const char *channel)
+{
+    if (strcmp(channel, MIMI_CHAN_WEBSOCKET) == 0) return BUS_CHAN_WEBSOCKET;
+    if (strcmp(channel, MIMI_CHAN_TELEGRAM) == 0) return BUS_CHAN_TELEGRAM;
+    if (strcmp(channel, MIMI_CHAN_SYSTEM) == 0) return BUS_CHAN_SYSTEM;
+    if (strcmp(channel, MIMI_CHAN_CLI) == 0) return BUS_CHAN_CLI;
+    return BUS_CHAN_OTHER;
+}
+
+static bus_class_t bus_class_of(bus_chan_t chan)
+{
+    switch (chan) {
+    case BUS_CHAN_WEBSOCKET: return BUS_CLASS_INTERACTIVE;
+    case BUS_CHAN_SYSTEM:    return BUS_CLASS_BACKGROUND;
+    default:                 return BUS_CLASS_NORMAL;
+    }
+}
+
+static uint32_t bus_key_hash(const char *channel, const char *chat_id)
+{
+    uint32_t h = 2166136261u;   /* FNV-1a over "channel\0chat_id" */
+    for (const char *p = channel; *p; p++) h = (h ^ (uint8_t)*p) * 16777619u;
+    h *= 16777619u;
+    for (const char *p = chat_id; *p; p++) h = (h ^ (uint8_t)*p) * 16777619u;
+    return h;
+}
+
 esp_err_t message_bus_init(void)
 {
-    s_inbound_queue = xQueueCreate(MIMI_BUS_QUEUE_LEN, sizeof(mimi_msg_t));
+    s_inbound_lock = xSemaphoreCreateMutex();
+    s_inbound_items = xSemaphoreCreateCounting(MIMI_BUS_INBOUND_DEPTH, 0);
+    s_inbound_space = xSemaphoreCreateCounting(MIMI_BUS_INBOUND_DEPTH, MIMI_BUS_INBOUND_DEPTH);
+    s_inbound_changed = xSemaphoreCreateBinary();
     s_outbound_queue = xQueueCreate(MIMI_BUS_QUEUE_LEN, sizeof(mimi_msg_t));
 
-    if (!s_inbound_queue || !s_outbound_queue) {
+    if (!s_inbound_lock || !s_inbound_items || !s_inbound_space ||
+        !s_inbound_changed || !s_outbound_queue) {
         ESP_LOGE(TAG, "Failed to create message queues");
         return ESP_ERR_NO_MEM;
     }
 
-    ESP_LOGI(TAG, "Message bus initialized (queue depth %d)", MIMI_BUS_QUEUE_LEN);
+    for (int c = 0; c < BUS_CLASS_COUNT; c++) {
+        s_head[c] = s_tail[c] = -1;
+    }
+    for (int i = 0; i < MIMI_BUS_INBOUND_DEPTH; i++) {
+        s_slots[i].next = (i + 1 < MIMI_BUS_INBOUND_DEPTH) ? (int16_t)(i + 1) : -1;
+    }
+    s_free_head = 0;
+
+    ESP_LOGI(TAG, "Message bus initialized (inbound depth %d, outbound depth %d)",
+             MIMI_BUS_INBOUND_DEPTH, MIMI_BUS_QUEUE_LEN);
     return ESP_OK;
 }
 
 esp_err_t message_bus_push_inbound(const mimi_msg_t *msg)
 {
-    if (xQueueSend(s_inbound_queue, msg, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    if (xSemaphoreTake(s_inbound_space, pdMS_TO_TICKS(1000)) != pdTRUE) {
         ESP_LOGW(TAG, "Inbound queue full, dropping message");
         return ESP_ERR_NO_MEM;
     }
+
+    bus_chan_t chan = bus_chan_of(msg->channel);
+    bus_class_t cls = bus_class_of(chan);
+    uint32_t key_hash = bus_key_hash(msg->channel, msg->chat_id);
+
+    xSemaphoreTake(s_inbound_lock, portMAX_DELAY);
+    int16_t idx = s_free_head;
+    bus_slot_t *slot = &s_slots[idx];
+    s_free_head = slot->next;
+
+    slot->msg = *msg;
+    slot->key_hash = key_hash;
+    slot->queued = xTaskGetTickCount();
+    slot->chan = (uint8_t)chan;
+    slot->next = -1;
+    if (s_tail[cls] >= 0) {
+        s_slots[s_tail[cls]].next = idx;
+    } else {
+        s_head[cls] = idx;
+    }
+    s_tail[cls] = idx;
+
+    s_inbound_count++;
+    s_chan_count[chan]++;
+    s_key_count[key_hash % BUS_KEY_BUCKETS]++;
+    xSemaphoreGive(s_inbound_items);
+    xSemaphoreGive(s_inbound_lock);
+
+    xSemaphoreGive(s_inbound_changed);
     return ESP_OK;
 }
 
-esp_err_t message_bus_pop_inbound(mimi_msg_t *msg, uint32_t timeout_ms)
+/* Unlink slot idx (prev = the slot before it in class cls, or -1) */
+static void take_locked(int cls, int16_t prev, int16_t idx, mimi_msg_t *msg)
 {
-    TickType_t ticks = (timeout_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
-    if (xQueueReceive(s_inbound_queue, msg, ticks) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
+    bus_slot_t *slot = &s_slots[idx];
+    if (prev >= 0) {
+        s_slots[prev].next = slot->next;
+    } else {
+        s_head[cls] = slot->next;
     }
-    return ESP_OK;
+    if (s_tail[cls] == idx) s_tail[cls] = prev;
+
+    *msg = slot->msg;
+    s_inbound_count--;
+    s_chan_count[slot->chan]--;
+    s_key_count[slot->key_hash % BUS_KEY_BUCKETS]--;
+
+    slot->next = s_free_head;
+    s_free_head = idx;
 }
 
-esp_err_t message_bus_pop_inbound_prefer_websocket(mimi_msg_t *msg, uint32_t timeout_ms)
+/* The classes in the order to serve them: overdue ones first, oldest
+ * head first, then the rest by priority. Empty classes are left out;
+ * returns how many were filled in. */
+static int class_order_locked(int order[BUS_CLASS_COUNT])
+{
+    TickType_t now = xTaskGetTickCount();
+    int overdue = 0, count = 0;
+    for (int cls = 0; cls < BUS_CLASS_COUNT; cls++) {
+        if (s_head[cls] < 0) continue;
+        TickType_t queued = s_slots[s_head[cls]].queued;
+        if (now - queued < pdMS_TO_TICKS(MIMI_BUS_INBOUND_AGE_MS)) {
+            order[count++] = cls;
+            continue;
+        }
+        /* Insert among the overdue ones by age, shifting the rest down */
+        int at = 0;
+        while (at < overdue && s_slots[s_head[order[at]]].queued <= queued) at++;
+        memmove(&order[at + 1], &order[at], (count - at) * sizeof(order[0]));
+        order[at] = cls;
+        overdue++;
+        count++;
+    }
+    return count;
+}
+
+/* Priority order with aging (above), FIFO within a class */
+esp_err_t message_bus_pop_inbound(mimi_msg_t *msg, uint32_t timeout_ms)
 {
     TickType_t ticks = (timeout_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
-    if (xQueueReceive(s_inbound_queue, msg, ticks) != pdTRUE) {
+    if (xSemaphoreTake(s_inbound_items, ticks) != pdTRUE) {
         return ESP_ERR_TIMEOUT;
     }
 
-    if (strcmp(msg->channel, MIMI_CHAN_WEBSOCKET) == 0) {
-        return ESP_OK;
-    }
+    xSemaphoreTake(s_inbound_lock, portMAX_DELAY);
+    int order[BUS_CLASS_COUNT];
+    class_order_locked(order);
+    take_locked(order[0], -1, s_head[order[0]], msg);
+    xSemaphoreGive(s_inbound_lock);
 
-    int waiting = (int)uxQueueMessagesWaiting(s_inbound_queue);
-    if (waiting <= 0) return ESP_OK;
+    xSemaphoreGive(s_inbound_space);
+    return ESP_OK;
+}
 
-    mimi_msg_t tmp[MIMI_BUS_QUEUE_LEN];
-    int count = 0;
-    while (count < MIMI_BUS_QUEUE_LEN && xQueueReceive(s_inbound_queue, &tmp[count], 0) == pdTRUE) {
-        count++;
-    }
+esp_err_t message_bus_pop_inbound_match(mimi_msg_t *msg, message_bus_match_t match,
+                                        void *arg, uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t ticks = (timeout_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
 
-    int ws_idx = -1;
-    for (int i = 0; i < count; i++) {
-        if (strcmp(tmp[i].channel, MIMI_CHAN_WEBSOCKET) == 0) {
-            ws_idx = i;
-            break;
+    for (;;) {
+        bool taken = false;
+        xSemaphoreTake(s_inbound_lock, portMAX_DELAY);
+        /* Reserve an item first so an accepted message is always ours */
+        if (xSemaphoreTake(s_inbound_items, 0) == pdTRUE) {
+            int order[BUS_CLASS_COUNT];
+            int classes = class_order_locked(order);
+            for (int k = 0; k < classes && !taken; k++) {
+                int cls = order[k];
+                int16_t prev = -1;
+                for (int16_t i = s_head[cls]; i >= 0; prev = i, i = s_slots[i].next) {
+                    if (match(&s_slots[i].msg, arg)) {
+                        take_locked(cls, prev, i, msg);
+                        taken = true;
+                        break;
+                    }
+                }
+            }
+            if (!taken) xSemaphoreGive(s_inbound_items);
         }
-    }
+        xSemaphoreGive(s_inbound_lock);
 
-    if (ws_idx < 0) {
-        for (int i = 0; i < count; i++) {
-            xQueueSendToBack(s_inbound_queue, &tmp[i], 0);
+        if (taken) {
+            xSemaphoreGive(s_inbound_space);
+            return ESP_OK;
         }
-        return ESP_OK;
-    }
-
-    mimi_msg_t original = *msg;
-    *msg = tmp[ws_idx];
 
-    for (int i = 0; i < count; i++) {
-        if (i == ws_idx) continue;
-        xQueueSendToBack(s_inbound_queue, &tmp[i], 0);
+        TickType_t wait = portMAX_DELAY;
+        if (ticks != portMAX_DELAY) {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if (elapsed >= ticks) return ESP_ERR_TIMEOUT;
+            wait = ticks - elapsed;
+        }
+        if (xSemaphoreTake(s_inbound_changed, wait) != pdTRUE) {
+            return ESP_ERR_TIMEOUT;
+        }
     }
-    xQueueSendToBack(s_inbound_queue, &original, 0);
+}
 
-    return ESP_OK;
+void message_bus_inbound_wake(void)
+{
+    if (s_inbound_changed) xSemaphoreGive(s_inbound_changed);
+}
+
+esp_err_t message_bus_pop_inbound_prefer_websocket(mimi_msg_t *msg, uint32_t timeout_ms)
+{
+    /* WebSocket is the interactive class, so plain priority order covers it */
+    return message_bus_pop_inbound(msg, timeout_ms);
 }
 
 int message_bus_inbound_depth(void)
 {
-    if (!s_inbound_queue) return 0;
-    return (int)uxQueueMessagesWaiting(s_inbound_queue);
+    if (!s_inbound_lock) return 0;
+    xSemaphoreTake(s_inbound_lock, portMAX_DELAY);
+    int depth = s_inbound_count;
+    xSemaphoreGive(s_inbound_lock);
+    return depth;
 }
 
 bool message_bus_inbound_contains(const char *channel, const char *chat_id)
 {
-    if (!s_inbound_queue || !channel || !chat_id) return false;
-
-    int waiting = (int)uxQueueMessagesWaiting(s_inbound_queue);
-    if (waiting <= 0) return false;
-
-    mimi_msg_t tmp[MIMI_BUS_QUEUE_LEN];
-    int count = 0;
-    while (count < MIMI_BUS_QUEUE_LEN && xQueueReceive(s_inbound_queue, &tmp[count], 0) == pdTRUE) {
-        count++;
-    }
+    if (!s_inbound_lock || !channel || !chat_id) return false;
 
+    uint32_t key_hash = bus_key_hash(channel, chat_id);
     bool found = false;
-    for (int i = 0; i < count; i++) {
-        if (strcmp(tmp[i].channel, channel) == 0 && strcmp(tmp[i].chat_id, chat_id) == 0) {
-            found = true;
+
+    xSemaphoreTake(s_inbound_lock, portMAX_DELAY);
+    if (s_key_count[key_hash % BUS_KEY_BUCKETS] > 0) {
+        /* Bucket hit: confirm against the queued messages of that class */
+        int cls = bus_class_of(bus_chan_of(channel));
+        for (int16_t i = s_head[cls]; i >= 0 && !found; i = s_slots[i].next) {
+            found = s_slots[i].key_hash == key_hash &&
+                    strcmp(s_slots[i].msg.channel, channel) == 0 &&
+                    strcmp(s_slots[i].msg.chat_id, chat_id) == 0;
         }
-        xQueueSendToBack(s_inbound_queue, &tmp[i], 0);
     }
+    xSemaphoreGive(s_inbound_lock);
     return found;
 }
 
 bool message_bus_inbound_has_channel(const char *channel)
 {
-    if (!s_inbound_queue || !channel) return false;
-
-    int waiting = (int)uxQueueMessagesWaiting(s_inbound_queue);
-    if (waiting <= 0) return false;
-
-    mimi_msg_t tmp[MIMI_BUS_QUEUE_LEN];
-    int count = 0;
-    while (count < MIMI_BUS_QUEUE_LEN && xQueueReceive(s_inbound_queue, &tmp[count], 0) == pdTRUE) {
-        count++;
-    }
+    if (!s_inbound_lock || !channel) return false;
 
+    bus_chan_t chan = bus_chan_of(channel);
     bool found = false;
-    for (int i = 0; i < count; i++) {
-        if (strcmp(tmp[i].channel, channel) == 0) {
-            found = true;
+
+    xSemaphoreTake(s_inbound_lock, portMAX_DELAY);
+    if (chan != BUS_CHAN_OTHER) {
+        found = s_chan_count[chan] > 0;
+    } else if (s_chan_count[BUS_CHAN_OTHER] > 0) {
+        int cls = bus_class_of(chan);
+        for (int16_t i = s_head[cls]; i >= 0 && !found; i = s_slots[i].next) {
+            found = strcmp(s_slots[i].msg.channel, channel) == 0;
         }
-        xQueueSendToBack(s_inbound_queue, &tmp[i], 0);
     }
+    xSemaphoreGive(s_inbound_lock);
     return found;
 }
 
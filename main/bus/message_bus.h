@@ -19,28 +19,53 @@ typedef struct {
 } mimi_msg_t;
 
 /**
- * Initialize the message bus (inbound + outbound FreeRTOS queues).
+ * Initialize the message bus (inbound priority inbox + outbound FreeRTOS queue).
  */
 esp_err_t message_bus_init(void);
 
 /**
  * Push a message to the inbound queue (towards Agent Loop).
+ * Waits up to 1 s for a free slot when the inbox is full.
  * The bus takes ownership of msg->content.
  */
 esp_err_t message_bus_push_inbound(const mimi_msg_t *msg);
 
 /**
  * Pop a message from the inbound queue (blocking).
+ * Messages come out by channel priority class (websocket, then
+ * telegram/cli/other, then system), FIFO within a class. A class whose
+ * oldest message has waited MIMI_BUS_INBOUND_AGE_MS is served first.
  * Caller must free msg->content when done.
  */
 esp_err_t message_bus_pop_inbound(mimi_msg_t *msg, uint32_t timeout_ms);
 
 /**
  * Pop inbound message with WebSocket priority.
- * If both websocket and non-websocket messages exist, websocket is returned first.
+ * Same as message_bus_pop_inbound(); websocket is the highest class.
  */
 esp_err_t message_bus_pop_inbound_prefer_websocket(mimi_msg_t *msg, uint32_t timeout_ms);
 
+/**
+ * Filter for message_bus_pop_inbound_match(). Runs under the bus lock:
+ * it must not block or call back into the bus.
+ */
+typedef bool (*message_bus_match_t)(const mimi_msg_t *msg, void *arg);
+
+/**
+ * Pop the first queued message, in priority order, that `match` accepts.
+ * Messages passed over stay queued in place. When nothing is accepted,
+ * waits for a push or message_bus_inbound_wake() and scans again.
+ * Caller must free msg->content when done.
+ */
+esp_err_t message_bus_pop_inbound_match(mimi_msg_t *msg, message_bus_match_t match,
+                                        void *arg, uint32_t timeout_ms);
+
+/**
+ * Wake a waiting message_bus_pop_inbound_match() to rescan, e.g. after
+ * whatever made its filter reject messages has changed.
+ */
+void message_bus_inbound_wake(void);
+
 /**
  * Current inbound queue depth.
  */
@@ -48,7 +73,7 @@ int message_bus_inbound_depth(void);
 
 /**
  * Check whether inbound queue already contains a message with channel/chat_id.
- * Returns true if found.
+ * Returns true if found. Does not reorder or copy queued messages.
  */
 bool message_bus_inbound_contains(const char *channel, const char *chat_id);
 
@@ -8,6 +8,7 @@
 #include "esp_heap_caps.h"
 #include "cJSON.h"
 #include "component/component_auto_detect.h"
+#include "memory/kv_store.h"
 
 static const char *TAG = "comp_mgr";
 
@@ -317,7 +318,38 @@ int comp_get_count(void)
 
 /* ── Runtime Config ──────────────────────────────────────────────── */
 
-esp_err_t comp_load_config(void)
+/* Switches live in the journaled store: "comp/off/<name>" marks a
+ * disabled component and "comp/auto_detection" turns detection on. Saving
+ * touches only the markers that changed. COMP_CONFIG_FILE is read once to
+ * import what older firmware saved. */
+#define COMP_KEY_PREFIX   "comp/"
+#define COMP_OFF_PREFIX   "comp/off/"
+#define COMP_AUTO_KEY     "comp/auto_detection"
+
+static bool disable_by_config(const char *name)
+{
+    comp_entry_t *c = find_by_name(name);
+    if (!c) return false;
+    if (c->required) {
+        ESP_LOGW(TAG, "Cannot disable required component '%s'", c->name);
+        return false;
+    }
+    c->state = COMP_STATE_DISABLED;
+    ESP_LOGI(TAG, "Component '%s' disabled by config", c->name);
+    return true;
+}
+
+static void apply_auto_detection(bool enabled)
+{
+    if (enabled) {
+        ESP_LOGI(TAG, "Auto-detection enabled by config");
+        comp_auto_detect_apply();
+    } else {
+        ESP_LOGI(TAG, "Auto-detection disabled (manual mode)");
+    }
+}
+
+static esp_err_t import_legacy_config(void)
 {
     FILE *f = fopen(COMP_CONFIG_FILE, "r");
     if (!f) {
@@ -351,14 +383,13 @@ esp_err_t comp_load_config(void)
         return ESP_ERR_INVALID_STATE;
     }
 
+    esp_err_t err = ESP_OK;
+
     /* Check for auto-detection flag */
     cJSON *auto_det = cJSON_GetObjectItem(root, "auto_detection");
-    if (cJSON_IsBool(auto_det) && cJSON_IsTrue(auto_det)) {
-        ESP_LOGI(TAG, "Auto-detection enabled by config");
-        comp_auto_detect_apply();
-    } else {
-        ESP_LOGI(TAG, "Auto-detection disabled (manual mode)");
-    }
+    bool auto_on = cJSON_IsBool(auto_det) && cJSON_IsTrue(auto_det);
+    if (auto_on) err = kv_store_set_str(COMP_AUTO_KEY, "1");
+    apply_auto_detection(auto_on);
 
     /* Format: { "disabled": ["telegram", "websocket"] } */
     cJSON *disabled = cJSON_GetObjectItem(root, "disabled");
@@ -367,53 +398,65 @@ esp_err_t comp_load_config(void)
         cJSON *item = NULL;
         cJSON_ArrayForEach(item, disabled) {
             if (!cJSON_IsString(item)) continue;
-            comp_entry_t *c = find_by_name(item->valuestring);
-            if (c) {
-                if (c->required) {
-                    ESP_LOGW(TAG, "Cannot disable required component '%s'", c->name);
-                    continue;
-                }
-                c->state = COMP_STATE_DISABLED;
-                disabled_count++;
-                ESP_LOGI(TAG, "Component '%s' disabled by config", c->name);
-            }
+            if (!disable_by_config(item->valuestring)) continue;
+            disabled_count++;
+
+            char key[KV_KEY_MAX];
+            snprintf(key, sizeof(key), COMP_OFF_PREFIX "%s", item->valuestring);
+            if (err == ESP_OK) err = kv_store_set_str(key, "1");
         }
         ESP_LOGI(TAG, "Config loaded: %d components disabled", disabled_count);
     }
 
     cJSON_Delete(root);
+    if (err == ESP_OK) {
+        remove(COMP_CONFIG_FILE);
+        ESP_LOGI(TAG, "Imported component config from %s", COMP_CONFIG_FILE);
+    }
     return ESP_OK;
 }
 
-esp_err_t comp_save_config(void)
+static bool load_disabled_cb(const char *key, const void *value, size_t len, void *arg)
 {
+    (void)value;
+    (void)len;
+    if (disable_by_config(key + strlen(COMP_OFF_PREFIX))) (*(int *)arg)++;
+    return true;
+}
 
-    cJSON *root = cJSON_CreateObject();
-    if (!root) return ESP_ERR_NO_MEM;
-
-    cJSON *disabled = cJSON_CreateArray();
-    for (int i = 0; i < s_count; i++) {
-        if (s_components[i].state == COMP_STATE_DISABLED) {
-            cJSON_AddItemToArray(disabled, cJSON_CreateString(s_components[i].name));
-        }
+esp_err_t comp_load_config(void)
+{
+    if (!kv_store_has_prefix(COMP_KEY_PREFIX)) {
+        return import_legacy_config();
     }
-    cJSON_AddItemToObject(root, "disabled", disabled);
 
-    char *str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    if (!str) return ESP_ERR_NO_MEM;
+    char flag[2];
+    apply_auto_detection(kv_store_get(COMP_AUTO_KEY, flag, sizeof(flag)) > 0);
 
-    FILE *f = fopen(COMP_CONFIG_FILE, "w");
-    if (!f) {
-        free(str);
-        ESP_LOGE(TAG, "Failed to write component config");
-        return ESP_FAIL;
-    }
+    int disabled_count = 0;
+    kv_store_foreach(COMP_OFF_PREFIX, load_disabled_cb, &disabled_count);
+    ESP_LOGI(TAG, "Config loaded: %d components disabled", disabled_count);
+    return ESP_OK;
+}
 
-    fputs(str, f);
-    fclose(f);
-    free(str);
+esp_err_t comp_save_config(void)
+{
+    /* An explicit save means manual mode, as it always has */
+    esp_err_t ret = kv_store_delete(COMP_AUTO_KEY);
+
+    for (int i = 0; i < s_count; i++) {
+        char key[KV_KEY_MAX];
+        snprintf(key, sizeof(key), COMP_OFF_PREFIX "%s", s_components[i].name);
+        esp_err_t err = (s_components[i].state == COMP_STATE_DISABLED)
+                        ? kv_store_set_str(key, "1")
+                        : kv_store_delete(key);
+        if (err != ESP_OK) ret = err;
+    }
 
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write component config: %s", esp_err_to_name(ret));
+        return ret;
+    }
     ESP_LOGI(TAG, "Component config saved");
     return ESP_OK;
 }
@@ -122,22 +122,22 @@ int comp_get_count(void);
 
 /* ── Runtime Config ──────────────────────────────────────────────── */
 
-#define COMP_CONFIG_FILE  "/spiffs/config/components.json"
+#define COMP_CONFIG_FILE  "/spiffs/config/components.json"   /* legacy, imported once */
 
 /**
- * Load config from SPIFFS. Marks components as DISABLED if config says so.
+ * Load config from the config store. Marks components as DISABLED if config says so.
  * Must be called AFTER all comp_register() and BEFORE comp_init_all().
  */
 esp_err_t comp_load_config(void);
 
 /**
- * Save current enable/disable state to SPIFFS.
+ * Save current enable/disable state to the config store.
  */
 esp_err_t comp_save_config(void);
 
 /**
  * Enable or disable a component by name.
- * Changes take effect on next boot (saves to config file).
+ * Changes take effect on next boot (saves to the config store).
  * @return ESP_OK, or ESP_ERR_NOT_FOUND
  */
 esp_err_t comp_set_enabled(const char *name, bool enabled);
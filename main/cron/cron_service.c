@@ -1,6 +1,7 @@
 #include "cron/cron_service.h"
 #include "mimi_config.h"
 #include "bus/message_bus.h"
+#include "memory/kv_store.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -25,21 +26,171 @@ static TaskHandle_t s_cron_task = NULL;
 
 /* ── Persistence ──────────────────────────────────────────────── */
 
+/* Jobs live in the journaled store: the definition under "cron/<id>" as
+ * JSON, and the run times, which change on every fire, under
+ * "cron/<id>/t" as two int64s. MIMI_CRON_FILE is only read once, to
+ * import jobs saved by older firmware. */
+
+#define CRON_KEY_PREFIX  "cron/"
+#define CRON_TIMES_SUFFIX "/t"
+
+typedef struct {
+    int64_t last_run;
+    int64_t next_run;
+} cron_times_t;
+
 static void cron_generate_id(char *id_buf)
 {
     uint32_t r = esp_random();
     snprintf(id_buf, 9, "%08x", (unsigned int)r);
 }
 
-static esp_err_t cron_load_jobs(void)
+static void cron_key(const char *id, bool times, char *buf, size_t size)
 {
-    FILE *f = fopen(MIMI_CRON_FILE, "r");
-    if (!f) {
-        ESP_LOGI(TAG, "No cron file found, starting fresh");
-        s_job_count = 0;
-        return ESP_OK;
+    snprintf(buf, size, CRON_KEY_PREFIX "%s%s", id, times ? CRON_TIMES_SUFFIX : "");
+}
+
+static bool cron_job_from_json(const cJSON *item, cron_job_t *job)
+{
+    memset(job, 0, sizeof(cron_job_t));
+
+    const char *id = cJSON_GetStringValue(cJSON_GetObjectItem(item, "id"));
+    const char *name = cJSON_GetStringValue(cJSON_GetObjectItem(item, "name"));
+    const char *kind_str = cJSON_GetStringValue(cJSON_GetObjectItem(item, "kind"));
+    const char *message = cJSON_GetStringValue(cJSON_GetObjectItem(item, "message"));
+    const char *channel = cJSON_GetStringValue(cJSON_GetObjectItem(item, "channel"));
+    const char *chat_id = cJSON_GetStringValue(cJSON_GetObjectItem(item, "chat_id"));
+
+    if (!id || !name || !kind_str || !message) return false;
+
+    strncpy(job->id, id, sizeof(job->id) - 1);
+    strncpy(job->name, name, sizeof(job->name) - 1);
+    strncpy(job->message, message, sizeof(job->message) - 1);
+    strncpy(job->channel, channel ? channel : MIMI_CHAN_SYSTEM,
+            sizeof(job->channel) - 1);
+    strncpy(job->chat_id, chat_id ? chat_id : "cron",
+            sizeof(job->chat_id) - 1);
+
+    cJSON *enabled_j = cJSON_GetObjectItem(item, "enabled");
+    job->enabled = enabled_j ? cJSON_IsTrue(enabled_j) : true;
+
+    cJSON *delete_j = cJSON_GetObjectItem(item, "delete_after_run");
+    job->delete_after_run = delete_j ? cJSON_IsTrue(delete_j) : false;
+
+    if (strcmp(kind_str, "every") == 0) {
+        job->kind = CRON_KIND_EVERY;
+        cJSON *interval = cJSON_GetObjectItem(item, "interval_s");
+        job->interval_s = (interval && cJSON_IsNumber(interval))
+                          ? (uint32_t)interval->valuedouble : 0;
+    } else if (strcmp(kind_str, "at") == 0) {
+        job->kind = CRON_KIND_AT;
+        cJSON *at_epoch = cJSON_GetObjectItem(item, "at_epoch");
+        job->at_epoch = (at_epoch && cJSON_IsNumber(at_epoch))
+                        ? (int64_t)at_epoch->valuedouble : 0;
+    } else {
+        return false; /* Unknown kind, skip */
+    }
+
+    cJSON *last_run = cJSON_GetObjectItem(item, "last_run");
+    job->last_run = (last_run && cJSON_IsNumber(last_run))
+                    ? (int64_t)last_run->valuedouble : 0;
+
+    cJSON *next_run = cJSON_GetObjectItem(item, "next_run");
+    job->next_run = (next_run && cJSON_IsNumber(next_run))
+                    ? (int64_t)next_run->valuedouble : 0;
+    return true;
+}
+
+/* Definition only; run times are stored separately */
+static char *cron_job_to_json(const cron_job_t *job)
+{
+    cJSON *item = cJSON_CreateObject();
+    if (!item) return NULL;
+
+    cJSON_AddStringToObject(item, "id", job->id);
+    cJSON_AddStringToObject(item, "name", job->name);
+    cJSON_AddBoolToObject(item, "enabled", job->enabled);
+    cJSON_AddStringToObject(item, "kind",
+        job->kind == CRON_KIND_EVERY ? "every" : "at");
+
+    if (job->kind == CRON_KIND_EVERY) {
+        cJSON_AddNumberToObject(item, "interval_s", job->interval_s);
+    } else {
+        cJSON_AddNumberToObject(item, "at_epoch", (double)job->at_epoch);
+    }
+
+    cJSON_AddStringToObject(item, "message", job->message);
+    cJSON_AddStringToObject(item, "channel", job->channel);
+    cJSON_AddStringToObject(item, "chat_id", job->chat_id);
+    cJSON_AddBoolToObject(item, "delete_after_run", job->delete_after_run);
+
+    char *json_str = cJSON_PrintUnformatted(item);
+    cJSON_Delete(item);
+    return json_str;
+}
+
+static esp_err_t cron_persist_times(const cron_job_t *job)
+{
+    char key[KV_KEY_MAX];
+    cron_key(job->id, true, key, sizeof(key));
+    cron_times_t t = { .last_run = job->last_run, .next_run = job->next_run };
+    return kv_store_set(key, &t, sizeof(t));
+}
+
+static esp_err_t cron_persist_job(const cron_job_t *job)
+{
+    char *json_str = cron_job_to_json(job);
+    if (!json_str) {
+        ESP_LOGE(TAG, "Failed to serialize cron job %s", job->id);
+        return ESP_ERR_NO_MEM;
     }
 
+    char key[KV_KEY_MAX];
+    cron_key(job->id, false, key, sizeof(key));
+    esp_err_t err = kv_store_set_str(key, json_str);
+    free(json_str);
+    if (err == ESP_OK) err = cron_persist_times(job);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save cron job %s: %s", job->id, esp_err_to_name(err));
+    }
+    return err;
+}
+
+static void cron_forget_job(const char *id)
+{
+    char key[KV_KEY_MAX];
+    cron_key(id, true, key, sizeof(key));
+    kv_store_delete(key);
+    cron_key(id, false, key, sizeof(key));
+    kv_store_delete(key);
+}
+
+static bool load_job_cb(const char *key, const void *value, size_t len, void *arg)
+{
+    (void)arg;
+    size_t klen = strlen(key);
+    size_t slen = strlen(CRON_TIMES_SUFFIX);
+    if (klen > slen && strcmp(key + klen - slen, CRON_TIMES_SUFFIX) == 0) {
+        return true;    /* applied once every definition is loaded */
+    }
+    if (s_job_count >= MAX_CRON_JOBS) return false;
+
+    cJSON *item = cJSON_ParseWithLength(value, len);
+    if (item && cron_job_from_json(item, &s_jobs[s_job_count])) {
+        s_job_count++;
+    } else {
+        ESP_LOGW(TAG, "Skipping unreadable cron record %s", key);
+    }
+    cJSON_Delete(item);
+    return true;
+}
+
+/* Import jobs from the JSON file written by older firmware */
+static void cron_import_legacy(void)
+{
+    FILE *f = fopen(MIMI_CRON_FILE, "r");
+    if (!f) return;
+
     /* Read entire file */
     fseek(f, 0, SEEK_END);
     long fsize = ftell(f);
@@ -48,8 +199,7 @@ static esp_err_t cron_load_jobs(void)
     if (fsize <= 0 || fsize > 8192) {
         ESP_LOGW(TAG, "Cron file invalid size: %ld", fsize);
         fclose(f);
-        s_job_count = 0;
-        return ESP_OK;
+        return;
     }
 
     char *buf = heap_caps_malloc((size_t)fsize + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
@@ -58,150 +208,57 @@ static esp_err_t cron_load_jobs(void)
     }
     if (!buf) {
         fclose(f);
-        return ESP_ERR_NO_MEM;
+        return;
     }
 
     size_t n = fread(buf, 1, fsize, f);
     buf[n] = '\0';
     fclose(f);
 
-    /* Parse JSON */
     cJSON *root = cJSON_Parse(buf);
     free(buf);
-
-    if (!root) {
-        ESP_LOGW(TAG, "Failed to parse cron JSON");
-        s_job_count = 0;
-        return ESP_OK;
-    }
-
-    cJSON *jobs_arr = cJSON_GetObjectItem(root, "jobs");
+    cJSON *jobs_arr = root ? cJSON_GetObjectItem(root, "jobs") : NULL;
     if (!jobs_arr || !cJSON_IsArray(jobs_arr)) {
+        ESP_LOGW(TAG, "Failed to parse cron JSON");
         cJSON_Delete(root);
-        s_job_count = 0;
-        return ESP_OK;
+        return;
     }
 
-    s_job_count = 0;
+    bool saved = true;
     cJSON *item;
     cJSON_ArrayForEach(item, jobs_arr) {
         if (s_job_count >= MAX_CRON_JOBS) break;
-
         cron_job_t *job = &s_jobs[s_job_count];
-        memset(job, 0, sizeof(cron_job_t));
-
-        const char *id = cJSON_GetStringValue(cJSON_GetObjectItem(item, "id"));
-        const char *name = cJSON_GetStringValue(cJSON_GetObjectItem(item, "name"));
-        const char *kind_str = cJSON_GetStringValue(cJSON_GetObjectItem(item, "kind"));
-        const char *message = cJSON_GetStringValue(cJSON_GetObjectItem(item, "message"));
-        const char *channel = cJSON_GetStringValue(cJSON_GetObjectItem(item, "channel"));
-        const char *chat_id = cJSON_GetStringValue(cJSON_GetObjectItem(item, "chat_id"));
-
-        if (!id || !name || !kind_str || !message) continue;
-
-        strncpy(job->id, id, sizeof(job->id) - 1);
-        strncpy(job->name, name, sizeof(job->name) - 1);
-        strncpy(job->message, message, sizeof(job->message) - 1);
-        strncpy(job->channel, channel ? channel : MIMI_CHAN_SYSTEM,
-                sizeof(job->channel) - 1);
-        strncpy(job->chat_id, chat_id ? chat_id : "cron",
-                sizeof(job->chat_id) - 1);
-
-        cJSON *enabled_j = cJSON_GetObjectItem(item, "enabled");
-        job->enabled = enabled_j ? cJSON_IsTrue(enabled_j) : true;
-
-        cJSON *delete_j = cJSON_GetObjectItem(item, "delete_after_run");
-        job->delete_after_run = delete_j ? cJSON_IsTrue(delete_j) : false;
-
-        if (strcmp(kind_str, "every") == 0) {
-            job->kind = CRON_KIND_EVERY;
-            cJSON *interval = cJSON_GetObjectItem(item, "interval_s");
-            job->interval_s = (interval && cJSON_IsNumber(interval))
-                              ? (uint32_t)interval->valuedouble : 0;
-        } else if (strcmp(kind_str, "at") == 0) {
-            job->kind = CRON_KIND_AT;
-            cJSON *at_epoch = cJSON_GetObjectItem(item, "at_epoch");
-            job->at_epoch = (at_epoch && cJSON_IsNumber(at_epoch))
-                            ? (int64_t)at_epoch->valuedouble : 0;
-        } else {
-            continue; /* Unknown kind, skip */
-        }
-
-        cJSON *last_run = cJSON_GetObjectItem(item, "last_run");
-        job->last_run = (last_run && cJSON_IsNumber(last_run))
-                        ? (int64_t)last_run->valuedouble : 0;
-
-        cJSON *next_run = cJSON_GetObjectItem(item, "next_run");
-        job->next_run = (next_run && cJSON_IsNumber(next_run))
-                        ? (int64_t)next_run->valuedouble : 0;
-
+        if (!cron_job_from_json(item, job)) continue;
+        if (cron_persist_job(job) != ESP_OK) saved = false;
         s_job_count++;
     }
-
     cJSON_Delete(root);
-    ESP_LOGI(TAG, "Loaded %d cron jobs", s_job_count);
-    return ESP_OK;
+
+    if (saved) remove(MIMI_CRON_FILE);
+    ESP_LOGI(TAG, "Imported %d cron jobs from %s", s_job_count, MIMI_CRON_FILE);
 }
 
-static esp_err_t cron_save_jobs(void)
+static esp_err_t cron_load_jobs(void)
 {
-    cJSON *root = cJSON_CreateObject();
-    cJSON *jobs_arr = cJSON_CreateArray();
+    s_job_count = 0;
+    if (!kv_store_has_prefix(CRON_KEY_PREFIX)) {
+        cron_import_legacy();
+        if (s_job_count == 0) ESP_LOGI(TAG, "No cron jobs saved, starting fresh");
+        return ESP_OK;
+    }
 
+    kv_store_foreach(CRON_KEY_PREFIX, load_job_cb, NULL);
     for (int i = 0; i < s_job_count; i++) {
-        cron_job_t *job = &s_jobs[i];
-        cJSON *item = cJSON_CreateObject();
-
-        cJSON_AddStringToObject(item, "id", job->id);
-        cJSON_AddStringToObject(item, "name", job->name);
-        cJSON_AddBoolToObject(item, "enabled", job->enabled);
-        cJSON_AddStringToObject(item, "kind",
-            job->kind == CRON_KIND_EVERY ? "every" : "at");
-
-        if (job->kind == CRON_KIND_EVERY) {
-            cJSON_AddNumberToObject(item, "interval_s", job->interval_s);
-        } else {
-            cJSON_AddNumberToObject(item, "at_epoch", (double)job->at_epoch);
+        char key[KV_KEY_MAX];
+        cron_key(s_jobs[i].id, true, key, sizeof(key));
+        cron_times_t t;
+        if (kv_store_get(key, &t, sizeof(t)) == sizeof(t)) {
+            s_jobs[i].last_run = t.last_run;
+            s_jobs[i].next_run = t.next_run;
         }
-
-        cJSON_AddStringToObject(item, "message", job->message);
-        cJSON_AddStringToObject(item, "channel", job->channel);
-        cJSON_AddStringToObject(item, "chat_id", job->chat_id);
-        cJSON_AddNumberToObject(item, "last_run", (double)job->last_run);
-        cJSON_AddNumberToObject(item, "next_run", (double)job->next_run);
-        cJSON_AddBoolToObject(item, "delete_after_run", job->delete_after_run);
-
-        cJSON_AddItemToArray(jobs_arr, item);
     }
-
-    cJSON_AddItemToObject(root, "jobs", jobs_arr);
-
-    char *json_str = cJSON_Print(root);
-    cJSON_Delete(root);
-
-    if (!json_str) {
-        ESP_LOGE(TAG, "Failed to serialize cron jobs");
-        return ESP_ERR_NO_MEM;
-    }
-
-    FILE *f = fopen(MIMI_CRON_FILE, "w");
-    if (!f) {
-        ESP_LOGE(TAG, "Failed to open %s for writing", MIMI_CRON_FILE);
-        free(json_str);
-        return ESP_FAIL;
-    }
-
-    size_t len = strlen(json_str);
-    size_t written = fwrite(json_str, 1, len, f);
-    fclose(f);
-    free(json_str);
-
-    if (written != len) {
-        ESP_LOGE(TAG, "Cron save incomplete: %d/%d bytes", (int)written, (int)len);
-        return ESP_FAIL;
-    }
-
-    ESP_LOGI(TAG, "Saved %d cron jobs to %s", s_job_count, MIMI_CRON_FILE);
+    ESP_LOGI(TAG, "Loaded %d cron jobs", s_job_count);
     return ESP_OK;
 }
 
@@ -211,8 +268,6 @@ static void cron_process_due_jobs(void)
 {
     time_t now = time(NULL);
 
-    bool changed = false;
-
     for (int i = 0; i < s_job_count; i++) {
         cron_job_t *job = &s_jobs[i];
         if (!job->enabled) continue;
@@ -221,14 +276,14 @@ static void cron_process_due_jobs(void)
 
         if (job->last_run > 0 && (now - job->last_run) < CRON_MIN_FIRE_GAP_S) {
             job->next_run = job->last_run + CRON_MIN_FIRE_GAP_S;
-            changed = true;
+            cron_persist_times(job);
             continue;
         }
 
         int inbound_depth = message_bus_inbound_depth();
-        if (inbound_depth >= (MIMI_BUS_QUEUE_LEN - 1)) {
+        if (inbound_depth >= (MIMI_BUS_INBOUND_DEPTH - 1)) {
             job->next_run = now + CRON_BACKPRESSURE_DELAY_S;
-            changed = true;
+            cron_persist_times(job);
             ESP_LOGW(TAG, "Deferring cron job %s due to inbound backpressure (depth=%d)",
                      job->name, inbound_depth);
             continue;
@@ -236,7 +291,7 @@ static void cron_process_due_jobs(void)
 
         if (message_bus_inbound_has_channel(MIMI_CHAN_WEBSOCKET)) {
             job->next_run = now + CRON_BACKPRESSURE_DELAY_S;
-            changed = true;
+            cron_persist_times(job);
             ESP_LOGI(TAG, "Deferring cron job %s because websocket requests are pending", job->name);
             continue;
         }
@@ -244,7 +299,7 @@ static void cron_process_due_jobs(void)
         if (strcmp(job->channel, MIMI_CHAN_SYSTEM) == 0 &&
             message_bus_inbound_contains(job->channel, job->chat_id)) {
             job->next_run = now + CRON_BACKPRESSURE_DELAY_S;
-            changed = true;
+            cron_persist_times(job);
             ESP_LOGW(TAG, "Deferring cron job %s due to dedupe on %s:%s",
                      job->name, job->channel, job->chat_id);
             continue;
@@ -276,6 +331,7 @@ static void cron_process_due_jobs(void)
             if (job->delete_after_run) {
                 /* Remove by shifting array */
                 ESP_LOGI(TAG, "Deleting one-shot job: %s", job->name);
+                cron_forget_job(job->id);
                 for (int j = i; j < s_job_count - 1; j++) {
                     s_jobs[j] = s_jobs[j + 1];
                 }
@@ -284,17 +340,13 @@ static void cron_process_due_jobs(void)
             } else {
                 job->enabled = false;
                 job->next_run = 0;
+                cron_persist_job(job);
             }
         } else {
             /* Recurring: compute next run */
             job->next_run = now + job->interval_s;
+            cron_persist_times(job);
         }
-
-        changed = true;
-    }
-
-    if (changed) {
-        cron_save_jobs();
     }
 }
 
@@ -413,7 +465,7 @@ esp_err_t cron_add_job(cron_job_t *job)
     s_jobs[s_job_count] = *job;
     s_job_count++;
 
-    cron_save_jobs();
+    cron_persist_job(job);
 
     ESP_LOGI(TAG, "Added cron job: %s (%s) kind=%s next_run=%lld",
              job->name, job->id,
@@ -427,14 +479,13 @@ esp_err_t cron_remove_job(const char *job_id)
     for (int i = 0; i < s_job_count; i++) {
         if (strcmp(s_jobs[i].id, job_id) == 0) {
             ESP_LOGI(TAG, "Removing cron job: %s (%s)", s_jobs[i].name, job_id);
+            cron_forget_job(job_id);
 
             /* Shift remaining jobs down */
             for (int j = i; j < s_job_count - 1; j++) {
                 s_jobs[j] = s_jobs[j + 1];
             }
             s_job_count--;
-
-            cron_save_jobs();
             return ESP_OK;
         }
     }
@@ -0,0 +1,198 @@
+#include "json_writer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+void jw_init(json_writer_t *w, json_sink_t sink, void *arg, char *buf, size_t cap)
+{
+    memset(w, 0, sizeof(*w));
+    w->sink = sink;
+    w->arg = arg;
+    w->buf = buf;
+    w->cap = sink ? cap : 0;
+}
+
+esp_err_t jw_flush(json_writer_t *w)
+{
+    if (w->sink && w->len > 0 && !w->failed) {
+        if (w->sink(w->arg, w->buf, w->len) != 0) {
+            w->failed = true;
+        }
+    }
+    w->len = 0;
+    return w->failed ? ESP_FAIL : ESP_OK;
+}
+
+static void jw_put(json_writer_t *w, const char *data, size_t len)
+{
+    w->total += len;
+    if (!w->sink || w->failed) return;
+
+    while (len > 0) {
+        size_t space = w->cap - w->len;
+        if (space == 0) {
+            if (jw_flush(w) != ESP_OK) return;
+            space = w->cap;
+        }
+        size_t n = (len < space) ? len : space;
+        memcpy(w->buf + w->len, data, n);
+        w->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+typedef void (*jw_emit_t)(json_writer_t *w, const char *data, size_t len);
+
+/* Escape like cJSON: quote, backslash and control characters; UTF-8
+ * passes through untouched. Runs of safe bytes are emitted in one go. */
+static void jw_escape(json_writer_t *w, const char *s, size_t len, jw_emit_t emit)
+{
+    size_t run = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        const char *esc = NULL;
+        char ubuf[8];
+        switch (c) {
+        case '"':  esc = "\\\""; break;
+        case '\\': esc = "\\\\"; break;
+        case '\b': esc = "\\b"; break;
+        case '\f': esc = "\\f"; break;
+        case '\n': esc = "\\n"; break;
+        case '\r': esc = "\\r"; break;
+        case '\t': esc = "\\t"; break;
+        default:
+            if (c < 0x20) {
+                snprintf(ubuf, sizeof(ubuf), "\\u%04x", c);
+                esc = ubuf;
+            }
+            break;
+        }
+        if (!esc) continue;
+        if (i > run) emit(w, s + run, i - run);
+        emit(w, esc, strlen(esc));
+        run = i + 1;
+    }
+    if (len > run) emit(w, s + run, len - run);
+}
+
+void jw_raw(json_writer_t *w, const char *data, size_t len)
+{
+    if (w->escape) {
+        jw_escape(w, data, len, jw_put);
+    } else {
+        jw_put(w, data, len);
+    }
+}
+
+void jw_str(json_writer_t *w, const char *s)
+{
+    jw_raw(w, s, strlen(s));
+}
+
+/* String pieces go through jw_raw, so a string written while the writer
+ * is in escape mode (JSON embedded in a JSON string) is escaped twice. */
+void jw_string_begin(json_writer_t *w)
+{
+    jw_raw(w, "\"", 1);
+}
+
+void jw_string_frag(json_writer_t *w, const char *s)
+{
+    if (s) jw_escape(w, s, strlen(s), jw_raw);
+}
+
+void jw_string_end(json_writer_t *w)
+{
+    jw_raw(w, "\"", 1);
+}
+
+void jw_string(json_writer_t *w, const char *s)
+{
+    jw_string_begin(w);
+    jw_string_frag(w, s);
+    jw_string_end(w);
+}
+
+void jw_key(json_writer_t *w, const char *key)
+{
+    jw_string(w, key);
+    jw_raw(w, ":", 1);
+}
+
+void jw_number(json_writer_t *w, double d)
+{
+    char num[32];
+    int n;
+    if (isnan(d) || isinf(d)) {
+        n = snprintf(num, sizeof(num), "null");
+    } else if (fabs(d) < 1e15 && d == (double)(long long)d) {
+        /* Range first: casting a double beyond long long is undefined */
+        n = snprintf(num, sizeof(num), "%lld", (long long)d);
+    } else {
+        n = snprintf(num, sizeof(num), "%1.15g", d);
+        double check = 0;
+        if (sscanf(num, "%lg", &check) != 1 || check != d) {
+            n = snprintf(num, sizeof(num), "%1.17g", d);
+        }
+    }
+    jw_raw(w, num, (size_t)n);
+}
+
+void jw_cjson(json_writer_t *w, const cJSON *item)
+{
+    if (!item) {
+        jw_str(w, "null");
+        return;
+    }
+
+    switch (item->type & 0xFF) {
+    case cJSON_False:
+        jw_str(w, "false");
+        break;
+    case cJSON_True:
+        jw_str(w, "true");
+        break;
+    case cJSON_NULL:
+        jw_str(w, "null");
+        break;
+    case cJSON_Number:
+        jw_number(w, item->valuedouble);
+        break;
+    case cJSON_String:
+        jw_string(w, item->valuestring);
+        break;
+    case cJSON_Raw:
+        if (item->valuestring) jw_str(w, item->valuestring);
+        break;
+    case cJSON_Array: {
+        jw_raw(w, "[", 1);
+        const cJSON *child;
+        bool first = true;
+        cJSON_ArrayForEach(child, item) {
+            if (!first) jw_raw(w, ",", 1);
+            jw_cjson(w, child);
+            first = false;
+        }
+        jw_raw(w, "]", 1);
+        break;
+    }
+    case cJSON_Object: {
+        jw_raw(w, "{", 1);
+        const cJSON *child;
+        bool first = true;
+        cJSON_ArrayForEach(child, item) {
+            if (!first) jw_raw(w, ",", 1);
+            jw_key(w, child->string ? child->string : "");
+            jw_cjson(w, child);
+            first = false;
+        }
+        jw_raw(w, "}", 1);
+        break;
+    }
+    default:
+        jw_str(w, "null");
+        break;
+    }
+}
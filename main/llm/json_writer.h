@@ -0,0 +1,62 @@
+#pragma once
+
+#include "esp_err.h"
+#include "cJSON.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/* ── Streaming JSON Writer ─────────────────────────────────────────
+ *
+ * Serializes JSON through a small fixed buffer into a sink callback,
+ * so large request bodies never exist as one string in memory.
+ * With a NULL sink the writer only counts bytes, which lets callers
+ * compute a Content-Length with a dry run before sending.
+ */
+
+/* Returns 0 on success, -1 to abort the write */
+typedef int (*json_sink_t)(void *arg, const char *data, size_t len);
+
+typedef struct {
+    json_sink_t sink;
+    void *arg;
+    char *buf;
+    size_t cap;
+    size_t len;
+    size_t total;       /* bytes produced so far */
+    bool escape;        /* route raw output through string escaping */
+    bool failed;
+} json_writer_t;
+
+/**
+ * Initialize a writer. sink == NULL selects counting mode (buf may be NULL).
+ */
+void jw_init(json_writer_t *w, json_sink_t sink, void *arg, char *buf, size_t cap);
+
+/** Write raw JSON text (escaped if inside jw_string_begin/end with escape set). */
+void jw_raw(json_writer_t *w, const char *data, size_t len);
+
+/** Write a NUL-terminated raw JSON fragment. */
+void jw_str(json_writer_t *w, const char *s);
+
+/** Write a quoted, escaped JSON string (NULL writes ""). */
+void jw_string(json_writer_t *w, const char *s);
+
+/** Write "key": */
+void jw_key(json_writer_t *w, const char *key);
+
+/** Open a JSON string value; fragments written with jw_string_frag are escaped. */
+void jw_string_begin(json_writer_t *w);
+void jw_string_frag(json_writer_t *w, const char *s);
+void jw_string_end(json_writer_t *w);
+
+/** Write a number using the same formatting rules as cJSON. */
+void jw_number(json_writer_t *w, double d);
+
+/** Serialize a cJSON tree (unformatted). */
+void jw_cjson(json_writer_t *w, const cJSON *item);
+
+/**
+ * Flush buffered bytes to the sink.
+ * @return ESP_OK, or ESP_FAIL if any sink call failed
+ */
+esp_err_t jw_flush(json_writer_t *w);
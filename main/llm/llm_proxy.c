@@ -1,8 +1,12 @@
 #include "llm_proxy.h"
 #include "mimi_config.h"
 #include "proxy/http_proxy.h"
+#include "json_writer.h"
+#include "tools/tool_registry.h"
 
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
 #include <stdlib.h>
 #include "esp_log.h"
 #include "esp_http_client.h"
@@ -13,6 +17,7 @@
 #include "cJSON.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 
 static const char *TAG = "llm";
 
@@ -32,10 +37,12 @@ char s_asr_endpoint[256] = MIMI_SECRET_ASR_ENDPOINT;
 char s_tts_endpoint[256] = MIMI_SECRET_TTS_ENDPOINT;
 static bool s_streaming = true; /* streaming enabled by default */
 
-/* Global status callback for forwarding HTTP progress to UI */
-static llm_stream_cb_t s_status_cb = NULL;
-static void *s_status_ctx = NULL;
-static bool s_first_data_received = false;
+/* Status callback for forwarding HTTP progress to UI. Thread-local:
+ * every agent worker runs its own request, and the HTTP event handler
+ * fires in the task that issued it. */
+static __thread llm_stream_cb_t s_status_cb = NULL;
+static __thread void *s_status_ctx = NULL;
+static __thread bool s_first_data_received = false;
 
 static void safe_copy(char *dst, size_t dst_size, const char *src)
 {
@@ -89,12 +96,22 @@ static void resp_buf_free(resp_buf_t *rb)
 
 /* ── Streaming Context ────────────────────────────────────────── */
 
+/* Single-pass SSE state machine. Each complete "data:" line is parsed
+ * once; tokens go to the callback and, when a response struct is
+ * attached, text and tool calls are assembled into it in place. */
 typedef struct {
     llm_stream_cb_t cb;
     void *ctx;
-    char *buf;       /* Line buffer for SSE parsing */
+    llm_response_t *resp;   /* assembled as events arrive (optional) */
+    char *buf;              /* current partial SSE line */
     size_t len;
     size_t cap;
+    size_t text_cap;
+    size_t input_cap[MIMI_MAX_TOOL_CALLS];
+    int block_call;         /* Anthropic: call index of the open tool_use block */
+    llm_usage_t usage;
+    char head[256];         /* first body bytes, kept for error logging */
+    size_t head_len;
 } stream_ctx_t;
 
 typedef struct {
@@ -102,13 +119,17 @@ typedef struct {
     stream_ctx_t *stream; /* Stream context (optional) */
 } http_req_ctx_t;
 
-static void stream_ctx_init(stream_ctx_t *ctx, llm_stream_cb_t cb, void *user_ctx)
+static void stream_ctx_init(stream_ctx_t *ctx, llm_stream_cb_t cb, void *user_ctx,
+                            llm_response_t *resp)
 {
+    memset(ctx, 0, sizeof(*ctx));
     ctx->cb = cb;
     ctx->ctx = user_ctx;
+    ctx->resp = resp;
+    ctx->block_call = -1;
     ctx->cap = 4096;
     ctx->buf = heap_caps_calloc(1, ctx->cap, MALLOC_CAP_SPIRAM);
-    ctx->len = 0;
+    if (resp) memset(resp, 0, sizeof(*resp));
 }
 
 static void stream_ctx_free(stream_ctx_t *ctx)
@@ -119,7 +140,216 @@ static void stream_ctx_free(stream_ctx_t *ctx)
     }
 }
 
-/* Extract content from "data: {...}" line */
+/* Drop everything assembled so far (request is being retried) */
+static void stream_ctx_reset(stream_ctx_t *ctx)
+{
+    ctx->len = 0;
+    ctx->head_len = 0;
+    ctx->text_cap = 0;
+    memset(ctx->input_cap, 0, sizeof(ctx->input_cap));
+    ctx->block_call = -1;
+    memset(&ctx->usage, 0, sizeof(ctx->usage));
+    if (ctx->resp) {
+        llm_response_free(ctx->resp);
+        memset(ctx->resp, 0, sizeof(*ctx->resp));
+    }
+}
+
+/* Append to a growable PSRAM string, doubling capacity to keep token
+ * accumulation linear. */
+static void str_append(char **dst, size_t *len, size_t *cap, const char *src, size_t n)
+{
+    if (*len + n + 1 > *cap) {
+        size_t new_cap = *cap ? *cap : 256;
+        while (new_cap < *len + n + 1) new_cap *= 2;
+        char *tmp = heap_caps_realloc(*dst, new_cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!tmp) return; /* OOM drop */
+        *dst = tmp;
+        *cap = new_cap;
+    }
+    memcpy(*dst + *len, src, n);
+    *len += n;
+    (*dst)[*len] = '\0';
+}
+
+static void stream_emit_text(stream_ctx_t *ctx, const char *text)
+{
+    if (ctx->cb) ctx->cb(text, ctx->ctx);
+    if (ctx->resp) {
+        str_append(&ctx->resp->text, &ctx->resp->text_len, &ctx->text_cap, text, strlen(text));
+    }
+}
+
+static void stream_append_input(stream_ctx_t *ctx, int idx, const char *frag)
+{
+    llm_tool_call_t *call = &ctx->resp->calls[idx];
+    str_append(&call->input, &call->input_len, &ctx->input_cap[idx], frag, strlen(frag));
+}
+
+/* OpenAI/MiniMax/Ollama: choices[0].delta.{content,tool_calls}, finish_reason */
+static void stream_handle_openai(stream_ctx_t *ctx, cJSON *choice)
+{
+    llm_response_t *resp = ctx->resp;
+    cJSON *delta = cJSON_GetObjectItem(choice, "delta");
+    if (delta) {
+        cJSON *content = cJSON_GetObjectItem(delta, "content");
+        if (content && cJSON_IsString(content) && content->valuestring[0]) {
+            stream_emit_text(ctx, content->valuestring);
+        }
+
+        cJSON *tool_calls = cJSON_GetObjectItem(delta, "tool_calls");
+        if (resp && tool_calls && cJSON_IsArray(tool_calls)) {
+            cJSON *tc;
+            cJSON_ArrayForEach(tc, tool_calls) {
+                cJSON *idx = cJSON_GetObjectItem(tc, "index");
+                int index = (idx && cJSON_IsNumber(idx)) ? idx->valueint : 0;
+                if (index < 0 || index >= MIMI_MAX_TOOL_CALLS) continue;
+                if (index + 1 > resp->call_count) resp->call_count = index + 1;
+
+                llm_tool_call_t *call = &resp->calls[index];
+                cJSON *id = cJSON_GetObjectItem(tc, "id");
+                if (id && cJSON_IsString(id)) {
+                    strncpy(call->id, id->valuestring, sizeof(call->id) - 1);
+                }
+                cJSON *func = cJSON_GetObjectItem(tc, "function");
+                if (func) {
+                    cJSON *name = cJSON_GetObjectItem(func, "name");
+                    if (name && cJSON_IsString(name)) {
+                        strncpy(call->name, name->valuestring, sizeof(call->name) - 1);
+                    }
+                    cJSON *args = cJSON_GetObjectItem(func, "arguments");
+                    if (args && cJSON_IsString(args)) {
+                        stream_append_input(ctx, index, args->valuestring);
+                    }
+                }
+            }
+            resp->tool_use = true;
+        }
+    }
+
+    cJSON *finish = cJSON_GetObjectItem(choice, "finish_reason");
+    if (resp && finish && cJSON_IsString(finish) &&
+        strcmp(finish->valuestring, "tool_calls") == 0) {
+        resp->tool_use = true;
+    }
+}
+
+/* Anthropic: content_block_start / content_block_delta / message_delta */
+static void stream_handle_anthropic(stream_ctx_t *ctx, cJSON *root, const char *type)
+{
+    llm_response_t *resp = ctx->resp;
+
+    if (strcmp(type, "content_block_delta") == 0) {
+        cJSON *delta = cJSON_GetObjectItem(root, "delta");
+        if (!delta) return;
+        cJSON *text = cJSON_GetObjectItem(delta, "text");
+        if (text && cJSON_IsString(text)) {
+            stream_emit_text(ctx, text->valuestring);
+        }
+        cJSON *partial = cJSON_GetObjectItem(delta, "partial_json");
+        if (resp && partial && cJSON_IsString(partial) && ctx->block_call >= 0) {
+            stream_append_input(ctx, ctx->block_call, partial->valuestring);
+        }
+    } else if (strcmp(type, "content_block_start") == 0) {
+        ctx->block_call = -1;
+        if (!resp) return;
+        cJSON *cb = cJSON_GetObjectItem(root, "content_block");
+        cJSON *cb_type = cb ? cJSON_GetObjectItem(cb, "type") : NULL;
+        if (!cb_type || !cJSON_IsString(cb_type) ||
+            strcmp(cb_type->valuestring, "tool_use") != 0) {
+            return;
+        }
+        resp->tool_use = true;
+        if (resp->call_count >= MIMI_MAX_TOOL_CALLS) return;
+        ctx->block_call = resp->call_count++;
+        llm_tool_call_t *call = &resp->calls[ctx->block_call];
+        cJSON *id = cJSON_GetObjectItem(cb, "id");
+        if (id && cJSON_IsString(id)) strncpy(call->id, id->valuestring, sizeof(call->id) - 1);
+        cJSON *name = cJSON_GetObjectItem(cb, "name");
+        if (name && cJSON_IsString(name)) strncpy(call->name, name->valuestring, sizeof(call->name) - 1);
+    } else if (strcmp(type, "content_block_stop") == 0) {
+        ctx->block_call = -1;
+    } else if (strcmp(type, "message_delta") == 0) {
+        cJSON *delta = cJSON_GetObjectItem(root, "delta");
+        cJSON *stop = delta ? cJSON_GetObjectItem(delta, "stop_reason") : NULL;
+        if (resp && stop && cJSON_IsString(stop) && strcmp(stop->valuestring, "tool_use") == 0) {
+            resp->tool_use = true;
+        }
+    } else if (strcmp(type, "error") == 0) {
+        cJSON *error = cJSON_GetObjectItem(root, "error");
+        cJSON *msg = error ? cJSON_GetObjectItem(error, "message") : NULL;
+        ESP_LOGE(TAG, "Stream error event: %s",
+                 (msg && cJSON_IsString(msg)) ? msg->valuestring : "unknown");
+    }
+}
+
+/* ── Token usage ───────────────────────────────────────────────── */
+
+static SemaphoreHandle_t s_usage_lock = NULL;
+static llm_cache_stats_t s_cache_stats = {0};
+
+static void usage_field(const cJSON *usage, const char *key, uint32_t *out)
+{
+    const cJSON *v = cJSON_GetObjectItem(usage, key);
+    if (v && cJSON_IsNumber(v)) *out = (uint32_t)v->valuedouble;
+}
+
+/* Merge a "usage" object into out. Anthropic streams report it in pieces
+ * (message_start, then output_tokens in message_delta), so only fields
+ * present are overwritten. */
+static void parse_usage(const cJSON *usage, llm_usage_t *out)
+{
+    if (!usage || !cJSON_IsObject(usage)) return;
+
+    usage_field(usage, "input_tokens", &out->input_tokens);
+    usage_field(usage, "cache_creation_input_tokens", &out->cache_write_tokens);
+    usage_field(usage, "cache_read_input_tokens", &out->cache_read_tokens);
+    usage_field(usage, "output_tokens", &out->output_tokens);
+
+    /* OpenAI format: prompt_tokens includes the cached part */
+    const cJSON *prompt = cJSON_GetObjectItem(usage, "prompt_tokens");
+    if (prompt && cJSON_IsNumber(prompt)) {
+        uint32_t cached = 0;
+        usage_field(cJSON_GetObjectItem(usage, "prompt_tokens_details"), "cached_tokens", &cached);
+        uint32_t total = (uint32_t)prompt->valuedouble;
+        out->cache_read_tokens = cached;
+        out->input_tokens = total > cached ? total - cached : 0;
+        usage_field(usage, "completion_tokens", &out->output_tokens);
+    }
+}
+
+static void usage_record(const llm_usage_t *u)
+{
+    if (!s_usage_lock) return;
+    if (u->input_tokens == 0 && u->cache_read_tokens == 0 && u->cache_write_tokens == 0) return;
+
+    xSemaphoreTake(s_usage_lock, portMAX_DELAY);
+    s_cache_stats.requests++;
+    if (u->cache_read_tokens > 0) s_cache_stats.cache_hits++;
+    s_cache_stats.input_tokens += u->input_tokens;
+    s_cache_stats.cache_write_tokens += u->cache_write_tokens;
+    s_cache_stats.cache_read_tokens += u->cache_read_tokens;
+    s_cache_stats.output_tokens += u->output_tokens;
+    xSemaphoreGive(s_usage_lock);
+
+    ESP_LOGI(TAG, "Usage: input=%u cache_write=%u cache_read=%u output=%u",
+             (unsigned)u->input_tokens, (unsigned)u->cache_write_tokens,
+             (unsigned)u->cache_read_tokens, (unsigned)u->output_tokens);
+}
+
+void llm_get_cache_stats(llm_cache_stats_t *out)
+{
+    if (!out) return;
+    if (!s_usage_lock) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(s_usage_lock, portMAX_DELAY);
+    *out = s_cache_stats;
+    xSemaphoreGive(s_usage_lock);
+}
+
+/* Handle one complete SSE line */
 static void process_sse_line(stream_ctx_t *ctx, char *line)
 {
     /* Skip "data: " prefix */
@@ -134,39 +364,26 @@ static void process_sse_line(stream_ctx_t *ctx, char *line)
     /* Check for [DONE] */
     if (strncmp(line, "[DONE]", 6) == 0) return;
 
-    /* Parse JSON line */
     cJSON *root = cJSON_Parse(line);
     if (!root) return;
 
-    /* OpenAI/MiniMax format: choices[0].delta.content */
     cJSON *choices = cJSON_GetObjectItem(root, "choices");
     if (choices && cJSON_IsArray(choices)) {
         cJSON *c0 = cJSON_GetArrayItem(choices, 0);
-        if (c0) {
-            cJSON *delta = cJSON_GetObjectItem(c0, "delta");
-            if (delta) {
-                cJSON *content = cJSON_GetObjectItem(delta, "content");
-                if (content && cJSON_IsString(content)) {
-                    if (ctx->cb) ctx->cb(content->valuestring, ctx->ctx);
-                }
-            }
-        }
+        if (c0) stream_handle_openai(ctx, c0);
     }
 
-    /* Anthropic format: content_block_delta with delta.text */
     cJSON *type = cJSON_GetObjectItem(root, "type");
     if (type && cJSON_IsString(type)) {
-        if (strcmp(type->valuestring, "content_block_delta") == 0) {
-            cJSON *delta = cJSON_GetObjectItem(root, "delta");
-            if (delta) {
-                cJSON *text = cJSON_GetObjectItem(delta, "text");
-                if (text && cJSON_IsString(text)) {
-                    if (ctx->cb) ctx->cb(text->valuestring, ctx->ctx);
-                }
-            }
-        }
+        stream_handle_anthropic(ctx, root, type->valuestring);
     }
 
+    /* Anthropic: message_start carries message.usage, message_delta a
+     * top-level usage; OpenAI sends usage in the final chunk */
+    parse_usage(cJSON_GetObjectItem(root, "usage"), &ctx->usage);
+    cJSON *message = cJSON_GetObjectItem(root, "message");
+    if (message) parse_usage(cJSON_GetObjectItem(message, "usage"), &ctx->usage);
+
     cJSON_Delete(root);
 }
 
@@ -174,48 +391,77 @@ static void process_stream_chunk(stream_ctx_t *ctx, const char *data, size_t len
 {
     if (!ctx || !ctx->buf) return;
 
-    /* Append to buffer */
-    if (ctx->len + len >= ctx->cap) {
-        size_t new_cap = ctx->cap * 2;
-        if (new_cap < ctx->len + len + 1) new_cap = ctx->len + len + 1024;
-        char *tmp = heap_caps_realloc(ctx->buf, new_cap, MALLOC_CAP_SPIRAM);
-        if (!tmp) return; /* OOM drop */
-        ctx->buf = tmp;
-        ctx->cap = new_cap;
-    }
-    memcpy(ctx->buf + ctx->len, data, len);
-    ctx->len += len;
-    ctx->buf[ctx->len] = '\0';
-
-    /* Process lines */
-    char *start = ctx->buf;
-    char *end;
-    while ((end = strstr(start, "\n"))) {
-        *end = '\0'; /* Terminate line */
-        /* Handle CR if present */
-        if (end > start && *(end - 1) == '\r') *(end - 1) = '\0';
-        
-        if (strlen(start) > 0) {
-            process_sse_line(ctx, start);
+    if (ctx->head_len < sizeof(ctx->head) - 1) {
+        size_t n = sizeof(ctx->head) - 1 - ctx->head_len;
+        if (n > len) n = len;
+        memcpy(ctx->head + ctx->head_len, data, n);
+        ctx->head_len += n;
+        ctx->head[ctx->head_len] = '\0';
+    }
+
+    /* Only the new bytes are scanned; complete lines are handled as soon
+     * as their newline arrives and the line buffer is reused. */
+    while (len > 0) {
+        const char *nl = memchr(data, '\n', len);
+        size_t seg = nl ? (size_t)(nl - data) : len;
+
+        if (ctx->len + seg + 1 > ctx->cap) {
+            size_t new_cap = ctx->cap * 2;
+            if (new_cap < ctx->len + seg + 1) new_cap = ctx->len + seg + 1024;
+            char *tmp = heap_caps_realloc(ctx->buf, new_cap, MALLOC_CAP_SPIRAM);
+            if (!tmp) return; /* OOM drop */
+            ctx->buf = tmp;
+            ctx->cap = new_cap;
         }
+        memcpy(ctx->buf + ctx->len, data, seg);
+        ctx->len += seg;
+
+        if (!nl) break;
 
-        start = end + 1;
+        /* Terminate line, handle CR if present */
+        if (ctx->len > 0 && ctx->buf[ctx->len - 1] == '\r') ctx->len--;
+        ctx->buf[ctx->len] = '\0';
+        if (ctx->len > 0) {
+            process_sse_line(ctx, ctx->buf);
+        }
+        ctx->len = 0;
+
+        data += seg + 1;
+        len -= seg + 1;
     }
+}
+
+/* Discard partial results before a request is retried */
+static void http_req_reset(http_req_ctx_t *req_ctx)
+{
+    if (req_ctx->rb && req_ctx->rb->data) {
+        req_ctx->rb->len = 0;
+        req_ctx->rb->data[0] = '\0';
+    }
+    if (req_ctx->stream) {
+        stream_ctx_reset(req_ctx->stream);
+    }
+}
 
-    /* Move remaining partial line to front */
-    size_t remaining = ctx->len - (start - ctx->buf);
-    if (remaining > 0 && start != ctx->buf) {
-        memmove(ctx->buf, start, remaining);
+/* Hand a slice of response body to whichever sinks the request asked for */
+static void http_req_deliver(http_req_ctx_t *req_ctx, const char *data, size_t len)
+{
+    if (req_ctx->rb) {
+        resp_buf_append(req_ctx->rb, data, len);
+    }
+    if (req_ctx->stream) {
+        if (!s_first_data_received && s_status_cb) {
+            s_status_cb("Receiving...", s_status_ctx);
+            s_first_data_received = true;
+        }
+        process_stream_chunk(req_ctx->stream, data, len);
     }
-    ctx->len = remaining;
-    ctx->buf[ctx->len] = '\0';
 }
 
 /* ── HTTP event handler (for esp_http_client direct path) ─────── */
 
 static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 {
-    http_req_ctx_t *req_ctx = (http_req_ctx_t *)evt->user_data;
     switch(evt->event_id) {
         case HTTP_EVENT_ERROR:
             ESP_LOGI(TAG, "HTTP_EVENT_ERROR");
@@ -232,16 +478,7 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
         case HTTP_EVENT_ON_HEADER:
             break;
         case HTTP_EVENT_ON_DATA:
-            if (req_ctx->rb) {
-                resp_buf_append(req_ctx->rb, (const char *)evt->data, evt->data_len);
-            }
-            if (req_ctx->stream) {
-                if (!s_first_data_received && s_status_cb) {
-                    s_status_cb("Receiving...", s_status_ctx);
-                    s_first_data_received = true;
-                }
-                process_stream_chunk(req_ctx->stream, (const char *)evt->data, evt->data_len);
-            }
+            /* Body is pulled with esp_http_client_read in llm_http_direct */
             break;
         case HTTP_EVENT_ON_FINISH:
             ESP_LOGI(TAG, "HTTP_EVENT_ON_FINISH");
@@ -318,10 +555,175 @@ static const char *llm_api_path(void)
     return "/v1/messages";  /* anthropic */
 }
 
+static int llm_api_port(void)
+{
+    if (provider_is_ollama()) {
+        int port = atoi(s_ollama_port);
+        return port > 0 ? port : 11434;
+    }
+    return 443;
+}
+
+/* ── Keep-alive connection pool ───────────────────────────────── */
+
+/* One slot holds a warm connection to a single host, either an
+ * esp_http_client handle (direct) or a CONNECT tunnel (proxy). A slot
+ * is checked out for the duration of one request and returned idle. */
+typedef struct {
+    bool in_use;
+    bool via_proxy;
+    char host[64];
+    int port;
+    int64_t last_used_us;
+    esp_http_client_handle_t client;
+    proxy_conn_t *tunnel;
+} llm_conn_slot_t;
+
+static llm_conn_slot_t s_pool[MIMI_LLM_CONN_POOL_SIZE];
+static SemaphoreHandle_t s_pool_lock = NULL;
+static llm_conn_pool_stats_t s_pool_stats = {0};
+
+static bool conn_slot_is_open(const llm_conn_slot_t *slot)
+{
+    return slot->client != NULL || slot->tunnel != NULL;
+}
+
+static void conn_slot_close(llm_conn_slot_t *slot)
+{
+    if (slot->client) {
+        esp_http_client_cleanup(slot->client);
+        slot->client = NULL;
+    }
+    if (slot->tunnel) {
+        proxy_conn_close(slot->tunnel);
+        slot->tunnel = NULL;
+    }
+    slot->host[0] = '\0';
+    slot->port = 0;
+}
+
+/* Check out a slot for host:port. The returned slot may already carry a
+ * warm connection; if not, the caller opens one and stores it in the slot.
+ * Returns NULL when every slot is busy (caller falls back to a one-shot
+ * connection). */
+static llm_conn_slot_t *conn_pool_acquire(const char *host, int port, bool via_proxy)
+{
+    if (!s_pool_lock) return NULL;
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+
+    int64_t now = esp_timer_get_time();
+    llm_conn_slot_t *hit = NULL;
+    llm_conn_slot_t *free_slot = NULL;
+    llm_conn_slot_t *lru = NULL;
+
+    for (int i = 0; i < MIMI_LLM_CONN_POOL_SIZE; i++) {
+        llm_conn_slot_t *slot = &s_pool[i];
+        if (slot->in_use) continue;
+
+        /* Idle eviction: servers drop idle keep-alive sessions anyway */
+        if (conn_slot_is_open(slot) &&
+            now - slot->last_used_us > (int64_t)MIMI_LLM_CONN_IDLE_MS * 1000) {
+            ESP_LOGI(TAG, "Pool: evicting idle connection to %s:%d", slot->host, slot->port);
+            conn_slot_close(slot);
+            s_pool_stats.evictions++;
+        }
+
+        if (!conn_slot_is_open(slot)) {
+            if (!free_slot) free_slot = slot;
+            continue;
+        }
+        if (!hit && slot->via_proxy == via_proxy && slot->port == port &&
+            strcmp(slot->host, host) == 0) {
+            hit = slot;
+        }
+        if (!lru || slot->last_used_us < lru->last_used_us) lru = slot;
+    }
+
+    llm_conn_slot_t *slot = hit;
+    if (hit) {
+        s_pool_stats.hits++;
+    } else {
+        s_pool_stats.misses++;
+        slot = free_slot;
+        if (!slot && lru) {
+            ESP_LOGI(TAG, "Pool: displacing connection to %s:%d", lru->host, lru->port);
+            conn_slot_close(lru);
+            s_pool_stats.evictions++;
+            slot = lru;
+        }
+        if (slot) {
+            safe_copy(slot->host, sizeof(slot->host), host);
+            slot->port = port;
+            slot->via_proxy = via_proxy;
+        }
+    }
+    if (slot) slot->in_use = true;
+
+    xSemaphoreGive(s_pool_lock);
+    return slot;
+}
+
+/* Return a slot. Connections that ended in an error or were closed by
+ * the server are dropped rather than kept warm. */
+static void conn_pool_release(llm_conn_slot_t *slot, bool reusable)
+{
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    if (!reusable) {
+        conn_slot_close(slot);
+    }
+    slot->last_used_us = esp_timer_get_time();
+    slot->in_use = false;
+    xSemaphoreGive(s_pool_lock);
+}
+
+static void conn_pool_note_reconnect(void)
+{
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    s_pool_stats.reconnects++;
+    xSemaphoreGive(s_pool_lock);
+}
+
+/* Drop every idle connection (provider/host changed) */
+static void conn_pool_flush(void)
+{
+    if (!s_pool_lock) return;
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    for (int i = 0; i < MIMI_LLM_CONN_POOL_SIZE; i++) {
+        if (!s_pool[i].in_use && conn_slot_is_open(&s_pool[i])) {
+            conn_slot_close(&s_pool[i]);
+            s_pool_stats.evictions++;
+        }
+    }
+    xSemaphoreGive(s_pool_lock);
+}
+
+void llm_get_conn_pool_stats(llm_conn_pool_stats_t *out)
+{
+    if (!out) return;
+    if (!s_pool_lock) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    *out = s_pool_stats;
+    out->open = 0;
+    for (int i = 0; i < MIMI_LLM_CONN_POOL_SIZE; i++) {
+        if (conn_slot_is_open(&s_pool[i])) out->open++;
+    }
+    xSemaphoreGive(s_pool_lock);
+}
+
 /* ── Init ─────────────────────────────────────────────────────── */
 
 esp_err_t llm_proxy_init(void)
 {
+    if (!s_pool_lock) {
+        s_pool_lock = xSemaphoreCreateMutex();
+    }
+    if (!s_usage_lock) {
+        s_usage_lock = xSemaphoreCreateMutex();
+    }
+
     /* Start with build-time defaults */
     if (MIMI_SECRET_API_KEY[0] != '\0') {
         safe_copy(s_api_key, sizeof(s_api_key), MIMI_SECRET_API_KEY);
@@ -402,9 +804,337 @@ esp_err_t llm_proxy_init(void)
     return ESP_OK;
 }
 
+/* ── Request body writer ──────────────────────────────────────── */
+
+/* Everything needed to serialize one request. The body is streamed
+ * straight from these inputs, so no second copy of the history is
+ * ever built as a cJSON tree or a flat string. */
+typedef struct {
+    const char *system_prompt;
+    const cJSON *messages;      /* Anthropic-shaped history (caller owns) */
+    const char *tools_json;     /* tools array already in the provider's format, or NULL */
+    bool stream;
+} llm_req_t;
+
+static bool block_is(const cJSON *block, const char *type)
+{
+    cJSON *btype = cJSON_GetObjectItem(block, "type");
+    return btype && cJSON_IsString(btype) && strcmp(btype->valuestring, type) == 0;
+}
+
+static const char *block_text(const cJSON *block, const char *key)
+{
+    cJSON *item = cJSON_GetObjectItem(block, key);
+    return (item && cJSON_IsString(item)) ? item->valuestring : NULL;
+}
+
+static void jw_sep(json_writer_t *w, bool *first)
+{
+    if (!*first) jw_raw(w, ",", 1);
+    *first = false;
+}
+
+/* Translate the Anthropic-shaped history into OpenAI chat messages
+ * while writing: assistant tool_use blocks become tool_calls, user
+ * tool_result blocks become role=tool messages. */
+static void write_messages_openai(json_writer_t *w, const char *system_prompt,
+                                  const cJSON *messages)
+{
+    bool first = true;
+    jw_raw(w, "[", 1);
+
+    if (system_prompt && system_prompt[0]) {
+        jw_sep(w, &first);
+        jw_str(w, "{\"role\":\"system\",\"content\":");
+        jw_string(w, system_prompt);
+        jw_raw(w, "}", 1);
+    }
+
+    const cJSON *msg;
+    cJSON_ArrayForEach(msg, messages) {
+        const char *role = block_text(msg, "role");
+        cJSON *content = cJSON_GetObjectItem(msg, "content");
+        if (!role) continue;
+
+        if (content && cJSON_IsString(content)) {
+            jw_sep(w, &first);
+            jw_str(w, "{\"role\":");
+            jw_string(w, role);
+            jw_str(w, ",\"content\":");
+            jw_string(w, content->valuestring);
+            jw_raw(w, "}", 1);
+            continue;
+        }
+
+        if (!content || !cJSON_IsArray(content)) continue;
+
+        const cJSON *block;
+        if (strcmp(role, "assistant") == 0) {
+            jw_sep(w, &first);
+            jw_str(w, "{\"role\":\"assistant\",\"content\":");
+            jw_string_begin(w);
+            cJSON_ArrayForEach(block, content) {
+                if (block_is(block, "text")) jw_string_frag(w, block_text(block, "text"));
+            }
+            jw_string_end(w);
+
+            bool first_call = true;
+            cJSON_ArrayForEach(block, content) {
+                if (!block_is(block, "tool_use")) continue;
+                const char *name = block_text(block, "name");
+                if (!name || !name[0]) continue;
+
+                jw_str(w, first_call ? ",\"tool_calls\":[{" : ",{");
+                first_call = false;
+                const char *id = block_text(block, "id");
+                if (id) {
+                    jw_key(w, "id");
+                    jw_string(w, id);
+                    jw_raw(w, ",", 1);
+                }
+                jw_str(w, "\"type\":\"function\",\"function\":{\"name\":");
+                jw_string(w, name);
+                jw_str(w, ",\"arguments\":");
+
+                /* arguments is the input object serialized into a string */
+                cJSON *input = cJSON_GetObjectItem(block, "input");
+                if (input) {
+                    jw_string_begin(w);
+                    w->escape = true;
+                    jw_cjson(w, input);
+                    w->escape = false;
+                    jw_string_end(w);
+                } else {
+                    jw_string(w, "{}");
+                }
+                jw_str(w, "}}");
+            }
+            if (!first_call) jw_raw(w, "]", 1);
+            jw_raw(w, "}", 1);
+        } else if (strcmp(role, "user") == 0) {
+            /* tool_result blocks become role=tool */
+            bool has_user_text = false;
+            cJSON_ArrayForEach(block, content) {
+                if (block_is(block, "tool_result")) {
+                    const char *tool_id = block_text(block, "tool_use_id");
+                    if (!tool_id) continue;
+                    jw_sep(w, &first);
+                    jw_str(w, "{\"role\":\"tool\",\"tool_call_id\":");
+                    jw_string(w, tool_id);
+                    jw_str(w, ",\"content\":");
+                    jw_string(w, block_text(block, "content"));
+                    jw_raw(w, "}", 1);
+                } else if (block_is(block, "text") && block_text(block, "text")) {
+                    has_user_text = true;
+                }
+            }
+            if (has_user_text) {
+                jw_sep(w, &first);
+                jw_str(w, "{\"role\":\"user\",\"content\":");
+                jw_string_begin(w);
+                cJSON_ArrayForEach(block, content) {
+                    if (block_is(block, "text")) jw_string_frag(w, block_text(block, "text"));
+                }
+                jw_string_end(w);
+                jw_raw(w, "}", 1);
+            }
+        }
+    }
+
+    jw_raw(w, "]", 1);
+}
+
+/* Prompt caching breakpoint (Anthropic). Everything up to and including
+ * a marked block is cached for a few minutes and billed at a fraction of
+ * the input price when the next request repeats the same prefix. */
+#define CACHE_CONTROL_FIELD  "\"cache_control\":{\"type\":\"ephemeral\"}"
+
+static bool prompt_cache_enabled(void)
+{
+#if CONFIG_MIMI_ENABLE_PROMPT_CACHE
+    return !provider_uses_openai_format() && !provider_is_minimax_coding();
+#else
+    return false;
+#endif
+}
+
+/* Write an object with a cache_control field appended */
+static void write_cached_block(json_writer_t *w, const cJSON *block)
+{
+    jw_raw(w, "{", 1);
+    const cJSON *child;
+    cJSON_ArrayForEach(child, block) {
+        if (!child->string || strcmp(child->string, "cache_control") == 0) continue;
+        jw_key(w, child->string);
+        jw_cjson(w, child);
+        jw_raw(w, ",", 1);
+    }
+    jw_str(w, CACHE_CONTROL_FIELD "}");
+}
+
+/* Mark the last tool: the tools blob is pre-rendered, so the breakpoint
+ * is spliced in before the closing brace of its final object. */
+static void write_tools_anthropic(json_writer_t *w, const char *tools_json, bool cache)
+{
+    size_t len = strlen(tools_json);
+    while (len > 0 && isspace((unsigned char)tools_json[len - 1])) len--;
+    if (cache && len >= 2 && tools_json[len - 2] == '}' && tools_json[len - 1] == ']') {
+        jw_raw(w, tools_json, len - 2);
+        jw_str(w, "," CACHE_CONTROL_FIELD "}]");
+    } else {
+        jw_str(w, tools_json);
+    }
+}
+
+/* History is sent as-is except for the last message, whose final content
+ * block carries the breakpoint. Within a ReAct chain each request repeats
+ * the previous one and appends to it, so that prefix is read back from
+ * the cache on the next iteration. */
+static void write_messages_anthropic(json_writer_t *w, const cJSON *messages, bool cache)
+{
+    if (!messages) {
+        jw_str(w, "[]");
+        return;
+    }
+
+    jw_raw(w, "[", 1);
+    const cJSON *msg;
+    bool first = true;
+    cJSON_ArrayForEach(msg, messages) {
+        jw_sep(w, &first);
+        if (!cache || msg->next) {
+            jw_cjson(w, msg);
+            continue;
+        }
+
+        jw_raw(w, "{", 1);
+        const cJSON *child;
+        bool first_key = true;
+        cJSON_ArrayForEach(child, msg) {
+            if (!child->string) continue;
+            jw_sep(w, &first_key);
+            jw_key(w, child->string);
+            if (strcmp(child->string, "content") != 0) {
+                jw_cjson(w, child);
+            } else if (cJSON_IsString(child) && child->valuestring[0]) {
+                jw_str(w, "[{\"type\":\"text\",\"text\":");
+                jw_string(w, child->valuestring);
+                jw_str(w, "," CACHE_CONTROL_FIELD "}]");
+            } else if (cJSON_IsArray(child) && child->child) {
+                jw_raw(w, "[", 1);
+                const cJSON *block;
+                bool first_block = true;
+                cJSON_ArrayForEach(block, child) {
+                    jw_sep(w, &first_block);
+                    if (block->next || !cJSON_IsObject(block)) {
+                        jw_cjson(w, block);
+                    } else {
+                        write_cached_block(w, block);
+                    }
+                }
+                jw_raw(w, "]", 1);
+            } else {
+                jw_cjson(w, child);
+            }
+        }
+        jw_raw(w, "}", 1);
+    }
+    jw_raw(w, "]", 1);
+}
+
+static void write_request_body(json_writer_t *w, const llm_req_t *req)
+{
+    jw_str(w, "{\"model\":");
+    jw_string(w, s_model);
+    jw_str(w, ",\"max_tokens\":");
+    jw_number(w, MIMI_LLM_MAX_TOKENS);
+    if (req->stream) {
+        jw_str(w, ",\"stream\":true");
+    }
+
+    if (provider_uses_openai_format()) {
+        jw_str(w, ",\"messages\":");
+        write_messages_openai(w, req->system_prompt, req->messages);
+        if (req->tools_json) {
+            jw_str(w, ",\"tools\":");
+            jw_str(w, req->tools_json);
+            jw_str(w, ",\"tool_choice\":\"auto\"");
+        }
+    } else {
+        bool cache = prompt_cache_enabled();
+        if (req->tools_json) {
+            jw_str(w, ",\"tools\":");
+            write_tools_anthropic(w, req->tools_json, cache);
+        }
+        jw_str(w, ",\"system\":");
+        if (cache && req->system_prompt && req->system_prompt[0]) {
+            jw_str(w, "[{\"type\":\"text\",\"text\":");
+            jw_string(w, req->system_prompt);
+            jw_str(w, "," CACHE_CONTROL_FIELD "}]");
+        } else {
+            jw_string(w, req->system_prompt);
+        }
+        jw_str(w, ",\"messages\":");
+        write_messages_anthropic(w, req->messages, cache);
+    }
+
+    jw_raw(w, "}", 1);
+}
+
+/* Dry run: the exact body size, for the Content-Length header */
+static size_t llm_body_length(const llm_req_t *req)
+{
+    json_writer_t w;
+    jw_init(&w, NULL, NULL, NULL, 0);
+    write_request_body(&w, req);
+    return w.total;
+}
+
+/* Serialize the body through `chunk` into the sink */
+static esp_err_t llm_body_send(const llm_req_t *req, json_sink_t sink, void *arg,
+                               char *chunk, size_t chunk_size)
+{
+    json_writer_t w;
+    jw_init(&w, sink, arg, chunk, chunk_size);
+    write_request_body(&w, req);
+    return jw_flush(&w);
+}
+
+static int http_client_sink(void *arg, const char *data, size_t len)
+{
+    esp_http_client_handle_t client = (esp_http_client_handle_t)arg;
+    while (len > 0) {
+        int n = esp_http_client_write(client, data, (int)len);
+        if (n <= 0) return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int proxy_conn_sink(void *arg, const char *data, size_t len)
+{
+    return proxy_conn_write((proxy_conn_t *)arg, data, (int)len) < 0 ? -1 : 0;
+}
+
 /* ── Direct path: esp_http_client ───────────────────────────── */
 
-static esp_err_t llm_http_direct(const char *post_data, http_req_ctx_t *ctx, int *out_status)
+/* Pull the response body and hand it to the request's sinks; *got_data
+ * is set once any of it has been delivered */
+static esp_err_t llm_http_read_body(esp_http_client_handle_t client, http_req_ctx_t *ctx,
+                                    char *buf, size_t buf_size, bool *got_data)
+{
+    while (1) {
+        int n = esp_http_client_read(client, buf, (int)buf_size);
+        if (n < 0) return ESP_ERR_HTTP_FETCH_HEADER;
+        if (n == 0) return ESP_OK;
+        *got_data = true;
+        http_req_deliver(ctx, buf, (size_t)n);
+    }
+}
+
+static esp_err_t llm_http_direct(const llm_req_t *req, size_t body_len,
+                                 http_req_ctx_t *ctx, int *out_status)
 {
     esp_http_client_config_t config = {
         .url = llm_api_url(),
@@ -414,15 +1144,40 @@ static esp_err_t llm_http_direct(const char *post_data, http_req_ctx_t *ctx, int
         .buffer_size = 1024,    /* Increased for TLS reliability */
         .buffer_size_tx = 2048, /* Headers + body chunks */
         .crt_bundle_attach = esp_crt_bundle_attach,
-        .keep_alive_enable = false,
+        .keep_alive_enable = true,  /* TCP keep-alive so dead pooled sockets are noticed */
+        .keep_alive_idle = 15,
+        .keep_alive_interval = 5,
+        .keep_alive_count = 3,
     };
 
+    /* One scratch buffer serves as the body write chunk and the read buffer */
+    char *scratch = heap_caps_malloc(MIMI_LLM_TX_CHUNK_SIZE, MALLOC_CAP_SPIRAM);
+    if (!scratch) return ESP_ERR_NO_MEM;
+
     esp_err_t err = ESP_FAIL;
     *out_status = 0;
+    bool stale_retried = false;
 
     for (int attempt = 1; attempt <= 3; attempt++) {
-        esp_http_client_handle_t client = esp_http_client_init(&config);
-        if (!client) return ESP_FAIL;
+        http_req_reset(ctx);
+        llm_conn_slot_t *slot = conn_pool_acquire(llm_api_host(), llm_api_port(), false);
+        esp_http_client_handle_t client = slot ? slot->client : NULL;
+        bool warm = (client != NULL);
+
+        if (warm) {
+            /* Reuse the pooled session: only per-request state changes */
+            esp_http_client_set_url(client, config.url);
+            esp_http_client_set_user_data(client, ctx);
+            if (s_status_cb) s_status_cb("Connected", s_status_ctx);
+        } else {
+            client = esp_http_client_init(&config);
+            if (!client) {
+                if (slot) conn_pool_release(slot, false);
+                free(scratch);
+                return ESP_FAIL;
+            }
+            if (slot) slot->client = client;
+        }
 
         esp_http_client_set_method(client, HTTP_METHOD_POST);
         esp_http_client_set_header(client, "Content-Type", "application/json");
@@ -436,31 +1191,173 @@ static esp_err_t llm_http_direct(const char *post_data, http_req_ctx_t *ctx, int
             esp_http_client_set_header(client, "x-api-key", s_api_key);
             esp_http_client_set_header(client, "anthropic-version", MIMI_LLM_API_VERSION);
         }
-        esp_http_client_set_post_field(client, post_data, strlen(post_data));
 
-        err = esp_http_client_perform(client);
-        *out_status = esp_http_client_get_status_code(client);
-        esp_http_client_cleanup(client);
+        /* Headers go out with the precomputed length, then the body is
+         * serialized directly into the TLS session chunk by chunk. */
+        err = esp_http_client_open(client, (int)body_len);
+        if (err == ESP_OK) {
+            err = llm_body_send(req, http_client_sink, client, scratch, MIMI_LLM_TX_CHUNK_SIZE);
+            if (err != ESP_OK) err = ESP_ERR_HTTP_WRITE_DATA;
+        }
+        if (err == ESP_OK &&
+            esp_http_client_fetch_headers(client) < 0 &&
+            !esp_http_client_is_chunked_response(client)) {
+            err = ESP_ERR_HTTP_FETCH_HEADER;
+        }
+        bool got_data = false;
+        if (err == ESP_OK) {
+            *out_status = esp_http_client_get_status_code(client);
+            err = llm_http_read_body(client, ctx, scratch, MIMI_LLM_TX_CHUNK_SIZE, &got_data);
+        }
+        /* The read ends quietly when the server closes mid-body */
+        if (err == ESP_OK && !esp_http_client_is_complete_data_received(client)) {
+            err = ESP_ERR_INVALID_RESPONSE;
+        }
+
+        bool reusable = (err == ESP_OK);
+        if (slot) {
+            conn_pool_release(slot, reusable);
+        } else {
+            esp_http_client_cleanup(client);
+        }
 
         if (err == ESP_OK) {
+            free(scratch);
             return ESP_OK;
         }
 
-        ESP_LOGW(TAG, "HTTP perform attempt %d/3 failed: %s", attempt, esp_err_to_name(err));
+        if (got_data) {
+            /* Part of the body already reached the sinks, and maybe the
+             * user as streamed text: a retry would deliver it twice */
+            ESP_LOGW(TAG, "Response truncated (status %d, %s)", *out_status, esp_err_to_name(err));
+            err = ESP_ERR_INVALID_RESPONSE;
+            break;
+        }
+
+        if (warm && !stale_retried) {
+            /* Server dropped the idle session: reconnect right away */
+            ESP_LOGI(TAG, "Pooled connection went stale (%s), reconnecting", esp_err_to_name(err));
+            conn_pool_note_reconnect();
+            stale_retried = true;
+            attempt--;
+            continue;
+        }
+
+        ESP_LOGW(TAG, "HTTP request attempt %d/3 failed: %s", attempt, esp_err_to_name(err));
         vTaskDelay(pdMS_TO_TICKS(300 * attempt));
     }
 
+    free(scratch);
     return err;
 }
 
 /* ── Proxy path: manual HTTP over CONNECT tunnel ────────────── */
 
-static esp_err_t llm_http_via_proxy(const char *post_data, http_req_ctx_t *ctx, int *out_status)
+/* Minimal HTTP/1.1 response reader for the tunnel. It decodes the
+ * framing (Content-Length or chunked) so the request can end without
+ * the server closing the socket, which lets the tunnel be pooled. */
+typedef enum {
+    PROXY_RESP_HEADERS = 0,
+    PROXY_RESP_BODY,
+    PROXY_RESP_CHUNK_SIZE,
+    PROXY_RESP_CHUNK_DATA,
+    PROXY_RESP_CHUNK_CRLF,
+    PROXY_RESP_TRAILER,
+    PROXY_RESP_DONE,
+} proxy_resp_state_t;
+
+typedef struct {
+    http_req_ctx_t *ctx;
+    proxy_resp_state_t state;
+    int status;
+    bool chunked;
+    bool conn_close;
+    long content_length;    /* -1 = delimited by connection close */
+    long remaining;         /* bytes left in body or current chunk */
+    char line[256];
+    size_t line_len;
+} proxy_resp_t;
+
+static void proxy_resp_line(proxy_resp_t *pr)
+{
+    char *line = pr->line;
+
+    switch (pr->state) {
+    case PROXY_RESP_HEADERS:
+        if (pr->status == 0 && strncmp(line, "HTTP/", 5) == 0) {
+            const char *sp = strchr(line, ' ');
+            if (sp) pr->status = atoi(sp + 1);
+        } else if (line[0] == '\0') {
+            if (pr->status >= 100 && pr->status < 200) {
+                pr->status = 0;     /* interim response, real one follows */
+            } else if (pr->chunked) {
+                pr->state = PROXY_RESP_CHUNK_SIZE;
+            } else if (pr->content_length == 0) {
+                pr->state = PROXY_RESP_DONE;
+            } else {
+                pr->remaining = pr->content_length;
+                pr->state = PROXY_RESP_BODY;
+            }
+        } else if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            pr->content_length = strtol(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+            pr->chunked = (strstr(line + 18, "chunked") != NULL);
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            pr->conn_close = (strstr(line + 11, "close") != NULL);
+        }
+        break;
+    case PROXY_RESP_CHUNK_SIZE:
+        pr->remaining = strtol(line, NULL, 16);
+        pr->state = (pr->remaining > 0) ? PROXY_RESP_CHUNK_DATA : PROXY_RESP_TRAILER;
+        break;
+    case PROXY_RESP_CHUNK_CRLF:
+        pr->state = PROXY_RESP_CHUNK_SIZE;
+        break;
+    case PROXY_RESP_TRAILER:
+        if (line[0] == '\0') pr->state = PROXY_RESP_DONE;
+        break;
+    default:
+        break;
+    }
+}
+
+static void proxy_resp_feed(proxy_resp_t *pr, const char *data, size_t len)
 {
-    proxy_conn_t *conn = proxy_conn_open(llm_api_host(), 443, 300000);
-    if (!conn) return ESP_ERR_HTTP_CONNECT;
+    size_t i = 0;
+    while (i < len && pr->state != PROXY_RESP_DONE) {
+        if (pr->state == PROXY_RESP_BODY || pr->state == PROXY_RESP_CHUNK_DATA) {
+            size_t n = len - i;
+            if (pr->content_length >= 0 || pr->state == PROXY_RESP_CHUNK_DATA) {
+                if ((long)n > pr->remaining) n = (size_t)pr->remaining;
+                pr->remaining -= (long)n;
+            }
+            http_req_deliver(pr->ctx, data + i, n);
+            i += n;
+            if (pr->remaining == 0) {
+                if (pr->state == PROXY_RESP_CHUNK_DATA) {
+                    pr->state = PROXY_RESP_CHUNK_CRLF;
+                } else if (pr->content_length >= 0) {
+                    pr->state = PROXY_RESP_DONE;
+                }
+            }
+            continue;
+        }
 
-    int body_len = strlen(post_data);
+        char c = data[i++];
+        if (c == '\n') {
+            pr->line[pr->line_len] = '\0';
+            proxy_resp_line(pr);
+            pr->line_len = 0;
+        } else if (c != '\r' && pr->line_len < sizeof(pr->line) - 1) {
+            pr->line[pr->line_len++] = c;
+        }
+    }
+}
+
+static esp_err_t llm_http_via_proxy(const llm_req_t *req, size_t body_len,
+                                    http_req_ctx_t *ctx, int *out_status)
+{
+    const char *host = llm_api_host();
     char header[512];
     int hlen = 0;
     if (provider_uses_openai_format()) {
@@ -469,9 +1366,9 @@ static esp_err_t llm_http_via_proxy(const char *post_data, http_req_ctx_t *ctx,
             "Host: %s\r\n"
             "Content-Type: application/json\r\n"
             "Authorization: Bearer %s\r\n"
-            "Content-Length: %d\r\n"
-            "Connection: close\r\n\r\n",
-            llm_api_path(), llm_api_host(), s_api_key, body_len);
+            "Content-Length: %u\r\n"
+            "Connection: keep-alive\r\n\r\n",
+            llm_api_path(), host, s_api_key, (unsigned)body_len);
     } else {
         hlen = snprintf(header, sizeof(header),
             "POST %s HTTP/1.1\r\n"
@@ -479,61 +1376,107 @@ static esp_err_t llm_http_via_proxy(const char *post_data, http_req_ctx_t *ctx,
             "Content-Type: application/json\r\n"
             "x-api-key: %s\r\n"
             "anthropic-version: %s\r\n"
-            "Content-Length: %d\r\n"
-            "Connection: close\r\n\r\n",
-            llm_api_path(), llm_api_host(), s_api_key, MIMI_LLM_API_VERSION, body_len);
+            "Content-Length: %u\r\n"
+            "Connection: keep-alive\r\n\r\n",
+            llm_api_path(), host, s_api_key, MIMI_LLM_API_VERSION, (unsigned)body_len);
     }
 
-    if (proxy_conn_write(conn, header, hlen) < 0 ||
-        proxy_conn_write(conn, post_data, body_len) < 0) {
-        proxy_conn_close(conn);
-        return ESP_ERR_HTTP_WRITE_DATA;
-    }
+    /* One scratch buffer serves as the body write chunk and the read buffer */
+    char *scratch = heap_caps_malloc(MIMI_LLM_TX_CHUNK_SIZE, MALLOC_CAP_SPIRAM);
+    if (!scratch) return ESP_ERR_NO_MEM;
+
+    esp_err_t err = ESP_FAIL;
+    *out_status = 0;
+    bool stale_retried = false;
 
-    /* Read full response into buffer */
-    char tmp[4096];
     while (1) {
-        int n = proxy_conn_read(conn, tmp, sizeof(tmp), 300000);
-        if (n <= 0) break;
-        if (ctx->rb) {
-            if (resp_buf_append(ctx->rb, tmp, n) != ESP_OK) break;
+        http_req_reset(ctx);
+        llm_conn_slot_t *slot = conn_pool_acquire(host, 443, true);
+        proxy_conn_t *conn = slot ? slot->tunnel : NULL;
+        bool warm = (conn != NULL);
+
+        if (!conn) {
+            conn = proxy_conn_open(host, 443, 300000);
+            if (!conn) {
+                if (slot) conn_pool_release(slot, false);
+                err = ESP_ERR_HTTP_CONNECT;
+                break;
+            }
+            if (slot) slot->tunnel = conn;
+        } else if (s_status_cb) {
+            s_status_cb("Connected", s_status_ctx);
         }
-        if (ctx->stream) {
-            process_stream_chunk(ctx->stream, tmp, n);
+
+        bool sent = proxy_conn_write(conn, header, hlen) >= 0 &&
+                    llm_body_send(req, proxy_conn_sink, conn,
+                                  scratch, MIMI_LLM_TX_CHUNK_SIZE) == ESP_OK;
+
+        proxy_resp_t pr = { .ctx = ctx, .content_length = -1 };
+        bool got_data = false;
+        bool eof = false;
+        if (sent) {
+            while (pr.state != PROXY_RESP_DONE) {
+                int n = proxy_conn_read(conn, scratch, MIMI_LLM_TX_CHUNK_SIZE, 300000);
+                if (n <= 0) {
+                    eof = (n == 0);
+                    break;
+                }
+                got_data = true;
+                proxy_resp_feed(&pr, scratch, n);
+            }
         }
-    }
-    proxy_conn_close(conn);
 
-    /* Parse status line */
-    *out_status = 0;
-    if (ctx->rb && ctx->rb->len > 5 && strncmp(ctx->rb->data, "HTTP/", 5) == 0) {
-        const char *sp = strchr(ctx->rb->data, ' ');
-        if (sp) *out_status = atoi(sp + 1);
-    }
-
-    /* Strip HTTP headers, keep body only */
-    if (ctx->rb) {
-        char *body = strstr(ctx->rb->data, "\r\n\r\n");
-        if (body) {
-            body += 4;
-            size_t blen = ctx->rb->len - (body - ctx->rb->data);
-            memmove(ctx->rb->data, body, blen);
-            ctx->rb->len = blen;
-            ctx->rb->data[ctx->rb->len] = '\0';
+        /* Whole only if the framing completed, or the body had no length
+         * and the server ended it by closing. A response cut short in the
+         * headers, a chunk or a Content-Length body is an error. */
+        bool complete = pr.state == PROXY_RESP_DONE ||
+                        (pr.state == PROXY_RESP_BODY && pr.content_length < 0 && eof);
+        bool reusable = pr.state == PROXY_RESP_DONE && !pr.conn_close;
+        if (slot) {
+            conn_pool_release(slot, reusable);
+        } else {
+            proxy_conn_close(conn);
         }
+
+        if (complete) {
+            *out_status = pr.status;
+            err = ESP_OK;
+            break;
+        }
+
+        if (warm && !stale_retried && !got_data) {
+            /* Tunnel was closed while idle: open a fresh one once */
+            ESP_LOGI(TAG, "Pooled tunnel went stale, reconnecting");
+            conn_pool_note_reconnect();
+            stale_retried = true;
+            continue;
+        }
+        if (!sent) {
+            err = ESP_ERR_HTTP_WRITE_DATA;
+        } else if (!got_data) {
+            err = ESP_ERR_HTTP_FETCH_HEADER;
+        } else {
+            ESP_LOGW(TAG, "Proxied response truncated (state %d, status %d)", pr.state, pr.status);
+            err = ESP_ERR_INVALID_RESPONSE;
+        }
+        break;
     }
 
-    return ESP_OK;
+    free(scratch);
+    return err;
 }
 
 /* ── Shared HTTP dispatch ─────────────────────────────────────── */
 
-static esp_err_t llm_http_call(const char *post_data, http_req_ctx_t *ctx, int *out_status)
+static esp_err_t llm_http_call(const llm_req_t *req, http_req_ctx_t *ctx, int *out_status)
 {
+    size_t body_len = llm_body_length(req);
+    ESP_LOGI(TAG, "Request body: %u bytes (streamed)", (unsigned)body_len);
+
     if (http_proxy_is_enabled()) {
-        return llm_http_via_proxy(post_data, ctx, out_status);
+        return llm_http_via_proxy(req, body_len, ctx, out_status);
     } else {
-        return llm_http_direct(post_data, ctx, out_status);
+        return llm_http_direct(req, body_len, ctx, out_status);
     }
 }
 
@@ -575,7 +1518,8 @@ static void extract_text_openai(cJSON *root, char *buf, size_t size)
     buf[size - 1] = '\0';
 }
 
-static cJSON *convert_tools_openai(const char *tools_json)
+/* Render the Anthropic tools array as an OpenAI "tools" array string */
+static char *render_tools_openai(const char *tools_json)
 {
     if (!tools_json) return NULL;
     cJSON *arr = cJSON_Parse(tools_json);
@@ -606,146 +1550,24 @@ static cJSON *convert_tools_openai(const char *tools_json)
         cJSON_AddItemToArray(out, wrap);
     }
     cJSON_Delete(arr);
-    return out;
+    char *rendered = cJSON_PrintUnformatted(out);
+    cJSON_Delete(out);
+    return rendered;
 }
 
-static cJSON *convert_messages_openai(const char *system_prompt, cJSON *messages)
+/* Tools array in the active provider's wire format. For a blob the
+ * caller acquired from the registry, the OpenAI rendering of the same
+ * set is pinned along with it; any other string is converted here and
+ * handed back through *owned for the caller to free. */
+static const char *tools_for_provider(const char *tools_json, char **owned)
 {
-    cJSON *out = cJSON_CreateArray();
-    if (system_prompt && system_prompt[0]) {
-        cJSON *sys = cJSON_CreateObject();
-        cJSON_AddStringToObject(sys, "role", "system");
-        cJSON_AddStringToObject(sys, "content", system_prompt);
-        cJSON_AddItemToArray(out, sys);
-    }
-
-    if (!messages || !cJSON_IsArray(messages)) return out;
-
-    cJSON *msg;
-    cJSON_ArrayForEach(msg, messages) {
-        cJSON *role = cJSON_GetObjectItem(msg, "role");
-        cJSON *content = cJSON_GetObjectItem(msg, "content");
-        if (!role || !cJSON_IsString(role)) continue;
-
-        if (content && cJSON_IsString(content)) {
-            cJSON *m = cJSON_CreateObject();
-            cJSON_AddStringToObject(m, "role", role->valuestring);
-            cJSON_AddStringToObject(m, "content", content->valuestring);
-            cJSON_AddItemToArray(out, m);
-            continue;
-        }
-
-        if (!content || !cJSON_IsArray(content)) continue;
-
-        if (strcmp(role->valuestring, "assistant") == 0) {
-            cJSON *m = cJSON_CreateObject();
-            cJSON_AddStringToObject(m, "role", "assistant");
-
-            /* collect text */
-            char *text_buf = NULL;
-            size_t off = 0;
-            cJSON *block;
-            cJSON *tool_calls = NULL;
-            cJSON_ArrayForEach(block, content) {
-                cJSON *btype = cJSON_GetObjectItem(block, "type");
-                if (btype && cJSON_IsString(btype) && strcmp(btype->valuestring, "text") == 0) {
-                    cJSON *text = cJSON_GetObjectItem(block, "text");
-                    if (text && cJSON_IsString(text)) {
-                        size_t tlen = strlen(text->valuestring);
-                        char *tmp = heap_caps_realloc(text_buf, off + tlen + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                        if (tmp) {
-                            text_buf = tmp;
-                            memcpy(text_buf + off, text->valuestring, tlen);
-                            off += tlen;
-                            text_buf[off] = '\0';
-                        }
-                    }
-                } else if (btype && cJSON_IsString(btype) && strcmp(btype->valuestring, "tool_use") == 0) {
-                    cJSON *id = cJSON_GetObjectItem(block, "id");
-                    cJSON *name = cJSON_GetObjectItem(block, "name");
-                    cJSON *input = cJSON_GetObjectItem(block, "input");
-                    if (!name || !cJSON_IsString(name) || !name->valuestring || !name->valuestring[0]) continue;
-                    if (!tool_calls) tool_calls = cJSON_CreateArray();
-
-                    cJSON *tc = cJSON_CreateObject();
-                    if (id && cJSON_IsString(id)) {
-                        cJSON_AddStringToObject(tc, "id", id->valuestring);
-                    }
-                    cJSON_AddStringToObject(tc, "type", "function");
-                    cJSON *func = cJSON_CreateObject();
-                    cJSON_AddStringToObject(func, "name", name->valuestring);
-                    if (input) {
-                        char *args = cJSON_PrintUnformatted(input);
-                        if (args) {
-                            cJSON_AddStringToObject(func, "arguments", args);
-                            free(args);
-                        } else {
-                            cJSON_AddStringToObject(func, "arguments", "{}");
-                        }
-                    } else {
-                        cJSON_AddStringToObject(func, "arguments", "{}");
-                    }
-                    cJSON_AddItemToObject(tc, "function", func);
-                    cJSON_AddItemToArray(tool_calls, tc);
-                }
-            }
-            if (text_buf) {
-                cJSON_AddStringToObject(m, "content", text_buf);
-            } else {
-                cJSON_AddStringToObject(m, "content", "");
-            }
-                if (tool_calls) {
-                    cJSON_AddItemToObject(m, "tool_calls", tool_calls);
-                }
-            cJSON_AddItemToArray(out, m);
-            free(text_buf);
-        } else if (strcmp(role->valuestring, "user") == 0) {
-            /* tool_result blocks become role=tool */
-            cJSON *block;
-            bool has_user_text = false;
-            char *text_buf = NULL;
-            size_t off = 0;
-            cJSON_ArrayForEach(block, content) {
-                cJSON *btype = cJSON_GetObjectItem(block, "type");
-                if (btype && cJSON_IsString(btype) && strcmp(btype->valuestring, "tool_result") == 0) {
-                    cJSON *tool_id = cJSON_GetObjectItem(block, "tool_use_id");
-                    cJSON *tcontent = cJSON_GetObjectItem(block, "content");
-                    if (!tool_id || !cJSON_IsString(tool_id)) continue;
-                    cJSON *tm = cJSON_CreateObject();
-                    cJSON_AddStringToObject(tm, "role", "tool");
-                    cJSON_AddStringToObject(tm, "tool_call_id", tool_id->valuestring);
-                    if (tcontent && cJSON_IsString(tcontent)) {
-                        cJSON_AddStringToObject(tm, "content", tcontent->valuestring);
-                    } else {
-                        cJSON_AddStringToObject(tm, "content", "");
-                    }
-                    cJSON_AddItemToArray(out, tm);
-                } else if (btype && cJSON_IsString(btype) && strcmp(btype->valuestring, "text") == 0) {
-                    cJSON *text = cJSON_GetObjectItem(block, "text");
-                    if (text && cJSON_IsString(text)) {
-                        size_t tlen = strlen(text->valuestring);
-                        char *tmp = heap_caps_realloc(text_buf, off + tlen + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                        if (tmp) {
-                            text_buf = tmp;
-                            memcpy(text_buf + off, text->valuestring, tlen);
-                            off += tlen;
-                            text_buf[off] = '\0';
-                        }
-                        has_user_text = true;
-                    }
-                }
-            }
-            if (has_user_text) {
-                cJSON *um = cJSON_CreateObject();
-                cJSON_AddStringToObject(um, "role", "user");
-                cJSON_AddStringToObject(um, "content", text_buf);
-                cJSON_AddItemToArray(out, um);
-            }
-            free(text_buf);
-        }
-    }
+    *owned = NULL;
+    if (!tools_json || !provider_uses_openai_format()) return tools_json;
 
-    return out;
+    const char *blob = tool_registry_get_tools_blob(tools_json, TOOL_SCHEMA_OPENAI);
+    if (blob) return blob;
+    *owned = render_tools_openai(tools_json);
+    return *owned;
 }
 
 /* ── Public: simple chat (backward compat) ────────────────────── */
@@ -758,59 +1580,35 @@ esp_err_t llm_chat(const char *system_prompt, const char *messages_json,
         return ESP_ERR_INVALID_STATE;
     }
 
-    /* Build request body (non-streaming) */
-    cJSON *body = cJSON_CreateObject();
-    cJSON_AddStringToObject(body, "model", s_model);
-    cJSON_AddNumberToObject(body, "max_tokens", MIMI_LLM_MAX_TOKENS);
-
-    if (provider_uses_openai_format()) {
-        cJSON *messages = cJSON_Parse(messages_json);
-        if (!messages) {
-            messages = cJSON_CreateArray();
-            cJSON *msg = cJSON_CreateObject();
-            cJSON_AddStringToObject(msg, "role", "user");
-            cJSON_AddStringToObject(msg, "content", messages_json);
-            cJSON_AddItemToArray(messages, msg);
-        }
-        cJSON *openai_msgs = convert_messages_openai(system_prompt, messages);
-        cJSON_Delete(messages);
-        cJSON_AddItemToObject(body, "messages", openai_msgs);
-    } else {
-        cJSON_AddStringToObject(body, "system", system_prompt);
-        cJSON *messages = cJSON_Parse(messages_json);
-        if (messages) {
-            cJSON_AddItemToObject(body, "messages", messages);
-        } else {
-            cJSON *arr = cJSON_CreateArray();
-            cJSON *msg = cJSON_CreateObject();
-            cJSON_AddStringToObject(msg, "role", "user");
-            cJSON_AddStringToObject(msg, "content", messages_json);
-            cJSON_AddItemToArray(arr, msg);
-            cJSON_AddItemToObject(body, "messages", arr);
-        }
+    /* Plain text that is not a JSON array is sent as one user message */
+    cJSON *messages = cJSON_Parse(messages_json);
+    if (!messages) {
+        messages = cJSON_CreateArray();
+        cJSON *msg = cJSON_CreateObject();
+        cJSON_AddStringToObject(msg, "role", "user");
+        cJSON_AddStringToObject(msg, "content", messages_json);
+        cJSON_AddItemToArray(messages, msg);
     }
 
-    char *post_data = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
-    if (!post_data) {
-        snprintf(response_buf, buf_size, "Error: Failed to build request");
-        return ESP_ERR_NO_MEM;
-    }
-
-    ESP_LOGI(TAG, "Calling LLM API (provider: %s, model: %s, body: %d bytes)",
-             s_provider, s_model, (int)strlen(post_data));
+    ESP_LOGI(TAG, "Calling LLM API (provider: %s, model: %s)", s_provider, s_model);
 
     resp_buf_t rb;
     if (resp_buf_init(&rb, MIMI_LLM_STREAM_BUF_SIZE) != ESP_OK) {
-        free(post_data);
+        cJSON_Delete(messages);
         snprintf(response_buf, buf_size, "Error: Out of memory");
         return ESP_ERR_NO_MEM;
     }
 
+    llm_req_t req = {
+        .system_prompt = system_prompt,
+        .messages = messages,
+        .tools_json = NULL,
+        .stream = false,
+    };
     int status = 0;
     http_req_ctx_t req_ctx = { .rb = &rb, .stream = NULL };
-    esp_err_t err = llm_http_call(post_data, &req_ctx, &status);
-    free(post_data);
+    esp_err_t err = llm_http_call(&req, &req_ctx, &status);
+    cJSON_Delete(messages);
 
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
@@ -837,6 +1635,10 @@ esp_err_t llm_chat(const char *system_prompt, const char *messages_json,
         return ESP_FAIL;
     }
 
+    llm_usage_t usage = {0};
+    parse_usage(cJSON_GetObjectItem(root, "usage"), &usage);
+    usage_record(&usage);
+
     if (provider_uses_openai_format()) {
         extract_text_openai(root, response_buf, buf_size);
     } else {
@@ -877,56 +1679,28 @@ esp_err_t llm_chat_tools(const char *system_prompt,
 
     if (s_api_key[0] == '\0') return ESP_ERR_INVALID_STATE;
 
-    /* Build request body (non-streaming) */
-    cJSON *body = cJSON_CreateObject();
-    cJSON_AddStringToObject(body, "model", s_model);
-    cJSON_AddNumberToObject(body, "max_tokens", MIMI_LLM_MAX_TOKENS);
+    char *tools_owned = NULL;
+    const char *tools = tools_for_provider(tools_json, &tools_owned);
 
-    if (provider_uses_openai_format()) {
-        cJSON *openai_msgs = convert_messages_openai(system_prompt, messages);
-        cJSON_AddItemToObject(body, "messages", openai_msgs);
-
-        if (tools_json) {
-            cJSON *tools = convert_tools_openai(tools_json);
-            if (tools) {
-                cJSON_AddItemToObject(body, "tools", tools);
-                cJSON_AddStringToObject(body, "tool_choice", "auto");
-            }
-        }
-    } else {
-        cJSON_AddStringToObject(body, "system", system_prompt);
-
-        /* Deep-copy messages so caller keeps ownership */
-        cJSON *msgs_copy = cJSON_Duplicate(messages, 1);
-        cJSON_AddItemToObject(body, "messages", msgs_copy);
-
-        /* Add tools array if provided */
-        if (tools_json) {
-            cJSON *tools = cJSON_Parse(tools_json);
-            if (tools) {
-                cJSON_AddItemToObject(body, "tools", tools);
-            }
-        }
-    }
-
-    char *post_data = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
-    if (!post_data) return ESP_ERR_NO_MEM;
-
-    ESP_LOGI(TAG, "Calling LLM API with tools (provider: %s, model: %s, body: %d bytes)",
-             s_provider, s_model, (int)strlen(post_data));
+    ESP_LOGI(TAG, "Calling LLM API with tools (provider: %s, model: %s)", s_provider, s_model);
 
     /* HTTP call */
     resp_buf_t rb;
     if (resp_buf_init(&rb, MIMI_LLM_STREAM_BUF_SIZE) != ESP_OK) {
-        free(post_data);
+        free(tools_owned);
         return ESP_ERR_NO_MEM;
     }
 
+    llm_req_t req = {
+        .system_prompt = system_prompt,
+        .messages = messages,
+        .tools_json = tools,
+        .stream = false,
+    };
     int status = 0;
     http_req_ctx_t req_ctx = { .rb = &rb, .stream = NULL };
-    esp_err_t err = llm_http_call(post_data, &req_ctx, &status);
-    free(post_data);
+    esp_err_t err = llm_http_call(&req, &req_ctx, &status);
+    free(tools_owned);
 
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
@@ -949,6 +1723,9 @@ esp_err_t llm_chat_tools(const char *system_prompt,
         return ESP_FAIL;
     }
 
+    parse_usage(cJSON_GetObjectItem(root, "usage"), &resp->usage);
+    usage_record(&resp->usage);
+
     if (provider_uses_openai_format()) {
         cJSON *choices = cJSON_GetObjectItem(root, "choices");
         cJSON *choice0 = choices && cJSON_IsArray(choices) ? cJSON_GetArrayItem(choices, 0) : NULL;
@@ -1085,182 +1862,6 @@ esp_err_t llm_chat_tools(const char *system_prompt,
     return ESP_OK;
 }
 
-/* Parse accumulated SSE chunks in rb->data to rebuild full response struct */
-static void parse_sse_response(const char *sse_data, llm_response_t *resp)
-{
-    memset(resp, 0, sizeof(*resp));
-    if (!sse_data) return;
-
-    /* Iterate lines manually */
-    const char *p = sse_data;
-    while (*p) {
-        /* Find start of line */
-        const char *line_start = p;
-        const char *line_end = strchr(p, '\n');
-        if (!line_end) line_end = p + strlen(p);
-        
-        p = (*line_end != '\0') ? (line_end + 1) : line_end;
-
-        /* Skip "data: " prefix */
-        const char *json_start = NULL;
-        if (strncmp(line_start, "data: ", 6) == 0) json_start = line_start + 6;
-        else if (strncmp(line_start, "data:", 5) == 0) json_start = line_start + 5;
-        else continue;
-
-        /* Check for [DONE] */
-        if (strncmp(json_start, "[DONE]", 6) == 0) continue;
-
-        cJSON *root = cJSON_Parse(json_start);
-        if (!root) continue;
-
-        /* Support OpenAI/MiniMax format */
-        cJSON *choices = cJSON_GetObjectItem(root, "choices");
-        if (choices && cJSON_IsArray(choices)) {
-            cJSON *c0 = cJSON_GetArrayItem(choices, 0);
-            if (c0) {
-                cJSON *delta = cJSON_GetObjectItem(c0, "delta");
-                if (delta) {
-                    /* Text Content */
-                    cJSON *content = cJSON_GetObjectItem(delta, "content");
-                    if (content && cJSON_IsString(content)) {
-                        /* Accumulate text */
-                        size_t new_len = strlen(content->valuestring);
-                        char *new_text = heap_caps_realloc(resp->text, resp->text_len + new_len + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                        if (new_text) {
-                            resp->text = new_text;
-                            memcpy(resp->text + resp->text_len, content->valuestring, new_len);
-                            resp->text_len += new_len;
-                            resp->text[resp->text_len] = '\0';
-                        }
-                    }
-
-                    /* Tool Calls */
-                    cJSON *tool_calls = cJSON_GetObjectItem(delta, "tool_calls");
-                    if (tool_calls && cJSON_IsArray(tool_calls)) {
-                        cJSON *tc;
-                        cJSON_ArrayForEach(tc, tool_calls) {
-                            cJSON *idx = cJSON_GetObjectItem(tc, "index");
-                            int index = (idx && cJSON_IsNumber(idx)) ? idx->valueint : 0;
-                            if (index >= MIMI_MAX_TOOL_CALLS) continue;
-
-                            /* Update max seen count */
-                            if (index + 1 > resp->call_count) resp->call_count = index + 1;
-
-                            llm_tool_call_t *call = &resp->calls[index];
-                            
-                            cJSON *id = cJSON_GetObjectItem(tc, "id");
-                            if (id && cJSON_IsString(id)) {
-                                strncpy(call->id, id->valuestring, sizeof(call->id) - 1);
-                            }
-
-                            cJSON *func = cJSON_GetObjectItem(tc, "function");
-                            if (func) {
-                                cJSON *name = cJSON_GetObjectItem(func, "name");
-                                if (name && cJSON_IsString(name)) {
-                                    strncpy(call->name, name->valuestring, sizeof(call->name) - 1);
-                                }
-                                cJSON *args = cJSON_GetObjectItem(func, "arguments");
-                                if (args && cJSON_IsString(args)) {
-                                    /* Append arguments */
-                                    size_t args_len = strlen(args->valuestring);
-                                    size_t existing_len = call->input ? call->input_len : 0;
-                                    char *new_input = heap_caps_realloc(call->input, existing_len + args_len + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                                    if (new_input) {
-                                        call->input = new_input;
-                                        memcpy(call->input + existing_len, args->valuestring, args_len);
-                                        call->input_len += args_len;
-                                        call->input[call->input_len] = '\0';
-                                    }
-                                }
-                            }
-                        }
-                        resp->tool_use = true;
-                    }
-                }
-                
-                /* Check finish_reason for tool_calls confirmation */
-                cJSON *finish = cJSON_GetObjectItem(c0, "finish_reason");
-                if (finish && cJSON_IsString(finish)) {
-                    if (strcmp(finish->valuestring, "tool_calls") == 0) {
-                        resp->tool_use = true;
-                    }
-                }
-            }
-        }
-
-        /* Anthropic format: content_block_delta / content_block_start */
-        cJSON *evt_type = cJSON_GetObjectItem(root, "type");
-        if (evt_type && cJSON_IsString(evt_type)) {
-            const char *t = evt_type->valuestring;
-
-            /* Text content: content_block_delta */
-            if (strcmp(t, "content_block_delta") == 0) {
-                cJSON *delta = cJSON_GetObjectItem(root, "delta");
-                if (delta) {
-                    cJSON *text = cJSON_GetObjectItem(delta, "text");
-                    if (text && cJSON_IsString(text)) {
-                        size_t new_len = strlen(text->valuestring);
-                        char *new_text = heap_caps_realloc(resp->text, resp->text_len + new_len + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                        if (new_text) {
-                            resp->text = new_text;
-                            memcpy(resp->text + resp->text_len, text->valuestring, new_len);
-                            resp->text_len += new_len;
-                            resp->text[resp->text_len] = '\0';
-                        }
-                    }
-                    /* Tool input JSON delta */
-                    cJSON *partial = cJSON_GetObjectItem(delta, "partial_json");
-                    if (partial && cJSON_IsString(partial) && resp->call_count > 0) {
-                        llm_tool_call_t *call = &resp->calls[resp->call_count - 1];
-                        size_t plen = strlen(partial->valuestring);
-                        size_t existing = call->input ? call->input_len : 0;
-                        char *new_input = heap_caps_realloc(call->input, existing + plen + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                        if (new_input) {
-                            call->input = new_input;
-                            memcpy(call->input + existing, partial->valuestring, plen);
-                            call->input_len += plen;
-                            call->input[call->input_len] = '\0';
-                        }
-                    }
-                }
-            }
-
-            /* Tool use start: content_block_start with type=tool_use */
-            if (strcmp(t, "content_block_start") == 0) {
-                cJSON *cb = cJSON_GetObjectItem(root, "content_block");
-                if (cb) {
-                    cJSON *cb_type = cJSON_GetObjectItem(cb, "type");
-                    if (cb_type && cJSON_IsString(cb_type) && strcmp(cb_type->valuestring, "tool_use") == 0) {
-                        resp->tool_use = true;
-                        int idx = resp->call_count;
-                        if (idx < MIMI_MAX_TOOL_CALLS) {
-                            resp->call_count = idx + 1;
-                            llm_tool_call_t *call = &resp->calls[idx];
-                            cJSON *id = cJSON_GetObjectItem(cb, "id");
-                            if (id && cJSON_IsString(id)) strncpy(call->id, id->valuestring, sizeof(call->id) - 1);
-                            cJSON *name = cJSON_GetObjectItem(cb, "name");
-                            if (name && cJSON_IsString(name)) strncpy(call->name, name->valuestring, sizeof(call->name) - 1);
-                        }
-                    }
-                }
-            }
-
-            /* Message delta with stop_reason */
-            if (strcmp(t, "message_delta") == 0) {
-                cJSON *delta = cJSON_GetObjectItem(root, "delta");
-                if (delta) {
-                    cJSON *stop = cJSON_GetObjectItem(delta, "stop_reason");
-                    if (stop && cJSON_IsString(stop) && strcmp(stop->valuestring, "tool_use") == 0) {
-                        resp->tool_use = true;
-                    }
-                }
-            }
-        }
-
-        cJSON_Delete(root);
-    }
-}
-
 /* ── Streaming Chat ─────────────────────────────────────────── */
 
 esp_err_t llm_chat_stream(const char *system_prompt,
@@ -1272,90 +1873,57 @@ esp_err_t llm_chat_stream(const char *system_prompt,
 {
     if (s_api_key[0] == '\0') return ESP_ERR_INVALID_STATE;
 
-    /* Build request body */
-    cJSON *body = cJSON_CreateObject();
-    cJSON_AddStringToObject(body, "model", s_model);
-    cJSON_AddBoolToObject(body, "stream", true); /* Enable Streaming */
-    /* Add max_tokens if needed, but streaming usually implies unlimited or large limit */
-    cJSON_AddNumberToObject(body, "max_tokens", MIMI_LLM_MAX_TOKENS);
+    char *tools_owned = NULL;
+    const char *tools = tools_for_provider(tools_json, &tools_owned);
 
-    /* Same prompt building logic as tools */
-    if (provider_uses_openai_format()) {
-        cJSON *openai_msgs = convert_messages_openai(system_prompt, messages);
-        cJSON_AddItemToObject(body, "messages", openai_msgs);
-        if (tools_json) {
-            cJSON *tools = convert_tools_openai(tools_json);
-            if (tools) {
-                cJSON_AddItemToObject(body, "tools", tools);
-                cJSON_AddStringToObject(body, "tool_choice", "auto");
-            }
-        }
-    } else {
-        cJSON_AddStringToObject(body, "system", system_prompt);
-        cJSON *msgs_copy = cJSON_Duplicate(messages, 1);
-        cJSON_AddItemToObject(body, "messages", msgs_copy);
-        if (tools_json) {
-            cJSON *tools = cJSON_Parse(tools_json);
-            if (tools) cJSON_AddItemToObject(body, "tools", tools);
-        }
-    }
-
-    char *post_data = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
-    if (!post_data) return ESP_ERR_NO_MEM;
-
-    /* Initialize contexts */
+    /* Response is assembled while bytes arrive; no full-body buffer */
     stream_ctx_t stream;
-    stream_ctx_init(&stream, on_token, ctx);
-
-    resp_buf_t rb;
-    /* Only save full response if requested (for history/tool parsing) */
-    if (resp) {
-         if (resp_buf_init(&rb, MIMI_LLM_STREAM_BUF_SIZE) != ESP_OK) {
-            free(post_data);
-            stream_ctx_free(&stream);
-            return ESP_ERR_NO_MEM;
-        }
-    } else {
-        rb.data = NULL; rb.cap = 0; rb.len = 0;
+    stream_ctx_init(&stream, on_token, ctx, resp);
+    if (!stream.buf) {
+        free(tools_owned);
+        return ESP_ERR_NO_MEM;
     }
 
+    llm_req_t req = {
+        .system_prompt = system_prompt,
+        .messages = messages,
+        .tools_json = tools,
+        .stream = true,
+    };
     int status = 0;
-    http_req_ctx_t req_ctx = { .rb = (resp ? &rb : NULL), .stream = &stream };
+    http_req_ctx_t req_ctx = { .rb = NULL, .stream = &stream };
     
     ESP_LOGI(TAG, "Starting streaming request...");
     /* Set a reasonable timeout for the entire operation if not handled by client config */
     /* The client config timeout handles connection/socket, but we should log if it takes too long */
     int64_t start_time = esp_timer_get_time();
-    esp_err_t err = llm_http_call(post_data, &req_ctx, &status);
+    esp_err_t err = llm_http_call(&req, &req_ctx, &status);
     int64_t end_time = esp_timer_get_time();
     ESP_LOGI(TAG, "Streaming request finished in %lld ms, status=%d, err=%d", (end_time - start_time) / 1000, status, err);
     
-    free(post_data);
+    free(tools_owned);
+
+    if (err == ESP_OK && status != 200) {
+        ESP_LOGE(TAG, "Stream API error %d: %s", status, stream.head);
+        err = ESP_FAIL;
+    } else if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Stream failed: %s", esp_err_to_name(err));
+    } else {
+        usage_record(&stream.usage);
+        if (resp) resp->usage = stream.usage;
+    }
     stream_ctx_free(&stream);
 
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Stream failed: %s", esp_err_to_name(err));
-        if (resp) resp_buf_free(&rb);
+        if (resp) llm_response_free(resp);
         return err;
     }
-    
-    if (status != 200) {
-        ESP_LOGE(TAG, "Stream API error: %d", status);
-        if (resp) resp_buf_free(&rb);
-        return ESP_FAIL;
-    }
 
-    /* If resp provided, parse the full accumulated buffer to extracting tool calls */
     if (resp) {
-        if (rb.data) {
-            parse_sse_response(rb.data, resp);
-        } else {
-             memset(resp, 0, sizeof(*resp));
-        }
-        resp_buf_free(&rb);
+        ESP_LOGI(TAG, "Stream response: %d bytes text, %d tool calls, stop=%s",
+                 (int)resp->text_len, resp->call_count,
+                 resp->tool_use ? "tool_use" : "end_turn");
     }
-    
     return ESP_OK;
 }
 
@@ -1396,6 +1964,7 @@ esp_err_t llm_set_provider(const char *provider)
     nvs_close(nvs);
 
     safe_copy(s_provider, sizeof(s_provider), provider);
+    conn_pool_flush();
     ESP_LOGI(TAG, "Provider set to: %s", s_provider);
     return ESP_OK;
 }
@@ -1409,6 +1978,7 @@ esp_err_t llm_set_ollama_host(const char *host)
     nvs_close(nvs);
 
     safe_copy(s_ollama_host, sizeof(s_ollama_host), host);
+    conn_pool_flush();
     ESP_LOGI(TAG, "Ollama host set to: %s", s_ollama_host);
     return ESP_OK;
 }
@@ -1422,6 +1992,7 @@ esp_err_t llm_set_ollama_port(const char *port)
     nvs_close(nvs);
 
     safe_copy(s_ollama_port, sizeof(s_ollama_port), port);
+    conn_pool_flush();
     ESP_LOGI(TAG, "Ollama port set to: %s", s_ollama_port);
     return ESP_OK;
 }
@@ -3,6 +3,7 @@
 #include "esp_err.h"
 #include "cJSON.h"
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 #include "mimi_config.h"
@@ -101,6 +102,37 @@ const char *llm_get_tts_endpoint(void);
 esp_err_t llm_chat(const char *system_prompt, const char *messages_json,
                    char *response_buf, size_t buf_size);
 
+/* ── Connection Pool ───────────────────────────────────────────── */
+
+typedef struct {
+    uint32_t hits;          /* requests served on a warm connection */
+    uint32_t misses;        /* requests that had to open a new connection */
+    uint32_t reconnects;    /* warm connections found closed and reopened */
+    uint32_t evictions;     /* idle or displaced connections closed */
+    int open;               /* connections currently held by the pool */
+} llm_conn_pool_stats_t;
+
+/**
+ * Snapshot the keep-alive connection pool counters.
+ */
+void llm_get_conn_pool_stats(llm_conn_pool_stats_t *out);
+
+/* ── Prompt Cache ──────────────────────────────────────────────── */
+
+typedef struct {
+    uint32_t requests;              /* responses that reported usage */
+    uint32_t cache_hits;            /* responses that read from the prompt cache */
+    uint64_t input_tokens;
+    uint64_t cache_write_tokens;
+    uint64_t cache_read_tokens;
+    uint64_t output_tokens;
+} llm_cache_stats_t;
+
+/**
+ * Snapshot cumulative token usage and prompt cache counters.
+ */
+void llm_get_cache_stats(llm_cache_stats_t *out);
+
 /* ── Tool Use Support ──────────────────────────────────────────── */
 
 typedef struct {
@@ -110,12 +142,23 @@ typedef struct {
     size_t input_len;
 } llm_tool_call_t;
 
+/* Token usage reported by the API. Anthropic counts cached prompt tokens
+ * separately from input_tokens; OpenAI-format cached_tokens map to
+ * cache_read_tokens. */
+typedef struct {
+    uint32_t input_tokens;                       /* uncached prompt tokens */
+    uint32_t cache_write_tokens;                 /* cache_creation_input_tokens */
+    uint32_t cache_read_tokens;                  /* cache_read_input_tokens */
+    uint32_t output_tokens;
+} llm_usage_t;
+
 typedef struct {
     char *text;                                  /* accumulated text blocks */
     size_t text_len;
     llm_tool_call_t calls[MIMI_MAX_TOOL_CALLS];
     int call_count;
     bool tool_use;                               /* stop_reason == "tool_use" */
+    llm_usage_t usage;
 } llm_response_t;
 
 void llm_response_free(llm_response_t *resp);
@@ -145,7 +188,7 @@ typedef void (*llm_stream_cb_t)(const char *token, void *ctx);
 /**
  * Set a progress status callback for HTTP event notifications.
  * The callback receives status strings like "ð å·²è¿æ¥", "ð¤ åéä¸­...", etc.
- * Set cb=NULL to clear.
+ * Set cb=NULL to clear. The callback is per calling task.
  */
 void llm_set_status_cb(llm_stream_cb_t cb, void *ctx);
 
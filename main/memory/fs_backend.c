@@ -0,0 +1,284 @@
+#include "fs_backend.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_spiffs.h"
+#if CONFIG_MIMI_FS_LITTLEFS
+#include "esp_littlefs.h"
+#endif
+
+static const char *TAG = "fs";
+
+/* ── SPIFFS ───────────────────────────────────────────────────── */
+
+static esp_err_t spiffs_mount(bool format_if_mount_failed)
+{
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = MIMI_SPIFFS_BASE,
+        .partition_label = MIMI_FS_PARTITION_LABEL,
+        .max_files = MIMI_FS_MAX_FILES,
+        .format_if_mount_failed = format_if_mount_failed,
+    };
+    return esp_vfs_spiffs_register(&conf);
+}
+
+#if CONFIG_MIMI_FS_LITTLEFS
+
+/* ── LittleFS ─────────────────────────────────────────────────── */
+
+/* A migration that could not take everything left the partition SPIFFS */
+static bool s_stayed_on_spiffs = false;
+
+static bool on_littlefs(void)
+{
+    return !s_stayed_on_spiffs;
+}
+
+static esp_err_t littlefs_mount(bool format_if_mount_failed)
+{
+    esp_vfs_littlefs_conf_t conf = {
+        .base_path = MIMI_SPIFFS_BASE,
+        .partition_label = MIMI_FS_PARTITION_LABEL,
+        .format_if_mount_failed = format_if_mount_failed,
+    };
+    return esp_vfs_littlefs_register(&conf);
+}
+
+#if CONFIG_MIMI_FS_MIGRATE_SPIFFS
+
+/* ── SPIFFS → LittleFS migration ──────────────────────────────── */
+
+/* One file held in PSRAM while the partition is reformatted */
+typedef struct fs_snap {
+    struct fs_snap *next;
+    size_t len;
+    char name[96];          /* path below MIMI_SPIFFS_BASE */
+    uint8_t data[];
+} fs_snap_t;
+
+typedef struct {
+    fs_snap_t *head;
+    fs_snap_t *tail;
+    size_t budget;
+    int files;
+    int skipped;            /* config, memory, skills: any of these aborts */
+    int sessions_skipped;   /* sessions: dropped, as chat history can be */
+    size_t bytes;
+} fs_snapshot_t;
+
+static bool is_session_file(const char *name)
+{
+    size_t n = strlen(MIMI_SPIFFS_SESSION_DIR) - strlen(MIMI_SPIFFS_BASE) - 1;
+    return strncmp(name, MIMI_SPIFFS_SESSION_DIR + strlen(MIMI_SPIFFS_BASE) + 1, n) == 0 &&
+           name[n] == '/';
+}
+
+/* Copy files into PSRAM while the budget lasts. SPIFFS is flat, so one
+ * listing of the root returns every file with its full relative name. */
+static void snapshot_pass(fs_snapshot_t *snap, bool sessions)
+{
+    DIR *dir = opendir(MIMI_SPIFFS_BASE);
+    if (!dir) return;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (is_session_file(entry->d_name) != sessions) continue;
+
+        /* Names too long for the snapshot are skipped before the path is built */
+        int *skipped = sessions ? &snap->sessions_skipped : &snap->skipped;
+        char path[128];
+        struct stat st;
+        if (strlen(entry->d_name) >= sizeof(snap->head->name) ||
+            (size_t)snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_BASE, entry->d_name) >= sizeof(path) ||
+            stat(path, &st) != 0) {
+            (*skipped)++;
+            continue;
+        }
+
+        size_t need = sizeof(fs_snap_t) + st.st_size;
+        fs_snap_t *s = (need <= snap->budget)
+                       ? heap_caps_malloc(need, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : NULL;
+        FILE *f = s ? fopen(path, "rb") : NULL;
+        if (!f || fread(s->data, 1, st.st_size, f) != (size_t)st.st_size) {
+            ESP_LOGW(TAG, "Not migrating %s (%ld bytes)", path, (long)st.st_size);
+            if (f) fclose(f);
+            free(s);
+            (*skipped)++;
+            continue;
+        }
+        fclose(f);
+
+        s->next = NULL;
+        s->len = st.st_size;
+        strcpy(s->name, entry->d_name);
+        if (snap->tail) snap->tail->next = s;
+        else snap->head = s;
+        snap->tail = s;
+        snap->budget -= need;
+        snap->files++;
+        snap->bytes += s->len;
+    }
+    closedir(dir);
+}
+
+static void snapshot_free(fs_snapshot_t *snap)
+{
+    while (snap->head) {
+        fs_snap_t *next = snap->head->next;
+        free(snap->head);
+        snap->head = next;
+    }
+    snap->tail = NULL;
+}
+
+static int snapshot_restore(const fs_snapshot_t *snap)
+{
+    int failed = 0;
+    for (const fs_snap_t *s = snap->head; s; s = s->next) {
+        char path[128];
+        snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_BASE, s->name);
+        FILE *f = fs_backend_ensure_parent(path) ? fopen(path, "wb") : NULL;
+        bool ok = f && fwrite(s->data, 1, s->len, f) == s->len;
+        if (f && fclose(f) != 0) ok = false;
+        if (!ok) {
+            ESP_LOGE(TAG, "Cannot restore %s", path);
+            failed++;
+        }
+    }
+    return failed;
+}
+
+/*
+ * Convert a partition that still holds SPIFFS. Everything but sessions is
+ * copied first, so settings, memory and skills survive even when PSRAM
+ * cannot hold the whole partition; if even those do not fit, nothing is
+ * formatted and SPIFFS stays mounted. Returns ESP_ERR_NOT_FOUND if there
+ * is no SPIFFS to migrate.
+ */
+static esp_err_t migrate_from_spiffs(void)
+{
+    if (spiffs_mount(false) != ESP_OK) return ESP_ERR_NOT_FOUND;
+
+    size_t free_psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    fs_snapshot_t snap = {
+        .budget = free_psram > MIMI_FS_MIGRATE_RESERVE ? free_psram - MIMI_FS_MIGRATE_RESERVE : 0,
+    };
+    snapshot_pass(&snap, false);
+    if (snap.skipped > 0) {
+        ESP_LOGE(TAG, "%d files do not fit in PSRAM; staying on SPIFFS", snap.skipped);
+        snapshot_free(&snap);
+        s_stayed_on_spiffs = true;
+        return ESP_OK;
+    }
+    snapshot_pass(&snap, true);
+    esp_vfs_spiffs_unregister(MIMI_FS_PARTITION_LABEL);
+    ESP_LOGW(TAG, "Migrating %d files (%u bytes) from SPIFFS to LittleFS, %d session files left behind",
+             snap.files, (unsigned)snap.bytes, snap.sessions_skipped);
+
+    esp_err_t err = esp_littlefs_format(MIMI_FS_PARTITION_LABEL);
+    if (err == ESP_OK) err = littlefs_mount(false);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "LittleFS format failed: %s", esp_err_to_name(err));
+        snapshot_free(&snap);
+        return err;
+    }
+
+    int failed = snapshot_restore(&snap);
+    snapshot_free(&snap);
+    ESP_LOGI(TAG, "Migration done (%d files failed)", failed);
+    return ESP_OK;
+}
+
+#endif /* CONFIG_MIMI_FS_MIGRATE_SPIFFS */
+
+static void ensure_dirs(void)
+{
+    const char *dirs[] = {
+        MIMI_SPIFFS_CONFIG_DIR, MIMI_SPIFFS_MEMORY_DIR,
+        MIMI_SPIFFS_SESSION_DIR, MIMI_SPIFFS_BASE "/skills",
+    };
+    for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+        mkdir(dirs[i], 0755);
+    }
+}
+
+#endif /* CONFIG_MIMI_FS_LITTLEFS */
+
+/* ── Public API ───────────────────────────────────────────────── */
+
+esp_err_t fs_backend_init(void)
+{
+    esp_err_t ret;
+#if CONFIG_MIMI_FS_LITTLEFS
+    s_stayed_on_spiffs = false;
+    ret = littlefs_mount(false);
+#if CONFIG_MIMI_FS_MIGRATE_SPIFFS
+    if (ret != ESP_OK && migrate_from_spiffs() == ESP_OK) ret = ESP_OK;
+#endif
+    if (ret != ESP_OK) ret = littlefs_mount(true);
+    if (ret == ESP_OK && on_littlefs()) ensure_dirs();
+#else
+    ret = spiffs_mount(true);
+#endif
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "%s mount failed: %s", fs_backend_name(), esp_err_to_name(ret));
+        return ret;
+    }
+
+    size_t total = 0, used = 0;
+    fs_backend_info(&total, &used);
+    ESP_LOGI(TAG, "%s: total=%d, used=%d", fs_backend_name(), (int)total, (int)used);
+    return ESP_OK;
+}
+
+esp_err_t fs_backend_info(size_t *total, size_t *used)
+{
+#if CONFIG_MIMI_FS_LITTLEFS
+    if (on_littlefs()) return esp_littlefs_info(MIMI_FS_PARTITION_LABEL, total, used);
+#endif
+    return esp_spiffs_info(MIMI_FS_PARTITION_LABEL, total, used);
+}
+
+esp_err_t fs_backend_gc(size_t bytes)
+{
+#if CONFIG_MIMI_FS_LITTLEFS
+    if (on_littlefs()) return ESP_ERR_NOT_SUPPORTED;
+#endif
+    return esp_spiffs_gc(MIMI_FS_PARTITION_LABEL, bytes);
+}
+
+bool fs_backend_ensure_parent(const char *path)
+{
+#if CONFIG_MIMI_FS_LITTLEFS
+    if (!on_littlefs()) return true;
+    char tmp[128];
+    size_t n = strlen(path);
+    if (n >= sizeof(tmp)) return false;
+    memcpy(tmp, path, n + 1);
+
+    for (size_t i = strlen(MIMI_SPIFFS_BASE) + 1; i < n; i++) {
+        if (tmp[i] != '/') continue;
+        tmp[i] = '\0';
+        if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return false;
+        tmp[i] = '/';
+    }
+#else
+    (void)path;
+#endif
+    return true;
+}
+
+const char *fs_backend_name(void)
+{
+#if CONFIG_MIMI_FS_LITTLEFS
+    if (on_littlefs()) return "littlefs";
+#endif
+    return "spiffs";
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/* ── Data partition filesystem ────────────────────────────────────
+ *
+ * The "spiffs" partition is mounted at MIMI_SPIFFS_BASE as SPIFFS or,
+ * with CONFIG_MIMI_FS_LITTLEFS, as LittleFS. Paths are the same either
+ * way; LittleFS has real directories, so writers that may create a new
+ * subdirectory call fs_backend_ensure_parent() first.
+ */
+
+/**
+ * Mount the data partition and create the standard directories. With
+ * CONFIG_MIMI_FS_MIGRATE_SPIFFS a partition that still holds SPIFFS is
+ * converted to LittleFS first.
+ */
+esp_err_t fs_backend_init(void);
+
+/**
+ * Partition size and bytes in use.
+ */
+esp_err_t fs_backend_info(size_t *total, size_t *used);
+
+/**
+ * Reclaim up to `bytes` of deleted space ahead of writers (SPIFFS only).
+ * @return ESP_ERR_NOT_SUPPORTED on backends that need no explicit GC
+ */
+esp_err_t fs_backend_gc(size_t bytes);
+
+/**
+ * Create the directories leading to a file path. No-op on SPIFFS.
+ */
+bool fs_backend_ensure_parent(const char *path);
+
+/**
+ * "spiffs" or "littlefs".
+ */
+const char *fs_backend_name(void);
@@ -0,0 +1,494 @@
+#include "kv_store.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "kv";
+
+/* ── On-flash format ──────────────────────────────────────────────
+ *
+ * Two snapshot slots and one log. A snapshot of generation G lives in
+ * slot G % 2; the log replays on top of the snapshot whose generation
+ * its header names. Compaction writes generation G + 1 into the other
+ * slot and only then starts a new log, so a reset at any point leaves
+ * either the old snapshot with its log, or the new snapshot with a log
+ * that is ignored as stale.
+ *
+ *   snapshot: snap_header_t, then `count` records
+ *   log:      log_header_t, then records until EOF or the first bad CRC
+ *   record:   rec_header_t, key bytes, value bytes
+ */
+
+#define SNAP_MAGIC      0x4E53564Bu     /* "KVSN" */
+#define LOG_MAGIC       0x474C564Bu     /* "KVLG" */
+#define VAL_TOMBSTONE   0xFFFF
+
+typedef struct {
+    uint32_t magic;
+    uint32_t gen;
+    uint32_t count;
+    uint32_t crc;               /* over magic, gen, count */
+} snap_header_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t gen;
+} log_header_t;
+
+typedef struct {
+    uint32_t crc;               /* over gen, lengths, key and value */
+    uint16_t key_len;
+    uint16_t val_len;           /* VAL_TOMBSTONE for a delete */
+} rec_header_t;
+
+typedef struct {
+    char key[KV_KEY_MAX];
+    uint16_t len;
+    uint8_t *value;             /* PSRAM */
+} kv_entry_t;
+
+static kv_entry_t s_entries[MIMI_KV_MAX_KEYS];
+static int s_count = 0;
+static SemaphoreHandle_t s_lock = NULL;
+static FILE *s_log = NULL;
+static uint32_t s_gen = 0;
+static size_t s_log_bytes = 0;
+/* The log on flash belongs to s_gen and ends on a whole record, so it can
+ * be reopened and appended to. When false the next append compacts first:
+ * a record behind a torn one, or in a log of another generation, would be
+ * dropped by the next replay. */
+static bool s_log_ok = false;
+
+static void snap_path(uint32_t gen, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s%u", MIMI_KV_SNAP_PREFIX, (unsigned)(gen & 1));
+}
+
+static uint32_t rec_crc(uint32_t gen, uint16_t key_len, uint16_t val_len,
+                        const void *key, const void *value, size_t value_bytes)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&gen, sizeof(gen));
+    crc = esp_rom_crc32_le(crc, (const uint8_t *)&key_len, sizeof(key_len));
+    crc = esp_rom_crc32_le(crc, (const uint8_t *)&val_len, sizeof(val_len));
+    crc = esp_rom_crc32_le(crc, key, key_len);
+    if (value_bytes) crc = esp_rom_crc32_le(crc, value, value_bytes);
+    return crc;
+}
+
+static uint32_t snap_crc(const snap_header_t *h)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)h, offsetof(snap_header_t, crc));
+}
+
+/* ── Table ────────────────────────────────────────────────────── */
+
+static int find(const char *key)
+{
+    for (int i = 0; i < s_count; i++) {
+        if (strcmp(s_entries[i].key, key) == 0) return i;
+    }
+    return -1;
+}
+
+static void clear_table(void)
+{
+    for (int i = 0; i < s_count; i++) free(s_entries[i].value);
+    memset(s_entries, 0, sizeof(s_entries));
+    s_count = 0;
+}
+
+/* Take ownership of `value` */
+static bool table_put(const char *key, uint8_t *value, uint16_t len)
+{
+    int i = find(key);
+    if (i < 0) {
+        if (s_count >= MIMI_KV_MAX_KEYS) return false;
+        i = s_count++;
+        strncpy(s_entries[i].key, key, KV_KEY_MAX - 1);
+    } else {
+        free(s_entries[i].value);
+    }
+    s_entries[i].value = value;
+    s_entries[i].len = len;
+    return true;
+}
+
+static void table_remove(const char *key)
+{
+    int i = find(key);
+    if (i < 0) return;
+    free(s_entries[i].value);
+    memmove(&s_entries[i], &s_entries[i + 1], (s_count - i - 1) * sizeof(kv_entry_t));
+    s_count--;
+    memset(&s_entries[s_count], 0, sizeof(kv_entry_t));
+}
+
+/* ── Records ──────────────────────────────────────────────────── */
+
+/* Read one record. With `apply` it is applied to the table; otherwise it
+ * is only checked. Returns false at EOF or on a torn or corrupt record. */
+static bool read_record(FILE *f, uint32_t gen, bool apply, size_t *bytes)
+{
+    rec_header_t h;
+    char key[KV_KEY_MAX];
+    if (fread(&h, sizeof(h), 1, f) != 1) return false;
+    if (h.key_len == 0 || h.key_len >= KV_KEY_MAX) return false;
+    if (h.val_len != VAL_TOMBSTONE && h.val_len > MIMI_KV_VALUE_MAX) return false;
+    if (fread(key, 1, h.key_len, f) != h.key_len) return false;
+    key[h.key_len] = '\0';
+
+    size_t vlen = h.val_len == VAL_TOMBSTONE ? 0 : h.val_len;
+    uint8_t *value = heap_caps_malloc(vlen ? vlen : 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!value) return false;
+    if (fread(value, 1, vlen, f) != vlen ||
+        rec_crc(gen, h.key_len, h.val_len, key, value, vlen) != h.crc) {
+        free(value);
+        return false;
+    }
+
+    if (bytes) *bytes += sizeof(h) + h.key_len + vlen;
+    if (!apply) {
+        free(value);
+    } else if (h.val_len == VAL_TOMBSTONE) {
+        free(value);
+        table_remove(key);
+    } else if (!table_put(key, value, (uint16_t)vlen)) {
+        ESP_LOGW(TAG, "Table full, dropping %s", key);
+        free(value);
+    }
+    return true;
+}
+
+static bool write_record(FILE *f, uint32_t gen, const char *key, const void *value, uint16_t val_len)
+{
+    size_t vlen = val_len == VAL_TOMBSTONE ? 0 : val_len;
+    rec_header_t h = { .key_len = (uint16_t)strlen(key), .val_len = val_len };
+    h.crc = rec_crc(gen, h.key_len, h.val_len, key, value, vlen);
+    return fwrite(&h, sizeof(h), 1, f) == 1 &&
+           fwrite(key, 1, h.key_len, f) == h.key_len &&
+           (vlen == 0 || fwrite(value, 1, vlen, f) == vlen);
+}
+
+static bool sync_file(FILE *f)
+{
+    return fflush(f) == 0 && fsync(fileno(f)) == 0;
+}
+
+/* ── Snapshot ─────────────────────────────────────────────────── */
+
+/* Check a slot end to end; every record must be intact */
+static bool snapshot_valid(uint32_t slot, uint32_t *gen)
+{
+    char path[48];
+    snap_path(slot, path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+
+    snap_header_t h;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 && h.magic == SNAP_MAGIC &&
+              h.crc == snap_crc(&h) && (h.gen & 1) == slot && h.count <= MIMI_KV_MAX_KEYS;
+    for (uint32_t i = 0; ok && i < h.count; i++) {
+        ok = read_record(f, h.gen, false, NULL);
+    }
+    fclose(f);
+    if (ok) *gen = h.gen;
+    return ok;
+}
+
+static bool snapshot_load(uint32_t gen)
+{
+    char path[48];
+    snap_path(gen, path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+
+    snap_header_t h;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1;
+    for (uint32_t i = 0; ok && i < h.count; i++) {
+        ok = read_record(f, gen, true, NULL);
+    }
+    fclose(f);
+    return ok;
+}
+
+static bool snapshot_write(uint32_t gen)
+{
+    char path[48];
+    snap_path(gen, path, sizeof(path));
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+
+    snap_header_t h = { .magic = SNAP_MAGIC, .gen = gen, .count = (uint32_t)s_count };
+    h.crc = snap_crc(&h);
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (int i = 0; ok && i < s_count; i++) {
+        ok = write_record(f, gen, s_entries[i].key, s_entries[i].value, s_entries[i].len);
+    }
+    ok = ok && sync_file(f);
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+/* ── Log ──────────────────────────────────────────────────────── */
+
+static bool log_start(uint32_t gen)
+{
+    if (s_log) fclose(s_log);
+    s_log = fopen(MIMI_KV_LOG_FILE, "wb");
+    s_log_ok = false;
+    if (!s_log) return false;
+
+    log_header_t h = { .magic = LOG_MAGIC, .gen = gen };
+    if (fwrite(&h, sizeof(h), 1, s_log) != 1 || !sync_file(s_log)) {
+        fclose(s_log);
+        s_log = NULL;
+        return false;
+    }
+    s_log_bytes = sizeof(h);
+    s_log_ok = true;
+    return true;
+}
+
+/* Replay the log for generation `gen`. Returns the bytes of intact
+ * records, and whether the file holds anything past them. */
+static size_t log_replay(uint32_t gen, bool *torn, bool *stale)
+{
+    *torn = false;
+    *stale = false;
+    FILE *f = fopen(MIMI_KV_LOG_FILE, "rb");
+    if (!f) {
+        *stale = true;
+        return 0;
+    }
+
+    log_header_t h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != LOG_MAGIC || h.gen != gen) {
+        fclose(f);
+        *stale = true;
+        return 0;
+    }
+
+    size_t bytes = sizeof(h);
+    int records = 0;
+    while (read_record(f, gen, true, &bytes)) records++;
+    *torn = fseek(f, 0, SEEK_END) != 0 || ftell(f) > (long)bytes;
+    fclose(f);
+    if (records) ESP_LOGI(TAG, "Replayed %d log records", records);
+    return bytes;
+}
+
+static esp_err_t compact_locked(void)
+{
+    uint32_t gen = s_gen + 1;
+    if (!snapshot_write(gen)) {
+        ESP_LOGE(TAG, "Snapshot write failed");
+        return ESP_FAIL;
+    }
+    /* The new snapshot is now authoritative; the old log is stale */
+    s_gen = gen;
+    if (!log_start(gen)) {
+        ESP_LOGE(TAG, "Cannot start log");
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Compacted %d keys into generation %u", s_count, (unsigned)gen);
+    return ESP_OK;
+}
+
+static esp_err_t append_locked(const char *key, const void *value, uint16_t val_len)
+{
+    if (!s_log && !s_log_ok) {
+        /* The table holds every committed change; fold it into a fresh
+         * snapshot and log rather than append where replay cannot reach */
+        ESP_LOGW(TAG, "Log unusable, compacting before %s", key);
+        if (compact_locked() != ESP_OK) return ESP_FAIL;
+    }
+    if (!s_log) {
+        s_log = fopen(MIMI_KV_LOG_FILE, "ab");
+        if (!s_log) return ESP_FAIL;
+    }
+    if (!write_record(s_log, s_gen, key, value, val_len) || !sync_file(s_log)) {
+        ESP_LOGE(TAG, "Log append failed for %s", key);
+        /* Whatever part reached flash fails its CRC and would hide any
+         * record written after it; the next append starts a new log */
+        fclose(s_log);
+        s_log = NULL;
+        s_log_ok = false;
+        return ESP_FAIL;
+    }
+    s_log_bytes += sizeof(rec_header_t) + strlen(key) + (val_len == VAL_TOMBSTONE ? 0 : val_len);
+    return ESP_OK;
+}
+
+/* ── Public API ───────────────────────────────────────────────── */
+
+esp_err_t kv_store_init(void)
+{
+    if (s_lock) return ESP_OK;
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) return ESP_ERR_NO_MEM;
+
+    uint32_t gen0 = 0, gen1 = 0;
+    bool ok0 = snapshot_valid(0, &gen0);
+    bool ok1 = snapshot_valid(1, &gen1);
+    s_gen = 0;
+    if (ok0 || ok1) {
+        s_gen = (ok0 && (!ok1 || gen0 > gen1)) ? gen0 : gen1;
+        if (!snapshot_load(s_gen)) {
+            clear_table();
+            ESP_LOGE(TAG, "Snapshot %u unreadable", (unsigned)s_gen);
+        }
+    }
+
+    bool torn, stale;
+    s_log_bytes = log_replay(s_gen, &torn, &stale);
+    s_log_ok = !torn && !stale;
+    ESP_LOGI(TAG, "Loaded %d keys (generation %u, log %u bytes)",
+             s_count, (unsigned)s_gen, (unsigned)s_log_bytes);
+
+    /* A torn tail would hide later appends from the next replay */
+    if (torn) {
+        ESP_LOGW(TAG, "Log ends in a partial record, compacting");
+        return compact_locked() == ESP_OK ? ESP_OK : ESP_FAIL;
+    }
+    if (stale) return log_start(s_gen) ? ESP_OK : ESP_FAIL;
+    if (s_log_bytes > MIMI_KV_LOG_COMPACT_BYTES) return compact_locked();
+
+    s_log = fopen(MIMI_KV_LOG_FILE, "ab");
+    return s_log ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t kv_store_set(const char *key, const void *value, size_t len)
+{
+    if (!key || !key[0] || strlen(key) >= KV_KEY_MAX || len > MIMI_KV_VALUE_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!s_lock) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find(key);
+    if (i >= 0 && s_entries[i].len == len && memcmp(s_entries[i].value, value, len) == 0) {
+        xSemaphoreGive(s_lock);
+        return ESP_OK;
+    }
+    if (i < 0 && s_count >= MIMI_KV_MAX_KEYS) {
+        xSemaphoreGive(s_lock);
+        ESP_LOGE(TAG, "Table full, cannot store %s", key);
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint8_t *copy = heap_caps_malloc(len ? len : 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!copy) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(copy, value, len);
+
+    /* Commit to flash first; the table only changes once it is durable */
+    esp_err_t err = append_locked(key, copy, (uint16_t)len);
+    if (err == ESP_OK) {
+        table_put(key, copy, (uint16_t)len);
+        if (s_log_bytes > MIMI_KV_LOG_COMPACT_BYTES) compact_locked();
+    } else {
+        free(copy);
+    }
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+esp_err_t kv_store_set_str(const char *key, const char *value)
+{
+    return kv_store_set(key, value, strlen(value));
+}
+
+esp_err_t kv_store_delete(const char *key)
+{
+    if (!key || strlen(key) >= KV_KEY_MAX) return ESP_ERR_INVALID_SIZE;
+    if (!s_lock) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = ESP_OK;
+    if (find(key) >= 0) {
+        err = append_locked(key, NULL, VAL_TOMBSTONE);
+        if (err == ESP_OK) {
+            table_remove(key);
+            if (s_log_bytes > MIMI_KV_LOG_COMPACT_BYTES) compact_locked();
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+int kv_store_get(const char *key, void *buf, size_t size)
+{
+    if (!s_lock || !key) return -1;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find(key);
+    int len = -1;
+    if (i >= 0) {
+        len = s_entries[i].len;
+        memcpy(buf, s_entries[i].value, (size_t)len < size ? (size_t)len : size);
+    }
+    xSemaphoreGive(s_lock);
+    return len;
+}
+
+char *kv_store_get_str(const char *key)
+{
+    if (!s_lock || !key) return NULL;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find(key);
+    char *str = NULL;
+    if (i >= 0) {
+        str = malloc(s_entries[i].len + 1);
+        if (str) {
+            memcpy(str, s_entries[i].value, s_entries[i].len);
+            str[s_entries[i].len] = '\0';
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return str;
+}
+
+void kv_store_foreach(const char *prefix, kv_store_iter_fn fn, void *arg)
+{
+    if (!s_lock) return;
+    size_t plen = strlen(prefix);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < s_count; i++) {
+        if (strncmp(s_entries[i].key, prefix, plen) != 0) continue;
+        if (!fn(s_entries[i].key, s_entries[i].value, s_entries[i].len, arg)) break;
+    }
+    xSemaphoreGive(s_lock);
+}
+
+bool kv_store_has_prefix(const char *prefix)
+{
+    if (!s_lock) return false;
+    size_t plen = strlen(prefix);
+    bool found = false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < s_count && !found; i++) {
+        found = strncmp(s_entries[i].key, prefix, plen) == 0;
+    }
+    xSemaphoreGive(s_lock);
+    return found;
+}
+
+esp_err_t kv_store_compact(void)
+{
+    if (!s_lock) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = compact_locked();
+    xSemaphoreGive(s_lock);
+    return err;
+}
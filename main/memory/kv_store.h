@@ -0,0 +1,72 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/* ── Journaled key/value store ────────────────────────────────────
+ *
+ * Small settings records (cron jobs, MCP sources, skill quotas,
+ * component switches) kept in RAM and persisted as an append-only log of
+ * changes on top of a compacted snapshot. Each record carries a CRC, so a
+ * write cut short by a reset is dropped on replay instead of corrupting
+ * the store. Setting a key to the value it already holds writes nothing.
+ *
+ * Keys are namespaced by their owner, e.g. "cron/1a2b3c4d".
+ */
+
+#define KV_KEY_MAX  48              /* including the terminating NUL */
+
+/**
+ * Load the newest valid snapshot and replay the log on top. Call once
+ * after the filesystem is mounted.
+ */
+esp_err_t kv_store_init(void);
+
+/**
+ * Store a value. Journaled with fsync before returning.
+ * @return ESP_ERR_INVALID_SIZE if the key or value is too long,
+ *         ESP_ERR_NO_MEM if the table is full
+ */
+esp_err_t kv_store_set(const char *key, const void *value, size_t len);
+
+/**
+ * Store a NUL-terminated string (without the NUL).
+ */
+esp_err_t kv_store_set_str(const char *key, const char *value);
+
+/**
+ * Remove a key. Removing a missing key writes nothing.
+ */
+esp_err_t kv_store_delete(const char *key);
+
+/**
+ * Copy a value out.
+ * @return Value length (may exceed `size`, the copy is truncated), or -1 if missing
+ */
+int kv_store_get(const char *key, void *buf, size_t size);
+
+/**
+ * Copy a value out as a string.
+ * @return malloc'd NUL-terminated copy, or NULL if missing
+ */
+char *kv_store_get_str(const char *key);
+
+/**
+ * Visit the keys starting with `prefix`, in insertion order. The callback
+ * runs under the store lock and must not call back into the store.
+ * Return false from it to stop.
+ */
+typedef bool (*kv_store_iter_fn)(const char *key, const void *value, size_t len, void *arg);
+void kv_store_foreach(const char *prefix, kv_store_iter_fn fn, void *arg);
+
+/**
+ * True if any key starts with `prefix`.
+ */
+bool kv_store_has_prefix(const char *prefix);
+
+/**
+ * Fold the log into a fresh snapshot now. Runs by itself once the log
+ * outgrows MIMI_KV_LOG_COMPACT_BYTES.
+ */
+esp_err_t kv_store_compact(void);
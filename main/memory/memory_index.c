@@ -0,0 +1,863 @@
+#include "memory_index.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "mem_index";
+
+/* ── On-flash layout ──────────────────────────────────────────────
+ *
+ * One little-endian file, every section 4-byte aligned so it can be read
+ * with plain seeks or mapped in place:
+ *
+ *   header
+ *   docs[doc_count]            source files and their chunk ranges
+ *   chunks[chunk_count]        byte range and token count per chunk
+ *   terms[term_count]          sorted by hash: first posting, df
+ *   postings[posting_count]    (chunk, tf), grouped by term
+ *
+ * Terms are kept as 32-bit hashes only. A query binary-searches the term
+ * table on flash and streams the postings it needs; RAM holds the chunk
+ * table and one score per chunk.
+ */
+
+#define INDEX_MAGIC         0x5844494Du     /* "MIDX" */
+#define INDEX_VERSION       1
+#define DOC_NAME_LEN        40
+#define NO_CHUNK            0xFFFF
+#define MAX_QUERY_TERMS     32
+#define MAX_HITS            16
+#define MAX_DIRTY           8
+#define POSTING_BLOCK       64
+#define BM25_K1             1.2f
+#define BM25_B              0.75f
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t doc_count;
+    uint32_t chunk_count;
+    uint32_t term_count;
+    uint32_t posting_count;
+    uint32_t total_tokens;
+    uint32_t docs_off;
+    uint32_t chunks_off;
+    uint32_t terms_off;
+    uint32_t postings_off;
+} idx_header_t;
+
+typedef struct {
+    char name[DOC_NAME_LEN];    /* relative to MIMI_SPIFFS_MEMORY_DIR */
+    uint32_t mtime;
+    uint32_t size;
+    uint16_t first_chunk;
+    uint16_t chunk_count;
+} idx_doc_t;
+
+typedef struct {
+    uint32_t offset;
+    uint16_t len;
+    uint16_t doc;
+    uint16_t tokens;
+    uint16_t reserved;
+} idx_chunk_t;
+
+typedef struct {
+    uint32_t hash;
+    uint32_t first;
+    uint32_t df;
+} idx_term_t;
+
+typedef struct {
+    uint16_t chunk;
+    uint16_t tf;
+} idx_posting_t;
+
+_Static_assert(sizeof(idx_header_t) % 4 == 0, "header alignment");
+_Static_assert(sizeof(idx_doc_t) % 4 == 0, "doc alignment");
+_Static_assert(sizeof(idx_chunk_t) == 12, "chunk layout");
+_Static_assert(sizeof(idx_term_t) == 12, "term layout");
+_Static_assert(sizeof(idx_posting_t) == 4, "posting layout");
+_Static_assert(sizeof(((memory_hit_t *)0)->name) == DOC_NAME_LEN, "hit name length");
+
+static SemaphoreHandle_t s_lock = NULL;
+static portMUX_TYPE s_dirty_mux = portMUX_INITIALIZER_UNLOCKED;
+static bool s_dirty_all = false;            /* reindex everything, trust no mtime */
+static bool s_dirty_any = true;
+static char s_dirty[MAX_DIRTY][DOC_NAME_LEN];
+static int s_dirty_count = 0;
+static int64_t s_last_check_us = 0;
+
+static void *psram_malloc(size_t size)
+{
+    return heap_caps_malloc(size ? size : 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+}
+
+/* ── Tokenizer ────────────────────────────────────────────────── */
+
+#define FNV_OFFSET  2166136261u
+#define FNV_PRIME   16777619u
+#define CJK_START   0x2E80          /* CJK radicals onwards: no spaces between words */
+#define WORD_HASH_MAX 32            /* longer words hash their first 32 bytes */
+
+static const char *const s_stopwords[] = {
+    "an", "and", "are", "as", "at", "be", "by", "for", "from", "has", "in",
+    "is", "it", "its", "of", "on", "or", "that", "the", "this", "to", "was",
+    "were", "will", "with",
+};
+
+static inline uint32_t fnv_step(uint32_t h, uint8_t c)
+{
+    return (h ^ c) * FNV_PRIME;
+}
+
+static int utf8_len(uint8_t c)
+{
+    if (c < 0x80) return 1;
+    if ((c >> 5) == 0x6) return 2;
+    if ((c >> 4) == 0xE) return 3;
+    if ((c >> 3) == 0x1E) return 4;
+    return 1;   /* stray continuation byte */
+}
+
+static uint32_t utf8_cp(const uint8_t *s, int n)
+{
+    if (n == 1) return s[0];
+    uint32_t cp = s[0] & (0x7F >> n);
+    for (int i = 1; i < n; i++) cp = (cp << 6) | (s[i] & 0x3F);
+    return cp;
+}
+
+/* Drop a multi-byte sequence cut off at the end of buf[0..n) */
+static size_t utf8_trim(const char *buf, size_t n)
+{
+    for (size_t back = 1; back <= 4 && back <= n; back++) {
+        uint8_t c = (uint8_t)buf[n - back];
+        if ((c & 0xC0) == 0x80) continue;           /* continuation byte */
+        return (size_t)utf8_len(c) > back ? n - back : n;
+    }
+    return n;
+}
+
+static bool is_word_byte(uint8_t c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool is_stopword(const char *w, size_t n)
+{
+    for (size_t i = 0; i < sizeof(s_stopwords) / sizeof(s_stopwords[0]); i++) {
+        if (strlen(s_stopwords[i]) == n && memcmp(s_stopwords[i], w, n) == 0) return true;
+    }
+    return false;
+}
+
+static uint32_t hash_bytes(const uint8_t *s, size_t n)
+{
+    uint32_t h = FNV_OFFSET;
+    for (size_t i = 0; i < n; i++) h = fnv_step(h, s[i]);
+    return h;
+}
+
+/* Split text into term hashes: lowercased words of two or more bytes
+ * (accented letters included), and overlapping bigrams of CJK characters,
+ * or the character itself when it stands alone, so Chinese and Japanese
+ * notes are searchable without a dictionary. */
+static int tokenize(const char *text, size_t len, uint32_t *out, int max)
+{
+    const uint8_t *s = (const uint8_t *)text;
+    size_t i = 0;
+    int n = 0;
+
+    while (i < len && n < max) {
+        int cl = utf8_len(s[i]);
+        if (i + cl > len) break;
+
+        if (cl > 1 && utf8_cp(s + i, cl) >= CJK_START) {
+            size_t prev = i;
+            int prev_len = cl;
+            int run = 1;
+            i += cl;
+            while (i < len && n < max) {
+                int l = utf8_len(s[i]);
+                if (l == 1 || i + l > len || utf8_cp(s + i, l) < CJK_START) break;
+                out[n++] = hash_bytes(s + prev, i + l - prev);
+                prev = i;
+                prev_len = l;
+                i += l;
+                run++;
+            }
+            if (run == 1 && n < max) out[n++] = hash_bytes(s + prev, prev_len);
+            continue;
+        }
+
+        if (cl > 1 || is_word_byte(s[i])) {
+            uint32_t h = FNV_OFFSET;
+            char head[8];
+            size_t wl = 0;
+            while (i < len) {
+                int l = utf8_len(s[i]);
+                if (i + l > len) break;
+                if (l == 1 ? !is_word_byte(s[i]) : utf8_cp(s + i, l) >= CJK_START) break;
+                for (int k = 0; k < l; k++, wl++) {
+                    uint8_t c = s[i + k];
+                    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+                    if (wl < WORD_HASH_MAX) h = fnv_step(h, c);
+                    if (wl < sizeof(head)) head[wl] = (char)c;
+                }
+                i += l;
+            }
+            if (wl >= 2 && !(wl < sizeof(head) && is_stopword(head, wl))) out[n++] = h;
+            continue;
+        }
+        i++;
+    }
+    return n;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* ── Builder ──────────────────────────────────────────────────── */
+
+typedef struct {
+    uint32_t hash;
+    uint16_t chunk;
+    uint16_t tf;
+} triple_t;
+
+typedef struct {
+    idx_doc_t *docs;
+    int doc_count;
+    idx_chunk_t *chunks;
+    int chunk_count;
+    triple_t *triples;
+    size_t triple_count;
+    size_t triple_cap;
+    uint32_t total_tokens;
+    uint32_t *toks;             /* scratch for one chunk */
+    bool truncated;
+} builder_t;
+
+static bool add_triple(builder_t *b, uint32_t hash, uint16_t chunk, uint16_t tf)
+{
+    if (b->triple_count == b->triple_cap) {
+        size_t cap = b->triple_cap ? b->triple_cap * 2 : 1024;
+        if (cap > MIMI_MEMORY_INDEX_MAX_POSTINGS) cap = MIMI_MEMORY_INDEX_MAX_POSTINGS;
+        triple_t *t = cap > b->triple_cap
+                      ? heap_caps_realloc(b->triples, cap * sizeof(triple_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+                      : NULL;
+        if (!t) {
+            b->truncated = true;
+            return false;
+        }
+        b->triples = t;
+        b->triple_cap = cap;
+    }
+    b->triples[b->triple_count++] = (triple_t){ .hash = hash, .chunk = chunk, .tf = tf };
+    return true;
+}
+
+static void add_chunk(builder_t *b, uint16_t doc, const char *text, size_t start, size_t end)
+{
+    size_t i = start;
+    while (i < end && (text[i] == ' ' || text[i] == '\t' || text[i] == '\r' || text[i] == '\n')) i++;
+    if (i == end) return;
+    if (b->chunk_count >= MIMI_MEMORY_INDEX_MAX_CHUNKS) {
+        b->truncated = true;
+        return;
+    }
+
+    uint16_t id = (uint16_t)b->chunk_count++;
+    int n = tokenize(text + start, end - start, b->toks, MIMI_MEMORY_CHUNK_MAX);
+    b->chunks[id] = (idx_chunk_t){
+        .offset = (uint32_t)start, .len = (uint16_t)(end - start),
+        .doc = doc, .tokens = (uint16_t)n,
+    };
+    b->total_tokens += n;
+
+    qsort(b->toks, n, sizeof(uint32_t), cmp_u32);
+    for (int k = 0; k < n;) {
+        int run = 1;
+        while (k + run < n && b->toks[k + run] == b->toks[k]) run++;
+        if (!add_triple(b, b->toks[k], id, (uint16_t)run)) return;
+        k += run;
+    }
+}
+
+/* Chunks end at blank lines and before headings; paragraphs longer than
+ * MIMI_MEMORY_CHUNK_MAX are cut on a character boundary. */
+static void index_text(builder_t *b, uint16_t doc, const char *text, size_t len)
+{
+    size_t start = 0;
+    size_t pos = 0;
+    while (pos < len) {
+        size_t eol = pos;
+        while (eol < len && text[eol] != '\n') eol++;
+        size_t next = eol < len ? eol + 1 : len;
+
+        bool blank = true;
+        for (size_t k = pos; k < eol && blank; k++) {
+            blank = (text[k] == ' ' || text[k] == '\t' || text[k] == '\r');
+        }
+
+        if (blank) {
+            add_chunk(b, doc, text, start, pos);
+            start = next;
+        } else if (pos > start && (text[pos] == '#' || next - start > MIMI_MEMORY_CHUNK_MAX)) {
+            add_chunk(b, doc, text, start, pos);
+            start = pos;
+        }
+        while (next - start > MIMI_MEMORY_CHUNK_MAX) {
+            size_t cut = start + MIMI_MEMORY_CHUNK_MAX;
+            while (cut > start && ((uint8_t)text[cut] & 0xC0) == 0x80) cut--;
+            add_chunk(b, doc, text, start, cut);
+            start = cut;
+        }
+        pos = next;
+    }
+    add_chunk(b, doc, text, start, len);
+}
+
+static void index_file(builder_t *b, uint16_t doc, const char *name)
+{
+    char path[96];
+    snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_MEMORY_DIR, name);
+    FILE *f = fopen(path, "r");
+    if (!f) return;
+
+    size_t size = b->docs[doc].size;
+    if (size > MIMI_MEMORY_INDEX_FILE_MAX) {
+        ESP_LOGW(TAG, "%s: indexing first %d of %u bytes", name, MIMI_MEMORY_INDEX_FILE_MAX, (unsigned)size);
+        size = MIMI_MEMORY_INDEX_FILE_MAX;
+    }
+    char *text = psram_malloc(size);
+    if (text) {
+        size = fread(text, 1, size, f);
+        index_text(b, doc, text, size);
+        free(text);
+    }
+    fclose(f);
+}
+
+static int cmp_triple(const void *a, const void *b)
+{
+    const triple_t *x = a, *y = b;
+    if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    return (int)x->chunk - (int)y->chunk;
+}
+
+static bool write_index(const builder_t *b)
+{
+    uint32_t term_count = 0;
+    for (size_t i = 0; i < b->triple_count; i++) {
+        if (i == 0 || b->triples[i].hash != b->triples[i - 1].hash) term_count++;
+    }
+
+    idx_header_t h = {
+        .magic = INDEX_MAGIC,
+        .version = INDEX_VERSION,
+        .doc_count = (uint16_t)b->doc_count,
+        .chunk_count = (uint32_t)b->chunk_count,
+        .term_count = term_count,
+        .posting_count = (uint32_t)b->triple_count,
+        .total_tokens = b->total_tokens,
+    };
+    h.docs_off = sizeof(h);
+    h.chunks_off = h.docs_off + b->doc_count * sizeof(idx_doc_t);
+    h.terms_off = h.chunks_off + b->chunk_count * sizeof(idx_chunk_t);
+    h.postings_off = h.terms_off + term_count * sizeof(idx_term_t);
+
+    const char *tmp = MIMI_MEMORY_INDEX_FILE ".tmp";
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return false;
+
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+              fwrite(b->docs, sizeof(idx_doc_t), b->doc_count, f) == (size_t)b->doc_count &&
+              fwrite(b->chunks, sizeof(idx_chunk_t), b->chunk_count, f) == (size_t)b->chunk_count;
+
+    for (size_t i = 0; ok && i < b->triple_count;) {
+        idx_term_t t = { .hash = b->triples[i].hash, .first = (uint32_t)i };
+        while (i < b->triple_count && b->triples[i].hash == t.hash) i++;
+        t.df = (uint32_t)i - t.first;
+        ok = fwrite(&t, sizeof(t), 1, f) == 1;
+    }
+    for (size_t i = 0; ok && i < b->triple_count; i++) {
+        idx_posting_t p = { .chunk = b->triples[i].chunk, .tf = b->triples[i].tf };
+        ok = fwrite(&p, sizeof(p), 1, f) == 1;
+    }
+
+    if (fclose(f) != 0) ok = false;
+    remove(MIMI_MEMORY_INDEX_FILE);
+    if (!ok || rename(tmp, MIMI_MEMORY_INDEX_FILE) != 0) {
+        remove(tmp);
+        return false;
+    }
+    return true;
+}
+
+/* ── Old index ────────────────────────────────────────────────── */
+
+static bool read_header(FILE *f, idx_header_t *h)
+{
+    struct stat st;
+    if (fseek(f, 0, SEEK_SET) != 0 || fread(h, sizeof(*h), 1, f) != 1) return false;
+    if (h->magic != INDEX_MAGIC || h->version != INDEX_VERSION) return false;
+    if (fstat(fileno(f), &st) != 0) return false;
+    return h->docs_off == sizeof(*h) &&
+           h->chunks_off == h->docs_off + h->doc_count * sizeof(idx_doc_t) &&
+           h->terms_off == h->chunks_off + h->chunk_count * sizeof(idx_chunk_t) &&
+           h->postings_off == h->terms_off + h->term_count * sizeof(idx_term_t) &&
+           h->postings_off + (size_t)h->posting_count * sizeof(idx_posting_t) == (size_t)st.st_size;
+}
+
+static void *read_section(FILE *f, uint32_t off, size_t count, size_t elem)
+{
+    void *p = psram_malloc(count * elem);
+    if (p && (fseek(f, off, SEEK_SET) != 0 || fread(p, elem, count, f) != count)) {
+        free(p);
+        p = NULL;
+    }
+    return p;
+}
+
+/* Carry the postings of unchanged chunks over, renumbered. Postings are
+ * stored in term order, so one sequential read covers them all. */
+static bool carry_postings(builder_t *b, FILE *old, const idx_header_t *oh, const uint16_t *remap)
+{
+    idx_term_t *terms = read_section(old, oh->terms_off, oh->term_count, sizeof(idx_term_t));
+    if (!terms) return false;
+    if (fseek(old, oh->postings_off, SEEK_SET) != 0) {
+        free(terms);
+        return false;
+    }
+
+    idx_posting_t block[POSTING_BLOCK];
+    bool ok = true;
+    for (uint32_t t = 0; ok && t < oh->term_count; t++) {
+        for (uint32_t left = terms[t].df; ok && left > 0;) {
+            size_t n = left < POSTING_BLOCK ? left : POSTING_BLOCK;
+            ok = fread(block, sizeof(idx_posting_t), n, old) == n;
+            for (size_t k = 0; ok && k < n; k++) {
+                if (block[k].chunk >= oh->chunk_count || remap[block[k].chunk] == NO_CHUNK) continue;
+                if (!add_triple(b, terms[t].hash, remap[block[k].chunk], block[k].tf)) break;
+            }
+            left -= n;
+        }
+    }
+    free(terms);
+    return ok;
+}
+
+/* ── Sync ─────────────────────────────────────────────────────── */
+
+typedef struct {
+    char name[DOC_NAME_LEN];
+    uint32_t mtime;
+    uint32_t size;
+    int old;                    /* row in the old doc table, -1 = tokenize */
+} doc_stat_t;
+
+static bool has_md_suffix(const char *name)
+{
+    size_t n = strlen(name);
+    return n > 3 && strcmp(name + n - 3, ".md") == 0;
+}
+
+/* SPIFFS lists "daily/x.md" as one entry; LittleFS has a real "daily"
+ * directory, which is descended into once. */
+static int scan_dir(const char *dir_path, const char *prefix, doc_stat_t *out, int n, int depth)
+{
+    DIR *dir = opendir(dir_path);
+    if (!dir) return n;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && n < MIMI_MEMORY_INDEX_MAX_DOCS) {
+        if (entry->d_name[0] == '.') continue;
+
+        /* A name too long for the doc table could not be indexed anyway */
+        char path[128];
+        char name[DOC_NAME_LEN];
+        if ((size_t)snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name) >= sizeof(path) ||
+            (size_t)snprintf(name, sizeof(name), "%s%s", prefix, entry->d_name) >= sizeof(name)) {
+            continue;
+        }
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+
+        if (S_ISDIR(st.st_mode)) {
+            char sub[DOC_NAME_LEN];
+            if (depth == 0 &&
+                (size_t)snprintf(sub, sizeof(sub), "%s/", entry->d_name) < sizeof(sub)) {
+                n = scan_dir(path, sub, out, n, depth + 1);
+            }
+            continue;
+        }
+        if (!has_md_suffix(name)) continue;
+
+        memset(&out[n], 0, sizeof(out[n]));
+        strcpy(out[n].name, name);
+        out[n].mtime = (uint32_t)st.st_mtime;
+        out[n].size = (uint32_t)st.st_size;
+        out[n].old = -1;
+        n++;
+    }
+    closedir(dir);
+    return n;
+}
+
+static int cmp_doc_stat(const void *a, const void *b)
+{
+    return strcmp(((const doc_stat_t *)a)->name, ((const doc_stat_t *)b)->name);
+}
+
+static bool name_dirty(const char names[][DOC_NAME_LEN], int count, const char *name)
+{
+    for (int i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0) return true;
+    }
+    return false;
+}
+
+static esp_err_t sync_locked(void)
+{
+    int64_t now = esp_timer_get_time();
+
+    char dirty[MAX_DIRTY][DOC_NAME_LEN];
+    portENTER_CRITICAL(&s_dirty_mux);
+    bool any = s_dirty_any;
+    bool all = s_dirty_all;
+    int dirty_count = s_dirty_count;
+    memcpy(dirty, s_dirty, sizeof(dirty));
+    s_dirty_any = false;
+    s_dirty_all = false;
+    s_dirty_count = 0;
+    portEXIT_CRITICAL(&s_dirty_mux);
+
+    /* Without a reported write, rescan only as often as the prompt
+     * sources are revalidated, for writers that bypass the hooks */
+    if (!any && now - s_last_check_us < (int64_t)MIMI_CONTEXT_REVALIDATE_MS * 1000) return ESP_OK;
+    s_last_check_us = now;
+
+    doc_stat_t *cur = psram_malloc(MIMI_MEMORY_INDEX_MAX_DOCS * sizeof(doc_stat_t));
+    if (!cur) return ESP_ERR_NO_MEM;
+    int cur_count = scan_dir(MIMI_SPIFFS_MEMORY_DIR, "", cur, 0, 0);
+    qsort(cur, cur_count, sizeof(doc_stat_t), cmp_doc_stat);
+
+    /* Match against the old index: same name, mtime and size, and no
+     * write reported since, means the old chunks can be reused */
+    idx_header_t oh = {0};
+    idx_doc_t *odocs = NULL;
+    FILE *old = fopen(MIMI_MEMORY_INDEX_FILE, "rb");
+    if (old && read_header(old, &oh)) {
+        odocs = read_section(old, oh.docs_off, oh.doc_count, sizeof(idx_doc_t));
+    }
+    int reused = 0;
+    for (int i = 0; odocs && !all && i < cur_count; i++) {
+        if (name_dirty(dirty, dirty_count, cur[i].name)) continue;
+        for (int k = 0; k < oh.doc_count; k++) {
+            if (strncmp(odocs[k].name, cur[i].name, DOC_NAME_LEN) == 0) {
+                if (odocs[k].mtime == cur[i].mtime && odocs[k].size == cur[i].size) {
+                    cur[i].old = k;
+                    reused++;
+                }
+                break;
+            }
+        }
+    }
+    if (odocs && reused == cur_count && cur_count == oh.doc_count) {
+        free(odocs);
+        fclose(old);
+        free(cur);
+        return ESP_OK;
+    }
+
+    builder_t b = {0};
+    b.docs = psram_malloc(MIMI_MEMORY_INDEX_MAX_DOCS * sizeof(idx_doc_t));
+    b.chunks = psram_malloc(MIMI_MEMORY_INDEX_MAX_CHUNKS * sizeof(idx_chunk_t));
+    b.toks = psram_malloc(MIMI_MEMORY_CHUNK_MAX * sizeof(uint32_t));
+    idx_chunk_t *ochunks = reused ? read_section(old, oh.chunks_off, oh.chunk_count, sizeof(idx_chunk_t)) : NULL;
+    uint16_t *remap = reused ? psram_malloc(oh.chunk_count * sizeof(uint16_t)) : NULL;
+    esp_err_t err = ESP_OK;
+    if (!b.docs || !b.chunks || !b.toks || (reused && (!ochunks || !remap))) {
+        err = ESP_ERR_NO_MEM;
+        goto done;
+    }
+    if (remap) memset(remap, 0xFF, oh.chunk_count * sizeof(uint16_t));
+
+    for (int i = 0; i < cur_count; i++) {
+        idx_doc_t *d = &b.docs[b.doc_count];
+        memset(d, 0, sizeof(*d));
+        memcpy(d->name, cur[i].name, DOC_NAME_LEN);
+        d->mtime = cur[i].mtime;
+        d->size = cur[i].size;
+        d->first_chunk = (uint16_t)b.chunk_count;
+        uint16_t id = (uint16_t)b.doc_count++;
+
+        if (cur[i].old >= 0) {
+            const idx_doc_t *od = &odocs[cur[i].old];
+            for (uint32_t c = od->first_chunk; c < (uint32_t)od->first_chunk + od->chunk_count &&
+                 c < oh.chunk_count; c++) {
+                if (b.chunk_count >= MIMI_MEMORY_INDEX_MAX_CHUNKS) {
+                    b.truncated = true;
+                    break;
+                }
+                remap[c] = (uint16_t)b.chunk_count;
+                b.chunks[b.chunk_count] = ochunks[c];
+                b.chunks[b.chunk_count].doc = id;
+                b.total_tokens += ochunks[c].tokens;
+                b.chunk_count++;
+            }
+        } else {
+            index_file(&b, id, cur[i].name);
+        }
+        d->chunk_count = (uint16_t)(b.chunk_count - d->first_chunk);
+    }
+
+    if (reused && !carry_postings(&b, old, &oh, remap)) {
+        err = ESP_FAIL;
+        goto done;
+    }
+    if (old) {
+        fclose(old);
+        old = NULL;
+    }
+
+    qsort(b.triples, b.triple_count, sizeof(triple_t), cmp_triple);
+    if (!write_index(&b)) {
+        ESP_LOGE(TAG, "Cannot write %s", MIMI_MEMORY_INDEX_FILE);
+        err = ESP_FAIL;
+        goto done;
+    }
+    if (b.truncated) ESP_LOGW(TAG, "Index full, some memory text is not searchable");
+    ESP_LOGI(TAG, "Indexed %d files (%d reused), %d chunks, %u postings in %lld ms",
+             b.doc_count, reused, b.chunk_count, (unsigned)b.triple_count,
+             (long long)((esp_timer_get_time() - now) / 1000));
+
+done:
+    if (err != ESP_OK) {
+        /* Try again on the next search */
+        portENTER_CRITICAL(&s_dirty_mux);
+        s_dirty_any = true;
+        s_dirty_all |= all;
+        portEXIT_CRITICAL(&s_dirty_mux);
+    }
+    if (old) fclose(old);
+    free(remap);
+    free(ochunks);
+    free(odocs);
+    free(b.triples);
+    free(b.toks);
+    free(b.chunks);
+    free(b.docs);
+    free(cur);
+    return err;
+}
+
+/* ── Search ───────────────────────────────────────────────────── */
+
+static bool find_term(FILE *f, const idx_header_t *h, uint32_t hash, idx_term_t *out)
+{
+    uint32_t lo = 0, hi = h->term_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (fseek(f, h->terms_off + mid * sizeof(idx_term_t), SEEK_SET) != 0 ||
+            fread(out, sizeof(*out), 1, f) != 1) {
+            return false;
+        }
+        if (out->hash == hash) return true;
+        if (out->hash < hash) lo = mid + 1;
+        else hi = mid;
+    }
+    return false;
+}
+
+static int search_locked(const char *query, memory_hit_t *hits, int max_hits)
+{
+    uint32_t q[MAX_QUERY_TERMS];
+    int nq = tokenize(query, strlen(query), q, MAX_QUERY_TERMS);
+    qsort(q, nq, sizeof(uint32_t), cmp_u32);
+    int uq = 0;
+    for (int i = 0; i < nq; i++) {
+        if (uq == 0 || q[uq - 1] != q[i]) q[uq++] = q[i];
+    }
+    if (uq == 0 || max_hits <= 0) return 0;
+
+    FILE *f = fopen(MIMI_MEMORY_INDEX_FILE, "rb");
+    if (!f) return 0;
+    idx_header_t h;
+    int found = 0;
+    idx_chunk_t *chunks = NULL;
+    float *scores = NULL;
+    if (!read_header(f, &h) || h.chunk_count == 0) goto out;
+
+    chunks = read_section(f, h.chunks_off, h.chunk_count, sizeof(idx_chunk_t));
+    scores = psram_malloc(h.chunk_count * sizeof(float));
+    if (!chunks || !scores) goto out;
+    memset(scores, 0, h.chunk_count * sizeof(float));
+
+    const float n_chunks = (float)h.chunk_count;
+    const float avgdl = h.total_tokens ? (float)h.total_tokens / n_chunks : 1.0f;
+    idx_posting_t block[POSTING_BLOCK];
+
+    for (int i = 0; i < uq; i++) {
+        idx_term_t t;
+        if (!find_term(f, &h, q[i], &t) || t.first + t.df > h.posting_count) continue;
+
+        float idf = logf(1.0f + (n_chunks - t.df + 0.5f) / (t.df + 0.5f));
+        if (fseek(f, h.postings_off + t.first * sizeof(idx_posting_t), SEEK_SET) != 0) continue;
+        for (uint32_t left = t.df; left > 0;) {
+            size_t n = left < POSTING_BLOCK ? left : POSTING_BLOCK;
+            if (fread(block, sizeof(idx_posting_t), n, f) != n) break;
+            for (size_t k = 0; k < n; k++) {
+                uint16_t c = block[k].chunk;
+                if (c >= h.chunk_count) continue;
+                float tf = block[k].tf;
+                float norm = BM25_K1 * (1.0f - BM25_B + BM25_B * chunks[c].tokens / avgdl);
+                scores[c] += idf * tf * (BM25_K1 + 1.0f) / (tf + norm);
+            }
+            left -= n;
+        }
+    }
+
+    /* Keep the best max_hits, sorted by insertion */
+    uint32_t top[MAX_HITS];
+    if (max_hits > MAX_HITS) max_hits = MAX_HITS;
+    for (uint32_t c = 0; c < h.chunk_count; c++) {
+        if (scores[c] <= 0.0f) continue;
+        if (found == max_hits && scores[c] <= scores[top[found - 1]]) continue;
+        int pos = found < max_hits ? found++ : found - 1;
+        while (pos > 0 && scores[top[pos - 1]] < scores[c]) {
+            top[pos] = top[pos - 1];
+            pos--;
+        }
+        top[pos] = c;
+    }
+
+    for (int i = 0; i < found; i++) {
+        const idx_chunk_t *c = &chunks[top[i]];
+        hits[i] = (memory_hit_t){ .offset = c->offset, .len = c->len, .score = scores[top[i]] };
+        idx_doc_t d;
+        if (c->doc < h.doc_count &&
+            fseek(f, h.docs_off + c->doc * sizeof(idx_doc_t), SEEK_SET) == 0 &&
+            fread(&d, sizeof(d), 1, f) == 1) {
+            memcpy(hits[i].name, d.name, DOC_NAME_LEN);
+            hits[i].name[DOC_NAME_LEN - 1] = '\0';
+        }
+    }
+
+out:
+    free(scores);
+    free(chunks);
+    fclose(f);
+    return found;
+}
+
+/* ── Public API ───────────────────────────────────────────────── */
+
+esp_err_t memory_index_init(void)
+{
+    if (s_lock) return ESP_OK;
+    s_lock = xSemaphoreCreateMutex();
+    return s_lock ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void memory_index_note_write(const char *path)
+{
+    size_t dir_len = strlen(MIMI_SPIFFS_MEMORY_DIR);
+    if (!path || strncmp(path, MIMI_SPIFFS_MEMORY_DIR, dir_len) != 0 || path[dir_len] != '/') return;
+    const char *name = path + dir_len + 1;
+
+    portENTER_CRITICAL(&s_dirty_mux);
+    s_dirty_any = true;
+    if (!name_dirty(s_dirty, s_dirty_count, name)) {
+        if (s_dirty_count < MAX_DIRTY && strlen(name) < DOC_NAME_LEN) {
+            strcpy(s_dirty[s_dirty_count++], name);
+        } else {
+            s_dirty_all = true;
+        }
+    }
+    portEXIT_CRITICAL(&s_dirty_mux);
+}
+
+esp_err_t memory_index_sync(void)
+{
+    if (!s_lock && memory_index_init() != ESP_OK) return ESP_ERR_NO_MEM;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = sync_locked();
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+int memory_index_search(const char *query, memory_hit_t *hits, int max_hits)
+{
+    if (!query) return 0;
+    if (!s_lock && memory_index_init() != ESP_OK) return 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    sync_locked();
+    int found = search_locked(query, hits, max_hits);
+    xSemaphoreGive(s_lock);
+    return found;
+}
+
+size_t memory_index_read_hit(const memory_hit_t *hit, char *buf, size_t size)
+{
+    if (size == 0) return 0;
+    buf[0] = '\0';
+
+    char path[96];
+    snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_MEMORY_DIR, hit->name);
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    size_t want = hit->len < size - 1 ? hit->len : size - 1;
+    size_t n = fseek(f, (long)hit->offset, SEEK_SET) == 0 ? fread(buf, 1, want, f) : 0;
+    fclose(f);
+
+    /* Do not end inside a UTF-8 sequence when cut short */
+    if (n < hit->len) n = utf8_trim(buf, n);
+    while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == '\r' || buf[n - 1] == ' ')) n--;
+    buf[n] = '\0';
+    return n;
+}
+
+char *memory_index_recall(const char *query, size_t budget)
+{
+    memory_hit_t hits[MIMI_MEMORY_RECALL_TOP_K];
+    int found = memory_index_search(query, hits, MIMI_MEMORY_RECALL_TOP_K);
+    if (found == 0 || budget < 64) return NULL;
+
+    char *out = psram_malloc(budget);
+    if (!out) return NULL;
+
+    size_t off = 0;
+    for (int i = 0; i < found; i++) {
+        int head = snprintf(out + off, budget - off, "[%s]\n", hits[i].name);
+        if (head < 0 || off + head + 32 >= budget) break;
+        size_t n = memory_index_read_hit(&hits[i], out + off + head, budget - off - head - 1);
+        if (n == 0) continue;
+        off += head + n;
+        out[off++] = '\n';
+        out[off] = '\0';
+    }
+    if (off == 0) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+
+/* ── Long-term memory index ───────────────────────────────────────
+ *
+ * BM25 over the markdown files in MIMI_SPIFFS_MEMORY_DIR (MEMORY.md and
+ * every daily note), split into paragraph-sized chunks. The inverted
+ * index lives on flash in MIMI_MEMORY_INDEX_FILE and is searched with
+ * seeks, so RAM use does not grow with the vocabulary. Writers report
+ * changes through memory_note_write(); the next search re-tokenizes only
+ * the files that changed and carries the other postings over.
+ */
+
+typedef struct {
+    char name[40];          /* file name below MIMI_SPIFFS_MEMORY_DIR */
+    size_t offset;          /* chunk byte range in that file */
+    size_t len;
+    float score;
+} memory_hit_t;
+
+/**
+ * Create the index lock. The index itself is built on the first search.
+ */
+esp_err_t memory_index_init(void);
+
+/**
+ * Mark a memory file as changed. Called by memory_note_write().
+ */
+void memory_index_note_write(const char *path);
+
+/**
+ * Bring the index up to date with the memory directory.
+ */
+esp_err_t memory_index_sync(void);
+
+/**
+ * Rank chunks against a free-text query.
+ * @return Number of hits written, best first (0 when nothing matches)
+ */
+int memory_index_search(const char *query, memory_hit_t *hits, int max_hits);
+
+/**
+ * Read the text of a hit from its source file.
+ * @return Bytes written to buf, NUL-terminated
+ */
+size_t memory_index_read_hit(const memory_hit_t *hit, char *buf, size_t size);
+
+/**
+ * The top MIMI_MEMORY_RECALL_TOP_K snippets for a query, formatted for
+ * the model and cut to `budget` bytes.
+ * @return PSRAM string the caller must free(), or NULL when nothing matches
+ */
+char *memory_index_recall(const char *query, size_t budget);
@@ -1,4 +1,5 @@
 #include "memory_store.h"
+#include "memory_index.h"
 #include "mimi_config.h"
 
 #include <stdio.h>
@@ -9,6 +10,8 @@
 
 static const char *TAG = "memory";
 
+static uint32_t s_dirty = 0;
+
 static void get_date_str(char *buf, size_t size, int days_ago)
 {
     time_t now;
@@ -24,7 +27,11 @@ esp_err_t memory_store_init(void)
     /* SPIFFS is flat — no real directory creation needed.
        Just verify we can open the base path. */
     ESP_LOGI(TAG, "Memory store initialized at %s", MIMI_SPIFFS_BASE);
+#if CONFIG_MIMI_ENABLE_MEMORY_INDEX
+    return memory_index_init();
+#else
     return ESP_OK;
+#endif
 }
 
 esp_err_t memory_read_long_term(char *buf, size_t size)
@@ -50,6 +57,7 @@ esp_err_t memory_write_long_term(const char *content)
     }
     fputs(content, f);
     fclose(f);
+    memory_note_write(MIMI_MEMORY_FILE);
     ESP_LOGI(TAG, "Long-term memory updated (%d bytes)", (int)strlen(content));
     return ESP_OK;
 }
@@ -75,6 +83,7 @@ esp_err_t memory_append_today(const char *note)
 
     fprintf(f, "%s\n", note);
     fclose(f);
+    memory_note_write(path);
     return ESP_OK;
 }
 
@@ -105,3 +114,30 @@ esp_err_t memory_read_recent(char *buf, size_t size, int days)
 
     return ESP_OK;
 }
+
+void memory_note_write(const char *path)
+{
+    if (!path) return;
+
+    uint32_t src = 0;
+    size_t dir_len = strlen(MIMI_SPIFFS_MEMORY_DIR);
+    if (strcmp(path, MIMI_SOUL_FILE) == 0) {
+        src = MEMORY_SRC_SOUL;
+    } else if (strcmp(path, MIMI_USER_FILE) == 0) {
+        src = MEMORY_SRC_USER;
+    } else if (strcmp(path, MIMI_MEMORY_FILE) == 0) {
+        src = MEMORY_SRC_LONG;
+    } else if (strncmp(path, MIMI_SPIFFS_MEMORY_DIR, dir_len) == 0 && path[dir_len] == '/') {
+        src = MEMORY_SRC_DAILY;
+    }
+
+    if (src) __atomic_fetch_or(&s_dirty, src, __ATOMIC_RELEASE);
+#if CONFIG_MIMI_ENABLE_MEMORY_INDEX
+    if (src & (MEMORY_SRC_LONG | MEMORY_SRC_DAILY)) memory_index_note_write(path);
+#endif
+}
+
+uint32_t memory_take_dirty(void)
+{
+    return __atomic_exchange_n(&s_dirty, 0, __ATOMIC_ACQUIRE);
+}
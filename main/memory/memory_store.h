@@ -2,6 +2,7 @@
 
 #include "esp_err.h"
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * Initialize memory store. Ensures SPIFFS directories exist.
@@ -29,3 +30,23 @@ esp_err_t memory_append_today(const char *note);
  * @param days  Number of days to look back (default 3)
  */
 esp_err_t memory_read_recent(char *buf, size_t size, int days);
+
+/* ── Change tracking ───────────────────────────────────────────
+ * Files that feed the system prompt. Writers call memory_note_write()
+ * so the context builder can refresh only what changed. */
+
+#define MEMORY_SRC_SOUL     (1u << 0)
+#define MEMORY_SRC_USER     (1u << 1)
+#define MEMORY_SRC_LONG     (1u << 2)
+#define MEMORY_SRC_DAILY    (1u << 3)
+
+/**
+ * Record that a file was written. Paths that feed the system prompt mark
+ * their source dirty; other paths are ignored.
+ */
+void memory_note_write(const char *path);
+
+/**
+ * Return the dirty source mask (MEMORY_SRC_*) and clear it.
+ */
+uint32_t memory_take_dirty(void);
@@ -1,117 +1,1078 @@
 #include "session_mgr.h"
+#include "session_record.h"
 #include "mimi_config.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <dirent.h>
 #include <time.h>
+#include <sys/stat.h>
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "cJSON.h"
 
 static const char *TAG = "session";
 
+/* ── Storage layout ───────────────────────────────────────────────
+ *
+ * <chat_id>.jsonl  append-only log, one JSON record per line (unchanged
+ *                  format, so old sessions stay readable)
+ * <chat_id>.bin    with CONFIG_MIMI_ENABLE_SESSION_TRANSCRIPTS: append-only
+ *                  log of session_record payloads, each framed as
+ *                  REC_MAGIC + u32 length; replaces the JSONL log, which
+ *                  is converted on first use
+ * <chat_id>.idx    sidecar index: one session_idx_entry_t per record
+ * <chat_id>.sum    rolling summary of the records before "upto", written
+ *                  by history compaction: {"upto":N,"summary":"..."}
+ *
+ * The index covers the log up to the end of its last entry. A log that
+ * grew past that (legacy file, crash between the two appends) is indexed
+ * by scanning only the uncovered tail; a log shorter than the index means
+ * it was replaced, and the index is rebuilt. History loads read the last
+ * N index entries and seek straight to those records.
+ */
+
+#if CONFIG_MIMI_ENABLE_SESSION_TRANSCRIPTS
+#define SESSION_TRANSCRIPTS 1
+#define SESSION_LOG_EXT     ".bin"
+#define REC_MAGIC           0xB5
+#define REC_HEAD            5       /* magic + u32 length before the payload */
+#define REC_TAIL            0
+#else
+#define SESSION_TRANSCRIPTS 0
+#define SESSION_LOG_EXT     ".jsonl"
+#define REC_HEAD            0
+#define REC_TAIL            1       /* newline after the payload */
+#endif
+
+typedef struct {
+    uint32_t off;       /* payload start in the log */
+    uint32_t len;       /* payload length, without framing */
+} session_idx_entry_t;
+
+/* Parsed history of a hot session, ready for the LLM serializer */
+typedef struct {
+    char chat_id[32];
+    cJSON *msgs;            /* [{"role","content"},...], whole turns, at most
+                             * MIMI_SESSION_MAX_MSGS unless the newest turn is longer;
+                             * content is a string or, for tool turns, a block array.
+                             * A record that could not be read is a JSON null, so
+                             * msgs[i] is always record seq_end - count + i */
+    uint32_t seq_end;       /* record number after the last message */
+    char *summary;          /* rolling summary of records before summary_upto */
+    uint32_t summary_upto;
+    uint32_t compact_upto;  /* window start when compaction was requested */
+    bool compact_requested;
+    size_t bytes;           /* approximate PSRAM footprint */
+    uint32_t last_used;
+} session_cache_t;
+
+/* Record waiting for the write-behind flush */
+typedef struct pending_rec {
+    struct pending_rec *next;
+    char chat_id[32];
+    size_t len;
+    char data[];            /* JSON line or binary payload, per SESSION_LOG_EXT */
+} pending_rec_t;
+
+#define SCAN_CHUNK  1024
+
+/* The newest turn stays cached whole even when it alone passes
+ * MIMI_SESSION_MAX_MSGS */
+#define CACHE_MAX_MSGS  (MIMI_SESSION_TURN_MAX_MSGS > MIMI_SESSION_MAX_MSGS ? \
+                         MIMI_SESSION_TURN_MAX_MSGS : MIMI_SESSION_MAX_MSGS)
+
+static SemaphoreHandle_t s_lock = NULL;
+static SemaphoreHandle_t s_flush_wake = NULL;
+static session_cache_t s_cache[MIMI_SESSION_CACHE_SLOTS];
+static size_t s_cache_bytes = 0;
+static uint32_t s_tick = 0;
+static pending_rec_t *s_pending_head = NULL;
+static pending_rec_t *s_pending_tail = NULL;
+static session_cache_stats_t s_stats = {0};
+
 static void session_path(const char *chat_id, char *buf, size_t size)
 {
-    snprintf(buf, size, "%s/%s.jsonl", MIMI_SPIFFS_SESSION_DIR, chat_id);
+    snprintf(buf, size, "%s/%s" SESSION_LOG_EXT, MIMI_SPIFFS_SESSION_DIR, chat_id);
 }
 
-esp_err_t session_mgr_init(void)
+static void index_path(const char *chat_id, char *buf, size_t size)
 {
-    ESP_LOGI(TAG, "Session manager initialized at %s", MIMI_SPIFFS_SESSION_DIR);
-    return ESP_OK;
+    snprintf(buf, size, "%s/%s.idx", MIMI_SPIFFS_SESSION_DIR, chat_id);
 }
 
-esp_err_t session_append(const char *chat_id, const char *role, const char *content)
+static void summary_path(const char *chat_id, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s/%s.sum", MIMI_SPIFFS_SESSION_DIR, chat_id);
+}
+
+static void summary_tmp_path(const char *chat_id, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s/%s.tmp", MIMI_SPIFFS_SESSION_DIR, chat_id);
+}
+
+static long file_size(const char *path)
+{
+    struct stat st;
+    return (stat(path, &st) == 0) ? (long)st.st_size : -1;
+}
+
+/* ── Sidecar index ────────────────────────────────────────────── */
+
+#if SESSION_TRANSCRIPTS
+/* Index framed records starting at `from`, appending entries to idx.
+ * Stops at a torn or foreign record; *end is where the next one goes. */
+static uint32_t index_scan(FILE *log, FILE *idx, uint32_t from, uint32_t size, uint32_t *end)
+{
+    uint32_t pos = from;
+    uint32_t added = 0;
+    uint8_t head[REC_HEAD];
+
+    while (size - pos >= REC_HEAD) {
+        if (fseek(log, pos, SEEK_SET) != 0 || fread(head, 1, REC_HEAD, log) != REC_HEAD) break;
+        uint32_t len = head[1] | (head[2] << 8) | (head[3] << 16) | ((uint32_t)head[4] << 24);
+        if (head[0] != REC_MAGIC || len == 0 || len > size - pos - REC_HEAD) break;
+
+        session_idx_entry_t e = { .off = pos + REC_HEAD, .len = len };
+        fwrite(&e, sizeof(e), 1, idx);
+        added++;
+        pos += REC_HEAD + len;
+    }
+    /* Appends overwrite anything past this point */
+    *end = pos;
+    return added;
+}
+#else
+/* Index log records starting at `from`, appending entries to idx */
+static uint32_t index_scan(FILE *log, FILE *idx, uint32_t from, uint32_t size, uint32_t *end)
+{
+    (void)size;
+    char chunk[SCAN_CHUNK];
+    uint32_t pos = from;
+    uint32_t start = from;
+    uint32_t added = 0;
+
+    if (fseek(log, from, SEEK_SET) != 0) return 0;
+
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), log)) > 0) {
+        for (size_t i = 0; i < n; i++, pos++) {
+            if (chunk[i] != '\n') continue;
+            if (pos > start) {
+                session_idx_entry_t e = { .off = start, .len = pos - start };
+                fwrite(&e, sizeof(e), 1, idx);
+                added++;
+            }
+            start = pos + 1;
+        }
+    }
+    /* A final record without newline is torn; the next append writes
+     * over it */
+    *end = start;
+    return added;
+}
+#endif
+
+/*
+ * Make the index cover the whole log. Returns the number of records, or
+ * -1 if the log does not exist. Leaves the index positioned for appends
+ * when out_idx is given; out_end receives the end of the last record.
+ */
+static int index_sync(const char *chat_id, long log_size, FILE **out_idx, uint32_t *out_end)
+{
+    char ipath[64];
+    index_path(chat_id, ipath, sizeof(ipath));
+
+    if (out_idx) *out_idx = NULL;
+    if (log_size < 0) {
+        remove(ipath);
+        return -1;
+    }
+
+    uint32_t covered = 0;
+    long isize = file_size(ipath);
+    int count = (isize > 0) ? (int)(isize / sizeof(session_idx_entry_t)) : 0;
+
+    FILE *idx = NULL;
+    if (count > 0) {
+        idx = fopen(ipath, "r+b");
+        session_idx_entry_t last;
+        if (idx && fseek(idx, (long)(count - 1) * sizeof(last), SEEK_SET) == 0 &&
+            fread(&last, sizeof(last), 1, idx) == 1) {
+            covered = last.off + last.len + REC_TAIL;
+        }
+        if (!idx || covered == 0 || covered > (uint32_t)log_size ||
+            isize % sizeof(session_idx_entry_t) != 0) {
+            /* Log was replaced or index is damaged: rebuild */
+            ESP_LOGW(TAG, "Rebuilding index for %s", chat_id);
+            if (idx) fclose(idx);
+            idx = NULL;
+            count = 0;
+            covered = 0;
+        }
+    }
+    if (!idx) {
+        idx = fopen(ipath, "w+b");
+        if (!idx) {
+            ESP_LOGE(TAG, "Cannot open index %s", ipath);
+            return -1;
+        }
+    }
+    fseek(idx, (long)count * sizeof(session_idx_entry_t), SEEK_SET);
+
+    if (covered < (uint32_t)log_size) {
+        char path[64];
+        session_path(chat_id, path, sizeof(path));
+        FILE *log = fopen(path, "rb");
+        if (log) {
+            uint32_t added = index_scan(log, idx, covered, (uint32_t)log_size, &covered);
+            fclose(log);
+            if (added > 0) {
+                ESP_LOGI(TAG, "Indexed %u records of %s from offset %u",
+                         (unsigned)added, chat_id, (unsigned)covered);
+            }
+            count += added;
+        }
+    }
+
+    if (out_end) *out_end = covered;
+    if (out_idx) {
+        *out_idx = idx;
+    } else {
+        fclose(idx);
+    }
+    return count;
+}
+
+
+/* Append one record to the log and its index. Caller holds s_lock. */
+static esp_err_t log_write(const char *chat_id, const char *data, size_t len)
 {
     char path[64];
     session_path(chat_id, path, sizeof(path));
 
-    FILE *f = fopen(path, "a");
+    /* Bring the index up to date first, so the new entry lands right
+     * after the records it already covers */
+    FILE *idx = NULL;
+    long log_size = file_size(path);
+    if (log_size < 0) log_size = 0;
+    /* Without an index, append at the end rather than guess */
+    uint32_t end = (uint32_t)log_size;
+    index_sync(chat_id, log_size, &idx, &end);
+
+    /* Write at the end of the last good record, over any torn tail:
+     * appended after it, the record would be lost with the tail */
+    FILE *f = fopen(path, log_size > 0 ? "r+b" : "wb");
+    if (f && fseek(f, end, SEEK_SET) != 0) {
+        fclose(f);
+        f = NULL;
+    }
     if (!f) {
         ESP_LOGE(TAG, "Cannot open session file %s", path);
+        if (idx) fclose(idx);
         return ESP_FAIL;
     }
 
-    cJSON *obj = cJSON_CreateObject();
-    cJSON_AddStringToObject(obj, "role", role);
-    cJSON_AddStringToObject(obj, "content", content);
-    cJSON_AddNumberToObject(obj, "ts", (double)time(NULL));
+#if SESSION_TRANSCRIPTS
+    uint8_t head[REC_HEAD] = { REC_MAGIC, len & 0xFF, (len >> 8) & 0xFF,
+                               (len >> 16) & 0xFF, (len >> 24) & 0xFF };
+    session_idx_entry_t e = { .off = end + REC_HEAD, .len = (uint32_t)len };
+    bool ok = fwrite(head, 1, REC_HEAD, f) == REC_HEAD && fwrite(data, 1, len, f) == len;
+#else
+    session_idx_entry_t e = { .off = end, .len = (uint32_t)len };
+    bool ok = fwrite(data, 1, len, f) == len && fputc('\n', f) != EOF;
+#endif
+    fclose(f);
+
+    if (ok && idx) {
+        fwrite(&e, sizeof(e), 1, idx);
+    }
+    if (idx) fclose(idx);
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+/* ── Records ──────────────────────────────────────────────────── */
 
+/* Serialize a {"role","content"} message in the log's format */
+static pending_rec_t *record_build(const char *chat_id, const cJSON *msg, uint32_t ts)
+{
+#if SESSION_TRANSCRIPTS
+    size_t len = session_record_encode(msg, ts, NULL, 0);
+    if (len == 0) return NULL;
+    pending_rec_t *rec = heap_caps_malloc(sizeof(pending_rec_t) + len + 1,
+                                          MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!rec) return NULL;
+    session_record_encode(msg, ts, (uint8_t *)rec->data, len);
+#else
+    cJSON *obj = cJSON_Duplicate(msg, true);
+    if (!obj) return NULL;
+    cJSON_AddNumberToObject(obj, "ts", (double)ts);
     char *line = cJSON_PrintUnformatted(obj);
     cJSON_Delete(obj);
+    if (!line) return NULL;
 
-    if (line) {
-        fprintf(f, "%s\n", line);
+    size_t len = strlen(line);
+    pending_rec_t *rec = heap_caps_malloc(sizeof(pending_rec_t) + len + 1,
+                                          MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!rec) {
         free(line);
+        return NULL;
     }
+    memcpy(rec->data, line, len);
+    free(line);
+#endif
+    rec->data[len] = '\0';
+    rec->next = NULL;
+    memset(rec->chat_id, 0, sizeof(rec->chat_id));
+    strncpy(rec->chat_id, chat_id, sizeof(rec->chat_id) - 1);
+    rec->len = len;
+    return rec;
+}
 
-    fclose(f);
-    return ESP_OK;
+/* Parse a stored record back into a {"role","content"} message */
+static cJSON *record_parse(const char *data, size_t len)
+{
+#if SESSION_TRANSCRIPTS
+    return session_record_decode((const uint8_t *)data, len);
+#else
+    cJSON *src = cJSON_ParseWithLength(data, len);
+    const char *role = cJSON_GetStringValue(cJSON_GetObjectItem(src, "role"));
+    cJSON *content = cJSON_GetObjectItem(src, "content");
+    cJSON *msg = NULL;
+    if (role && (cJSON_IsString(content) || cJSON_IsArray(content))) {
+        msg = cJSON_CreateObject();
+        cJSON_AddStringToObject(msg, "role", role);
+        cJSON_AddItemToObject(msg, "content", cJSON_DetachItemFromObject(src, "content"));
+    }
+    cJSON_Delete(src);
+    return msg;
+#endif
 }
 
-esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size, int max_msgs)
+#if SESSION_TRANSCRIPTS
+/*
+ * Convert a JSONL session left over from text-only mode into the binary
+ * log. The JSONL file is removed only after every record has been
+ * copied, so while it exists the import is (re)done from scratch.
+ * Caller holds s_lock.
+ */
+static void legacy_import(const char *chat_id)
 {
+    char jpath[64];
+    snprintf(jpath, sizeof(jpath), "%s/%s.jsonl", MIMI_SPIFFS_SESSION_DIR, chat_id);
+    FILE *in = fopen(jpath, "rb");
+    if (!in) return;
+
     char path[64];
+    char ipath[64];
     session_path(chat_id, path, sizeof(path));
+    index_path(chat_id, ipath, sizeof(ipath));
+    remove(path);
+    remove(ipath);
 
-    FILE *f = fopen(path, "r");
-    if (!f) {
-        /* No history yet */
-        snprintf(buf, size, "[]");
-        return ESP_OK;
+    size_t cap = SCAN_CHUNK;
+    char *line = heap_caps_malloc(cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    int imported = 0;
+    bool ok = line != NULL;
+
+    while (ok && fgets(line, cap, in)) {
+        size_t len = strlen(line);
+        /* Grow the buffer for records longer than one read */
+        while (len == cap - 1 && line[len - 1] != '\n') {
+            char *bigger = heap_caps_realloc(line, cap * 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            if (!bigger) {
+                ok = false;
+                break;
+            }
+            line = bigger;
+            cap *= 2;
+            if (!fgets(line + len, cap - len, in)) break;
+            len += strlen(line + len);
+        }
+        if (!ok) break;
+
+        /* The encoder reads only role and content, so the parsed line
+         * serves as the message */
+        cJSON *src = cJSON_Parse(line);
+        cJSON *ts = cJSON_GetObjectItem(src, "ts");
+        pending_rec_t *rec = src ? record_build(chat_id, src, cJSON_IsNumber(ts) ? (uint32_t)ts->valuedouble : 0) : NULL;
+        cJSON_Delete(src);
+        if (!rec) continue;
+        if (log_write(chat_id, rec->data, rec->len) == ESP_OK) {
+            imported++;
+        } else {
+            ok = false;
+        }
+        free(rec);
     }
+    free(line);
+    fclose(in);
 
-    /* Read all lines into a ring buffer of cJSON objects */
-    cJSON *messages[MIMI_SESSION_MAX_MSGS];
-    int count = 0;
-    int write_idx = 0;
+    if (ok) {
+        remove(jpath);
+        ESP_LOGI(TAG, "Converted %d records of %s to transcript format", imported, chat_id);
+    } else {
+        ESP_LOGE(TAG, "Converting %s failed, will retry", chat_id);
+    }
+}
+#endif
 
-    char line[2048];
-    while (fgets(line, sizeof(line), f)) {
-        /* Strip newline */
-        size_t len = strlen(line);
-        if (len > 0 && line[len - 1] == '\n') line[len - 1] = '\0';
-        if (line[0] == '\0') continue;
+static esp_err_t log_append(const char *chat_id, const char *data, size_t len)
+{
+#if SESSION_TRANSCRIPTS
+    legacy_import(chat_id);
+#endif
+    return log_write(chat_id, data, len);
+}
 
-        cJSON *obj = cJSON_Parse(line);
-        if (!obj) continue;
+/* ── Write-behind ─────────────────────────────────────────────── */
 
-        /* Ring buffer: overwrite oldest if full */
-        if (count >= max_msgs) {
-            cJSON_Delete(messages[write_idx]);
+/* Write every pending record. Caller holds s_lock. */
+static void pending_flush_locked(void)
+{
+    if (!s_pending_head) return;
+
+    int written = 0;
+    while (s_pending_head) {
+        pending_rec_t *rec = s_pending_head;
+        s_pending_head = rec->next;
+        if (log_append(rec->chat_id, rec->data, rec->len) == ESP_OK) {
+            written++;
+        } else {
+            s_stats.write_errors++;
         }
-        messages[write_idx] = obj;
-        write_idx = (write_idx + 1) % max_msgs;
-        if (count < max_msgs) count++;
+        s_stats.pending--;
+        free(rec);
     }
-    fclose(f);
+    s_pending_tail = NULL;
+    s_stats.flushes++;
+    ESP_LOGD(TAG, "Flushed %d session records", written);
+}
 
-    /* Build JSON array with only role + content */
-    cJSON *arr = cJSON_CreateArray();
-    int start = (count < max_msgs) ? 0 : write_idx;
-    for (int i = 0; i < count; i++) {
-        int idx = (start + i) % max_msgs;
-        cJSON *src = messages[idx];
+static bool pending_has(const char *chat_id)
+{
+    for (pending_rec_t *rec = s_pending_head; rec; rec = rec->next) {
+        if (strcmp(rec->chat_id, chat_id) == 0) return true;
+    }
+    return false;
+}
+
+static int pending_drop(const char *chat_id)
+{
+    int dropped = 0;
+    pending_rec_t **pp = &s_pending_head;
+    s_pending_tail = NULL;
+    while (*pp) {
+        pending_rec_t *rec = *pp;
+        if (strcmp(rec->chat_id, chat_id) == 0) {
+            *pp = rec->next;
+            s_stats.pending--;
+            free(rec);
+            dropped++;
+        } else {
+            s_pending_tail = rec;
+            pp = &rec->next;
+        }
+    }
+    return dropped;
+}
+
+static void session_flush_task(void *arg)
+{
+    while (1) {
+        xSemaphoreTake(s_flush_wake, portMAX_DELAY);
+        /* Let the rest of the turn (assistant reply) join the batch */
+        vTaskDelay(pdMS_TO_TICKS(MIMI_SESSION_FLUSH_MS));
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        pending_flush_locked();
+        xSemaphoreGive(s_lock);
+    }
+}
+
+/* ── History cache ────────────────────────────────────────────── */
+
+/* Approximate heap footprint of a parsed message */
+static size_t msg_cost(const cJSON *item)
+{
+    size_t cost = sizeof(cJSON);
+    if (item->string) cost += strlen(item->string) + 1;
+    if (item->valuestring) cost += strlen(item->valuestring) + 1;
+    for (const cJSON *child = item->child; child; child = child->next) {
+        cost += msg_cost(child);
+    }
+    return cost;
+}
+
+/* Rough token count of a message: ~4 bytes per token for ASCII text, one
+ * token per multibyte character (CJK, emoji), plus per-message framing */
+static int estimate_text_tokens(const char *s)
+{
+    int ascii = 0;
+    int wide = 0;
+    for (; *s; s++) {
+        unsigned char ch = (unsigned char)*s;
+        if (ch < 0x80) {
+            ascii++;
+        } else if (ch >= 0xC0) {
+            wide++;
+        }
+    }
+    return (ascii + 3) / 4 + wide;
+}
+
+static int estimate_tokens(const cJSON *item)
+{
+    int tokens = item->valuestring ? estimate_text_tokens(item->valuestring) : 0;
+    if (cJSON_IsNumber(item)) tokens++;
+    for (const cJSON *child = item->child; child; child = child->next) {
+        tokens += estimate_tokens(child);
+    }
+    return tokens;
+}
+
+#define MSG_FRAMING_TOKENS  4
+
+static int message_tokens(const cJSON *msg)
+{
+    if (cJSON_IsNull(msg)) return 0;
+    return estimate_tokens(cJSON_GetObjectItem(msg, "content")) + MSG_FRAMING_TOKENS;
+}
+
+/* History handed to the LLM must open with a user turn, never with a
+ * tool_result whose tool_use was trimmed away */
+static bool turn_start(const cJSON *msg)
+{
+    const char *role = cJSON_GetStringValue(cJSON_GetObjectItem(msg, "role"));
+    if (!role || strcmp(role, "user") != 0) return false;
+
+    const cJSON *content = cJSON_GetObjectItem(msg, "content");
+    const cJSON *block;
+    cJSON_ArrayForEach(block, content) {
+        const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(block, "type"));
+        if (type && strcmp(type, "tool_result") == 0) return false;
+    }
+    return true;
+}
+
+static session_cache_t *cache_find(const char *chat_id)
+{
+    for (int i = 0; i < MIMI_SESSION_CACHE_SLOTS; i++) {
+        if (s_cache[i].msgs && strcmp(s_cache[i].chat_id, chat_id) == 0) {
+            s_cache[i].last_used = ++s_tick;
+            return &s_cache[i];
+        }
+    }
+    return NULL;
+}
 
-        cJSON *entry = cJSON_CreateObject();
-        cJSON *role = cJSON_GetObjectItem(src, "role");
-        cJSON *content = cJSON_GetObjectItem(src, "content");
-        if (role && content) {
-            cJSON_AddStringToObject(entry, "role", role->valuestring);
-            cJSON_AddStringToObject(entry, "content", content->valuestring);
+static void cache_drop(session_cache_t *c)
+{
+    cJSON_Delete(c->msgs);
+    free(c->summary);
+    s_cache_bytes -= c->bytes;
+    memset(c, 0, sizeof(*c));
+}
+
+static session_cache_t *cache_lru(const session_cache_t *keep)
+{
+    session_cache_t *victim = NULL;
+    for (int i = 0; i < MIMI_SESSION_CACHE_SLOTS; i++) {
+        session_cache_t *c = &s_cache[i];
+        if (!c->msgs || c == keep) continue;
+        if (!victim || c->last_used < victim->last_used) victim = c;
+    }
+    return victim;
+}
+
+/* Evict least recently used sessions until the byte budget holds. The
+ * session being used is never evicted, even if it alone is over budget. */
+static void cache_enforce_budget(const session_cache_t *keep)
+{
+    while (s_cache_bytes > MIMI_SESSION_CACHE_BYTES) {
+        session_cache_t *victim = cache_lru(keep);
+        if (!victim) break;
+        ESP_LOGD(TAG, "Evicting session %s (%u bytes)", victim->chat_id, (unsigned)victim->bytes);
+        cache_drop(victim);
+        s_stats.evictions++;
+    }
+}
+
+static session_cache_t *cache_claim(const char *chat_id)
+{
+    session_cache_t *slot = NULL;
+    for (int i = 0; i < MIMI_SESSION_CACHE_SLOTS && !slot; i++) {
+        if (!s_cache[i].msgs) slot = &s_cache[i];
+    }
+    if (!slot) {
+        slot = cache_lru(NULL);
+        cache_drop(slot);
+        s_stats.evictions++;
+    }
+
+    slot->msgs = cJSON_CreateArray();
+    if (!slot->msgs) return NULL;
+    strncpy(slot->chat_id, chat_id, sizeof(slot->chat_id) - 1);
+    slot->last_used = ++s_tick;
+    return slot;
+}
+
+/* Takes ownership of msg; keeps the newest whole turns that fit
+ * MIMI_SESSION_MAX_MSGS, starting at a user turn. The turn in progress
+ * never loses its opening message, up to CACHE_MAX_MSGS. */
+static void cache_push(session_cache_t *c, cJSON *msg)
+{
+    size_t cost = msg_cost(msg);
+    cJSON_AddItemToArray(c->msgs, msg);
+    c->bytes += cost;
+    s_cache_bytes += cost;
+
+    int count = cJSON_GetArraySize(c->msgs);
+    while (c->msgs->child) {
+        const cJSON *head = c->msgs->child;
+        if (count <= CACHE_MAX_MSGS) {
+            if (turn_start(head) && count <= MIMI_SESSION_MAX_MSGS) break;
+            /* Only a turn with a newer one behind it goes */
+            const cJSON *next = head->next;
+            while (next && !turn_start(next)) next = next->next;
+            if (!next) break;
         }
-        cJSON_AddItemToArray(arr, entry);
+        count--;
+        cJSON *old = cJSON_DetachItemFromArray(c->msgs, 0);
+        cost = msg_cost(old);
+        c->bytes -= cost;
+        s_cache_bytes -= cost;
+        cJSON_Delete(old);
     }
+}
 
-    /* Cleanup ring buffer */
-    int cleanup_start = (count < max_msgs) ? 0 : write_idx;
-    for (int i = 0; i < count; i++) {
-        int idx = (cleanup_start + i) % max_msgs;
-        cJSON_Delete(messages[idx]);
+static void cache_set_summary(session_cache_t *c, char *summary, uint32_t upto)
+{
+    if (c->summary) {
+        size_t old = strlen(c->summary) + 1;
+        c->bytes -= old;
+        s_cache_bytes -= old;
+        free(c->summary);
+    }
+    c->summary = summary;
+    c->summary_upto = upto;
+    if (summary) {
+        c->bytes += strlen(summary) + 1;
+        s_cache_bytes += strlen(summary) + 1;
     }
+}
+
+static char *psram_strdup(const char *s)
+{
+    size_t len = strlen(s);
+    char *copy = heap_caps_malloc(len + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (copy) memcpy(copy, s, len + 1);
+    return copy;
+}
+
+/* Read a persisted summary; *summary is a PSRAM copy the caller frees.
+ * Caller holds s_lock. */
+static bool summary_read(const char *chat_id, char **summary, uint32_t *upto)
+{
+    char path[64];
+    summary_path(chat_id, path, sizeof(path));
+    long size = file_size(path);
+
+    /* A reset between summary_save()'s remove and rename leaves only the
+     * new summary, complete, under its temporary name */
+    if (size < 0) {
+        char tmp[64];
+        summary_tmp_path(chat_id, tmp, sizeof(tmp));
+        if (file_size(tmp) > 0 && rename(tmp, path) == 0) {
+            ESP_LOGW(TAG, "Completed interrupted summary save of %s", chat_id);
+            size = file_size(path);
+        }
+    }
+    if (size <= 0) return false;
+
+    FILE *f = fopen(path, "rb");
+    char *buf = f ? heap_caps_malloc(size + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : NULL;
+    size_t n = buf ? fread(buf, 1, size, f) : 0;
+    if (f) fclose(f);
+    if (!buf) return false;
+    buf[n] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    free(buf);
+    const char *text = cJSON_GetStringValue(cJSON_GetObjectItem(root, "summary"));
+    cJSON *num = cJSON_GetObjectItem(root, "upto");
+    bool ok = text && cJSON_IsNumber(num) && num->valuedouble >= 0;
+    if (ok) {
+        *summary = psram_strdup(text);
+        *upto = (uint32_t)num->valuedouble;
+        ok = *summary != NULL;
+    }
+    cJSON_Delete(root);
+    return ok;
+}
+
+/* Persist a summary. Written aside and renamed, so a crash never leaves
+ * half a summary. Caller holds s_lock. */
+static bool summary_save(const char *chat_id, const char *summary, uint32_t upto)
+{
+    char path[64];
+    char tmp[64];
+    summary_path(chat_id, path, sizeof(path));
+    summary_tmp_path(chat_id, tmp, sizeof(tmp));
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "upto", upto);
+    cJSON_AddStringToObject(root, "summary", summary);
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    FILE *f = json ? fopen(tmp, "w") : NULL;
+    bool ok = f && fputs(json, f) >= 0;
+    if (f && fclose(f) != 0) ok = false;
+    free(json);
+    /* Only a complete file may be left under the temporary name once the
+     * old summary is gone; summary_read() picks it up from there */
+    if (!ok) {
+        remove(tmp);
+        return false;
+    }
+    remove(path);
+    return rename(tmp, path) == 0;
+}
 
-    char *json_str = cJSON_PrintUnformatted(arr);
+static void summary_load(session_cache_t *c)
+{
+    char *summary = NULL;
+    uint32_t upto = 0;
+    if (!summary_read(c->chat_id, &summary, &upto)) return;
+    if (upto <= c->seq_end) {
+        cache_set_summary(c, summary, upto);
+    } else {
+        free(summary);
+    }
+}
+
+/* Load the last records of a session from disk into a fresh slot. A
+ * missing log yields an empty slot, so new chats skip the disk next time. */
+static session_cache_t *cache_load(const char *chat_id)
+{
+    /* Records still in the write-behind queue must reach the log first */
+    if (pending_has(chat_id)) pending_flush_locked();
+#if SESSION_TRANSCRIPTS
+    legacy_import(chat_id);
+#endif
+
+    char path[64];
+    session_path(chat_id, path, sizeof(path));
+    long log_size = file_size(path);
+
+    session_idx_entry_t entries[CACHE_MAX_MSGS];
+    int n = 0;
+    FILE *idx = NULL;
+    int total = index_sync(chat_id, log_size, &idx, NULL);
+    if (total > 0 && idx) {
+        n = (total < CACHE_MAX_MSGS) ? total : CACHE_MAX_MSGS;
+        fflush(idx);
+        if (fseek(idx, (long)(total - n) * sizeof(session_idx_entry_t), SEEK_SET) != 0 ||
+            fread(entries, sizeof(session_idx_entry_t), n, idx) != (size_t)n) {
+            n = 0;
+        }
+    }
+    if (idx) fclose(idx);
+
+    session_cache_t *c = cache_claim(chat_id);
+    if (!c) return NULL;
+    c->seq_end = (total > 0) ? (uint32_t)total : 0;
+    summary_load(c);
+
+    /* Newest first: the last MIMI_SESSION_MAX_MSGS records, and further
+     * back only to reach the opening message of a longer turn */
+    FILE *log = (n > 0) ? fopen(path, "rb") : NULL;
+    cJSON *loaded[CACHE_MAX_MSGS];
+    int from = n;
+    bool opened = false;
+    char *rec = NULL;
+    size_t rec_cap = 0;
+    while (log && from > 0 && (n - from < MIMI_SESSION_MAX_MSGS || !opened)) {
+        int i = from - 1;
+        if (entries[i].len + 1 > rec_cap) {
+            free(rec);
+            rec_cap = entries[i].len + 1;
+            rec = heap_caps_malloc(rec_cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            if (!rec) break;
+        }
+        cJSON *msg = NULL;
+        if (fseek(log, entries[i].off, SEEK_SET) == 0 &&
+            fread(rec, 1, entries[i].len, log) == entries[i].len) {
+            rec[entries[i].len] = '\0';
+            msg = record_parse(rec, entries[i].len);
+        }
+        /* An unreadable record keeps its place, or every message before
+         * it would be numbered one too low against the summary */
+        if (!msg) {
+            ESP_LOGW(TAG, "Session %s: record %u unreadable", chat_id,
+                     (unsigned)(total - n + i));
+            msg = cJSON_CreateNull();
+        }
+        if (msg && turn_start(msg)) opened = true;
+        loaded[--from] = msg;
+    }
+    free(rec);
+    if (log) fclose(log);
+
+    for (int i = from; i < n; i++) {
+        if (loaded[i]) cache_push(c, loaded[i]);
+    }
+
+    cache_enforce_budget(c);
+    return c;
+}
+
+/* ── Public API ───────────────────────────────────────────────── */
+
+static void rotate_recover(void);
+
+esp_err_t session_mgr_init(void)
+{
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        s_flush_wake = xSemaphoreCreateBinary();
+        if (!s_lock || !s_flush_wake) return ESP_ERR_NO_MEM;
+
+        if (xTaskCreatePinnedToCore(session_flush_task, "session_wb",
+                                    MIMI_SESSION_FLUSH_STACK, NULL,
+                                    MIMI_SESSION_FLUSH_PRIO, NULL,
+                                    MIMI_SESSION_FLUSH_CORE) != pdPASS) {
+            /* Appends fall back to writing through */
+            ESP_LOGW(TAG, "Write-behind task unavailable, writing through");
+            vSemaphoreDelete(s_flush_wake);
+            s_flush_wake = NULL;
+        }
+
+        /* Every restart path reboots inside the write-behind delay */
+        if (esp_register_shutdown_handler(session_flush) != ESP_OK) {
+            ESP_LOGW(TAG, "No shutdown flush, records queued at restart are lost");
+        }
+    }
+    rotate_recover();
+    ESP_LOGI(TAG, "Session manager initialized at %s", MIMI_SPIFFS_SESSION_DIR);
+    return ESP_OK;
+}
+
+/* Cut a string member to at most max bytes on a UTF-8 boundary, noting
+ * how much was dropped */
+static void truncate_string(cJSON *obj, const char *key, size_t max)
+{
+    const char *str = cJSON_GetStringValue(cJSON_GetObjectItem(obj, key));
+    size_t len = str ? strlen(str) : 0;
+    if (len <= max) return;
+
+    size_t keep = max;
+    while (keep > 0 && ((unsigned char)str[keep] & 0xC0) == 0x80) keep--;
+    char note[48];
+    int nlen = snprintf(note, sizeof(note), "\n...[truncated %u bytes]", (unsigned)(len - keep));
+
+    char *cut = heap_caps_malloc(keep + nlen + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!cut) return;
+    memcpy(cut, str, keep);
+    memcpy(cut + keep, note, nlen + 1);
+    cJSON_ReplaceItemInObject(obj, key, cJSON_CreateString(cut));
+    free(cut);
+}
+
+/* Copy of a message with tool inputs and results held to the transcript
+ * budget, so one large web page or file read cannot crowd out history */
+static cJSON *message_trim(const cJSON *msg)
+{
+    cJSON *copy = cJSON_Duplicate(msg, true);
+    cJSON *block;
+    cJSON_ArrayForEach(block, cJSON_GetObjectItem(copy, "content")) {
+        const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(block, "type"));
+        if (!type) continue;
+        if (strcmp(type, "tool_result") == 0) {
+            truncate_string(block, "content", MIMI_SESSION_TOOL_RESULT_MAX);
+        } else if (strcmp(type, "tool_use") == 0) {
+            /* A cut input would no longer be JSON; the result still says
+             * what the call did */
+            char *input = cJSON_PrintUnformatted(cJSON_GetObjectItem(block, "input"));
+            if (input && strlen(input) > MIMI_SESSION_TOOL_RESULT_MAX) {
+                cJSON_ReplaceItemInObject(block, "input", cJSON_CreateObject());
+            }
+            free(input);
+        }
+    }
+    return copy;
+}
+
+esp_err_t session_append_message(const char *chat_id, const cJSON *msg)
+{
+    cJSON *entry = message_trim(msg);
+    if (!entry) return ESP_ERR_NO_MEM;
+
+    pending_rec_t *rec = record_build(chat_id, entry, (uint32_t)time(NULL));
+    if (!rec) {
+        cJSON_Delete(entry);
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    if (s_pending_tail) {
+        s_pending_tail->next = rec;
+    } else {
+        s_pending_head = rec;
+    }
+    s_pending_tail = rec;
+    s_stats.pending++;
+
+    session_cache_t *c = cache_find(chat_id);
+    if (c) {
+        cache_push(c, entry);
+        c->seq_end++;
+        cache_enforce_budget(c);
+    } else {
+        cJSON_Delete(entry);
+    }
+
+    if (!s_flush_wake) pending_flush_locked();
+    xSemaphoreGive(s_lock);
+
+    if (s_flush_wake) xSemaphoreGive(s_flush_wake);
+    return ESP_OK;
+}
+
+esp_err_t session_append(const char *chat_id, const char *role, const char *content)
+{
+    cJSON *msg = cJSON_CreateObject();
+    if (!msg) return ESP_ERR_NO_MEM;
+    cJSON_AddStringToObject(msg, "role", role);
+    cJSON_AddStringToObject(msg, "content", content);
+    esp_err_t err = session_append_message(chat_id, msg);
+    cJSON_Delete(msg);
+    return err;
+}
+
+#define SUMMARY_PREFIX  "[Summary of our earlier conversation]\n"
+#define SUMMARY_ACK     "Understood, I'll keep that context in mind."
+
+static void summary_message(cJSON *arr, const char *role, const char *prefix, const char *text)
+{
+    size_t plen = strlen(prefix);
+    size_t tlen = strlen(text);
+    char *content = heap_caps_malloc(plen + tlen + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!content) return;
+    memcpy(content, prefix, plen);
+    memcpy(content + plen, text, tlen + 1);
+
+    cJSON *msg = cJSON_CreateObject();
+    cJSON_AddStringToObject(msg, "role", role);
+    cJSON_AddStringToObject(msg, "content", content);
+    cJSON_AddItemToArray(arr, msg);
+    free(content);
+}
+
+cJSON *session_get_history(const char *chat_id, int max_msgs, int max_tokens, bool *outgrown)
+{
+    if (outgrown) *outgrown = false;
+    if (max_msgs > MIMI_SESSION_MAX_MSGS) max_msgs = MIMI_SESSION_MAX_MSGS;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    session_cache_t *c = cache_find(chat_id);
+    if (c) {
+        s_stats.hits++;
+    } else {
+        s_stats.misses++;
+        c = cache_load(chat_id);
+    }
+
+    cJSON *arr = cJSON_CreateArray();
+    if (c && arr) {
+        const cJSON *items[CACHE_MAX_MSGS];
+        int total = 0;
+        const cJSON *msg;
+        cJSON_ArrayForEach(msg, c->msgs) {
+            if (total < CACHE_MAX_MSGS) items[total++] = msg;
+        }
+        uint32_t first_seq = c->seq_end - total;
+
+        /* Messages the summary already covers are left out */
+        int first = 0;
+        if (c->summary && c->summary_upto > first_seq) {
+            first = (c->summary_upto - first_seq < (uint32_t)total) ? (int)(c->summary_upto - first_seq) : total;
+        }
+
+        /* Pack newest first until the message cap or token budget is hit */
+        int budget = (max_tokens > 0) ? max_tokens : INT32_MAX;
+        if (c->summary) {
+            budget -= estimate_text_tokens(SUMMARY_PREFIX) + estimate_text_tokens(c->summary) +
+                      estimate_text_tokens(SUMMARY_ACK) + 2 * MSG_FRAMING_TOKENS;
+        }
+        int start = total;
+        int used = 0;
+        while (start > first && total - start < max_msgs) {
+            int t = message_tokens(items[start - 1]);
+            if (used + t > budget) break;
+            used += t;
+            start--;
+        }
+        while (start < total && !turn_start(items[start])) start++;
+
+        /* A turn longer than max_msgs is sent whole if it fits the budget,
+         * rather than not at all */
+        if (start == total) {
+            int open = total - 1;
+            while (open >= first && !turn_start(items[open])) open--;
+            if (open >= first) {
+                int need = 0;
+                for (int i = open; i < total; i++) need += message_tokens(items[i]);
+                if (need <= budget) start = open;
+            }
+        }
+
+        /* Older messages fell out of the window without being summarized,
+         * or records before the cache never were. With the whole cache in
+         * the window, the summary catches up over such a gap by folding in
+         * the oldest cached turn. */
+        int upto = start;
+        if (start == first && first < total && first_seq > c->summary_upto) {
+            upto = first + 1;
+            while (upto < total && !turn_start(items[upto])) upto++;
+            if (upto == total) upto = first;    /* never the only turn */
+        }
+        if (upto > first) {
+            c->compact_upto = first_seq + upto;
+            if (!c->compact_requested && outgrown) {
+                c->compact_requested = true;
+                *outgrown = true;
+            }
+        }
+
+        /* The summary goes first as its own exchange; it changes only on
+         * compaction, so the prompt cache prefix stays stable */
+        if (c->summary) {
+            summary_message(arr, "user", SUMMARY_PREFIX, c->summary);
+            summary_message(arr, "assistant", "", SUMMARY_ACK);
+        }
+        for (int i = start; i < total; i++) {
+            if (!cJSON_IsNull(items[i])) cJSON_AddItemToArray(arr, cJSON_Duplicate(items[i], true));
+        }
+    }
+
+    xSemaphoreGive(s_lock);
+    return arr;
+}
+
+esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size, int max_msgs)
+{
+    cJSON *arr = session_get_history(chat_id, max_msgs, 0, NULL);
+    char *json_str = arr ? cJSON_PrintUnformatted(arr) : NULL;
     cJSON_Delete(arr);
 
     if (json_str) {
@@ -125,12 +1086,280 @@ esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size,
     return ESP_OK;
 }
 
+/* ── History compaction ───────────────────────────────────────── */
+
+esp_err_t session_compact_begin(const char *chat_id, char **summary, cJSON **msgs, uint32_t *upto)
+{
+    *summary = NULL;
+    *msgs = NULL;
+    *upto = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    session_cache_t *c = cache_find(chat_id);
+    if (c && c->compact_requested) {
+        int total = cJSON_GetArraySize(c->msgs);
+        uint32_t first_seq = c->seq_end - total;
+        uint32_t from = (c->summary_upto > first_seq) ? c->summary_upto : first_seq;
+        if (c->summary_upto < first_seq) {
+            ESP_LOGW(TAG, "Session %s: %u records left the cache unsummarized",
+                     chat_id, (unsigned)(first_seq - c->summary_upto));
+        }
+
+        if (c->compact_upto > from) {
+            cJSON *range = cJSON_CreateArray();
+            uint32_t seq = first_seq;
+            const cJSON *msg;
+            cJSON_ArrayForEach(msg, c->msgs) {
+                if (seq >= from && seq < c->compact_upto && !cJSON_IsNull(msg)) {
+                    cJSON_AddItemToArray(range, cJSON_Duplicate(msg, true));
+                }
+                seq++;
+            }
+            *msgs = range;
+            *summary = c->summary ? psram_strdup(c->summary) : NULL;
+            *upto = c->compact_upto;
+            err = range ? ESP_OK : ESP_ERR_NO_MEM;
+        }
+        if (err != ESP_OK) c->compact_requested = false;
+    }
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+esp_err_t session_compact_end(const char *chat_id, const char *summary, uint32_t upto)
+{
+    esp_err_t err = ESP_OK;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (summary && !summary_save(chat_id, summary, upto)) {
+        ESP_LOGE(TAG, "Cannot save summary for %s", chat_id);
+        err = ESP_FAIL;
+    }
+
+    session_cache_t *c = cache_find(chat_id);
+    if (c) {
+        if (err == ESP_OK && summary) {
+            cache_set_summary(c, psram_strdup(summary), upto);
+            cache_enforce_budget(c);
+        }
+        c->compact_requested = false;
+    }
+    if (err == ESP_OK && summary) s_stats.compactions++;
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+/* ── Rotation ─────────────────────────────────────────────────── */
+
+static void rotate_path(const char *chat_id, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s/%s.rot", MIMI_SPIFFS_SESSION_DIR, chat_id);
+}
+
+/* Load the whole index; the caller frees. Caller holds s_lock. */
+static session_idx_entry_t *index_load(const char *chat_id, long log_size, int *count)
+{
+    FILE *idx = NULL;
+    int total = index_sync(chat_id, log_size, &idx, NULL);
+    session_idx_entry_t *entries = NULL;
+    if (total > 0 && idx) {
+        entries = heap_caps_malloc(total * sizeof(session_idx_entry_t),
+                                   MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        fflush(idx);
+        if (entries && (fseek(idx, 0, SEEK_SET) != 0 ||
+                        fread(entries, sizeof(session_idx_entry_t), total, idx) != (size_t)total)) {
+            free(entries);
+            entries = NULL;
+        }
+    }
+    if (idx) fclose(idx);
+    *count = (total > 0) ? total : 0;
+    return entries;
+}
+
+/* Finish or undo a rotation cut short by a reset: a leftover .rot is the
+ * new log if the old one is already gone, otherwise it is stale */
+static void rotate_recover(void)
+{
+    DIR *dir = opendir(MIMI_SPIFFS_SESSION_DIR);
+    if (!dir) return;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len <= 4 || len - 4 >= 32 || strcmp(entry->d_name + len - 4, ".rot") != 0) continue;
+
+        char chat_id[32];
+        memcpy(chat_id, entry->d_name, len - 4);
+        chat_id[len - 4] = '\0';
+        char path[64];
+        char rpath[64];
+        char ipath[64];
+        session_path(chat_id, path, sizeof(path));
+        rotate_path(chat_id, rpath, sizeof(rpath));
+        index_path(chat_id, ipath, sizeof(ipath));
+        if (file_size(path) < 0 && rename(rpath, path) == 0) {
+            remove(ipath);
+            ESP_LOGW(TAG, "Completed interrupted rotation of %s", chat_id);
+        } else {
+            remove(rpath);
+        }
+    }
+    closedir(dir);
+}
+
+static bool copy_range(FILE *in, FILE *out, uint32_t from, uint32_t to)
+{
+    char chunk[SCAN_CHUNK];
+    if (fseek(in, from, SEEK_SET) != 0) return false;
+    while (from < to) {
+        size_t want = (to - from < sizeof(chunk)) ? to - from : sizeof(chunk);
+        if (fread(chunk, 1, want, in) != want || fwrite(chunk, 1, want, out) != want) return false;
+        from += want;
+    }
+    return true;
+}
+
+esp_err_t session_rotate(const char *chat_id, size_t keep_bytes, int *dropped)
+{
+    if (dropped) *dropped = 0;
+    char path[64];
+    char rpath[64];
+    session_path(chat_id, path, sizeof(path));
+    rotate_path(chat_id, rpath, sizeof(rpath));
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (pending_has(chat_id)) pending_flush_locked();
+#if SESSION_TRANSCRIPTS
+    legacy_import(chat_id);
+#endif
+
+    /* Record numbers shift, which would misplace a summary in progress */
+    session_cache_t *c = cache_find(chat_id);
+    if (c && c->compact_requested) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    long log_size = file_size(path);
+    if (log_size <= (long)keep_bytes) {
+        xSemaphoreGive(s_lock);
+        return log_size < 0 ? ESP_ERR_NOT_FOUND : ESP_OK;
+    }
+
+    int total = 0;
+    session_idx_entry_t *entries = index_load(chat_id, log_size, &total);
+    if (!entries) {
+        xSemaphoreGive(s_lock);
+        return (total > 0) ? ESP_FAIL : ESP_OK;
+    }
+
+    /* Keep the newest records that fit, but never fewer than the cache
+     * loads, so a long turn keeps its opening message */
+    int first = total;
+    size_t kept = 0;
+    while (first > 0) {
+        size_t rec = entries[first - 1].len + REC_HEAD + REC_TAIL;
+        if (total - first >= CACHE_MAX_MSGS && kept + rec > keep_bytes) break;
+        kept += rec;
+        first--;
+    }
+    uint32_t from = (first < total) ? entries[first].off - REC_HEAD : 0;
+    uint32_t to = entries[total - 1].off + entries[total - 1].len + REC_TAIL;
+    free(entries);
+    if (first == 0) {
+        xSemaphoreGive(s_lock);
+        return ESP_OK;
+    }
+
+    FILE *in = fopen(path, "rb");
+    FILE *out = in ? fopen(rpath, "wb") : NULL;
+    bool ok = out && copy_range(in, out, from, to);
+    if (out && fclose(out) != 0) ok = false;
+    if (in) fclose(in);
+    if (ok) {
+        remove(path);
+        ok = rename(rpath, path) == 0;
+    }
+    if (!ok) {
+        ESP_LOGE(TAG, "Cannot rotate %s", chat_id);
+        remove(rpath);
+        xSemaphoreGive(s_lock);
+        return ESP_FAIL;
+    }
+
+    /* Renumber the summary and rebuild the index for the shorter log */
+    char *summary = NULL;
+    uint32_t upto = 0;
+    if (summary_read(chat_id, &summary, &upto)) {
+        summary_save(chat_id, summary, upto > (uint32_t)first ? upto - first : 0);
+        free(summary);
+    }
+    char ipath[64];
+    index_path(chat_id, ipath, sizeof(ipath));
+    remove(ipath);
+    index_sync(chat_id, file_size(path), NULL, NULL);
+    if (c) cache_drop(c);
+    s_stats.rotations++;
+    xSemaphoreGive(s_lock);
+
+    ESP_LOGI(TAG, "Rotated %s: dropped %d records, %ld -> %u bytes",
+             chat_id, first, log_size, (unsigned)(to - from));
+    if (dropped) *dropped = first;
+    return ESP_OK;
+}
+
+void session_flush(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    pending_flush_locked();
+    xSemaphoreGive(s_lock);
+}
+
+void session_get_cache_stats(session_cache_stats_t *out)
+{
+    if (!out) return;
+    if (!s_lock) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out = s_stats;
+    out->bytes = s_cache_bytes;
+    out->sessions = 0;
+    for (int i = 0; i < MIMI_SESSION_CACHE_SLOTS; i++) {
+        if (s_cache[i].msgs) out->sessions++;
+    }
+    xSemaphoreGive(s_lock);
+}
+
 esp_err_t session_clear(const char *chat_id)
 {
     char path[64];
     session_path(chat_id, path, sizeof(path));
+    char ipath[64];
+    index_path(chat_id, ipath, sizeof(ipath));
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool unsaved = pending_drop(chat_id) > 0;
+    session_cache_t *c = cache_find(chat_id);
+    if (c) cache_drop(c);
+    remove(ipath);
+    int rc = remove(path);
+    char spath[64];
+    summary_path(chat_id, spath, sizeof(spath));
+    remove(spath);
+    summary_tmp_path(chat_id, spath, sizeof(spath));
+    remove(spath);
+#if SESSION_TRANSCRIPTS
+    char jpath[64];
+    snprintf(jpath, sizeof(jpath), "%s/%s.jsonl", MIMI_SPIFFS_SESSION_DIR, chat_id);
+    if (remove(jpath) == 0) rc = 0;
+#endif
+    xSemaphoreGive(s_lock);
 
-    if (remove(path) == 0) {
+    if (rc == 0 || unsaved) {
         ESP_LOGI(TAG, "Session %s cleared", chat_id);
         return ESP_OK;
     }
@@ -152,7 +1381,7 @@ void session_list(void)
     struct dirent *entry;
     int count = 0;
     while ((entry = readdir(dir)) != NULL) {
-        if (strstr(entry->d_name, ".jsonl")) {
+        if (strstr(entry->d_name, SESSION_LOG_EXT)) {
             ESP_LOGI(TAG, "  Session: %s", entry->d_name);
             count++;
         }
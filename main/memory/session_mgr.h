@@ -2,6 +2,9 @@
 
 #include "esp_err.h"
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "cJSON.h"
 
 /**
  * Initialize session manager.
@@ -9,27 +12,97 @@
 esp_err_t session_mgr_init(void);
 
 /**
- * Append a message to a session file (JSONL format).
+ * Append a message to a session. The cached history is updated at once;
+ * the record reaches the session file (JSONL format) and its sidecar
+ * offset index (<chat_id>.idx) through the write-behind task.
  * @param chat_id   Session identifier (e.g., "12345")
  * @param role      "user" or "assistant"
  * @param content   Message text
  */
 esp_err_t session_append(const char *chat_id, const char *role, const char *content);
 
+/**
+ * Append a whole {"role","content"} message, where content may be an array
+ * of text / tool_use / tool_result blocks. Tool inputs and results longer
+ * than MIMI_SESSION_TOOL_RESULT_MAX are cut before the message is cached
+ * and queued. With CONFIG_MIMI_ENABLE_SESSION_TRANSCRIPTS the record is
+ * stored in the compact binary format (<chat_id>.bin).
+ */
+esp_err_t session_append_message(const char *chat_id, const cJSON *msg);
+
+/**
+ * Load session history as a cJSON array of {"role","content"} messages,
+ * ready to extend and pass to the LLM. Hot sessions are served from an
+ * LRU cache of parsed history in PSRAM without touching the filesystem.
+ *
+ * The newest messages are packed until max_msgs or the estimated
+ * max_tokens budget is reached. The window always opens with a user turn,
+ * so it never starts on an orphaned tool_result; a single turn longer than
+ * max_msgs comes whole while it fits max_tokens. A rolling summary of
+ * older messages, if one exists, comes first as a user/assistant exchange
+ * and counts against the budget.
+ *
+ * @param chat_id     Session identifier
+ * @param max_msgs    Maximum number of messages (at most MIMI_SESSION_MAX_MSGS)
+ * @param max_tokens  Estimated input-token budget, 0 for none
+ * @param outgrown    Optional: set true the first time unsummarized messages
+ *                    fall out of the window or precede the cached history;
+ *                    the caller should then run
+ *                    session_compact_begin()/session_compact_end()
+ * @return New array owned by the caller (empty if no history), NULL if out of memory
+ */
+cJSON *session_get_history(const char *chat_id, int max_msgs, int max_tokens, bool *outgrown);
+
 /**
  * Load session history as a JSON array string suitable for LLM messages.
  * Returns the last max_msgs messages as:
  * [{"role":"user","content":"..."},{"role":"assistant","content":"..."},...]
  *
+ * Records are located through the sidecar index, so the cost does not
+ * grow with session age. Legacy logs without an index are indexed on
+ * first load.
+ *
  * @param chat_id   Session identifier
  * @param buf       Output buffer (caller allocates)
  * @param size      Buffer size
- * @param max_msgs  Maximum number of messages to return
+ * @param max_msgs  Maximum number of messages to return (at most MIMI_SESSION_MAX_MSGS)
  */
 esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size, int max_msgs);
 
 /**
- * Clear a session (delete the file).
+ * Start compacting a session that outgrew its history window: returns the
+ * current summary (NULL if none) and copies of the messages between it and
+ * the window, to be folded into a new summary.
+ *
+ * @param summary  Output: current summary, caller frees
+ * @param msgs     Output: messages to summarize, caller deletes
+ * @param upto     Output: record number the new summary will cover up to
+ * @return ESP_OK, or ESP_ERR_NOT_FOUND if there is nothing to compact
+ */
+esp_err_t session_compact_begin(const char *chat_id, char **summary, cJSON **msgs, uint32_t *upto);
+
+/**
+ * Finish a compaction: persist the new summary (<chat_id>.sum) and use it
+ * in place of the messages it covers. summary == NULL abandons the attempt;
+ * the next outgrown history load requests it again.
+ */
+esp_err_t session_compact_end(const char *chat_id, const char *summary, uint32_t upto);
+
+/**
+ * Rotate a session log that grew past keep_bytes: the oldest records are
+ * dropped so that the newest ones fitting in keep_bytes remain, but never
+ * fewer than MIMI_SESSION_MAX_MSGS. The index is rebuilt and the rolling
+ * summary renumbered; dropped records that it did not cover are lost.
+ *
+ * @param keep_bytes  Log size to cut back to
+ * @param dropped     Optional: number of records removed
+ * @return ESP_OK (also when nothing had to go), ESP_ERR_NOT_FOUND if there
+ *         is no log, ESP_ERR_INVALID_STATE while a compaction is running
+ */
+esp_err_t session_rotate(const char *chat_id, size_t keep_bytes, int *dropped);
+
+/**
+ * Clear a session (delete the log, its index and summary).
  */
 esp_err_t session_clear(const char *chat_id);
 
@@ -37,3 +110,26 @@ esp_err_t session_clear(const char *chat_id);
  * List all session files (prints to log).
  */
 void session_list(void);
+
+/**
+ * Write all pending session records to flash now.
+ */
+void session_flush(void);
+
+typedef struct {
+    uint32_t hits;          /* history loads served from the cache */
+    uint32_t misses;        /* history loads that read the session file */
+    uint32_t evictions;     /* sessions dropped for the slot or byte cap */
+    uint32_t flushes;       /* write-behind batches */
+    uint32_t write_errors;  /* records that failed to persist */
+    uint32_t compactions;   /* rolling summaries written */
+    uint32_t rotations;     /* logs cut back by session_rotate() */
+    uint32_t pending;       /* records not yet written */
+    int sessions;           /* sessions currently cached */
+    size_t bytes;           /* approximate cache footprint */
+} session_cache_stats_t;
+
+/**
+ * Snapshot the history cache and write-behind counters.
+ */
+void session_get_cache_stats(session_cache_stats_t *out);
@@ -0,0 +1,254 @@
+#include "session_record.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+enum {
+    BLOCK_TEXT = 1,
+    BLOCK_TOOL_USE = 2,
+    BLOCK_TOOL_RESULT = 3,
+};
+
+/* ── Encoder ──────────────────────────────────────────────────── */
+
+/* Bounded output cursor; keeps counting past cap so callers learn the
+ * full size from a dry run */
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+} rec_out_t;
+
+static void out_bytes(rec_out_t *o, const void *data, size_t n)
+{
+    if (o->buf && o->len + n <= o->cap) {
+        memcpy(o->buf + o->len, data, n);
+    }
+    o->len += n;
+}
+
+static void out_u8(rec_out_t *o, uint8_t v)
+{
+    out_bytes(o, &v, 1);
+}
+
+static void out_varint(rec_out_t *o, uint32_t v)
+{
+    while (v >= 0x80) {
+        out_u8(o, (uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out_u8(o, (uint8_t)v);
+}
+
+static void out_str(rec_out_t *o, const char *s)
+{
+    size_t n = s ? strlen(s) : 0;
+    out_varint(o, (uint32_t)n);
+    if (n) out_bytes(o, s, n);
+}
+
+static const char *block_str(const cJSON *block, const char *key)
+{
+    const char *s = cJSON_GetStringValue(cJSON_GetObjectItem(block, key));
+    return s ? s : "";
+}
+
+static bool encode_block(rec_out_t *o, const cJSON *block)
+{
+    const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(block, "type"));
+    if (!type) return false;
+
+    if (strcmp(type, "text") == 0) {
+        out_u8(o, BLOCK_TEXT);
+        out_str(o, block_str(block, "text"));
+    } else if (strcmp(type, "tool_use") == 0) {
+        const cJSON *input = cJSON_GetObjectItem(block, "input");
+        char *input_json = input ? cJSON_PrintUnformatted(input) : NULL;
+        out_u8(o, BLOCK_TOOL_USE);
+        out_str(o, block_str(block, "id"));
+        out_str(o, block_str(block, "name"));
+        out_str(o, input_json ? input_json : "{}");
+        free(input_json);
+    } else if (strcmp(type, "tool_result") == 0) {
+        const cJSON *content = cJSON_GetObjectItem(block, "content");
+        char *printed = (content && !cJSON_IsString(content)) ? cJSON_PrintUnformatted(content) : NULL;
+        out_u8(o, BLOCK_TOOL_RESULT);
+        out_str(o, block_str(block, "tool_use_id"));
+        out_str(o, printed ? printed : cJSON_GetStringValue(content));
+        free(printed);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+size_t session_record_encode(const cJSON *msg, uint32_t ts, uint8_t *buf, size_t cap)
+{
+    const char *role = cJSON_GetStringValue(cJSON_GetObjectItem(msg, "role"));
+    const cJSON *content = cJSON_GetObjectItem(msg, "content");
+    if (!role || !content) return 0;
+
+    rec_out_t o = { .buf = buf, .cap = cap };
+    out_u8(&o, SESSION_RECORD_VERSION);
+    out_u8(&o, strcmp(role, "assistant") == 0 ? 1 : 0);
+    uint8_t t[4] = { ts & 0xFF, (ts >> 8) & 0xFF, (ts >> 16) & 0xFF, (ts >> 24) & 0xFF };
+    out_bytes(&o, t, sizeof(t));
+
+    if (cJSON_IsString(content)) {
+        out_varint(&o, 1);
+        out_u8(&o, BLOCK_TEXT);
+        out_str(&o, content->valuestring);
+        return o.len;
+    }
+    if (!cJSON_IsArray(content)) return 0;
+
+    /* Count first so unknown block types can be skipped */
+    rec_out_t probe = {0};
+    uint32_t count = 0;
+    const cJSON *block;
+    cJSON_ArrayForEach(block, content) {
+        if (encode_block(&probe, block)) count++;
+    }
+    out_varint(&o, count);
+    cJSON_ArrayForEach(block, content) {
+        encode_block(&o, block);
+    }
+    return o.len;
+}
+
+/* ── Decoder ──────────────────────────────────────────────────── */
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool bad;
+} rec_in_t;
+
+static uint8_t in_u8(rec_in_t *in)
+{
+    if (in->p >= in->end) {
+        in->bad = true;
+        return 0;
+    }
+    return *in->p++;
+}
+
+static uint32_t in_varint(rec_in_t *in)
+{
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35 && !in->bad; shift += 7) {
+        uint8_t b = in_u8(in);
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    in->bad = true;
+    return 0;
+}
+
+/* Returns a NUL-terminated copy, or NULL if the record is truncated */
+static char *in_str(rec_in_t *in)
+{
+    uint32_t n = in_varint(in);
+    if (in->bad || n > (size_t)(in->end - in->p)) {
+        in->bad = true;
+        return NULL;
+    }
+    char *s = malloc(n + 1);
+    if (!s) {
+        in->bad = true;
+        return NULL;
+    }
+    memcpy(s, in->p, n);
+    s[n] = '\0';
+    in->p += n;
+    return s;
+}
+
+static void add_owned_string(cJSON *obj, const char *key, char *s)
+{
+    cJSON_AddStringToObject(obj, key, s ? s : "");
+    free(s);
+}
+
+static cJSON *decode_block(rec_in_t *in)
+{
+    uint8_t type = in_u8(in);
+    cJSON *block = cJSON_CreateObject();
+    if (!block) {
+        in->bad = true;
+        return NULL;
+    }
+
+    switch (type) {
+    case BLOCK_TEXT:
+        cJSON_AddStringToObject(block, "type", "text");
+        add_owned_string(block, "text", in_str(in));
+        break;
+    case BLOCK_TOOL_USE: {
+        cJSON_AddStringToObject(block, "type", "tool_use");
+        add_owned_string(block, "id", in_str(in));
+        add_owned_string(block, "name", in_str(in));
+        char *input_json = in_str(in);
+        cJSON *input = input_json ? cJSON_Parse(input_json) : NULL;
+        free(input_json);
+        cJSON_AddItemToObject(block, "input", input ? input : cJSON_CreateObject());
+        break;
+    }
+    case BLOCK_TOOL_RESULT:
+        cJSON_AddStringToObject(block, "type", "tool_result");
+        add_owned_string(block, "tool_use_id", in_str(in));
+        add_owned_string(block, "content", in_str(in));
+        break;
+    default:
+        in->bad = true;
+        break;
+    }
+
+    if (in->bad) {
+        cJSON_Delete(block);
+        return NULL;
+    }
+    return block;
+}
+
+cJSON *session_record_decode(const uint8_t *buf, size_t len)
+{
+    rec_in_t in = { .p = buf, .end = buf + len };
+    if (in_u8(&in) != SESSION_RECORD_VERSION) return NULL;
+    uint8_t role = in_u8(&in);
+    if (in.bad || in.end - in.p < 4) return NULL;
+    in.p += 4;  /* ts is kept for tooling; history does not need it */
+
+    uint32_t count = in_varint(&in);
+    if (in.bad || count == 0) return NULL;
+
+    cJSON *content = cJSON_CreateArray();
+    for (uint32_t i = 0; content && i < count; i++) {
+        cJSON *block = decode_block(&in);
+        if (!block) {
+            cJSON_Delete(content);
+            return NULL;
+        }
+        cJSON_AddItemToArray(content, block);
+    }
+    if (!content) return NULL;
+
+    /* A lone text block was a plain string message */
+    cJSON *first = content->child;
+    if (count == 1 && strcmp(cJSON_GetStringValue(cJSON_GetObjectItem(first, "type")), "text") == 0) {
+        cJSON *text = cJSON_DetachItemFromObject(first, "text");
+        cJSON_Delete(content);
+        content = text;
+    }
+
+    cJSON *msg = cJSON_CreateObject();
+    if (!msg) {
+        cJSON_Delete(content);
+        return NULL;
+    }
+    cJSON_AddStringToObject(msg, "role", role ? "assistant" : "user");
+    cJSON_AddItemToObject(msg, "content", content);
+    return msg;
+}
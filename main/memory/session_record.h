@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cJSON.h"
+
+/* ── Binary transcript records ─────────────────────────────────────
+ *
+ * Compact encoding of one conversation message for the session log
+ * when tool transcripts are kept. A payload is:
+ *
+ *   u8  version         SESSION_RECORD_VERSION
+ *   u8  role            0 = user, 1 = assistant
+ *   u32 ts              unix time, little endian
+ *   var block_count
+ *   blocks...           u8 type, then varint-length strings:
+ *                         text:        text
+ *                         tool_use:    id, name, input (JSON text)
+ *                         tool_result: tool_use_id, content
+ *
+ * A message whose content is a plain string is stored as a single text
+ * block and decodes back to a plain string. The log frames each payload
+ * with its own length, so records are found without parsing.
+ */
+
+#define SESSION_RECORD_VERSION  1
+
+/**
+ * Encode a {"role","content"} message. content may be a string or an
+ * array of text / tool_use / tool_result blocks; other blocks are skipped.
+ *
+ * @param buf  Output buffer, or NULL to only measure
+ * @param cap  Buffer size
+ * @return Encoded length (which may exceed cap), 0 if the message is invalid
+ */
+size_t session_record_encode(const cJSON *msg, uint32_t ts, uint8_t *buf, size_t cap);
+
+/**
+ * Decode a payload into a new {"role","content"} message.
+ * @return Message owned by the caller, NULL if the payload is malformed
+ */
+cJSON *session_record_decode(const uint8_t *buf, size_t len);
@@ -0,0 +1,447 @@
+#include "storage_manager.h"
+#include "session_mgr.h"
+#include "fs_backend.h"
+#include "memory_store.h"
+#include "mimi_config.h"
+#include "skills/skill_engine.h"
+#include "skills/skill_rollback.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "cJSON.h"
+
+static const char *TAG = "storage";
+
+#define SKILLS_DIR          "/spiffs/skills"
+#define BACKUP_DIR          "/spiffs/skills/.rollback"
+#define STAGING_DIR         "/spiffs/skills/.staging"
+#define CLOCK_VALID_EPOCH   1704067200      /* 2024-01-01; earlier means SNTP has not synced */
+#define WALK_MAX_DEPTH      4
+#define DAY_SECONDS         86400
+
+typedef struct {
+    size_t bytes;
+    int files;
+} storage_usage_t;
+
+enum {
+    CAT_CONFIG,
+    CAT_MEMORY,
+    CAT_SESSIONS,
+    CAT_SKILLS,
+    CAT_BACKUPS,
+    CAT_STAGING,
+    CAT_COUNT,
+};
+
+static const struct {
+    const char *name;
+    const char *dir;
+    bool skip_hidden;       /* hidden entries belong to another category */
+    size_t quota;
+} s_categories[CAT_COUNT] = {
+    [CAT_CONFIG]   = { "config",        MIMI_SPIFFS_CONFIG_DIR,  false, 0 },
+    [CAT_MEMORY]   = { "memory",        MIMI_SPIFFS_MEMORY_DIR,  false, MIMI_STORAGE_NOTES_QUOTA },
+    [CAT_SESSIONS] = { "sessions",      MIMI_SPIFFS_SESSION_DIR, false, MIMI_STORAGE_SESSION_QUOTA },
+    [CAT_SKILLS]   = { "skills",        SKILLS_DIR,              true,  0 },
+    [CAT_BACKUPS]  = { "skill_backups", BACKUP_DIR,              false, MIMI_STORAGE_BACKUP_QUOTA },
+    [CAT_STAGING]  = { "skill_staging", STAGING_DIR,             false, 0 },
+};
+
+typedef struct {
+    uint32_t passes;
+    uint32_t sessions_cleared;
+    uint32_t sessions_rotated;
+    uint32_t notes_removed;
+    uint32_t backups_removed;
+    uint32_t gc_runs;
+    size_t freed_bytes;         /* over all passes */
+    int64_t last_pass_us;
+    uint32_t last_pass_ms;      /* duration */
+} storage_stats_t;
+
+static SemaphoreHandle_t s_pass_lock = NULL;
+static SemaphoreHandle_t s_stats_lock = NULL;
+static storage_stats_t s_stats = {0};
+
+/* ── Usage scan ───────────────────────────────────────────────── */
+
+static void walk(const char *path, storage_usage_t *u, bool skip_hidden, int depth)
+{
+    DIR *dir = opendir(path);
+    if (!dir) return;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        if (skip_hidden && entry->d_name[0] == '.') continue;
+
+        char child[160];
+        if (snprintf(child, sizeof(child), "%s/%s", path, entry->d_name) >= (int)sizeof(child)) continue;
+        struct stat st;
+        if (stat(child, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            if (depth < WALK_MAX_DEPTH) walk(child, u, false, depth + 1);
+        } else {
+            u->bytes += st.st_size;
+            u->files++;
+        }
+    }
+    closedir(dir);
+}
+
+static void scan_usage(storage_usage_t usage[CAT_COUNT])
+{
+    for (int i = 0; i < CAT_COUNT; i++) {
+        usage[i] = (storage_usage_t){0};
+        walk(s_categories[i].dir, &usage[i], s_categories[i].skip_hidden, 0);
+    }
+}
+
+static size_t usage_total(const storage_usage_t usage[CAT_COUNT])
+{
+    size_t total = 0;
+    for (int i = 0; i < CAT_COUNT; i++) total += usage[i].bytes;
+    return total;
+}
+
+static int fill_pct(size_t *total, size_t *used)
+{
+    *total = 0;
+    *used = 0;
+    if (fs_backend_info(total, used) != ESP_OK || *total == 0) return 0;
+    return (int)((uint64_t)*used * 100 / *total);
+}
+
+static bool clock_valid(time_t now)
+{
+    return now >= CLOCK_VALID_EPOCH;
+}
+
+/* ── Sessions ─────────────────────────────────────────────────── */
+
+typedef struct {
+    char chat_id[32];
+    size_t bytes;           /* log plus index, summary and temp files */
+    size_t log_bytes;
+    time_t mtime;           /* newest of its files */
+} chat_usage_t;
+
+static bool is_log_name(const char *ext)
+{
+    return strcmp(ext, ".jsonl") == 0 || strcmp(ext, ".bin") == 0;
+}
+
+/* Group the session directory by chat; returns the number of chats */
+static int scan_chats(chat_usage_t *chats, int max)
+{
+    DIR *dir = opendir(MIMI_SPIFFS_SESSION_DIR);
+    if (!dir) return 0;
+
+    int n = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char *ext = strrchr(entry->d_name, '.');
+        size_t id_len = ext ? (size_t)(ext - entry->d_name) : 0;
+        if (id_len == 0 || id_len >= sizeof(chats[0].chat_id)) continue;
+
+        char path[96];
+        snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_SESSION_DIR, entry->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0 || S_ISDIR(st.st_mode)) continue;
+
+        chat_usage_t *c = NULL;
+        for (int i = 0; i < n && !c; i++) {
+            if (strncmp(chats[i].chat_id, entry->d_name, id_len) == 0 &&
+                chats[i].chat_id[id_len] == '\0') {
+                c = &chats[i];
+            }
+        }
+        if (!c) {
+            if (n == max) continue;
+            c = &chats[n++];
+            memset(c, 0, sizeof(*c));
+            memcpy(c->chat_id, entry->d_name, id_len);
+        }
+        c->bytes += st.st_size;
+        if (is_log_name(ext)) c->log_bytes += st.st_size;
+        if (st.st_mtime > c->mtime) c->mtime = st.st_mtime;
+    }
+    closedir(dir);
+    return n;
+}
+
+static int chat_by_age(const void *a, const void *b)
+{
+    time_t ta = ((const chat_usage_t *)a)->mtime;
+    time_t tb = ((const chat_usage_t *)b)->mtime;
+    return (ta > tb) - (ta < tb);
+}
+
+static void retain_sessions(size_t quota, storage_stats_t *st)
+{
+    chat_usage_t *chats = heap_caps_malloc(MIMI_STORAGE_MAX_CHATS * sizeof(chat_usage_t),
+                                           MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!chats) return;
+
+    time_t now = time(NULL);
+    int n = scan_chats(chats, MIMI_STORAGE_MAX_CHATS);
+    for (int i = 0; i < n; i++) {
+        chat_usage_t *c = &chats[i];
+        /* mtime is only meaningful if the file was written after SNTP */
+        if (clock_valid(now) && clock_valid(c->mtime) &&
+            now - c->mtime > (time_t)MIMI_STORAGE_SESSION_MAX_AGE_DAYS * DAY_SECONDS) {
+            if (session_clear(c->chat_id) == ESP_OK) st->sessions_cleared++;
+        } else if (c->log_bytes > MIMI_STORAGE_SESSION_ROTATE) {
+            int dropped = 0;
+            if (session_rotate(c->chat_id, MIMI_STORAGE_SESSION_KEEP, &dropped) == ESP_OK &&
+                dropped > 0) {
+                st->sessions_rotated++;
+            }
+        }
+        vTaskDelay(1);
+    }
+
+    /* Over quota: clear the least recently written, sparing the newest */
+    n = scan_chats(chats, MIMI_STORAGE_MAX_CHATS);
+    size_t total = 0;
+    for (int i = 0; i < n; i++) total += chats[i].bytes;
+    if (total > quota) {
+        qsort(chats, n, sizeof(chat_usage_t), chat_by_age);
+        for (int i = 0; i < n - 1 && total > quota; i++) {
+            if (session_clear(chats[i].chat_id) != ESP_OK) continue;
+            ESP_LOGI(TAG, "Cleared session %s (%u bytes) for quota",
+                     chats[i].chat_id, (unsigned)chats[i].bytes);
+            total -= chats[i].bytes;
+            st->sessions_cleared++;
+        }
+    }
+    free(chats);
+}
+
+/* ── Daily notes ──────────────────────────────────────────────── */
+
+#define NOTE_NAME_LEN   13      /* YYYY-MM-DD.md */
+#define NOTE_MAX        128
+
+typedef struct {
+    char name[NOTE_NAME_LEN + 1];
+    size_t bytes;
+} note_t;
+
+static bool is_note_name(const char *name)
+{
+    if (strlen(name) != NOTE_NAME_LEN || strcmp(name + 10, ".md") != 0) return false;
+    for (int i = 0; i < 10; i++) {
+        bool dash = (i == 4 || i == 7);
+        if (dash ? name[i] != '-' : (name[i] < '0' || name[i] > '9')) return false;
+    }
+    return true;
+}
+
+static int note_by_name(const void *a, const void *b)
+{
+    return strcmp(((const note_t *)a)->name, ((const note_t *)b)->name);
+}
+
+static bool remove_note(const char *name, size_t *total, size_t bytes)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_MEMORY_DIR, name);
+    if (remove(path) != 0) return false;
+    memory_note_write(path);
+    *total -= bytes;
+    return true;
+}
+
+static void retain_notes(size_t quota, storage_stats_t *st)
+{
+    note_t *notes = heap_caps_malloc(NOTE_MAX * sizeof(note_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!notes) return;
+
+    int n = 0;
+    size_t total = 0;
+    DIR *dir = opendir(MIMI_SPIFFS_MEMORY_DIR);
+    struct dirent *entry;
+    while (dir && (entry = readdir(dir)) != NULL) {
+        if (!is_note_name(entry->d_name)) continue;
+        char path[64];
+        snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_MEMORY_DIR, entry->d_name);
+        struct stat sb;
+        if (stat(path, &sb) != 0) continue;
+        total += sb.st_size;
+        if (n < NOTE_MAX) {
+            memcpy(notes[n].name, entry->d_name, NOTE_NAME_LEN + 1);
+            notes[n].bytes = sb.st_size;
+            n++;
+        }
+    }
+    if (dir) closedir(dir);
+    qsort(notes, n, sizeof(note_t), note_by_name);
+
+    /* Names sort by date; compare against the cutoff date's name */
+    char cutoff[NOTE_NAME_LEN + 1] = "";
+    time_t now = time(NULL);
+    if (clock_valid(now)) {
+        time_t t = now - (time_t)MIMI_STORAGE_NOTES_MAX_AGE_DAYS * DAY_SECONDS;
+        struct tm tm;
+        localtime_r(&t, &tm);
+        strftime(cutoff, sizeof(cutoff), "%Y-%m-%d.md", &tm);
+    }
+
+    for (int i = 0; i < n - MIMI_STORAGE_NOTES_MIN_KEEP; i++) {
+        bool expired = cutoff[0] && strcmp(notes[i].name, cutoff) < 0;
+        if (!expired && total <= quota) break;
+        if (remove_note(notes[i].name, &total, notes[i].bytes)) {
+            ESP_LOGI(TAG, "Removed daily note %s", notes[i].name);
+            st->notes_removed++;
+        }
+    }
+    free(notes);
+}
+
+/* ── Retention pass ───────────────────────────────────────────── */
+
+void storage_manager_run(void)
+{
+    if (!s_pass_lock) return;
+    xSemaphoreTake(s_pass_lock, portMAX_DELAY);
+
+    int64_t start = esp_timer_get_time();
+    storage_stats_t st = {0};
+    storage_usage_t before[CAT_COUNT];
+    scan_usage(before);
+
+    size_t total, used;
+    bool pressure = fill_pct(&total, &used) >= MIMI_STORAGE_HIGH_WATER_PCT;
+    int scale = pressure ? 2 : 1;
+
+    retain_sessions(MIMI_STORAGE_SESSION_QUOTA / scale, &st);
+    retain_notes(MIMI_STORAGE_NOTES_QUOTA / scale, &st);
+
+    st.backups_removed = skill_rollback_prune_all(pressure ? 1 : MIMI_STORAGE_BACKUP_KEEP);
+    if (!pressure && before[CAT_BACKUPS].bytes > MIMI_STORAGE_BACKUP_QUOTA) {
+        st.backups_removed += skill_rollback_prune_all(1);
+    }
+    skill_engine_cleanup_staging();
+
+    /* Reclaim deleted pages now rather than inside the next write */
+    if (pressure && fs_backend_gc(MIMI_STORAGE_GC_BYTES) == ESP_OK) {
+        st.gc_runs++;
+    }
+
+    storage_usage_t after[CAT_COUNT];
+    scan_usage(after);
+    size_t was = usage_total(before);
+    size_t now = usage_total(after);
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+
+    xSemaphoreTake(s_stats_lock, portMAX_DELAY);
+    s_stats.passes++;
+    s_stats.sessions_cleared += st.sessions_cleared;
+    s_stats.sessions_rotated += st.sessions_rotated;
+    s_stats.notes_removed += st.notes_removed;
+    s_stats.backups_removed += st.backups_removed;
+    s_stats.gc_runs += st.gc_runs;
+    if (was > now) s_stats.freed_bytes += was - now;
+    s_stats.last_pass_us = esp_timer_get_time();
+    s_stats.last_pass_ms = ms;
+    xSemaphoreGive(s_stats_lock);
+
+    xSemaphoreGive(s_pass_lock);
+
+    if (was > now || pressure) {
+        ESP_LOGI(TAG, "Retention pass: freed %u bytes in %u ms (%d%% full)",
+                 (unsigned)(was > now ? was - now : 0), (unsigned)ms,
+                 total ? (int)((uint64_t)used * 100 / total) : 0);
+    }
+}
+
+static void storage_task(void *arg)
+{
+    vTaskDelay(pdMS_TO_TICKS(MIMI_STORAGE_FIRST_PASS_MS));
+    while (1) {
+        storage_manager_run();
+        vTaskDelay(pdMS_TO_TICKS(MIMI_STORAGE_INTERVAL_MS));
+    }
+}
+
+/* ── Public API ───────────────────────────────────────────────── */
+
+esp_err_t storage_manager_init(void)
+{
+    if (s_pass_lock) return ESP_OK;
+    s_pass_lock = xSemaphoreCreateMutex();
+    s_stats_lock = xSemaphoreCreateMutex();
+    if (!s_pass_lock || !s_stats_lock) return ESP_ERR_NO_MEM;
+
+    /* Low priority and off the agent core: passes only run when idle */
+    if (xTaskCreatePinnedToCore(storage_task, "storage", MIMI_STORAGE_STACK, NULL,
+                                MIMI_STORAGE_PRIO, NULL, MIMI_STORAGE_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create storage task");
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Storage manager started (every %d min)", MIMI_STORAGE_INTERVAL_MS / 60000);
+    return ESP_OK;
+}
+
+char *storage_get_usage_json(void)
+{
+    storage_usage_t usage[CAT_COUNT];
+    scan_usage(usage);
+    size_t total, used;
+    int pct = fill_pct(&total, &used);
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return NULL;
+    cJSON_AddStringToObject(root, "backend", fs_backend_name());
+    cJSON_AddNumberToObject(root, "total", total);
+    cJSON_AddNumberToObject(root, "used", used);
+    cJSON_AddNumberToObject(root, "used_pct", pct);
+    cJSON_AddBoolToObject(root, "pressure", pct >= MIMI_STORAGE_HIGH_WATER_PCT);
+
+    cJSON *cats = cJSON_AddObjectToObject(root, "categories");
+    for (int i = 0; i < CAT_COUNT; i++) {
+        cJSON *c = cJSON_AddObjectToObject(cats, s_categories[i].name);
+        cJSON_AddNumberToObject(c, "bytes", usage[i].bytes);
+        cJSON_AddNumberToObject(c, "files", usage[i].files);
+        if (s_categories[i].quota) cJSON_AddNumberToObject(c, "quota", s_categories[i].quota);
+    }
+    /* Filesystem overhead and files outside the known directories */
+    size_t known = usage_total(usage);
+    cJSON *other = cJSON_AddObjectToObject(cats, "other");
+    cJSON_AddNumberToObject(other, "bytes", used > known ? used - known : 0);
+
+    storage_stats_t st = {0};
+    if (s_stats_lock) {
+        xSemaphoreTake(s_stats_lock, portMAX_DELAY);
+        st = s_stats;
+        xSemaphoreGive(s_stats_lock);
+    }
+    cJSON *ret = cJSON_AddObjectToObject(root, "retention");
+    cJSON_AddNumberToObject(ret, "passes", st.passes);
+    cJSON_AddNumberToObject(ret, "sessions_cleared", st.sessions_cleared);
+    cJSON_AddNumberToObject(ret, "sessions_rotated", st.sessions_rotated);
+    cJSON_AddNumberToObject(ret, "notes_removed", st.notes_removed);
+    cJSON_AddNumberToObject(ret, "backups_removed", st.backups_removed);
+    cJSON_AddNumberToObject(ret, "gc_runs", st.gc_runs);
+    cJSON_AddNumberToObject(ret, "freed_bytes", st.freed_bytes);
+    cJSON_AddNumberToObject(ret, "last_pass_ms", st.last_pass_ms);
+    cJSON_AddNumberToObject(ret, "last_pass_age_s",
+                            st.passes ? (double)((esp_timer_get_time() - st.last_pass_us) / 1000000) : -1);
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "esp_err.h"
+
+/* ── Storage manager ──────────────────────────────────────────────
+ *
+ * Keeps flash from filling up with data that only ever grows: session
+ * logs, daily memory notes, skill rollback copies and leftovers of
+ * interrupted skill installs. A low-priority task on core 0 runs a
+ * retention pass every MIMI_STORAGE_INTERVAL_MS:
+ *
+ *   sessions       cleared after MIMI_STORAGE_SESSION_MAX_AGE_DAYS idle;
+ *                  logs over MIMI_STORAGE_SESSION_ROTATE are rotated;
+ *                  oldest cleared while over MIMI_STORAGE_SESSION_QUOTA
+ *   daily notes    removed after MIMI_STORAGE_NOTES_MAX_AGE_DAYS, oldest
+ *                  first while over MIMI_STORAGE_NOTES_QUOTA
+ *   skill backups  MIMI_STORAGE_BACKUP_KEEP versions per skill, one while
+ *                  over MIMI_STORAGE_BACKUP_QUOTA
+ *   skill staging  temp files removed whenever no install is running
+ *
+ * Above MIMI_STORAGE_HIGH_WATER_PCT fill the quotas are halved and, on
+ * SPIFFS, garbage collection is run from the task, so writers on the
+ * agent path do not pay for it. Age rules wait until the clock has been
+ * set.
+ */
+
+/**
+ * Start the storage manager task.
+ */
+esp_err_t storage_manager_init(void);
+
+/**
+ * Run a retention pass now, in the calling task.
+ */
+void storage_manager_run(void);
+
+/**
+ * Usage by category plus the results of the retention passes, for
+ * /api/storage:
+ * {"backend","total","used","used_pct","pressure","categories":{"sessions":{"bytes",
+ *  "files","quota"},...},"retention":{"passes",...}}
+ * Caller must free().
+ */
+char *storage_get_usage_json(void);
@@ -6,7 +6,6 @@
 #include "esp_event.h"
 #include "esp_system.h"
 #include "esp_heap_caps.h"
-#include "esp_spiffs.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_timer.h"
@@ -19,6 +18,10 @@
 #include "agent/agent_loop.h"
 #include "memory/memory_store.h"
 #include "memory/session_mgr.h"
+#include "memory/storage_manager.h"
+#include "memory/fs_backend.h"
+#include "memory/kv_store.h"
+#include "assets/asset_store.h"
 #include "cli/serial_cli.h"
 #include "tools/tool_registry.h"
 #include "buttons/button_driver.h"
@@ -96,28 +99,6 @@ static esp_err_t init_nvs(void)
     return ret;
 }
 
-static esp_err_t init_spiffs(void)
-{
-    esp_vfs_spiffs_conf_t conf = {
-        .base_path = MIMI_SPIFFS_BASE,
-        .partition_label = NULL,
-        .max_files = 10,
-        .format_if_mount_failed = true,
-    };
-
-    esp_err_t ret = esp_vfs_spiffs_register(&conf);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "SPIFFS mount failed: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    size_t total = 0, used = 0;
-    esp_spiffs_info(NULL, &total, &used);
-    ESP_LOGI(TAG, "SPIFFS: total=%d, used=%d", (int)total, (int)used);
-
-    return ESP_OK;
-}
-
 /* ── System Manager handles Safe Mode & Health ──────────────────── */
 #include "system_manager.h"
 
@@ -197,7 +178,14 @@ void app_main(void)
     system_manager_init();
     
     ESP_ERROR_CHECK(esp_event_loop_create_default());
-    ESP_ERROR_CHECK(init_spiffs());
+    ESP_ERROR_CHECK(fs_backend_init());
+    /* Not fatal: the table is loaded, and a full partition or a log that
+     * would not open is retried by compaction on the next write */
+    esp_err_t kv_err = kv_store_init();
+    if (kv_err != ESP_OK) {
+        ESP_LOGE(TAG, "KV store degraded: %s", esp_err_to_name(kv_err));
+    }
+    asset_store_init();     /* optional: web UI falls back to a stub page */
 
     /* ── Phase 2: Register components ──────────────────────────── */
 
@@ -221,6 +209,9 @@ void app_main(void)
                   llm_proxy_init, NULL, NULL, core_deps);
     comp_register("tool_reg",    COMP_LAYER_CORE, true,  false,
                   tool_registry_init, NULL, NULL, core_deps);
+    const char *storage_deps[] = {"memory", "session", NULL};
+    comp_register("storage",     COMP_LAYER_CORE, false, false,
+                  storage_manager_init, NULL, NULL, storage_deps);
 
     /* Skill engine depends on tool_reg + needs safe mode check */
 #if CONFIG_MIMI_ENABLE_SKILLS
@@ -305,7 +296,7 @@ void app_main(void)
                   api_manager_init, NULL, NULL, api_deps);
 
     /* ── Phase 3: Load config + Initialize all ──────────────────── */
-    comp_load_config();  /* Disable components per /spiffs/config/components.json */
+    comp_load_config();  /* Disable components per the saved config */
     ESP_ERROR_CHECK(comp_init_all());
 
     /* Initialize RGB LED (lazy init in tool, but try here for early boot feedback) */
@@ -63,12 +63,24 @@
 #define MIMI_TG_POLL_CORE            0
 
 /* Agent Loop */
-#define MIMI_AGENT_STACK             (12 * 1024)
+#define MIMI_AGENT_STACK             (12 * 1024)    /* per worker */
+#define MIMI_AGENT_DISPATCH_STACK    (4 * 1024)
 #define MIMI_AGENT_PRIO              6
 #define MIMI_AGENT_CORE              1
-#define MIMI_AGENT_MAX_HISTORY       20
+#define MIMI_AGENT_MAX_HISTORY       40             /* message cap; the token budget usually binds first */
+#define MIMI_AGENT_HISTORY_TOKENS    6000           /* estimated input-token budget for history */
+#define MIMI_AGENT_COMPACT_STACK     (10 * 1024)
+#define MIMI_AGENT_COMPACT_PRIO      3              /* below the workers */
+#define MIMI_AGENT_COMPACT_QUEUE_LEN 4
 #define MIMI_AGENT_MAX_TOOL_ITER     25
+#define MIMI_AGENT_WORKERS           CONFIG_MIMI_AGENT_WORKERS  /* conversations processed concurrently */
+#define MIMI_AGENT_ARENA_SIZE        (40 * 1024)    /* per-worker turn scratch: tool outputs, prompt, reply */
+#define MIMI_LLM_MAX_INFLIGHT        2              /* global cap on concurrent LLM requests */
 #define MIMI_MAX_TOOL_CALLS          4
+#define MIMI_TOOL_WORKERS            2              /* run parallel-safe tool calls concurrently */
+#define MIMI_TOOL_WORKER_STACK       (10 * 1024)
+#define MIMI_TOOL_WORKER_PRIO        MIMI_AGENT_PRIO
+#define MIMI_TOOL_WORKER_CORE        MIMI_AGENT_CORE
 
 /* Timezone (POSIX TZ format) */
 #define MIMI_TIMEZONE                "PST8PDT,M3.2.0,M11.1.0"
@@ -84,9 +96,18 @@
 #define MIMI_OLLAMA_API_URL          "http://localhost:11434/v1/chat/completions"
 #define MIMI_LLM_API_VERSION         "2023-06-01"
 #define MIMI_LLM_STREAM_BUF_SIZE     (32 * 1024)
+#define MIMI_LLM_CONN_POOL_SIZE      2              /* warm TLS sessions kept across calls */
+#ifndef MIMI_LLM_CONN_IDLE_MS
+#define MIMI_LLM_CONN_IDLE_MS        (60 * 1000)    /* close pooled sessions idle this long */
+#endif
+#define MIMI_LLM_TX_CHUNK_SIZE       2048           /* request body is serialized through this */
 
 /* Message Bus */
-#define MIMI_BUS_QUEUE_LEN           8
+#define MIMI_BUS_QUEUE_LEN           8              /* outbound queue */
+#define MIMI_BUS_INBOUND_DEPTH       CONFIG_MIMI_BUS_INBOUND_DEPTH  /* inbound priority inbox slots */
+#ifndef MIMI_BUS_INBOUND_AGE_MS
+#define MIMI_BUS_INBOUND_AGE_MS      500            /* a class waiting this long is served first */
+#endif
 #define MIMI_OUTBOUND_STACK          (6 * 1024)
 #define MIMI_OUTBOUND_PRIO           5
 #define MIMI_OUTBOUND_CORE           0
@@ -96,11 +117,64 @@
 #define MIMI_SPIFFS_CONFIG_DIR       "/spiffs/config"
 #define MIMI_SPIFFS_MEMORY_DIR       "/spiffs/memory"
 #define MIMI_SPIFFS_SESSION_DIR      "/spiffs/sessions"
+#define MIMI_FS_PARTITION_LABEL      "spiffs"       /* mounted at MIMI_SPIFFS_BASE whatever the backend */
+#define MIMI_FS_MAX_FILES            10
+#ifndef MIMI_FS_MIGRATE_RESERVE
+#define MIMI_FS_MIGRATE_RESERVE      (1024 * 1024)  /* PSRAM left free while migrating */
+#endif
+#define MIMI_ASSETS_PARTITION_LABEL  "assets"       /* packed by tools/pack_assets.py */
+#define MIMI_ASSETS_PARTITION_SUBTYPE 0x40
 #define MIMI_MEMORY_FILE             "/spiffs/memory/MEMORY.md"
 #define MIMI_SOUL_FILE               "/spiffs/config/SOUL.md"
 #define MIMI_USER_FILE               "/spiffs/config/USER.md"
 #define MIMI_CONTEXT_BUF_SIZE        (16 * 1024)
-#define MIMI_SESSION_MAX_MSGS        20
+#define MIMI_CONTEXT_REVALIDATE_MS   60000          /* stat prompt sources at most this often */
+#define MIMI_MEMORY_INDEX_FILE       "/spiffs/memory/.index"
+#define MIMI_MEMORY_INDEX_MAX_DOCS   128
+#define MIMI_MEMORY_INDEX_MAX_CHUNKS 2048
+#define MIMI_MEMORY_INDEX_MAX_POSTINGS (32 * 1024)  /* (term, chunk) pairs over all memory files */
+#define MIMI_MEMORY_INDEX_FILE_MAX   (128 * 1024)   /* indexed prefix of one memory file */
+#define MIMI_MEMORY_CHUNK_MAX        512            /* bytes per indexed paragraph */
+#define MIMI_MEMORY_RECALL_TOP_K     4
+#define MIMI_MEMORY_RECALL_BYTES     1536           /* recalled snippets per turn */
+#define MIMI_KV_LOG_FILE             "/spiffs/config/kv.log"
+#define MIMI_KV_SNAP_PREFIX          "/spiffs/config/kv.snap"   /* slots kv.snap0 / kv.snap1 */
+#define MIMI_KV_MAX_KEYS             96
+#define MIMI_KV_VALUE_MAX            1024
+#define MIMI_KV_LOG_COMPACT_BYTES    (16 * 1024)    /* fold the log into a snapshot past this */
+#define MIMI_FILE_STREAM_BLOCK       2048           /* window for grep_file / edit_file */
+#define MIMI_FILE_GREP_MAX_MATCHES   50
+#define MIMI_FILE_EDIT_TMP_SUFFIX    ".tmp~"        /* edit copy, next to the target */
+#define MIMI_FILE_EDIT_BAK_SUFFIX    ".bak~"        /* original while the copy is swapped in */
+#define MIMI_SESSION_MAX_MSGS        40
+#define MIMI_SESSION_TURN_MAX_MSGS   (2 * MIMI_AGENT_MAX_TOOL_ITER + 2)  /* one agent turn, kept whole past the cap */
+#define MIMI_SESSION_CACHE_SLOTS     8              /* hot sessions kept parsed in PSRAM */
+#define MIMI_SESSION_CACHE_BYTES     (128 * 1024)   /* PSRAM budget for cached history */
+#define MIMI_SESSION_FLUSH_MS        1000           /* write-behind batching delay */
+#define MIMI_SESSION_FLUSH_STACK     (4 * 1024)
+#define MIMI_SESSION_FLUSH_PRIO      3
+#define MIMI_SESSION_FLUSH_CORE      0
+#define MIMI_SESSION_TOOL_RESULT_MAX 1024           /* transcript budget per tool input/result */
+#define MIMI_SESSION_SUMMARY_MAX     2048           /* rolling summary length cap */
+
+/* Storage Manager */
+#define MIMI_STORAGE_INTERVAL_MS     (10 * 60 * 1000)  /* retention pass period */
+#define MIMI_STORAGE_FIRST_PASS_MS   (2 * 60 * 1000)   /* stay out of the way during boot */
+#define MIMI_STORAGE_STACK           (4 * 1024)
+#define MIMI_STORAGE_PRIO            1
+#define MIMI_STORAGE_CORE            0
+#define MIMI_STORAGE_HIGH_WATER_PCT  75             /* above this fill, quotas are halved */
+#define MIMI_STORAGE_GC_BYTES        (32 * 1024)    /* SPIFFS GC run ahead of writers under pressure */
+#define MIMI_STORAGE_SESSION_QUOTA   (256 * 1024)
+#define MIMI_STORAGE_SESSION_MAX_AGE_DAYS 30
+#define MIMI_STORAGE_SESSION_ROTATE  (48 * 1024)    /* rotate logs larger than this... */
+#define MIMI_STORAGE_SESSION_KEEP    (16 * 1024)    /* ...down to about this */
+#define MIMI_STORAGE_MAX_CHATS       64             /* sessions considered per pass */
+#define MIMI_STORAGE_NOTES_QUOTA     (64 * 1024)    /* daily memory notes */
+#define MIMI_STORAGE_NOTES_MAX_AGE_DAYS 60
+#define MIMI_STORAGE_NOTES_MIN_KEEP  3              /* newest notes always kept */
+#define MIMI_STORAGE_BACKUP_QUOTA    (96 * 1024)    /* skill rollback copies */
+#define MIMI_STORAGE_BACKUP_KEEP     3              /* versions per skill within quota */
 
 /* Cron Service */
 #define MIMI_CRON_FILE               "/spiffs/config/cron.json"
@@ -164,6 +238,9 @@
 #ifndef CONFIG_MIMI_ENABLE_WEB_UI
 #define CONFIG_MIMI_ENABLE_WEB_UI    1
 #endif
+#ifndef CONFIG_MIMI_ASSETS_PARTITION
+#define CONFIG_MIMI_ASSETS_PARTITION 0
+#endif
 #ifndef CONFIG_MIMI_ENABLE_SKILLS
 #define CONFIG_MIMI_ENABLE_SKILLS    1
 #endif
@@ -182,15 +259,27 @@
 #ifndef CONFIG_MIMI_ENABLE_HTTP_PROXY
 #define CONFIG_MIMI_ENABLE_HTTP_PROXY 1
 #endif
+#if !defined(CONFIG_MIMI_FS_SPIFFS) && !defined(CONFIG_MIMI_FS_LITTLEFS)
+#define CONFIG_MIMI_FS_SPIFFS        1
+#endif
 #ifndef CONFIG_MIMI_ENABLE_ED25519
 #define CONFIG_MIMI_ENABLE_ED25519   1
 #endif
 #ifndef CONFIG_MIMI_ENABLE_MDNS
 #define CONFIG_MIMI_ENABLE_MDNS      1
 #endif
+#ifndef CONFIG_MIMI_AGENT_WORKERS
+#define CONFIG_MIMI_AGENT_WORKERS    2
+#endif
+#ifndef CONFIG_MIMI_BUS_INBOUND_DEPTH
+#define CONFIG_MIMI_BUS_INBOUND_DEPTH 16
+#endif
 #ifndef CONFIG_MIMI_ENABLE_MCP
 #define CONFIG_MIMI_ENABLE_MCP       0
 #endif
+#ifndef CONFIG_MIMI_AUDIO_DSP_PIE
+#define CONFIG_MIMI_AUDIO_DSP_PIE    0
+#endif
 #ifndef CONFIG_MIMI_ENABLE_HA
 #define CONFIG_MIMI_ENABLE_HA        1
 #endif
@@ -201,6 +290,53 @@
 #define CONFIG_MIMI_ENABLE_SSDP      1
 #endif
 
+/* Native MP3 streaming (audio_manager without ESP-ADF) */
+#define MIMI_MP3_IN_RING_SIZE        (32 * 1024)    /* compressed bytes, ~2 s at 128 kbps */
+#define MIMI_MP3_IN_LOW_WATER        (12 * 1024)    /* prefetch before decoding; fetch resumes below */
+#define MIMI_MP3_IN_HIGH_WATER       (28 * 1024)    /* fetch pauses above */
+#define MIMI_MP3_PCM_RING_SIZE       (16 * 1024)    /* mono 16-bit, ~190 ms at 44.1 kHz */
+#define MIMI_MP3_PCM_START           (8 * 1024)     /* PCM queued before the first I2S write */
+#define MIMI_MP3_FETCH_CHUNK         4096
+#define MIMI_MP3_FETCH_STACK         (8 * 1024)     /* TLS handshake runs here */
+#define MIMI_MP3_FETCH_PRIO          3              /* below LwIP / Wi-Fi */
+#define MIMI_MP3_FETCH_CORE          0
+#define MIMI_MP3_DECODE_STACK        (20 * 1024)    /* minimp3 scratch lives on the stack */
+#define MIMI_MP3_DECODE_PRIO         4
+#define MIMI_MP3_DECODE_CORE         1
+#define MIMI_MP3_SINK_STACK          (3 * 1024)
+#define MIMI_MP3_SINK_PRIO           5
+#define MIMI_MP3_SINK_CORE           1
+
+/* Voice: capture and streaming ASR */
+#define MIMI_VOICE_MAX_RECORD_MS     15000          /* hard cap on one utterance */
+#define MIMI_VOICE_NO_SPEECH_MS      5000           /* give up if nothing is said */
+#define MIMI_VOICE_ENDPOINT_MS       800            /* trailing silence that ends it */
+#define MIMI_VAD_FRAME_MS            20
+#define MIMI_VAD_START_MS            120            /* speech before an utterance starts */
+#define MIMI_VAD_WAKE_MS             300            /* idle wake trigger needs longer */
+#define MIMI_VAD_HANGOVER_MS         300            /* gaps inside words stay speech */
+#define MIMI_VAD_SNR_PCT             200            /* speech at 2x the noise floor RMS (6 dB) */
+#define MIMI_VAD_MIN_RMS             300            /* never speech below; seeds the floor */
+#define MIMI_VAD_ZCR_MAX_HZ          3000           /* voiced speech crosses zero less often */
+#define MIMI_ASR_RING_SIZE           (128 * 1024)   /* ~2.7 s at 24 kHz; covers the TLS handshake */
+#define MIMI_ASR_CHUNK_BYTES         2048           /* per chunked-transfer chunk */
+#define MIMI_ASR_TASK_STACK          (8 * 1024)
+#define MIMI_ASR_TASK_PRIO           4
+#define MIMI_ASR_TASK_CORE           0
+
+/* Voice: sentence-pipelined TTS */
+#define MIMI_TTS_RING_SIZE           (64 * 1024)    /* jitter buffer, ~1.4 s at 24 kHz */
+#define MIMI_TTS_JITTER_START        (12 * 1024)    /* ~250 ms queued before speaking */
+#define MIMI_TTS_READ_CHUNK          2048
+#define MIMI_TTS_SENTENCE_MAX        240            /* split longer runs at a space or comma */
+#define MIMI_TTS_QUEUE_LEN           8              /* sentences waiting for synthesis */
+#define MIMI_TTS_FETCH_STACK         (8 * 1024)     /* TLS handshake runs here */
+#define MIMI_TTS_FETCH_PRIO          4
+#define MIMI_TTS_FETCH_CORE          0
+#define MIMI_TTS_PLAY_STACK          (4 * 1024)
+#define MIMI_TTS_PLAY_PRIO           5
+#define MIMI_TTS_PLAY_CORE           1
+
 /* MCP Client */
 #define MIMI_MCP_SERVER_URL          "ws://192.168.1.10:3000"
 #define MIMI_MCP_RECONNECT_MS        5000
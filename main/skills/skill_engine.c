@@ -2497,6 +2497,19 @@ esp_err_t skill_engine_install(const char *url)
     return skill_engine_install_with_checksum(url, NULL);
 }
 
+esp_err_t skill_engine_cleanup_staging(void)
+{
+    /* Never pull files from under a running install */
+    if (s_install_lock && xSemaphoreTake(s_install_lock, 0) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    char staging_dir[512];
+    snprintf(staging_dir, sizeof(staging_dir), "%s/.staging", SKILL_DIR);
+    cleanup_staging_temp(staging_dir);
+    if (s_install_lock) xSemaphoreGive(s_install_lock);
+    return ESP_OK;
+}
+
 esp_err_t skill_engine_uninstall(const char *name)
 {
     if (!name || !name[0]) return ESP_ERR_INVALID_ARG;
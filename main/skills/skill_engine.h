@@ -81,6 +81,12 @@ esp_err_t skill_engine_clear_trusted_key(void);
  */
 bool skill_engine_signature_verification_enabled(void);
 
+/**
+ * Remove temporary files left in the install staging directory by
+ * interrupted installs. Skipped (ESP_ERR_TIMEOUT) while an install runs.
+ */
+esp_err_t skill_engine_cleanup_staging(void);
+
 /**
  * Uninstall a skill by name.
  */
@@ -2,11 +2,13 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <dirent.h>
 #include <sys/stat.h>
 
 #include "esp_log.h"
 #include "cJSON.h"
+#include "memory/kv_store.h"
 
 static const char *TAG = "skill_quota";
 
@@ -55,9 +57,54 @@ static void recalc_total_disk(void)
     }
 }
 
-/* ── JSON persistence ─────────────────────────────────────────────── */
+/* ── Persistence ──────────────────────────────────────────────────── */
 
-static esp_err_t load_from_file(void)
+/* One record per skill, "quota/<name>", in the journaled store. Saving
+ * re-sends every entry, but the store drops writes that change nothing,
+ * so only the skills that moved reach flash. SKILL_QUOTA_FILE is read
+ * once to import what older firmware saved. */
+#define QUOTA_KEY_PREFIX "quota/"
+
+static void entry_from_json(skill_quota_entry_t *e, const cJSON *item)
+{
+    cJSON *v;
+    v = cJSON_GetObjectItem(item, "disk_limit");
+    if (cJSON_IsNumber(v)) e->disk_limit = clamp_i32((int32_t)v->valuedouble, 0, SKILL_QUOTA_MAX_DISK_LIMIT);
+    v = cJSON_GetObjectItem(item, "disk_used");
+    if (cJSON_IsNumber(v)) e->disk_used = (int32_t)v->valuedouble;
+    v = cJSON_GetObjectItem(item, "heap_limit");
+    if (cJSON_IsNumber(v)) e->heap_limit = clamp_i32((int32_t)v->valuedouble, 0, SKILL_QUOTA_MAX_HEAP_LIMIT);
+    v = cJSON_GetObjectItem(item, "heap_peak");
+    if (cJSON_IsNumber(v)) e->heap_peak = (int32_t)v->valuedouble;
+    v = cJSON_GetObjectItem(item, "instr_limit");
+    if (cJSON_IsNumber(v)) e->instr_limit = clamp_i32((int32_t)v->valuedouble, 0, SKILL_QUOTA_MAX_INSTR_LIMIT);
+    v = cJSON_GetObjectItem(item, "instr_last");
+    if (cJSON_IsNumber(v)) e->instr_last = (int32_t)v->valuedouble;
+}
+
+static esp_err_t persist_entry(const skill_quota_entry_t *e)
+{
+    cJSON *item = cJSON_CreateObject();
+    if (!item) return ESP_ERR_NO_MEM;
+    cJSON_AddNumberToObject(item, "disk_limit",  e->disk_limit);
+    cJSON_AddNumberToObject(item, "disk_used",   e->disk_used);
+    cJSON_AddNumberToObject(item, "heap_limit",  e->heap_limit);
+    cJSON_AddNumberToObject(item, "heap_peak",   e->heap_peak);
+    cJSON_AddNumberToObject(item, "instr_limit", e->instr_limit);
+    cJSON_AddNumberToObject(item, "instr_last",  e->instr_last);
+
+    char *str = cJSON_PrintUnformatted(item);
+    cJSON_Delete(item);
+    if (!str) return ESP_ERR_NO_MEM;
+
+    char key[KV_KEY_MAX];
+    snprintf(key, sizeof(key), QUOTA_KEY_PREFIX "%s", e->name);
+    esp_err_t err = kv_store_set_str(key, str);
+    free(str);
+    return err;
+}
+
+static esp_err_t import_legacy_file(void)
 {
     FILE *f = fopen(SKILL_QUOTA_FILE, "r");
     if (!f) {
@@ -100,28 +147,43 @@ static esp_err_t load_from_file(void)
 
             skill_quota_entry_t *e = find_or_create_entry(item->string);
             if (!e) continue;
-
-            cJSON *v;
-            v = cJSON_GetObjectItem(item, "disk_limit");
-            if (cJSON_IsNumber(v)) e->disk_limit = clamp_i32((int32_t)v->valuedouble, 0, SKILL_QUOTA_MAX_DISK_LIMIT);
-            v = cJSON_GetObjectItem(item, "disk_used");
-            if (cJSON_IsNumber(v)) e->disk_used = (int32_t)v->valuedouble;
-            v = cJSON_GetObjectItem(item, "heap_limit");
-            if (cJSON_IsNumber(v)) e->heap_limit = clamp_i32((int32_t)v->valuedouble, 0, SKILL_QUOTA_MAX_HEAP_LIMIT);
-            v = cJSON_GetObjectItem(item, "heap_peak");
-            if (cJSON_IsNumber(v)) e->heap_peak = (int32_t)v->valuedouble;
-            v = cJSON_GetObjectItem(item, "instr_limit");
-            if (cJSON_IsNumber(v)) e->instr_limit = clamp_i32((int32_t)v->valuedouble, 0, SKILL_QUOTA_MAX_INSTR_LIMIT);
-            v = cJSON_GetObjectItem(item, "instr_last");
-            if (cJSON_IsNumber(v)) e->instr_last = (int32_t)v->valuedouble;
+            entry_from_json(e, item);
         }
     }
-
     cJSON_Delete(root);
+
+    if (skill_quota_save() == ESP_OK) remove(SKILL_QUOTA_FILE);
+    ESP_LOGI(TAG, "Imported %d quota entries from %s", s_entry_count, SKILL_QUOTA_FILE);
+    return ESP_OK;
+}
+
+static bool load_entry_cb(const char *key, const void *value, size_t len, void *arg)
+{
+    (void)arg;
+    if (s_entry_count >= SKILL_QUOTA_MAX_ENTRIES) return false;
+
+    cJSON *item = cJSON_ParseWithLength(value, len);
+    skill_quota_entry_t *e = item ? find_or_create_entry(key + strlen(QUOTA_KEY_PREFIX)) : NULL;
+    if (e) {
+        entry_from_json(e, item);
+    } else {
+        ESP_LOGW(TAG, "Skipping unreadable quota record %s", key);
+    }
+    cJSON_Delete(item);
+    return true;
+}
+
+static void load_entries(void)
+{
+    if (!kv_store_has_prefix(QUOTA_KEY_PREFIX)) {
+        import_legacy_file();
+    } else {
+        kv_store_foreach(QUOTA_KEY_PREFIX, load_entry_cb, NULL);
+    }
+
     recalc_total_disk();
     ESP_LOGI(TAG, "Loaded %d quota entries, total disk used: %d bytes",
              s_entry_count, (int)s_total_disk_used);
-    return ESP_OK;
 }
 
 /* ── Public API ──────────────────────────────────────────────────── */
@@ -132,7 +194,7 @@ esp_err_t skill_quota_init(void)
     s_entry_count = 0;
     s_total_disk_used = 0;
 
-    load_from_file();  /* OK if file doesn't exist yet */
+    load_entries();    /* OK if nothing was saved yet */
     return ESP_OK;
 }
 
@@ -172,7 +234,7 @@ void skill_quota_track_disk(const char *skill_name, int32_t bytes_used)
     recalc_total_disk();
 
     /* Auto-save (best effort) */
-    skill_quota_save();
+    persist_entry(e);
 }
 
 int32_t skill_quota_get_instr_limit(const char *skill_name)
@@ -222,7 +284,7 @@ esp_err_t skill_quota_set_limits(const char *skill_name, int32_t disk_limit,
         e->instr_limit = clamp_i32(instr_limit, 1000, SKILL_QUOTA_MAX_INSTR_LIMIT);
     }
 
-    return skill_quota_save();
+    return persist_entry(e);
 }
 
 void skill_quota_remove(const char *skill_name)
@@ -230,6 +292,10 @@ void skill_quota_remove(const char *skill_name)
     if (!skill_name) return;
     for (int i = 0; i < s_entry_count; i++) {
         if (strcmp(s_entries[i].name, skill_name) == 0) {
+            char key[KV_KEY_MAX];
+            snprintf(key, sizeof(key), QUOTA_KEY_PREFIX "%s", skill_name);
+            kv_store_delete(key);
+
             /* Shift remaining entries down */
             for (int j = i; j < s_entry_count - 1; j++) {
                 s_entries[j] = s_entries[j + 1];
@@ -237,7 +303,6 @@ void skill_quota_remove(const char *skill_name)
             s_entry_count--;
             memset(&s_entries[s_entry_count], 0, sizeof(skill_quota_entry_t));
             recalc_total_disk();
-            skill_quota_save();
             return;
         }
     }
@@ -245,44 +310,18 @@ void skill_quota_remove(const char *skill_name)
 
 esp_err_t skill_quota_save(void)
 {
-    cJSON *root = cJSON_CreateObject();
-    if (!root) return ESP_ERR_NO_MEM;
-
-    cJSON *skills = cJSON_CreateObject();
-    cJSON_AddItemToObject(root, "skills", skills);
-
+    esp_err_t ret = ESP_OK;
     for (int i = 0; i < s_entry_count; i++) {
-        skill_quota_entry_t *e = &s_entries[i];
-        cJSON *item = cJSON_CreateObject();
-        cJSON_AddNumberToObject(item, "disk_limit",  e->disk_limit);
-        cJSON_AddNumberToObject(item, "disk_used",   e->disk_used);
-        cJSON_AddNumberToObject(item, "heap_limit",  e->heap_limit);
-        cJSON_AddNumberToObject(item, "heap_peak",   e->heap_peak);
-        cJSON_AddNumberToObject(item, "instr_limit", e->instr_limit);
-        cJSON_AddNumberToObject(item, "instr_last",  e->instr_last);
-        cJSON_AddItemToObject(skills, e->name, item);
-    }
-
-    cJSON_AddNumberToObject(root, "total_disk_used",  s_total_disk_used);
-    cJSON_AddNumberToObject(root, "total_disk_limit", SKILL_QUOTA_TOTAL_DISK_LIMIT);
-
-    char *str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    if (!str) return ESP_ERR_NO_MEM;
-
-    FILE *f = fopen(SKILL_QUOTA_FILE, "w");
-    if (!f) {
-        free(str);
-        ESP_LOGE(TAG, "Failed to open quota file for writing");
-        return ESP_FAIL;
+        esp_err_t err = persist_entry(&s_entries[i]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to save quota for %s: %s",
+                     s_entries[i].name, esp_err_to_name(err));
+            ret = err;
+        }
     }
 
-    fputs(str, f);
-    fclose(f);
-    free(str);
-
     ESP_LOGD(TAG, "Quota saved (%d entries)", s_entry_count);
-    return ESP_OK;
+    return ret;
 }
 
 const skill_quota_entry_t *skill_quota_get(const char *skill_name)
@@ -94,7 +94,7 @@ esp_err_t skill_quota_set_limits(const char *skill_name, int32_t disk_limit,
 void skill_quota_remove(const char *skill_name);
 
 /**
- * Persist current quota state to SPIFFS.
+ * Persist current quota state to the config store.
  */
 esp_err_t skill_quota_save(void);
 
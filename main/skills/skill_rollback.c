@@ -6,6 +6,7 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <time.h>
+#include <stdbool.h>
 #include "esp_log.h"
 #include "cJSON.h"
 
@@ -14,6 +15,7 @@ static const char *TAG = "skill_rollback";
 #define SKILL_BASE_DIR "/spiffs/skills"
 #define ROLLBACK_DIR   "/spiffs/skills/.rollback"
 #define MAX_BACKUPS    3
+#define MAX_PRUNE_SKILLS 32
 
 static void ensure_rollback_dir(const char *skill_name)
 {
@@ -84,7 +86,7 @@ esp_err_t skill_rollback_backup(const char *skill_name)
     /* Manifest is optional but good to have */
     copy_file(src_manifest, dst_manifest);
 
-    // TODO: implement pruning of old backups (MAX_BACKUPS)
+    skill_rollback_prune(skill_name, MAX_BACKUPS);
 
     return ESP_OK;
 }
@@ -144,3 +146,79 @@ char *skill_rollback_list_json(const char *skill_name)
     cJSON_Delete(root);
     return json;
 }
+
+/* Find the oldest backup version of a skill; returns the number of versions */
+static int find_oldest_version(const char *dir_path, char *oldest, size_t size)
+{
+    DIR *d = opendir(dir_path);
+    if (!d) return 0;
+
+    int count = 0;
+    oldest[0] = '\0';
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (strncmp(entry->d_name, "main.lua.", 9) != 0) continue;
+        /* Versions are timestamps, so they sort by name */
+        const char *ver = entry->d_name + 9;
+        if (count == 0 || strcmp(ver, oldest) < 0) {
+            snprintf(oldest, size, "%s", ver);
+        }
+        count++;
+    }
+    closedir(d);
+    return count;
+}
+
+int skill_rollback_prune(const char *skill_name, int keep)
+{
+    char dir_path[128];
+    snprintf(dir_path, sizeof(dir_path), "%s/%s", ROLLBACK_DIR, skill_name);
+    if (keep < 0) keep = 0;
+
+    int removed = 0;
+    char version[64];
+    while (find_oldest_version(dir_path, version, sizeof(version)) > keep) {
+        char path[192];
+        snprintf(path, sizeof(path), "%s/main.lua.%s", dir_path, version);
+        if (remove(path) != 0) break;
+        snprintf(path, sizeof(path), "%s/manifest.json.%s", dir_path, version);
+        remove(path);
+        ESP_LOGI(TAG, "Pruned backup '%s' of '%s'", version, skill_name);
+        removed++;
+    }
+    if (keep == 0) rmdir(dir_path);
+    return removed;
+}
+
+int skill_rollback_prune_all(int keep)
+{
+    /* Collect names first: removing files while reading the directory is
+     * not safe on every filesystem */
+    char names[MAX_PRUNE_SKILLS][32];
+    int n = 0;
+
+    DIR *d = opendir(ROLLBACK_DIR);
+    if (!d) return 0;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL && n < MAX_PRUNE_SKILLS) {
+        if (entry->d_name[0] == '.') continue;
+        /* SPIFFS is flat and lists "<skill>/main.lua.<ver>" here */
+        size_t len = strcspn(entry->d_name, "/");
+        if (len == 0 || len >= sizeof(names[0])) continue;
+        bool seen = false;
+        for (int i = 0; i < n && !seen; i++) {
+            seen = strncmp(names[i], entry->d_name, len) == 0 && names[i][len] == '\0';
+        }
+        if (seen) continue;
+        memcpy(names[n], entry->d_name, len);
+        names[n][len] = '\0';
+        n++;
+    }
+    closedir(d);
+
+    int removed = 0;
+    for (int i = 0; i < n; i++) {
+        removed += skill_rollback_prune(names[i], keep);
+    }
+    return removed;
+}
@@ -24,3 +24,15 @@ esp_err_t skill_rollback_restore(const char *skill_name, const char *version);
  * @return JSON string or NULL on error
  */
 char *skill_rollback_list_json(const char *skill_name);
+
+/**
+ * Delete the oldest backups of a skill until at most `keep` remain.
+ * @return Number of backup versions removed
+ */
+int skill_rollback_prune(const char *skill_name, int keep);
+
+/**
+ * Prune the backups of every skill in the rollback directory.
+ * @return Number of backup versions removed
+ */
+int skill_rollback_prune_all(int keep);
@@ -9,6 +9,8 @@
 #include "cJSON.h"
 #include "esp_system.h"
 #include "esp_heap_caps.h"
+#include "llm/llm_proxy.h"
+#include "memory/session_mgr.h"
 
 #define TAG "SYS_MGR"
 #define NVS_NAMESPACE "system"
@@ -129,6 +131,49 @@ char *system_get_health_json(void)
     cJSON_AddNumberToObject(root, "free_psram", heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
 #endif
 
+    // LLM keep-alive connection pool
+    llm_conn_pool_stats_t pool;
+    llm_get_conn_pool_stats(&pool);
+    cJSON *llm_pool = cJSON_AddObjectToObject(root, "llm_pool");
+    cJSON_AddNumberToObject(llm_pool, "hits", pool.hits);
+    cJSON_AddNumberToObject(llm_pool, "misses", pool.misses);
+    cJSON_AddNumberToObject(llm_pool, "reconnects", pool.reconnects);
+    cJSON_AddNumberToObject(llm_pool, "evictions", pool.evictions);
+    cJSON_AddNumberToObject(llm_pool, "open", pool.open);
+
+    // LLM prompt cache
+    llm_cache_stats_t cache;
+    llm_get_cache_stats(&cache);
+    uint64_t prompt_tokens = cache.input_tokens + cache.cache_write_tokens + cache.cache_read_tokens;
+    cJSON *llm_cache = cJSON_AddObjectToObject(root, "llm_cache");
+    cJSON_AddNumberToObject(llm_cache, "requests", cache.requests);
+    cJSON_AddNumberToObject(llm_cache, "hits", cache.cache_hits);
+    cJSON_AddNumberToObject(llm_cache, "input_tokens", (double)cache.input_tokens);
+    cJSON_AddNumberToObject(llm_cache, "cache_write_tokens", (double)cache.cache_write_tokens);
+    cJSON_AddNumberToObject(llm_cache, "cache_read_tokens", (double)cache.cache_read_tokens);
+    cJSON_AddNumberToObject(llm_cache, "output_tokens", (double)cache.output_tokens);
+    cJSON_AddNumberToObject(llm_cache, "hit_ratio",
+                            cache.requests ? (double)cache.cache_hits / cache.requests : 0);
+    cJSON_AddNumberToObject(llm_cache, "token_hit_ratio",
+                            prompt_tokens ? (double)cache.cache_read_tokens / prompt_tokens : 0);
+
+    // Session history cache
+    session_cache_stats_t sess;
+    session_get_cache_stats(&sess);
+    cJSON *sessions = cJSON_AddObjectToObject(root, "session_cache");
+    cJSON_AddNumberToObject(sessions, "hits", sess.hits);
+    cJSON_AddNumberToObject(sessions, "misses", sess.misses);
+    cJSON_AddNumberToObject(sessions, "evictions", sess.evictions);
+    cJSON_AddNumberToObject(sessions, "sessions", sess.sessions);
+    cJSON_AddNumberToObject(sessions, "max_sessions", MIMI_SESSION_CACHE_SLOTS);
+    cJSON_AddNumberToObject(sessions, "bytes", sess.bytes);
+    cJSON_AddNumberToObject(sessions, "max_bytes", MIMI_SESSION_CACHE_BYTES);
+    cJSON_AddNumberToObject(sessions, "pending_writes", sess.pending);
+    cJSON_AddNumberToObject(sessions, "flushes", sess.flushes);
+    cJSON_AddNumberToObject(sessions, "write_errors", sess.write_errors);
+    cJSON_AddNumberToObject(sessions, "compactions", sess.compactions);
+    cJSON_AddNumberToObject(sessions, "rotations", sess.rotations);
+
     char *json_str = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
     return json_str;
@@ -227,7 +227,8 @@ static esp_err_t api_provider_execute_tool(const char *tool_name, const char *in
 static const tool_provider_t s_api_provider = {
     .name = "api_skills",
     .get_tools_json = api_provider_get_tools_json,
-    .execute_tool = api_provider_execute_tool
+    .execute_tool = api_provider_execute_tool,
+    .parallel_safe = true
 };
 
 /* ── Init ──────────────────────────────────────────────────────────── */
@@ -48,6 +48,34 @@ static esp_err_t tool_audio_stop(const char *input, char *output, size_t out_len
     return ESP_OK;
 }
 
+/* -------------------------------------------------------------------------
+ * Tool: audio_status
+ * Input: {}
+ * ------------------------------------------------------------------------- */
+static esp_err_t tool_audio_status(const char *input, char *output, size_t out_len)
+{
+    (void)input;
+    mp3_stream_stats_t st;
+    if (audio_manager_get_stream_stats(&st) != ESP_OK) {
+        snprintf(output, out_len, "%s (no stream telemetry with ESP-ADF)",
+                 audio_manager_is_playing() ? "Playing" : "Idle");
+        return ESP_OK;
+    }
+
+    snprintf(output, out_len,
+             "%s. Input buffer %u/%u bytes (lowest %u), PCM buffer %u/%u bytes. "
+             "Fetched %u bytes, decoded %u frames at %d Hz, avg %u us/frame (max %u). "
+             "Underruns: input %u, output %u.",
+             audio_manager_is_playing() ? "Playing" : "Idle (last stream)",
+             (unsigned)st.in_level, (unsigned)st.in_size, (unsigned)st.in_level_min,
+             (unsigned)st.pcm_level, (unsigned)st.pcm_size,
+             (unsigned)st.bytes_fetched, (unsigned)st.frames_decoded, st.sample_rate,
+             (unsigned)(st.frames_decoded ? st.decode_us_total / st.frames_decoded : 0),
+             (unsigned)st.decode_us_max,
+             (unsigned)st.in_underruns, (unsigned)st.pcm_underruns);
+    return ESP_OK;
+}
+
 /* -------------------------------------------------------------------------
  * Tool: audio_volume
  * Input: {"volume": 50}
@@ -234,6 +262,12 @@ void register_audio_tools(void)
         .input_schema_json = "{\"type\":\"object\",\"properties\":{},\"required\":[]}",
         .execute = tool_audio_stop,
     };
+    static const mimi_tool_t tool_status = {
+        .name = "audio_status",
+        .description = "Report playback state, stream buffer levels and underrun counts.",
+        .input_schema_json = "{\"type\":\"object\",\"properties\":{},\"required\":[]}",
+        .execute = tool_audio_status,
+    };
     static const mimi_tool_t tool_volume = {
         .name = "audio_volume",
         .description = "Set audio volume. Input: {\"volume\": 0-100}.",
@@ -255,6 +289,7 @@ void register_audio_tools(void)
 
     tool_registry_register(&tool_play_url);
     tool_registry_register(&tool_stop);
+    tool_registry_register(&tool_status);
     tool_registry_register(&tool_volume);
     tool_registry_register(&tool_test);
     tool_registry_register(&tool_test_mic);
@@ -1,20 +1,37 @@
 #include "tools/tool_files.h"
 #include "mimi_config.h"
+#include "memory/memory_store.h"
+#include "memory/fs_backend.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <stdbool.h>
 #include <dirent.h>
 #include <sys/stat.h>
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "cJSON.h"
 #include <stdbool.h>
 
 static const char *TAG = "tool_files";
 
-#define MAX_FILE_SIZE (32 * 1024)
+/* write_file and edit_file run on any agent worker; edits copy the whole
+ * file, so two at once on one path would lose one of them */
+static SemaphoreHandle_t s_write_lock;
+
+static void write_lock(void)
+{
+    if (s_write_lock) xSemaphoreTake(s_write_lock, portMAX_DELAY);
+}
+
+static void write_unlock(void)
+{
+    if (s_write_lock) xSemaphoreGive(s_write_lock);
+}
 
 /**
  * Validate that a path starts with /spiffs/ and contains no ".." traversal.
@@ -27,8 +44,140 @@ static bool validate_path(const char *path)
     return true;
 }
 
+/* ── Streaming helpers ─────────────────────────────────────── */
+
+/* Room kept at the end of output for the continuation note */
+#define NOTE_RESERVE  112
+
+static long file_length(FILE *f)
+{
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    return size;
+}
+
+/* Shorten n so buf does not end inside a UTF-8 sequence */
+static size_t utf8_trim(const char *buf, size_t n)
+{
+    for (size_t back = 1; back <= 4 && back <= n; back++) {
+        unsigned char c = (unsigned char)buf[n - back];
+        if ((c & 0xC0) == 0x80) continue;           /* continuation byte */
+        size_t need = (c >= 0xF0) ? 4 : (c >= 0xE0) ? 3 : (c >= 0xC0) ? 2 : 1;
+        return (need > back) ? n - back : n;
+    }
+    return n;
+}
+
+static bool bytes_equal(const char *a, const char *b, size_t n, bool icase)
+{
+    if (!icase) return memcmp(a, b, n) == 0;
+    for (size_t i = 0; i < n; i++) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+    }
+    return true;
+}
+
+static const char *find_bytes(const char *hay, size_t hay_len,
+                              const char *needle, size_t needle_len, bool icase)
+{
+    if (needle_len == 0 || hay_len < needle_len) return NULL;
+    for (size_t i = 0; i + needle_len <= hay_len; i++) {
+        if (bytes_equal(hay + i, needle, needle_len, icase)) return hay + i;
+    }
+    return NULL;
+}
+
+static long json_long(const cJSON *root, const char *key, long def)
+{
+    cJSON *v = cJSON_GetObjectItem(root, key);
+    return cJSON_IsNumber(v) ? (long)v->valuedouble : def;
+}
+
 /* ── read_file ─────────────────────────────────────────────── */
 
+/* Byte range straight into output; no staging buffer */
+static void read_byte_range(FILE *f, long offset, long length, char *output, size_t output_size)
+{
+    long size = file_length(f);
+    if (offset < 0) offset = 0;
+    if (offset > size) offset = size;
+
+    size_t room = output_size > NOTE_RESERVE ? output_size - NOTE_RESERVE - 1 : 0;
+    size_t want = (size_t)(size - offset);
+    if (length > 0 && (size_t)length < want) want = (size_t)length;
+    if (want > room) want = room;
+
+    fseek(f, offset, SEEK_SET);
+    size_t n = fread(output, 1, want, f);
+    long end = offset + (long)n;
+    if (end < size) n = utf8_trim(output, n);
+    end = offset + (long)n;
+    output[n] = '\0';
+
+    if (end < size) {
+        snprintf(output + n, output_size - n,
+                 "\n[bytes %ld-%ld of %ld; continue with offset=%ld]",
+                 offset, end, size, end);
+    }
+}
+
+/* Lines [start, end] (1-based, end 0 = as many as fit) */
+static void read_line_range(FILE *f, long start, long end, char *output, size_t output_size)
+{
+    char skip[256];
+    long line = 1;
+
+    /* Skip ahead through a small window; long lines take several reads */
+    while (line < start && fgets(skip, sizeof(skip), f)) {
+        if (strchr(skip, '\n')) line++;
+    }
+    if (line < start) {
+        snprintf(output, output_size, "Error: start_line %ld is past the end of the file", start);
+        return;
+    }
+
+    size_t room = output_size > NOTE_RESERVE ? output_size - NOTE_RESERVE - 1 : 0;
+    size_t off = 0;
+    output[0] = '\0';
+    while (end <= 0 || line <= end) {
+        long line_pos = ftell(f);
+        size_t line_off = off;
+        if (off + 1 >= room || !fgets(output + off, (int)(room - off), f)) break;
+        off += strlen(output + off);
+        if (output[off - 1] == '\n') {
+            line++;
+            continue;
+        }
+        if (feof(f)) {          /* last line without a newline */
+            line++;
+            break;
+        }
+
+        /* Output full mid-line: drop the partial line unless it is the only one */
+        if (line_off > 0) {
+            off = line_off;
+            output[off] = '\0';
+            snprintf(output + off, output_size - off,
+                     "[lines %ld-%ld; continue with start_line=%ld]", start, line - 1, line);
+        } else {
+            off = utf8_trim(output, off);
+            output[off] = '\0';
+            snprintf(output + off, output_size - off,
+                     "\n[line %ld is longer than the output; continue with offset=%ld]",
+                     line, line_pos + (long)off);
+        }
+        return;
+    }
+
+    if (off == 0) {
+        snprintf(output, output_size, "(no lines in range)");
+    } else if (!feof(f) && (end <= 0 || line <= end)) {
+        snprintf(output + off, output_size - off,
+                 "[lines %ld-%ld; continue with start_line=%ld]", start, line - 1, line);
+    }
+}
+
 esp_err_t tool_read_file_execute(const char *input_json, char *output, size_t output_size)
 {
     cJSON *root = cJSON_Parse(input_json);
@@ -51,14 +200,125 @@ esp_err_t tool_read_file_execute(const char *input_json, char *output, size_t ou
         return ESP_ERR_NOT_FOUND;
     }
 
-    size_t max_read = output_size - 1;
-    if (max_read > MAX_FILE_SIZE) max_read = MAX_FILE_SIZE;
+    long start_line = json_long(root, "start_line", 0);
+    if (start_line > 0) {
+        read_line_range(f, start_line, json_long(root, "end_line", 0), output, output_size);
+    } else {
+        read_byte_range(f, json_long(root, "offset", 0), json_long(root, "length", 0),
+                        output, output_size);
+    }
+    fclose(f);
+
+    ESP_LOGI(TAG, "read_file: %s (%d bytes out)", path, (int)strlen(output));
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+/* ── grep_file ─────────────────────────────────────────────── */
 
-    size_t n = fread(output, 1, max_read, f);
-    output[n] = '\0';
+#define GREP_DEFAULT_MATCHES  20
+#define GREP_SHOW_BYTES       160     /* text shown per matching line */
+#define GREP_SHOW_BEFORE      48      /* of which before the match */
+
+esp_err_t tool_grep_file_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *root = cJSON_Parse(input_json);
+    if (!root) {
+        snprintf(output, output_size, "Error: invalid JSON input");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const char *path = cJSON_GetStringValue(cJSON_GetObjectItem(root, "path"));
+    const char *pattern = cJSON_GetStringValue(cJSON_GetObjectItem(root, "pattern"));
+    bool icase = cJSON_IsTrue(cJSON_GetObjectItem(root, "ignore_case"));
+    long max_matches = json_long(root, "max_matches", GREP_DEFAULT_MATCHES);
+    if (max_matches <= 0 || max_matches > MIMI_FILE_GREP_MAX_MATCHES) {
+        max_matches = MIMI_FILE_GREP_MAX_MATCHES;
+    }
+
+    if (!validate_path(path)) {
+        snprintf(output, output_size, "Error: path must start with /spiffs/ and must not contain '..'");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t plen = pattern ? strlen(pattern) : 0;
+    if (plen == 0 || plen >= MIMI_FILE_STREAM_BLOCK) {
+        snprintf(output, output_size, "Error: 'pattern' must be 1-%d bytes", MIMI_FILE_STREAM_BLOCK - 1);
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        snprintf(output, output_size, "Error: file not found: %s", path);
+        cJSON_Delete(root);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* One window, plus the tail of the previous one so a match split
+     * across reads of an overlong line is still seen */
+    char *win = heap_caps_malloc(MIMI_FILE_STREAM_BLOCK + plen, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!win) {
+        fclose(f);
+        snprintf(output, output_size, "Error: out of memory");
+        cJSON_Delete(root);
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t room = output_size > NOTE_RESERVE ? output_size - NOTE_RESERVE : 0;
+    size_t off = 0;
+    long line = 1, hits = 0, shown = 0;
+    size_t carry = 0;
+    bool line_hit = false;
+    output[0] = '\0';
+
+    while (fgets(win + carry, MIMI_FILE_STREAM_BLOCK, f)) {
+        size_t n = carry + strlen(win + carry);
+        bool eol = n > 0 && win[n - 1] == '\n';
+        size_t text_len = eol ? n - 1 : n;
+
+        const char *m = line_hit ? NULL : find_bytes(win, text_len, pattern, plen, icase);
+        if (m) {
+            line_hit = true;
+            hits++;
+            if (shown < max_matches && off + 32 < room) {
+                size_t from = (size_t)(m - win);
+                from = from > GREP_SHOW_BEFORE ? from - GREP_SHOW_BEFORE : 0;
+                while (from > 0 && ((unsigned char)win[from] & 0xC0) == 0x80) from--;
+                size_t show = text_len - from;
+                if (show > GREP_SHOW_BYTES) show = utf8_trim(win + from, GREP_SHOW_BYTES);
+                int w = snprintf(output + off, room - off, "%ld: %.*s\n", line, (int)show, win + from);
+                if (w > 0 && off + (size_t)w < room) {
+                    off += (size_t)w;
+                    shown++;
+                } else {
+                    output[off] = '\0';
+                }
+            }
+        }
+
+        if (eol) {
+            line++;
+            carry = 0;
+            line_hit = false;
+        } else {
+            carry = n < plen - 1 ? n : plen - 1;
+            memmove(win, win + n - carry, carry);
+        }
+    }
     fclose(f);
+    free(win);
+
+    if (hits == 0) {
+        snprintf(output, output_size, "No matches for \"%s\" in %s", pattern, path);
+    } else if (shown < hits) {
+        snprintf(output + off, output_size - off,
+                 "[%ld matching lines, %ld shown; narrow the pattern or read by line]", hits, shown);
+    } else {
+        snprintf(output + off, output_size - off, "[%ld matching lines]", hits);
+    }
 
-    ESP_LOGI(TAG, "read_file: %s (%d bytes)", path, (int)n);
+    ESP_LOGI(TAG, "grep_file: %s \"%s\" (%ld hits)", path, pattern, hits);
     cJSON_Delete(root);
     return ESP_OK;
 }
@@ -87,8 +347,10 @@ esp_err_t tool_write_file_execute(const char *input_json, char *output, size_t o
         return ESP_ERR_INVALID_ARG;
     }
 
-    FILE *f = fopen(path, "w");
+    write_lock();
+    FILE *f = fs_backend_ensure_parent(path) ? fopen(path, "w") : NULL;
     if (!f) {
+        write_unlock();
         snprintf(output, output_size, "Error: cannot open file for writing: %s", path);
         cJSON_Delete(root);
         return ESP_FAIL;
@@ -97,6 +359,8 @@ esp_err_t tool_write_file_execute(const char *input_json, char *output, size_t o
     size_t len = strlen(content);
     size_t written = fwrite(content, 1, len, f);
     fclose(f);
+    write_unlock();
+    memory_note_write(path);
 
     if (written != len) {
         snprintf(output, output_size, "Error: wrote %d of %d bytes to %s", (int)written, (int)len, path);
@@ -112,6 +376,76 @@ esp_err_t tool_write_file_execute(const char *input_json, char *output, size_t o
 
 /* ── edit_file ─────────────────────────────────────────────── */
 
+static bool write_all(FILE *f, const char *buf, size_t len)
+{
+    return len == 0 || fwrite(buf, 1, len, f) == len;
+}
+
+/* Copy `in` to `out` through one window, replacing old_str. The window
+ * holds a block plus old_len bytes so a match across two reads is found.
+ * @return Replacements made, or -1 on a write error */
+static int stream_replace(FILE *in, FILE *out, char *win,
+                          const char *old_str, size_t old_len,
+                          const char *new_str, size_t new_len, bool all)
+{
+    size_t cap = MIMI_FILE_STREAM_BLOCK + old_len;
+    size_t have = 0;
+    int replaced = 0;
+    bool done = false;
+
+    for (;;) {
+        have += fread(win + have, 1, cap - have, in);
+        bool eof = feof(in) || ferror(in);
+
+        size_t from = 0;
+        while (!done) {
+            const char *hit = find_bytes(win + from, have - from, old_str, old_len, false);
+            if (!hit) break;
+            size_t at = (size_t)(hit - win);
+            if (!write_all(out, win + from, at - from) || !write_all(out, new_str, new_len)) {
+                return -1;
+            }
+            from = at + old_len;
+            replaced++;
+            if (!all) done = true;
+        }
+
+        /* Hold back a tail that may be the start of a match */
+        size_t keep = 0;
+        if (!done && !eof) {
+            keep = have - from < old_len - 1 ? have - from : old_len - 1;
+        }
+        if (!write_all(out, win + from, have - from - keep)) return -1;
+        memmove(win, win + have - keep, keep);
+        have = keep;
+
+        if (eof) break;
+    }
+    return replaced;
+}
+
+/* The edit copy and the original during the swap sit next to the
+ * target, so a reset part way through can be undone at boot */
+static bool edit_side_path(const char *path, const char *suffix, char *buf, size_t size)
+{
+    return (size_t)snprintf(buf, size, "%s%s", path, suffix) < size;
+}
+
+/* Put tmp in place of path, keeping the original until the swap is done */
+static bool swap_in(const char *tmp, const char *path)
+{
+    char bak[128];
+    if (!edit_side_path(path, MIMI_FILE_EDIT_BAK_SUFFIX, bak, sizeof(bak))) return false;
+    remove(bak);
+    if (rename(path, bak) != 0) return false;
+    if (rename(tmp, path) != 0) {
+        (void)rename(bak, path);
+        return false;
+    }
+    remove(bak);
+    return true;
+}
+
 esp_err_t tool_edit_file_execute(const char *input_json, char *output, size_t output_size)
 {
     cJSON *root = cJSON_Parse(input_json);
@@ -123,98 +457,171 @@ esp_err_t tool_edit_file_execute(const char *input_json, char *output, size_t ou
     const char *path = cJSON_GetStringValue(cJSON_GetObjectItem(root, "path"));
     const char *old_str = cJSON_GetStringValue(cJSON_GetObjectItem(root, "old_string"));
     const char *new_str = cJSON_GetStringValue(cJSON_GetObjectItem(root, "new_string"));
+    bool all = cJSON_IsTrue(cJSON_GetObjectItem(root, "replace_all"));
 
     if (!validate_path(path)) {
         snprintf(output, output_size, "Error: path must start with /spiffs/ and must not contain '..'");
         cJSON_Delete(root);
         return ESP_ERR_INVALID_ARG;
     }
-    if (!old_str || !new_str) {
+    if (!old_str || !new_str || !old_str[0]) {
         snprintf(output, output_size, "Error: missing 'old_string' or 'new_string' field");
         cJSON_Delete(root);
         return ESP_ERR_INVALID_ARG;
     }
 
-    /* Read existing file */
-    FILE *f = fopen(path, "r");
-    if (!f) {
-        snprintf(output, output_size, "Error: file not found: %s", path);
+    char tmp[128];
+    if (!edit_side_path(path, MIMI_FILE_EDIT_TMP_SUFFIX, tmp, sizeof(tmp))) {
+        snprintf(output, output_size, "Error: path too long: %s", path);
         cJSON_Delete(root);
-        return ESP_ERR_NOT_FOUND;
+        return ESP_ERR_INVALID_ARG;
     }
 
-    fseek(f, 0, SEEK_END);
-    long file_size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    if (file_size <= 0 || file_size > MAX_FILE_SIZE) {
-        snprintf(output, output_size, "Error: file too large or empty (%ld bytes)", file_size);
-        fclose(f);
+    write_lock();
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        write_unlock();
+        snprintf(output, output_size, "Error: file not found: %s", path);
         cJSON_Delete(root);
-        return ESP_ERR_INVALID_SIZE;
+        return ESP_ERR_NOT_FOUND;
     }
 
-    /* Allocate buffer for the result (old content + possible expansion) */
     size_t old_len = strlen(old_str);
     size_t new_len = strlen(new_str);
-    size_t max_result = file_size + (new_len > old_len ? new_len - old_len : 0) + 1;
-    char *buf = heap_caps_malloc(file_size + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    char *result = heap_caps_malloc(max_result, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!buf || !result) {
-        free(buf);
-        free(result);
-        fclose(f);
-        snprintf(output, output_size, "Error: out of memory");
+    char *win = heap_caps_malloc(MIMI_FILE_STREAM_BLOCK + old_len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    FILE *out = win ? fopen(tmp, "w") : NULL;
+    if (!out) {
+        write_unlock();
+        free(win);
+        fclose(in);
+        snprintf(output, output_size, win ? "Error: cannot create temp file" : "Error: out of memory");
         cJSON_Delete(root);
-        return ESP_ERR_NO_MEM;
+        return win ? ESP_FAIL : ESP_ERR_NO_MEM;
     }
 
-    size_t n = fread(buf, 1, file_size, f);
-    buf[n] = '\0';
-    fclose(f);
-
-    /* Find and replace first occurrence */
-    char *pos = strstr(buf, old_str);
-    if (!pos) {
+    int replaced = stream_replace(in, out, win, old_str, old_len, new_str, new_len, all);
+    bool read_err = ferror(in);
+    fclose(in);
+    free(win);
+    if (fclose(out) != 0) replaced = -1;
+
+    esp_err_t ret = ESP_OK;
+    if (replaced < 0 || read_err) {
+        snprintf(output, output_size, "Error: copy failed (storage full?); %s unchanged", path);
+        ret = ESP_FAIL;
+    } else if (replaced == 0) {
         snprintf(output, output_size, "Error: old_string not found in %s", path);
-        free(buf);
-        free(result);
+        ret = ESP_ERR_NOT_FOUND;
+    } else if (!swap_in(tmp, path)) {
+        snprintf(output, output_size, "Error: cannot replace %s", path);
+        ret = ESP_FAIL;
+    }
+    if (ret != ESP_OK) remove(tmp);
+    write_unlock();
+    if (ret != ESP_OK) {
         cJSON_Delete(root);
-        return ESP_ERR_NOT_FOUND;
+        return ret;
     }
+    memory_note_write(path);
+
+    snprintf(output, output_size, "OK: edited %s (%d replacement%s of %d bytes with %d bytes)",
+             path, replaced, replaced == 1 ? "" : "s", (int)old_len, (int)new_len);
+    ESP_LOGI(TAG, "edit_file: %s (%d replacements)", path, replaced);
+    cJSON_Delete(root);
+    return ESP_OK;
+}
 
-    size_t prefix_len = pos - buf;
-    memcpy(result, buf, prefix_len);
-    memcpy(result + prefix_len, new_str, new_len);
-    size_t suffix_start = prefix_len + old_len;
-    size_t suffix_len = n - suffix_start;
-    memcpy(result + prefix_len + new_len, buf + suffix_start, suffix_len);
-    size_t total = prefix_len + new_len + suffix_len;
-    result[total] = '\0';
+/* Undo edits cut short by a reset. A leftover original goes back in
+ * place if the target is gone (the edit never reported success), else it
+ * is stale; a leftover copy is always stale. SPIFFS lists every file from
+ * the root; LittleFS directories are descended into. */
+static void edit_recover(const char *dir_path, int depth)
+{
+    DIR *dir = opendir(dir_path);
+    if (!dir) return;
 
-    free(buf);
+    /* Collected first: renaming while reading the directory is unsafe.
+     * Edits are serialized, so there is rarely more than one. */
+    char found[4][128];
+    int nfound = 0;
+    size_t bak_len = strlen(MIMI_FILE_EDIT_BAK_SUFFIX);
+    size_t tmp_len = strlen(MIMI_FILE_EDIT_TMP_SUFFIX);
 
-    /* Write back */
-    f = fopen(path, "w");
-    if (!f) {
-        snprintf(output, output_size, "Error: cannot open file for writing: %s", path);
-        free(result);
-        cJSON_Delete(root);
-        return ESP_FAIL;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+        char full_path[512];
+        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, ent->d_name);
+
+        struct stat st;
+        if (depth < 8 && stat(full_path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            edit_recover(full_path, depth + 1);
+            continue;
+        }
+        size_t len = strlen(full_path);
+        bool bak = len > bak_len && strcmp(full_path + len - bak_len, MIMI_FILE_EDIT_BAK_SUFFIX) == 0;
+        bool tmp = len > tmp_len && strcmp(full_path + len - tmp_len, MIMI_FILE_EDIT_TMP_SUFFIX) == 0;
+        if ((bak || tmp) && nfound < 4 && len < sizeof(found[0])) {
+            memcpy(found[nfound++], full_path, len + 1);
+        }
     }
+    closedir(dir);
 
-    fwrite(result, 1, total, f);
-    fclose(f);
-    free(result);
+    for (int i = 0; i < nfound; i++) {
+        char *side = found[i];
+        size_t len = strlen(side);
+        if (len > bak_len && strcmp(side + len - bak_len, MIMI_FILE_EDIT_BAK_SUFFIX) == 0) {
+            char target[128];
+            memcpy(target, side, len - bak_len);
+            target[len - bak_len] = '\0';
+            struct stat st;
+            if (stat(target, &st) != 0 && rename(side, target) == 0) {
+                ESP_LOGW(TAG, "Restored %s after an interrupted edit", target);
+                continue;
+            }
+        }
+        remove(side);
+    }
+}
 
-    snprintf(output, output_size, "OK: edited %s (replaced %d bytes with %d bytes)", path, (int)old_len, (int)new_len);
-    ESP_LOGI(TAG, "edit_file: %s", path);
-    cJSON_Delete(root);
-    return ESP_OK;
+void tool_files_init(void)
+{
+    if (!s_write_lock) s_write_lock = xSemaphoreCreateMutex();
+    edit_recover(MIMI_SPIFFS_BASE, 0);
 }
 
 /* ── list_dir ──────────────────────────────────────────────── */
 
+/* Append the files under dir to output. SPIFFS lists every file of the
+ * partition from the root with embedded slashes; LittleFS has real
+ * directories, which are descended into. */
+static void list_files(const char *dir_path, const char *prefix, char *output,
+                       size_t output_size, size_t *off, int *count, int depth)
+{
+    DIR *dir = opendir(dir_path);
+    if (!dir) return;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL && *off < output_size - 1) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+        char full_path[512];
+        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, ent->d_name);
+
+        struct stat st;
+        if (depth < 8 && stat(full_path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            list_files(full_path, prefix, output, output_size, off, count, depth + 1);
+            continue;
+        }
+        if (prefix && strncmp(full_path, prefix, strlen(prefix)) != 0) {
+            continue;
+        }
+
+        *off += snprintf(output + *off, output_size - *off, "%s\n", full_path);
+        (*count)++;
+    }
+    closedir(dir);
+}
+
 esp_err_t tool_list_dir_execute(const char *input_json, char *output, size_t output_size)
 {
     cJSON *root = cJSON_Parse(input_json);
@@ -232,25 +639,12 @@ esp_err_t tool_list_dir_execute(const char *input_json, char *output, size_t out
         cJSON_Delete(root);
         return ESP_FAIL;
     }
+    closedir(dir);
 
     size_t off = 0;
-    struct dirent *ent;
     int count = 0;
-
-    while ((ent = readdir(dir)) != NULL && off < output_size - 1) {
-        /* Build full path: SPIFFS entries are just filenames with embedded slashes */
-        char full_path[512];
-        snprintf(full_path, sizeof(full_path), "%s/%s", MIMI_SPIFFS_BASE, ent->d_name);
-
-        if (prefix && strncmp(full_path, prefix, strlen(prefix)) != 0) {
-            continue;
-        }
-
-        off += snprintf(output + off, output_size - off, "%s\n", full_path);
-        count++;
-    }
-
-    closedir(dir);
+    output[0] = '\0';
+    list_files(MIMI_SPIFFS_BASE, prefix, output, output_size, &off, &count, 0);
 
     if (count == 0) {
         snprintf(output, output_size, "(no files found)");
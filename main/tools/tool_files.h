@@ -4,11 +4,25 @@
 #include <stddef.h>
 
 /**
- * Read a file from SPIFFS.
- * Input JSON: {"path": "/spiffs/..."}
+ * Create the lock serializing write_file and edit_file, and undo any
+ * edit a reset interrupted. Call once the filesystem is mounted.
+ */
+void tool_files_init(void);
+
+/**
+ * Read part of a file from SPIFFS, by bytes or by lines. Reads stop when
+ * the output is full and end with a note saying where to continue.
+ * Input JSON: {"path": "/spiffs/...", "offset": 0, "length": 4096}
+ *          or {"path": "/spiffs/...", "start_line": 1, "end_line": 50}
  */
 esp_err_t tool_read_file_execute(const char *input_json, char *output, size_t output_size);
 
+/**
+ * Search a file for a literal string, streaming it through a fixed window.
+ * Input JSON: {"path": "/spiffs/...", "pattern": "...", "ignore_case": false, "max_matches": 20}
+ */
+esp_err_t tool_grep_file_execute(const char *input_json, char *output, size_t output_size);
+
 /**
  * Write/overwrite a file on SPIFFS.
  * Input JSON: {"path": "/spiffs/...", "content": "..."}
@@ -16,8 +30,9 @@ esp_err_t tool_read_file_execute(const char *input_json, char *output, size_t ou
 esp_err_t tool_write_file_execute(const char *input_json, char *output, size_t output_size);
 
 /**
- * Find-and-replace edit a file on SPIFFS.
- * Input JSON: {"path": "/spiffs/...", "old_string": "...", "new_string": "..."}
+ * Find-and-replace edit a file on SPIFFS. The file is copied through a
+ * temp file block by block, so its size is not limited by RAM.
+ * Input JSON: {"path": "/spiffs/...", "old_string": "...", "new_string": "...", "replace_all": false}
  */
 esp_err_t tool_edit_file_execute(const char *input_json, char *output, size_t output_size);
 
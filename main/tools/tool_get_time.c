@@ -8,11 +8,30 @@
 #include <sys/time.h>
 #include "esp_log.h"
 #include "esp_sntp.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
 static const char *TAG = "tool_time";
 static bool sntp_started = false;
 
-/* Initialize SNTP if not already started */
+/* get_current_time runs alongside other tool calls, and agent workers call
+ * it concurrently: SNTP start, s_timezone and the process-wide TZ that
+ * localtime_r() reads are only touched under this lock. The NTP wait is
+ * outside it. */
+static SemaphoreHandle_t s_time_lock = NULL;
+
+static void time_lock(void)
+{
+    if (s_time_lock) xSemaphoreTake(s_time_lock, portMAX_DELAY);
+}
+
+static void time_unlock(void)
+{
+    if (s_time_lock) xSemaphoreGive(s_time_lock);
+}
+
+/* Initialize SNTP if not already started; caller holds the lock */
 static void ensure_sntp(void)
 {
     if (esp_sntp_enabled()) {
@@ -35,15 +54,23 @@ static void ensure_sntp(void)
 
 static char s_timezone[64] = MIMI_TIMEZONE;
 
-/* Initialize timezone from NVS */
+/* Initialize timezone from NVS and apply it */
 void tool_time_init(void)
 {
+    if (!s_time_lock) {
+        s_time_lock = xSemaphoreCreateMutex();
+    }
+
+    time_lock();
     nvs_handle_t nvs;
     if (nvs_open("mimi_config", NVS_READONLY, &nvs) == ESP_OK) {
         size_t len = sizeof(s_timezone);
         nvs_get_str(nvs, "timezone", s_timezone, &len);
         nvs_close(nvs);
     }
+    setenv("TZ", s_timezone, 1);
+    tzset();
+    time_unlock();
 }
 
 /* Check if system time looks valid (year >= 2024) */
@@ -55,12 +82,9 @@ static bool time_is_valid(void)
     return (tm.tm_year >= (2024 - 1900));
 }
 
-/* Format current local time into output buffer */
+/* Format current local time into output buffer; caller holds the lock */
 static void format_local_time(char *out, size_t out_size)
 {
-    setenv("TZ", s_timezone, 1);
-    tzset();
-
     time_t now = time(NULL);
     struct tm local;
     localtime_r(&now, &local);
@@ -72,7 +96,9 @@ esp_err_t tool_get_time_execute(const char *input_json, char *output, size_t out
     (void)input_json;
     ESP_LOGI(TAG, "Fetching current time...");
     /* Ensure SNTP is running */
+    time_lock();
     ensure_sntp();
+    time_unlock();
     ESP_LOGI(TAG, "SNTP status: %s", esp_sntp_enabled() ? "running" : "stopped");
     
     /* Wait if not synced (only short wait) */
@@ -88,8 +114,12 @@ esp_err_t tool_get_time_execute(const char *input_json, char *output, size_t out
         snprintf(output, output_size, "Error: NTP sync timeout. Reading system time anyway.");
     }
     
+    char tz[sizeof(s_timezone)];
+    time_lock();
     format_local_time(output, output_size);
-    ESP_LOGI(TAG, "Time: %s (TZ=%s)", output, s_timezone);
+    memcpy(tz, s_timezone, sizeof(tz));
+    time_unlock();
+    ESP_LOGI(TAG, "Time: %s (TZ=%s)", output, tz);
     return ESP_OK;
 }
 
@@ -108,6 +138,7 @@ esp_err_t tool_set_timezone_execute(const char *input_json, char *output, size_t
         return ESP_FAIL;
     }
 
+    time_lock();
     strncpy(s_timezone, tz->valuestring, sizeof(s_timezone) - 1);
     s_timezone[sizeof(s_timezone) - 1] = '\0';
     cJSON_Delete(root);
@@ -127,6 +158,7 @@ esp_err_t tool_set_timezone_execute(const char *input_json, char *output, size_t
     snprintf(output, output_size, "Timezone set to %s. Current time: ", s_timezone);
     size_t len = strlen(output);
     format_local_time(output + len, output_size - len);
-    
+    time_unlock();
+
     return ESP_OK;
 }
@@ -0,0 +1,57 @@
+#include "tools/tool_memory.h"
+#include "mimi_config.h"
+#include "memory/memory_index.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "cJSON.h"
+
+static const char *TAG = "tool_memory";
+
+#define SEARCH_DEFAULT_K    5
+#define SEARCH_MAX_K        10
+
+esp_err_t tool_memory_search_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *root = cJSON_Parse(input_json);
+    if (!root) {
+        snprintf(output, output_size, "Error: invalid JSON input");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const char *query = cJSON_GetStringValue(cJSON_GetObjectItem(root, "query"));
+    if (!query || !query[0]) {
+        snprintf(output, output_size, "Error: missing 'query' field");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+    cJSON *k_item = cJSON_GetObjectItem(root, "top_k");
+    int top_k = cJSON_IsNumber(k_item) ? k_item->valueint : SEARCH_DEFAULT_K;
+    if (top_k < 1) top_k = 1;
+    if (top_k > SEARCH_MAX_K) top_k = SEARCH_MAX_K;
+
+    memory_hit_t hits[SEARCH_MAX_K];
+    int found = memory_index_search(query, hits, top_k);
+    ESP_LOGI(TAG, "memory_search '%s': %d hits", query, found);
+    cJSON_Delete(root);
+
+    if (found == 0) {
+        snprintf(output, output_size, "No matching memory.");
+        return ESP_OK;
+    }
+
+    /* Each hit gets an equal share of the output so later ones still show */
+    size_t off = 0;
+    output[0] = '\0';
+    for (int i = 0; i < found && off + 64 < output_size; i++) {
+        size_t share = (output_size - off) / (found - i);
+        int head = snprintf(output + off, output_size - off, "[%s @%u, score %.2f]\n",
+                            hits[i].name, (unsigned)hits[i].offset, hits[i].score);
+        if (head < 0 || (size_t)head >= share) break;
+        off += head;
+        off += memory_index_read_hit(&hits[i], output + off, share - head);
+        off += snprintf(output + off, output_size - off, "\n\n");
+    }
+    return ESP_OK;
+}
@@ -13,11 +13,18 @@
 #include "tools/tool_mcp.h"
 #include "tools/tool_voice.h"
 #include "tools/tool_audio.h"
+#include "tools/tool_memory.h"
 #include "llm/llm_proxy.h"
+#include "llm/json_writer.h"
 
+#include <stdlib.h>
 #include <string.h>
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "cJSON.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 static const char *TAG = "tools";
 
@@ -33,14 +40,67 @@ static int s_tool_count = 0;
 static tool_provider_t s_providers[MAX_PROVIDERS];
 static int s_provider_count = 0;
 
-static char *s_cached_json = NULL;
+/* ── Rendered schema cache ─────────────────────────────────────────── */
+
+/* One pre-serialized tools array per wire format, rendered lazily when
+ * the generation moves. A set is refcounted: the registry holds one
+ * reference on the newest set, and every caller that acquired it holds
+ * another for the length of its LLM call, so an invalidation in the
+ * middle of a request never frees the blob it is sending. Sets stay on
+ * s_sets (newest first) until their last reference is dropped. */
+typedef struct tool_blob_set {
+    struct tool_blob_set *next;
+    uint32_t refs;
+    uint32_t generation;
+    char *blob[TOOL_SCHEMA_FORMAT_COUNT];
+} tool_blob_set_t;
+
+static tool_blob_set_t *s_sets = NULL;
+static tool_blob_set_t *s_current = NULL;
+static uint32_t s_generation = 1;
+static uint32_t s_blob_generation = 0;
+static SemaphoreHandle_t s_registry_lock = NULL;
 
 static void invalidate_tools_cache(void)
 {
-    if (s_cached_json) {
-        free(s_cached_json);
-        s_cached_json = NULL;
+    s_generation++;
+}
+
+static void registry_lock(void)
+{
+    if (s_registry_lock) xSemaphoreTake(s_registry_lock, portMAX_DELAY);
+}
+
+static void registry_unlock(void)
+{
+    if (s_registry_lock) xSemaphoreGive(s_registry_lock);
+}
+
+/* ── Dispatch index ────────────────────────────────────────────────── */
+
+/* Open-addressing table from tool name to (provider, handle), rebuilt
+ * in the same pass that renders the schemas. Names live in one arena:
+ * the pass runs on a snapshot of s_tools[], which may shift under it. */
+typedef struct {
+    uint32_t hash;
+    int16_t provider;       /* index into s_providers, -1 = empty slot */
+    int16_t handle;         /* s_tools[] index, or position in the provider's array */
+    uint32_t name_off;      /* into s_index_names */
+} tool_index_entry_t;
+
+static tool_index_entry_t *s_index = NULL;
+static uint32_t s_index_mask = 0;
+static int s_index_count = 0;
+static char *s_index_names = NULL;
+
+static uint32_t tool_name_hash(const char *name)
+{
+    uint32_t h = 2166136261u;   /* FNV-1a */
+    while (*name) {
+        h ^= (uint8_t)*name++;
+        h *= 16777619u;
     }
+    return h;
 }
 
 /* ── Inline tool: set_streaming ────────────────────────────────────── */
@@ -60,22 +120,89 @@ static esp_err_t tool_set_streaming_execute(const char *input_json, char *output
 
 /* ── Built-in Provider (Legacy Wrapper) ────────────────────────────── */
 
-static char *builtin_get_tools_json(void)
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} blob_buf_t;
+
+static int blob_sink(void *arg, const char *data, size_t len)
 {
-    cJSON *arr = cJSON_CreateArray();
-    for (int i = 0; i < s_tool_count; i++) {
-        cJSON *tool = cJSON_CreateObject();
-        cJSON_AddStringToObject(tool, "name", s_tools[i].name);
-        cJSON_AddStringToObject(tool, "description", s_tools[i].description);
-        cJSON *schema = cJSON_Parse(s_tools[i].input_schema_json);
-        if (schema) {
-            cJSON_AddItemToObject(tool, "input_schema", schema);
+    blob_buf_t *b = (blob_buf_t *)arg;
+    if (b->len + len + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap : 1024;
+        while (b->len + len + 1 > cap) cap *= 2;
+        char *tmp = heap_caps_realloc(b->data, cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!tmp) return -1;
+        b->data = tmp;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    b->data[b->len] = '\0';
+    return 0;
+}
+
+/* Write one tool entry. The schema is either a validated raw JSON
+ * string (built-in tools) or a parsed tree (provider tools). */
+static void write_tool(json_writer_t *w, tool_schema_format_t fmt, const char *name,
+                       const char *desc, const char *schema_raw, const cJSON *schema)
+{
+    bool has_schema = schema_raw || schema;
+
+    if (fmt == TOOL_SCHEMA_OPENAI) {
+        jw_str(w, "{\"type\":\"function\",\"function\":{\"name\":");
+        jw_string(w, name);
+        if (desc) {
+            jw_str(w, ",\"description\":");
+            jw_string(w, desc);
+        }
+        if (has_schema) jw_str(w, ",\"parameters\":");
+    } else {
+        jw_str(w, "{\"name\":");
+        jw_string(w, name);
+        if (desc) {
+            jw_str(w, ",\"description\":");
+            jw_string(w, desc);
         }
-        cJSON_AddItemToArray(arr, tool);
+        if (has_schema) jw_str(w, ",\"input_schema\":");
+    }
+
+    if (schema_raw) {
+        jw_str(w, schema_raw);
+    } else if (schema) {
+        jw_cjson(w, schema);
+    }
+    jw_str(w, fmt == TOOL_SCHEMA_OPENAI ? "}}" : "}");
+}
+
+static void write_builtin_tools(json_writer_t *w, tool_schema_format_t fmt,
+                                const mimi_tool_t *tools, int count, bool *first)
+{
+    for (int i = 0; i < count; i++) {
+        if (!*first) jw_raw(w, ",", 1);
+        *first = false;
+        write_tool(w, fmt, tools[i].name, tools[i].description,
+                   tools[i].input_schema_json, NULL);
+    }
+}
+
+static char *builtin_get_tools_json(void)
+{
+    char chunk[256];
+    blob_buf_t blob = {0};
+    json_writer_t w;
+    bool first = true;
+
+    jw_init(&w, blob_sink, &blob, chunk, sizeof(chunk));
+    jw_raw(&w, "[", 1);
+    write_builtin_tools(&w, TOOL_SCHEMA_ANTHROPIC, s_tools, s_tool_count, &first);
+    jw_raw(&w, "]", 1);
+    if (jw_flush(&w) != ESP_OK) {
+        free(blob.data);
+        return NULL;
     }
-    char *json = cJSON_PrintUnformatted(arr);
-    cJSON_Delete(arr);
-    return json;
+    return blob.data;
 }
 
 static esp_err_t builtin_execute_tool(const char *tool_name, const char *input_json, char *output, size_t output_size)
@@ -94,28 +221,124 @@ static const tool_provider_t s_builtin_provider = {
     .execute_tool = builtin_execute_tool
 };
 
+static bool provider_is_builtin(int idx)
+{
+    return s_providers[idx].get_tools_json == builtin_get_tools_json;
+}
+
+static const char *index_entry_name(const tool_index_entry_t *e)
+{
+    return s_index_names + e->name_off;
+}
+
+static const tool_index_entry_t *index_find(const char *name)
+{
+    if (!s_index) return NULL;
+    uint32_t h = tool_name_hash(name);
+    for (uint32_t slot = h & s_index_mask; ; slot = (slot + 1) & s_index_mask) {
+        const tool_index_entry_t *e = &s_index[slot];
+        if (e->provider < 0) return NULL;
+        if (e->hash == h && strcmp(index_entry_name(e), name) == 0) return e;
+    }
+}
+
+/* Built-in entry to its tool. The handle is the tool's position when the
+ * index was built; if a register/unregister has shifted s_tools[] since,
+ * fall back to a scan. Caller holds the registry lock. */
+static const mimi_tool_t *index_builtin(const tool_index_entry_t *e)
+{
+    const char *name = index_entry_name(e);
+    if (e->handle < s_tool_count && strcmp(s_tools[e->handle].name, name) == 0) {
+        return &s_tools[e->handle];
+    }
+    for (int i = 0; i < s_tool_count; i++) {
+        if (strcmp(s_tools[i].name, name) == 0) return &s_tools[i];
+    }
+    return NULL;
+}
+
+/* Swap in a new table built from `list`. The load factor stays at or
+ * below 1/2, so probes always reach an empty slot. On a duplicate name
+ * the earlier provider wins, as with the old linear dispatch. */
+static void index_install(const tool_index_entry_t *list, int count, char *names)
+{
+    uint32_t cap = 16;
+    while (cap < (uint32_t)count * 2) cap <<= 1;
+
+    tool_index_entry_t *table = heap_caps_malloc(cap * sizeof(*table), MALLOC_CAP_SPIRAM);
+    free(s_index);
+    free(s_index_names);
+    s_index = table;
+    s_index_names = names;
+    s_index_mask = cap - 1;
+    s_index_count = 0;
+    if (!table) {
+        ESP_LOGE(TAG, "Out of memory for dispatch index, using linear lookup");
+        return;
+    }
+
+    for (uint32_t i = 0; i < cap; i++) table[i].provider = -1;
+    for (int i = 0; i < count; i++) {
+        const tool_index_entry_t *e = &list[i];
+        if (index_find(index_entry_name(e))) continue;
+        uint32_t slot = e->hash & s_index_mask;
+        while (table[slot].provider >= 0) slot = (slot + 1) & s_index_mask;
+        table[slot] = *e;
+        s_index_count++;
+    }
+}
+
+static void index_collect(blob_buf_t *entries, blob_buf_t *names,
+                          int provider, int handle, const char *name)
+{
+    tool_index_entry_t e = {
+        .hash = tool_name_hash(name),
+        .provider = (int16_t)provider,
+        .handle = (int16_t)handle,
+        .name_off = (uint32_t)names->len,
+    };
+    blob_sink(names, name, strlen(name) + 1);
+    blob_sink(entries, (const char *)&e, sizeof(e));
+}
+
 /* ── Registry API ──────────────────────────────────────────────────── */
 
 void tool_registry_register(const mimi_tool_t *tool)
 {
+    registry_lock();
     for (int i = 0; i < s_tool_count; i++) {
         if (strcmp(s_tools[i].name, tool->name) == 0) {
+            registry_unlock();
             ESP_LOGW(TAG, "Tool already exists, skip: %s", tool->name);
             return;
         }
     }
     if (s_tool_count >= MAX_TOOLS) {
+        registry_unlock();
         ESP_LOGE(TAG, "Tool registry full");
         return;
     }
-    s_tools[s_tool_count++] = *tool;
+    s_tools[s_tool_count] = *tool;
+
+    /* Schemas are spliced verbatim into requests, so check them once here */
+    if (tool->input_schema_json) {
+        cJSON *schema = cJSON_Parse(tool->input_schema_json);
+        if (!schema) {
+            ESP_LOGW(TAG, "Tool %s has an invalid input schema, omitting it", tool->name);
+            s_tools[s_tool_count].input_schema_json = NULL;
+        }
+        cJSON_Delete(schema);
+    }
+    s_tool_count++;
     invalidate_tools_cache();
+    registry_unlock();
     ESP_LOGI(TAG, "Registered tool: %s", tool->name);
 }
 
 void tool_registry_unregister(const char *name)
 {
     if (!name || !name[0]) return;
+    registry_lock();
     for (int i = 0; i < s_tool_count; i++) {
         if (strcmp(s_tools[i].name, name) == 0) {
             for (int j = i; j < s_tool_count - 1; j++) {
@@ -123,17 +346,24 @@ void tool_registry_unregister(const char *name)
             }
             s_tool_count--;
             invalidate_tools_cache();
+            registry_unlock();
             ESP_LOGI(TAG, "Unregistered tool: %s", name);
             return;
         }
     }
+    registry_unlock();
 }
 
 esp_err_t tool_registry_register_provider(const tool_provider_t *provider)
 {
-    if (s_provider_count >= MAX_PROVIDERS) return ESP_ERR_NO_MEM;
+    registry_lock();
+    if (s_provider_count >= MAX_PROVIDERS) {
+        registry_unlock();
+        return ESP_ERR_NO_MEM;
+    }
     s_providers[s_provider_count++] = *provider;
     invalidate_tools_cache();
+    registry_unlock();
     ESP_LOGI(TAG, "Registered provider: %s", provider->name);
     return ESP_OK;
 }
@@ -143,45 +373,262 @@ void tool_registry_rebuild_json(void)
     invalidate_tools_cache();
 }
 
-const char *tool_registry_get_tools_json(void)
+/* What a render pass works from, copied under the lock so that the
+ * providers' get_tools_json() (MCP and API skills take their own locks,
+ * and may be slow) runs without the registry lock held. */
+typedef struct {
+    uint32_t generation;
+    int tool_count;
+    int provider_count;
+    mimi_tool_t tools[MAX_TOOLS];
+    tool_provider_t providers[MAX_PROVIDERS];
+} registry_snapshot_t;
+
+static void blob_set_free(tool_blob_set_t *set)
+{
+    for (int f = 0; f < TOOL_SCHEMA_FORMAT_COUNT; f++) free(set->blob[f]);
+    free(set);
+}
+
+/* Caller holds the registry lock */
+static void blob_set_unref(tool_blob_set_t *set)
+{
+    if (!set || --set->refs > 0) return;
+    for (tool_blob_set_t **pp = &s_sets; *pp; pp = &(*pp)->next) {
+        if (*pp == set) {
+            *pp = set->next;
+            break;
+        }
+    }
+    blob_set_free(set);
+}
+
+/* Caller holds the registry lock */
+static tool_blob_set_t *blob_set_find(const char *tools_json)
 {
-    if (s_cached_json) return s_cached_json;
+    for (tool_blob_set_t *set = s_sets; set; set = set->next) {
+        if (set->blob[TOOL_SCHEMA_ANTHROPIC] == tools_json) return set;
+    }
+    return NULL;
+}
 
-    cJSON *root = cJSON_CreateObject();
-    cJSON *all_tools = cJSON_CreateArray();
-    cJSON_AddItemToObject(root, "type", cJSON_CreateString("function")); // Optional, for some LLM formats
-    // Actually, usually we return just the array or objects. The original code returned printed array.
-    // Let's stick to returning array of tools as root, unless LLM proxy expects otherwise.
-    // Original implementation: returned cJSON_PrintUnformatted(arr)
-    
-    // So let's create a big array.
-    cJSON_Delete(root);
-    all_tools = cJSON_CreateArray();
+/* Render every tool in `snap` into one blob per wire format and collect
+ * the dispatch index entries. Built-in tools are written straight from
+ * their fields; other providers' arrays are parsed once per generation.
+ * Runs without the registry lock. */
+static tool_blob_set_t *render_tool_cache(const registry_snapshot_t *snap,
+                                          blob_buf_t *entries, blob_buf_t *names)
+{
+    char chunk[TOOL_SCHEMA_FORMAT_COUNT][256];
+    blob_buf_t blob[TOOL_SCHEMA_FORMAT_COUNT] = {0};
+    json_writer_t w[TOOL_SCHEMA_FORMAT_COUNT];
+    bool first[TOOL_SCHEMA_FORMAT_COUNT];
+
+    for (int f = 0; f < TOOL_SCHEMA_FORMAT_COUNT; f++) {
+        jw_init(&w[f], blob_sink, &blob[f], chunk[f], sizeof(chunk[f]));
+        jw_raw(&w[f], "[", 1);
+        first[f] = true;
+    }
 
-    for (int i = 0; i < s_provider_count; i++) {
-        char *p_json = s_providers[i].get_tools_json();
-        if (p_json) {
-            cJSON *p_arr = cJSON_Parse(p_json);
-            if (p_arr && cJSON_IsArray(p_arr)) {
-                cJSON *item = NULL;
-                cJSON_ArrayForEach(item, p_arr) {
-                    cJSON *clone = cJSON_Duplicate(item, true);
-                    cJSON_AddItemToArray(all_tools, clone);
-                }
+    for (int i = 0; i < snap->provider_count; i++) {
+        if (snap->providers[i].get_tools_json == builtin_get_tools_json) {
+            for (int f = 0; f < TOOL_SCHEMA_FORMAT_COUNT; f++) {
+                write_builtin_tools(&w[f], (tool_schema_format_t)f,
+                                    snap->tools, snap->tool_count, &first[f]);
             }
-            if (p_arr) cJSON_Delete(p_arr);
-            free(p_json);
+            for (int k = 0; k < snap->tool_count; k++) {
+                index_collect(entries, names, i, k, snap->tools[k].name);
+            }
+            continue;
+        }
+
+        char *p_json = snap->providers[i].get_tools_json();
+        if (!p_json) continue;
+        cJSON *p_arr = cJSON_Parse(p_json);
+        free(p_json);
+        if (!p_arr || !cJSON_IsArray(p_arr)) {
+            cJSON_Delete(p_arr);
+            continue;
         }
+
+        cJSON *item = NULL;
+        int pos = -1;
+        cJSON_ArrayForEach(item, p_arr) {
+            pos++;
+            cJSON *name = cJSON_GetObjectItem(item, "name");
+            if (!name || !cJSON_IsString(name)) continue;
+            cJSON *desc = cJSON_GetObjectItem(item, "description");
+            index_collect(entries, names, i, pos, name->valuestring);
+
+            /* Anthropic keeps the provider's entry as-is */
+            if (!first[TOOL_SCHEMA_ANTHROPIC]) jw_raw(&w[TOOL_SCHEMA_ANTHROPIC], ",", 1);
+            first[TOOL_SCHEMA_ANTHROPIC] = false;
+            jw_cjson(&w[TOOL_SCHEMA_ANTHROPIC], item);
+
+            if (!first[TOOL_SCHEMA_OPENAI]) jw_raw(&w[TOOL_SCHEMA_OPENAI], ",", 1);
+            first[TOOL_SCHEMA_OPENAI] = false;
+            write_tool(&w[TOOL_SCHEMA_OPENAI], TOOL_SCHEMA_OPENAI, name->valuestring,
+                       cJSON_IsString(desc) ? desc->valuestring : NULL,
+                       NULL, cJSON_GetObjectItem(item, "input_schema"));
+        }
+        cJSON_Delete(p_arr);
+    }
+
+    tool_blob_set_t *set = calloc(1, sizeof(*set));
+    for (int f = 0; f < TOOL_SCHEMA_FORMAT_COUNT; f++) {
+        jw_raw(&w[f], "]", 1);
+        if (jw_flush(&w[f]) != ESP_OK || !set) {
+            free(blob[f].data);
+            blob[f].data = NULL;
+        }
+        if (set) set->blob[f] = blob[f].data;
+    }
+    if (!set || !set->blob[TOOL_SCHEMA_ANTHROPIC]) {
+        ESP_LOGE(TAG, "Out of memory rendering tool schemas");
+        if (set) blob_set_free(set);
+        return NULL;
+    }
+    set->generation = snap->generation;
+    set->refs = 1;  /* held by the registry */
+    return set;
+}
+
+/* Bring the schema cache and dispatch index up to the current
+ * generation. Called with the registry lock held; drops it while
+ * rendering. If the generation moves during a render the result is
+ * still installed (it is newer than what it replaces) and the pass is
+ * retried a couple of times before settling for it. */
+static void refresh_tool_cache(void)
+{
+    for (int attempt = 0; attempt < 3 && s_blob_generation != s_generation; attempt++) {
+        registry_snapshot_t *snap = malloc(sizeof(*snap));
+        if (!snap) return;
+        snap->generation = s_generation;
+        snap->tool_count = s_tool_count;
+        snap->provider_count = s_provider_count;
+        memcpy(snap->tools, s_tools, sizeof(s_tools[0]) * s_tool_count);
+        memcpy(snap->providers, s_providers, sizeof(s_providers[0]) * s_provider_count);
+        registry_unlock();
+
+        int64_t start = esp_timer_get_time();
+        blob_buf_t entries = {0};
+        blob_buf_t names = {0};
+        tool_blob_set_t *set = render_tool_cache(snap, &entries, &names);
+        int64_t took = esp_timer_get_time() - start;
+
+        registry_lock();
+        /* Another caller may have installed this generation or a later one meanwhile */
+        if (set && (int32_t)(set->generation - s_blob_generation) > 0) {
+            set->next = s_sets;
+            s_sets = set;
+            blob_set_unref(s_current);
+            s_current = set;
+            index_install((const tool_index_entry_t *)entries.data,
+                          (int)(entries.len / sizeof(tool_index_entry_t)), names.data);
+            names.data = NULL;
+            s_blob_generation = set->generation;
+
+            ESP_LOGI(TAG, "Tool schemas rendered (gen %lu): anthropic %u B, openai %u B, %d indexed in %lld us",
+                     (unsigned long)set->generation,
+                     (unsigned)strlen(set->blob[TOOL_SCHEMA_ANTHROPIC]),
+                     set->blob[TOOL_SCHEMA_OPENAI] ? (unsigned)strlen(set->blob[TOOL_SCHEMA_OPENAI]) : 0,
+                     s_index_count, (long long)took);
+        } else if (set) {
+            blob_set_free(set);
+        }
+        free(entries.data);
+        free(names.data);
+        free(snap);
+        if (!set) return;
+    }
+}
+
+const char *tool_registry_acquire_tools_json(void)
+{
+    const char *blob = NULL;
+
+    registry_lock();
+    refresh_tool_cache();
+    if (s_current) {
+        s_current->refs++;
+        blob = s_current->blob[TOOL_SCHEMA_ANTHROPIC];
     }
+    registry_unlock();
+    return blob;
+}
+
+void tool_registry_release_tools_json(const char *tools_json)
+{
+    if (!tools_json) return;
+    registry_lock();
+    tool_blob_set_t *set = blob_set_find(tools_json);
+    if (set) {
+        blob_set_unref(set);
+    } else {
+        ESP_LOGW(TAG, "Release of a tools blob the registry does not own");
+    }
+    registry_unlock();
+}
+
+const char *tool_registry_get_tools_blob(const char *tools_json, tool_schema_format_t fmt)
+{
+    if (!tools_json || (unsigned)fmt >= TOOL_SCHEMA_FORMAT_COUNT) return NULL;
+
+    registry_lock();
+    tool_blob_set_t *set = blob_set_find(tools_json);
+    const char *blob = set ? set->blob[fmt] : NULL;
+    registry_unlock();
+    return blob;
+}
 
-    s_cached_json = cJSON_PrintUnformatted(all_tools);
-    cJSON_Delete(all_tools);
-    return s_cached_json;
+uint32_t tool_registry_get_generation(void)
+{
+    return s_generation;
 }
 
 esp_err_t tool_registry_execute(const char *name, const char *input_json,
                                 char *output, size_t output_size)
 {
+    /* Resolve through the index, then run the tool outside the lock:
+     * tools can be slow, and skill tools may register tools themselves. */
+    mimi_tool_t builtin = {0};
+    tool_provider_t provider = {0};
+    int handle = -1;
+    bool indexed = false;
+
+    registry_lock();
+    refresh_tool_cache();
+    const tool_index_entry_t *e = index_find(name);
+    if (e) {
+        indexed = true;
+        handle = e->handle;
+        if (provider_is_builtin(e->provider)) {
+            const mimi_tool_t *t = index_builtin(e);
+            if (t) builtin = *t;
+            else indexed = false;
+        }
+        provider = s_providers[e->provider];
+    }
+    registry_unlock();
+
+    if (indexed) {
+        esp_err_t ret;
+        if (builtin.execute) {
+            ret = builtin.execute(input_json, output, output_size);
+        } else if (provider.execute_tool_at) {
+            ret = provider.execute_tool_at(handle, name, input_json, output, output_size);
+        } else {
+            ret = provider.execute_tool(name, input_json, output, output_size);
+        }
+        if (ret == ESP_OK) {
+            ESP_LOGI(TAG, "Executed tool '%s' via provider '%s'", name, provider.name);
+            return ESP_OK;
+        } else if (ret != ESP_ERR_NOT_FOUND) {
+            return ret;
+        }
+        /* Provider state moved under the index: fall back to a full scan */
+    }
+
     for (int i = 0; i < s_provider_count; i++) {
         esp_err_t ret = s_providers[i].execute_tool(name, input_json, output, output_size);
         if (ret == ESP_OK) {
@@ -198,10 +645,32 @@ esp_err_t tool_registry_execute(const char *name, const char *input_json,
     return ESP_ERR_NOT_FOUND;
 }
 
+bool tool_registry_is_parallel_safe(const char *name)
+{
+    bool safe = false;
+
+    registry_lock();
+    refresh_tool_cache();
+    const tool_index_entry_t *e = index_find(name);
+    if (e) {
+        if (provider_is_builtin(e->provider)) {
+            const mimi_tool_t *t = index_builtin(e);
+            safe = t && t->parallel_safe;
+        } else {
+            safe = s_providers[e->provider].parallel_safe;
+        }
+    }
+    registry_unlock();
+    return safe;
+}
+
 /* ── Init ──────────────────────────────────────────────────────────── */
 
 esp_err_t tool_registry_init(void)
 {
+    if (!s_registry_lock) {
+        s_registry_lock = xSemaphoreCreateMutex();
+    }
     s_tool_count = 0;
     s_provider_count = 0;
     invalidate_tools_cache();
@@ -216,6 +685,7 @@ esp_err_t tool_registry_init(void)
         .description = "Search the web for current information. Use this when you need up-to-date facts, news, weather, or anything beyond your training data.",
         .input_schema_json = "{\"type\":\"object\",\"properties\":{\"query\":{\"type\":\"string\",\"description\":\"The search query\"}},\"required\":[\"query\"]}",
         .execute = tool_web_search_execute,
+        .parallel_safe = true,
     };
     tool_registry_register(&ws);
 
@@ -226,6 +696,7 @@ esp_err_t tool_registry_init(void)
         .description = "Get the current date and time. Also sets the system clock. Call this when you need to know what time or date it is.",
         .input_schema_json = "{\"type\":\"object\",\"properties\":{},\"required\":[]}",
         .execute = tool_get_time_execute,
+        .parallel_safe = true,
     };
     tool_registry_register(&gt);
 
@@ -248,14 +719,26 @@ esp_err_t tool_registry_init(void)
     tool_registry_register(&stm);
 
     /* Register read_file */
+    tool_files_init();
     mimi_tool_t rf = {
         .name = "read_file",
-        .description = "Read a file from SPIFFS storage.",
-        .input_schema_json = "{\"type\":\"object\",\"properties\":{\"path\":{\"type\":\"string\"}},\"required\":[\"path\"]}",
+        .description = "Read a file from SPIFFS storage. Large files come back in parts: pass offset/length (bytes) or start_line/end_line (1-based) to read further.",
+        .input_schema_json = "{\"type\":\"object\",\"properties\":{\"path\":{\"type\":\"string\"},\"offset\":{\"type\":\"integer\"},\"length\":{\"type\":\"integer\"},\"start_line\":{\"type\":\"integer\"},\"end_line\":{\"type\":\"integer\"}},\"required\":[\"path\"]}",
         .execute = tool_read_file_execute,
+        .parallel_safe = true,
     };
     tool_registry_register(&rf);
 
+    /* Register grep_file */
+    mimi_tool_t gf = {
+        .name = "grep_file",
+        .description = "Find the lines of a file containing a literal string. Returns line numbers for read_file.",
+        .input_schema_json = "{\"type\":\"object\",\"properties\":{\"path\":{\"type\":\"string\"},\"pattern\":{\"type\":\"string\"},\"ignore_case\":{\"type\":\"boolean\"},\"max_matches\":{\"type\":\"integer\"}},\"required\":[\"path\",\"pattern\"]}",
+        .execute = tool_grep_file_execute,
+        .parallel_safe = true,
+    };
+    tool_registry_register(&gf);
+
     /* Register write_file */
     mimi_tool_t wf = {
         .name = "write_file",
@@ -268,8 +751,8 @@ esp_err_t tool_registry_init(void)
     /* Register edit_file */
     mimi_tool_t ef = {
         .name = "edit_file",
-        .description = "Find and replace text in a file.",
-        .input_schema_json = "{\"type\":\"object\",\"properties\":{\"path\":{\"type\":\"string\"},\"old_string\":{\"type\":\"string\"},\"new_string\":{\"type\":\"string\"}},\"required\":[\"path\",\"old_string\",\"new_string\"]}",
+        .description = "Find and replace text in a file (first match, or every match with replace_all).",
+        .input_schema_json = "{\"type\":\"object\",\"properties\":{\"path\":{\"type\":\"string\"},\"old_string\":{\"type\":\"string\"},\"new_string\":{\"type\":\"string\"},\"replace_all\":{\"type\":\"boolean\"}},\"required\":[\"path\",\"old_string\",\"new_string\"]}",
         .execute = tool_edit_file_execute,
     };
     tool_registry_register(&ef);
@@ -280,9 +763,22 @@ esp_err_t tool_registry_init(void)
         .description = "List files on SPIFFS storage.",
         .input_schema_json = "{\"type\":\"object\",\"properties\":{\"prefix\":{\"type\":\"string\"}},\"required\":[]}",
         .execute = tool_list_dir_execute,
+        .parallel_safe = true,
     };
     tool_registry_register(&ld);
 
+#if CONFIG_MIMI_ENABLE_MEMORY_INDEX
+    /* Register memory_search */
+    mimi_tool_t ms = {
+        .name = "memory_search",
+        .description = "Search long-term memory and past daily notes. Returns the most relevant passages.",
+        .input_schema_json = "{\"type\":\"object\",\"properties\":{\"query\":{\"type\":\"string\"},\"top_k\":{\"type\":\"integer\"}},\"required\":[\"query\"]}",
+        .execute = tool_memory_search_execute,
+        .parallel_safe = true,
+    };
+    tool_registry_register(&ms);
+#endif
+
     /* Register cron tools */
     mimi_tool_t ca = {
         .name = "cron_add",
@@ -297,6 +793,7 @@ esp_err_t tool_registry_init(void)
         .description = "List all active cron jobs.",
         .input_schema_json = "{\"type\":\"object\",\"properties\":{},\"required\":[]}",
         .execute = tool_cron_list_execute,
+        .parallel_safe = true,
     };
     tool_registry_register(&cl);
 
@@ -314,6 +811,7 @@ esp_err_t tool_registry_init(void)
         .description = "Get current system status.",
         .input_schema_json = "{\"type\":\"object\",\"properties\":{},\"required\":[]}",
         .execute = tool_system_status,
+        .parallel_safe = true,
     };
     tool_registry_register(&ss);
 
@@ -349,7 +847,7 @@ esp_err_t tool_registry_init(void)
     mimi_tool_t wscan = { "wifi_scan", "Scan for WiFi APs.", "{\"type\":\"object\",\"properties\":{},\"required\":[]}", tool_wifi_scan };
     tool_registry_register(&wscan);
 
-    mimi_tool_t wstat = { "wifi_status", "Get WiFi status.", "{\"type\":\"object\",\"properties\":{},\"required\":[]}", tool_wifi_status };
+    mimi_tool_t wstat = { "wifi_status", "Get WiFi status.", "{\"type\":\"object\",\"properties\":{},\"required\":[]}", tool_wifi_status, true };
     tool_registry_register(&wstat);
 
 #ifdef CONFIG_BT_ENABLED
@@ -377,10 +875,10 @@ esp_err_t tool_registry_init(void)
     };
     tool_registry_register(&sc);
 
-    mimi_tool_t slt = { "skill_list_templates", "List skill templates.", "{\"type\":\"object\",\"properties\":{},\"required\":[]}", tool_skill_list_templates_execute };
+    mimi_tool_t slt = { "skill_list_templates", "List skill templates.", "{\"type\":\"object\",\"properties\":{},\"required\":[]}", tool_skill_list_templates_execute, true };
     tool_registry_register(&slt);
 
-    mimi_tool_t sgt = { "skill_get_template", "Get skill template code.", "{\"type\":\"object\",\"properties\":{\"name\":{\"type\":\"string\"}},\"required\":[\"name\"]}", tool_skill_get_template_execute };
+    mimi_tool_t sgt = { "skill_get_template", "Get skill template code.", "{\"type\":\"object\",\"properties\":{\"name\":{\"type\":\"string\"}},\"required\":[\"name\"]}", tool_skill_get_template_execute, true };
     tool_registry_register(&sgt);
 
     mimi_tool_t sm = { "skill_manage", "Manage skills.", "{\"type\":\"object\",\"properties\":{\"action\":{\"type\":\"string\"},\"name\":{\"type\":\"string\"}},\"required\":[\"action\"]}", tool_skill_manage_execute };
@@ -390,7 +888,7 @@ esp_err_t tool_registry_init(void)
     mimi_tool_t mcp_add = { "mcp_add", "Add MCP source.", "{\"type\":\"object\",\"properties\":{\"name\":{\"type\":\"string\"},\"url\":{\"type\":\"string\"}},\"required\":[\"name\",\"url\"]}", tool_mcp_add };
     tool_registry_register(&mcp_add);
 
-    mimi_tool_t mcp_list = { "mcp_list", "List MCP sources.", "{\"type\":\"object\",\"properties\":{},\"required\":[]}", tool_mcp_list };
+    mimi_tool_t mcp_list = { "mcp_list", "List MCP sources.", "{\"type\":\"object\",\"properties\":{},\"required\":[]}", tool_mcp_list, true };
     tool_registry_register(&mcp_list);
 
     mimi_tool_t mcp_remove = { "mcp_remove", "Remove MCP source.", "{\"type\":\"object\",\"properties\":{\"id\":{\"type\":\"integer\"}},\"required\":[\"id\"]}", tool_mcp_remove };
@@ -2,6 +2,8 @@
 
 #include "esp_err.h"
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 /* ── Legacy Tool Struct ────────────────────────────────────────────── */
 
@@ -10,6 +12,7 @@ typedef struct {
     const char *description;
     const char *input_schema_json;  /* JSON Schema string for input */
     esp_err_t (*execute)(const char *input_json, char *output, size_t output_size);
+    bool parallel_safe;             /* read-only or network-bound: may run alongside other calls */
 } mimi_tool_t;
 
 /* ── Tool Provider Interface ────────────────────────────────────────── */
@@ -32,8 +35,28 @@ typedef struct {
      * @return ESP_OK if executed, ESP_ERR_NOT_FOUND if tool not owned by provider, other error if execution failed.
      */
     esp_err_t (*execute_tool)(const char *tool_name, const char *input_json, char *output, size_t output_size);
+
+    /**
+     * Optional: execute the tool at `index` in this provider's get_tools_json()
+     * array, as resolved by the registry's dispatch index. Saves the provider
+     * its own name lookup. NULL falls back to execute_tool.
+     */
+    esp_err_t (*execute_tool_at)(int index, const char *tool_name, const char *input_json,
+                                 char *output, size_t output_size);
+
+    /* All of this provider's tools may run alongside other calls */
+    bool parallel_safe;
 } tool_provider_t;
 
+/* ── Rendered Schemas ──────────────────────────────────────────────── */
+
+/* Wire formats the registry keeps a pre-serialized tools array for */
+typedef enum {
+    TOOL_SCHEMA_ANTHROPIC = 0,  /* [{"name","description","input_schema"}] */
+    TOOL_SCHEMA_OPENAI,         /* [{"type":"function","function":{...,"parameters"}}] */
+    TOOL_SCHEMA_FORMAT_COUNT,
+} tool_schema_format_t;
+
 /* ── API ───────────────────────────────────────────────────────────── */
 
 /**
@@ -64,11 +87,31 @@ esp_err_t tool_registry_register_provider(const tool_provider_t *provider);
 void tool_registry_rebuild_json(void);
 
 /**
- * Get the pre-built tools JSON array string for the API request.
- * Aggregates tools from all registered providers.
- * Returns NULL if no tools are registered.
+ * Pin the pre-built tools JSON array (Anthropic format) for the API request.
+ * Aggregates tools from all registered providers, rendered once per
+ * generation. The string stays valid until released, however often the
+ * registry is invalidated meanwhile, so hold it for the whole LLM call
+ * (retries included). Returns NULL if no tools are registered.
+ */
+const char *tool_registry_acquire_tools_json(void);
+
+/**
+ * Drop a reference taken by tool_registry_acquire_tools_json().
  */
-const char *tool_registry_get_tools_json(void);
+void tool_registry_release_tools_json(const char *tools_json);
+
+/**
+ * The same tool set as an acquired tools_json, pre-rendered for a wire
+ * format. Valid for as long as tools_json stays acquired; NULL if
+ * tools_json did not come from the registry.
+ */
+const char *tool_registry_get_tools_blob(const char *tools_json, tool_schema_format_t fmt);
+
+/**
+ * Current registry generation. Bumped whenever tools or providers
+ * are registered, unregistered or refreshed.
+ */
+uint32_t tool_registry_get_generation(void);
 
 /**
  * Execute a tool by name.
@@ -82,3 +125,9 @@ const char *tool_registry_get_tools_json(void);
  */
 esp_err_t tool_registry_execute(const char *name, const char *input_json,
                                 char *output, size_t output_size);
+
+/**
+ * Whether a tool may run concurrently with other tool calls.
+ * Unknown tools are treated as exclusive.
+ */
+bool tool_registry_is_parallel_safe(const char *name);
@@ -4,12 +4,14 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <ctype.h>
 #include <sys/stat.h>
 #include <dirent.h>
 #include <errno.h>
 #include "esp_log.h"
 #include "skills/skill_rollback.h"
+#include "assets/asset_store.h"
 
 #if CONFIG_MIMI_ENABLE_SKILLS
 #include "skills/skill_engine.h"
@@ -261,95 +263,7 @@ typedef struct {
     const char *bus;
 } template_info_t;
 
-static const char *s_template_content[] = {
-    /* i2c_sensor */
-    "SKILL = {\n"
-    "    name = \"i2c_sensor_demo\",\n"
-    "    version = \"1.0.0\",\n"
-    "    author = \"agent\",\n"
-    "    description = \"Reads generic I2C register\",\n"
-    "    classification = { category=\"hardware\", type=\"sensor\", bus=\"i2c\" },\n"
-    "    permissions = { i2c={\"i2c0\"} }\n"
-    "}\n\n"
-    "function read_reg(reg)\n"
-    "    -- Assuming i2c0 is configured. addr=0x40 example\n"
-    "    local dev_addr = 0x40\n"
-    "    local i2c_num = 0\n"
-    "    -- Write register address\n"
-    "    local ok = hw.i2c_init(\"i2c0\")\n"
-    "    if not ok then return nil, \"i2c init failed\" end\n"
-    "    -- Read 1 byte from register\n"
-    "    local data = hw.i2c_read(\"i2c0\", dev_addr, reg, 1)\n"
-    "    if not data then return nil, \"read failed\" end\n"
-    "    return string.byte(data, 1)\n"
-    "end\n\n"
-    "TOOLS = {\n"
-    "    {\n"
-    "        name = \"read_value\",\n"
-    "        description = \"Read sensor value from register\",\n"
-    "        parameters = { type=\"object\", properties={ reg={type=\"integer\"} }, required={\"reg\"} },\n"
-    "        handler = function(args)\n"
-    "            local val, err = read_reg(args.reg)\n"
-    "            if err then return { error=err } end\n"
-    "            return { value=val }\n"
-    "        end\n"
-    "    }\n"
-    "}",
-
-    /* gpio_control */
-    "SKILL = {\n"
-    "    name = \"gpio_toggle\",\n"
-    "    version = \"1.0.0\",\n"
-    "    author = \"agent\",\n"
-    "    description = \"Control GPIO pin\",\n"
-    "    classification = { category=\"hardware\", type=\"actuator\", bus=\"gpio\" },\n"
-    "    permissions = { gpio={\"18\"} } -- Example pin\n"
-    "}\n\n"
-    "local PIN = 18\n\n"
-    "function set_state(on)\n"
-    "    hw.gpio_set_mode(PIN, \"output\")\n"
-    "    hw.gpio_write(PIN, on and 1 or 0)\n"
-    "    return true\n"
-    "end\n\n"
-    "TOOLS = {\n"
-    "    {\n"
-    "        name = \"set_led\",\n"
-    "        description = \"Turn LED on or off\",\n"
-    "        parameters = { type=\"object\", properties={ on={type=\"boolean\"} }, required={\"on\"} },\n"
-    "        handler = function(args)\n"
-    "            set_state(args.on)\n"
-    "            return { ok=true, state=args.on }\n"
-    "        end\n"
-    "    }\n"
-    "}",
-
-    /* timer_service */
-    "SKILL = {\n"
-    "    name = \"timer_demo\",\n"
-    "    version = \"1.0.0\",\n"
-    "    author = \"agent\",\n"
-    "    description = \"Runs a task every 5 seconds\",\n"
-    "    classification = { category=\"software\", type=\"service\", bus=\"none\" }\n"
-    "}\n\n"
-    "local count = 0\n\n"
-    "function on_timer()\n"
-    "    count = count + 1\n"
-    "    print(\"Timer tick: \" .. count)\n"
-    "end\n\n"
-    "-- Start periodic timer every 5000ms\n"
-    "local timer_id = hw.timer_every(5000, on_timer)\n\n"
-    "TOOLS = {\n"
-    "    {\n"
-    "        name = \"get_count\",\n"
-    "        description = \"Get current timer tick count\",\n"
-    "        parameters = { type=\"object\", properties={}, required={} },\n"
-    "        handler = function(args)\n"
-    "            return { count=count }\n"
-    "        end\n"
-    "    }\n"
-    "}"
-};
-
+/* Template code is asset_data/templates/<name>.lua in the asset partition */
 static const template_info_t s_templates[] = {
     {
         .name     = "i2c_sensor",
@@ -437,8 +351,10 @@ esp_err_t tool_skill_get_template_execute(const char *input_json, char *output,
         return ESP_OK; /* Not a system error, just not found */
     }
 
-    int template_content_count = (int)(sizeof(s_template_content) / sizeof(s_template_content[0]));
-    if (idx >= template_content_count || !s_template_content[idx]) {
+    char asset_name[64];
+    snprintf(asset_name, sizeof(asset_name), "templates/%s.lua", s_templates[idx].name);
+    char *code = asset_store_read_text(asset_name);
+    if (!code) {
         snprintf(output, output_size, "{\"error\":\"template content missing\"}");
         return ESP_FAIL;
     }
@@ -446,7 +362,8 @@ esp_err_t tool_skill_get_template_execute(const char *input_json, char *output,
     /* Return JSON object with code */
     cJSON *resp = cJSON_CreateObject();
     cJSON_AddStringToObject(resp, "name", s_templates[idx].name);
-    cJSON_AddStringToObject(resp, "code", s_template_content[idx]);
+    cJSON_AddStringToObject(resp, "code", code);
+    free(code);
     
     char *json = cJSON_PrintUnformatted(resp);
     cJSON_Delete(resp);
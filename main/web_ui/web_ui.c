@@ -15,12 +15,16 @@
 #include "../skills/skill_rollback.h"
 #include "../discovery/mdns_service.h"
 #include "../tools/tool_registry.h"
+#include "../memory/memory_store.h"
+#include "../memory/storage_manager.h"
 #include "../extensions/zigbee_gateway.h"
 #include "../system_manager.h"
+#include "../assets/asset_store.h"
 #include "nvs.h"
 
 #include <string.h>
 #include <stdio.h>
+#include <inttypes.h>
 #include "esp_log.h"
 #include "esp_http_server.h"
 #include "cJSON.h"
@@ -43,1545 +47,74 @@ static httpd_handle_t s_http_server = NULL;
 
 /* ── SPA HTML Page ───────────────────────────────────────────────── */
 
-static const char *HTML_PAGE =
-"<!DOCTYPE html>"
-"<html>"
-"<head>"
-"  <meta charset='utf-8'>"
-"  <meta name='viewport' content='width=device-width, initial-scale=1'>"
-"  <title>Esp32Claw</title>"
-"  <script src='https://cdn.jsdelivr.net/npm/marked/marked.min.js'></script>"
-"  <link rel='stylesheet' href='https://cdnjs.cloudflare.com/ajax/libs/highlight.js/11.9.0/styles/github-dark.min.css'>"
-"  <script src='https://cdnjs.cloudflare.com/ajax/libs/highlight.js/11.9.0/highlight.min.js'></script>"
-"  <link rel='icon' href='data:image/svg+xml,<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 100 100\"><text y=\".9em\" font-size=\"90\">🦊</text></svg>'>"
-"  <style>"
-"    :root {"
-"      --primary: #6366f1; --primary-dark: #4f46e5;"
-"      --bg: #f8fafc; --surface: #ffffff;"
-"      --text: #1e293b; --text-secondary: #64748b;"
-"      --border: #e2e8f0; --success: #22c55e;"
-"      --error: #ef4444; --warning: #f59e0b;"
-"    }"
-"    * { box-sizing: border-box; margin: 0; padding: 0; }"
-"    body { font-family: -apple-system, BlinkMacSystemFont, 'Segoe UI', Roboto, sans-serif; background: var(--bg); color: var(--text); height: 100vh; display: flex; }"
-"    /* Sidebar */"
-"    .sidebar { width: 220px; background: var(--surface); border-right: 1px solid var(--border); display: flex; flex-direction: column; }"
-"    .logo { padding: 20px; font-size: 20px; font-weight: 700; color: var(--primary); border-bottom: 1px solid var(--border); display: flex; align-items: center; gap: 8px; }"
-"    .logo-icon { font-size: 24px; }"
-"    .nav { flex: 1; padding: 12px; }"
-"    .nav-item { display: flex; align-items: center; gap: 10px; padding: 12px 14px; border-radius: 8px; color: var(--text-secondary); cursor: pointer; transition: all 0.2s; margin-bottom: 4px; }"
-"    .nav-item:hover { background: var(--bg); color: var(--text); }"
-"    .nav-item.active { background: var(--primary); color: white; }"
-"    .nav-icon { font-size: 18px; width: 24px; text-align: center; }"
-"    .nav-label { font-size: 14px; font-weight: 500; }"
-"    .sidebar-footer { padding: 16px; border-top: 1px solid var(--border); }"
-"    .ws-status { display: flex; align-items: center; gap: 8px; font-size: 12px; color: var(--text-secondary); }"
-"    .ws-dot { width: 8px; height: 8px; border-radius: 50%; background: var(--error); }"
-"    .ws-dot.connected { background: var(--success); }"
-"    /* Main Content */"
-"    .main { flex: 1; overflow-y: auto; }"
-"    .header { background: var(--surface); border-bottom: 1px solid var(--border); padding: 16px 24px; display: flex; justify-content: space-between; align-items: center; }"
-"    .header h1 { font-size: 18px; font-weight: 600; }"
-"    .header-right { display: flex; align-items: center; gap: 16px; }"
-"    .ip-badge { background: var(--bg); padding: 6px 12px; border-radius: 6px; font-size: 13px; color: var(--text-secondary); }"
-"    .content { padding: 24px; }"
-"    /* Cards */"
-"    .card { background: var(--surface); border-radius: 12px; padding: 20px; margin-bottom: 16px; box-shadow: 0 1px 3px rgba(0,0,0,0.05); }"
-"    .card-header { display: flex; justify-content: space-between; align-items: center; margin-bottom: 16px; }"
-"    .card-title { font-size: 16px; font-weight: 600; }"
-"    /* Forms */"
-"    .form-row { display: flex; gap: 16px; margin-bottom: 16px; }"
-"    .form-group { flex: 1; }"
-"    .form-group label { display: block; font-size: 13px; color: var(--text-secondary); margin-bottom: 6px; }"
-"    .form-group input, .form-group select { width: 100%; padding: 10px 12px; border: 1px solid var(--border); border-radius: 8px; font-size: 14px; transition: border-color 0.2s; }"
-"    .form-group input:focus, .form-group select:focus { outline: none; border-color: var(--primary); }"
-"    /* Buttons */"
-"    .btn { padding: 10px 20px; border-radius: 8px; font-size: 14px; font-weight: 500; cursor: pointer; border: none; transition: all 0.2s; }"
-"    .btn-primary { background: var(--primary); color: white; }"
-"    .btn-primary:hover { background: var(--primary-dark); }"
-"    .btn-danger { background: var(--error); color: white; }"
-"    .btn-danger:hover { background: #dc2626; }"
-"    .btn-sm { padding: 6px 12px; font-size: 12px; }"
-"    /* Status Grid */"
-"    .status-grid { display: grid; grid-template-columns: repeat(auto-fit, minmax(150px, 1fr)); gap: 12px; }"
-"    .status-item { background: var(--bg); padding: 14px; border-radius: 8px; }"
-"    .status-label { font-size: 12px; color: var(--text-secondary); margin-bottom: 4px; }"
-"    .status-value { font-size: 15px; font-weight: 600; }"
-"    /* Chat */"
-"    .markdown-body { font-size: 14px; line-height: 1.6; overflow-wrap: break-word; }"
-"    .markdown-body pre { background: #0d1117; padding: 12px; border-radius: 6px; overflow-x: auto; position: relative; margin-bottom: 10px; }"
-"    .markdown-body code { font-family: Consolas, Monaco, 'Andale Mono', monospace; font-size: 13px; }"
-"    .markdown-body p { margin-bottom: 10px; }"
-"    .markdown-body ul, .markdown-body ol { margin-left: 20px; margin-bottom: 10px; }"
-"    .markdown-body blockquote { border-left: 4px solid var(--border); padding-left: 10px; color: var(--text-secondary); margin-bottom: 10px; }"
-"    .copy-btn { position: absolute; top: 4px; right: 4px; padding: 4px 8px; background: #21262d; border: 1px solid #30363d; border-radius: 4px; color: #c9d1d9; cursor: pointer; font-size: 11px; opacity: 0; transition: opacity 0.2s; }"
-"    .markdown-body pre:hover .copy-btn { opacity: 1; }"
-"    .chat-container { height: calc(100vh - 140px); display: flex; flex-direction: column; }"
-"    .chat-messages { flex: 1; overflow-y: auto; padding: 16px; background: var(--bg); border-radius: 12px; margin-bottom: 16px; }"
-"    .chat-message { max-width: 80%; margin-bottom: 16px; padding: 12px 16px; border-radius: 16px; }"
-"    .chat-message.user { background: var(--primary); color: white; margin-left: auto; border-bottom-right-radius: 4px; }"
-"    .chat-message.assistant { background: var(--surface); border: 1px solid var(--border); border-bottom-left-radius: 4px; }"
-"    .chat-message.error { background: #fef2f2; color: var(--error); border: 1px solid #fecaca; }"
-"    .chat-message .time { font-size: 11px; opacity: 0.7; margin-top: 6px; }\n"
-"    .typing-indicator { display: flex; gap: 4px; padding: 6px 4px; }\n"
-"    .typing-dot { width: 6px; height: 6px; background: #94a3b8; border-radius: 50%; animation: typing 1.4s infinite ease-in-out both; }\n"
-"    .typing-dot:nth-child(1) { animation-delay: -0.32s; }\n"
-"    .typing-dot:nth-child(2) { animation-delay: -0.16s; }\n"
-"    @keyframes typing { 0%, 80%, 100% { transform: scale(0); } 40% { transform: scale(1); } }\n"
-"    .chat-input-row { display: flex; gap: 12px; align-items: center; }"
-"    .chat-input-row select { padding: 12px; border: 1px solid var(--border); border-radius: 8px; font-size: 14px; min-width: 160px; }"
-"    .chat-input-row input { flex: 1; padding: 12px 16px; border: 1px solid var(--border); border-radius: 24px; font-size: 14px; }"
-"    .chat-input-row input:focus { outline: none; border-color: var(--primary); }"
-"    .chat-input-row button { padding: 12px 24px; background: var(--primary); color: white; border: none; border-radius: 24px; cursor: pointer; font-size: 14px; font-weight: 500; }"
-"    .chat-input-row button:hover { background: var(--primary-dark); }"
-"    .chat-input-row button:disabled { background: #94a3b8; cursor: not-allowed; }"
-"    /* Toast */"
-"    .toast { position: fixed; top: 20px; right: 20px; padding: 12px 20px; border-radius: 8px; font-size: 14px; z-index: 1000; animation: slideIn 0.3s ease; }"
-"    .toast.success { background: var(--success); color: white; }"
-"    .toast.error { background: var(--error); color: white; }"
-"    .toast.warning { background: var(--warning); color: white; }"
-"    @keyframes slideIn { from { transform: translateX(100%); opacity: 0; } to { transform: translateX(0); opacity: 1; } }"
-"    /* Views */"
-"    .view { display: none; }"
-"    .view.active { display: block; }"
-"    /* Board Layout */"
-"    /* Board Layout (Horizontal) */"
-"    .board-layout { display: flex; flex-direction: column; gap: 16px; }"
-"    .board-row { display: flex; flex-wrap: wrap; gap: 6px; justify-content: flex-start; background: #fff; padding: 10px; border-radius: 8px; border: 1px solid #e2e8f0; }"
-"    .board-row h4 { width: 100%; margin: 0 0 8px 0; font-size: 13px; color: #64748b; border-bottom: 1px solid #f1f5f9; padding-bottom: 4px; }"
-"    .pin-card { display: flex; flex-direction: column; align-items: center; width: 64px; padding: 6px 4px; background: #f8fafc; border: 1px solid #cbd5e1; border-radius: 6px; }"
-"    .pin-card.restricted { opacity: 0.6; background: #f1f5f9; border-color: #e2e8f0; }"
-"    .pin-card.label-only { background: transparent; border: 1px dashed #cbd5e1; }"
-"    .pin-lbl { font-family: monospace; font-size: 12px; font-weight: bold; color: #334155; margin-bottom: 4px; }"
-"    .btn-group-v { display: flex; flex-direction: column; gap: 2px; width: 100%; }"
-"    .btn-xs { padding: 2px 0; font-size: 10px; width: 100%; text-align: center; }"
-"    .badge-warn { font-size: 9px; color: #b45309; background: #fef3c7; padding: 2px 4px; border-radius: 3px; width: 100%; text-align: center; border: 1px solid #fcd34d; }"
-"  </style>"
-"</head>"
-"<body>\n"
-"  <div id='safeModeBanner' style='display:none;background:#ef4444;color:white;text-align:center;padding:10px;font-weight:bold;'>⚠ SAFE MODE - Limited Functionality</div>"
-
-"  <script>\n"
-"    /* Core Functions */\n"
-"    function showToast(msg, type) {\n"
-"      const toast = document.createElement('div');\n"
-"      toast.className = 'toast ' + type;\n"
-"      toast.textContent = msg;\n"
-"      document.body.appendChild(toast);\n"
-"      setTimeout(() => toast.remove(), 3000);\n"
-"    }\n"
-"\n"
-"    function formatUptime(ms) {\n"
-"      if (!ms) return '0秒';\n"
-"      const s = Math.floor(ms / 1000);\n"
-"      const m = Math.floor(s / 60);\n"
-"      const h = Math.floor(m / 60);\n"
-"      const d = Math.floor(h / 24);\n"
-"      if (h > 0) return h + '小时 ' + (m % 60) + '分钟';\n"
-"      if (m > 0) return m + '分钟 ' + (s % 60) + '秒';\n"
-"      return s + '秒';\n"
-"    }\n"
-"\n"
-"    /* Status */\n"
-"    async function checkSafeMode() {\n"
-"      try {\n"
-"        const resp = await fetch('/api/system/health');\n"
-"        const data = await resp.json();\n"
-"        if (data.safe_mode) {\n"
-"          const banner = document.getElementById('safeModeBanner');\n"
-"          if (banner) banner.style.display = 'block';\n"
-"          showToast('⚠ SAFE MODE ACTIVE', 'warning');\n"
-"        }\n"
-"      } catch(e) {}\n"
-"    }\n"
-"    \n"
-"    async function refreshStatus() {\n"
-"      try {\n"
-"        const resp = await fetch('/api/status');\n"
-"        const data = await resp.json();\n"
-"        const grid = document.getElementById('statusGrid');\n"
-"        if(grid) {\n"
-"          grid.innerHTML = '';\n"
-"          const items = [\n"
-"            { label: 'WiFi IP', value: data.wifi_ip || '未连接' },\n"
-"            { label: 'LLM 提供商', value: data.provider || '未知' },\n"
-"            { label: '模型', value: data.model || '未设置' },\n"
-"            { label: '运行时间', value: formatUptime(data.uptime_ms) },\n"
-"          ];\n"
-"          items.forEach(item => {\n"
-"            grid.innerHTML += '<div class=\\'status-item\\'><div class=\\'status-label\\'>' + item.label + '</div><div class=\\'status-value\\'>' + item.value + '</div></div>';\n"
-"          });\n"
-"        }\n"
-"        const ipBadge = document.getElementById('ipBadge');\n"
-"        if(ipBadge) ipBadge.textContent = data.wifi_ip || '无网络';\n"
-"      } catch(e) { showToast('获取状态失败', 'error'); }\n"
-"    }\n"
-"\n"
-"    /* Navigation */\n"
-"    function switchView(view) {\n"
-"      document.querySelectorAll('.view').forEach(v => v.classList.remove('active'));\n"
-"      document.querySelectorAll('.nav-item').forEach(n => n.classList.remove('active'));\n"
-"      const viewEl = document.getElementById('view-' + view);\n"
-"      if(viewEl) viewEl.classList.add('active');\n"
-"      const navItem = document.querySelector('[data-view=' + view + ']');\n"
-"      if (navItem) navItem.classList.add('active');\n"
-"      const titles = { dashboard: '仪表盘', chat: '聊天', agent: 'Agent', settings: '设置', tools: '工具', hardware: '硬件', skillhub: 'SkillHub', installed: '已安装技能', fleet: '设备集群' };\n"
-"      const pageTitle = document.getElementById('pageTitle');\n"
-"      if(pageTitle) pageTitle.textContent = titles[view] || view;\n"
-"    }\n"
-"    window.onload = function() { checkSafeMode(); refreshStatus(); };\n""  </script>\n"
-"  <!-- Sidebar -->"
-"  <div class='sidebar'>"
-"    <div class='logo'>"
-"      <span class='logo-icon'>🦊</span>"
-"      <span>Esp32Claw</span>"
-"    </div>"
-"    <div class='nav'>"
-"      <div class='nav-item active' data-view='dashboard'>"
-"        <span class='nav-icon'>📊</span>"
-"        <span class='nav-label'>仪表盘</span>"
-"      </div>"
-"      <div class='nav-item' data-view='chat'>"
-"        <span class='nav-icon'>💬</span>"
-"        <span class='nav-label'>聊天</span>"
-"      </div>"
-"      <div class='nav-item' data-view='agent'>"
-"        <span class='nav-icon'>🤖</span>"
-"        <span class='nav-label'>Agent</span>"
-"      </div>"
-"      <div class='nav-item' data-view='hardware'>"
-"        <span class='nav-icon'>🔌</span>"
-"        <span class='nav-label'>硬件</span>"
-"      </div>"
-"      <div class='nav-item' data-view='skillhub'>"
-"        <span class='nav-icon'>📦</span>"
-"        <span class='nav-label'>SkillHub</span>"
-"      </div>"
-"      <div class='nav-item' data-view='settings'>"
-"        <span class='nav-icon'>⚙️</span>"
-"        <span class='nav-label'>设置</span>"
-"      </div>"
-"      <div class='nav-item' data-view='tools'>"
-"        <span class='nav-icon'>🔧</span>"
-"        <span class='nav-label'>工具</span>"
-"      </div>"
-"      "
-
-"    </div>"
-"    <div class='sidebar-footer'>"
-"      <div class='ws-status'>"
-"        <div class='ws-dot' id='wsDot'></div>"
-"        <span id='wsText'>未连接</span>"
-"      </div>"
-"    </div>"
-"  </div>"
-""
-"  <!-- Main Content -->"
-"  <div class='main'>"
-"    <div class='header'>"
-"      <h1 id='pageTitle'>仪表盘</h1>"
-"      <div class='header-right'>"
-"        <span class='ip-badge' id='ipBadge'>获取IP...</span>"
-"      </div>"
-"    </div>"
-""
-"    <!-- Dashboard View -->"
-"    <div class='view active' id='view-dashboard'>"
-"      <div class='content'>"
-"        <div class='card'>"
-"          <div class='card-header'>"
-"            <span class='card-title'>系统状态</span>"
-"            <button class='btn btn-sm btn-primary' onclick='refreshStatus()'>刷新</button>"
-"          </div>"
-"          <div class='status-grid' id='statusGrid'></div>"
-"        </div>"
-""
-"        <div class='card'>"
-"          <div class='card-header'>"
-"            <span class='card-title'>快速操作</span>"
-"          </div>"
-"          <div class='form-row'>"
-"            <button class='btn btn-primary' onclick='switchView(\"chat\")'>进入聊天</button>"
-"            <button class='btn btn-danger' onclick='reboot()'>重启设备</button>"
-"          </div>"
-"        </div>"
-"      </div>"
-"    </div>"
-""
-"    <!-- Chat View -->"
-"    <div class='view' id='view-chat'>"
-"      <div class='content'>"
-"        <div class='chat-container'>"
-"          <div class='chat-messages' id='chatMessages'></div>"
-"          <div class='chat-input-row'>"
-"            <select id='modelSelect'>"
-"              <option value=''>默认模型</option>"
-"              <option value='claude-opus-4-5'>Claude Opus 4.5</option>"
-"              <option value='claude-sonnet-4-5'>Claude Sonnet 4.5</option>"
-"              <option value='claude-haiku-3-5'>Claude Haude 3.5</option>"
-"              <option value='gpt-4o'>GPT-4o</option>"
-"              <option value='gpt-4o-mini'>GPT-4o Mini</option>"
-"              <option value='miniMax-Realtime'>MiniMax Realtime</option>"
-"              <option value='miniMax-M2.5'>MiniMax M2.5</option>"
-"              <option value='ollama:llama3'>Ollama Llama3</option>"
-"              <option value='ollama:qwen2.5'>Ollama Qwen2.5</option>"
-"            </select>"
-"            <input type='text' id='chatInput' placeholder='发送消息...' onkeypress='handleChatKey(event)'>"
-"            <button onclick='sendChat()' id='sendBtn'>发送</button>"
-"          </div>"
-"        </div>"
-"      </div>"
-"    </div>"
-""
-"    <!-- Agent View -->"
-"    <div class='view' id='view-agent'>"
-"      <div class='content'>"
-"        <div class='card'>"
-"          <div class='card-header'>"
-"            <span class='card-title'>Agent 配置</span>"
-"            <button class='btn btn-sm btn-primary' onclick='saveAgent()'>保存</button>"
-"          </div>"
-"          <div class='form-group'>"
-"            <label>SOUL.md (性格设定)</label>"
-"            <textarea id='agentSoul' rows='6' style='width:100%;font-family:monospace;font-size:13px;padding:8px;border:1px solid #333;border-radius:6px;background:#1a1a2e;color:#e0e0e0;resize:vertical'></textarea>"
-"          </div>"
-"          <div class='form-group'>"
-"            <label>USER.md (用户信息)</label>"
-"            <textarea id='agentUser' rows='6' style='width:100%;font-family:monospace;font-size:13px;padding:8px;border:1px solid #333;border-radius:6px;background:#1a1a2e;color:#e0e0e0;resize:vertical'></textarea>"
-"          </div>"
-"          <div class='form-group'>"
-"            <label>MEMORY.md (长期记忆)</label>"
-"            <textarea id='agentMemory' rows='6' style='width:100%;font-family:monospace;font-size:13px;padding:8px;border:1px solid #333;border-radius:6px;background:#1a1a2e;color:#e0e0e0;resize:vertical'></textarea>"
-"          </div>"
-"          <div class='form-group'>"
-"            <label>HEARTBEAT.md (定时任务)</label>"
-"            <textarea id='agentHeartbeat' rows='6' style='width:100%;font-family:monospace;font-size:13px;padding:8px;border:1px solid #333;border-radius:6px;background:#1a1a2e;color:#e0e0e0;resize:vertical'></textarea>"
-"          </div>"
-"        </div>"
-"      </div>"
-"    </div>"
-""
-"    <!-- Settings View -->"
-"    <div class='view' id='view-settings'>"
-"      <div class='content'>"
-"        <div class='card'>"
-"          <div class='card-header'>"
-"            <span class='card-title'>LLM 配置</span>"
-"            <button class='btn btn-sm btn-primary' onclick='saveSettings()'>保存</button>"
-"          </div>"
-"          <div class='form-row'>"
-"            <div class='form-group'>"
-"              <label>提供商</label>"
-"              <select id='provider'>"
-"                <option value='anthropic'>Anthropic (Claude)</option>"
-"                <option value='openai'>OpenAI (GPT)</option>"
-"                <option value='minimax'>MiniMax</option>"
-"                <option value='minimax_coding'>MiniMax Coding</option>"
-"                <option value='ollama'>Ollama (本地)</option>"
-"              </select>"
-"            </div>"
-"            <div class='form-group'>"
-"              <label>默认模型</label>"
-"              <input type='text' id='model' placeholder='如: claude-opus-4-5'>"
-"            </div>"
-"          </div>"
-"          <div class='form-row'>"
-"            <div class='form-group'>"
-"              <label>API Key</label>"
-"              <input type='password' id='api_key' placeholder='API Key'>"
-"            </div>"
-"          </div>"
-"          <div class='form-row' id='ollamaFields' style='display:none'>"
-"            <div class='form-group'>"
-"              <label>Ollama 主机</label>"
-"              <input type='text' id='ollama_host' placeholder='如: 192.168.1.100'>"
-"            </div>"
-"            <div class='form-group'>"
-"              <label>Ollama 端口</label>"
-"              <input type='text' id='ollama_port' placeholder='默认: 11434'>"
-"            </div>"
-"          </div>"
-"          <div class='form-row'>"
-"            <div class='form-group'>"
-"              <label>OpenAI Audio API Key (用于语音)</label>"
-"              <input type='password' id='openai_api_audio' placeholder='sk-xxxx...'>"
-"            </div>"
-"          </div>"
-"          <div class='form-row'>"
-"            <div class='form-group'>"
-"              <label>ASR 端点 (语音识别 URL)</label>"
-"              <input type='text' id='asr_endpoint' placeholder='https://api.openai.com/v1/audio/transcriptions'>"
-"            </div>"
-"            <div class='form-group'>"
-"              <label>TTS 端点 (语音合成 URL)</label>"
-"              <input type='text' id='tts_endpoint' placeholder='https://api.openai.com/v1/audio/speech'>"
-"            </div>"
-"          </div>"
-"          <div class='form-row'>"
-"            <div class='form-group' style='flex-direction:row;align-items:center;gap:12px'>"
-"              <input type='checkbox' id='streaming' style='width:18px;height:18px'>"
-"              <label for='streaming' style='margin:0'>启用流式输出 (Streaming)</label>"
-"            </div>"
-"          </div>"
-"        </div>"
-""
-"        <div class='card'>"
-"          <div class='card-header'>"
-"            <span class='card-title'>设备操作</span>"
-"          </div>"
-"          <button class='btn btn-danger' onclick='reboot()'>重启设备</button>"
-"        </div>"
-"      </div>"
-"    </div>"
-""
-"    <!-- Tools View -->"
-"    <div class='view' id='view-tools'>"
-"      <div class='content'>"
-""
-"        <div class='card'>"
-"          <div class='card-header'>"
-"            <span class='card-title'>🔍 网络搜索 (Brave)</span>"
-"            <button class='btn btn-sm btn-primary' onclick='saveSearchKey()'>保存</button>"
-"          </div>"
-"          <div class='form-group'>"
-"            <label>Brave Search API Key</label>"
-"            <input type='password' id='searchKey' placeholder='BSA-xxxx...'>"
-"          </div>"
-"          <div style='font-size:12px;color:#888;margin-top:4px'>从 <a href='https://brave.com/search/api/' style='color:#6C9BD2' target='_blank'>brave.com/search/api</a> 获取免费 API Key</div>"
-"        </div>"
-""
-"        <div class='card'>"
-"          <div class='card-header'>"
-"            <span class='card-title'>⏰ 定时任务</span>"
-"            <button class='btn btn-sm btn-primary' onclick='loadCronJobs()'>刷新</button>"
-"          </div>"
-"          <div id='cronList' style='font-size:13px;color:#ccc'>加载中...</div>"
-"        </div>"
-""
-"        <div class='card'>"
-"          <div class='card-header'>"
-"            <span class='card-title'>工具状态</span>"
-"          </div>"
-"          <div style='font-size:13px;color:#ccc;line-height:2'>"
-"            <div>📅 <b>获取时间</b>：通过 SNTP 自动同步，无需配置</div>"
-"            <div>📁 <b>文件管理</b>：读 / 写 / 编辑 / 列出 SPIFFS 文件</div>"
-"          </div>"
-"        </div>"
-""
-"      </div>"
-"    </div>"
-""
-"    <!-- Hardware View -->"
-"    <div class='view' id='view-hardware'>"
-"      <div class='content'>"
-"        <!-- Pin Configuration -->"
-"        <div class='card'>"
-"          <div class='card-header'>"
-"            <span class='card-title'>引脚配置</span>"
-"            <button class='btn btn-sm btn-primary' onclick='savePinConfig()'>保存配置</button>"
-"          </div>"
-"          <div style='display:grid;grid-template-columns:repeat(auto-fit,minmax(200px,1fr));gap:16px;'>"
-"            <div>"
-"              <div style='font-size:13px;color:var(--text-secondary);margin-bottom:4px;'>RGB LED</div>"
-"              <input type='number' id='cfg_rgb_pin' placeholder='GPIO' style='width:100%;padding:8px;border:1px solid var(--border);border-radius:6px;'>"
-"            </div>"
-"            <div>"
-"              <div style='font-size:13px;color:var(--text-secondary);margin-bottom:4px;'>I2C0 SDA (OLED)</div>"
-"              <input type='number' id='cfg_i2c0_sda' placeholder='GPIO' style='width:100%;padding:8px;border:1px solid var(--border);border-radius:6px;'>"
-"            </div>"
-"            <div>"
-"              <div style='font-size:13px;color:var(--text-secondary);margin-bottom:4px;'>I2C0 SCL (OLED)</div>"
-"              <input type='number' id='cfg_i2c0_scl' placeholder='GPIO' style='width:100%;padding:8px;border:1px solid var(--border);border-radius:6px;'>"
-"            </div>"
-"            <div>"
-"              <div style='font-size:13px;color:var(--text-secondary);margin-bottom:4px;'>I2S0 WS (麦克风)</div>"
-"              <input type='number' id='cfg_i2s0_ws' placeholder='GPIO' style='width:100%;padding:8px;border:1px solid var(--border);border-radius:6px;'>"
-"            </div>"
-"            <div>"
-"              <div style='font-size:13px;color:var(--text-secondary);margin-bottom:4px;'>I2S0 SCK (麦克风)</div>"
-"              <input type='number' id='cfg_i2s0_sck' placeholder='GPIO' style='width:100%;padding:8px;border:1px solid var(--border);border-radius:6px;'>"
-"            </div>"
-"            <div>"
-"              <div style='font-size:13px;color:var(--text-secondary);margin-bottom:4px;'>I2S0 SD (麦克风)</div>"
-"              <input type='number' id='cfg_i2s0_sd' placeholder='GPIO' style='width:100%;padding:8px;border:1px solid var(--border);border-radius:6px;'>"
-"            </div>"
-"            <div>"
-"              <div style='font-size:13px;color:var(--text-secondary);margin-bottom:4px;'>I2S1 DIN (功放)</div>"
-"              <input type='number' id='cfg_i2s1_din' placeholder='GPIO' style='width:100%;padding:8px;border:1px solid var(--border);border-radius:6px;'>"
-"            </div>"
-"            <div>"
-"              <div style='font-size:13px;color:var(--text-secondary);margin-bottom:4px;'>I2S1 BCLK (功放)</div>"
-"              <input type='number' id='cfg_i2s1_bclk' placeholder='GPIO' style='width:100%;padding:8px;border:1px solid var(--border);border-radius:6px;'>"
-"            </div>"
-"            <div>"
-"              <div style='font-size:13px;color:var(--text-secondary);margin-bottom:4px;'>I2S1 LRC (功放)</div>"
-"              <input type='number' id='cfg_i2s1_lrc' placeholder='GPIO' style='width:100%;padding:8px;border:1px solid var(--border);border-radius:6px;'>"
-"            </div>"
-"            <div>"
-"              <div style='font-size:13px;color:var(--text-secondary);margin-bottom:4px;'>音量减按钮</div>"
-"              <input type='number' id='cfg_vol_down' placeholder='GPIO' style='width:100%;padding:8px;border:1px solid var(--border);border-radius:6px;'>"
-"            </div>"
-"            <div>"
-"              <div style='font-size:13px;color:var(--text-secondary);margin-bottom:4px;'>音量加按钮</div>"
-"              <input type='number' id='cfg_vol_up' placeholder='GPIO' style='width:100%;padding:8px;border:1px solid var(--border);border-radius:6px;'>"
-"            </div>"
-"          </div>"
-"          <div id='pin-config-status' style='margin-top:12px;font-size:13px;'></div>"
-"        </div>"
-""
-"        <!-- Hardware Status -->"
-"        <div class='card'>"
-"          <div class='card-header'>"
-"            <span class='card-title'>硬件状态</span>"
-"            <button class='btn btn-sm btn-primary' onclick='loadHardwareStatus()'>刷新</button>"
-"          </div>"
-"          <div id='hw-status' style='font-size:13px;color:#ccc'>加载中...</div>"
-"        </div>"
-""
-"        <div class='card'>"
-"          <div class='card-header'>"
-"            <span class='card-title'>I2C 设备扫描</span>"
-"            <button class='btn btn-sm btn-primary' onclick='scanI2C()'>扫描</button>"
-"          </div>"
-"          <div id='i2c-result' style='font-size:13px;color:#ccc'>点击扫描...</div>"
-"        </div>"
-""
-"        <div class='card'>"
-"          <div class='card-header'>"
-"            <span class='card-title'>GPIO 控制</span>"
-"          </div>"
-"          <div id='gpio-grid' style='display:grid;grid-template-columns:repeat(auto-fit, minmax(150px, 1fr));gap:8px;font-size:13px;color:#ccc'></div>"
-"        </div>"
-"      </div>"
-"    </div>"
-""
-"    <!-- SkillHub View (Unified) -->"
-"    <div class='view' id='view-skillhub'>"
-"      <div class='content'>"
-"        <!-- Main Tabs -->"
-"        <div class='card' style='margin-bottom:16px;'>"
-"          <div style='display:flex;gap:8px;'>"
-"            <button id='hub-btn-market' class='btn btn-sm btn-primary' onclick='switchHubTab(\"market\")'>应用市场 (Mock)</button>"
-"            <button id='hub-btn-installed' class='btn btn-sm' onclick='switchHubTab(\"installed\")'>已安装管理</button>"
-"            <button id='hub-btn-sources' class='btn btn-sm' onclick='switchHubTab(\"sources\")'>MCP 源</button>"
-"            <button id='hub-btn-fleet' class='btn btn-sm' onclick='switchHubTab(\"fleet\")'>集群 (Fleet)</button>"
-"          </div>"
-"        </div>"
-"        <!-- Tab: Market (Original SkillHub) -->"
-"        <div id='hub-content-market'>"
-"          <div class='card'>"
-"            <div style='display:flex;gap:12px;align-items:center;'>"
-"              <input type='text' id='skillSearch' placeholder='搜索传感器、舵机、LED...' style='flex:1;padding:12px 16px;border:1px solid var(--border);border-radius:8px;font-size:14px;' oninput='filterSkills()'>"
-"              <span id='slotInfo' style='font-size:13px;color:var(--text-secondary);white-space:nowrap;'>已安装: 0/0</span>"
-"            </div>"
-"            <div style='display:flex;gap:8px;margin-top:12px'>"
-"               <button id='tab-all' class='btn btn-sm btn-primary' onclick='switchSkillTab(\"all\")'>全部</button>"
-"               <button id='tab-hardware' class='btn btn-sm' onclick='switchSkillTab(\"hardware\")'>硬件</button>"
-"               <button id='tab-software' class='btn btn-sm' onclick='switchSkillTab(\"software\")'>软件</button>"
-"            </div>"
-"          </div>"
-"          <div id='skillsList'>"
-"            <div style='text-align:center;color:var(--text-secondary);padding:40px;'>加载中...</div>"
-"          </div>"
-"        </div>"
-"        <!-- Tab: Installed (Original Installed View) -->"
-"        <div id='hub-content-installed' style='display:none'>"
-"          <div class='card'>"
-"            <div class='card-header'>"
-"              <span class='card-title'>已安装技能</span>"
-"              <button class='btn btn-sm' onclick='reloadSkills()'>🚀 重载引擎</button>"
-"            </div>"
-"            <div id='installedList'>"
-"              <div style='text-align:center;color:var(--text-secondary);padding:20px;'>暂无已安装技能</div>"
-"            </div>"
-"          </div>"
-"        </div>"
-"        <!-- Tab: Sources (Original MCP View) -->"
-"        <div id='hub-content-sources' style='display:none'>"
-"          <div class='card'>"
-"            <div class='card-header'>"
-"              <div style='display:flex;align-items:center;gap:12px'>"
-"                <span class='card-title'>MCP Servers</span>"
-"                <button class='btn btn-sm btn-primary' onclick='showAddMcpSourceModal()'>+ 添加源</button>"
-"              </div>"
-"              <button class='btn btn-sm' onclick='loadMcpSources()'>🔄 刷新</button>"
-"            </div>"
-"            <div id='mcpSourceList' style='display:grid;gap:12px;grid-template-columns:repeat(auto-fit,minmax(300px,1fr))'>"
-"              <div style='text-align:center;color:var(--text-secondary);padding:20px;'>加载中...</div>"
-"            </div>"
-"          </div>"
-"        </div>"
-"        <!-- Tab: Fleet (Federation) -->"
-"        <div id='hub-content-fleet' style='display:none'>"
-"          <div class='card'>"
-"            <div class='card-header'>"
-"              <span class='card-title'>设备集群 (Fleet)</span>"
-"              <div style='display:flex;gap:8px'>"
-"                <button class='btn btn-sm' onclick='loadPeers()'>📡 扫描网络</button>"
-"                <button class='btn btn-sm btn-primary' onclick='showBroadcastModal()'>📢 广播命令</button>"
-"              </div>"
-"            </div>"
-"            <div id='peerList' style='display:grid;gap:12px;grid-template-columns:repeat(auto-fit,minmax(250px,1fr))'>"
-"              <div style='text-align:center;color:var(--text-secondary);padding:20px;'>点击扫描查找设备...</div>"
-"            </div>"
-"          </div>"
-"        </div>"
-"      </div>"
-"    </div>"
-""
-""
-"  </div>"
-""
-"  <script>\n"
-"    const WS_PORT = 18789;\n"
-"    let ws = null;\n"
-"    let myChatId = 'web_' + Math.random().toString(36).substr(2, 9);\n"
-"    let connected = false;\n"
-"    let pending = 0;\n"
-"    let pendingTimer = null;\n"
-"    let currentStreamDiv = null;\n"
-""
-""
-"    /* Navigation */\n"
-
-""
-""
-"    document.querySelectorAll('.nav-item').forEach(item => {\n"
-"      item.addEventListener('click', () => switchView(item.dataset.view));\n"
-"    });\n"
-""
-
-"    /* Toast */\n"
-"    /* Status */\n"
-"\n"
-"    /* Settings */"
-"    async function loadSettings() {"
-"      try {"
-"        const resp = await fetch('/api/config');"
-"        const data = await resp.json();"
-"        document.getElementById('provider').value = data.provider || 'anthropic';"
-"        document.getElementById('model').value = data.model || '';"
-"        document.getElementById('api_key').value = data.api_key || '';"
-"        document.getElementById('ollama_host').value = data.ollama_host || '';"
-"        document.getElementById('ollama_port').value = data.ollama_port || '11434';"
-"        document.getElementById('openai_api_audio').value = data.openai_api_audio || '';"
-"        document.getElementById('asr_endpoint').value = data.asr_endpoint || '';"
-"        document.getElementById('tts_endpoint').value = data.tts_endpoint || '';"
-"        document.getElementById('streaming').checked = data.streaming !== false;"
-"        updateOllamaFields();"
-"      } catch(e) { console.error(e); }"
-"    }"
-""
-"    document.getElementById('provider').addEventListener('change', updateOllamaFields);"
-"    function updateOllamaFields() {"
-"      const isOllama = document.getElementById('provider').value === 'ollama';"
-"      document.getElementById('ollamaFields').style.display = isOllama ? 'flex' : 'none';"
-"    }"
-""
-"    async function saveSettings() {"
-"      const config = {"
-"        provider: document.getElementById('provider').value,"
-"        model: document.getElementById('model').value,"
-"        api_key: document.getElementById('api_key').value,"
-"        ollama_host: document.getElementById('ollama_host').value,"
-"        ollama_port: document.getElementById('ollama_port').value,"
-"        openai_api_audio: document.getElementById('openai_api_audio').value,"
-"        asr_endpoint: document.getElementById('asr_endpoint').value,"
-"        tts_endpoint: document.getElementById('tts_endpoint').value,"
-"        streaming: document.getElementById('streaming').checked"
-"      };"
-"      try {"
-"        const resp = await fetch('/api/config', {"
-"          method: 'POST',"
-"          headers: {'Content-Type': 'application/json'},"
-"          body: JSON.stringify(config)"
-"        });"
-"        if (resp.ok) { showToast('配置已保存', 'success'); }"
-"        else { showToast('保存失败', 'error'); }"
-"      } catch(e) { showToast('保存失败: ' + e, 'error'); }"
-"    }"
-""
-"    async function reboot() {"
-"      if (!confirm('确定要重启设备吗？')) return;"
-"      try {"
-"        await fetch('/api/reboot', {method: 'POST'});"
-"        showToast('正在重启...', 'warning');"
-"      } catch(e) { showToast('重启失败', 'error'); }"
-"    }"
-""
-"    /* Update send button text */"
-"    function updateSendBtn() {"
-"      var btn = document.getElementById('sendBtn');"
-"      if (pending > 0) {"
-"        btn.textContent = '思考中(' + pending + ')';"
-"      } else {"
-"        btn.textContent = '发送';"
-"      }"
-"    }"
-""
-"    /* WebSocket & Chat */"
-"    function connectWS() {"
-"      const protocol = location.protocol === 'https:' ? 'wss:' : 'ws:';"
-"      const wsUrl = protocol + '//' + location.hostname + ':' + WS_PORT;"
-"      ws = new WebSocket(wsUrl);"
-""
-"      ws.onopen = function() {"
-"        connected = true;"
-"        document.getElementById('wsDot').classList.add('connected');"
-"        document.getElementById('wsText').textContent = '已连接';"
-"      };"
-""
-"      ws.onmessage = function(event) {"
-"        try {"
-"          const data = JSON.parse(event.data);"
-"          if (data.chat_id !== myChatId) return;"
-""
-"          if (data.type === 'token') {"
-"            if (!currentStreamDiv) {"
-"              currentStreamDiv = addChatMessage('assistant', '', true);"
-"            }"
-"            if(currentStreamDiv) {"
-"                const indicator = currentStreamDiv.querySelector('.typing-indicator');"
-"                if (indicator) {"
-"                    indicator.outerHTML = '<span class=\"content-span\"></span>';"
-"                }"
-"                const span = currentStreamDiv.querySelector('.content-span');"
-"                if (span) span.innerHTML += data.token.replace(/\\n/g, '<br>');"
-"                const container = document.getElementById('chatMessages');"
-"                container.scrollTop = container.scrollHeight;"
-"            }"
-"          } else if (data.type === 'status') {"
-"             /* Update thinking bubble with tool status text */"
-"             if (currentStreamDiv) {"
-"                 const indicator = currentStreamDiv.querySelector('.typing-indicator');"
-"                 if (indicator) {"
-"                     let statusText = indicator.querySelector('.status-text');"
-"                     if (!statusText) {"
-"                         statusText = document.createElement('span');"
-"                         statusText.className = 'status-text';"
-"                         statusText.style.fontSize = '12px';"
-"                         statusText.style.color = '#64748b';"
-"                         statusText.style.marginRight = '6px';"
-"                         indicator.insertBefore(statusText, indicator.firstChild);"
-"                     }"
-"                     statusText.textContent = data.content;"
-"                 }"
-"             }"
-"          } else if (data.type === 'done') {"
-"             if (currentStreamDiv) {"
-"                 const indicator = currentStreamDiv.querySelector('.typing-indicator');"
-"                 if (indicator) indicator.remove();"
-"                 currentStreamDiv = null;"
-"             }"
-"             if (pending > 0) pending--;"
-"             if (pendingTimer && pending === 0) { clearTimeout(pendingTimer); pendingTimer = null; }"
-"             updateSendBtn();"
-"          } else if (data.type === 'response') {"
-"            if (currentStreamDiv) {"
-"              currentStreamDiv.remove();"
-"              currentStreamDiv = null;"
-"            }"
-"            addChatMessage('assistant', data.content);"
-"            if (pending > 0) pending--;"
-"            if (pendingTimer && pending === 0) { clearTimeout(pendingTimer); pendingTimer = null; }"
-"            updateSendBtn();"
-"          }"
-"        } catch(e) {}"
-"      };"
-""
-"      ws.onclose = function() {"
-"        connected = false;"
-"        document.getElementById('wsDot').classList.remove('connected');"
-"        document.getElementById('wsText').textContent = '重连中...';"
-"        pending = 0; updateSendBtn();"
-"        setTimeout(connectWS, 3000);"
-"      };"
-""
-"      ws.onerror = function() {"
-"        document.getElementById('wsText').textContent = '连接错误';"
-"      };"
-"    }"
-""
-"    function addChatMessage(role, content, isStream) {"
-"      const div = document.createElement('div');"
-"      div.className = 'chat-message ' + role;"
-"      if (isStream) {"
-"        div.innerHTML = '<span class=\"content-span\">' + content.replace(/\\n/g, '<br>') + '</span>';"
-"      } else {"
-"        if (role === 'assistant' && typeof marked !== 'undefined') {"
-"           div.innerHTML = '<div class=\"markdown-body\">' + marked.parse(content) + '</div>';"
-"           div.querySelectorAll('pre code').forEach((block) => {"
-"               if (typeof hljs !== 'undefined') hljs.highlightElement(block);"
-"           });"
-"           div.querySelectorAll('pre').forEach((pre) => {"
-"               if (pre.querySelector('.copy-btn')) return;"
-"               const code = pre.querySelector('code');"
-"               if (!code) return;"
-"               const btn = document.createElement('button');"
-"               btn.className = 'copy-btn';"
-"               btn.textContent = 'Copy';"
-"               btn.onclick = () => copyToClipboard(code.innerText, btn);"
-"               pre.appendChild(btn);"
-"           });"
-"        } else {"
-"           div.innerHTML = content.replace(/\\n/g, '<br>');"
-"        }"
-"      }"
-"      div.innerHTML += '<div class=\"time\">' + new Date().toLocaleTimeString() + '</div>';"
-"      document.getElementById('chatMessages').appendChild(div);"
-"      document.getElementById('chatMessages').scrollTop = document.getElementById('chatMessages').scrollHeight;"
-"      return div;"
-"    }"
-""
-"    function copyToClipboard(text, btn) {"
-"        navigator.clipboard.writeText(text).then(() => {"
-"            const original = btn.textContent;"
-"            btn.textContent = 'Copied!';"
-"            setTimeout(() => btn.textContent = original, 2000);"
-"        });"
-"    }"
-""
-"    function sendChat() {"
-"      if (!connected) { showToast('未连接到设备', 'error'); return; }"
-"      const msg = document.getElementById('chatInput').value.trim();"
-"      if (!msg) return;"
-""
-"      addChatMessage('user', msg);"
-"      document.getElementById('chatInput').value = '';"
-"      pending++;"
-"      updateSendBtn();"
-"      "
-"      /* Show thinking animation immediately */"
-"      const thinkingHtml = '<div class=\"typing-indicator\"><div class=\"typing-dot\"></div><div class=\"typing-dot\"></div><div class=\"typing-dot\"></div></div>';"
-"      currentStreamDiv = addChatMessage('assistant', thinkingHtml, false);"
-""
-"      if (pendingTimer) clearTimeout(pendingTimer);"
-"      pendingTimer = setTimeout(function() { pending = 0; updateSendBtn(); addChatMessage('error', '响应超时，请重试'); }, 300000);"
-""
-"      const model = document.getElementById('modelSelect').value;"
-"      let payload = {type: 'message', content: msg, chat_id: myChatId};"
-"      if (model) { payload.model = model; }"
-"      ws.send(JSON.stringify(payload));"
-"    }"
-""
-"    function handleChatKey(e) {"
-"      if (e.key === 'Enter' && !e.shiftKey) {"
-"        e.preventDefault();"
-"        sendChat();"
-"      }"
-"    }"
-""
-"    /* Federation */"
-"    async function loadPeers() {"
-"      try {"
-"        const resp = await fetch('/api/federation/peers');"
-"        const data = await resp.json();"
-"        const list = document.getElementById('peerList');"
-"        if (!data.peers || data.peers.length === 0) {"
-"          list.innerHTML = '<div style=\"padding:10px;text-align:center\">暂无发现其他设备</div>';"
-"          return;"
-"        }"
-"        list.innerHTML = '';"
-"        data.peers.forEach(p => {"
-"          list.innerHTML += `<div style=\"padding:10px;border-bottom:1px solid #eee;display:flex;justify-content:space-between;align-items:center\">"
-"            <div>"
-"              <div style=\"font-weight:bold;font-size:14px\">${p.hostname}</div>"
-"              <div style=\"font-size:12px;color:#666\">${p.ip}:${p.port} <span style=\"background:#eee;padding:2px 4px;border-radius:4px\">Group: ${p.group||'default'}</span></div>"
-"            </div>"
-"            <div style=\"font-size:12px;color:#888\">${Math.floor(p.last_seen_ago)}s ago</div>"
-"          </div>`;"
-"        });"
-"      } catch(e) { console.error(e); }"
-"    }"
-""
-"    async function sendBroadcast() {"
-"      const cmd = document.getElementById('broadcastCmd').value;"
-"      const args = document.getElementById('broadcastArgs').value || '{}';"
-"      if (!cmd) return;"
-"      try {"
-"        await fetch('/api/federation/command', {"
-"          method: 'POST',"
-"          headers: {'Content-Type': 'application/json'},"
-"          body: JSON.stringify({ command: cmd, args: JSON.parse(args) })"
-"        });"
-"        showToast('广播命令已发送', 'success');"
-"      } catch(e) { showToast('发送失败', 'error'); }"
-"    }"
-""
-"    /* Agent */"
-"    async function loadAgent() {"
-"      try {"
-"        const resp = await fetch('/api/agent');"
-"        const data = await resp.json();"
-"        document.getElementById('agentSoul').value = data.soul || '';"
-"        document.getElementById('agentUser').value = data.user || '';"
-"        document.getElementById('agentMemory').value = data.memory || '';"
-"        document.getElementById('agentHeartbeat').value = data.heartbeat || '';"
-"      } catch(e) { console.error(e); }"
-"    }"
-""
-"    async function saveAgent() {"
-"      const body = {"
-"        soul: document.getElementById('agentSoul').value,"
-"        user: document.getElementById('agentUser').value,"
-"        memory: document.getElementById('agentMemory').value,"
-"        heartbeat: document.getElementById('agentHeartbeat').value"
-"      };"
-"      try {"
-"        const resp = await fetch('/api/agent', {"
-"          method: 'POST',"
-"          headers: {'Content-Type': 'application/json'},"
-"          body: JSON.stringify(body)"
-"        });"
-"        if (resp.ok) { showToast('Agent 配置已保存', 'success'); }"
-"        else { showToast('保存失败', 'error'); }"
-"      } catch(e) { showToast('保存失败: ' + e, 'error'); }"
-"    }"
-""
-"    /* Tools - Search Key */"
-"    async function loadSearchKey() {"
-"      try {"
-"        const resp = await fetch('/api/tools/search_key');"
-"        const data = await resp.json();"
-"        document.getElementById('searchKey').value = data.key || '';"
-"      } catch(e) { console.error(e); }"
-"    }"
-""
-"    async function saveSearchKey() {"
-"      const key = document.getElementById('searchKey').value.trim();"
-"      if (!key) { showToast('请输入 API Key', 'error'); return; }"
-"      try {"
-"        const resp = await fetch('/api/tools/search_key', {"
-"          method: 'POST',"
-"          headers: {'Content-Type': 'application/json'},"
-"          body: JSON.stringify({key: key})"
-"        });"
-"        if (resp.ok) { showToast('搜索 Key 已保存', 'success'); }"
-"        else { showToast('保存失败', 'error'); }"
-"      } catch(e) { showToast('保存失败: ' + e, 'error'); }"
-"    }"
-""
-"    /* Tools - Cron Jobs */\n"
-"    async function loadCronJobs() {\n"
-"      try {\n"
-"        const resp = await fetch('/api/tools/cron');\n"
-"        const data = await resp.json();\n"
-"        const el = document.getElementById('cronList');\n"
-"        if (!data.jobs || data.jobs.length === 0) {\n"
-"          el.innerHTML = '<div style=\"color:#888\">没有活动的定时任务</div>';\n"
-"          return;\n"
-"        }\n"
-"        let html = '';\n"
-"        data.jobs.forEach(function(j) {\n"
-"          var sched = j.kind === 'every' ? '每 ' + j.interval_s + ' 秒' : '在 ' + new Date(j.at_epoch * 1000).toLocaleString();\n"
-"          html += '<div style=\"display:flex;align-items:center;justify-content:space-between;padding:8px;margin:4px 0;background:#1a1a2e;border-radius:6px\">';\n"
-"          html += '<div><b>' + j.name + '</b><br><span style=\"font-size:11px;color:#888\">' + sched + ' | ' + (j.enabled ? '✅ 启用' : '❌ 禁用') + ' | ID: ' + j.id + '</span></div>';\n"
-"          html += '<button class=\"btn btn-sm btn-danger\" onclick=\\'deleteCronJob(\"' + j.id + '\")\\'>删除</button>';\n"
-"          html += '</div>';\n"
-"        });\n"
-"        el.innerHTML = html;\n"
-"      } catch(e) { document.getElementById('cronList').innerHTML = '加载失败'; }\n"
-"    }\n"
-""
-""
-"    /* MCP Manager */\n"
-"    async function loadMcpSources() {\n"
-"      try {\n"
-"        const resp = await fetch('/api/mcp/sources');\n"
-"        const data = await resp.json();\n"
-"        const el = document.getElementById('mcpSourceList');\n"
-"        if (!data.sources || data.sources.length === 0) {\n"
-"           el.innerHTML = '<div style=\"grid-column:1/-1;text-align:center;color:#888;padding:20px\">暂无 MCP 源</div>';\n"
-"           return;\n"
-"        }\n"
-"        let html = '';\n"
-"        data.sources.forEach(s => {\n"
-"           const statusColor = s.status === 'connected' ? 'var(--success)' : '#94a3b8';\n"
-"           const statusText = s.status === 'connected' ? '已连接' : '未连接';\n"
-"           html += `<div class='card'>`;\n"
-"           html += `  <div style='display:flex;justify-content:space-between;align-items:start;margin-bottom:8px'>`;\n"
-"           html += `    <div style='font-weight:600;font-size:15px'>${s.name}</div>`;\n"
-"           html += `    <div style='font-size:12px;padding:2px 8px;border-radius:12px;background:${statusColor}20;color:${statusColor}'>${statusText}</div>`;\n"
-"           html += `  </div>`;\n"
-"           html += `  <div style='font-size:12px;color:var(--text-secondary);margin-bottom:12px'>${s.url}</div>`;\n"
-"           html += `  <div style='display:flex;gap:8px'>`;\n"
-"           if (s.status !== 'connected') {\n"
-"               html += `<button class='btn btn-sm btn-primary' onclick='mcpAction(${s.id}, \"connect\")'>连接</button>`;\n"
-"           } else {\n"
-"               html += `<button class='btn btn-sm' onclick='mcpAction(${s.id}, \"disconnect\")'>断开</button>`;\n"
-"           }\n"
-"           // html += `<button class='btn btn-sm btn-danger' onclick='deleteMcpSource(${s.id})'>删除</button>`; /* TODO */\n"
-"           html += `  </div>`;\n"
-"           html += `</div>`;\n"
-"        });\n"
-"        el.innerHTML = html;\n"
-"      } catch(e) { document.getElementById('mcpSourceList').textContent = '加载失败: ' + e; }\n"
-"    }\n"
-""
-""
-"    async function mcpAction(id, action) {\n"
-"        try {\n"
-"            const resp = await fetch('/api/mcp/sources/action', {\n"
-"                method: 'POST',\n"
-"                headers: {'Content-Type': 'application/json'},\n"
-"                body: JSON.stringify({id: id, action: action})\n"
-"            });\n"
-"            if (resp.ok) { showToast('操作成功', 'success'); loadMcpSources(); }\n"
-"            else { showToast('操作失败', 'error'); }\n"
-"        } catch(e) { showToast('请求失败', 'error'); }\n"
-"    }\n"
-""
-""
-"    async function showAddMcpSourceModal() {\n"
-"        const name = prompt('Server Name:');\n"
-"        if (!name) return;\n"
-"        const url = prompt('WebSocket URL (ws://...):', 'ws://192.168.1.50:8080/mcp');\n"
-"        if (!url) return;\n"
-"        try {\n"
-"             const resp = await fetch('/api/mcp/sources/add', {\n"
-"                 method: 'POST',\n"
-"                 headers: {'Content-Type': 'application/json'},\n"
-"                 body: JSON.stringify({name: name, url: url, transport: 'websocket'})\n"
-"             });\n"
-"             if (resp.ok) { showToast('添加成功', 'success'); loadMcpSources(); }\n"
-"             else { showToast('添加失败', 'error'); }\n"
-"        } catch(e) { showToast('请求失败', 'error'); }\n"
-"    }\n"
-""
-""
-"    async function deleteCronJob(id) {\n"
-"      if (!confirm('确定删除任务 ' + id + ' 吗？')) return;\n"
-"      try {\n"
-"        const resp = await fetch('/api/tools/cron?id=' + id, { method: 'DELETE' });\n"
-"        if (resp.ok) { showToast('已删除', 'success'); loadCronJobs(); }\n"
-"        else { showToast('删除失败', 'error'); }\n"
-"      } catch(e) { showToast('删除失败: ' + e, 'error'); }\n"
-"    }\n"
-""
-"    async function loadHardwareStatus() {\n"
-"      try {\n"
-"        const resp = await fetch('/api/hardware/status');\n"
-"        const data = await resp.json();\n"
-"        let html = '<div style=\"display:grid;grid-template-columns:repeat(2,1fr);gap:8px;font-size:13px;\">';\n"
-"        html += '<div><span style=\"color:#666\">CPU:</span> ' + data.cpu_freq_mhz + ' MHz</div>';\n"
-"        html += '<div><span style=\"color:#666\">Temp:</span> ' + data.cpu_temp_c.toFixed(1) + ' °C</div>';\n"
-"        html += '<div><span style=\"color:#666\">Tasks:</span> ' + data.task_count + '</div>';\n"
-"        html += '<div><span style=\"color:#666\">Uptime:</span> ' + formatUptime(data.uptime_s) + '</div>';\n"
-"        html += '<div style=\"grid-column:span 2;margin-top:8px;padding-top:8px;border-top:1px solid #eee;\"><strong>内存:</strong></div>';\n"
-"        const intPct = data.total_heap_internal ? (data.total_heap_internal - data.free_heap_internal) / data.total_heap_internal * 100 : 0;\n"
-"        const psramPct = data.total_heap_psram ? (data.total_heap_psram - data.free_heap_psram) / data.total_heap_psram * 100 : 0;\n"
-"        html += '<div><span style=\"color:#666\">内部:</span> ' + (data.free_heap_internal/1024).toFixed(1) + ' KB / ' + (data.total_heap_internal/1024).toFixed(0) + ' KB (' + intPct.toFixed(0) + '% used)</div>';\n"
-"        html += '<div><span style=\"color:#666\">PSRAM:</span> ' + (data.free_heap_psram/1024).toFixed(0) + ' KB / ' + (data.total_heap_psram/1024).toFixed(0) + ' KB (' + psramPct.toFixed(0) + '% used)</div>';\n"
-"        html += '<div><span style=\"color:#666\">最大块:</span> ' + (data.largest_free_block/1024).toFixed(1) + ' KB</div>';\n"
-"        html += '<div><span style=\"color:#666\">最小空闲:</span> ' + (data.min_free_heap/1024).toFixed(1) + ' KB</div>';\n"
-"        html += '</div>';\n"
-"        document.getElementById('hw-status').innerHTML = html;\n"
-"        if(data.gpio) {\n"
-"           for (const [p, lvl] of Object.entries(data.gpio)) {\n"
-"               const bOn = document.getElementById('btn-gpio-' + p + '-on');\n"
-"               const bOff = document.getElementById('btn-gpio-' + p + '-off');\n"
-"               if(bOn && bOff) {\n"
-"                   bOn.style.opacity = lvl ? '1' : '0.3';\n"
-"                   bOff.style.opacity = !lvl ? '1' : '0.3';\n"
-"               }\n"
-"           }\n"
-"        }\n"
-"      } catch(e) { document.getElementById('hw-status').textContent = 'Error loading status'; }\n"
-"    }\n"
-""
-""
-"    function formatUptime(s) {\n"
-"      if (s < 60) return s + 's';\n"
-"      if (s < 3600) return Math.floor(s/60) + 'm ' + (s%60) + 's';\n"
-"      if (s < 86400) return Math.floor(s/3600) + 'h ' + Math.floor((s%3600)/60) + 'm';\n"
-"      return Math.floor(s/86400) + 'd ' + Math.floor((s%86400)/3600) + 'h';\n"
-"    }\n"
-""
-""
-"    async function scanI2C() {\n"
-"      const el = document.getElementById('i2c-result');\n"
-"      el.textContent = 'Scanning...';\n"
-"      try {\n"
-"        const resp = await fetch('/api/hardware/scan', {method:'POST'});\n"
-"        const data = await resp.json();\n"
-"        if(data.devices && data.devices.length > 0) {\n"
-"           const hex = data.devices.map(d => '0x' + d.toString(16).toUpperCase());\n"
-"           el.style.color='#1e293b'; el.style.fontWeight='600';\n"
-"           el.textContent = 'Found: ' + hex.join(', ');\n"
-"        } else {\n"
-"           el.textContent = 'No devices found.';\n"
-"        }\n"
-"      } catch(e) { el.textContent = 'Error: ' + e; }\n"
-"    }\n"
-""
-""
-"    async function toggleGPIO(pin, state) {\n"
-"      try {\n"
-"          const resp = await fetch('/api/hardware/gpio', {\n"
-"             method: 'POST',\n"
-"             headers: {'Content-Type': 'application/json'},\n"
-"             body: JSON.stringify({pin: pin, state: state})\n"
-"          });\n"
-"          const txt = await resp.text();\n"
-"          if(resp.ok && !txt.startsWith('Error')) {\n"
-"              showToast('GPIO ' + pin + (state?' ON':' OFF'), 'success');\n"
-"              // Immediate UI update, standard status fetch will confirm later\n"
-"              const bOn = document.getElementById('btn-gpio-' + pin + '-on');\n"
-"              const bOff = document.getElementById('btn-gpio-' + pin + '-off');\n"
-"              if(bOn && bOff) {\n"
-"                  bOn.style.opacity = state ? '1' : '0.3';\n"
-"                  bOff.style.opacity = !state ? '1' : '0.3';\n"
-"              }\n"
-"          } else {\n"
-"              showToast(txt, 'error');\n"
-"          }\n"
-"      } catch(e) { showToast('Error: ' + e, 'error'); }\n"
-"    }\n"
-""
-""
-"    /* Pin Configuration Functions */\n"
-"    async function loadPinConfig() {\n"
-"      try {\n"
-"        const resp = await fetch('/api/hardware/pins');\n"
-"        const data = await resp.json();\n"
-"        if (data.rgb_pin) document.getElementById('cfg_rgb_pin').value = data.rgb_pin;\n"
-"        if (data.i2c0_sda) document.getElementById('cfg_i2c0_sda').value = data.i2c0_sda;\n"
-"        if (data.i2c0_scl) document.getElementById('cfg_i2c0_scl').value = data.i2c0_scl;\n"
-"        if (data.i2s0_ws) document.getElementById('cfg_i2s0_ws').value = data.i2s0_ws;\n"
-"        if (data.i2s0_sck) document.getElementById('cfg_i2s0_sck').value = data.i2s0_sck;\n"
-"        if (data.i2s0_sd) document.getElementById('cfg_i2s0_sd').value = data.i2s0_sd;\n"
-"        if (data.i2s1_din) document.getElementById('cfg_i2s1_din').value = data.i2s1_din;\n"
-"        if (data.i2s1_bclk) document.getElementById('cfg_i2s1_bclk').value = data.i2s1_bclk;\n"
-"        if (data.i2s1_lrc) document.getElementById('cfg_i2s1_lrc').value = data.i2s1_lrc;\n"
-"        if (data.vol_down) document.getElementById('cfg_vol_down').value = data.vol_down;\n"
-"        if (data.vol_up) document.getElementById('cfg_vol_up').value = data.vol_up;\n"
-"      } catch(e) { console.log('Load pin config error:', e); }\n"
-"    }\n"
-""
-""
-"    async function savePinConfig() {\n"
-"      const cfg = {\n"
-"        rgb_pin: parseInt(document.getElementById('cfg_rgb_pin').value) || 38,\n"
-"        i2c0_sda: parseInt(document.getElementById('cfg_i2c0_sda').value) || 41,\n"
-"        i2c0_scl: parseInt(document.getElementById('cfg_i2c0_scl').value) || 42,\n"
-"        i2s0_ws: parseInt(document.getElementById('cfg_i2s0_ws').value) || 4,\n"
-"        i2s0_sck: parseInt(document.getElementById('cfg_i2s0_sck').value) || 5,\n"
-"        i2s0_sd: parseInt(document.getElementById('cfg_i2s0_sd').value) || 6,\n"
-"        i2s1_din: parseInt(document.getElementById('cfg_i2s1_din').value) || 7,\n"
-"        i2s1_bclk: parseInt(document.getElementById('cfg_i2s1_bclk').value) || 15,\n"
-"        i2s1_lrc: parseInt(document.getElementById('cfg_i2s1_lrc').value) || 16,\n"
-"        vol_down: parseInt(document.getElementById('cfg_vol_down').value) || 39,\n"
-"        vol_up: parseInt(document.getElementById('cfg_vol_up').value) || 40\n"
-"      };\n"
-"      try {\n"
-"        const resp = await fetch('/api/hardware/pins', {\n"
-"          method: 'POST',\n"
-"          headers: {'Content-Type': 'application/json'},\n"
-"          body: JSON.stringify(cfg)\n"
-"        });\n"
-"        const data = await resp.json();\n"
-"        const st = document.getElementById('pin-config-status');\n"
-"        if (data.success) {\n"
-"          st.textContent = '配置已保存，需要重启生效';\n"
-"          st.style.color = 'var(--success)';\n"
-"          showToast('引脚配置已保存', 'success');\n"
-"        } else {\n"
-"          st.textContent = '保存失败';\n"
-"          st.style.color = 'var(--error)';\n"
-"        }\n"
-"      } catch(e) {\n"
-"        document.getElementById('pin-config-status').textContent = '保存失败: ' + e.message;\n"
-"      }\n"
-"    }\n"
-""
-""
-"    function initGPIO() {\n"
-"      // Safe pins per backend logic (2,4,5,12-18,21,38)\n"
-"      const safe = [2, 4, 5, 12, 13, 14, 15, 16, 17, 18, 21, 38];\n"
-"      \n"
-"      // Standard ESP32-S3 DevKitC Layout Approximation\n"
-"      // Left Header: 3V3, EN, 4, 5, 6, 7, 15, 16, 17, 18, 8, 19, 20, 3, 46, 9, 10, 11, 12, 13, 14\n"
-"      const left = [\n"
-"          {l:'3V3'}, {l:'EN'}, {p:4}, {p:5}, {p:6}, {p:7}, {p:15}, {p:16}, {p:17}, {p:18}, {p:8}, {p:19}, {p:20}, {p:3}, {p:46}, {p:9}, {p:10}, {p:11}, {p:12}, {p:13}, {p:14}\n"
-"      ];\n"
-"      // Right Header: 5V, GND, 0, 1, 2, 42, 41, 40, 39, 38, 37, 36, 35, 45, 48, 47, 21\n"
-"      const right = [\n"
-"          {l:'5V'}, {l:'GND'}, {p:0}, {p:1}, {p:2}, {p:42}, {p:41}, {p:40}, {p:39}, {p:38}, {p:37}, {p:36}, {p:35}, {p:45}, {p:48}, {p:47}, {p:21}\n"
-"      ];\n"
-""
-""
-"      const renderPin = (item) => {\n"
-"          if (item.p === undefined) return `<div class=\"pin-card label-only\"><span class=\"pin-lbl\">${item.l}</span></div>`;\n"
-"          const isSafe = safe.includes(item.p);\n"
-"          let h = `<div class=\"pin-card ${!isSafe?'restricted':''}\" data-pin=\"${item.p}\">`;\n"
-"          h += `<span class=\"pin-lbl\">G${item.p}</span>`;\n"
-"          if (isSafe) {\n"
-"             h += `<div class=\"btn-group-v\">`;\n"
-"             h += `<button id=\"btn-gpio-${item.p}-on\" onclick=\"toggleGPIO(${item.p}, true)\" class=\"btn btn-xs btn-outline-secondary\" style=\"opacity:0.3\">ON</button>`;\n"
-"             h += `<button id=\"btn-gpio-${item.p}-off\" onclick=\"toggleGPIO(${item.p}, false)\" class=\"btn btn-xs btn-outline-secondary\" style=\"margin-top:2px;opacity:0.3\">OFF</button>`;\n"
-"             h += `</div>`;\n"
-"          } else {\n"
-"             h += `<span class=\"badge-warn\">RSTR</span>`;\n"
-"          }\n"
-"          h += `</div>`;\n"
-"          return h;\n"
-"      };\n"
-""
-""
-"      let html = '<div class=\"board-layout\">';\n"
-"      html += '<div class=\"board-row\"><h4>Left Header</h4>';\n"
-"      left.forEach(i => html += renderPin(i));\n"
-"      html += '</div><div class=\"board-row\"><h4>Right Header</h4>';\n"
-"      right.forEach(i => html += renderPin(i));\n"
-"      html += '</div></div>';\n"
-"      \n"
-"      document.getElementById('gpio-grid').innerHTML = html;\n"
-"    }\n"
-""
-""
-"    /* Init */\n"
-""
-""
-"    /* ── SkillHub Functions ── */\n"
-"    let allSkills = [];\n"
-"    let installedSkills = new Set();\n"
-"    let currentSkillTab = 'all';\n"
-"    const MAX_SLOTS = 16;\n"
-""
-""
-"    function normalizeSkillState(state) {\n"
-"      if (typeof state === 'string') return state;\n"
-"      switch (state) {\n"
-"        case 0: return 'INSTALLED';\n"
-"        case 1: return 'LOADED';\n"
-"        case 2: return 'READY';\n"
-"        case 3: return 'ERROR';\n"
-"        case 4: return 'DISABLED';\n"
-"        case 5: return 'UNINSTALLED';\n"
-"        default: return 'UNKNOWN';\n"
-"      }\n"
-"    }\n"
-""
-""
-"    async function loadSkills() {\n"
-"      try {\n"
-"        const resp = await fetch('/api/skills');\n"
-"        const data = await resp.json();\n"
-"        allSkills = data.skills || [];\n"
-"        /* /api/skills returns currently installed skills in runtime. */\n"
-"        installedSkills = new Set(allSkills.map(s => s.name));\n"
-"        renderSkills(allSkills);\n"
-"        updateSlotInfo();\n"
-"      } catch(e) {\n"
-"        document.getElementById('skillsList').innerHTML = '<div style=\"text-align:center;color:var(--error);padding:40px;\">加载失败: ' + e.message + '</div>';\n"
-"      }\n"
-"    }\n"
-""
-""
-"    function switchSkillTab(tab) {\n"
-"      currentSkillTab = tab;\n"
-"      document.querySelectorAll('[id^=\"tab-\"]').forEach(btn => btn.classList.remove('btn-primary'));\n"
-"      document.getElementById('tab-' + tab).classList.add('btn-primary');\n"
-"      renderSkills(allSkills);\n"
-"    }\n"
-""
-""
-"    function renderSkills(skills) {\n"
-"      const container = document.getElementById('skillsList');\n"
-"      const searchTerm = document.getElementById('skillSearch').value.toLowerCase();\n"
-""
-""
-"      // Filter by category and search term\n"
-"      const filtered = skills.filter(s => {\n"
-"        const term = searchTerm.toLowerCase();\n"
-"        const matchesSearch = !term || (s.name && s.name.toLowerCase().includes(term)) ||\n"
-"               (s.description && s.description.toLowerCase().includes(term)) ||\n"
-"               (s.bus && s.bus.toLowerCase().includes(term));\n"
-""
-""
-"        // Category filter\n"
-"        if (currentSkillTab === 'all' || currentSkillTab === 'installed_view') return matchesSearch;\n"
-"        const category = (s.category || 'UNKNOWN').toUpperCase();\n"
-"        if (currentSkillTab === 'hardware') return matchesSearch && (category === 'SENSOR' || category === 'ACTUATOR');\n"
-"        if (currentSkillTab === 'software') return matchesSearch && (category === 'PROTOCOL' || category === 'UTILITY' || category === 'SYSTEM');\n"
-"        return matchesSearch;\n"
-"      });\n"
-""
-""
-"      if (filtered.length === 0) {\n"
-"        container.innerHTML = '<div style=\"text-align:center;color:var(--text-secondary);padding:40px;\">暂无技能</div>';\n"
-"        return;\n"
-"      }\n"
-""
-""
-"      let html = '';\n"
-"      filtered.forEach(skill => {\n"
-"        const isInstalled = installedSkills.has(skill.name);\n"
-"        const version = skill.version || '1.0';\n"
-"        const author = skill.author || '@unknown';\n"
-"        const rating = (skill.rating || 4.5).toFixed(1);\n"
-"        const category = skill.category || 'UNKNOWN';\n"
-"        const type = skill.type || 'TOOL';\n"
-"        const bus = skill.bus || 'NONE';\n"
-"        const catBg = category === 'SENSOR' ? '#dbeafe' : (category === 'ACTUATOR' ? '#ffedd5' : '#f1f5f9');\n"
-"        const catText = category === 'SENSOR' ? '#1e40af' : (category === 'ACTUATOR' ? '#9a3412' : '#475569');\n"
-""
-""
-"        html += `<div class='card' style='margin-bottom:12px;'>`;\n"
-"        html += `  <div style='display:flex;justify-content:space-between;align-items:flex-start;'>`;\n"
-"        html += `    <div style='flex:1'>`;\n"
-"        html += `      <div style='display:flex;align-items:center;gap:8px;margin-bottom:6px;flex-wrap:wrap'>`;\n"
-"        html += `        <span style='font-weight:600;font-size:16px;'>${escapeHtml(skill.name)}</span>`;\n"
-"        html += `        <span style='background:var(--bg);padding:2px 8px;border-radius:4px;font-size:12px;color:var(--text-secondary);'>v${escapeHtml(version)}</span>`;\n"
-"        html += `        <span style='background:${catBg};color:${catText};padding:2px 8px;border-radius:12px;font-size:11px;font-weight:600'>${category}</span>`;\n"
-"        html += `        <span style='border:1px solid var(--border);padding:1px 6px;border-radius:4px;font-size:11px;color:var(--text-secondary);'>${type}</span>`;\n"
-"        if (bus !== 'NONE') html += `        <span style='background:#f3f4f6;color:#374151;padding:2px 6px;border-radius:4px;font-size:11px;font-family:monospace'>${bus}</span>`;\n"
-"        html += `      </div>`;\n"
-"        html += `      <div style='font-size:13px;color:var(--text-secondary);margin-bottom:8px;'>`;\n"
-"        html += `        Author: ${escapeHtml(author)}`;\n"
-"        html += `      </div>`;\n"
-"        if (skill.description) {\n"
-"            html += `      <div style='font-size:13px;color:var(--text);line-height:1.4'>${escapeHtml(skill.description)}</div>`;\n"
-"        }\n"
-"        html += `    </div>`;\n"
-"        html += `    <div style='display:flex;gap:8px;margin-left:12px'>`;\n"
-"        if (currentSkillTab === 'installed_view') {\n"
-"             html += `      <button class='btn btn-sm btn-danger' onclick='uninstallSkill(\"${escapeHtml(skill.name)}\")'>卸载</button>`;\n"
-"        } else {\n"
-"             if (isInstalled) {\n"
-"                html += `      <button class='btn btn-sm' style='background:var(--success);color:white;opacity:0.8' disabled>已安装</button>`;\n"
-"             } else {\n"
-"                html += `      <button class='btn btn-sm btn-primary' onclick='installSkill(\"${escapeHtml(skill.name)}\", \"${escapeHtml(skill.url || '')}\")'>安装</button>`;\n"
-"             }\n"
-"             html += `      <button class='btn btn-sm' onclick='showSkillDetails(\"${escapeHtml(skill.name)}\")'>详情</button>`;\n"
-"        }\n"
-"        html += `    </div>`;\n"
-"        html += `  </div>`;\n"
-"        html += `</div>`;\n"
-"      });\n"
-"      container.innerHTML = html;\n"
-"    }\n"
-""
-""
-"    function filterSkills() {\n"
-"      renderSkills(allSkills);\n"
-"    }\n"
-""
-""
-"    function updateSlotInfo() {\n"
-"      const count = installedSkills.size;\n"
-"      document.getElementById('slotInfo').textContent = `已安装: ${count}/${MAX_SLOTS} 卡槽`;\n"
-"    }\n"
-""
-""
-"    async function installSkill(name, url) {\n"
-"      if (!url) {\n"
-"        showToast('该技能暂无可用安装源', 'warning');\n"
-"        return;\n"
-"      }\n"
-"      try {\n"
-"        showToast('正在安装 ' + name + '...', 'success');\n"
-"        const resp = await fetch('/api/skills/install', {\n"
-"          method: 'POST',\n"
-"          headers: {'Content-Type': 'application/json'},\n"
-"          body: JSON.stringify({url: url, checksum: ''})\n"
-"        });\n"
-"        const data = await resp.json();\n"
-"        if (data.success) {\n"
-"          showToast(name + ' 安装成功!', 'success');\n"
-"          await loadSkills();\n"
-"        } else {\n"
-"          showToast('安装失败: ' + (data.error || '未知错误'), 'error');\n"
-"        }\n"
-"      } catch(e) {\n"
-"        showToast('安装请求失败: ' + e.message, 'error');\n"
-"      }\n"
-"    }\n"
-""
-""
-"    async function uninstallSkill(name) {\n"
-"      if (!confirm('确定要卸载 ' + name + ' 吗?')) return;\n"
-"      try {\n"
-"        const resp = await fetch('/api/skills?name=' + encodeURIComponent(name), {\n"
-"          method: 'DELETE'\n"
-"        });\n"
-"        const data = await resp.json();\n"
-"        if (data.success || resp.ok) {\n"
-"          showToast(name + ' 已卸载', 'success');\n"
-"          await loadSkills();\n"
-"        } else {\n"
-"          showToast('卸载失败: ' + (data.error || '未知错误'), 'error');\n"
-"        }\n"
-"      } catch(e) {\n"
-"        showToast('卸载请求失败: ' + e.message, 'error');\n"
-"      }\n"
-"    }\n"
-""
-""
-"    async function reloadSkills() {\n"
-"      if (!confirm('确定要重载技能引擎吗?')) return;\n"
-"      try {\n"
-"        const resp = await fetch('/api/skills/reload', { method: 'POST' });\n"
-"        if (resp.ok) {\n"
-"          showToast('技能引擎已重载', 'success');\n"
-"          await loadSkills();\n"
-"        } else {\n"
-"          showToast('重载失败', 'error');\n"
-"        }\n"
-"      } catch(e) {\n"
-"        showToast('重载请求失败: ' + e.message, 'error');\n"
-"      }\n"
-"    }\n"
-""
-""
-"    function showSkillDetails(name) {\n"
-"      const skill = allSkills.find(s => s.name === name);\n"
-"      if (!skill) return;\n"
-"      let details = '名称: ' + skill.name + '\\n';\n"
-"      details += '版本: ' + (skill.version || '未知') + '\\n';\n"
-"      details += '作者: ' + (skill.author || '未知') + '\\n';\n"
-"      details += '描述: ' + (skill.description || '无');\n"
-"      alert(details);\n"
-"    }\n"
-""
-""
-"    function escapeHtml(str) {\n"
-"      if (!str) return '';\n"
-"      return str.replace(/&/g, '&amp;').replace(/</g, '&lt;').replace(/>/g, '&gt;').replace(/\"/g, '&quot;');\n"
-"    }\n"
-""
-""
-"    /* Installed Skills Management */\n"
-"    async function loadInstalledSkills() {\n"
-"      try {\n"
-"        const resp = await fetch('/api/skills');\n"
-"        const data = await resp.json();\n"
-"        const installed = data.skills || [];\n"
-"        renderInstalledSkills(installed);\n"
-"      } catch(e) {\n"
-"        document.getElementById('installedList').innerHTML = '<div style=\"text-align:center;color:var(--error);padding:20px;\">加载失败: ' + e.message + '</div>';\n"
-"      }\n"
-"    }\n"
-""
-""
-"    function renderInstalledSkills(skills) {\n"
-"      const container = document.getElementById('installedList');\n"
-"      if (skills.length === 0) {\n"
-"        container.innerHTML = '<div style=\"text-align:center;color:var(--text-secondary);padding:20px;\">暂无已安装技能</div>';\n"
-"        return;\n"
-"      }\n"
-""
-""
-"      let html = '';\n"
-"      skills.forEach(skill => {\n"
-"        const version = skill.version || '1.0';\n"
-"        const author = skill.author || '@unknown';\n"
-"        const state = normalizeSkillState(skill.state);\n"
-"        const stateColor = state === 'READY' ? 'var(--success)' : (state === 'ERROR' ? 'var(--error)' : 'var(--warning)');\n"
-"        const stateText = state === 'READY' ? '运行中' : (state === 'ERROR' ? '异常' : '已停止');\n"
-"        const category = skill.category || 'UNKNOWN';\n"
-"        const type = skill.type || 'TOOL';\n"
-"        const bus = skill.bus || 'NONE';\n"
-"        const busType = bus !== 'NONE' ? bus : '-';\n"
-"        const categoryIcon = category === 'SENSOR' ? '🔌' : '💻';\n"
-""
-""
-"        html += `<div class='card' style='margin-bottom:12px;'>`;\n"
-"        html += `  <div style='display:flex;justify-content:space-between;align-items:center;'>`;\n"
-"        html += `    <div style='display:flex;align-items:center;gap:12px;'>`;\n"
-"        html += `      <span style='font-size:24px;'>${categoryIcon}</span>`;\n"
-"        html += `      <div>`;\n"
-"        html += `        <div style='font-weight:600;font-size:15px;'>${escapeHtml(skill.name)} <span style='color:var(--text-secondary);font-weight:normal;'>v${escapeHtml(version)}</span>`;\n"
-"        html += `          <span style='border:1px solid var(--border);padding:0px 4px;border-radius:3px;font-size:10px;margin-left:6px'>${type}</span>`;\n"
-"        html += `        </div>`;\n"
-"        html += `        <div style='font-size:12px;color:var(--text-secondary);'>Author: ${escapeHtml(author)} | Bus: ${busType} | ${category}</div>`;\n"
-"        html += `      </div>`;\n"
-"        html += `    </div>`;\n"
-"        html += `    <div style='display:flex;align-items:center;gap:12px;'>`;\n"
-"        html += `      <span style='padding:4px 8px;border-radius:4px;font-size:12px;background: ${stateColor}20; color: ${stateColor};'>${stateText}</span>`;\n"
-"        html += `      <button class='btn btn-sm btn-danger' onclick='uninstallSkill(\"${escapeHtml(skill.name)}\")'>卸载</button>`;\n"
-"        html += `    </div>`;\n"
-"        html += `  </div>`;\n"
-"        if (skill.description) {\n"
-"        html += `  <div style='margin-top:8px;font-size:13px;color:var(--text-secondary);'>${escapeHtml(skill.description)}</div>`;\n"
-"        }\n"
-"        html += `</div>`;\n"
-"      });\n"
-"      container.innerHTML = html;\n"
-"    }\n"
-""
-
-"    /* Load skills when skillhub view is shown */\n"
-"    /* Unified SkillHub Tabs */\n"
-"    function switchHubTab(tab) {\n"
-"        // Toggle Buttons\n"
-"        ['market', 'installed', 'sources', 'fleet'].forEach(t => {\n"
-"            const btn = document.getElementById('hub-btn-' + t);\n"
-"            if (btn) btn.className = (t === tab) ? 'btn btn-sm btn-primary' : 'btn btn-sm';\n"
-""
-""
-"            const content = document.getElementById('hub-content-' + t);\n"
-"            if (content) content.style.display = (t === tab) ? 'block' : 'none';\n"
-"        });\n"
-"\n"
-"\n"
-"        /* Load Data */\n"
-"        if (tab === 'market') {\n"
-"             loadSkills();\n"
-"        } else if (tab === 'installed') {\n"
-"             loadInstalledSkills();\n"
-"        } else if (tab === 'sources') {\n"
-"             loadMcpSources();\n"
-"        }\n"
-"    }\n"
-""
-""
-"    // Override switchView to default to SkillHub->Market\n"
-"    const originalSwitchView = switchView;\n"
-"    switchView = function(view) {\n"
-"      if(typeof originalSwitchView === 'function') originalSwitchView(view);\n"
-"      if (view === 'skillhub') {\n"
-"        switchHubTab('market');\n"
-"      }\n"
-"    };\n"
-""
-""
-""
-"    initGPIO();\n"
-"    setInterval(loadHardwareStatus, 2000);\n"
-"    loadHardwareStatus();\n"
-"    refreshStatus();\n"
-"    loadSettings();\n"
-"    loadAgent();\n"
-"    loadSearchKey();\n"
-"    loadCronJobs();\n"
-"    loadPinConfig();\n"
-"    connectWS();\n"
-"    window.onload = function() { checkSafeMode(); refreshStatus(); };\n""  </script>\n"
-"</body>"
-"</html>";
+/* The page itself is asset_data/www/index.html in the asset store. This
+ * stands in when the "assets" partition (CONFIG_MIMI_ASSETS_PARTITION)
+ * has not been flashed. */
+static const char FALLBACK_PAGE[] =
+    "<!DOCTYPE html><html><head><meta charset='utf-8'><title>Esp32Claw</title></head>"
+    "<body style='font-family:sans-serif'><h2>Esp32Claw</h2>"
+    "<p>The web UI is not installed. Flash the asset partition with <code>idf.py flash</code>.</p>"
+    "<p>The JSON API under <code>/api/</code> is available.</p></body></html>";
 
 /* ── HTTP Handlers ─────────────────────────────────────────────── */
 
+/* Serve an asset zero-copy from flash, gzip'd as stored.
+ * A matching If-None-Match gets 304 with no body.
+ * @return ESP_ERR_NOT_FOUND, with nothing sent, if the asset is missing */
+static esp_err_t send_asset(httpd_req_t *req, const char *name, const char *type)
+{
+    asset_t asset;
+    if (!asset_store_find(name, &asset)) return ESP_ERR_NOT_FOUND;
+
+    char etag[12];
+    snprintf(etag, sizeof(etag), "\"%08" PRIx32 "\"", asset.etag);
+
+    char hdr[64];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", hdr, sizeof(hdr)) == ESP_OK &&
+        strstr(hdr, etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_set_hdr(req, "ETag", etag);
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    httpd_resp_set_type(req, type);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    if (!asset.gzip) {
+        return httpd_resp_send(req, (const char *)asset.data, asset.size);
+    }
+
+    /* Every browser takes gzip; inflate only for clients that do not */
+    bool accepts_gzip = true;
+    size_t ae_len = httpd_req_get_hdr_value_len(req, "Accept-Encoding");
+    if (ae_len < sizeof(hdr) &&
+        httpd_req_get_hdr_value_str(req, "Accept-Encoding", hdr, sizeof(hdr)) == ESP_OK) {
+        accepts_gzip = strstr(hdr, "gzip") != NULL;
+    } else if (ae_len == 0) {
+        accepts_gzip = false;
+    }
+    if (accepts_gzip) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        return httpd_resp_send(req, (const char *)asset.data, asset.size);
+    }
+
+    char *text = asset_store_read_text(name);
+    if (!text) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Asset unavailable");
+        return ESP_FAIL;
+    }
+    esp_err_t err = httpd_resp_send(req, text, asset.raw_size);
+    free(text);
+    return err;
+}
+
 static esp_err_t index_handler(httpd_req_t *req)
 {
+    esp_err_t err = send_asset(req, "www/index.html", "text/html; charset=utf-8");
+    if (err != ESP_ERR_NOT_FOUND) return err;
+
     httpd_resp_set_type(req, "text/html; charset=utf-8");
-    /* Send large HTML page in chunks */
-    const char *ptr = HTML_PAGE;
-    size_t len = strlen(HTML_PAGE);
-    size_t chunk_size = 4096;
-    size_t sent = 0;
-
-    while (sent < len) {
-        size_t chunk = (len - sent > chunk_size) ? chunk_size : (len - sent);
-        if (httpd_resp_send_chunk(req, ptr + sent, chunk) != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to send HTML chunk");
-            return ESP_FAIL;
-        }
-        sent += chunk;
-    }
-    httpd_resp_send_chunk(req, NULL, 0);
-    return ESP_OK;
+    return httpd_resp_send(req, FALLBACK_PAGE, sizeof(FALLBACK_PAGE) - 1);
 }
 
 static esp_err_t status_handler(httpd_req_t *req)
@@ -1714,6 +247,7 @@ static void write_spiffs_file(const char *path, const char *data, size_t len)
     if (!f) { ESP_LOGE(TAG, "Cannot write %s", path); return; }
     fwrite(data, 1, len, f);
     fclose(f);
+    memory_note_write(path);
 }
 
 /* JSON-escape a string into buf, return bytes written */
@@ -2551,6 +1085,19 @@ static esp_err_t system_health_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+static esp_err_t storage_handler(httpd_req_t *req)
+{
+    char *json = storage_get_usage_json();
+    if (json) {
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_send(req, json, strlen(json));
+        free(json);
+    } else {
+        httpd_resp_send_500(req);
+    }
+    return ESP_OK;
+}
+
 /* ── Server Init ───────────────────────────────────────────────── */
 
 esp_err_t web_ui_init(void)
@@ -2596,6 +1143,13 @@ esp_err_t web_ui_init(void)
     };
     httpd_register_uri_handler(s_http_server, &api_system_health);
 
+    httpd_uri_t api_storage = {
+        .uri = "/api/storage",
+        .method = HTTP_GET,
+        .handler = storage_handler,
+    };
+    httpd_register_uri_handler(s_http_server, &api_storage);
+
     httpd_uri_t api_config_get_uri = {
         .uri = "/api/config",
         .method = HTTP_GET,
@@ -0,0 +1,265 @@
+/* Implementation of fake_flash.h and the esp_spiffs/esp_littlefs stubs */
+#include "fake_flash.h"
+#include "host_fs.h"
+#include "esp_spiffs.h"
+#include "esp_littlefs.h"
+
+#undef fopen
+#undef opendir
+#undef readdir
+#undef closedir
+#undef remove
+#undef stat
+
+#include <ftw.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PARTITION_SIZE  (2 * 1024 * 1024)
+#define UNMOUNTED_ROOT  "/nonexistent/mimi_flash"
+
+int fake_flash_formats;
+size_t fake_flash_reserve = 1024 * 1024;
+
+static char s_part[256];
+static fake_flash_fs_t s_format = FAKE_FLASH_BLANK;
+static fake_flash_fs_t s_mounted = FAKE_FLASH_BLANK;
+
+static void erase(void);
+
+/* The partition lives in RAM; do not leave it behind */
+static void part_remove(void)
+{
+    erase();
+    rmdir(s_part);
+}
+
+static void part_init(void)
+{
+    if (s_part[0]) return;
+    const char *dirs[] = {"/dev/shm", "/tmp"};
+    for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+        snprintf(s_part, sizeof(s_part), "%s/mimi_flash.XXXXXX", dirs[i]);
+        if (mkdtemp(s_part)) break;
+        s_part[0] = '\0';
+    }
+    if (!s_part[0]) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    atexit(part_remove);
+    host_fs_root(UNMOUNTED_ROOT);
+}
+
+/* ── Walking the partition ────────────────────────────────────── */
+
+static char **s_walk_names;
+static int s_walk_count;
+static size_t s_walk_bytes;
+
+static int erase_entry(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    (void)st; (void)type;
+    if (ftw->level > 0) remove(path);
+    return 0;
+}
+
+static int list_entry(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    (void)ftw;
+    if (type != FTW_F) return 0;
+    s_walk_bytes += st->st_size;
+    if (s_walk_names) {
+        s_walk_names = realloc(s_walk_names, (s_walk_count + 2) * sizeof(char *));
+        s_walk_names[s_walk_count++] = strdup(path + strlen(s_part) + 1);
+    }
+    return 0;
+}
+
+static void erase(void)
+{
+    nftw(s_part, erase_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+/* ── Mounting ─────────────────────────────────────────────────── */
+
+fake_flash_fs_t fake_flash_format(void) { return s_format; }
+fake_flash_fs_t fake_flash_mounted(void) { return s_mounted; }
+
+static void format(fake_flash_fs_t fs)
+{
+    erase();
+    s_format = fs;
+    fake_flash_formats++;
+}
+
+static esp_err_t mount(fake_flash_fs_t fs, bool format_if_mount_failed)
+{
+    part_init();
+    if (s_mounted != FAKE_FLASH_BLANK) return ESP_ERR_INVALID_STATE;
+    if (s_format != fs) {
+        if (!format_if_mount_failed) return ESP_FAIL;
+        format(fs);
+    }
+    s_mounted = fs;
+    host_fs_root(s_part);
+    return ESP_OK;
+}
+
+static esp_err_t unmount(fake_flash_fs_t fs)
+{
+    if (s_mounted != fs) return ESP_ERR_INVALID_STATE;
+    s_mounted = FAKE_FLASH_BLANK;
+    host_fs_root(UNMOUNTED_ROOT);
+    return ESP_OK;
+}
+
+void fake_flash_unmount(void)
+{
+    if (s_mounted != FAKE_FLASH_BLANK) unmount(s_mounted);
+}
+
+void fake_flash_reset(fake_flash_fs_t fs)
+{
+    part_init();
+    fake_flash_unmount();
+    format(fs);
+    if (fs != FAKE_FLASH_BLANK) mount(fs, false);
+}
+
+static esp_err_t info(fake_flash_fs_t fs, size_t *total, size_t *used)
+{
+    if (s_mounted != fs) return ESP_ERR_INVALID_STATE;
+    s_walk_bytes = 0;
+    nftw(s_part, list_entry, 16, FTW_PHYS);
+    if (total) *total = PARTITION_SIZE;
+    if (used) *used = s_walk_bytes;
+    return ESP_OK;
+}
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t *conf)
+{
+    return mount(FAKE_FLASH_SPIFFS, conf->format_if_mount_failed);
+}
+
+esp_err_t esp_vfs_spiffs_unregister(const char *partition_label)
+{
+    (void)partition_label;
+    return unmount(FAKE_FLASH_SPIFFS);
+}
+
+esp_err_t esp_spiffs_info(const char *partition_label, size_t *total, size_t *used)
+{
+    (void)partition_label;
+    return info(FAKE_FLASH_SPIFFS, total, used);
+}
+
+esp_err_t esp_spiffs_gc(const char *partition_label, size_t size_to_gc)
+{
+    (void)partition_label; (void)size_to_gc;
+    return s_mounted == FAKE_FLASH_SPIFFS ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_vfs_littlefs_register(const esp_vfs_littlefs_conf_t *conf)
+{
+    return mount(FAKE_FLASH_LITTLEFS, conf->format_if_mount_failed);
+}
+
+esp_err_t esp_vfs_littlefs_unregister(const char *partition_label)
+{
+    (void)partition_label;
+    return unmount(FAKE_FLASH_LITTLEFS);
+}
+
+esp_err_t esp_littlefs_format(const char *partition_label)
+{
+    (void)partition_label;
+    part_init();
+    if (s_mounted != FAKE_FLASH_BLANK) return ESP_ERR_INVALID_STATE;
+    format(FAKE_FLASH_LITTLEFS);
+    return ESP_OK;
+}
+
+esp_err_t esp_littlefs_info(const char *partition_label, size_t *total, size_t *used)
+{
+    (void)partition_label;
+    return info(FAKE_FLASH_LITTLEFS, total, used);
+}
+
+/* ── SPIFFS namespace ─────────────────────────────────────────── */
+
+static bool is_spiffs_root(const char *path)
+{
+    return s_mounted == FAKE_FLASH_SPIFFS &&
+           (strcmp(path, "/spiffs") == 0 || strcmp(path, "/spiffs/") == 0);
+}
+
+/* SPIFFS has no directories to create first */
+FILE *fake_flash_fopen(const char *path, const char *mode)
+{
+    if (s_mounted == FAKE_FLASH_SPIFFS && strpbrk(mode, "wa")) {
+        char host[512];
+        host_fs_path(path, host, sizeof(host));
+        for (char *p = host + strlen(s_part) + 1; *p; p++) {
+            if (*p != '/') continue;
+            *p = '\0';
+            mkdir(host, 0755);
+            *p = '/';
+        }
+    }
+    return host_fopen(path, mode);
+}
+
+typedef struct {
+    DIR *real;              /* NULL for a flat SPIFFS listing */
+    char **names;
+    int count;
+    int next;
+    struct dirent ent;
+} fake_dir_t;
+
+DIR *fake_flash_opendir(const char *path)
+{
+    fake_dir_t *d = calloc(1, sizeof(*d));
+    if (is_spiffs_root(path)) {
+        s_walk_names = calloc(1, sizeof(char *));
+        s_walk_count = 0;
+        nftw(s_part, list_entry, 16, FTW_PHYS);
+        d->names = s_walk_names;
+        d->count = s_walk_count;
+        s_walk_names = NULL;
+    } else if (s_mounted == FAKE_FLASH_SPIFFS) {
+        /* Only the root exists */
+        free(d);
+        return NULL;
+    } else {
+        d->real = host_opendir(path);
+        if (!d->real) {
+            free(d);
+            return NULL;
+        }
+    }
+    return (DIR *)d;
+}
+
+struct dirent *fake_flash_readdir(DIR *dir)
+{
+    fake_dir_t *d = (fake_dir_t *)dir;
+    if (d->real) return readdir(d->real);
+    if (d->next >= d->count) return NULL;
+    snprintf(d->ent.d_name, sizeof(d->ent.d_name), "%s", d->names[d->next++]);
+    d->ent.d_type = DT_REG;
+    return &d->ent;
+}
+
+int fake_flash_closedir(DIR *dir)
+{
+    fake_dir_t *d = (fake_dir_t *)dir;
+    int ret = d->real ? closedir(d->real) : 0;
+    for (int i = 0; i < d->count; i++) free(d->names[i]);
+    free(d->names);
+    free(d);
+    return ret;
+}
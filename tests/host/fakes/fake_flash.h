@@ -0,0 +1,49 @@
+#pragma once
+
+/*
+ * The "spiffs" data partition as a RAM-backed directory (/dev/shm when
+ * there is one), holding either SPIFFS or LittleFS. Mounting points
+ * host_fs at it. While SPIFFS is mounted the namespace is flat, as on the
+ * device: listing /spiffs returns every file by its full relative name,
+ * and a file can be created under any "directory". Force-included after
+ * stubs/host_fs.h.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <dirent.h>
+
+typedef enum {
+    FAKE_FLASH_BLANK,
+    FAKE_FLASH_SPIFFS,
+    FAKE_FLASH_LITTLEFS,
+} fake_flash_fs_t;
+
+/* What the partition holds, and what is mounted (BLANK: nothing) */
+fake_flash_fs_t fake_flash_format(void);
+fake_flash_fs_t fake_flash_mounted(void);
+
+/* Erase the partition and give it an empty filesystem of `fs`, mounted */
+void fake_flash_reset(fake_flash_fs_t fs);
+
+/* Unmount whatever is mounted */
+void fake_flash_unmount(void);
+
+/* Partition formats since start */
+extern int fake_flash_formats;
+
+/* PSRAM the migration leaves free; the stub heap reports 8 MB */
+extern size_t fake_flash_reserve;
+
+FILE *fake_flash_fopen(const char *path, const char *mode);
+DIR *fake_flash_opendir(const char *path);
+struct dirent *fake_flash_readdir(DIR *dir);
+int fake_flash_closedir(DIR *dir);
+
+#undef fopen
+#undef opendir
+#define fopen(p, m)     fake_flash_fopen((p), (m))
+#define opendir(p)      fake_flash_opendir(p)
+#define readdir(d)      fake_flash_readdir(d)
+#define closedir(d)     fake_flash_closedir(d)
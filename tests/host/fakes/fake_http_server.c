@@ -0,0 +1,213 @@
+/*
+ * esp_http_client against the stand-in server in fake_http_server.h,
+ * plus the llm_proxy getters an uploader reads its endpoint from.
+ */
+#include "fake_http_server.h"
+#include "esp_http_client.h"
+#include "esp_timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef enum {
+    RX_HEADERS,
+    RX_SIZE,                    /* chunk size line */
+    RX_DATA,
+    RX_DATA_END,                /* CRLF after a chunk */
+    RX_TRAILER,                 /* CRLF after the last chunk */
+    RX_SIZED,                   /* Content-Length body */
+    RX_DONE,
+} rx_state_t;
+
+struct esp_http_client {
+    char set_headers[512];
+    bool open;
+    rx_state_t state;
+    char line[1024];            /* headers, or the size line being read */
+    size_t line_len;
+    size_t want;                /* bytes left in the chunk or sized body */
+    size_t chunk_len;
+    char reply[512];
+    size_t reply_len, reply_sent;
+};
+
+static fake_http_script_t s_script;
+static fake_http_request_t s_req;
+
+void fake_http_reset(const fake_http_script_t *script)
+{
+    free(s_req.body);
+    memset(&s_req, 0, sizeof(s_req));
+    s_script = script ? *script : (fake_http_script_t){0};
+}
+
+const fake_http_request_t *fake_http_request(void)
+{
+    return &s_req;
+}
+
+const char *llm_get_asr_endpoint(void) { return FAKE_HTTP_URL; }
+const char *llm_get_openai_api_key_audio(void) { return "test-audio-key"; }
+
+static void body_append(const char *data, size_t len)
+{
+    s_req.body = realloc(s_req.body, s_req.body_len + len + 1);
+    memcpy(s_req.body + s_req.body_len, data, len);
+    s_req.body_len += len;
+    s_req.body[s_req.body_len] = '\0';
+}
+
+static void chunk_arrived(size_t len)
+{
+    if (s_req.chunk_count < FAKE_HTTP_MAX_CHUNKS) {
+        s_req.chunks[s_req.chunk_count++] = (fake_http_chunk_t){esp_timer_get_time(), len};
+    }
+}
+
+static void body_complete(esp_http_client_handle_t c)
+{
+    c->state = RX_DONE;
+    s_req.complete_us = esp_timer_get_time();
+}
+
+/* Decode what the client wrote; false on a framing error */
+static bool receive(esp_http_client_handle_t c, const char *p, size_t len)
+{
+    while (len > 0) {
+        switch (c->state) {
+        case RX_HEADERS:
+        case RX_SIZE:
+        case RX_DATA_END:
+        case RX_TRAILER:
+            if (c->line_len + 1 >= sizeof(c->line)) return false;
+            c->line[c->line_len++] = *p++;
+            len--;
+            c->line[c->line_len] = '\0';
+            if (c->state == RX_HEADERS) {
+                if (c->line_len < 4 || strcmp(c->line + c->line_len - 4, "\r\n\r\n") != 0) break;
+                snprintf(s_req.headers, sizeof(s_req.headers), "%s", c->line);
+                s_req.headers_us = esp_timer_get_time();
+                s_req.chunked = strcasestr(c->line, "Transfer-Encoding: chunked") != NULL;
+                const char *cl = strcasestr(c->line, "Content-Length:");
+                c->want = cl ? strtoul(cl + 15, NULL, 10) : 0;
+                c->state = s_req.chunked ? RX_SIZE : RX_SIZED;
+                if (c->state == RX_SIZED && c->want == 0) body_complete(c);
+            } else if (c->line_len >= 2 && strcmp(c->line + c->line_len - 2, "\r\n") == 0) {
+                if (c->state == RX_SIZE) {
+                    char *end;
+                    c->want = c->chunk_len = strtoul(c->line, &end, 16);
+                    if (end == c->line) return false;
+                    c->state = c->want ? RX_DATA : RX_TRAILER;
+                } else if (c->line_len != 2) {
+                    return false;
+                } else if (c->state == RX_DATA_END) {
+                    c->state = RX_SIZE;
+                } else {
+                    body_complete(c);
+                }
+            } else {
+                break;
+            }
+            c->line_len = 0;
+            break;
+        case RX_DATA:
+        case RX_SIZED: {
+            size_t n = len < c->want ? len : c->want;
+            body_append(p, n);
+            p += n;
+            len -= n;
+            c->want -= n;
+            if (c->want > 0) break;
+            if (c->state == RX_DATA) {
+                chunk_arrived(c->chunk_len);
+                c->state = RX_DATA_END;
+            } else {
+                chunk_arrived(s_req.body_len);
+                body_complete(c);
+            }
+            break;
+        }
+        case RX_DONE:
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ── esp_http_client.h ────────────────────────────────────────── */
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    if (!config->url || strcmp(config->url, FAKE_HTTP_URL) != 0) return NULL;
+    return calloc(1, sizeof(struct esp_http_client));
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t c, const char *key, const char *value)
+{
+    size_t used = strlen(c->set_headers);
+    snprintf(c->set_headers + used, sizeof(c->set_headers) - used, "%s: %s\r\n", key, value);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t c, int write_len)
+{
+    if (s_script.connect_ms) usleep(s_script.connect_ms * 1000);
+    s_req.opened_us = esp_timer_get_time();
+    c->open = true;
+
+    char head[768];
+    int n = snprintf(head, sizeof(head), "POST /v1/audio/transcriptions HTTP/1.1\r\n"
+                     "Host: 127.0.0.1\r\n%s", c->set_headers);
+    if (write_len < 0) n += snprintf(head + n, sizeof(head) - n, "Transfer-Encoding: chunked\r\n\r\n");
+    else n += snprintf(head + n, sizeof(head) - n, "Content-Length: %d\r\n\r\n", write_len);
+    return receive(c, head, (size_t)n) ? ESP_OK : ESP_FAIL;
+}
+
+int esp_http_client_write(esp_http_client_handle_t c, const char *buffer, int len)
+{
+    if (!c->open || !receive(c, buffer, (size_t)len)) return -1;
+    return len;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t c)
+{
+    if (!c->open || c->state != RX_DONE) return ESP_FAIL;
+    int64_t due = s_req.complete_us + s_script.process_ms * 1000LL;
+    int64_t now = esp_timer_get_time();
+    if (due > now) usleep((useconds_t)(due - now));
+    s_req.replied_us = esp_timer_get_time();
+
+    const char *body = s_script.body ? s_script.body : "{}";
+    c->reply_len = (size_t)snprintf(c->reply, sizeof(c->reply), "%s", body);
+    c->reply_sent = 0;
+    return (int64_t)c->reply_len;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t c)
+{
+    (void)c;
+    return s_script.status ? s_script.status : 200;
+}
+
+int esp_http_client_read(esp_http_client_handle_t c, char *buffer, int len)
+{
+    size_t n = c->reply_len - c->reply_sent;
+    if (n > (size_t)len) n = (size_t)len;
+    memcpy(buffer, c->reply + c->reply_sent, n);
+    c->reply_sent += n;
+    return (int)n;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t c)
+{
+    c->open = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t c)
+{
+    free(c);
+    return ESP_OK;
+}
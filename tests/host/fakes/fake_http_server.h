@@ -0,0 +1,49 @@
+#pragma once
+
+/*
+ * Stand-in for an HTTP server behind esp_http_client, for tests that run
+ * uploaders such as asr_client.c. One request per client handle: the
+ * request is decoded as it is written (Content-Length or chunked body)
+ * and the arrival time of every body chunk is recorded. Once the body is
+ * complete the reply is served, after a simulated processing delay.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FAKE_HTTP_MAX_CHUNKS    1024
+
+typedef struct {
+    int connect_ms;             /* open() blocks this long (DNS + TLS) */
+    int process_ms;             /* from the last body byte to the reply */
+    int status;                 /* 0 = 200 */
+    const char *body;           /* reply body, NULL = "{}" */
+} fake_http_script_t;
+
+typedef struct {
+    int64_t us;                 /* arrival, esp_timer clock */
+    size_t len;
+} fake_http_chunk_t;
+
+typedef struct {
+    int64_t opened_us;          /* connection established */
+    int64_t headers_us;         /* request headers complete */
+    int64_t complete_us;        /* body complete, 0 while still arriving */
+    int64_t replied_us;         /* reply headers fetched by the client */
+    bool chunked;
+    char headers[1024];
+    char *body;                 /* decoded body, chunk framing removed */
+    size_t body_len;
+    fake_http_chunk_t chunks[FAKE_HTTP_MAX_CHUNKS];
+    int chunk_count;
+} fake_http_request_t;
+
+/* Forget the last request and serve the next one with `script` */
+void fake_http_reset(const fake_http_script_t *script);
+
+/* The request received since the last reset; valid until the next reset */
+const fake_http_request_t *fake_http_request(void);
+
+/* What llm_get_asr_endpoint() returns; other URLs fail esp_http_client_init */
+#define FAKE_HTTP_URL   "http://127.0.0.1:18080/v1/audio/transcriptions"
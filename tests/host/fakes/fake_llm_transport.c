@@ -0,0 +1,355 @@
+/*
+ * The network under llm_proxy.c: each proxy tunnel, or with the proxy
+ * off each esp_http_client session, talks to the scripted server in
+ * fake_llm_transport.h. The tool registry keeps no provider blobs, so
+ * tools are rendered per request.
+ */
+#include "fake_llm_transport.h"
+#include "proxy/http_proxy.h"
+#include "tools/tool_registry.h"
+#include "esp_http_client.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_REPLIES  16
+#define MAX_TUNNELS  8
+
+struct proxy_conn {
+    bool server_closed;
+    char *req;                  /* bytes of the request being received */
+    size_t req_len, req_cap;
+    fake_reply_t reply;         /* response in flight, data == NULL if none */
+    size_t sent;
+};
+
+static fake_reply_t s_replies[MAX_REPLIES];
+static int s_reply_head, s_reply_count;
+static proxy_conn_t *s_tunnels[MAX_TUNNELS];
+static int s_opens;
+static char *s_last_req;
+static size_t s_last_req_len;
+static bool s_proxy = true;
+
+void fake_transport_use_proxy(bool on)
+{
+    s_proxy = on;
+}
+
+void fake_transport_reset(void)
+{
+    s_reply_head = s_reply_count = 0;
+    s_opens = 0;
+}
+
+void fake_transport_queue(const fake_reply_t *reply)
+{
+    if (s_reply_count == MAX_REPLIES) abort();
+    fake_reply_t *r = &s_replies[(s_reply_head + s_reply_count++) % MAX_REPLIES];
+    *r = *reply;
+    if (!r->len) r->len = strlen(r->data);
+}
+
+void fake_transport_close_idle(void)
+{
+    for (int i = 0; i < MAX_TUNNELS; i++) {
+        if (s_tunnels[i]) s_tunnels[i]->server_closed = true;
+    }
+}
+
+int fake_transport_opens(void) { return s_opens; }
+
+int fake_transport_live(void)
+{
+    int n = 0;
+    for (int i = 0; i < MAX_TUNNELS; i++) n += s_tunnels[i] != NULL;
+    return n;
+}
+
+const char *fake_transport_last_request(size_t *len)
+{
+    if (len) *len = s_last_req_len;
+    return s_last_req;
+}
+
+/* ── proxy/http_proxy.h ────────────────────────────────────────── */
+
+bool http_proxy_is_enabled(void) { return s_proxy; }
+
+proxy_conn_t *proxy_conn_open(const char *host, int port, int timeout_ms)
+{
+    (void)host; (void)port; (void)timeout_ms;
+    for (int i = 0; i < MAX_TUNNELS; i++) {
+        if (!s_tunnels[i]) {
+            s_tunnels[i] = calloc(1, sizeof(proxy_conn_t));
+            s_opens++;
+            return s_tunnels[i];
+        }
+    }
+    return NULL;
+}
+
+int proxy_conn_write(proxy_conn_t *conn, const char *data, int len)
+{
+    if (conn->req_len + len > conn->req_cap) {
+        conn->req_cap = (conn->req_len + len) * 2;
+        conn->req = realloc(conn->req, conn->req_cap);
+    }
+    memcpy(conn->req + conn->req_len, data, len);
+    conn->req_len += len;
+    return len;
+}
+
+/* True once the headers and Content-Length bytes of body are in */
+static bool request_complete(const proxy_conn_t *conn)
+{
+    const char *end = conn->req ? memmem(conn->req, conn->req_len, "\r\n\r\n", 4) : NULL;
+    if (!end) return false;
+    size_t head = (size_t)(end - conn->req) + 4;
+    const char *cl = memmem(conn->req, head, "Content-Length:", 15);
+    size_t body = cl ? strtoul(cl + 15, NULL, 10) : 0;
+    return conn->req_len >= head + body;
+}
+
+int proxy_conn_read(proxy_conn_t *conn, char *buf, int len, int timeout_ms)
+{
+    (void)timeout_ms;
+    if (!conn->reply.data) {
+        if (conn->server_closed) return 0;
+        if (!request_complete(conn) || s_reply_count == 0) return -1;
+
+        free(s_last_req);
+        s_last_req = conn->req;
+        s_last_req_len = conn->req_len;
+        conn->req = NULL;
+        conn->req_len = conn->req_cap = 0;
+
+        conn->reply = s_replies[s_reply_head];
+        s_reply_head = (s_reply_head + 1) % MAX_REPLIES;
+        s_reply_count--;
+        conn->sent = 0;
+    }
+
+    size_t n = conn->reply.len - conn->sent;
+    size_t most = conn->reply.read_size;
+    if (most && conn->reply.seed) most = 1 + rand_r(&conn->reply.seed) % most;
+    if (most && n > most) n = most;
+    if (n > (size_t)len) n = (size_t)len;
+    memcpy(buf, conn->reply.data + conn->sent, n);
+    conn->sent += n;
+    if (conn->sent == conn->reply.len) {
+        if (conn->reply.close) conn->server_closed = true;
+        conn->reply.data = NULL;
+    }
+    return (int)n;
+}
+
+void proxy_conn_close(proxy_conn_t *conn)
+{
+    for (int i = 0; i < MAX_TUNNELS; i++) {
+        if (s_tunnels[i] == conn) s_tunnels[i] = NULL;
+    }
+    free(conn->req);
+    free(conn);
+}
+
+/* ── tools/tool_registry.h ─────────────────────────────────────── */
+
+const char *tool_registry_get_tools_blob(const char *tools_json, tool_schema_format_t format)
+{
+    (void)tools_json; (void)format;
+    return NULL;
+}
+
+/* ── esp_http_client.h ─────────────────────────────────────────── */
+
+/* The reply is decoded as esp_http_client does: interim 1xx responses
+ * skipped, then a Content-Length, chunked or close-delimited body. A
+ * connection that ends early ends the read quietly; only
+ * esp_http_client_is_complete_data_received() tells. */
+typedef enum {
+    BODY_SIZED,
+    BODY_CHUNK_SIZE,
+    BODY_CHUNK_DATA,
+    BODY_CHUNK_CRLF,
+    BODY_TRAILER,
+    BODY_UNTIL_EOF,
+    BODY_DONE,
+} body_state_t;
+
+struct esp_http_client {
+    proxy_conn_t *conn;
+    char raw[1024];             /* received, not yet decoded */
+    size_t raw_len, raw_off;
+    int status;
+    bool chunked;
+    body_state_t state;
+    long long want;             /* bytes left in the sized body or chunk */
+    char line[32];              /* chunk size line */
+    size_t line_len;
+};
+
+/* More reply bytes into raw; the proxy_conn_read result */
+static int client_fill(esp_http_client_handle_t c)
+{
+    if (c->raw_off == c->raw_len) c->raw_off = c->raw_len = 0;
+    if (c->raw_len == sizeof(c->raw)) return -1;
+    int n = proxy_conn_read(c->conn, c->raw + c->raw_len, (int)(sizeof(c->raw) - c->raw_len), 0);
+    if (n > 0) c->raw_len += (size_t)n;
+    return n;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    (void)config;
+    return calloc(1, sizeof(struct esp_http_client));
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    if (client->conn) proxy_conn_close(client->conn);
+    free(client);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+    if (client->conn) proxy_conn_close(client->conn);
+    client->conn = NULL;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url)
+{
+    (void)client; (void)url;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method)
+{
+    (void)client; (void)method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    (void)client; (void)key; (void)value;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_user_data(esp_http_client_handle_t client, void *data)
+{
+    (void)client; (void)data;
+    return ESP_OK;
+}
+
+/* Connects on first use and keeps the session, as with keep-alive */
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len)
+{
+    if (!client->conn) client->conn = proxy_conn_open("direct", 443, 0);
+    if (!client->conn) return ESP_ERR_HTTP_CONNECT;
+    client->raw_len = client->raw_off = 0;
+    client->status = 0;
+    client->chunked = false;
+    client->state = BODY_DONE;
+
+    char head[96];
+    int n = snprintf(head, sizeof(head), "POST /v1/messages HTTP/1.1\r\nContent-Length: %d\r\n\r\n",
+                     write_len);
+    return proxy_conn_write(client->conn, head, n) == n ? ESP_OK : ESP_ERR_HTTP_CONNECT;
+}
+
+int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, int len)
+{
+    return client->conn ? proxy_conn_write(client->conn, buffer, len) : -1;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client)
+{
+    while (1) {
+        char *start = client->raw + client->raw_off;
+        size_t avail = client->raw_len - client->raw_off;
+        char *end = memmem(start, avail, "\r\n\r\n", 4);
+        if (!end) {
+            if (client_fill(client) <= 0) return ESP_FAIL;
+            continue;
+        }
+        *end = '\0';
+        client->raw_off += (size_t)(end + 4 - start);
+        if (sscanf(start, "HTTP/1.%*d %d", &client->status) != 1) return ESP_FAIL;
+        if (client->status / 100 == 1) continue;
+
+        const char *cl = strcasestr(start, "Content-Length:");
+        client->chunked = strcasestr(start, "Transfer-Encoding: chunked") != NULL;
+        client->want = cl ? strtoll(cl + 15, NULL, 10) : -1;
+        client->line_len = 0;
+        if (client->chunked) {
+            client->state = BODY_CHUNK_SIZE;
+            return -1;
+        }
+        client->state = cl ? (client->want ? BODY_SIZED : BODY_DONE) : BODY_UNTIL_EOF;
+        return client->want;
+    }
+}
+
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client)
+{
+    return client->chunked;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return client->status;
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len)
+{
+    int out = 0;
+    while (out < len && client->state != BODY_DONE) {
+        if (client->raw_off == client->raw_len) {
+            int n = client_fill(client);
+            if (n == 0 && client->state == BODY_UNTIL_EOF) client->state = BODY_DONE;
+            if (n == 0) break;
+            if (n < 0) return out ? out : -1;
+        }
+        char *p = client->raw + client->raw_off;
+        size_t avail = client->raw_len - client->raw_off;
+
+        if (client->state == BODY_SIZED || client->state == BODY_CHUNK_DATA ||
+            client->state == BODY_UNTIL_EOF) {
+            size_t n = avail < (size_t)(len - out) ? avail : (size_t)(len - out);
+            if (client->state != BODY_UNTIL_EOF && (long long)n > client->want) n = (size_t)client->want;
+            memcpy(buffer + out, p, n);
+            out += (int)n;
+            client->raw_off += n;
+            if (client->state == BODY_UNTIL_EOF) continue;
+            client->want -= (long long)n;
+            if (client->want == 0) {
+                client->state = client->state == BODY_SIZED ? BODY_DONE : BODY_CHUNK_CRLF;
+            }
+            continue;
+        }
+
+        /* Size line, the CRLF after a chunk, or the final CRLF */
+        client->raw_off++;
+        if (client->line_len + 1 < sizeof(client->line)) client->line[client->line_len++] = *p;
+        if (*p != '\n') continue;
+        client->line[client->line_len] = '\0';
+        client->line_len = 0;
+        if (client->state == BODY_CHUNK_SIZE) {
+            client->want = strtoll(client->line, NULL, 16);
+            client->state = client->want ? BODY_CHUNK_DATA : BODY_TRAILER;
+        } else if (client->state == BODY_CHUNK_CRLF) {
+            client->state = BODY_CHUNK_SIZE;
+        } else if (strcmp(client->line, "\r\n") == 0) {
+            client->state = BODY_DONE;
+        }
+    }
+    return out;
+}
+
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t client)
+{
+    return client->state == BODY_DONE;
+}
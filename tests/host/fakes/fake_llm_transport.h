@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+ * Stand-in for the HTTPS server behind the proxy tunnel, for tests that
+ * run llm_proxy.c. Each proxy_conn_open() is one tunnel; once a whole
+ * request (headers plus Content-Length body) has been written, reads
+ * return the next queued reply, split into reads of at most read_size.
+ * With the proxy off, each esp_http_client session is a connection to
+ * the same server, and the client decodes the reply's framing.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    const char *data;       /* raw response: status line, headers, body */
+    size_t len;             /* 0 = strlen(data) */
+    size_t read_size;       /* most bytes one read returns, 0 = all at once */
+    unsigned seed;          /* nonzero: each read returns 1..read_size bytes at random */
+    bool close;             /* server closes the tunnel after sending it */
+} fake_reply_t;
+
+/* Route requests through the proxy tunnel (the default) or esp_http_client */
+void fake_transport_use_proxy(bool on);
+
+/* Forget queued replies and tunnel counters; live tunnels are left alone */
+void fake_transport_reset(void);
+
+/* Queue a reply; data must stay valid until it has been read */
+void fake_transport_queue(const fake_reply_t *reply);
+
+/* The server drops every open connection: writes still succeed, reads see EOF */
+void fake_transport_close_idle(void);
+
+/* Connections opened since the last reset, and connections not yet closed */
+int fake_transport_opens(void);
+int fake_transport_live(void);
+
+/* Bytes of the last complete request the server received */
+const char *fake_transport_last_request(size_t *len);
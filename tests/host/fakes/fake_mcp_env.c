@@ -0,0 +1,197 @@
+/*
+ * In-process MCP servers for mcp_manager.c. tools/list answers with the
+ * server's synthetic tools; tools/call answers "<url>:<tool>" when the
+ * server has the tool and an isError result when it does not.
+ */
+#include "fake_mcp_env.h"
+#include "agent/mcp_client.h"
+#include "memory/kv_store.h"
+#include "cJSON.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_SERVERS  4
+
+typedef struct {
+    char url[64];
+    char prefix[32];
+    int first, count;
+} fake_server_t;
+
+struct mcp_client_t {
+    mcp_client_config_t config;
+    bool connected;
+};
+
+static fake_server_t s_servers[MAX_SERVERS];
+static mcp_client_t *s_clients[MAX_SERVERS];
+static const tool_provider_t *s_provider;
+static int s_rebuilds;
+
+static fake_server_t *server_for(const char *url)
+{
+    for (int i = 0; i < MAX_SERVERS; i++) {
+        if (strcmp(s_servers[i].url, url) == 0) return &s_servers[i];
+    }
+    return NULL;
+}
+
+void fake_mcp_serve(const char *url, const char *prefix, int first, int count)
+{
+    fake_server_t *srv = server_for(url);
+    for (int i = 0; !srv && i < MAX_SERVERS; i++) {
+        if (!s_servers[i].url[0]) srv = &s_servers[i];
+    }
+    if (!srv) abort();
+    snprintf(srv->url, sizeof(srv->url), "%s", url);
+    snprintf(srv->prefix, sizeof(srv->prefix), "%s", prefix);
+    srv->first = first;
+    srv->count = count;
+}
+
+void fake_mcp_relist(const char *url)
+{
+    for (int i = 0; i < MAX_SERVERS; i++) {
+        mcp_client_t *c = s_clients[i];
+        if (c && c->connected && strcmp(c->config.url, url) == 0) c->config.on_connect(c);
+    }
+}
+
+/* ── agent/mcp_client.h ────────────────────────────────────────── */
+
+mcp_client_t *mcp_client_create(const mcp_client_config_t *config)
+{
+    mcp_client_t *c = calloc(1, sizeof(*c));
+    c->config = *config;
+    for (int i = 0; i < MAX_SERVERS; i++) {
+        if (!s_clients[i]) {
+            s_clients[i] = c;
+            break;
+        }
+    }
+    return c;
+}
+
+void mcp_client_destroy(mcp_client_t *client)
+{
+    for (int i = 0; i < MAX_SERVERS; i++) {
+        if (s_clients[i] == client) s_clients[i] = NULL;
+    }
+    free(client);
+}
+
+esp_err_t mcp_client_connect(mcp_client_t *client)
+{
+    if (!server_for(client->config.url)) return ESP_FAIL;
+    client->connected = true;
+    client->config.on_connect(client);
+    return ESP_OK;
+}
+
+esp_err_t mcp_client_disconnect(mcp_client_t *client)
+{
+    client->connected = false;
+    return ESP_OK;
+}
+
+bool mcp_client_is_connected(mcp_client_t *client) { return client->connected; }
+esp_err_t mcp_client_send(mcp_client_t *client, const char *json_data)
+{
+    (void)client; (void)json_data;
+    return ESP_OK;
+}
+void *mcp_client_get_ctx(mcp_client_t *client) { return client ? client->config.user_ctx : NULL; }
+
+static char *tools_list(const fake_server_t *srv)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON *tools = cJSON_AddArrayToObject(root, "tools");
+    for (int i = 0; i < srv->count; i++) {
+        char name[48];
+        snprintf(name, sizeof(name), "%s_%03d", srv->prefix, srv->first + i);
+        cJSON *t = cJSON_CreateObject();
+        cJSON_AddStringToObject(t, "name", name);
+        cJSON_AddStringToObject(t, "description", "A synthetic MCP tool.");
+        cJSON *schema = cJSON_AddObjectToObject(t, "inputSchema");
+        cJSON_AddStringToObject(schema, "type", "object");
+        cJSON_AddItemToArray(tools, t);
+    }
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json;
+}
+
+static char *tools_call(const fake_server_t *srv, const char *params)
+{
+    cJSON *p = cJSON_Parse(params);
+    const char *name = cJSON_GetStringValue(cJSON_GetObjectItem(p, "name"));
+    size_t plen = strlen(srv->prefix);
+    int n = -1;
+    bool have = name && strncmp(name, srv->prefix, plen) == 0 && name[plen] == '_' &&
+                sscanf(name + plen + 1, "%d", &n) == 1 &&
+                n >= srv->first && n < srv->first + srv->count;
+
+    char text[128];
+    if (have) snprintf(text, sizeof(text), "%s:%s", srv->url, name);
+    else snprintf(text, sizeof(text), "%s: unknown tool %s", srv->url, name ? name : "?");
+    cJSON_Delete(p);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON *content = cJSON_AddArrayToObject(root, "content");
+    cJSON *block = cJSON_CreateObject();
+    cJSON_AddStringToObject(block, "type", "text");
+    cJSON_AddStringToObject(block, "text", text);
+    cJSON_AddItemToArray(content, block);
+    if (!have) cJSON_AddBoolToObject(root, "isError", true);
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json;
+}
+
+esp_err_t mcp_client_send_request(mcp_client_t *client, const char *method, const char *params,
+                                  mcp_result_cb_t cb, void *ctx)
+{
+    const fake_server_t *srv = server_for(client->config.url);
+    if (!client->connected || !srv) return ESP_FAIL;
+
+    char *result = NULL;
+    if (strcmp(method, "tools/list") == 0) result = tools_list(srv);
+    else if (strcmp(method, "tools/call") == 0) result = tools_call(srv, params);
+    if (cb) cb(ctx, 1, result, result ? ESP_OK : ESP_FAIL);
+    free(result);
+    return ESP_OK;
+}
+
+esp_err_t mcp_client_send_notification(mcp_client_t *client, const char *method, const char *params)
+{
+    (void)client; (void)method; (void)params;
+    return ESP_OK;
+}
+
+/* ── memory/kv_store.h: nothing saved ──────────────────────────── */
+
+esp_err_t kv_store_set_str(const char *key, const char *value)
+{
+    (void)key; (void)value;
+    return ESP_OK;
+}
+esp_err_t kv_store_delete(const char *key) { (void)key; return ESP_OK; }
+void kv_store_foreach(const char *prefix, kv_store_iter_fn fn, void *arg)
+{
+    (void)prefix; (void)fn; (void)arg;
+}
+bool kv_store_has_prefix(const char *prefix) { (void)prefix; return true; }
+
+/* ── tools/tool_registry.h ─────────────────────────────────────── */
+
+esp_err_t tool_registry_register_provider(const tool_provider_t *provider)
+{
+    s_provider = provider;
+    return ESP_OK;
+}
+void tool_registry_rebuild_json(void) { s_rebuilds++; }
+
+const tool_provider_t *fake_registry_provider(void) { return s_provider; }
+int fake_registry_rebuilds(void) { return s_rebuilds; }
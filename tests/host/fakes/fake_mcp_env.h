@@ -0,0 +1,20 @@
+#pragma once
+
+/*
+ * Stand-ins around mcp_manager.c: MCP servers answer in-process and at
+ * once, the config store is empty, and the tool registry only keeps the
+ * provider so a test can call it directly.
+ */
+
+#include "tools/tool_registry.h"
+
+/* Serve tools "<prefix>_000".. from the server at url, count of them
+ * starting at first; reconnecting re-lists them */
+void fake_mcp_serve(const char *url, const char *prefix, int first, int count);
+
+/* Re-send tools/list on the source's live connection to url */
+void fake_mcp_relist(const char *url);
+
+/* The provider mcp_manager_init() registered, and rebuild_json() calls */
+const tool_provider_t *fake_registry_provider(void);
+int fake_registry_rebuilds(void);
@@ -0,0 +1,73 @@
+/*
+ * Built-in tool entry points referenced by tool_registry_init(), for tests
+ * that link the registry without the hardware, file and network tools.
+ * Each answers with its own name. All are weak, so a test can link the
+ * real module for the tool it exercises.
+ */
+#include "tools/tool_registry.h"
+#include "tools/tool_web_search.h"
+#include "tools/tool_get_time.h"
+#include "tools/tool_files.h"
+#include "tools/tool_cron.h"
+#include "tools/tool_hardware.h"
+#include "tools/tool_network.h"
+#include "tools/tool_skill_create.h"
+#include "tools/tool_skill_manage.h"
+#include "tools/tool_mcp.h"
+#include "tools/tool_voice.h"
+#include "tools/tool_audio.h"
+#include "tools/tool_memory.h"
+#include "llm/llm_proxy.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define FAKE_TOOL(fn) \
+    __attribute__((weak)) esp_err_t fn(const char *input, char *output, size_t size) \
+    { \
+        (void)input; \
+        snprintf(output, size, "%s", #fn); \
+        return ESP_OK; \
+    }
+
+FAKE_TOOL(tool_web_search_execute)
+FAKE_TOOL(tool_get_time_execute)
+FAKE_TOOL(tool_set_timezone_execute)
+FAKE_TOOL(tool_read_file_execute)
+FAKE_TOOL(tool_grep_file_execute)
+FAKE_TOOL(tool_write_file_execute)
+FAKE_TOOL(tool_edit_file_execute)
+FAKE_TOOL(tool_list_dir_execute)
+FAKE_TOOL(tool_memory_search_execute)
+FAKE_TOOL(tool_cron_add_execute)
+FAKE_TOOL(tool_cron_list_execute)
+FAKE_TOOL(tool_cron_remove_execute)
+FAKE_TOOL(tool_system_status)
+FAKE_TOOL(tool_gpio_control)
+FAKE_TOOL(tool_i2c_scan)
+FAKE_TOOL(tool_adc_read)
+FAKE_TOOL(tool_pwm_control)
+FAKE_TOOL(tool_rgb_control)
+FAKE_TOOL(tool_wifi_scan)
+FAKE_TOOL(tool_wifi_status)
+FAKE_TOOL(tool_ble_scan)
+FAKE_TOOL(tool_uart_send)
+FAKE_TOOL(tool_i2s_read)
+FAKE_TOOL(tool_i2s_write)
+FAKE_TOOL(tool_system_restart)
+FAKE_TOOL(tool_skill_create_execute)
+FAKE_TOOL(tool_skill_list_templates_execute)
+FAKE_TOOL(tool_skill_get_template_execute)
+FAKE_TOOL(tool_skill_manage_execute)
+FAKE_TOOL(tool_mcp_add)
+FAKE_TOOL(tool_mcp_list)
+FAKE_TOOL(tool_mcp_remove)
+FAKE_TOOL(tool_mcp_action)
+
+__attribute__((weak)) esp_err_t tool_web_search_init(void) { return ESP_OK; }
+__attribute__((weak)) void tool_time_init(void) {}
+__attribute__((weak)) void tool_files_init(void) {}
+__attribute__((weak)) esp_err_t tool_network_init(void) { return ESP_OK; }
+__attribute__((weak)) void register_voice_tools(void) {}
+__attribute__((weak)) void register_audio_tools(void) {}
+__attribute__((weak)) esp_err_t llm_set_streaming(bool enable) { (void)enable; return ESP_OK; }
@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+ * Minimal assertion helpers for the host tests. A failed CHECK reports
+ * and counts but keeps going, so one run shows every failure; the test's
+ * main() returns host_test_result().
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+extern int host_test_failures;
+
+#define CHECK(cond) do {                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            host_test_failures++;                                           \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_EQ_INT(a, b) do {                                             \
+        long long a_ = (long long)(a), b_ = (long long)(b);                 \
+        if (a_ != b_) {                                                     \
+            fprintf(stderr, "FAIL %s:%d: %s == %s (%lld vs %lld)\n",        \
+                    __FILE__, __LINE__, #a, #b, a_, b_);                    \
+            host_test_failures++;                                           \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_EQ_STR(a, b) do {                                             \
+        const char *a_ = (a), *b_ = (b);                                    \
+        if (!a_ || !b_ || strcmp(a_, b_) != 0) {                            \
+            fprintf(stderr, "FAIL %s:%d: %s == %s\n  got:  %s\n  want: %s\n", \
+                    __FILE__, __LINE__, #a, #b, a_ ? a_ : "(null)",         \
+                    b_ ? b_ : "(null)");                                    \
+            host_test_failures++;                                           \
+        }                                                                   \
+    } while (0)
+
+/* Benchmarks print one line per figure, prefixed so they are easy to grep */
+#define BENCH(fmt, ...) printf("bench: " fmt "\n", ##__VA_ARGS__)
+
+static inline int host_test_result(const char *name)
+{
+    if (host_test_failures) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, host_test_failures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
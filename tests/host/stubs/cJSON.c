@@ -0,0 +1,687 @@
+#include "cJSON.h"
+
+#include <ctype.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static void *(*s_malloc)(size_t) = malloc;
+static void (*s_free)(void *) = free;
+
+void cJSON_InitHooks(cJSON_Hooks *hooks)
+{
+    s_malloc = (hooks && hooks->malloc_fn) ? hooks->malloc_fn : malloc;
+    s_free = (hooks && hooks->free_fn) ? hooks->free_fn : free;
+}
+
+void cJSON_free(void *object)
+{
+    s_free(object);
+}
+
+static char *dup_str(const char *s)
+{
+    if (!s) return NULL;
+    size_t n = strlen(s) + 1;
+    char *d = s_malloc(n);
+    if (d) memcpy(d, s, n);
+    return d;
+}
+
+static cJSON *new_item(int type)
+{
+    cJSON *item = s_malloc(sizeof(cJSON));
+    if (item) {
+        memset(item, 0, sizeof(*item));
+        item->type = type;
+    }
+    return item;
+}
+
+void cJSON_Delete(cJSON *item)
+{
+    while (item) {
+        cJSON *next = item->next;
+        if (!(item->type & cJSON_IsReference) && item->child) cJSON_Delete(item->child);
+        if (!(item->type & cJSON_IsReference)) s_free(item->valuestring);
+        if (!(item->type & cJSON_StringIsConst)) s_free(item->string);
+        s_free(item);
+        item = next;
+    }
+}
+
+/* ── Parser ─────────────────────────────────────────────────────── */
+
+typedef struct {
+    const char *p;
+    const char *end;
+} parse_t;
+
+static void skip_ws(parse_t *ps)
+{
+    while (ps->p < ps->end && (unsigned char)*ps->p <= 32) ps->p++;
+}
+
+static int literal(parse_t *ps, const char *word)
+{
+    size_t n = strlen(word);
+    if ((size_t)(ps->end - ps->p) < n || strncmp(ps->p, word, n) != 0) return 0;
+    ps->p += n;
+    return 1;
+}
+
+static int hex4(const char *p, unsigned *out)
+{
+    unsigned v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= (unsigned)(c - '0');
+        else if (c >= 'a' && c <= 'f') v |= (unsigned)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') v |= (unsigned)(c - 'A' + 10);
+        else return 0;
+    }
+    *out = v;
+    return 1;
+}
+
+static size_t utf8_put(char *out, unsigned cp)
+{
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+static char *parse_string_raw(parse_t *ps)
+{
+    if (ps->p >= ps->end || *ps->p != '"') return NULL;
+    const char *start = ++ps->p;
+    size_t cap = 0;
+    while (ps->p < ps->end && *ps->p != '"') {
+        if (*ps->p == '\\') ps->p++;
+        ps->p++;
+        cap++;
+    }
+    if (ps->p >= ps->end) return NULL;
+
+    char *out = s_malloc(cap * 2 + 1);
+    if (!out) return NULL;
+    size_t n = 0;
+    for (const char *s = start; s < ps->p; s++) {
+        if (*s != '\\') {
+            out[n++] = *s;
+            continue;
+        }
+        s++;
+        switch (*s) {
+        case 'b': out[n++] = '\b'; break;
+        case 'f': out[n++] = '\f'; break;
+        case 'n': out[n++] = '\n'; break;
+        case 'r': out[n++] = '\r'; break;
+        case 't': out[n++] = '\t'; break;
+        case '"': case '\\': case '/': out[n++] = *s; break;
+        case 'u': {
+            unsigned cp;
+            if (ps->p - s < 5 || !hex4(s + 1, &cp)) goto fail;
+            s += 4;
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                unsigned lo;
+                if (ps->p - s < 7 || s[1] != '\\' || s[2] != 'u' || !hex4(s + 3, &lo) ||
+                    lo < 0xDC00 || lo > 0xDFFF) goto fail;
+                s += 6;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            }
+            n += utf8_put(out + n, cp);
+            break;
+        }
+        default:
+            goto fail;
+        }
+    }
+    out[n] = '\0';
+    ps->p++;
+    return out;
+
+fail:
+    s_free(out);
+    return NULL;
+}
+
+static cJSON *parse_value(parse_t *ps, int depth);
+
+static cJSON *parse_number(parse_t *ps)
+{
+    char buf[64];
+    size_t n = 0;
+    while (ps->p + n < ps->end && n < sizeof(buf) - 1 &&
+           strchr("+-0123456789.eE", ps->p[n])) {
+        buf[n] = ps->p[n];
+        n++;
+    }
+    buf[n] = '\0';
+    char *endp;
+    double d = strtod(buf, &endp);
+    if (endp == buf) return NULL;
+    ps->p += endp - buf;
+    return cJSON_CreateNumber(d);
+}
+
+static cJSON *parse_container(parse_t *ps, int depth, int object)
+{
+    cJSON *item = new_item(object ? cJSON_Object : cJSON_Array);
+    if (!item) return NULL;
+    ps->p++;
+    skip_ws(ps);
+    if (ps->p < ps->end && *ps->p == (object ? '}' : ']')) {
+        ps->p++;
+        return item;
+    }
+
+    cJSON *tail = NULL;
+    for (;;) {
+        char *key = NULL;
+        skip_ws(ps);
+        if (object) {
+            key = parse_string_raw(ps);
+            if (!key) goto fail;
+            skip_ws(ps);
+            if (ps->p >= ps->end || *ps->p != ':') {
+                s_free(key);
+                goto fail;
+            }
+            ps->p++;
+        }
+        cJSON *child = parse_value(ps, depth + 1);
+        if (!child) {
+            s_free(key);
+            goto fail;
+        }
+        child->string = key;
+        if (tail) {
+            tail->next = child;
+            child->prev = tail;
+        } else {
+            item->child = child;
+        }
+        item->child->prev = child;
+        tail = child;
+
+        skip_ws(ps);
+        if (ps->p >= ps->end) goto fail;
+        if (*ps->p == ',') {
+            ps->p++;
+            continue;
+        }
+        if (*ps->p == (object ? '}' : ']')) {
+            ps->p++;
+            return item;
+        }
+        goto fail;
+    }
+
+fail:
+    cJSON_Delete(item);
+    return NULL;
+}
+
+static cJSON *parse_value(parse_t *ps, int depth)
+{
+    if (depth > 1000) return NULL;
+    skip_ws(ps);
+    if (ps->p >= ps->end) return NULL;
+    switch (*ps->p) {
+    case '{': return parse_container(ps, depth, 1);
+    case '[': return parse_container(ps, depth, 0);
+    case '"': {
+        char *s = parse_string_raw(ps);
+        if (!s) return NULL;
+        cJSON *item = new_item(cJSON_String);
+        if (!item) {
+            s_free(s);
+            return NULL;
+        }
+        item->valuestring = s;
+        return item;
+    }
+    case 'n': return literal(ps, "null") ? cJSON_CreateNull() : NULL;
+    case 't': return literal(ps, "true") ? cJSON_CreateTrue() : NULL;
+    case 'f': return literal(ps, "false") ? cJSON_CreateFalse() : NULL;
+    default:
+        if (*ps->p == '-' || isdigit((unsigned char)*ps->p)) return parse_number(ps);
+        return NULL;
+    }
+}
+
+cJSON *cJSON_ParseWithLength(const char *value, size_t buffer_length)
+{
+    if (!value) return NULL;
+    parse_t ps = { value, value + buffer_length };
+    /* Like cJSON, a NUL inside the buffer ends the input */
+    const char *nul = memchr(value, '\0', buffer_length);
+    if (nul) ps.end = nul;
+    return parse_value(&ps, 0);
+}
+
+cJSON *cJSON_Parse(const char *value)
+{
+    return value ? cJSON_ParseWithLength(value, strlen(value) + 1) : NULL;
+}
+
+/* ── Printer ────────────────────────────────────────────────────── */
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+    int fail;
+} out_t;
+
+static void put(out_t *o, const char *s, size_t n)
+{
+    if (o->fail) return;
+    if (o->len + n + 1 > o->cap) {
+        size_t cap = o->cap ? o->cap : 256;
+        while (o->len + n + 1 > cap) cap *= 2;
+        char *b = s_malloc(cap);
+        if (!b) {
+            o->fail = 1;
+            return;
+        }
+        if (o->buf) memcpy(b, o->buf, o->len);
+        s_free(o->buf);
+        o->buf = b;
+        o->cap = cap;
+    }
+    memcpy(o->buf + o->len, s, n);
+    o->len += n;
+    o->buf[o->len] = '\0';
+}
+
+static void put_str(out_t *o, const char *s)
+{
+    put(o, s, strlen(s));
+}
+
+static void print_string(out_t *o, const char *s)
+{
+    put(o, "\"", 1);
+    for (; s && *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        char esc[8];
+        switch (c) {
+        case '"':  put_str(o, "\\\""); break;
+        case '\\': put_str(o, "\\\\"); break;
+        case '\b': put_str(o, "\\b"); break;
+        case '\f': put_str(o, "\\f"); break;
+        case '\n': put_str(o, "\\n"); break;
+        case '\r': put_str(o, "\\r"); break;
+        case '\t': put_str(o, "\\t"); break;
+        default:
+            if (c < 0x20) {
+                snprintf(esc, sizeof(esc), "\\u%04x", c);
+                put_str(o, esc);
+            } else {
+                put(o, (const char *)&c, 1);
+            }
+            break;
+        }
+    }
+    put(o, "\"", 1);
+}
+
+static void print_number(out_t *o, const cJSON *item)
+{
+    char num[32];
+    double d = item->valuedouble;
+    if (isnan(d) || isinf(d)) {
+        snprintf(num, sizeof(num), "null");
+    } else if (d == (double)item->valueint) {
+        snprintf(num, sizeof(num), "%d", item->valueint);
+    } else {
+        snprintf(num, sizeof(num), "%1.15g", d);
+        double check = 0;
+        if (sscanf(num, "%lg", &check) != 1 || check != d) {
+            snprintf(num, sizeof(num), "%1.17g", d);
+        }
+    }
+    put_str(o, num);
+}
+
+static void indent(out_t *o, int depth)
+{
+    for (int i = 0; i < depth; i++) put(o, "\t", 1);
+}
+
+static void print_value(out_t *o, const cJSON *item, int fmt, int depth)
+{
+    switch (item->type & 0xFF) {
+    case cJSON_False: put_str(o, "false"); break;
+    case cJSON_True: put_str(o, "true"); break;
+    case cJSON_NULL: put_str(o, "null"); break;
+    case cJSON_Number: print_number(o, item); break;
+    case cJSON_String: print_string(o, item->valuestring ? item->valuestring : ""); break;
+    case cJSON_Raw: if (item->valuestring) put_str(o, item->valuestring); break;
+    case cJSON_Array:
+    case cJSON_Object: {
+        int object = (item->type & 0xFF) == cJSON_Object;
+        put(o, object ? "{" : "[", 1);
+        if (fmt && object) put(o, "\n", 1);
+        for (const cJSON *c = item->child; c; c = c->next) {
+            if (fmt && object) indent(o, depth + 1);
+            if (object) {
+                print_string(o, c->string ? c->string : "");
+                put_str(o, fmt ? ":\t" : ":");
+            }
+            print_value(o, c, fmt, depth + 1);
+            if (c->next) put_str(o, fmt && !object ? ", " : ",");
+            if (fmt && object) put(o, "\n", 1);
+        }
+        if (fmt && object) indent(o, depth);
+        put(o, object ? "}" : "]", 1);
+        break;
+    }
+    default:
+        o->fail = 1;
+        break;
+    }
+}
+
+static char *print(const cJSON *item, int fmt)
+{
+    if (!item) return NULL;
+    out_t o = {0};
+    print_value(&o, item, fmt, 0);
+    if (o.fail) {
+        s_free(o.buf);
+        return NULL;
+    }
+    return o.buf;
+}
+
+char *cJSON_Print(const cJSON *item)
+{
+    return print(item, 1);
+}
+
+char *cJSON_PrintUnformatted(const cJSON *item)
+{
+    return print(item, 0);
+}
+
+/* ── Access ─────────────────────────────────────────────────────── */
+
+int cJSON_GetArraySize(const cJSON *array)
+{
+    int n = 0;
+    for (const cJSON *c = array ? array->child : NULL; c; c = c->next) n++;
+    return n;
+}
+
+cJSON *cJSON_GetArrayItem(const cJSON *array, int index)
+{
+    if (index < 0) return NULL;
+    cJSON *c = array ? array->child : NULL;
+    while (c && index-- > 0) c = c->next;
+    return c;
+}
+
+static cJSON *get_object_item(const cJSON *object, const char *name, int case_sensitive)
+{
+    if (!object || !name) return NULL;
+    for (cJSON *c = object->child; c; c = c->next) {
+        if (!c->string) continue;
+        if (case_sensitive ? strcmp(c->string, name) == 0 : strcasecmp(c->string, name) == 0) {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string)
+{
+    return get_object_item(object, string, 0);
+}
+
+cJSON *cJSON_GetObjectItemCaseSensitive(const cJSON *object, const char *string)
+{
+    return get_object_item(object, string, 1);
+}
+
+cJSON_bool cJSON_HasObjectItem(const cJSON *object, const char *string)
+{
+    return cJSON_GetObjectItem(object, string) != NULL;
+}
+
+char *cJSON_GetStringValue(const cJSON *item)
+{
+    return cJSON_IsString(item) ? item->valuestring : NULL;
+}
+
+double cJSON_GetNumberValue(const cJSON *item)
+{
+    return cJSON_IsNumber(item) ? item->valuedouble : NAN;
+}
+
+#define TYPE_IS(item, t) ((item) != NULL && ((item)->type & 0xFF) == (t))
+
+cJSON_bool cJSON_IsInvalid(const cJSON *item) { return TYPE_IS(item, cJSON_Invalid); }
+cJSON_bool cJSON_IsFalse(const cJSON *item)   { return TYPE_IS(item, cJSON_False); }
+cJSON_bool cJSON_IsTrue(const cJSON *item)    { return TYPE_IS(item, cJSON_True); }
+cJSON_bool cJSON_IsBool(const cJSON *item)    { return item && (item->type & (cJSON_True | cJSON_False)); }
+cJSON_bool cJSON_IsNull(const cJSON *item)    { return TYPE_IS(item, cJSON_NULL); }
+cJSON_bool cJSON_IsNumber(const cJSON *item)  { return TYPE_IS(item, cJSON_Number); }
+cJSON_bool cJSON_IsString(const cJSON *item)  { return TYPE_IS(item, cJSON_String); }
+cJSON_bool cJSON_IsArray(const cJSON *item)   { return TYPE_IS(item, cJSON_Array); }
+cJSON_bool cJSON_IsObject(const cJSON *item)  { return TYPE_IS(item, cJSON_Object); }
+cJSON_bool cJSON_IsRaw(const cJSON *item)     { return TYPE_IS(item, cJSON_Raw); }
+
+/* ── Construction ───────────────────────────────────────────────── */
+
+cJSON *cJSON_CreateNull(void)   { return new_item(cJSON_NULL); }
+cJSON *cJSON_CreateTrue(void)   { return new_item(cJSON_True); }
+cJSON *cJSON_CreateFalse(void)  { return new_item(cJSON_False); }
+cJSON *cJSON_CreateBool(cJSON_bool b) { return new_item(b ? cJSON_True : cJSON_False); }
+cJSON *cJSON_CreateArray(void)  { return new_item(cJSON_Array); }
+cJSON *cJSON_CreateObject(void) { return new_item(cJSON_Object); }
+
+double cJSON_SetNumberHelper(cJSON *object, double number)
+{
+    if (number >= INT_MAX) object->valueint = INT_MAX;
+    else if (number <= (double)INT_MIN) object->valueint = INT_MIN;
+    else object->valueint = (int)number;
+    return object->valuedouble = number;
+}
+
+cJSON *cJSON_CreateNumber(double num)
+{
+    cJSON *item = new_item(cJSON_Number);
+    if (item) cJSON_SetNumberHelper(item, num);
+    return item;
+}
+
+static cJSON *create_text(int type, const char *s)
+{
+    cJSON *item = new_item(type);
+    if (!item) return NULL;
+    item->valuestring = dup_str(s ? s : "");
+    if (!item->valuestring) {
+        cJSON_Delete(item);
+        return NULL;
+    }
+    return item;
+}
+
+cJSON *cJSON_CreateString(const char *string) { return string ? create_text(cJSON_String, string) : NULL; }
+cJSON *cJSON_CreateRaw(const char *raw)       { return create_text(cJSON_Raw, raw); }
+
+cJSON_bool cJSON_AddItemToArray(cJSON *array, cJSON *item)
+{
+    if (!array || !item || array == item) return 0;
+    item->next = NULL;
+    if (!array->child) {
+        array->child = item;
+        item->prev = item;
+    } else {
+        cJSON *last = array->child->prev;
+        last->next = item;
+        item->prev = last;
+        array->child->prev = item;
+    }
+    return 1;
+}
+
+cJSON_bool cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item)
+{
+    if (!object || !string || !item) return 0;
+    char *key = dup_str(string);
+    if (!key) return 0;
+    if (!(item->type & cJSON_StringIsConst)) s_free(item->string);
+    item->string = key;
+    item->type &= ~cJSON_StringIsConst;
+    return cJSON_AddItemToArray(object, item);
+}
+
+static cJSON *detach(cJSON *parent, cJSON *item)
+{
+    if (!parent || !item) return NULL;
+    if (item != parent->child) item->prev->next = item->next;
+    if (item->next) item->next->prev = item->prev;
+    if (item == parent->child) {
+        parent->child = item->next;
+    } else if (!item->next) {
+        parent->child->prev = item->prev;
+    }
+    item->prev = NULL;
+    item->next = NULL;
+    return item;
+}
+
+cJSON *cJSON_DetachItemFromArray(cJSON *array, int which)
+{
+    return detach(array, cJSON_GetArrayItem(array, which));
+}
+
+void cJSON_DeleteItemFromArray(cJSON *array, int which)
+{
+    cJSON_Delete(cJSON_DetachItemFromArray(array, which));
+}
+
+cJSON *cJSON_DetachItemFromObject(cJSON *object, const char *string)
+{
+    return detach(object, cJSON_GetObjectItem(object, string));
+}
+
+void cJSON_DeleteItemFromObject(cJSON *object, const char *string)
+{
+    cJSON_Delete(cJSON_DetachItemFromObject(object, string));
+}
+
+cJSON_bool cJSON_InsertItemInArray(cJSON *array, int which, cJSON *newitem)
+{
+    cJSON *after = cJSON_GetArrayItem(array, which);
+    if (!after) return cJSON_AddItemToArray(array, newitem);
+    if (!newitem) return 0;
+    newitem->next = after;
+    newitem->prev = after->prev;
+    after->prev = newitem;
+    if (after == array->child) array->child = newitem;
+    else newitem->prev->next = newitem;
+    return 1;
+}
+
+static cJSON_bool replace(cJSON *parent, cJSON *item, cJSON *replacement)
+{
+    if (!parent || !item || !replacement) return 0;
+    replacement->next = item->next;
+    replacement->prev = item->prev;
+    if (replacement->next) replacement->next->prev = replacement;
+    if (parent->child == item) {
+        if (parent->child->prev == parent->child) replacement->prev = replacement;
+        parent->child = replacement;
+    } else {
+        if (replacement->prev) replacement->prev->next = replacement;
+        if (!replacement->next) parent->child->prev = replacement;
+    }
+    item->next = NULL;
+    item->prev = NULL;
+    cJSON_Delete(item);
+    return 1;
+}
+
+cJSON_bool cJSON_ReplaceItemInArray(cJSON *array, int which, cJSON *newitem)
+{
+    return replace(array, cJSON_GetArrayItem(array, which), newitem);
+}
+
+cJSON_bool cJSON_ReplaceItemInObject(cJSON *object, const char *string, cJSON *newitem)
+{
+    if (!newitem || !string) return 0;
+    char *key = dup_str(string);
+    if (!key) return 0;
+    if (!(newitem->type & cJSON_StringIsConst)) s_free(newitem->string);
+    newitem->string = key;
+    newitem->type &= ~cJSON_StringIsConst;
+    return replace(object, cJSON_GetObjectItem(object, string), newitem);
+}
+
+cJSON *cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
+{
+    if (!item) return NULL;
+    cJSON *copy = new_item(item->type & ~cJSON_IsReference);
+    if (!copy) return NULL;
+    copy->valueint = item->valueint;
+    copy->valuedouble = item->valuedouble;
+    if (item->valuestring) copy->valuestring = dup_str(item->valuestring);
+    if (item->string) {
+        copy->string = (item->type & cJSON_StringIsConst) ? item->string : dup_str(item->string);
+    }
+    if (recurse) {
+        for (const cJSON *c = item->child; c; c = c->next) {
+            cJSON *cc = cJSON_Duplicate(c, 1);
+            if (!cc) {
+                cJSON_Delete(copy);
+                return NULL;
+            }
+            cJSON_AddItemToArray(copy, cc);
+        }
+    }
+    return copy;
+}
+
+static cJSON *add(cJSON *object, const char *name, cJSON *item)
+{
+    if (cJSON_AddItemToObject(object, name, item)) return item;
+    cJSON_Delete(item);
+    return NULL;
+}
+
+cJSON *cJSON_AddNullToObject(cJSON *o, const char *n)            { return add(o, n, cJSON_CreateNull()); }
+cJSON *cJSON_AddTrueToObject(cJSON *o, const char *n)            { return add(o, n, cJSON_CreateTrue()); }
+cJSON *cJSON_AddFalseToObject(cJSON *o, const char *n)           { return add(o, n, cJSON_CreateFalse()); }
+cJSON *cJSON_AddBoolToObject(cJSON *o, const char *n, cJSON_bool b) { return add(o, n, cJSON_CreateBool(b)); }
+cJSON *cJSON_AddNumberToObject(cJSON *o, const char *n, double d)   { return add(o, n, cJSON_CreateNumber(d)); }
+cJSON *cJSON_AddStringToObject(cJSON *o, const char *n, const char *s) { return add(o, n, cJSON_CreateString(s)); }
+cJSON *cJSON_AddRawToObject(cJSON *o, const char *n, const char *r) { return add(o, n, cJSON_CreateRaw(r)); }
+cJSON *cJSON_AddObjectToObject(cJSON *o, const char *n)          { return add(o, n, cJSON_CreateObject()); }
+cJSON *cJSON_AddArrayToObject(cJSON *o, const char *n)           { return add(o, n, cJSON_CreateArray()); }
@@ -0,0 +1,114 @@
+#pragma once
+
+/*
+ * Host stand-in for the cJSON component: the same types, type bits and
+ * output format (unformatted printing, number rules, escaping) for the
+ * subset of the API the firmware uses. Not a general-purpose parser.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define cJSON_Invalid   (0)
+#define cJSON_False     (1 << 0)
+#define cJSON_True      (1 << 1)
+#define cJSON_NULL      (1 << 2)
+#define cJSON_Number    (1 << 3)
+#define cJSON_String    (1 << 4)
+#define cJSON_Array     (1 << 5)
+#define cJSON_Object    (1 << 6)
+#define cJSON_Raw       (1 << 7)
+
+#define cJSON_IsReference   256
+#define cJSON_StringIsConst 512
+
+typedef struct cJSON {
+    struct cJSON *next;
+    struct cJSON *prev;
+    struct cJSON *child;
+    int type;
+    char *valuestring;
+    int valueint;
+    double valuedouble;
+    char *string;
+} cJSON;
+
+typedef struct cJSON_Hooks {
+    void *(*malloc_fn)(size_t sz);
+    void (*free_fn)(void *ptr);
+} cJSON_Hooks;
+
+typedef int cJSON_bool;
+
+void cJSON_InitHooks(cJSON_Hooks *hooks);
+
+cJSON *cJSON_Parse(const char *value);
+cJSON *cJSON_ParseWithLength(const char *value, size_t buffer_length);
+char *cJSON_Print(const cJSON *item);
+char *cJSON_PrintUnformatted(const cJSON *item);
+void cJSON_Delete(cJSON *item);
+void cJSON_free(void *object);
+
+int cJSON_GetArraySize(const cJSON *array);
+cJSON *cJSON_GetArrayItem(const cJSON *array, int index);
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string);
+cJSON *cJSON_GetObjectItemCaseSensitive(const cJSON *object, const char *string);
+cJSON_bool cJSON_HasObjectItem(const cJSON *object, const char *string);
+char *cJSON_GetStringValue(const cJSON *item);
+double cJSON_GetNumberValue(const cJSON *item);
+
+cJSON_bool cJSON_IsInvalid(const cJSON *item);
+cJSON_bool cJSON_IsFalse(const cJSON *item);
+cJSON_bool cJSON_IsTrue(const cJSON *item);
+cJSON_bool cJSON_IsBool(const cJSON *item);
+cJSON_bool cJSON_IsNull(const cJSON *item);
+cJSON_bool cJSON_IsNumber(const cJSON *item);
+cJSON_bool cJSON_IsString(const cJSON *item);
+cJSON_bool cJSON_IsArray(const cJSON *item);
+cJSON_bool cJSON_IsObject(const cJSON *item);
+cJSON_bool cJSON_IsRaw(const cJSON *item);
+
+cJSON *cJSON_CreateNull(void);
+cJSON *cJSON_CreateTrue(void);
+cJSON *cJSON_CreateFalse(void);
+cJSON *cJSON_CreateBool(cJSON_bool boolean);
+cJSON *cJSON_CreateNumber(double num);
+cJSON *cJSON_CreateString(const char *string);
+cJSON *cJSON_CreateRaw(const char *raw);
+cJSON *cJSON_CreateArray(void);
+cJSON *cJSON_CreateObject(void);
+
+cJSON_bool cJSON_AddItemToArray(cJSON *array, cJSON *item);
+cJSON_bool cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item);
+cJSON *cJSON_DetachItemFromArray(cJSON *array, int which);
+void cJSON_DeleteItemFromArray(cJSON *array, int which);
+cJSON *cJSON_DetachItemFromObject(cJSON *object, const char *string);
+void cJSON_DeleteItemFromObject(cJSON *object, const char *string);
+cJSON_bool cJSON_InsertItemInArray(cJSON *array, int which, cJSON *newitem);
+cJSON_bool cJSON_ReplaceItemInArray(cJSON *array, int which, cJSON *newitem);
+cJSON_bool cJSON_ReplaceItemInObject(cJSON *object, const char *string, cJSON *newitem);
+cJSON *cJSON_Duplicate(const cJSON *item, cJSON_bool recurse);
+
+cJSON *cJSON_AddNullToObject(cJSON *object, const char *name);
+cJSON *cJSON_AddTrueToObject(cJSON *object, const char *name);
+cJSON *cJSON_AddFalseToObject(cJSON *object, const char *name);
+cJSON *cJSON_AddBoolToObject(cJSON *object, const char *name, cJSON_bool boolean);
+cJSON *cJSON_AddNumberToObject(cJSON *object, const char *name, double number);
+cJSON *cJSON_AddStringToObject(cJSON *object, const char *name, const char *string);
+cJSON *cJSON_AddRawToObject(cJSON *object, const char *name, const char *raw);
+cJSON *cJSON_AddObjectToObject(cJSON *object, const char *name);
+cJSON *cJSON_AddArrayToObject(cJSON *object, const char *name);
+
+double cJSON_SetNumberHelper(cJSON *object, double number);
+#define cJSON_SetIntValue(object, number) ((object) ? (object)->valueint = (object)->valuedouble = (number) : (number))
+#define cJSON_SetNumberValue(object, number) ((object != NULL) ? cJSON_SetNumberHelper(object, (double)number) : (number))
+
+#define cJSON_ArrayForEach(element, array) \
+    for (element = (array != NULL) ? (array)->child : NULL; element != NULL; element = element->next)
+
+#ifdef __cplusplus
+}
+#endif
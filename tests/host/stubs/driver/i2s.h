@@ -0,0 +1,7 @@
+#pragma once
+
+/* Port numbers audio/audio.h names; nothing on the host drives I2S */
+typedef enum {
+    I2S_NUM_0 = 0,
+    I2S_NUM_1,
+} i2s_port_t;
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "esp_err.h"
+
+/* Host builds never verify certificates; the fake transport has no TLS */
+static inline esp_err_t esp_crt_bundle_attach(void *conf) { (void)conf; return ESP_OK; }
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_EXEC     (1 << 0)
+#define MALLOC_CAP_32BIT    (1 << 1)
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+
+static inline void *heap_caps_malloc(size_t size, unsigned caps) { (void)caps; return malloc(size); }
+static inline void *heap_caps_calloc(size_t n, size_t size, unsigned caps) { (void)caps; return calloc(n, size); }
+static inline void *heap_caps_realloc(void *p, size_t size, unsigned caps) { (void)caps; return realloc(p, size); }
+static inline void heap_caps_free(void *p) { free(p); }
+static inline void *heap_caps_aligned_alloc(size_t align, size_t size, unsigned caps)
+{
+    (void)caps;
+    return aligned_alloc(align, (size + align - 1) / align * align);
+}
+static inline size_t heap_caps_get_free_size(unsigned caps) { (void)caps; return 8 * 1024 * 1024; }
+static inline size_t heap_caps_get_largest_free_block(unsigned caps) { (void)caps; return 4 * 1024 * 1024; }
+static inline size_t heap_caps_get_minimum_free_size(unsigned caps) { (void)caps; return 4 * 1024 * 1024; }
+
+typedef struct {
+    size_t total_free_bytes;
+    size_t total_allocated_bytes;
+    size_t largest_free_block;
+    size_t minimum_free_bytes;
+    size_t allocated_blocks;
+    size_t free_blocks;
+    size_t total_blocks;
+} multi_heap_info_t;
+
+static inline void heap_caps_get_info(multi_heap_info_t *info, unsigned caps)
+{
+    (void)caps;
+    *info = (multi_heap_info_t){
+        .total_free_bytes = 8 * 1024 * 1024,
+        .largest_free_block = 4 * 1024 * 1024,
+        .minimum_free_bytes = 4 * 1024 * 1024,
+    };
+}
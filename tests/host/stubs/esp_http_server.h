@@ -0,0 +1,4 @@
+#pragma once
+
+/* Only the handle type; host tests do not serve HTTP */
+typedef void *httpd_handle_t;
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdio.h>
+
+/* Warnings and errors go to stderr; info and debug only with HOST_LOG=1
+ * in the environment, so test output stays readable. */
+int host_log_enabled(char level);
+
+#define ESP_LOG_AT(level, tag, fmt, ...) do {                               \
+        if (host_log_enabled(level))                                        \
+            fprintf(stderr, "%c (%s) " fmt "\n", level, tag, ##__VA_ARGS__); \
+    } while (0)
+
+#define ESP_LOGE(tag, fmt, ...) ESP_LOG_AT('E', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) ESP_LOG_AT('W', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ESP_LOG_AT('I', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) ESP_LOG_AT('D', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) ESP_LOG_AT('V', tag, fmt, ##__VA_ARGS__)
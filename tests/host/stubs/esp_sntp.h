@@ -0,0 +1,14 @@
+#pragma once
+
+/* SNTP that only records being started; the host clock is already set */
+
+#include <stdbool.h>
+
+#define SNTP_OPMODE_POLL 0
+
+static bool host_sntp_running;
+
+static inline bool esp_sntp_enabled(void) { return host_sntp_running; }
+static inline void esp_sntp_setoperatingmode(int mode) { (void)mode; }
+static inline void esp_sntp_setservername(int idx, const char *server) { (void)idx; (void)server; }
+static inline void esp_sntp_init(void) { host_sntp_running = true; }
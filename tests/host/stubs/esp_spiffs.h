@@ -0,0 +1,19 @@
+#pragma once
+
+/* SPIFFS mount API; the partition behind it is fakes/fake_flash.c */
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    const char *base_path;
+    const char *partition_label;
+    size_t max_files;
+    bool format_if_mount_failed;
+} esp_vfs_spiffs_conf_t;
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t *conf);
+esp_err_t esp_vfs_spiffs_unregister(const char *partition_label);
+esp_err_t esp_spiffs_info(const char *partition_label, size_t *total, size_t *used);
+esp_err_t esp_spiffs_gc(const char *partition_label, size_t size_to_gc);
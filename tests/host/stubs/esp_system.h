@@ -0,0 +1,13 @@
+#pragma once
+#include "esp_err.h"
+#include "esp_random.h"
+#include <stdlib.h>
+
+typedef void (*shutdown_handler_t)(void);
+
+/* Handlers run by esp_restart() and host_shutdown(), newest first */
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler);
+void host_shutdown(void);
+
+static inline void esp_restart(void) { host_shutdown(); abort(); }
+static inline uint32_t esp_get_free_heap_size(void) { return 8 * 1024 * 1024; }
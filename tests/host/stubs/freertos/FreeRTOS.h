@@ -0,0 +1,55 @@
+#pragma once
+
+/* Host stand-in for FreeRTOS on pthreads: one tick is one millisecond. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdTRUE          1
+#define pdFALSE         0
+#define pdPASS          1
+#define pdFAIL          0
+#define errQUEUE_FULL   0
+#define portMAX_DELAY   0xffffffffu
+#define portTICK_PERIOD_MS  1
+#define configTICK_RATE_HZ  1000
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+#define tskNO_AFFINITY  0x7fffffff
+
+#define portMUX_INITIALIZER_UNLOCKED 0
+typedef int portMUX_TYPE;
+#define portENTER_CRITICAL(m)   ((void)(m))
+#define portEXIT_CRITICAL(m)    ((void)(m))
+
+/* Absolute deadline for a timed wait */
+static inline struct timespec rtos_deadline(TickType_t ms)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    if (ms == portMAX_DELAY) {
+        ts.tv_sec += 1000000;
+        return ts;
+    }
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static inline TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static inline BaseType_t xPortGetCoreID(void) { return 0; }
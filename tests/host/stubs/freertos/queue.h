@@ -0,0 +1,108 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct rtos_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t cap;
+    size_t item_size;
+    size_t head;
+    size_t count;
+    unsigned char *buf;
+} *QueueHandle_t;
+
+static inline QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size)
+{
+    QueueHandle_t q = (QueueHandle_t)calloc(1, sizeof(*q));
+    if (!q) return NULL;
+    q->buf = (unsigned char *)malloc((size_t)len * item_size);
+    if (!q->buf) {
+        free(q);
+        return NULL;
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    q->cap = len;
+    q->item_size = item_size;
+    return q;
+}
+
+static inline void vQueueDelete(QueueHandle_t q)
+{
+    if (!q) return;
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->cond);
+    free(q->buf);
+    free(q);
+}
+
+static inline BaseType_t rtos_queue_put(QueueHandle_t q, const void *item, TickType_t ticks, int front)
+{
+    struct timespec dl = rtos_deadline(ticks);
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->cap && ticks != 0) {
+        if (pthread_cond_timedwait(&q->cond, &q->lock, &dl) != 0) break;
+    }
+    BaseType_t ok = q->count < q->cap;
+    if (ok) {
+        size_t slot;
+        if (front) {
+            q->head = (q->head + q->cap - 1) % q->cap;
+            slot = q->head;
+        } else {
+            slot = (q->head + q->count) % q->cap;
+        }
+        memcpy(q->buf + slot * q->item_size, item, q->item_size);
+        q->count++;
+        pthread_cond_broadcast(&q->cond);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok;
+}
+
+#define xQueueSend(q, item, ticks)          rtos_queue_put((q), (item), (ticks), 0)
+#define xQueueSendToBack(q, item, ticks)    rtos_queue_put((q), (item), (ticks), 0)
+#define xQueueSendToFront(q, item, ticks)   rtos_queue_put((q), (item), (ticks), 1)
+
+static inline BaseType_t rtos_queue_get(QueueHandle_t q, void *item, TickType_t ticks, int peek)
+{
+    struct timespec dl = rtos_deadline(ticks);
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && ticks != 0) {
+        if (pthread_cond_timedwait(&q->cond, &q->lock, &dl) != 0) break;
+    }
+    BaseType_t ok = q->count > 0;
+    if (ok) {
+        memcpy(item, q->buf + q->head * q->item_size, q->item_size);
+        if (!peek) {
+            q->head = (q->head + 1) % q->cap;
+            q->count--;
+            pthread_cond_broadcast(&q->cond);
+        }
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok;
+}
+
+#define xQueueReceive(q, item, ticks)   rtos_queue_get((q), (item), (ticks), 0)
+#define xQueuePeek(q, item, ticks)      rtos_queue_get((q), (item), (ticks), 1)
+
+static inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = (UBaseType_t)q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+static inline UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = (UBaseType_t)(q->cap - q->count);
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
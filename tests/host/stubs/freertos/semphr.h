@@ -0,0 +1,99 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+/* Mutexes, binary and counting semaphores are all a counter under a
+ * condition variable; a mutex is a binary semaphore that starts given.
+ * Recursive mutexes track their owner. */
+typedef struct rtos_sem {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    UBaseType_t count;
+    UBaseType_t max;
+    pthread_t owner;
+    UBaseType_t depth;
+} *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t rtos_sem_create(UBaseType_t max, UBaseType_t initial)
+{
+    SemaphoreHandle_t s = (SemaphoreHandle_t)calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    s->max = max;
+    s->count = initial;
+    return s;
+}
+
+#define xSemaphoreCreateMutex()                 rtos_sem_create(1, 1)
+#define xSemaphoreCreateRecursiveMutex()        rtos_sem_create(1, 1)
+#define xSemaphoreCreateBinary()                rtos_sem_create(1, 0)
+#define xSemaphoreCreateCounting(max, initial)  rtos_sem_create((max), (initial))
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t s)
+{
+    if (!s) return;
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->cond);
+    free(s);
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks)
+{
+    struct timespec dl = rtos_deadline(ticks);
+    pthread_mutex_lock(&s->lock);
+    while (s->count == 0 && ticks != 0) {
+        if (pthread_cond_timedwait(&s->cond, &s->lock, &dl) != 0) break;
+    }
+    BaseType_t ok = s->count > 0;
+    if (ok) s->count--;
+    pthread_mutex_unlock(&s->lock);
+    return ok;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+    pthread_mutex_lock(&s->lock);
+    BaseType_t ok = s->count < s->max;
+    if (ok) {
+        s->count++;
+        pthread_cond_signal(&s->cond);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return ok;
+}
+
+static inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t s, TickType_t ticks)
+{
+    pthread_mutex_lock(&s->lock);
+    if (s->depth > 0 && pthread_equal(s->owner, pthread_self())) {
+        s->depth++;
+        pthread_mutex_unlock(&s->lock);
+        return pdTRUE;
+    }
+    pthread_mutex_unlock(&s->lock);
+    if (!xSemaphoreTake(s, ticks)) return pdFALSE;
+    pthread_mutex_lock(&s->lock);
+    s->owner = pthread_self();
+    s->depth = 1;
+    pthread_mutex_unlock(&s->lock);
+    return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t s)
+{
+    pthread_mutex_lock(&s->lock);
+    UBaseType_t depth = --s->depth;
+    pthread_mutex_unlock(&s->lock);
+    return depth == 0 ? xSemaphoreGive(s) : pdTRUE;
+}
+
+static inline UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t s)
+{
+    pthread_mutex_lock(&s->lock);
+    UBaseType_t n = s->count;
+    pthread_mutex_unlock(&s->lock);
+    return n;
+}
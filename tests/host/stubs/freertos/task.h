@@ -0,0 +1,120 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct rtos_task {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify;
+    void (*fn)(void *);
+    void *arg;
+} *TaskHandle_t;
+
+extern __thread TaskHandle_t rtos_current_task;
+
+static inline void *rtos_task_entry(void *p)
+{
+    TaskHandle_t t = (TaskHandle_t)p;
+    rtos_current_task = t;
+    t->fn(t->arg);
+    return NULL;
+}
+
+static inline BaseType_t xTaskCreatePinnedToCore(void (*fn)(void *), const char *name,
+                                                 uint32_t stack, void *arg, UBaseType_t prio,
+                                                 TaskHandle_t *out, BaseType_t core)
+{
+    (void)name; (void)prio; (void)core;
+    TaskHandle_t t = (TaskHandle_t)calloc(1, sizeof(*t));
+    if (!t) return pdFAIL;
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->cond, NULL);
+    t->fn = fn;
+    t->arg = arg;
+    if (out) *out = t;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, stack < 65536 ? 65536 : stack);
+    int rc = pthread_create(&t->thread, &attr, rtos_task_entry, t);
+    pthread_attr_destroy(&attr);
+    return rc == 0 ? pdPASS : pdFAIL;
+}
+
+static inline BaseType_t xTaskCreate(void (*fn)(void *), const char *name, uint32_t stack,
+                                     void *arg, UBaseType_t prio, TaskHandle_t *out)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, out, tskNO_AFFINITY);
+}
+
+/* Threads not started through xTaskCreate (main) get a handle on first use */
+static inline TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (!rtos_current_task) {
+        TaskHandle_t t = (TaskHandle_t)calloc(1, sizeof(*t));
+        pthread_mutex_init(&t->lock, NULL);
+        pthread_cond_init(&t->cond, NULL);
+        t->thread = pthread_self();
+        rtos_current_task = t;
+    }
+    return rtos_current_task;
+}
+
+static inline void vTaskDelay(TickType_t ticks)
+{
+    if (ticks == 0) sched_yield();
+    else usleep((useconds_t)ticks * 1000);
+}
+
+/* A task deleting itself frees its handle, as FreeRTOS frees the TCB */
+static inline void vTaskDelete(TaskHandle_t t)
+{
+    if (t && t != rtos_current_task) return;
+    t = rtos_current_task;
+    rtos_current_task = NULL;
+    if (t) {
+        pthread_mutex_destroy(&t->lock);
+        pthread_cond_destroy(&t->cond);
+        free(t);
+    }
+    pthread_exit(NULL);
+}
+
+static inline void taskYIELD(void)
+{
+    sched_yield();
+}
+
+static inline void xTaskNotifyGive(TaskHandle_t t)
+{
+    pthread_mutex_lock(&t->lock);
+    t->notify++;
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+}
+
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    TaskHandle_t t = xTaskGetCurrentTaskHandle();
+    struct timespec dl = rtos_deadline(ticks);
+    pthread_mutex_lock(&t->lock);
+    while (t->notify == 0 && ticks != 0) {
+        if (pthread_cond_timedwait(&t->cond, &t->lock, &dl) != 0) break;
+    }
+    uint32_t n = t->notify;
+    if (n) t->notify = clear ? 0 : n - 1;
+    pthread_mutex_unlock(&t->lock);
+    return n;
+}
+
+static inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t t)
+{
+    (void)t;
+    return 4096;
+}
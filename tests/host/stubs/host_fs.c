@@ -0,0 +1,156 @@
+/* Implementation of host_fs.h; calls the real functions underneath. */
+#include "host_fs.h"
+
+#undef fopen
+#undef remove
+#undef rename
+#undef opendir
+#undef stat
+#undef mkdir
+#undef unlink
+#undef truncate
+#undef access
+#undef fileno
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define FW_ROOT "/spiffs"
+
+static char s_root[256];
+
+const char *host_fs_root(const char *dir)
+{
+    if (dir) {
+        snprintf(s_root, sizeof(s_root), "%s", dir);
+    } else {
+        snprintf(s_root, sizeof(s_root), "/tmp/mimi_host_fs.XXXXXX");
+        if (!mkdtemp(s_root)) {
+            perror("mkdtemp");
+            exit(1);
+        }
+    }
+    return s_root;
+}
+
+/* Each thread maps at most two paths per call (rename), so two
+ * rotating thread-local buffers suffice */
+static const char *map(const char *path)
+{
+    static __thread char bufs[2][512];
+    static __thread int next;
+    size_t n = strlen(FW_ROOT);
+    if (!s_root[0] || strncmp(path, FW_ROOT, n) != 0 || (path[n] != '/' && path[n] != '\0')) {
+        return path;
+    }
+    char *buf = bufs[next++ & 1];
+    snprintf(buf, sizeof(bufs[0]), "%s%s", s_root, path + n);
+    return buf;
+}
+
+const char *host_fs_path(const char *path, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s", map(path));
+    return buf;
+}
+
+/* One armed fault at a time */
+static char s_fault_path[256];
+static long s_fault_bytes;
+
+/* The one stream opened under a fault, and the file underneath */
+static FILE *s_short_stream;
+static FILE *s_short_file;
+static long s_short_left;
+
+void host_fs_fault(const char *path, long bytes)
+{
+    snprintf(s_fault_path, sizeof(s_fault_path), "%s", path);
+    s_fault_bytes = bytes;
+}
+
+static ssize_t short_write(void *cookie, const char *buf, size_t size)
+{
+    (void)cookie;
+    size_t n = size < (size_t)s_short_left ? size : (size_t)s_short_left;
+    if (n && (fwrite(buf, 1, n, s_short_file) != n || fflush(s_short_file) != 0)) n = 0;
+    s_short_left -= (long)n;
+    if (n < size) {
+        errno = EIO;
+        return n ? (ssize_t)n : -1;
+    }
+    return (ssize_t)n;
+}
+
+static ssize_t short_read(void *cookie, char *buf, size_t size)
+{
+    (void)cookie;
+    return (ssize_t)fread(buf, 1, size, s_short_file);
+}
+
+static int short_seek(void *cookie, off64_t *offset, int whence)
+{
+    (void)cookie;
+    if (fseeko(s_short_file, *offset, whence) != 0) return -1;
+    *offset = ftello(s_short_file);
+    return 0;
+}
+
+static int short_close(void *cookie)
+{
+    (void)cookie;
+    int ret = fclose(s_short_file);
+    s_short_stream = NULL;
+    s_short_file = NULL;
+    return ret;
+}
+
+FILE *host_fopen(const char *path, const char *mode)
+{
+    bool writing = strpbrk(mode, "wa+") != NULL;
+    if (!writing || !s_fault_path[0] || strcmp(path, s_fault_path) != 0) {
+        return fopen(map(path), mode);
+    }
+    s_fault_path[0] = '\0';
+    if (s_fault_bytes < 0 || s_short_stream) {
+        errno = EIO;
+        return NULL;
+    }
+    s_short_file = fopen(map(path), mode);
+    if (!s_short_file) return NULL;
+    s_short_left = s_fault_bytes;
+    s_short_stream = fopencookie(NULL, mode, (cookie_io_functions_t){
+        .read = short_read, .write = short_write, .seek = short_seek, .close = short_close,
+    });
+    return s_short_stream;
+}
+
+/* fsync() on a faulted stream syncs the file underneath */
+int host_fileno(FILE *f)
+{
+    return fileno(f == s_short_stream && f ? s_short_file : f);
+}
+
+/* ── Paths ────────────────────────────────────────────────────── */
+
+
+int host_remove(const char *path) { return remove(map(path)); }
+int host_rename(const char *from, const char *to)
+{
+    const char *a = map(from);
+    const char *b = map(to);
+    return rename(a, b);
+}
+DIR *host_opendir(const char *path) { return opendir(map(path)); }
+int host_stat(const char *path, struct stat *st) { return stat(map(path), st); }
+int host_mkdir(const char *path, mode_t mode) { return mkdir(map(path), mode); }
+int host_unlink(const char *path) { return unlink(map(path)); }
+int host_truncate(const char *path, off_t len) { return truncate(map(path), len); }
+int host_access(const char *path, int mode) { return access(map(path), mode); }
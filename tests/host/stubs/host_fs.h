@@ -0,0 +1,48 @@
+#pragma once
+
+/*
+ * Maps the firmware's /spiffs paths into a scratch directory so modules
+ * that do file I/O run unchanged on the host. Force-included (-include)
+ * by tests that need it: the system headers come first, then the calls
+ * are redirected.
+ */
+
+#include <stdio.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/* Root for /spiffs; a fresh directory under /tmp when NULL. Returns it. */
+const char *host_fs_root(const char *dir);
+
+/* Host path for a firmware path, for tests that inspect files directly */
+const char *host_fs_path(const char *path, char *buf, size_t size);
+
+/* The next fopen() of `path` for writing fails when `bytes` < 0, or
+ * gives a stream that stores `bytes` bytes and then fails every write,
+ * as flash does when power is cut mid-write */
+void host_fs_fault(const char *path, long bytes);
+
+FILE *host_fopen(const char *path, const char *mode);
+int host_fileno(FILE *f);
+int host_remove(const char *path);
+int host_rename(const char *from, const char *to);
+DIR *host_opendir(const char *path);
+int host_stat(const char *path, struct stat *st);
+int host_mkdir(const char *path, mode_t mode);
+int host_unlink(const char *path);
+int host_truncate(const char *path, off_t len);
+int host_access(const char *path, int mode);
+
+#define fopen(p, m)         host_fopen((p), (m))
+#define remove(p)           host_remove(p)
+#define rename(a, b)        host_rename((a), (b))
+#define opendir(p)          host_opendir(p)
+#define stat(p, st)         host_stat((p), (st))
+#define mkdir(p, m)         host_mkdir((p), (m))
+#define unlink(p)           host_unlink(p)
+#define truncate(p, n)      host_truncate((p), (n))
+#define access(p, m)        host_access((p), (m))
+#define fileno(f)           host_fileno(f)
@@ -0,0 +1,61 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+__thread TaskHandle_t rtos_current_task;
+int host_test_failures;
+
+int host_log_enabled(char level)
+{
+    static int verbose = -1;
+    if (verbose < 0) {
+        const char *env = getenv("HOST_LOG");
+        verbose = env && strcmp(env, "0") != 0;
+    }
+    return verbose || level == 'E' || level == 'W';
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+    default: return "ESP_ERR_UNKNOWN";
+    }
+}
+
+/* As in ESP-IDF: a handful of slots, no duplicates, run newest first */
+static shutdown_handler_t s_shutdown_handlers[5];
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler)
+{
+    for (int i = 0; i < 5; i++) {
+        if (s_shutdown_handlers[i] == handler) return ESP_ERR_INVALID_STATE;
+        if (!s_shutdown_handlers[i]) {
+            s_shutdown_handlers[i] = handler;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void host_shutdown(void)
+{
+    for (int i = 4; i >= 0; i--) {
+        if (s_shutdown_handlers[i]) s_shutdown_handlers[i]();
+    }
+}
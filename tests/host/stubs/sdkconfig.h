@@ -0,0 +1,3 @@
+#pragma once
+
+/* Host builds take CONFIG_* from the Makefile (-D) per test */
@@ -0,0 +1,279 @@
+/*
+ * Agent dispatcher and workers against a fake LLM that sleeps per turn:
+ * a long conversation does not hold up other chats, its backlog stays
+ * visible in the inbox, turns of one chat stay in order, idle workers
+ * take the highest-priority message, and tool outputs from the per-worker
+ * arena are whole. Ends with push-to-reply p50/p99 under a mixed load of
+ * long Telegram turns, short WebSocket turns and cron events, where aging
+ * keeps cron from starving.
+ */
+#include "host_test.h"
+#include "agent/agent_loop.h"
+#include "bus/message_bus.h"
+#include "llm/llm_proxy.h"
+#include "mimi_config.h"
+#include "cJSON.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_IDS 1024
+
+static int64_t s_pushed_us[MAX_IDS];
+static _Atomic int64_t s_started_us[MAX_IDS];
+static _Atomic int64_t s_finished_us[MAX_IDS];
+static _Atomic int64_t s_replied_us[MAX_IDS];
+static atomic_int s_next_id = 1;
+
+/* ── Fake LLM ──────────────────────────────────────────────────── */
+
+/* The newest user message whose content is text, i.e. the turn's prompt */
+static const char *turn_prompt(cJSON *messages)
+{
+    const char *prompt = NULL;
+    cJSON *m;
+    cJSON_ArrayForEach(m, messages) {
+        cJSON *content = cJSON_GetObjectItem(m, "content");
+        if (cJSON_IsString(content)) prompt = content->valuestring;
+    }
+    return prompt;
+}
+
+esp_err_t llm_chat_tools(const char *system_prompt, cJSON *messages,
+                         const char *tools_json, llm_response_t *resp)
+{
+    (void)system_prompt; (void)tools_json;
+    memset(resp, 0, sizeof(*resp));
+
+    const char *prompt = turn_prompt(messages);
+    const char *at = prompt ? strstr(prompt, "id=") : NULL;
+    int id = 0, ms = 0, tools = 0;
+    if (!at || sscanf(at, "id=%d ms=%d tools=%d", &id, &ms, &tools) != 3) return ESP_FAIL;
+
+    cJSON *last = cJSON_GetArrayItem(messages, cJSON_GetArraySize(messages) - 1);
+    cJSON *content = cJSON_GetObjectItem(last, "content");
+    if (cJSON_IsString(content)) {
+        int64_t zero = 0;
+        atomic_compare_exchange_strong(&s_started_us[id], &zero, esp_timer_get_time());
+        if (strstr(prompt, "recall")) {
+            CHECK(strncmp(prompt, "<memory>\nremembered\n</memory>\n\n", 31) == 0);
+        }
+    } else {
+        /* Second round: every tool result came back whole */
+        int results = 0;
+        cJSON *block;
+        cJSON_ArrayForEach(block, content) {
+            CHECK_EQ_STR(cJSON_GetStringValue(cJSON_GetObjectItem(block, "content")), "out:read_file");
+            results++;
+        }
+        CHECK_EQ_INT(results, tools);
+        tools = 0;
+    }
+
+    usleep(ms * 1000);
+
+    if (tools > 0) {
+        resp->tool_use = true;
+        for (int i = 0; i < tools && i < MIMI_MAX_TOOL_CALLS; i++) {
+            llm_tool_call_t *call = &resp->calls[resp->call_count++];
+            snprintf(call->id, sizeof(call->id), "toolu_%d_%d", id, i);
+            snprintf(call->name, sizeof(call->name), "read_file");
+            call->input = strdup("{}");
+            call->input_len = 2;
+        }
+        return ESP_OK;
+    }
+
+    atomic_store(&s_finished_us[id], esp_timer_get_time());
+    char text[32];
+    resp->text_len = snprintf(text, sizeof(text), "reply:%d", id);
+    resp->text = strdup(text);
+    return ESP_OK;
+}
+
+esp_err_t llm_chat_stream(const char *system_prompt, cJSON *messages, const char *tools_json,
+                          void (*on_token)(const char *token, void *ctx), void *ctx,
+                          llm_response_t *resp)
+{
+    (void)on_token; (void)ctx;
+    return llm_chat_tools(system_prompt, messages, tools_json, resp);
+}
+
+/* ── Driver ────────────────────────────────────────────────────── */
+
+static void *outbound_reader(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        mimi_msg_t out;
+        if (message_bus_pop_outbound(&out, UINT32_MAX) != ESP_OK) continue;
+        const char *r = strstr(out.content, "reply:");
+        if (r) {
+            int id = atoi(r + 6);
+            if (id > 0 && id < MAX_IDS) atomic_store(&s_replied_us[id], esp_timer_get_time());
+        }
+        free(out.content);
+    }
+    return NULL;
+}
+
+static int send_msg(const char *channel, const char *chat_id, int ms, int tools, const char *extra)
+{
+    int id = atomic_fetch_add(&s_next_id, 1);
+    char text[96];
+    snprintf(text, sizeof(text), "id=%d ms=%d tools=%d%s", id, ms, tools, extra ? extra : "");
+
+    mimi_msg_t msg = {0};
+    strncpy(msg.channel, channel, sizeof(msg.channel) - 1);
+    strncpy(msg.chat_id, chat_id, sizeof(msg.chat_id) - 1);
+    msg.content = strdup(text);
+    s_pushed_us[id] = esp_timer_get_time();
+    CHECK_EQ_INT(message_bus_push_inbound(&msg), ESP_OK);
+    return id;
+}
+
+static int64_t latency_ms(int id)
+{
+    return (atomic_load(&s_replied_us[id]) - s_pushed_us[id]) / 1000;
+}
+
+static bool wait_replies(int first, int last, int timeout_ms)
+{
+    int64_t deadline = esp_timer_get_time() + timeout_ms * 1000LL;
+    for (int id = first; id <= last; id++) {
+        while (!atomic_load(&s_replied_us[id])) {
+            if (esp_timer_get_time() > deadline) return false;
+            usleep(1000);
+        }
+    }
+    return true;
+}
+
+/* A busy conversation queues up in the inbox, not in a worker, while
+ * other chats keep being served */
+static void test_no_head_of_line_blocking(void)
+{
+    int first = send_msg(MIMI_CHAN_TELEGRAM, "long", 150, 0, NULL);
+    for (int i = 0; i < 5; i++) send_msg(MIMI_CHAN_TELEGRAM, "long", 150, 0, NULL);
+    int ws = send_msg(MIMI_CHAN_WEBSOCKET, "ws1", 10, 0, NULL);
+    int last = ws - 1;
+
+    CHECK(wait_replies(ws, ws, 2000));
+    CHECK(latency_ms(ws) < 120);
+
+    /* The rest of the long chat is still queued, where cron can see it */
+    usleep(20 * 1000);
+    CHECK_EQ_INT(message_bus_inbound_depth(), 5);
+    CHECK(message_bus_inbound_contains(MIMI_CHAN_TELEGRAM, "long"));
+    CHECK(message_bus_inbound_has_channel(MIMI_CHAN_TELEGRAM));
+
+    CHECK(wait_replies(first, last, 5000));
+    for (int id = first; id < last; id++) {
+        /* One at a time and in order */
+        CHECK(atomic_load(&s_started_us[id + 1]) >= atomic_load(&s_finished_us[id]));
+    }
+    CHECK_EQ_INT(message_bus_inbound_depth(), 0);
+}
+
+/* With every worker busy, freed workers take the highest class first */
+static void test_priority_when_workers_free(void)
+{
+    int b = send_msg(MIMI_CHAN_TELEGRAM, "b", 200, 0, NULL);
+    int c = send_msg(MIMI_CHAN_TELEGRAM, "c", 320, 0, NULL);
+    usleep(30 * 1000);
+    int cron = send_msg(MIMI_CHAN_SYSTEM, "cron", 10, 0, NULL);
+    int tg = send_msg(MIMI_CHAN_TELEGRAM, "d", 10, 0, NULL);
+    int ws = send_msg(MIMI_CHAN_WEBSOCKET, "ws2", 10, 0, NULL);
+
+    CHECK(wait_replies(b, ws, 3000));
+    CHECK(atomic_load(&s_started_us[ws]) <= atomic_load(&s_started_us[tg]));
+    CHECK(atomic_load(&s_started_us[tg]) <= atomic_load(&s_started_us[cron]));
+    (void)c;
+}
+
+/* Tool outputs come from the worker arena; several calls per round and
+ * recalled memory in the prompt must all fit without clobbering */
+static void test_tool_turns(void)
+{
+    int first = send_msg(MIMI_CHAN_TELEGRAM, "tools1", 5, MIMI_MAX_TOOL_CALLS, " recall");
+    int last = send_msg(MIMI_CHAN_WEBSOCKET, "tools2", 5, 2, NULL);
+    for (int i = 0; i < 6; i++) last = send_msg(MIMI_CHAN_CLI, "tools3", 1, 1 + i % MIMI_MAX_TOOL_CALLS, " recall");
+    CHECK(wait_replies(first, last, 5000));
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name, int64_t *lat, int n, int64_t *p50, int64_t *p99)
+{
+    qsort(lat, n, sizeof(lat[0]), cmp_i64);
+    *p50 = lat[n / 2];
+    *p99 = lat[(n * 99) / 100 < n ? (n * 99) / 100 : n - 1];
+    BENCH("%-9s n=%3d  p50 %4lld ms  p99 %4lld ms", name, n, (long long)*p50, (long long)*p99);
+}
+
+static void bench_mixed_load(void)
+{
+    enum { TG, WS, CRON, CLASSES };
+    static const char *names[CLASSES] = {"telegram", "websocket", "cron"};
+    int ids[CLASSES][256];
+    int count[CLASSES] = {0};
+    int first = atomic_load(&s_next_id);
+
+    uint32_t seed = 12345;
+    for (int tick = 0; tick < 300; tick++) {          /* 10 ms ticks, 3 s */
+        seed = seed * 1103515245u + 12345u;
+        uint32_t r = (seed >> 16) % 100;
+        char chat[16];
+        if (r < 12) {                                 /* ~4/s, 120 ms turns */
+            snprintf(chat, sizeof(chat), "tg%u", (seed >> 8) % 6);
+            ids[TG][count[TG]++] = send_msg(MIMI_CHAN_TELEGRAM, chat, 120, 0, NULL);
+        } else if (r < 30) {                          /* ~6/s, 15 ms turns */
+            snprintf(chat, sizeof(chat), "ws%u", (seed >> 8) % 3);
+            ids[WS][count[WS]++] = send_msg(MIMI_CHAN_WEBSOCKET, chat, 15, 0, NULL);
+        } else if (r < 35) {                          /* ~1.7/s, 60 ms turns */
+            ids[CRON][count[CRON]++] = send_msg(MIMI_CHAN_SYSTEM, "cron", 60, 0, NULL);
+        }
+        usleep(10 * 1000);
+    }
+    int last = atomic_load(&s_next_id) - 1;
+    CHECK(wait_replies(first, last, 20000));
+
+    int64_t p50[CLASSES], p99[CLASSES];
+    BENCH("mixed load, %d workers, %d LLM slots:", MIMI_AGENT_WORKERS, MIMI_LLM_MAX_INFLIGHT);
+    for (int c = 0; c < CLASSES; c++) {
+        int64_t lat[256];
+        for (int i = 0; i < count[c]; i++) lat[i] = latency_ms(ids[c][i]);
+        report(names[c], lat, count[c], &p50[c], &p99[c]);
+    }
+    /* Short interactive turns are never stuck behind a long chat's backlog */
+    CHECK(p50[WS] < p50[TG]);
+    CHECK(p99[WS] < 400);
+    /* Cron waits out the aging threshold, not the whole chat backlog */
+    CHECK(p50[CRON] < 2 * MIMI_BUS_INBOUND_AGE_MS);
+}
+
+int main(void)
+{
+    CHECK_EQ_INT(message_bus_init(), ESP_OK);
+    CHECK_EQ_INT(agent_loop_init(), ESP_OK);
+    CHECK_EQ_INT(agent_loop_start(), ESP_OK);
+
+    pthread_t reader;
+    pthread_create(&reader, NULL, outbound_reader, NULL);
+
+    test_no_head_of_line_blocking();
+    test_priority_when_workers_free();
+    test_tool_turns();
+    bench_mixed_load();
+    return host_test_result("test_agent_dispatch");
+}
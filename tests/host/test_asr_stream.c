@@ -0,0 +1,237 @@
+/*
+ * Streaming ASR upload against a stand-in server that timestamps every
+ * body chunk: audio goes out while it is still being recorded, speech
+ * during the connection handshake is queued rather than lost, the body
+ * is a well-formed multipart WAV of unknown length holding exactly the
+ * samples written, and the transcript follows the end of speech by the
+ * server's processing time alone. Ends with arrival timings.
+ */
+#include "host_test.h"
+#include "audio/asr_client.h"
+#include "fakes/fake_http_server.h"
+#include "mimi_config.h"
+#include "esp_timer.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RATE        24000
+#define FRAME       512                 /* samples per mic read */
+#define FRAME_US    (FRAME * 1000000LL / RATE)
+
+static const char s_tail[] = "\r\n------Esp32ClawBoundary123456--\r\n";
+
+static int16_t sample_at(size_t i)
+{
+    return (int16_t)(i * 7 + (i >> 9));
+}
+
+/* The PCM inside the received multipart body, after checking the parts
+ * around it; NULL if the framing is wrong */
+static const uint8_t *body_pcm(const fake_http_request_t *req, size_t *len)
+{
+    const char *body = req->body;
+    const char *riff = body ? memmem(body, req->body_len, "RIFF", 4) : NULL;
+    size_t tail = sizeof(s_tail) - 1;
+    CHECK(riff != NULL);
+    if (!riff) return NULL;
+    CHECK(strstr(body, "name=\"model\"\r\n\r\nwhisper-1\r\n") != NULL);
+    CHECK(strstr(body, "filename=\"audio.wav\"\r\nContent-Type: audio/wav\r\n\r\nRIFF") != NULL);
+
+    /* Unknown RIFF and data sizes; 16-bit mono at the recording rate */
+    const uint8_t *h = (const uint8_t *)riff;
+    CHECK(memcmp(h, "RIFF\xff\xff\xff\xff" "WAVEfmt ", 16) == 0);
+    CHECK(memcmp(h + 36, "data\xff\xff\xff\xff", 8) == 0);
+    CHECK_EQ_INT(h[20] | h[21] << 8, 1);
+    CHECK_EQ_INT(h[22] | h[23] << 8, 1);
+    CHECK_EQ_INT(h[24] | h[25] << 8 | h[26] << 16, RATE);
+    CHECK_EQ_INT(h[34], 16);
+
+    size_t before = (size_t)(riff - body) + 44;
+    CHECK(req->body_len >= before + tail);
+    CHECK(memcmp(body + req->body_len - tail, s_tail, tail) == 0);
+    *len = req->body_len - before - tail;
+    return h + 44;
+}
+
+static bool pcm_matches(const uint8_t *pcm, size_t len, size_t samples)
+{
+    if (len != samples * 2) return false;
+    for (size_t i = 0; i < samples; i++) {
+        int16_t v;
+        memcpy(&v, pcm + i * 2, 2);
+        if (v != sample_at(i)) return false;
+    }
+    return true;
+}
+
+typedef struct {
+    int64_t begin_us, end_us, done_us;
+    size_t samples;
+    esp_err_t err;
+    char *text;
+} take_t;
+
+/* Record `ms` of audio paced like the microphone, then finish */
+static void record(int ms, take_t *t)
+{
+    memset(t, 0, sizeof(*t));
+    asr_stream_t *s;
+    t->begin_us = esp_timer_get_time();
+    CHECK_EQ_INT(asr_stream_begin(RATE, &s), ESP_OK);
+
+    int16_t frame[FRAME];
+    size_t frames = (size_t)ms * RATE / 1000 / FRAME;
+    for (size_t f = 0; f < frames; f++) {
+        for (int k = 0; k < FRAME; k++) frame[k] = sample_at(t->samples + k);
+        CHECK_EQ_INT(asr_stream_write(s, frame, FRAME), ESP_OK);
+        t->samples += FRAME;
+        int64_t due = t->begin_us + (int64_t)(f + 1) * FRAME_US;
+        int64_t now = esp_timer_get_time();
+        if (due > now) usleep((useconds_t)(due - now));
+    }
+
+    t->end_us = esp_timer_get_time();
+    t->err = asr_stream_finish(s, &t->text);
+    t->done_us = esp_timer_get_time();
+}
+
+/* Audio bytes (chunks after the multipart head) that arrived by `us` */
+static size_t audio_by(const fake_http_request_t *req, int64_t us)
+{
+    size_t n = 0;
+    for (int i = 1; i < req->chunk_count; i++) {
+        if (req->chunks[i].us <= us) n += req->chunks[i].len;
+    }
+    return n;
+}
+
+/* When the first `bytes` of audio had all arrived */
+static int64_t audio_done_us(const fake_http_request_t *req, size_t bytes)
+{
+    size_t n = 0;
+    for (int i = 1; i < req->chunk_count; i++) {
+        n += req->chunks[i].len;
+        if (n >= bytes) return req->chunks[i].us;
+    }
+    return 0;
+}
+
+static int64_t last_audio_us(const fake_http_request_t *req)
+{
+    /* The final two chunks are the closing boundary and the terminator */
+    for (int i = req->chunk_count - 1; i >= 1; i--) {
+        if (req->chunks[i].len != sizeof(s_tail) - 1) return req->chunks[i].us;
+    }
+    return 0;
+}
+
+static void test_streams_while_recording(void)
+{
+    fake_http_reset(&(fake_http_script_t){.connect_ms = 150, .process_ms = 200,
+                                          .body = "{\"text\":\"turn on the lamp\"}"});
+    take_t t;
+    record(1500, &t);
+    const fake_http_request_t *req = fake_http_request();
+
+    CHECK_EQ_INT(t.err, ESP_OK);
+    CHECK_EQ_STR(t.text, "turn on the lamp");
+    CHECK(req->chunked);
+    CHECK(strstr(req->headers, "Authorization: Bearer test-audio-key\r\n") != NULL);
+    CHECK(strstr(req->headers, "multipart/form-data; boundary=----Esp32ClawBoundary123456\r\n") != NULL);
+
+    size_t len = 0;
+    const uint8_t *pcm = body_pcm(req, &len);
+    CHECK(pcm && pcm_matches(pcm, len, t.samples));
+
+    /* All but the last partial chunk was on the wire before speech ended */
+    size_t total = t.samples * 2;
+    CHECK(audio_by(req, t.end_us) + MIMI_ASR_CHUNK_BYTES >= total);
+    CHECK(audio_by(req, t.begin_us + 500 * 1000) >= total / 4);
+    CHECK(last_audio_us(req) - t.end_us < 50 * 1000);
+    CHECK(req->complete_us - t.end_us < 50 * 1000);
+    /* Transcript latency is the server's, not the upload's */
+    CHECK(t.done_us - t.end_us < (200 + 100) * 1000);
+
+    BENCH("1.5 s take: first audio +%lld ms after begin, %zu/%zu bytes in before end of speech, "
+          "body complete +%lld ms, transcript +%lld ms after end (server 200 ms)",
+          (long long)((req->chunks[1].us - t.begin_us) / 1000), audio_by(req, t.end_us), total,
+          (long long)((req->complete_us - t.end_us) / 1000), (long long)((t.done_us - t.end_us) / 1000));
+    free(t.text);
+}
+
+/* Speech captured during a slow handshake waits in the ring and goes out
+ * in a burst once connected */
+static void test_handshake_behind_speech(void)
+{
+    fake_http_reset(&(fake_http_script_t){.connect_ms = 800, .process_ms = 50,
+                                          .body = "{\"text\":\"ok\"}"});
+    take_t t;
+    record(1200, &t);
+    const fake_http_request_t *req = fake_http_request();
+
+    CHECK_EQ_INT(t.err, ESP_OK);
+    CHECK_EQ_STR(t.text, "ok");
+    size_t len = 0;
+    const uint8_t *pcm = body_pcm(req, &len);
+    CHECK(pcm && pcm_matches(pcm, len, t.samples));
+
+    size_t backlog = (size_t)(req->opened_us - t.begin_us) * RATE / 1000000 * 2;
+    CHECK(audio_by(req, req->opened_us + 50 * 1000) + MIMI_ASR_CHUNK_BYTES >= backlog);
+    CHECK(t.done_us - t.end_us < (50 + 100) * 1000);
+    BENCH("800 ms handshake: %zu bytes queued behind it, out within %lld ms of connecting",
+          backlog, (long long)((audio_done_us(req, backlog) - req->opened_us) / 1000));
+    free(t.text);
+}
+
+/* The one-shot path feeds a clip larger than the ring as it drains */
+static void test_clip_larger_than_ring(void)
+{
+    fake_http_reset(&(fake_http_script_t){.body = "{\"text\":\"long\"}"});
+    size_t samples = MIMI_ASR_RING_SIZE / 2 + RATE;
+    int16_t *clip = malloc(samples * 2);
+    for (size_t i = 0; i < samples; i++) clip[i] = sample_at(i);
+
+    char *text = NULL;
+    CHECK_EQ_INT(asr_recognize((const uint8_t *)clip, samples * 2, &text), ESP_OK);
+    CHECK_EQ_STR(text, "long");
+    size_t len = 0;
+    const uint8_t *pcm = body_pcm(fake_http_request(), &len);
+    CHECK(pcm && pcm_matches(pcm, len, samples));
+    free(text);
+    free(clip);
+}
+
+static void test_server_error(void)
+{
+    fake_http_reset(&(fake_http_script_t){.status = 500, .body = "{\"error\":\"busy\"}"});
+    take_t t;
+    record(200, &t);
+    CHECK_EQ_INT(t.err, ESP_FAIL);
+    CHECK(t.text == NULL);
+}
+
+/* Dropped mid-take: the upload task lets go on its own */
+static void test_abort(void)
+{
+    fake_http_reset(&(fake_http_script_t){.connect_ms = 100});
+    asr_stream_t *s;
+    CHECK_EQ_INT(asr_stream_begin(RATE, &s), ESP_OK);
+    int16_t frame[FRAME] = {0};
+    for (int i = 0; i < 10; i++) CHECK_EQ_INT(asr_stream_write(s, frame, FRAME), ESP_OK);
+    asr_stream_abort(s);
+    usleep(400 * 1000);
+    CHECK_EQ_INT(fake_http_request()->complete_us, 0);
+}
+
+int main(void)
+{
+    test_streams_while_recording();
+    test_handshake_behind_speech();
+    test_clip_larger_than_ring();
+    test_server_error();
+    test_abort();
+    fake_http_reset(NULL);
+    return host_test_result("test_asr_stream");
+}
@@ -0,0 +1,183 @@
+/*
+ * PCM kernels: every dispatching kernel matches its scalar reference bit
+ * for bit over random and full-scale input, every length up to a few
+ * blocks, every misalignment and in place. On the host the dispatch
+ * takes the portable loops; an S3 build with MIMI_AUDIO_DSP_PIE runs the
+ * same checks through the vector path. Ends with both against _ref.
+ */
+#include "host_test.h"
+#include "audio/audio_dsp.h"
+#include "esp_timer.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_N   200
+#define PAD     (AUDIO_DSP_ALIGN / 2)
+
+static uint32_t s_seed = 1;
+
+static int16_t rnd16(void)
+{
+    s_seed = s_seed * 1103515245u + 12345u;
+    return (int16_t)(s_seed >> 8);
+}
+
+/* Random samples with the extremes mixed in */
+static void fill(int16_t *buf, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        switch (rnd16() & 15) {
+        case 0: buf[i] = INT16_MIN; break;
+        case 1: buf[i] = INT16_MAX; break;
+        case 2: buf[i] = -1; break;
+        default: buf[i] = rnd16(); break;
+        }
+    }
+}
+
+static const int16_t s_gains[] = { 0, 1, 16384, 23170, AUDIO_DSP_Q15_ONE, -5, INT16_MIN };
+#define GAINS (int)(sizeof(s_gains) / sizeof(s_gains[0]))
+
+static int16_t s_a[2 * MAX_N + 2 * PAD] __attribute__((aligned(AUDIO_DSP_ALIGN)));
+static int16_t s_b[2 * MAX_N + 2 * PAD] __attribute__((aligned(AUDIO_DSP_ALIGN)));
+static int16_t s_c[2 * MAX_N + 2 * PAD] __attribute__((aligned(AUDIO_DSP_ALIGN)));
+static int16_t s_d[2 * MAX_N + 2 * PAD] __attribute__((aligned(AUDIO_DSP_ALIGN)));
+
+static void test_gain_and_mix(void)
+{
+    int bad = 0;
+    for (size_t n = 0; n <= MAX_N; n++) {
+        for (int so = 0; so < PAD; so++) {
+            for (int dofs = 0; dofs < PAD; dofs += 3) {
+                int16_t g = s_gains[(n + so) % GAINS];
+                fill(s_a + so, n);
+                fill(s_b + dofs, n);
+                memcpy(s_c + dofs, s_b + dofs, n * sizeof(int16_t));
+
+                audio_dsp_gain_q15(s_b + dofs, s_a + so, n, g);
+                audio_dsp_gain_q15_ref(s_c + dofs, s_a + so, n, g);
+                bad += memcmp(s_b + dofs, s_c + dofs, n * sizeof(int16_t)) != 0;
+
+                fill(s_b + dofs, n);
+                memcpy(s_c + dofs, s_b + dofs, n * sizeof(int16_t));
+                audio_dsp_mix_q15(s_b + dofs, s_a + so, n, g);
+                audio_dsp_mix_q15_ref(s_c + dofs, s_a + so, n, g);
+                bad += memcmp(s_b + dofs, s_c + dofs, n * sizeof(int16_t)) != 0;
+            }
+            /* In place */
+            fill(s_a + so, n);
+            memcpy(s_c + so, s_a + so, n * sizeof(int16_t));
+            audio_dsp_gain_q15(s_a + so, s_a + so, n, 20000);
+            audio_dsp_gain_q15_ref(s_c + so, s_c + so, n, 20000);
+            bad += memcmp(s_a + so, s_c + so, n * sizeof(int16_t)) != 0;
+        }
+    }
+    CHECK_EQ_INT(bad, 0);
+
+    /* Full-scale accumulate saturates both ways */
+    for (int i = 0; i < 16; i++) {
+        s_a[i] = s_b[i] = (i & 1) ? INT16_MAX : INT16_MIN;
+    }
+    audio_dsp_mix_q15(s_b, s_a, 16, AUDIO_DSP_Q15_ONE);
+    CHECK_EQ_INT(s_b[0], INT16_MIN);
+    CHECK_EQ_INT(s_b[1], INT16_MAX);
+}
+
+static void test_downmix(void)
+{
+    int bad = 0;
+    for (size_t frames = 0; frames <= MAX_N; frames++) {
+        for (int so = 0; so < PAD; so++) {
+            for (int dofs = 0; dofs < PAD; dofs += 5) {
+                fill(s_a + so, 2 * frames);
+                audio_dsp_downmix_stereo(s_b + dofs, s_a + so, frames);
+                audio_dsp_downmix_stereo_ref(s_c + dofs, s_a + so, frames);
+                bad += memcmp(s_b + dofs, s_c + dofs, frames * sizeof(int16_t)) != 0;
+            }
+            /* In place: mono over the start of the stereo buffer */
+            fill(s_a + so, 2 * frames);
+            memcpy(s_d, s_a + so, 2 * frames * sizeof(int16_t));
+            audio_dsp_downmix_stereo(s_a + so, s_a + so, frames);
+            audio_dsp_downmix_stereo_ref(s_c, s_d, frames);
+            bad += memcmp(s_a + so, s_c, frames * sizeof(int16_t)) != 0;
+        }
+    }
+    CHECK_EQ_INT(bad, 0);
+}
+
+static void test_energy_and_rms(void)
+{
+    int bad = 0;
+    for (size_t n = 0; n <= MAX_N; n++) {
+        for (int so = 0; so < PAD; so++) {
+            fill(s_a + so, n);
+            bad += audio_dsp_energy(s_a + so, n) != audio_dsp_energy_ref(s_a + so, n);
+        }
+    }
+    CHECK_EQ_INT(bad, 0);
+
+    /* Past the 40-bit accumulator of one vector run: 4096 full-scale squares */
+    static int16_t big[4096] __attribute__((aligned(AUDIO_DSP_ALIGN)));
+    for (int i = 0; i < 4096; i++) big[i] = INT16_MIN;
+    CHECK(audio_dsp_energy(big, 4096) == audio_dsp_energy_ref(big, 4096));
+    CHECK_EQ_INT(audio_dsp_rms(big, 4096), 32768);
+    CHECK_EQ_INT(audio_dsp_rms(big, 0), 0);
+
+    for (int i = 0; i < 4096; i++) big[i] = (i & 1) ? 1000 : -1000;
+    CHECK_EQ_INT(audio_dsp_rms(big + 1, 4095), 1000);
+}
+
+static void test_gain_from_percent(void)
+{
+    CHECK_EQ_INT(audio_dsp_gain_from_percent(-3), 0);
+    CHECK_EQ_INT(audio_dsp_gain_from_percent(0), 0);
+    CHECK_EQ_INT(audio_dsp_gain_from_percent(50), 16384);
+    CHECK_EQ_INT(audio_dsp_gain_from_percent(100), AUDIO_DSP_Q15_ONE);
+    CHECK_EQ_INT(audio_dsp_gain_from_percent(150), AUDIO_DSP_Q15_ONE);
+}
+
+/* ns per sample; the sink keeps the loops from being dropped */
+static volatile uint64_t s_sink;
+
+#define BENCH_N      1024
+#define BENCH_ROUNDS 20000
+
+#define TIME_NS(expr) ({                                                    \
+        int64_t t0_ = esp_timer_get_time();                                 \
+        for (int r_ = 0; r_ < BENCH_ROUNDS; r_++) { expr; }                 \
+        (double)(esp_timer_get_time() - t0_) * 1000.0 / BENCH_ROUNDS / BENCH_N; \
+    })
+
+static void bench_kernels(void)
+{
+    static int16_t src[2 * BENCH_N] __attribute__((aligned(AUDIO_DSP_ALIGN)));
+    static int16_t dst[BENCH_N] __attribute__((aligned(AUDIO_DSP_ALIGN)));
+    fill(src, 2 * BENCH_N);
+    fill(dst, BENCH_N);
+
+    BENCH("%d samples, ns/sample     dispatch    _ref", BENCH_N);
+    BENCH("gain                       %6.3f  %6.3f",
+          TIME_NS(audio_dsp_gain_q15(dst, src, BENCH_N, 20000); s_sink += dst[r_ & 255]),
+          TIME_NS(audio_dsp_gain_q15_ref(dst, src, BENCH_N, 20000); s_sink += dst[r_ & 255]));
+    BENCH("mix                        %6.3f  %6.3f",
+          TIME_NS(audio_dsp_mix_q15(dst, src, BENCH_N, 20000); s_sink += dst[r_ & 255]),
+          TIME_NS(audio_dsp_mix_q15_ref(dst, src, BENCH_N, 20000); s_sink += dst[r_ & 255]));
+    BENCH("downmix (per frame)        %6.3f  %6.3f",
+          TIME_NS(audio_dsp_downmix_stereo(dst, src, BENCH_N); s_sink += dst[r_ & 255]),
+          TIME_NS(audio_dsp_downmix_stereo_ref(dst, src, BENCH_N); s_sink += dst[r_ & 255]));
+    BENCH("energy                     %6.3f  %6.3f",
+          TIME_NS(s_sink += audio_dsp_energy(src + (r_ & 1), BENCH_N)),
+          TIME_NS(s_sink += audio_dsp_energy_ref(src + (r_ & 1), BENCH_N)));
+}
+
+int main(void)
+{
+    test_gain_and_mix();
+    test_downmix();
+    test_energy_and_rms();
+    test_gain_from_percent();
+    bench_kernels();
+    return host_test_result("test_audio_dsp");
+}
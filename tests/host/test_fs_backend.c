@@ -0,0 +1,143 @@
+/*
+ * SPIFFS to LittleFS migration on a fake partition: everything fits and
+ * moves, sessions that do not fit are dropped, and when config, memory or
+ * skills do not fit the partition is left as SPIFFS, unformatted.
+ *
+ * There is no SPIFFS vs LittleFS bench here: the fake partition is a
+ * host directory, so timings would measure the host VFS, not either
+ * filesystem. Comparing them needs the real implementations over a RAM
+ * block device, which this suite does not build.
+ */
+#include "host_test.h"
+#include "memory/fs_backend.h"
+#include "mimi_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define STUB_PSRAM  (8 * 1024 * 1024)   /* what the heap stub reports free */
+
+typedef struct {
+    const char *path;
+    size_t len;
+} seed_file_t;
+
+static const seed_file_t s_small[] = {
+    {"/spiffs/config/SOUL.md", 700},
+    {"/spiffs/config/USER.md", 300},
+    {"/spiffs/memory/MEMORY.md", 1500},
+    {"/spiffs/memory/2026-10-01.md", 400},
+    {"/spiffs/skills/weather/SKILL.md", 900},
+    {"/spiffs/sessions/tg_1.jsonl", 24 * 1024},
+    {"/spiffs/sessions/tg_2.jsonl", 24 * 1024},
+};
+#define SMALL_COUNT     (sizeof(s_small) / sizeof(s_small[0]))
+
+static char s_data[64 * 1024];
+
+static void fill(size_t salt)
+{
+    for (size_t i = 0; i < sizeof(s_data); i++) s_data[i] = (char)('a' + (i * 7 + salt) % 26);
+}
+
+static void write_file(const char *path, size_t len, size_t salt)
+{
+    fill(salt);
+    FILE *f = fopen(path, "wb");
+    CHECK(f != NULL);
+    if (!f) return;
+    CHECK_EQ_INT(fwrite(s_data, 1, len, f), len);
+    fclose(f);
+}
+
+static bool file_is(const char *path, size_t len, size_t salt)
+{
+    fill(salt);
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    char buf[sizeof(s_data) + 1];
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    return n == len && memcmp(buf, s_data, len) == 0;
+}
+
+/* A SPIFFS partition holding `files`, unmounted as at boot */
+static void seed(const seed_file_t *files, size_t count)
+{
+    fake_flash_reset(FAKE_FLASH_SPIFFS);
+    for (size_t i = 0; i < count; i++) write_file(files[i].path, files[i].len, i);
+    fake_flash_unmount();
+}
+
+static void test_migrates_everything(void)
+{
+    seed(s_small, SMALL_COUNT);
+    fake_flash_reserve = 1024 * 1024;
+    int formats = fake_flash_formats;
+
+    CHECK_EQ_INT(fs_backend_init(), ESP_OK);
+    CHECK_EQ_STR(fs_backend_name(), "littlefs");
+    CHECK_EQ_INT(fake_flash_mounted(), FAKE_FLASH_LITTLEFS);
+    CHECK_EQ_INT(fake_flash_formats, formats + 1);
+    for (size_t i = 0; i < SMALL_COUNT; i++) CHECK(file_is(s_small[i].path, s_small[i].len, i));
+    CHECK_EQ_INT(fs_backend_gc(1024), ESP_ERR_NOT_SUPPORTED);
+    fake_flash_unmount();
+
+    /* The next boot mounts LittleFS as it is */
+    CHECK_EQ_INT(fs_backend_init(), ESP_OK);
+    CHECK_EQ_INT(fake_flash_formats, formats + 1);
+    CHECK(file_is(s_small[0].path, s_small[0].len, 0));
+    fake_flash_unmount();
+}
+
+/* Sessions past the PSRAM budget are dropped; the rest moves */
+static void test_sessions_left_behind(void)
+{
+    seed(s_small, SMALL_COUNT);
+    fake_flash_reserve = STUB_PSRAM - 16 * 1024;
+    int formats = fake_flash_formats;
+
+    CHECK_EQ_INT(fs_backend_init(), ESP_OK);
+    CHECK_EQ_STR(fs_backend_name(), "littlefs");
+    CHECK_EQ_INT(fake_flash_formats, formats + 1);
+    for (size_t i = 0; i < SMALL_COUNT; i++) {
+        bool session = strstr(s_small[i].path, "/sessions/") != NULL;
+        CHECK(file_is(s_small[i].path, s_small[i].len, i) == !session);
+    }
+    fake_flash_unmount();
+}
+
+/* A memory file past the budget: nothing is formatted, SPIFFS stays */
+static void test_stays_on_spiffs(void)
+{
+    seed_file_t files[SMALL_COUNT + 1];
+    memcpy(files, s_small, sizeof(s_small));
+    files[SMALL_COUNT] = (seed_file_t){"/spiffs/memory/2026-09-30.md", 20 * 1024};
+    seed(files, SMALL_COUNT + 1);
+    fake_flash_reserve = STUB_PSRAM - 16 * 1024;
+    int formats = fake_flash_formats;
+
+    for (int boot = 0; boot < 2; boot++) {
+        CHECK_EQ_INT(fs_backend_init(), ESP_OK);
+        CHECK_EQ_INT(fake_flash_formats, formats);
+        CHECK_EQ_INT(fake_flash_format(), FAKE_FLASH_SPIFFS);
+        CHECK_EQ_INT(fake_flash_mounted(), FAKE_FLASH_SPIFFS);
+        CHECK_EQ_STR(fs_backend_name(), "spiffs");
+        for (size_t i = 0; i < SMALL_COUNT + 1; i++) CHECK(file_is(files[i].path, files[i].len, i));
+
+        size_t total = 0, used = 0;
+        CHECK_EQ_INT(fs_backend_info(&total, &used), ESP_OK);
+        CHECK(total > 0 && used > 20 * 1024);
+        CHECK_EQ_INT(fs_backend_gc(1024), ESP_OK);
+        CHECK(fs_backend_ensure_parent("/spiffs/sessions/new.jsonl"));
+        fake_flash_unmount();
+    }
+}
+
+int main(void)
+{
+    test_migrates_everything();
+    test_sessions_left_behind();
+    test_stays_on_spiffs();
+    return host_test_result("test_fs_backend");
+}
@@ -0,0 +1,226 @@
+/*
+ * Streaming JSON writer: output matches cJSON's unformatted printer for
+ * the same tree, numbers of every magnitude round-trip (including ones
+ * no integer type can hold), escape mode nests JSON inside a string,
+ * and for every buffer size the dry-run count equals the bytes that
+ * reach the sink, so a Content-Length taken from it is exact.
+ */
+#include "host_test.h"
+#include "llm/json_writer.h"
+#include "cJSON.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char *data;
+    size_t len, cap;
+    int calls;
+    int fail_after;     /* sink fails on this call, 0 = never */
+} capture_t;
+
+static int capture_sink(void *arg, const char *data, size_t len)
+{
+    capture_t *c = arg;
+    c->calls++;
+    if (c->fail_after && c->calls >= c->fail_after) return -1;
+    if (c->len + len + 1 > c->cap) {
+        c->cap = (c->len + len + 1) * 2;
+        c->data = realloc(c->data, c->cap);
+    }
+    memcpy(c->data + c->len, data, len);
+    c->len += len;
+    c->data[c->len] = '\0';
+    return 0;
+}
+
+/* Write item through a buffer of cap bytes; returns the captured text */
+static char *write_through(const cJSON *item, size_t cap, size_t *total)
+{
+    capture_t c = {0};
+    char *buf = malloc(cap);
+    json_writer_t w;
+    jw_init(&w, capture_sink, &c, buf, cap);
+    jw_cjson(&w, item);
+    CHECK_EQ_INT(jw_flush(&w), ESP_OK);
+    *total = w.total;
+    free(buf);
+    if (!c.data) c.data = strdup("");
+    return c.data;
+}
+
+static size_t dry_run(const cJSON *item)
+{
+    json_writer_t w;
+    jw_init(&w, NULL, NULL, NULL, 0);
+    jw_cjson(&w, item);
+    CHECK_EQ_INT(jw_flush(&w), ESP_OK);
+    return w.total;
+}
+
+static const double s_numbers[] = {
+    0, -0.0, 1, -1, 42, 0.1, -2.5, 1.0 / 3, 123456789, 2147483647, 2147483648.0,
+    -2147483649.0, 1e14, 999999999999999, 1e15, -1e15, 1e15 + 2, 9007199254740993.0,
+    9.2233720368547758e18, -9.2233720368547758e18, 1.8446744073709552e19, 1e19, 1e20,
+    1e300, -1e300, DBL_MAX, -DBL_MAX, DBL_MIN, 5e-324, 1e-7, 6.02214076e23,
+};
+#define NUMBERS (int)(sizeof(s_numbers) / sizeof(s_numbers[0]))
+
+static cJSON *sample_tree(void)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "model", "claude");
+    cJSON_AddStringToObject(root, "quote\"key", "tab\there \"quoted\" back\\slash\n"
+                            "ctl\x01\x1f del\x7f utf8 \xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+    cJSON_AddBoolToObject(root, "stream", true);
+    cJSON_AddFalseToObject(root, "off");
+    cJSON_AddNullToObject(root, "nothing");
+    cJSON *nums = cJSON_AddArrayToObject(root, "numbers");
+    for (int i = 0; i < NUMBERS; i++) cJSON_AddItemToArray(nums, cJSON_CreateNumber(s_numbers[i]));
+    cJSON *msgs = cJSON_AddArrayToObject(root, "messages");
+    for (int i = 0; i < 20; i++) {
+        cJSON *m = cJSON_CreateObject();
+        cJSON_AddStringToObject(m, "role", i & 1 ? "assistant" : "user");
+        cJSON *content = cJSON_AddArrayToObject(m, "content");
+        cJSON *block = cJSON_CreateObject();
+        cJSON_AddStringToObject(block, "type", "text");
+        char text[64];
+        snprintf(text, sizeof(text), "message %d \"%c\"\r\n", i, 'a' + i);
+        cJSON_AddStringToObject(block, "text", text);
+        cJSON_AddItemToArray(content, block);
+        cJSON_AddItemToArray(content, cJSON_CreateArray());
+        cJSON_AddItemToArray(content, cJSON_CreateObject());
+        cJSON_AddItemToArray(msgs, m);
+    }
+    cJSON_AddRawToObject(root, "raw", "{\"pre\":[1,2,3]}");
+    cJSON_AddStringToObject(root, "", "empty key");
+    return root;
+}
+
+static void test_matches_cjson(void)
+{
+    cJSON *tree = sample_tree();
+    char *want = cJSON_PrintUnformatted(tree);
+    size_t total;
+    char *got = write_through(tree, 4096, &total);
+    CHECK_EQ_STR(got, want);
+    CHECK_EQ_INT(total, strlen(want));
+    free(got);
+    free(want);
+    cJSON_Delete(tree);
+}
+
+static void test_numbers_round_trip(void)
+{
+    for (int i = 0; i < NUMBERS; i++) {
+        cJSON *n = cJSON_CreateNumber(s_numbers[i]);
+        size_t total;
+        char *text = write_through(n, 64, &total);
+        cJSON *back = cJSON_Parse(text);
+        CHECK(cJSON_IsNumber(back));
+        if (back && back->valuedouble != s_numbers[i]) {
+            fprintf(stderr, "FAIL number %.17g written as %s\n", s_numbers[i], text);
+            host_test_failures++;
+        }
+        cJSON_Delete(back);
+        cJSON_Delete(n);
+        free(text);
+    }
+
+    /* Integral values below 1e15 print as plain integers */
+    json_writer_t w;
+    char buf[64];
+    capture_t c = {0};
+    jw_init(&w, capture_sink, &c, buf, sizeof(buf));
+    jw_number(&w, 999999999999999.0);
+    jw_raw(&w, ",", 1);
+    jw_number(&w, -2147483649.0);
+    jw_raw(&w, ",", 1);
+    jw_number(&w, NAN);
+    jw_raw(&w, ",", 1);
+    jw_number(&w, -INFINITY);
+    jw_raw(&w, ",", 1);
+    jw_number(&w, 1e300);
+    jw_flush(&w);
+    CHECK_EQ_STR(c.data, "999999999999999,-2147483649,null,null,1e+300");
+    free(c.data);
+}
+
+/* Escape mode: a JSON document written as the value of a string */
+static void test_escape_mode(void)
+{
+    cJSON *inner = sample_tree();
+    char *inner_text = cJSON_PrintUnformatted(inner);
+
+    capture_t c = {0};
+    char buf[16];
+    json_writer_t w;
+    jw_init(&w, capture_sink, &c, buf, sizeof(buf));
+    jw_raw(&w, "{", 1);
+    jw_key(&w, "payload");
+    jw_string_begin(&w);
+    w.escape = true;
+    jw_cjson(&w, inner);
+    w.escape = false;
+    jw_string_end(&w);
+    jw_raw(&w, "}", 1);
+    CHECK_EQ_INT(jw_flush(&w), ESP_OK);
+    CHECK_EQ_INT(w.total, c.len);
+
+    cJSON *outer = cJSON_Parse(c.data);
+    CHECK_EQ_STR(cJSON_GetStringValue(cJSON_GetObjectItem(outer, "payload")), inner_text);
+
+    cJSON_Delete(outer);
+    cJSON_Delete(inner);
+    free(inner_text);
+    free(c.data);
+}
+
+/* The Content-Length a dry run computes is exactly what goes out,
+ * whatever the buffer size and wherever flushes fall */
+static void test_dry_run_matches_sent(void)
+{
+    cJSON *tree = sample_tree();
+    size_t counted = dry_run(tree);
+    char *want = cJSON_PrintUnformatted(tree);
+    CHECK_EQ_INT(counted, strlen(want));
+
+    int bad = 0;
+    for (size_t cap = 1; cap <= 300; cap++) {
+        size_t total;
+        char *got = write_through(tree, cap, &total);
+        bad += total != counted || strlen(got) != counted || strcmp(got, want) != 0;
+        free(got);
+    }
+    CHECK_EQ_INT(bad, 0);
+    free(want);
+    cJSON_Delete(tree);
+}
+
+/* A failing sink stops the write and is reported once */
+static void test_sink_failure(void)
+{
+    cJSON *tree = sample_tree();
+    capture_t c = { .fail_after = 3 };
+    char buf[32];
+    json_writer_t w;
+    jw_init(&w, capture_sink, &c, buf, sizeof(buf));
+    jw_cjson(&w, tree);
+    CHECK_EQ_INT(jw_flush(&w), ESP_FAIL);
+    CHECK_EQ_INT(c.calls, 3);
+    CHECK_EQ_INT(w.total, dry_run(tree));
+    free(c.data);
+    cJSON_Delete(tree);
+}
+
+int main(void)
+{
+    test_matches_cjson();
+    test_numbers_round_trip();
+    test_escape_mode();
+    test_dry_run_matches_sent();
+    test_sink_failure();
+    return host_test_result("test_json_writer");
+}
@@ -0,0 +1,105 @@
+/*
+ * kv_store: a change that kv_store_set() reports as committed survives a
+ * reboot even when compaction or an append failed before it. Flash
+ * faults come from host_fs; a reboot runs this binary again as
+ * `test_kv_store check <root> key=value...` against the same files.
+ */
+#include "host_test.h"
+#include "memory/kv_store.h"
+#include "mimi_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char *s_self;
+static const char *s_root;
+
+/* Reload the store in a fresh process and check each key=value; an
+ * empty value means the key must be missing */
+static bool reboot_check(const char *expect)
+{
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "%s check %s %s", s_self, s_root, expect);
+    return system(cmd) == 0;
+}
+
+static int check_main(int argc, char **argv)
+{
+    host_fs_root(argv[2]);
+    CHECK_EQ_INT(kv_store_init(), ESP_OK);
+    for (int i = 3; i < argc; i++) {
+        char key[KV_KEY_MAX];
+        const char *eq = strchr(argv[i], '=');
+        snprintf(key, sizeof(key), "%.*s", (int)(eq - argv[i]), argv[i]);
+        char *value = kv_store_get_str(key);
+        if (eq[1]) {
+            CHECK_EQ_STR(value, eq + 1);
+        } else if (value) {
+            fprintf(stderr, "FAIL after reboot: %s is \"%s\", want missing\n", key, value);
+            host_test_failures++;
+        }
+        free(value);
+    }
+    return host_test_result("test_kv_store (after reboot)");
+}
+
+/* Compaction writes the snapshot, then cannot start the new log */
+static void test_log_start_fails(void)
+{
+    CHECK_EQ_INT(kv_store_set_str("a", "1"), ESP_OK);
+    host_fs_fault(MIMI_KV_LOG_FILE, -1);
+    CHECK(kv_store_compact() != ESP_OK);
+
+    CHECK_EQ_INT(kv_store_set_str("b", "2"), ESP_OK);
+    CHECK_EQ_INT(kv_store_delete("a"), ESP_OK);
+    CHECK_EQ_INT(kv_store_set_str("c", "3"), ESP_OK);
+    CHECK(reboot_check("a= b=2 c=3"));
+}
+
+/* An append cut short leaves a torn record at the end of the log */
+static void test_torn_append(void)
+{
+    /* The new log takes its header and a few bytes of the next record */
+    host_fs_fault(MIMI_KV_LOG_FILE, 8 + 5);
+    CHECK_EQ_INT(kv_store_compact(), ESP_OK);
+    CHECK(kv_store_set_str("d", "lost") != ESP_OK);
+    CHECK(kv_store_get_str("d") == NULL);
+
+    CHECK_EQ_INT(kv_store_set_str("e", "5"), ESP_OK);
+    CHECK_EQ_INT(kv_store_set_str("b", "22"), ESP_OK);
+    CHECK(reboot_check("b=22 c=3 d= e=5"));
+}
+
+/* Repeated failures each leave the store as the caller was told */
+static void test_fault_sweep(void)
+{
+    char expect[512] = "";
+    for (int i = 0; i < 24; i++) {
+        char key[8], value[8];
+        snprintf(key, sizeof(key), "k%d", i);
+        snprintf(value, sizeof(value), "v%d", i);
+        if (i % 3 == 0) {
+            host_fs_fault(MIMI_KV_LOG_FILE, i % 2 ? -1 : 8 + i);
+            kv_store_compact();
+        }
+        bool ok = kv_store_set_str(key, value) == ESP_OK;
+        size_t n = strlen(expect);
+        snprintf(expect + n, sizeof(expect) - n, " %s=%s", key, ok ? value : "");
+    }
+    CHECK(reboot_check(expect));
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 2 && strcmp(argv[1], "check") == 0) return check_main(argc, argv);
+
+    s_self = argv[0];
+    s_root = host_fs_root(NULL);
+    mkdir("/spiffs/config", 0755);
+    CHECK_EQ_INT(kv_store_init(), ESP_OK);
+
+    test_log_start_fails();
+    test_torn_append();
+    test_fault_sweep();
+    return host_test_result("test_kv_store");
+}
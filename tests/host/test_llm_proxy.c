@@ -0,0 +1,716 @@
+/*
+ * LLM requests over the proxy tunnel against a scripted HTTPS server:
+ * warm tunnels are reused, idle ones evicted, a tunnel the server closed
+ * while idle is reopened once, and responses cut short before their
+ * framing completes fail instead of passing as a reply. Without the
+ * proxy, esp_http_client sessions are pooled the same way, and a reply
+ * cut off after its body started is neither retried nor passed on, so
+ * streamed text is never delivered twice. Request bodies
+ * in both wire formats go out with a Content-Length equal to the bytes
+ * sent. Anthropic bodies carry exactly three prompt-cache breakpoints:
+ * the last tool, the system prompt and the last message's final block.
+ * Recorded Anthropic and OpenAI SSE streams (fixtures/) replay to
+ * the same text, tool calls and usage however the bytes are split.
+ */
+#include "host_test.h"
+#include "llm/llm_proxy.h"
+#include "fakes/fake_llm_transport.h"
+#include "cJSON.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Replies are read after queueing, so their bytes live in a ring */
+static char s_reply_bufs[16][512];
+static int s_reply_next;
+
+static const char *anthropic_body(const char *text)
+{
+    static char body[256];
+    snprintf(body, sizeof(body),
+             "{\"content\":[{\"type\":\"text\",\"text\":\"%s\"}],\"stop_reason\":\"end_turn\"}",
+             text);
+    return body;
+}
+
+static void queue_raw(const char *raw, size_t read_size, bool close)
+{
+    char *buf = s_reply_bufs[s_reply_next++ % 16];
+    snprintf(buf, sizeof(s_reply_bufs[0]), "%s", raw);
+    fake_transport_queue(&(fake_reply_t){ .data = buf, .read_size = read_size, .close = close });
+}
+
+/* 200 with a Content-Length body */
+static void queue_sized(const char *text, size_t read_size)
+{
+    const char *body = anthropic_body(text);
+    char raw[512];
+    snprintf(raw, sizeof(raw),
+             "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+             "Content-Length: %zu\r\n\r\n%s", strlen(body), body);
+    queue_raw(raw, read_size, false);
+}
+
+/* 200 with the body split over two chunks, after an interim 100 */
+static void queue_chunked(const char *text, size_t read_size)
+{
+    const char *body = anthropic_body(text);
+    size_t half = strlen(body) / 2;
+    char raw[512];
+    snprintf(raw, sizeof(raw),
+             "HTTP/1.1 100 Continue\r\n\r\n"
+             "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+             "%zx\r\n%.*s\r\n%zx\r\n%s\r\n0\r\n\r\n",
+             half, (int)half, body, strlen(body) - half, body + half);
+    queue_raw(raw, read_size, false);
+}
+
+static esp_err_t ask(char **text)
+{
+    cJSON *messages = cJSON_CreateArray();
+    cJSON *m = cJSON_CreateObject();
+    cJSON_AddStringToObject(m, "role", "user");
+    cJSON_AddStringToObject(m, "content", "hi");
+    cJSON_AddItemToArray(messages, m);
+
+    llm_response_t resp;
+    esp_err_t err = llm_chat_tools("system", messages, NULL, &resp);
+    cJSON_Delete(messages);
+    *text = resp.text ? strdup(resp.text) : NULL;
+    llm_response_free(&resp);
+    return err;
+}
+
+static void check_reply(const char *want)
+{
+    char *text = NULL;
+    CHECK_EQ_INT(ask(&text), ESP_OK);
+    CHECK_EQ_STR(text, want);
+    free(text);
+}
+
+static void check_fails(esp_err_t want)
+{
+    char *text = NULL;
+    CHECK_EQ_INT(ask(&text), want);
+    CHECK(text == NULL);
+    free(text);
+}
+
+static void test_warm_reuse(void)
+{
+    queue_sized("one", 0);
+    queue_chunked("two", 0);
+    queue_chunked("three", 7);      /* framing split across many reads */
+    queue_sized("four", 1);
+
+    check_reply("one");
+    check_reply("two");
+    check_reply("three");
+    check_reply("four");
+
+    llm_conn_pool_stats_t st;
+    llm_get_conn_pool_stats(&st);
+    CHECK_EQ_INT(fake_transport_opens(), 1);
+    CHECK_EQ_INT(st.misses, 1);
+    CHECK_EQ_INT(st.hits, 3);
+    CHECK_EQ_INT(st.open, 1);
+
+    /* The request on the wire is framed as sent */
+    size_t len;
+    const char *req = fake_transport_last_request(&len);
+    const char *body = strstr(req, "\r\n\r\n");
+    CHECK(body != NULL);
+    CHECK_EQ_INT(strtoul(strstr(req, "Content-Length:") + 15, NULL, 10), len - (body + 4 - req));
+}
+
+/* The server dropped the idle tunnel: the request is retried once on a
+ * fresh one, and the dead tunnel is not kept */
+static void test_reconnect_on_eof(void)
+{
+    llm_conn_pool_stats_t before, after;
+    llm_get_conn_pool_stats(&before);
+    int opens = fake_transport_opens();
+
+    fake_transport_close_idle();
+    queue_sized("again", 0);
+    check_reply("again");
+
+    llm_get_conn_pool_stats(&after);
+    CHECK_EQ_INT(fake_transport_opens(), opens + 1);
+    CHECK_EQ_INT(after.reconnects, before.reconnects + 1);
+    CHECK_EQ_INT(fake_transport_live(), 1);
+    CHECK_EQ_INT(after.open, 1);
+}
+
+static void test_idle_eviction(void)
+{
+    llm_conn_pool_stats_t before, after;
+    llm_get_conn_pool_stats(&before);
+    int opens = fake_transport_opens();
+
+    usleep((MIMI_LLM_CONN_IDLE_MS + 50) * 1000);
+    queue_sized("fresh", 0);
+    check_reply("fresh");
+
+    llm_get_conn_pool_stats(&after);
+    CHECK_EQ_INT(after.evictions, before.evictions + 1);
+    CHECK_EQ_INT(after.reconnects, before.reconnects);
+    CHECK_EQ_INT(fake_transport_opens(), opens + 1);
+    CHECK_EQ_INT(fake_transport_live(), 1);
+}
+
+/* Connection: close and close-delimited bodies end the tunnel */
+static void test_server_close(void)
+{
+    char raw[512];
+    const char *body = anthropic_body("closing");
+    snprintf(raw, sizeof(raw), "HTTP/1.1 200 OK\r\nConnection: close\r\n"
+             "Content-Length: %zu\r\n\r\n%s", strlen(body), body);
+    queue_raw(raw, 0, true);
+    check_reply("closing");
+    CHECK_EQ_INT(fake_transport_live(), 0);
+
+    snprintf(raw, sizeof(raw), "HTTP/1.0 200 OK\r\n\r\n%s", anthropic_body("until eof"));
+    queue_raw(raw, 5, true);
+    check_reply("until eof");
+    CHECK_EQ_INT(fake_transport_live(), 0);
+}
+
+/* Cut short mid-headers, mid-body or mid-chunk: an error, never a
+ * partial reply, and not retried as a stale tunnel */
+static void test_truncated(void)
+{
+    const char *body = anthropic_body("cut");
+    char raw[512];
+
+    /* Warm the pool so the stale retry would be on offer */
+    queue_sized("warm", 0);
+    check_reply("warm");
+    int opens = fake_transport_opens();
+    llm_conn_pool_stats_t before, after;
+    llm_get_conn_pool_stats(&before);
+
+    snprintf(raw, sizeof(raw), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n%.20s",
+             strlen(body), body);
+    queue_raw(raw, 0, true);
+    check_fails(ESP_ERR_INVALID_RESPONSE);
+
+    snprintf(raw, sizeof(raw), "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+             "%zx\r\n%s\r\n", strlen(body), body);
+    queue_raw(raw, 0, true);
+    check_fails(ESP_ERR_INVALID_RESPONSE);
+
+    queue_raw("HTTP/1.1 200 OK\r\nContent-Le", 0, true);
+    check_fails(ESP_ERR_INVALID_RESPONSE);
+
+    llm_get_conn_pool_stats(&after);
+    CHECK_EQ_INT(after.reconnects, before.reconnects);
+    CHECK_EQ_INT(fake_transport_opens(), opens + 2);
+    CHECK_EQ_INT(fake_transport_live(), 0);
+
+    /* The next request opens a clean tunnel and succeeds */
+    queue_sized("recovered", 0);
+    check_reply("recovered");
+}
+
+/* A ReAct history of several KB: text, tool calls whose input holds
+ * awkward strings and numbers no integer type can hold, and results */
+static cJSON *long_history(void)
+{
+    cJSON *messages = cJSON_CreateArray();
+    for (int i = 0; i < 12; i++) {
+        cJSON *user = cJSON_CreateObject();
+        cJSON_AddStringToObject(user, "role", "user");
+        if (i == 0) {
+            cJSON_AddStringToObject(user, "content", "List \"files\"\t\xc3\xa9\xe2\x82\xac\x01 please");
+        } else {
+            cJSON *content = cJSON_AddArrayToObject(user, "content");
+            cJSON *result = cJSON_CreateObject();
+            char id[32], text[200];
+            snprintf(id, sizeof(id), "toolu_%02d", i - 1);
+            memset(text, 'x', sizeof(text) - 1);
+            text[sizeof(text) - 1] = '\0';
+            text[10] = '"';
+            text[20] = '\n';
+            cJSON_AddStringToObject(result, "type", "tool_result");
+            cJSON_AddStringToObject(result, "tool_use_id", id);
+            cJSON_AddStringToObject(result, "content", text);
+            cJSON_AddItemToArray(content, result);
+        }
+        cJSON_AddItemToArray(messages, user);
+
+        cJSON *asst = cJSON_CreateObject();
+        cJSON_AddStringToObject(asst, "role", "assistant");
+        cJSON *content = cJSON_AddArrayToObject(asst, "content");
+        cJSON *text = cJSON_CreateObject();
+        cJSON_AddStringToObject(text, "type", "text");
+        cJSON_AddStringToObject(text, "text", "Let me check \\ that.");
+        cJSON_AddItemToArray(content, text);
+        cJSON *use = cJSON_CreateObject();
+        char id[32];
+        snprintf(id, sizeof(id), "toolu_%02d", i);
+        cJSON_AddStringToObject(use, "type", "tool_use");
+        cJSON_AddStringToObject(use, "id", id);
+        cJSON_AddStringToObject(use, "name", "list_dir");
+        cJSON *input = cJSON_AddObjectToObject(use, "input");
+        cJSON_AddStringToObject(input, "path", "/spiffs/\"dir\"\n");
+        cJSON_AddNumberToObject(input, "limit", 1e300);
+        cJSON_AddNumberToObject(input, "offset", -9.2233720368547758e18);
+        cJSON_AddNumberToObject(input, "depth", 3);
+        cJSON_AddItemToArray(content, use);
+        cJSON_AddItemToArray(messages, asst);
+    }
+    cJSON *last = cJSON_CreateObject();
+    cJSON_AddStringToObject(last, "role", "user");
+    cJSON_AddStringToObject(last, "content", "and now?");
+    cJSON_AddItemToArray(messages, last);
+    return messages;
+}
+
+static const char s_tools[] =
+    "[{\"name\":\"list_dir\",\"description\":\"List a \\\"dir\\\".\","
+    "\"input_schema\":{\"type\":\"object\",\"properties\":{\"path\":{\"type\":\"string\"}}}}]";
+
+/* The body that went out: parsed, after checking its Content-Length */
+static cJSON *sent_body(void)
+{
+    size_t len;
+    const char *req = fake_transport_last_request(&len);
+    const char *body = req ? strstr(req, "\r\n\r\n") : NULL;
+    const char *cl = req ? strstr(req, "Content-Length:") : NULL;
+    CHECK(body && cl && cl < body);
+    if (!body || !cl) return NULL;
+    body += 4;
+    size_t body_len = len - (size_t)(body - req);
+    CHECK_EQ_INT(strtoul(cl + 15, NULL, 10), body_len);
+    return cJSON_ParseWithLength(body, body_len);
+}
+
+static void test_body_framing(void)
+{
+    cJSON *messages = long_history();
+    llm_response_t resp;
+
+    queue_sized("long", 0);
+    CHECK_EQ_INT(llm_chat_tools("system \"prompt\"", messages, s_tools, &resp), ESP_OK);
+    llm_response_free(&resp);
+    cJSON *body = sent_body();
+    CHECK(cJSON_GetArraySize(cJSON_GetObjectItem(body, "messages")) == 25);
+    CHECK_EQ_INT(cJSON_GetArraySize(cJSON_GetObjectItem(body, "tools")), 1);
+    size_t len;
+    fake_transport_last_request(&len);
+    CHECK(len > 3 * MIMI_LLM_TX_CHUNK_SIZE);    /* several writer flushes */
+    cJSON_Delete(body);
+
+    llm_set_provider("openai");
+    const char *reply = "{\"choices\":[{\"message\":{\"content\":\"ok\"},\"finish_reason\":\"stop\"}]}";
+    char raw[256];
+    snprintf(raw, sizeof(raw), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n%s", strlen(reply), reply);
+    queue_raw(raw, 0, false);
+    CHECK_EQ_INT(llm_chat_tools("system", messages, s_tools, &resp), ESP_OK);
+    CHECK_EQ_STR(resp.text, "ok");
+    llm_response_free(&resp);
+
+    body = sent_body();
+    cJSON *msgs = cJSON_GetObjectItem(body, "messages");
+    CHECK_EQ_STR(cJSON_GetStringValue(cJSON_GetObjectItem(cJSON_GetArrayItem(msgs, 0), "role")), "system");
+    /* Tool input travels as a JSON document inside a string */
+    cJSON *call = cJSON_GetArrayItem(cJSON_GetObjectItem(cJSON_GetArrayItem(msgs, 2), "tool_calls"), 0);
+    const char *args = cJSON_GetStringValue(
+        cJSON_GetObjectItem(cJSON_GetObjectItem(call, "function"), "arguments"));
+    cJSON *input = args ? cJSON_Parse(args) : NULL;
+    CHECK_EQ_STR(cJSON_GetStringValue(cJSON_GetObjectItem(input, "path")), "/spiffs/\"dir\"\n");
+    CHECK(cJSON_GetObjectItem(input, "limit") && cJSON_GetObjectItem(input, "limit")->valuedouble == 1e300);
+    cJSON_Delete(input);
+    cJSON_Delete(body);
+
+    llm_set_provider("anthropic");
+    cJSON_Delete(messages);
+}
+
+/* ── Prompt-cache breakpoints ─────────────────────────────────── */
+
+/* Two tools, with the whitespace a hand-written blob may end in */
+static const char s_two_tools[] =
+    "[{\"name\":\"list_dir\",\"input_schema\":{\"type\":\"object\",\"properties\":{}}},"
+    "{\"name\":\"read_file\",\"input_schema\":{\"type\":\"object\",\"properties\":{}}}]\n ";
+
+static int count_substr(const char *s, size_t len, const char *needle)
+{
+    int n = 0;
+    size_t nl = strlen(needle);
+    for (const char *p = s; (p = memmem(p, len - (size_t)(p - s), needle, nl)) != NULL; p += nl) n++;
+    return n;
+}
+
+static bool is_breakpoint(const cJSON *obj)
+{
+    cJSON *cc = cJSON_GetObjectItem(obj, "cache_control");
+    return cJSON_IsObject(cc) && cJSON_GetArraySize(cc) == 1 &&
+           strcmp(cJSON_GetStringValue(cJSON_GetObjectItem(cc, "type")) ?: "", "ephemeral") == 0;
+}
+
+/* Send one request and return its parsed body; *marks counts breakpoints
+ * in the raw bytes */
+static cJSON *send_cached(const char *system, cJSON *messages, const char *tools, int *marks)
+{
+    llm_response_t resp;
+    queue_sized("cached", 0);
+    CHECK_EQ_INT(llm_chat_tools(system, messages, tools, &resp), ESP_OK);
+    llm_response_free(&resp);
+    size_t len;
+    const char *req = fake_transport_last_request(&len);
+    *marks = req ? count_substr(req, len, "\"cache_control\"") : -1;
+    return sent_body();
+}
+
+static void test_cache_breakpoints(void)
+{
+    /* Last message with string content: it becomes one marked text block */
+    cJSON *messages = long_history();
+    int marks;
+    cJSON *body = send_cached("system \"prompt\"", messages, s_two_tools, &marks);
+    CHECK_EQ_INT(marks, 3);
+
+    /* Spliced into the final tool object, before the closing }] */
+    cJSON *tools = cJSON_GetObjectItem(body, "tools");
+    CHECK_EQ_INT(cJSON_GetArraySize(tools), 2);
+    CHECK(!cJSON_GetObjectItem(cJSON_GetArrayItem(tools, 0), "cache_control"));
+    CHECK(is_breakpoint(cJSON_GetArrayItem(tools, 1)));
+    CHECK_EQ_STR(cJSON_GetStringValue(cJSON_GetObjectItem(cJSON_GetArrayItem(tools, 1), "name")), "read_file");
+
+    cJSON *system = cJSON_GetObjectItem(body, "system");
+    CHECK_EQ_INT(cJSON_GetArraySize(system), 1);
+    CHECK_EQ_STR(cJSON_GetStringValue(cJSON_GetObjectItem(cJSON_GetArrayItem(system, 0), "text")),
+                 "system \"prompt\"");
+    CHECK(is_breakpoint(cJSON_GetArrayItem(system, 0)));
+
+    cJSON *msgs = cJSON_GetObjectItem(body, "messages");
+    CHECK_EQ_INT(cJSON_GetArraySize(msgs), 25);
+    cJSON *content = cJSON_GetObjectItem(cJSON_GetArrayItem(msgs, 24), "content");
+    CHECK_EQ_INT(cJSON_GetArraySize(content), 1);
+    CHECK_EQ_STR(cJSON_GetStringValue(cJSON_GetObjectItem(cJSON_GetArrayItem(content, 0), "text")),
+                 "and now?");
+    CHECK(is_breakpoint(cJSON_GetArrayItem(content, 0)));
+    cJSON_Delete(body);
+
+    /* Last message with tool results: only its final block is marked, and
+     * a breakpoint already on it is not written twice */
+    cJSON *user = cJSON_CreateObject();
+    cJSON_AddStringToObject(user, "role", "user");
+    cJSON *results = cJSON_AddArrayToObject(user, "content");
+    for (int i = 0; i < 2; i++) {
+        cJSON *result = cJSON_CreateObject();
+        cJSON_AddStringToObject(result, "type", "tool_result");
+        cJSON_AddStringToObject(result, "tool_use_id", i ? "toolu_b" : "toolu_a");
+        cJSON_AddStringToObject(result, "content", i ? "second" : "first");
+        if (i) cJSON_AddItemToObject(result, "cache_control", cJSON_CreateObject());
+        cJSON_AddItemToArray(results, result);
+    }
+    cJSON_DeleteItemFromArray(messages, cJSON_GetArraySize(messages) - 1);
+    cJSON_AddItemToArray(messages, user);
+
+    body = send_cached("system", messages, s_tools, &marks);
+    CHECK_EQ_INT(marks, 3);
+    CHECK(is_breakpoint(cJSON_GetArrayItem(cJSON_GetObjectItem(body, "tools"), 0)));
+    content = cJSON_GetObjectItem(cJSON_GetArrayItem(cJSON_GetObjectItem(body, "messages"), 24), "content");
+    CHECK_EQ_INT(cJSON_GetArraySize(content), 2);
+    CHECK(!cJSON_GetObjectItem(cJSON_GetArrayItem(content, 0), "cache_control"));
+    CHECK(is_breakpoint(cJSON_GetArrayItem(content, 1)));
+    CHECK_EQ_STR(cJSON_GetStringValue(cJSON_GetObjectItem(cJSON_GetArrayItem(content, 1), "content")),
+                 "second");
+    cJSON_Delete(body);
+
+    /* An empty system prompt stays a plain string, unmarked */
+    body = send_cached("", messages, s_tools, &marks);
+    CHECK_EQ_INT(marks, 2);
+    CHECK(cJSON_IsString(cJSON_GetObjectItem(body, "system")));
+    cJSON_Delete(body);
+
+    /* Providers without the cache get no breakpoints at all; history goes
+     * out as given, so drop the one planted above */
+    cJSON_DeleteItemFromObject(cJSON_GetArrayItem(results, 1), "cache_control");
+    llm_set_provider("minimax_coding");
+    body = send_cached("system", messages, s_tools, &marks);
+    CHECK_EQ_INT(marks, 0);
+    CHECK(cJSON_IsString(cJSON_GetObjectItem(body, "system")));
+    cJSON_Delete(body);
+
+    llm_set_provider("anthropic");
+    cJSON_Delete(messages);
+}
+
+/* ── SSE replay ───────────────────────────────────────────────── */
+
+typedef struct {
+    const char *fixture;
+    const char *provider;
+    const char *text;
+    const char *ids[2], *names[2], *inputs[2];
+    llm_usage_t usage;
+} transcript_t;
+
+static const transcript_t s_transcripts[] = {
+    {
+        .fixture = "fixtures/sse_anthropic_tools.txt",
+        .provider = "anthropic",
+        .text = "I'll check the \"notes\" folder — café ☕, then the logs 😀.\nBack\\slash\tand tab.",
+        .ids = { "toolu_01T1x1fJ34qAmk2tNTrN7Up6", "toolu_01A09q90qw90lq917835lq9" },
+        .names = { "list_dir", "read_file" },
+        .inputs = { "{\"path\": \"/spiffs/notes\", \"limit\": 20}",
+                    "{\"path\": \"/spiffs/logs/é\\\"q\\\".txt\"}" },
+        .usage = { .input_tokens = 1184, .cache_read_tokens = 2048, .output_tokens = 87 },
+    },
+    {
+        .fixture = "fixtures/sse_openai_tools.txt",
+        .provider = "openai",
+        .text = "Checking the \"notes\" — café ☕ now.\n",
+        .ids = { "call_Qk1", "call_Rz2" },
+        .names = { "list_dir", "read_file" },
+        .inputs = { "{\"path\":\"/spiffs/notes\",\"limit\":20}",
+                    "{\"path\":\"/spiffs/logs/é\\\"q\\\".txt\"}" },
+        .usage = { .input_tokens = 1184, .cache_read_tokens = 2048, .output_tokens = 87 },
+    },
+};
+
+static char *read_fixture(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    CHECK(f != NULL);
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    *len = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc(*len + 1);
+    *len = fread(data, 1, *len, f);
+    data[*len] = '\0';
+    fclose(f);
+    return data;
+}
+
+/* The body as a chunked 200, chunk sizes drawn from seed (0: one chunk) */
+static char *sse_response(const char *body, size_t len, unsigned seed)
+{
+    size_t cap = 128 + len * 2 + len * 8;
+    char *raw = malloc(cap);
+    size_t off = (size_t)snprintf(raw, cap, "HTTP/1.1 200 OK\r\n"
+                                  "Content-Type: text/event-stream\r\n"
+                                  "Transfer-Encoding: chunked\r\n\r\n");
+    for (size_t pos = 0; pos < len; ) {
+        size_t n = seed ? 1 + rand_r(&seed) % 300 : len;
+        if (n > len - pos) n = len - pos;
+        off += (size_t)snprintf(raw + off, cap - off, "%zx\r\n", n);
+        memcpy(raw + off, body + pos, n);
+        off += n;
+        off += (size_t)snprintf(raw + off, cap - off, "\r\n");
+        pos += n;
+    }
+    snprintf(raw + off, cap - off, "0\r\n\r\n");
+    return raw;
+}
+
+typedef struct {
+    char text[512];
+    size_t len;
+    int tokens;
+} token_sink_t;
+
+static void on_token(const char *token, void *ctx)
+{
+    token_sink_t *t = ctx;
+    size_t n = strlen(token);
+    if (t->len + n < sizeof(t->text)) {
+        memcpy(t->text + t->len, token, n + 1);
+        t->len += n;
+    }
+    t->tokens++;
+}
+
+/* One replay, reads of up to read_size bytes; returns the number of mismatches */
+static int replay(const transcript_t *tr, const char *body, size_t len,
+                  unsigned seed, size_t read_size)
+{
+    char *raw = sse_response(body, len, seed);
+    fake_transport_queue(&(fake_reply_t){ .data = raw, .read_size = read_size, .seed = seed });
+
+    cJSON *messages = cJSON_CreateArray();
+    cJSON *m = cJSON_CreateObject();
+    cJSON_AddStringToObject(m, "role", "user");
+    cJSON_AddStringToObject(m, "content", "look around");
+    cJSON_AddItemToArray(messages, m);
+
+    token_sink_t tokens = {0};
+    llm_response_t resp;
+    esp_err_t err = llm_chat_stream("system", messages, NULL, on_token, &tokens, &resp);
+    cJSON_Delete(messages);
+    free(raw);
+
+    int bad = 0;
+    bad += err != ESP_OK;
+    bad += !resp.text || strcmp(resp.text, tr->text) != 0;
+    bad += strcmp(tokens.text, tr->text) != 0;
+    bad += !resp.tool_use || resp.call_count != 2;
+    for (int i = 0; i < 2 && i < resp.call_count; i++) {
+        bad += strcmp(resp.calls[i].id, tr->ids[i]) != 0;
+        bad += strcmp(resp.calls[i].name, tr->names[i]) != 0;
+        bad += !resp.calls[i].input || strcmp(resp.calls[i].input, tr->inputs[i]) != 0;
+        bad += resp.calls[i].input && resp.calls[i].input_len != strlen(resp.calls[i].input);
+    }
+    bad += resp.usage.input_tokens != tr->usage.input_tokens;
+    bad += resp.usage.cache_read_tokens != tr->usage.cache_read_tokens;
+    bad += resp.usage.cache_write_tokens != tr->usage.cache_write_tokens;
+    bad += resp.usage.output_tokens != tr->usage.output_tokens;
+    if (bad && seed == 0) {
+        fprintf(stderr, "replay %s: err %d text \"%s\" calls %d\n", tr->fixture, err,
+                resp.text ? resp.text : "(null)", resp.call_count);
+    }
+    llm_response_free(&resp);
+    return bad;
+}
+
+static void test_sse_replay(void)
+{
+    for (size_t t = 0; t < sizeof(s_transcripts) / sizeof(s_transcripts[0]); t++) {
+        const transcript_t *tr = &s_transcripts[t];
+        size_t len;
+        char *body = read_fixture(tr->fixture, &len);
+        if (!body) continue;
+        llm_set_provider(tr->provider);
+
+        CHECK_EQ_INT(replay(tr, body, len, 0, 0), 0);
+        /* Every line, UTF-8 sequence and chunk header split at every byte */
+        CHECK_EQ_INT(replay(tr, body, len, 0, 1), 0);
+        int failed = 0;
+        for (unsigned seed = 1; seed <= 300; seed++) {
+            if (replay(tr, body, len, seed, 64) != 0) {
+                if (!failed) fprintf(stderr, "replay %s: seed %u differs\n", tr->fixture, seed);
+                failed++;
+            }
+        }
+        CHECK_EQ_INT(failed, 0);
+        free(body);
+    }
+    llm_set_provider("anthropic");
+}
+
+/* ── Direct path ──────────────────────────────────────────────── */
+
+/* The first text deltas of the Anthropic fixture, as one open chunk */
+static char *sse_prefix(const char *upto, char *want, size_t want_size)
+{
+    size_t len;
+    char *body = read_fixture("fixtures/sse_anthropic_tools.txt", &len);
+    if (!body) return NULL;
+    char *end = strstr(body, upto);
+    CHECK(end != NULL);
+    size_t cut = end ? (size_t)(end - body) + strlen(upto) : 0;
+
+    char *raw = malloc(cut + 128);
+    int n = snprintf(raw, cut + 128, "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                     "Transfer-Encoding: chunked\r\n\r\n%zx\r\n", cut);
+    memcpy(raw + n, body, cut);
+    raw[n + cut] = '\0';
+    free(body);
+    snprintf(want, want_size, "I'll check the \"notes\" folder");
+    return raw;
+}
+
+static esp_err_t ask_stream(token_sink_t *tokens)
+{
+    cJSON *messages = cJSON_CreateArray();
+    cJSON *m = cJSON_CreateObject();
+    cJSON_AddStringToObject(m, "role", "user");
+    cJSON_AddStringToObject(m, "content", "look around");
+    cJSON_AddItemToArray(messages, m);
+
+    llm_response_t resp;
+    esp_err_t err = llm_chat_stream("system", messages, NULL, on_token, tokens, &resp);
+    cJSON_Delete(messages);
+    llm_response_free(&resp);
+    return err;
+}
+
+/* The same guarantees over esp_http_client, without the proxy */
+static void test_direct(void)
+{
+    fake_transport_use_proxy(false);
+    fake_transport_reset();
+    llm_conn_pool_stats_t before, after;
+    llm_get_conn_pool_stats(&before);
+
+    queue_sized("one", 0);
+    queue_chunked("two", 7);
+    check_reply("one");
+    check_reply("two");
+    CHECK_EQ_INT(fake_transport_opens(), 1);
+
+    /* Dropped while idle, before any byte of the reply: retried once */
+    fake_transport_close_idle();
+    queue_sized("again", 0);
+    check_reply("again");
+    llm_get_conn_pool_stats(&after);
+    CHECK_EQ_INT(after.reconnects, before.reconnects + 1);
+    CHECK_EQ_INT(fake_transport_opens(), 2);
+
+    /* Closed mid-body: the read just ends, which is still an error */
+    const char *body = anthropic_body("cut");
+    char raw[512];
+    snprintf(raw, sizeof(raw), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n%.20s",
+             strlen(body), body);
+    queue_raw(raw, 0, true);
+    check_fails(ESP_ERR_INVALID_RESPONSE);
+    snprintf(raw, sizeof(raw), "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+             "%zx\r\n%s\r\n", strlen(body), body);
+    queue_raw(raw, 0, true);
+    check_fails(ESP_ERR_INVALID_RESPONSE);
+
+    /* A warm session reset mid-stream: the text that went out is not
+     * replayed from a retry, which the queued full reply would serve */
+    queue_sized("warm", 0);
+    check_reply("warm");
+    llm_get_conn_pool_stats(&before);
+    int opens = fake_transport_opens();
+    char want[64];
+    char *prefix = sse_prefix("folder\"}}\n\n", want, sizeof(want));
+    size_t len;
+    char *fixture = read_fixture("fixtures/sse_anthropic_tools.txt", &len);
+    char *full = fixture ? sse_response(fixture, len, 0) : NULL;
+    if (prefix && full) {
+        fake_transport_queue(&(fake_reply_t){ .data = prefix, .read_size = 200 });
+        fake_transport_queue(&(fake_reply_t){ .data = full });
+        token_sink_t tokens = {0};
+        CHECK_EQ_INT(ask_stream(&tokens), ESP_ERR_INVALID_RESPONSE);
+        CHECK_EQ_STR(tokens.text, want);
+        llm_get_conn_pool_stats(&after);
+        CHECK_EQ_INT(after.reconnects, before.reconnects);
+        CHECK_EQ_INT(fake_transport_opens(), opens);
+    }
+    free(prefix);
+    free(full);
+    free(fixture);
+    CHECK_EQ_INT(fake_transport_live(), 0);
+
+    fake_transport_reset();
+    queue_sized("recovered", 0);
+    check_reply("recovered");
+    fake_transport_use_proxy(true);
+}
+
+int main(void)
+{
+    CHECK_EQ_INT(llm_proxy_init(), ESP_OK);
+    fake_transport_reset();
+
+    test_warm_reuse();
+    test_reconnect_on_eof();
+    test_idle_eviction();
+    test_server_close();
+    test_truncated();
+    test_body_framing();
+    test_cache_breakpoints();
+    test_sse_replay();
+    test_direct();
+    return host_test_result("test_llm_proxy");
+}
@@ -0,0 +1,195 @@
+/*
+ * MCP tool provider over hundreds of synthetic tools from three servers:
+ * the registry's index reaches every tool on the right server, an index
+ * left stale by a server re-listing its tools never calls a tool on the
+ * wrong server, and a disconnected server's tools are gone. Ends with
+ * the cost of indexed versus by-name dispatch.
+ */
+#include "host_test.h"
+#include "agent/mcp_manager.h"
+#include "fakes/fake_mcp_env.h"
+#include "cJSON.h"
+#include "esp_timer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char *url;
+    const char *prefix;
+    int count;
+    int id;
+} source_t;
+
+static source_t s_src[] = {
+    { "ws://alpha", "alpha", 150 },
+    { "ws://beta",  "beta",  250 },
+    { "ws://gamma", "gamma", 100 },
+};
+#define SOURCES (int)(sizeof(s_src) / sizeof(s_src[0]))
+
+static const source_t *source_of(const char *tool)
+{
+    for (int i = 0; i < SOURCES; i++) {
+        size_t n = strlen(s_src[i].prefix);
+        if (strncmp(tool, s_src[i].prefix, n) == 0 && tool[n] == '_') return &s_src[i];
+    }
+    return NULL;
+}
+
+/* Names of the provider's spliced tools array, in index order */
+static int list_tools(char ***names)
+{
+    char *json = fake_registry_provider()->get_tools_json();
+    cJSON *arr = cJSON_Parse(json);
+    free(json);
+    int n = cJSON_GetArraySize(arr);
+    *names = calloc(n ? n : 1, sizeof(char *));
+    for (int i = 0; i < n; i++) {
+        (*names)[i] = strdup(cJSON_GetStringValue(
+            cJSON_GetObjectItem(cJSON_GetArrayItem(arr, i), "name")));
+    }
+    cJSON_Delete(arr);
+    return n;
+}
+
+static void free_names(char **names, int n)
+{
+    for (int i = 0; i < n; i++) free(names[i]);
+    free(names);
+}
+
+/* The tool ran, on the server that has it */
+static bool ran_on_owner(const char *tool, const char *out)
+{
+    char want[96];
+    snprintf(want, sizeof(want), "%s:%s", source_of(tool)->url, tool);
+    return strstr(out, want) != NULL && strstr(out, "unknown tool") == NULL;
+}
+
+static void test_index_reaches_every_tool(void)
+{
+    char **names;
+    int n = list_tools(&names);
+    CHECK_EQ_INT(n, 150 + 250 + 100);
+
+    const tool_provider_t *p = fake_registry_provider();
+    char out[256];
+    int ok = 0;
+    for (int i = 0; i < n; i++) {
+        if (p->execute_tool_at(i, names[i], "{}", out, sizeof(out)) == ESP_OK &&
+            ran_on_owner(names[i], out)) {
+            ok++;
+        }
+    }
+    CHECK_EQ_INT(ok, n);
+
+    CHECK_EQ_INT(p->execute_tool("beta_249", "{}", out, sizeof(out)), ESP_OK);
+    CHECK(ran_on_owner("beta_249", out));
+    CHECK_EQ_INT(p->execute_tool("beta_250", "{}", out, sizeof(out)), ESP_ERR_NOT_FOUND);
+    CHECK_EQ_INT(p->execute_tool_at(n, "gamma_000", "{}", out, sizeof(out)), ESP_ERR_NOT_FOUND);
+    free_names(names, n);
+}
+
+/* alpha drops its last 30 tools: every later index now points 30 tools
+ * further on, across server boundaries. A stale index must miss, and
+ * the by-name lookup it falls back to must still find the tool. */
+static void test_stale_index(void)
+{
+    char **old;
+    int n = list_tools(&old);
+    int rebuilds = fake_registry_rebuilds();
+
+    fake_mcp_serve("ws://alpha", "alpha", 0, 120);
+    fake_mcp_relist("ws://alpha");
+    CHECK(fake_registry_rebuilds() > rebuilds);
+
+    char **cur;
+    int m = list_tools(&cur);
+    CHECK_EQ_INT(m, n - 30);
+
+    const tool_provider_t *p = fake_registry_provider();
+    char out[256];
+    int hits = 0, misses = 0, wrong = 0, found = 0, gone = 0;
+    for (int i = 0; i < n; i++) {
+        esp_err_t err = p->execute_tool_at(i, old[i], "{}", out, sizeof(out));
+        if (err == ESP_OK) {
+            hits++;
+            if (i >= m || strcmp(cur[i], old[i]) != 0 || !ran_on_owner(old[i], out)) wrong++;
+        } else {
+            CHECK_EQ_INT(err, ESP_ERR_NOT_FOUND);
+            misses++;
+            err = p->execute_tool(old[i], "{}", out, sizeof(out));
+            if (err == ESP_OK && ran_on_owner(old[i], out)) found++;
+            else if (err == ESP_ERR_NOT_FOUND) gone++;
+        }
+    }
+    CHECK_EQ_INT(wrong, 0);
+    CHECK_EQ_INT(hits, 120);            /* alpha_000..119 kept their slots */
+    CHECK_EQ_INT(gone, 30);             /* alpha_120..149 */
+    CHECK_EQ_INT(found, misses - 30);   /* beta and gamma, by name */
+    free_names(old, n);
+    free_names(cur, m);
+}
+
+static void test_disconnect_drops_tools(void)
+{
+    int rebuilds = fake_registry_rebuilds();
+    CHECK_EQ_INT(mcp_manager_source_action(s_src[1].id, "disconnect"), ESP_OK);
+    CHECK(fake_registry_rebuilds() > rebuilds);
+
+    char **names;
+    int n = list_tools(&names);
+    CHECK_EQ_INT(n, 120 + 100);
+    for (int i = 0; i < n; i++) CHECK(source_of(names[i]) != &s_src[1]);
+    free_names(names, n);
+
+    char out[256];
+    const tool_provider_t *p = fake_registry_provider();
+    CHECK_EQ_INT(p->execute_tool("beta_000", "{}", out, sizeof(out)), ESP_ERR_NOT_FOUND);
+    CHECK_EQ_INT(p->execute_tool("gamma_099", "{}", out, sizeof(out)), ESP_OK);
+
+    CHECK_EQ_INT(mcp_manager_source_action(s_src[1].id, "connect"), ESP_OK);
+    n = list_tools(&names);
+    CHECK_EQ_INT(n, 120 + 250 + 100);
+    free_names(names, n);
+}
+
+static void bench_dispatch(void)
+{
+    char **names;
+    int n = list_tools(&names);
+    const tool_provider_t *p = fake_registry_provider();
+    char out[256];
+    const int rounds = 20000;
+
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++) p->execute_tool_at(n - 1, names[n - 1], "{}", out, sizeof(out));
+    double at_us = (double)(esp_timer_get_time() - t0) / rounds;
+
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++) p->execute_tool(names[n - 1], "{}", out, sizeof(out));
+    double name_us = (double)(esp_timer_get_time() - t0) / rounds;
+
+    BENCH("call tool %d of %d via index: %.2f us, by name: %.2f us (incl. fake RPC)",
+          n, n, at_us, name_us);
+    free_names(names, n);
+}
+
+int main(void)
+{
+    for (int i = 0; i < SOURCES; i++) fake_mcp_serve(s_src[i].url, s_src[i].prefix, 0, s_src[i].count);
+    CHECK_EQ_INT(mcp_manager_init(), ESP_OK);
+    CHECK(fake_registry_provider() != NULL);
+    for (int i = 0; i < SOURCES; i++) {
+        s_src[i].id = mcp_manager_add_source(s_src[i].prefix, "websocket", s_src[i].url, true);
+        CHECK(s_src[i].id > 0);
+    }
+    CHECK_EQ_INT(mcp_manager_start(), ESP_OK);
+
+    test_index_reaches_every_tool();
+    test_stale_index();
+    test_disconnect_drops_tools();
+    bench_dispatch();
+    return host_test_result("test_mcp_manager");
+}
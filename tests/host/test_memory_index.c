@@ -0,0 +1,77 @@
+/*
+ * Memory index: a hit read into a buffer shorter than the chunk ends on a
+ * whole UTF-8 character, whatever the buffer held before.
+ */
+#include "host_test.h"
+#include "memory/memory_index.h"
+#include "mimi_config.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Mixed one-, two-, three- and four-byte characters, no spaces inside */
+static const char s_note[] =
+    "garden:我们在花园里种了番茄和黄瓜,Grüße🌱还有很多花。"
+    "浇水每周两次,肥料每月一次🌻école,naïve,日本語のテキスト。\n";
+
+static bool utf8_whole(const char *s, size_t n)
+{
+    size_t i = 0;
+    while (i < n) {
+        uint8_t c = (uint8_t)s[i];
+        size_t len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+        if (len == 0 || i + len > n) return false;
+        for (size_t k = 1; k < len; k++) {
+            if (((uint8_t)s[i + k] & 0xC0) != 0x80) return false;
+        }
+        i += len;
+    }
+    return true;
+}
+
+static void test_read_hit_cut_short(void)
+{
+    FILE *f = fopen(MIMI_SPIFFS_MEMORY_DIR "/MEMORY.md", "w");
+    fputs(s_note, f);
+    fclose(f);
+    memory_index_note_write(MIMI_SPIFFS_MEMORY_DIR "/MEMORY.md");
+
+    memory_hit_t hit;
+    CHECK_EQ_INT(memory_index_search("garden", &hit, 1), 1);
+    CHECK_EQ_STR(hit.name, "MEMORY.md");
+    CHECK_EQ_INT(hit.offset, 0);
+    size_t full = strlen(s_note) - 1;       /* without the newline */
+    CHECK(hit.len >= full);
+
+    /* Every cut point, with stale bytes past what is read */
+    static const char fills[] = {'x', (char)0x80, (char)0xE6};
+    int bad = 0;
+    for (size_t size = 1; size <= full + 1; size++) {
+        for (size_t k = 0; k < sizeof(fills); k++) {
+            char buf[sizeof(s_note) + 8];
+            memset(buf, fills[k], sizeof(buf));
+            size_t n = memory_index_read_hit(&hit, buf, size);
+            size_t want = size - 1 < full ? size - 1 : full;
+            if (n > want || n + 3 < want || buf[n] != '\0' ||
+                memcmp(buf, s_note, n) != 0 || !utf8_whole(buf, n)) {
+                bad++;
+            }
+        }
+    }
+    CHECK_EQ_INT(bad, 0);
+
+    char buf[sizeof(s_note)];
+    CHECK_EQ_INT(memory_index_read_hit(&hit, buf, sizeof(buf)), full);
+}
+
+int main(void)
+{
+    host_fs_root(NULL);
+    mkdir(MIMI_SPIFFS_MEMORY_DIR, 0755);
+    CHECK_EQ_INT(memory_index_init(), ESP_OK);
+
+    test_read_hit_cut_short();
+    return host_test_result("test_memory_index");
+}
@@ -0,0 +1,183 @@
+/*
+ * Inbound priority inbox: priority order with aging, per-key counts past
+ * 255 queued messages of one chat, and a multi-producer stress run where
+ * plain and filtered consumers together take every message exactly once.
+ * Built with a deep inbox and short aging (see the Makefile).
+ */
+#include "host_test.h"
+#include "bus/message_bus.h"
+#include "mimi_config.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void push(const char *channel, const char *chat_id, const char *text)
+{
+    mimi_msg_t msg = {0};
+    strncpy(msg.channel, channel, sizeof(msg.channel) - 1);
+    strncpy(msg.chat_id, chat_id, sizeof(msg.chat_id) - 1);
+    msg.content = strdup(text);
+    CHECK_EQ_INT(message_bus_push_inbound(&msg), ESP_OK);
+}
+
+/* Pop one message and check its text */
+static void expect(const char *text)
+{
+    mimi_msg_t msg;
+    CHECK_EQ_INT(message_bus_pop_inbound(&msg, 100), ESP_OK);
+    CHECK_EQ_STR(msg.content, text);
+    free(msg.content);
+}
+
+static void test_priority_and_aging(void)
+{
+    push(MIMI_CHAN_SYSTEM, "cron", "cron1");
+    push(MIMI_CHAN_TELEGRAM, "t", "tg1");
+    push(MIMI_CHAN_WEBSOCKET, "w", "ws1");
+    expect("ws1");
+    expect("tg1");
+    expect("cron1");
+
+    /* An overdue background message goes ahead of fresh chat turns */
+    push(MIMI_CHAN_SYSTEM, "cron", "cron2");
+    usleep(5 * 1000);
+    push(MIMI_CHAN_TELEGRAM, "t", "tg2");
+    usleep((MIMI_BUS_INBOUND_AGE_MS + 20) * 1000);
+    push(MIMI_CHAN_WEBSOCKET, "w", "ws2");
+    expect("cron2");        /* oldest of the overdue heads */
+    expect("tg2");
+    expect("ws2");
+    CHECK_EQ_INT(message_bus_inbound_depth(), 0);
+}
+
+/* More messages of one chat than a uint8_t counts */
+static void test_deep_key(void)
+{
+    const int n = 300;
+    CHECK(MIMI_BUS_INBOUND_DEPTH >= n);
+    for (int i = 0; i < n; i++) push(MIMI_CHAN_TELEGRAM, "busy", "x");
+    CHECK_EQ_INT(message_bus_inbound_depth(), n);
+
+    int wrong = 0;
+    for (int left = n; left > 0; left--) {
+        wrong += !message_bus_inbound_contains(MIMI_CHAN_TELEGRAM, "busy");
+        mimi_msg_t msg;
+        CHECK_EQ_INT(message_bus_pop_inbound(&msg, 100), ESP_OK);
+        free(msg.content);
+    }
+    CHECK_EQ_INT(wrong, 0);
+    CHECK(!message_bus_inbound_contains(MIMI_CHAN_TELEGRAM, "busy"));
+    CHECK(!message_bus_inbound_has_channel(MIMI_CHAN_TELEGRAM));
+}
+
+/* ── Stress ────────────────────────────────────────────────────── */
+
+#define PRODUCERS   6
+#define PER_PRODUCER 4000
+#define CONSUMERS   4           /* the last two pop with a filter */
+
+static atomic_uchar s_seen[PRODUCERS][PER_PRODUCER];
+static atomic_int s_taken;
+static atomic_int s_dups;
+static atomic_bool s_done;
+
+static const char *const s_channels[] = {
+    MIMI_CHAN_WEBSOCKET, MIMI_CHAN_TELEGRAM, MIMI_CHAN_CLI, MIMI_CHAN_SYSTEM, "custom",
+};
+
+static void *producer(void *arg)
+{
+    int p = (int)(intptr_t)arg;
+    unsigned seed = (unsigned)p + 1;
+    for (int i = 0; i < PER_PRODUCER; i++) {
+        char chat[16], text[32];
+        snprintf(chat, sizeof(chat), "c%d", rand_r(&seed) % 40);
+        snprintf(text, sizeof(text), "%d:%d", p, i);
+        push(s_channels[(p + i) % 5], chat, text);
+        if (rand_r(&seed) % 64 == 0) usleep(100);
+    }
+    return NULL;
+}
+
+/* Filtered consumers take only odd-numbered chats */
+static bool odd_chat(const mimi_msg_t *msg, void *arg)
+{
+    (void)arg;
+    return atoi(msg->chat_id + 1) % 2 == 1;
+}
+
+static void *consumer(void *arg)
+{
+    bool filtered = (intptr_t)arg >= CONSUMERS - 2;
+    while (!atomic_load(&s_done)) {
+        mimi_msg_t msg;
+        esp_err_t err = filtered ? message_bus_pop_inbound_match(&msg, odd_chat, NULL, 20)
+                                 : message_bus_pop_inbound(&msg, 20);
+        if (err != ESP_OK) continue;
+
+        int p = -1, i = -1;
+        CHECK(sscanf(msg.content, "%d:%d", &p, &i) == 2);
+        if (filtered) CHECK(odd_chat(&msg, NULL));
+        if (p >= 0 && p < PRODUCERS && i >= 0 && i < PER_PRODUCER) {
+            if (atomic_fetch_add(&s_seen[p][i], 1) != 0) atomic_fetch_add(&s_dups, 1);
+        }
+        free(msg.content);
+        atomic_fetch_add(&s_taken, 1);
+    }
+    return NULL;
+}
+
+/* Queries race the producers and consumers; they must only stay sane */
+static void *observer(void *arg)
+{
+    (void)arg;
+    while (!atomic_load(&s_done)) {
+        int depth = message_bus_inbound_depth();
+        CHECK(depth >= 0 && depth <= MIMI_BUS_INBOUND_DEPTH);
+        message_bus_inbound_contains(MIMI_CHAN_TELEGRAM, "c7");
+        message_bus_inbound_has_channel("custom");
+        message_bus_inbound_wake();
+    }
+    return NULL;
+}
+
+static void test_stress(void)
+{
+    pthread_t prod[PRODUCERS], cons[CONSUMERS], obs;
+    for (int c = 0; c < CONSUMERS; c++) pthread_create(&cons[c], NULL, consumer, (void *)(intptr_t)c);
+    pthread_create(&obs, NULL, observer, NULL);
+    for (int p = 0; p < PRODUCERS; p++) pthread_create(&prod[p], NULL, producer, (void *)(intptr_t)p);
+    for (int p = 0; p < PRODUCERS; p++) pthread_join(prod[p], NULL);
+
+    for (int waited = 0; atomic_load(&s_taken) < PRODUCERS * PER_PRODUCER && waited < 10000; waited++) {
+        usleep(1000);
+    }
+    atomic_store(&s_done, true);
+    for (int c = 0; c < CONSUMERS; c++) pthread_join(cons[c], NULL);
+    pthread_join(obs, NULL);
+
+    CHECK_EQ_INT(atomic_load(&s_taken), PRODUCERS * PER_PRODUCER);
+    CHECK_EQ_INT(atomic_load(&s_dups), 0);
+    int missing = 0;
+    for (int p = 0; p < PRODUCERS; p++) {
+        for (int i = 0; i < PER_PRODUCER; i++) missing += atomic_load(&s_seen[p][i]) == 0;
+    }
+    CHECK_EQ_INT(missing, 0);
+    CHECK_EQ_INT(message_bus_inbound_depth(), 0);
+    for (int k = 0; k < 5; k++) CHECK(!message_bus_inbound_has_channel(s_channels[k]));
+    CHECK(!message_bus_inbound_contains(MIMI_CHAN_TELEGRAM, "c7"));
+}
+
+int main(void)
+{
+    CHECK_EQ_INT(message_bus_init(), ESP_OK);
+    test_priority_and_aging();
+    test_deep_key();
+    test_stress();
+    return host_test_result("test_message_bus");
+}
@@ -0,0 +1,300 @@
+/*
+ * MP3 stream pipeline with a file source and a null sink: every frame of
+ * the file comes out, a source that stalls for less than the input ring
+ * holds plays without a gap, and ring levels read from a third task stay
+ * within the ring while both sides move. Ends with decode throughput.
+ *
+ * The source file is generated: silent MPEG-1 Layer III frames (128 kbps,
+ * 44.1 kHz, stereo) behind an ID3v2 tag, with a run of garbage between
+ * frames. The stream must produce what minimp3 decodes from the whole
+ * file in one buffer.
+ */
+#include "host_test.h"
+#include "audio/mp3_stream.h"
+#include "audio/spsc_ring.h"
+#include "mimi_config.h"
+#include "esp_timer.h"
+#include "audio/minimp3.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FRAMES          160
+#define FRAME_BYTES     417             /* 144 * 128000 / 44100, no padding */
+#define FRAME_SAMPLES   1152
+#define ID3_BYTES       (10 + 2048)
+#define GARBAGE_BYTES   300
+#define GARBAGE_AFTER   80              /* frame index */
+
+static char s_path[64];
+static int s_ref_frames;           /* what minimp3 decodes from the file in one buffer */
+static int s_ref_samples;
+
+static void write_fixture(void)
+{
+    snprintf(s_path, sizeof(s_path), "/tmp/mimi_mp3.XXXXXX");
+    int fd = mkstemp(s_path);
+    FILE *f = fdopen(fd, "wb");
+
+    /* ID3v2.3 header, syncsafe size of the zero padding after it */
+    uint8_t id3[10] = {'I', 'D', '3', 3, 0, 0, 0, 0, (ID3_BYTES - 10) >> 7, (ID3_BYTES - 10) & 0x7F};
+    fwrite(id3, 1, sizeof(id3), f);
+    for (int i = 0; i < ID3_BYTES - 10; i++) fputc(0, f);
+
+    /* Side info and main data all zero: no Huffman data, silence */
+    uint8_t frame[FRAME_BYTES] = {0xFF, 0xFB, 0x90, 0x00};
+    for (int i = 0; i < FRAMES; i++) {
+        fwrite(frame, 1, sizeof(frame), f);
+        if (i == GARBAGE_AFTER) {
+            for (int k = 0; k < GARBAGE_BYTES; k++) fputc(0x55, f);
+        }
+    }
+    fclose(f);
+}
+
+static void decode_reference(void)
+{
+    FILE *f = fopen(s_path, "rb");
+    static uint8_t file[ID3_BYTES + FRAMES * FRAME_BYTES + GARBAGE_BYTES];
+    size_t len = fread(file, 1, sizeof(file), f);
+    fclose(f);
+
+    static mp3dec_t dec;
+    static int16_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+    mp3dec_init(&dec);
+    for (size_t off = 0; off < len;) {
+        mp3dec_frame_info_t info;
+        int samples = mp3dec_decode_frame(&dec, file + off, (int)(len - off), pcm, &info);
+        if (info.frame_bytes == 0) break;
+        off += info.frame_bytes;
+        if (samples) {
+            s_ref_frames++;
+            s_ref_samples += samples;
+        }
+    }
+}
+
+/* ── File source, null sink ───────────────────────────────────── */
+
+typedef struct {
+    FILE *f;
+    int stall_every;            /* reads between source stalls, 0 = never */
+    int stall_ms;
+    int reads;
+    int speed;                  /* sink pace as a multiple of real time, 0 = unpaced */
+    int rate;
+    int64_t samples;
+    int64_t begun_us;
+    atomic_int done;
+} io_ctx_t;
+
+static esp_err_t src_open(void *ctx)
+{
+    io_ctx_t *c = ctx;
+    c->f = fopen(s_path, "rb");
+    return c->f ? ESP_OK : ESP_FAIL;
+}
+
+static int src_read(void *ctx, uint8_t *buf, size_t len)
+{
+    io_ctx_t *c = ctx;
+    if (c->stall_every && ++c->reads % c->stall_every == 0) usleep(c->stall_ms * 1000);
+    if (len > 1460) len = 1460;             /* one TCP segment */
+    return (int)fread(buf, 1, len, c->f);
+}
+
+static void src_close(void *ctx)
+{
+    io_ctx_t *c = ctx;
+    if (c->f) fclose(c->f);
+    c->f = NULL;
+}
+
+static esp_err_t sink_begin(void *ctx, int sample_rate)
+{
+    io_ctx_t *c = ctx;
+    c->rate = sample_rate;
+    c->begun_us = esp_timer_get_time();
+    return ESP_OK;
+}
+
+/* Paced like I2S: returns when the device would have played the samples */
+static esp_err_t sink_write(void *ctx, const int16_t *pcm, size_t samples)
+{
+    io_ctx_t *c = ctx;
+    (void)pcm;
+    c->samples += samples;
+    if (c->speed && c->rate) {
+        int64_t due = c->begun_us + c->samples * 1000000 / ((int64_t)c->rate * c->speed);
+        int64_t now = esp_timer_get_time();
+        if (due > now) usleep((useconds_t)(due - now));
+    }
+    return ESP_OK;
+}
+
+static void on_done(void *ctx)
+{
+    atomic_fetch_add(&((io_ctx_t *)ctx)->done, 1);
+}
+
+static void play(io_ctx_t *c, mp3_stream_stats_t *st)
+{
+    mp3_stream_io_t io = {
+        .ctx = c,
+        .open = src_open, .read = src_read, .close = src_close,
+        .begin = sink_begin, .write = sink_write, .done = on_done,
+    };
+    CHECK_EQ_INT(mp3_stream_start(&io), ESP_OK);
+    CHECK(mp3_stream_wait(20000));
+    mp3_stream_get_stats(st);
+    CHECK_EQ_INT(atomic_load(&c->done), 1);
+}
+
+static void check_whole_file(const io_ctx_t *c, const mp3_stream_stats_t *st)
+{
+    CHECK_EQ_INT(st->frames_decoded, s_ref_frames);
+    CHECK_EQ_INT(st->samples_out, s_ref_samples);
+    CHECK_EQ_INT(c->samples, s_ref_samples);
+    CHECK_EQ_INT(st->sample_rate, 44100);
+    CHECK_EQ_INT(st->bytes_fetched, ID3_BYTES + FRAMES * FRAME_BYTES + GARBAGE_BYTES);
+}
+
+static void test_throughput(void)
+{
+    io_ctx_t c = {0};
+    mp3_stream_stats_t st;
+    int64_t t0 = esp_timer_get_time();
+    play(&c, &st);
+    int64_t us = esp_timer_get_time() - t0;
+    check_whole_file(&c, &st);
+
+    double audio_s = (double)FRAMES * FRAME_SAMPLES / 44100;
+    BENCH("mp3 file -> null sink: %d frames in %lld ms, %.0fx real time, decode avg %u us max %u us",
+          FRAMES, (long long)(us / 1000), audio_s * 1e6 / us,
+          st.frames_decoded ? st.decode_us_total / st.frames_decoded : 0, st.decode_us_max);
+}
+
+/* Source stalls well inside the input ring's depth are absorbed */
+static void test_no_glitch_through_stalls(void)
+{
+    io_ctx_t c = {.stall_every = 12, .stall_ms = 40, .speed = 4};
+    mp3_stream_stats_t st;
+    play(&c, &st);
+    check_whole_file(&c, &st);
+    CHECK_EQ_INT(st.pcm_underruns, 0);
+    CHECK_EQ_INT(st.in_underruns, 0);
+    CHECK(st.in_level_min > 0);
+    BENCH("paced %dx, %d ms stall every %d reads: underruns in/pcm %u/%u, min input level %u",
+          c.speed, c.stall_ms, c.stall_every, st.in_underruns, st.pcm_underruns, st.in_level_min);
+}
+
+/* A source stalled past the whole input ring is one counted gap, not a
+ * hang or a lost frame */
+static void test_long_stall_counts_gap(void)
+{
+    io_ctx_t c = {.stall_every = 40, .stall_ms = 600, .speed = 4};
+    mp3_stream_stats_t st;
+    play(&c, &st);
+    check_whole_file(&c, &st);
+    CHECK(st.pcm_underruns >= 1);
+}
+
+/* ── Ring levels from a third task ────────────────────────────── */
+
+#define RING_SIZE   4096
+#define RING_MS     1500
+
+static spsc_ring_t s_ring;
+static atomic_bool s_ring_stop;
+static atomic_bool s_ring_done;
+static atomic_size_t s_ring_sent;
+static atomic_int s_ring_out_of_range;
+static atomic_long s_ring_samples;
+
+static void *ring_producer(void *arg)
+{
+    (void)arg;
+    unsigned seed = 1;
+    uint8_t chunk[512];
+    size_t sent = 0;
+    while (!atomic_load(&s_ring_stop)) {
+        size_t n = 1 + rand_r(&seed) % sizeof(chunk);
+        for (size_t i = 0; i < n; i++) chunk[i] = (uint8_t)(sent + i);
+        size_t w = spsc_ring_write(&s_ring, chunk, n);
+        sent += w;
+        if (w < n) sched_yield();
+    }
+    atomic_store(&s_ring_sent, sent);
+    return NULL;
+}
+
+static void *ring_consumer(void *arg)
+{
+    (void)arg;
+    unsigned seed = 2;
+    size_t got = 0;
+    int bad = 0;
+    for (;;) {
+        bool stopped = atomic_load(&s_ring_stop);
+        const uint8_t *p;
+        size_t n = spsc_ring_read_span(&s_ring, 1 + rand_r(&seed) % 700, &p);
+        for (size_t i = 0; i < n; i++) bad += p[i] != (uint8_t)(got + i);
+        spsc_ring_consume(&s_ring, n);
+        got += n;
+        if (n == 0) {
+            if (stopped && got == atomic_load(&s_ring_sent)) break;
+            sched_yield();
+        }
+    }
+    atomic_store(&s_ring_done, true);
+    return (void *)(intptr_t)bad;
+}
+
+static void *ring_observer(void *arg)
+{
+    (void)arg;
+    while (!atomic_load(&s_ring_done)) {
+        size_t level = spsc_ring_level(&s_ring);
+        size_t space = spsc_ring_space(&s_ring);
+        if (level > RING_SIZE || space > RING_SIZE) atomic_fetch_add(&s_ring_out_of_range, 1);
+        atomic_fetch_add(&s_ring_samples, 1);
+    }
+    return NULL;
+}
+
+static void test_ring_level_from_third_task(void)
+{
+    CHECK_EQ_INT(spsc_ring_init(&s_ring, RING_SIZE, 700), ESP_OK);
+    pthread_t prod, cons, obs[2];
+    for (int i = 0; i < 2; i++) pthread_create(&obs[i], NULL, ring_observer, NULL);
+    pthread_create(&cons, NULL, ring_consumer, NULL);
+    pthread_create(&prod, NULL, ring_producer, NULL);
+
+    usleep(RING_MS * 1000);
+    atomic_store(&s_ring_stop, true);
+    void *bad;
+    pthread_join(prod, NULL);
+    pthread_join(cons, &bad);
+    for (int i = 0; i < 2; i++) pthread_join(obs[i], NULL);
+    CHECK_EQ_INT((intptr_t)bad, 0);
+    CHECK_EQ_INT(atomic_load(&s_ring_out_of_range), 0);
+    CHECK_EQ_INT(spsc_ring_level(&s_ring), 0);
+    CHECK(atomic_load(&s_ring_sent) > 0 && atomic_load(&s_ring_samples) > 0);
+    spsc_ring_free(&s_ring);
+}
+
+int main(void)
+{
+    write_fixture();
+    decode_reference();
+    test_ring_level_from_third_task();
+    test_throughput();
+    test_no_glitch_through_stalls();
+    test_long_stall_counts_gap();
+    remove(s_path);
+    return host_test_result("test_mp3_stream");
+}
@@ -0,0 +1,341 @@
+/*
+ * Session manager over a synthetic long session: history compaction
+ * summarizes every record exactly once, through cache evictions, log
+ * rotations and resets in the middle of a summary save. Then the damage
+ * a reset leaves in the JSONL log: an unreadable record does not shift
+ * the window against the summary, and an append after a torn final line
+ * is not lost with it. Records that left before the cache loaded are
+ * still summarized over. A tool turn longer than the message cap stays
+ * whole, from the cache and from flash, and a restart inside the write-behind delay
+ * still persists what was queued.
+ */
+#include "host_test.h"
+#include "memory/session_mgr.h"
+#include "mimi_config.h"
+#include "cJSON.h"
+#include "esp_system.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SUMMARY_PREFIX  "[Summary of our earlier conversation]\n"
+
+static int s_round;
+
+/* Record n of a test session: alternating roles, numbered content */
+static void append_n(const char *chat, int n)
+{
+    char text[96];
+    snprintf(text, sizeof(text), "m%05d and some filler so the window holds a few dozen", n);
+    CHECK_EQ_INT(session_append(chat, n % 2 ? "assistant" : "user", text), ESP_OK);
+}
+
+static int msg_number(const cJSON *msg)
+{
+    const char *text = cJSON_GetStringValue(cJSON_GetObjectItem(msg, "content"));
+    return text && text[0] == 'm' ? atoi(text + 1) : -1;
+}
+
+/* Push the session out of the cache, so the next read goes to flash */
+static void evict(void)
+{
+    session_flush();
+    session_cache_stats_t before, after;
+    session_get_cache_stats(&before);
+    for (int i = 0; i < MIMI_SESSION_CACHE_SLOTS; i++) {
+        char idle[32];
+        snprintf(idle, sizeof(idle), "idle%d_%d", s_round, i);
+        cJSON_Delete(session_get_history(idle, 1, 0, NULL));
+    }
+    s_round++;
+    session_get_cache_stats(&after);
+    CHECK(after.evictions > before.evictions);
+}
+
+/* A reset between summary_save()'s remove and rename */
+static void interrupt_summary_save(const char *chat)
+{
+    char sum[64], tmp[64];
+    snprintf(sum, sizeof(sum), "%s/%s.sum", MIMI_SPIFFS_SESSION_DIR, chat);
+    snprintf(tmp, sizeof(tmp), "%s/%s.tmp", MIMI_SPIFFS_SESSION_DIR, chat);
+    CHECK_EQ_INT(rename(sum, tmp), 0);
+}
+
+/* History as message numbers; *through is what the summary says it
+ * covers, -1 without one */
+static int history(const char *chat, int max_tokens, bool *outgrown, int *nums, int *through)
+{
+    cJSON *arr = session_get_history(chat, MIMI_SESSION_MAX_MSGS, max_tokens, outgrown);
+    int count = 0;
+    *through = -1;
+    const cJSON *msg;
+    cJSON_ArrayForEach(msg, arr) {
+        const char *text = cJSON_GetStringValue(cJSON_GetObjectItem(msg, "content"));
+        if (text && strncmp(text, SUMMARY_PREFIX, strlen(SUMMARY_PREFIX)) == 0) {
+            sscanf(text + strlen(SUMMARY_PREFIX), "through %d", through);
+        } else if (msg_number(msg) >= 0) {
+            nums[count++] = msg_number(msg);
+        }
+    }
+    cJSON_Delete(arr);
+    return count;
+}
+
+static void test_long_session(void)
+{
+    const char *chat = "long";
+    int summarized = 0;         /* every record below this has been summarized */
+    int compactions = 0, rotations = 0;
+
+    for (int turn = 0; turn < 600; turn++) {
+        append_n(chat, 2 * turn);
+        append_n(chat, 2 * turn + 1);
+
+        if (turn % 37 == 36) {
+            if (turn % 3 == 0) interrupt_summary_save(chat);
+            evict();
+        }
+        if (turn % 97 == 96) {
+            session_flush();
+            int dropped = 0;
+            CHECK_EQ_INT(session_rotate(chat, 2048, &dropped), ESP_OK);
+            CHECK(dropped > 0);
+            rotations++;
+        }
+
+        int nums[MIMI_SESSION_MAX_MSGS];
+        int through;
+        bool outgrown = false;
+        int n = history(chat, 300, &outgrown, nums, &through);
+
+        /* Newest last, no gaps, nothing the summary already covers */
+        CHECK(n > 0 && nums[n - 1] == 2 * turn + 1);
+        for (int i = 1; i < n; i++) CHECK_EQ_INT(nums[i], nums[i - 1] + 1);
+        if (compactions) {
+            CHECK_EQ_INT(through, summarized);
+            CHECK(n > 0 && nums[0] >= through);
+        }
+        if (!outgrown) continue;
+
+        char *old = NULL;
+        cJSON *msgs = NULL;
+        uint32_t upto = 0;
+        CHECK_EQ_INT(session_compact_begin(chat, &old, &msgs, &upto), ESP_OK);
+        /* Picks up exactly where the last summary ended */
+        int first = msg_number(cJSON_GetArrayItem(msgs, 0));
+        int last = msg_number(cJSON_GetArrayItem(msgs, cJSON_GetArraySize(msgs) - 1));
+        CHECK_EQ_INT(first, summarized);
+        CHECK(last >= first);
+        CHECK_EQ_INT(cJSON_GetArraySize(msgs), last - first + 1);
+        if (compactions) {
+            int old_through = -1;
+            CHECK(old && sscanf(old, "through %d", &old_through) == 1);
+            CHECK_EQ_INT(old_through, summarized);
+        }
+
+        char summary[32];
+        snprintf(summary, sizeof(summary), "through %d", last + 1);
+        CHECK_EQ_INT(session_compact_end(chat, summary, upto), ESP_OK);
+        summarized = last + 1;
+        compactions++;
+        free(old);
+        cJSON_Delete(msgs);
+    }
+    CHECK(compactions > 50);
+    CHECK_EQ_INT(rotations, 6);
+}
+
+/* Record `n` of the JSONL log no longer parses */
+static void damage_record(const char *chat, int n)
+{
+    char path[64], needle[16];
+    snprintf(path, sizeof(path), "%s/%s.jsonl", MIMI_SPIFFS_SESSION_DIR, chat);
+    snprintf(needle, sizeof(needle), "\"m%05d ", n);
+    FILE *f = fopen(path, "r+b");
+    char buf[8192];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[len] = '\0';
+    char *at = strstr(buf, needle);
+    CHECK(at != NULL);
+    while (at && at > buf && at[-1] != '\n') at--;
+    if (at) {
+        fseek(f, at - buf, SEEK_SET);
+        fputc('#', f);
+    }
+    fclose(f);
+}
+
+static void test_unreadable_record(void)
+{
+    const char *chat = "gap";
+    for (int i = 0; i < 30; i++) append_n(chat, i);
+    cJSON_Delete(session_get_history(chat, 1, 0, NULL));
+    CHECK_EQ_INT(session_compact_end(chat, "through 10", 10), ESP_OK);
+    evict();
+    damage_record(chat, 20);
+    damage_record(chat, 24);
+
+    int nums[MIMI_SESSION_MAX_MSGS];
+    int through;
+    int n = history(chat, 0, NULL, nums, &through);
+    CHECK_EQ_INT(through, 10);
+    CHECK_EQ_INT(n, 18);
+    for (int i = 0, want = 10; i < n; i++, want++) {
+        if (want == 20 || want == 24) want++;
+        CHECK_EQ_INT(nums[i], want);
+    }
+}
+
+static void test_torn_tail(void)
+{
+    const char *chat = "torn";
+    for (int i = 0; i < 4; i++) append_n(chat, i);
+    evict();
+
+    /* A reset in the middle of writing record 4 */
+    FILE *f = fopen(MIMI_SPIFFS_SESSION_DIR "/torn.jsonl", "ab");
+    fputs("{\"role\":\"user\",\"content\":\"m00004 and so", f);
+    fclose(f);
+
+    append_n(chat, 4);
+    append_n(chat, 5);
+    evict();
+    /* The index is rebuilt from the log, as after a rotation */
+    CHECK_EQ_INT(remove(MIMI_SPIFFS_SESSION_DIR "/torn.idx"), 0);
+
+    int nums[MIMI_SESSION_MAX_MSGS];
+    int through;
+    int n = history(chat, 0, NULL, nums, &through);
+    CHECK_EQ_INT(n, 6);
+    for (int i = 0; i < n; i++) CHECK_EQ_INT(nums[i], i);
+}
+
+/* Loaded after the session grew past the cache: nothing was summarized
+ * and every cached message fits the window, yet records came before it */
+static void test_gap_before_cache(void)
+{
+    const char *chat = "grown";
+    for (int i = 0; i < 60; i++) append_n(chat, i);
+    evict();
+
+    bool outgrown = false;
+    int nums[MIMI_SESSION_MAX_MSGS];
+    int through;
+    int n = history(chat, 0, &outgrown, nums, &through);
+    CHECK_EQ_INT(n, MIMI_SESSION_MAX_MSGS);
+    CHECK(outgrown);
+
+    /* The oldest cached turn is folded in, past the gap */
+    char *summary;
+    cJSON *msgs;
+    uint32_t upto;
+    CHECK_EQ_INT(session_compact_begin(chat, &summary, &msgs, &upto), ESP_OK);
+    CHECK(summary == NULL);
+    CHECK_EQ_INT(cJSON_GetArraySize(msgs), 2);
+    CHECK_EQ_INT(msg_number(cJSON_GetArrayItem(msgs, 0)), 20);
+    CHECK_EQ_INT(upto, 22);
+    cJSON_Delete(msgs);
+    CHECK_EQ_INT(session_compact_end(chat, "through 21", upto), ESP_OK);
+
+    n = history(chat, 0, &outgrown, nums, &through);
+    CHECK(!outgrown);
+    CHECK_EQ_INT(through, 21);
+    CHECK_EQ_INT(n, 38);
+    CHECK_EQ_INT(nums[0], 22);
+}
+
+/* One tool round trip of an agent turn */
+static void append_tool_round(const char *chat, int i)
+{
+    char id[16];
+    snprintf(id, sizeof(id), "t%d", i);
+    cJSON *use = cJSON_CreateObject();
+    cJSON_AddStringToObject(use, "role", "assistant");
+    cJSON *block = cJSON_CreateObject();
+    cJSON_AddStringToObject(block, "type", "tool_use");
+    cJSON_AddStringToObject(block, "id", id);
+    cJSON_AddStringToObject(block, "name", "get_time");
+    cJSON_AddItemToObject(block, "input", cJSON_CreateObject());
+    cJSON_AddItemToArray(cJSON_AddArrayToObject(use, "content"), block);
+    CHECK_EQ_INT(session_append_message(chat, use), ESP_OK);
+    cJSON_Delete(use);
+
+    cJSON *result = cJSON_CreateObject();
+    cJSON_AddStringToObject(result, "role", "user");
+    block = cJSON_CreateObject();
+    cJSON_AddStringToObject(block, "type", "tool_result");
+    cJSON_AddStringToObject(block, "tool_use_id", id);
+    cJSON_AddStringToObject(block, "content", "12:00");
+    cJSON_AddItemToArray(cJSON_AddArrayToObject(result, "content"), block);
+    CHECK_EQ_INT(session_append_message(chat, result), ESP_OK);
+    cJSON_Delete(result);
+}
+
+/* The whole history opens on message `open` and holds `count` messages */
+static void check_window(const char *chat, int open, int count)
+{
+    cJSON *arr = session_get_history(chat, MIMI_SESSION_MAX_MSGS, 0, NULL);
+    CHECK_EQ_INT(cJSON_GetArraySize(arr), count);
+    CHECK_EQ_INT(msg_number(cJSON_GetArrayItem(arr, 0)), open);
+    cJSON_Delete(arr);
+}
+
+/* A turn at the tool iteration limit outgrows the message cap */
+static void test_long_turn(void)
+{
+    const char *chat = "tools";
+    int rounds = (MIMI_SESSION_TURN_MAX_MSGS - 2) / 2;
+    int turn = 2 * rounds + 2;
+    CHECK(turn > MIMI_SESSION_MAX_MSGS);
+
+    for (int i = 0; i < 10; i++) append_n(chat, i);
+    append_n(chat, 10);
+    for (int i = 0; i < rounds; i++) append_tool_round(chat, i);
+    append_n(chat, 11);
+    check_window(chat, 10, turn);
+
+    /* Loaded back from flash, the window reaches past the cap for it */
+    evict();
+    check_window(chat, 10, turn);
+
+    /* The next turn pushes it out whole, not its opening message alone */
+    append_n(chat, 12);
+    append_n(chat, 13);
+    check_window(chat, 12, 2);
+    evict();
+    check_window(chat, 12, 2);
+}
+
+/* Restarts reboot well inside MIMI_SESSION_FLUSH_MS */
+static void test_restart_flushes(void)
+{
+    const char *chat = "restart";
+    append_n(chat, 0);
+    append_n(chat, 1);
+    host_shutdown();
+
+    char buf[512] = {0};
+    FILE *f = fopen(MIMI_SPIFFS_SESSION_DIR "/restart.jsonl", "rb");
+    CHECK(f != NULL);
+    if (f) {
+        fread(buf, 1, sizeof(buf) - 1, f);
+        fclose(f);
+    }
+    CHECK(strstr(buf, "m00000") != NULL);
+    CHECK(strstr(buf, "m00001") != NULL);
+}
+
+int main(void)
+{
+    host_fs_root(NULL);
+    mkdir(MIMI_SPIFFS_SESSION_DIR, 0755);
+    CHECK_EQ_INT(session_mgr_init(), ESP_OK);
+
+    test_long_session();
+    test_unreadable_record();
+    test_torn_tail();
+    test_gap_before_cache();
+    test_long_turn();
+    test_restart_flushes();
+    return host_test_result("test_session_mgr");
+}
@@ -0,0 +1,135 @@
+/*
+ * write_file / edit_file: edits from several workers on one file all
+ * land, temp files sit next to their target, and an edit cut short by a
+ * reset is undone by tool_files_init().
+ */
+#include "host_test.h"
+#include "tools/tool_files.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void put(const char *path, const char *text)
+{
+    FILE *f = fopen(path, "w");
+    fputs(text, f);
+    fclose(f);
+}
+
+static char *get(const char *path)
+{
+    static char buf[4096];
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[n] = '\0';
+    fclose(f);
+    return buf;
+}
+
+static bool exists(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+static esp_err_t edit(const char *path, const char *from, const char *to)
+{
+    char input[256], out[256];
+    snprintf(input, sizeof(input),
+             "{\"path\":\"%s\",\"old_string\":\"%s\",\"new_string\":\"%s\"}", path, from, to);
+    return tool_edit_file_execute(input, out, sizeof(out));
+}
+
+/* Each thread bumps its own counter in the shared file; without the
+ * write lock, one edit copies the file while another swaps it and the
+ * other thread's change is lost */
+typedef struct {
+    char tag;
+    int failures;
+} editor_t;
+
+#define EDITS 60
+
+static void *editor(void *arg)
+{
+    editor_t *e = arg;
+    for (int i = 0; i < EDITS; i++) {
+        char from[16], to[16];
+        snprintf(from, sizeof(from), "%c=%d;", e->tag, i);
+        snprintf(to, sizeof(to), "%c=%d;", e->tag, i + 1);
+        if (edit("/spiffs/memory/shared.md", from, to) != ESP_OK) e->failures++;
+    }
+    return NULL;
+}
+
+static void test_concurrent_edits(void)
+{
+    put("/spiffs/memory/shared.md", "A=0;\nB=0;\nC=0;\n");
+    editor_t eds[3] = {{'A', 0}, {'B', 0}, {'C', 0}};
+    pthread_t th[3];
+    for (int i = 0; i < 3; i++) pthread_create(&th[i], NULL, editor, &eds[i]);
+    for (int i = 0; i < 3; i++) {
+        pthread_join(th[i], NULL);
+        CHECK_EQ_INT(eds[i].failures, 0);
+    }
+    CHECK_EQ_STR(get("/spiffs/memory/shared.md"), "A=60;\nB=60;\nC=60;\n");
+    CHECK(!exists("/spiffs/memory/shared.md.tmp~"));
+    CHECK(!exists("/spiffs/memory/shared.md.bak~"));
+}
+
+static void test_write_and_edit(void)
+{
+    char out[256];
+    CHECK_EQ_INT(tool_write_file_execute("{\"path\":\"/spiffs/notes/a.txt\",\"content\":\"hello world\"}",
+                                         out, sizeof(out)), ESP_OK);
+    CHECK_EQ_INT(edit("/spiffs/notes/a.txt", "world", "there"), ESP_OK);
+    CHECK_EQ_STR(get("/spiffs/notes/a.txt"), "hello there");
+    CHECK_EQ_INT(edit("/spiffs/notes/a.txt", "absent", "x"), ESP_ERR_NOT_FOUND);
+    CHECK(!exists("/spiffs/notes/a.txt.tmp~"));
+    CHECK_EQ_INT(edit("/spiffs/notes/missing.txt", "a", "b"), ESP_ERR_NOT_FOUND);
+}
+
+static void test_boot_recovery(void)
+{
+    /* Reset between moving the original aside and swapping the copy in */
+    put("/spiffs/memory/MEMORY.md.bak~", "original");
+    put("/spiffs/memory/MEMORY.md.tmp~", "half edited");
+    /* Reset after the swap, before the original was removed */
+    put("/spiffs/config/USER.md", "edited");
+    put("/spiffs/config/USER.md.bak~", "old");
+    /* A file the user named like this is left alone */
+    put("/spiffs/notes/bak~", "keep");
+
+    tool_files_init();
+
+    CHECK_EQ_STR(get("/spiffs/memory/MEMORY.md"), "original");
+    CHECK(!exists("/spiffs/memory/MEMORY.md.bak~"));
+    CHECK(!exists("/spiffs/memory/MEMORY.md.tmp~"));
+    CHECK_EQ_STR(get("/spiffs/config/USER.md"), "edited");
+    CHECK(!exists("/spiffs/config/USER.md.bak~"));
+    CHECK_EQ_STR(get("/spiffs/notes/bak~"), "keep");
+}
+
+int main(void)
+{
+    const char *root = host_fs_root(NULL);
+    char dir[300];
+    const char *subdirs[] = {"memory", "config", "notes"};
+    for (int i = 0; i < 3; i++) {
+        snprintf(dir, sizeof(dir), "%s/%s", root, subdirs[i]);
+        mkdir(dir, 0755);
+    }
+
+    tool_files_init();
+    test_write_and_edit();
+    test_concurrent_edits();
+    test_boot_recovery();
+
+    char cmd[300];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", root);
+    if (system(cmd) != 0) fprintf(stderr, "could not remove %s\n", root);
+    return host_test_result("test_tool_files");
+}
@@ -0,0 +1,236 @@
+/*
+ * Tool pool against a provider whose tools sleep: parallel-safe calls of
+ * one round overlap on the workers, an exclusive call runs with nothing
+ * else in flight, and every output lands in its own buffer in call order.
+ * Ends with the real get_current_time racing set_timezone.
+ */
+#include "host_test.h"
+#include "agent/tool_pool.h"
+#include "tools/tool_registry.h"
+#include "mimi_config.h"
+#include "cJSON.h"
+#include "esp_timer.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SLEEP_MS    100
+
+static atomic_int s_in_flight;
+static atomic_int s_max_in_flight;
+static atomic_int s_overlapped;         /* exclusive calls that saw company */
+static _Atomic int64_t s_started_us[MIMI_MAX_TOOL_CALLS + 1];
+static _Atomic int64_t s_finished_us[MIMI_MAX_TOOL_CALLS + 1];
+
+static int64_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+/* Input {"i":n}; records when call n ran and answers with its tool and n */
+static esp_err_t sleepy_call(const char *name, const char *input, char *out, size_t size)
+{
+    cJSON *root = cJSON_Parse(input);
+    int i = cJSON_GetObjectItem(root, "i") ? cJSON_GetObjectItem(root, "i")->valueint : 0;
+    cJSON_Delete(root);
+
+    int in = atomic_fetch_add(&s_in_flight, 1) + 1;
+    int max = atomic_load(&s_max_in_flight);
+    while (in > max && !atomic_compare_exchange_weak(&s_max_in_flight, &max, in)) {}
+    atomic_store(&s_started_us[i], esp_timer_get_time());
+
+    usleep(SLEEP_MS * 1000);
+
+    atomic_store(&s_finished_us[i], esp_timer_get_time());
+    atomic_fetch_sub(&s_in_flight, 1);
+    snprintf(out, size, "%s:%d", name, i);
+    return ESP_OK;
+}
+
+static char *net_tools_json(void)
+{
+    return strdup("[{\"name\":\"net_fetch\",\"description\":\"Fetch.\","
+                  "\"input_schema\":{\"type\":\"object\",\"properties\":{}}}]");
+}
+
+static esp_err_t net_execute(const char *name, const char *input, char *out, size_t size)
+{
+    if (strcmp(name, "net_fetch") != 0) return ESP_ERR_NOT_FOUND;
+    return sleepy_call(name, input, out, size);
+}
+
+static char *hw_tools_json(void)
+{
+    return strdup("[{\"name\":\"hw_move\",\"description\":\"Move.\","
+                  "\"input_schema\":{\"type\":\"object\",\"properties\":{}}}]");
+}
+
+static esp_err_t hw_execute(const char *name, const char *input, char *out, size_t size)
+{
+    if (strcmp(name, "hw_move") != 0) return ESP_ERR_NOT_FOUND;
+    if (atomic_load(&s_in_flight) != 0) atomic_fetch_add(&s_overlapped, 1);
+    esp_err_t err = sleepy_call(name, input, out, size);
+    if (atomic_load(&s_in_flight) != 0) atomic_fetch_add(&s_overlapped, 1);
+    return err;
+}
+
+static const tool_provider_t s_net = {
+    .name = "net",
+    .get_tools_json = net_tools_json,
+    .execute_tool = net_execute,
+    .parallel_safe = true,
+};
+
+static const tool_provider_t s_hw = {
+    .name = "hw",
+    .get_tools_json = hw_tools_json,
+    .execute_tool = hw_execute,
+};
+
+/* One round of calls; names[k] gets input {"i":k} and an output buffer
+ * sized differently from its neighbours */
+static int64_t run_round(const char *const *names, int count, char out[][64], tool_job_t *jobs)
+{
+    static char inputs[MIMI_MAX_TOOL_CALLS + 1][16];
+    memset(s_started_us, 0, sizeof(s_started_us));
+    memset(s_finished_us, 0, sizeof(s_finished_us));
+    atomic_store(&s_max_in_flight, 0);
+
+    for (int k = 0; k < count; k++) {
+        snprintf(inputs[k], sizeof(inputs[k]), "{\"i\":%d}", k);
+        memset(out[k], '#', 64);
+        jobs[k] = (tool_job_t){
+            .name = names[k],
+            .input_json = inputs[k],
+            .output = out[k],
+            .output_size = 24 + 6 * k,
+            .err = ESP_FAIL,
+        };
+    }
+    int64_t start = now_ms();
+    tool_pool_run(jobs, count);
+    return now_ms() - start;
+}
+
+static void check_outputs(const char *const *names, int count, char out[][64], tool_job_t *jobs)
+{
+    for (int k = 0; k < count; k++) {
+        char want[32];
+        snprintf(want, sizeof(want), "%s:%d", names[k], k);
+        CHECK_EQ_INT(jobs[k].err, ESP_OK);
+        CHECK_EQ_STR(out[k], want);
+        /* Nothing written past the buffer the job was given */
+        CHECK(out[k][jobs[k].output_size] == '#');
+    }
+}
+
+static void test_parallel_round(void)
+{
+    const char *names[MIMI_MAX_TOOL_CALLS];
+    for (int k = 0; k < MIMI_MAX_TOOL_CALLS; k++) names[k] = "net_fetch";
+    char out[MIMI_MAX_TOOL_CALLS][64];
+    tool_job_t jobs[MIMI_MAX_TOOL_CALLS];
+
+    int64_t ms = run_round(names, MIMI_MAX_TOOL_CALLS, out, jobs);
+    check_outputs(names, MIMI_MAX_TOOL_CALLS, out, jobs);
+
+    /* The caller plus every worker; a serial run would take count * SLEEP_MS */
+    int lanes = MIMI_TOOL_WORKERS + 1;
+    int waves = (MIMI_MAX_TOOL_CALLS + lanes - 1) / lanes;
+    CHECK_EQ_INT(atomic_load(&s_max_in_flight),
+                 lanes < MIMI_MAX_TOOL_CALLS ? lanes : MIMI_MAX_TOOL_CALLS);
+    CHECK(ms < waves * SLEEP_MS + SLEEP_MS / 2);
+    BENCH("%d x %d ms parallel-safe calls: %lld ms (serial %d ms)",
+          MIMI_MAX_TOOL_CALLS, SLEEP_MS, (long long)ms, MIMI_MAX_TOOL_CALLS * SLEEP_MS);
+}
+
+/* An exclusive call splits the round: the calls before it finish first,
+ * the ones after start after it */
+static void test_exclusive_barrier(void)
+{
+    const char *names[] = {"net_fetch", "net_fetch", "hw_move", "net_fetch", "net_fetch"};
+    const int count = 5, hw = 2;
+    CHECK(count <= MIMI_MAX_TOOL_CALLS + 1);
+    char out[5][64];
+    tool_job_t jobs[5];
+
+    int64_t ms = run_round(names, count, out, jobs);
+    check_outputs(names, count, out, jobs);
+
+    CHECK_EQ_INT(atomic_load(&s_overlapped), 0);
+    for (int k = 0; k < count; k++) {
+        if (k < hw) CHECK(atomic_load(&s_finished_us[k]) <= atomic_load(&s_started_us[hw]));
+        if (k > hw) CHECK(atomic_load(&s_started_us[k]) >= atomic_load(&s_finished_us[hw]));
+    }
+    /* Both halves still overlap: three sleeps, not five */
+    CHECK(ms < 3 * SLEEP_MS + SLEEP_MS / 2);
+}
+
+/* ── get_current_time alongside set_timezone ──────────────────── */
+
+static atomic_bool s_stop;
+
+static void *timezone_flipper(void *arg)
+{
+    (void)arg;
+    static const char *const zones[][2] = {{"UTC0", " UTC ("}, {"CST-8", " CST ("}};
+    for (int n = 0; !atomic_load(&s_stop); n++) {
+        char input[48], out[128];
+        snprintf(input, sizeof(input), "{\"timezone\":\"%s\"}", zones[n % 2][0]);
+        CHECK_EQ_INT(tool_registry_execute("set_timezone", input, out, sizeof(out)), ESP_OK);
+        /* The time it reports is in the zone it just set */
+        const char *time = strstr(out, "Current time: ");
+        CHECK(time && strstr(time, zones[n % 2][1]) != NULL);
+    }
+    return NULL;
+}
+
+static void test_time_while_setting_zone(void)
+{
+    char out0[128];
+    CHECK_EQ_INT(tool_registry_execute("set_timezone", "{\"timezone\":\"UTC0\"}", out0, sizeof(out0)), ESP_OK);
+    pthread_t flipper;
+    pthread_create(&flipper, NULL, timezone_flipper, NULL);
+
+    int bad = 0;
+    for (int round = 0; round < 2000; round++) {
+        char out[MIMI_MAX_TOOL_CALLS][64];
+        tool_job_t jobs[MIMI_MAX_TOOL_CALLS];
+        for (int k = 0; k < MIMI_MAX_TOOL_CALLS; k++) {
+            jobs[k] = (tool_job_t){
+                .name = "get_current_time", .input_json = "{}",
+                .output = out[k], .output_size = sizeof(out[k]),
+            };
+        }
+        tool_pool_run(jobs, MIMI_MAX_TOOL_CALLS);
+        for (int k = 0; k < MIMI_MAX_TOOL_CALLS; k++) {
+            int y, mo, d, h, mi, s;
+            char zone[8];
+            if (jobs[k].err != ESP_OK ||
+                sscanf(out[k], "%d-%d-%d %d:%d:%d %7s (", &y, &mo, &d, &h, &mi, &s, zone) != 7 ||
+                (strcmp(zone, "UTC") != 0 && strcmp(zone, "CST") != 0)) {
+                bad++;
+            }
+        }
+    }
+    atomic_store(&s_stop, true);
+    pthread_join(flipper, NULL);
+    CHECK_EQ_INT(bad, 0);
+    CHECK(tool_registry_is_parallel_safe("get_current_time"));
+}
+
+int main(void)
+{
+    CHECK_EQ_INT(tool_registry_init(), ESP_OK);
+    CHECK_EQ_INT(tool_registry_register_provider(&s_net), ESP_OK);
+    CHECK_EQ_INT(tool_registry_register_provider(&s_hw), ESP_OK);
+    CHECK_EQ_INT(tool_pool_start(), ESP_OK);
+
+    test_parallel_round();
+    test_exclusive_barrier();
+    test_time_while_setting_zone();
+    return host_test_result("test_tool_pool");
+}
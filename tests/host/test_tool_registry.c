@@ -0,0 +1,288 @@
+/*
+ * Tool registry: schema blobs stay pinned across invalidations, provider
+ * schemas are rendered without the registry lock, and the dispatch index
+ * routes to the right tool. Ends with a schema-cache microbenchmark.
+ */
+#include "host_test.h"
+#include "tools/tool_registry.h"
+#include "cJSON.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PROVIDER_TOOLS  200
+
+static atomic_int s_render_delay_ms;
+static atomic_int s_last_index = -1;
+
+static char *fake_get_tools_json(void)
+{
+    int delay = atomic_load(&s_render_delay_ms);
+    if (delay) usleep(delay * 1000);
+
+    cJSON *arr = cJSON_CreateArray();
+    for (int i = 0; i < PROVIDER_TOOLS; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "remote_tool_%03d", i);
+        cJSON *t = cJSON_CreateObject();
+        cJSON_AddStringToObject(t, "name", name);
+        cJSON_AddStringToObject(t, "description", "A synthetic remote tool.");
+        cJSON *schema = cJSON_AddObjectToObject(t, "input_schema");
+        cJSON_AddStringToObject(schema, "type", "object");
+        cJSON *props = cJSON_AddObjectToObject(schema, "properties");
+        cJSON_AddStringToObject(cJSON_AddObjectToObject(props, "arg"), "type", "string");
+        cJSON_AddItemToArray(arr, t);
+    }
+    char *json = cJSON_PrintUnformatted(arr);
+    cJSON_Delete(arr);
+    return json;
+}
+
+static esp_err_t fake_execute(const char *name, const char *input, char *out, size_t size)
+{
+    (void)input;
+    if (strncmp(name, "remote_tool_", 12) != 0) return ESP_ERR_NOT_FOUND;
+    snprintf(out, size, "scan:%s", name);
+    return ESP_OK;
+}
+
+static esp_err_t fake_execute_at(int index, const char *name, const char *input,
+                                 char *out, size_t size)
+{
+    (void)input;
+    atomic_store(&s_last_index, index);
+    snprintf(out, size, "at:%d:%s", index, name);
+    return ESP_OK;
+}
+
+static const tool_provider_t s_fake_provider = {
+    .name = "fake",
+    .get_tools_json = fake_get_tools_json,
+    .execute_tool = fake_execute,
+    .execute_tool_at = fake_execute_at,
+    .parallel_safe = true,
+};
+
+static esp_err_t extra_tool(const char *input, char *out, size_t size)
+{
+    (void)input;
+    snprintf(out, size, "extra");
+    return ESP_OK;
+}
+
+static const mimi_tool_t s_extra = {
+    .name = "extra_tool",
+    .description = "Registered and unregistered while requests are in flight.",
+    .input_schema_json = "{\"type\":\"object\",\"properties\":{}}",
+    .execute = extra_tool,
+};
+
+static void test_pinned_blob_survives_rebuilds(void)
+{
+    const char *pinned = tool_registry_acquire_tools_json();
+    CHECK(pinned != NULL);
+    char *copy = strdup(pinned);
+    const char *openai = tool_registry_get_tools_blob(pinned, TOOL_SCHEMA_OPENAI);
+    CHECK(openai != NULL);
+    char *openai_copy = strdup(openai);
+
+    /* Several generations come and go while the first set is held */
+    for (int i = 0; i < 6; i++) {
+        if (i % 2 == 0) tool_registry_register(&s_extra);
+        else tool_registry_unregister(s_extra.name);
+        const char *fresh = tool_registry_acquire_tools_json();
+        CHECK(fresh != NULL && fresh != pinned);
+        tool_registry_release_tools_json(fresh);
+    }
+
+    CHECK_EQ_STR(pinned, copy);
+    CHECK_EQ_STR(tool_registry_get_tools_blob(pinned, TOOL_SCHEMA_OPENAI), openai_copy);
+    tool_registry_release_tools_json(pinned);
+    /* Released and superseded: no longer a registry blob */
+    CHECK(tool_registry_get_tools_blob(pinned, TOOL_SCHEMA_OPENAI) == NULL);
+    CHECK(tool_registry_get_tools_blob("[]", TOOL_SCHEMA_OPENAI) == NULL);
+
+    /* With nothing changed, callers share one set */
+    const char *a = tool_registry_acquire_tools_json();
+    const char *b = tool_registry_acquire_tools_json();
+    CHECK(a == b);
+    tool_registry_release_tools_json(a);
+    tool_registry_release_tools_json(b);
+
+    free(copy);
+    free(openai_copy);
+}
+
+static void test_blob_contents(void)
+{
+    const char *json = tool_registry_acquire_tools_json();
+    cJSON *arr = cJSON_Parse(json);
+    CHECK(cJSON_IsArray(arr));
+    int builtin = 0, remote = 0;
+    cJSON *t;
+    cJSON_ArrayForEach(t, arr) {
+        const char *name = cJSON_GetStringValue(cJSON_GetObjectItem(t, "name"));
+        if (name && strncmp(name, "remote_tool_", 12) == 0) remote++;
+        else builtin++;
+    }
+    CHECK_EQ_INT(remote, PROVIDER_TOOLS);
+    CHECK(builtin > 20);
+    cJSON_Delete(arr);
+
+    cJSON *oa = cJSON_Parse(tool_registry_get_tools_blob(json, TOOL_SCHEMA_OPENAI));
+    CHECK_EQ_INT(cJSON_GetArraySize(oa), builtin + remote);
+    cJSON *first = cJSON_GetArrayItem(oa, 0);
+    CHECK_EQ_STR(cJSON_GetStringValue(cJSON_GetObjectItem(first, "type")), "function");
+    CHECK(cJSON_GetObjectItem(cJSON_GetObjectItem(first, "function"), "parameters") != NULL);
+    cJSON_Delete(oa);
+    tool_registry_release_tools_json(json);
+}
+
+static void test_dispatch(void)
+{
+    char out[128];
+    CHECK_EQ_INT(tool_registry_execute("read_file", "{}", out, sizeof(out)), ESP_OK);
+    CHECK_EQ_STR(out, "tool_read_file_execute");
+
+    CHECK_EQ_INT(tool_registry_execute("remote_tool_123", "{}", out, sizeof(out)), ESP_OK);
+    CHECK_EQ_STR(out, "at:123:remote_tool_123");
+    CHECK_EQ_INT(atomic_load(&s_last_index), 123);
+
+    CHECK_EQ_INT(tool_registry_execute("no_such_tool", "{}", out, sizeof(out)), ESP_ERR_NOT_FOUND);
+
+    CHECK(tool_registry_is_parallel_safe("read_file"));
+    CHECK(!tool_registry_is_parallel_safe("write_file"));
+    CHECK(tool_registry_is_parallel_safe("remote_tool_007"));
+
+    /* Unregistering a built-in shifts s_tools[]; tools after it still resolve */
+    tool_registry_unregister("web_search");
+    CHECK_EQ_INT(tool_registry_execute("cron_list", "{}", out, sizeof(out)), ESP_OK);
+    CHECK_EQ_STR(out, "tool_cron_list_execute");
+    CHECK_EQ_INT(tool_registry_execute("web_search", "{}", out, sizeof(out)), ESP_ERR_NOT_FOUND);
+}
+
+/* A slow provider render must not hold the registry lock */
+static void *slow_acquire(void *arg)
+{
+    (void)arg;
+    const char *json = tool_registry_acquire_tools_json();
+    tool_registry_release_tools_json(json);
+    return NULL;
+}
+
+static void test_render_outside_lock(void)
+{
+    atomic_store(&s_render_delay_ms, 300);
+    tool_registry_rebuild_json();
+
+    pthread_t th;
+    pthread_create(&th, NULL, slow_acquire, NULL);
+    usleep(50 * 1000);      /* let it get into the provider */
+
+    int64_t t0 = esp_timer_get_time();
+    tool_registry_register(&s_extra);
+    int64_t took = esp_timer_get_time() - t0;
+    CHECK(took < 100 * 1000);
+
+    pthread_join(th, NULL);
+    atomic_store(&s_render_delay_ms, 0);
+    tool_registry_unregister(s_extra.name);
+}
+
+/* Readers hold blobs across a simulated request while a writer churns
+ * the registry; run under ASan this catches any early free. */
+static atomic_bool s_stop;
+
+static void *reader(void *arg)
+{
+    unsigned long *sum = arg;
+    while (!atomic_load(&s_stop)) {
+        const char *json = tool_registry_acquire_tools_json();
+        const char *oa = tool_registry_get_tools_blob(json, TOOL_SCHEMA_OPENAI);
+        usleep(200);
+        *sum += strlen(json) + (oa ? strlen(oa) : 0);
+        tool_registry_release_tools_json(json);
+    }
+    return NULL;
+}
+
+static void test_concurrent_churn(void)
+{
+    pthread_t th[4];
+    unsigned long sums[4] = {0};
+    atomic_store(&s_stop, false);
+    for (int i = 0; i < 4; i++) pthread_create(&th[i], NULL, reader, &sums[i]);
+    for (int i = 0; i < 200; i++) {
+        if (i % 2 == 0) tool_registry_register(&s_extra);
+        else tool_registry_unregister(s_extra.name);
+        usleep(300);
+    }
+    atomic_store(&s_stop, true);
+    for (int i = 0; i < 4; i++) {
+        pthread_join(th[i], NULL);
+        CHECK(sums[i] > 0);
+    }
+}
+
+static void bench_schema_cache(void)
+{
+    const int rounds = 200;
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++) {
+        tool_registry_rebuild_json();
+        tool_registry_release_tools_json(tool_registry_acquire_tools_json());
+    }
+    double miss_us = (double)(esp_timer_get_time() - t0) / rounds;
+
+    const int hits = 200000;
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < hits; i++) {
+        tool_registry_release_tools_json(tool_registry_acquire_tools_json());
+    }
+    double hit_ns = (double)(esp_timer_get_time() - t0) * 1000.0 / hits;
+
+    /* What each request paid before the cache: fetch and re-render */
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++) {
+        char *json = fake_get_tools_json();
+        cJSON *arr = cJSON_Parse(json);
+        char *out = cJSON_PrintUnformatted(arr);
+        cJSON_Delete(arr);
+        free(out);
+        free(json);
+    }
+    double uncached_us = (double)(esp_timer_get_time() - t0) / rounds;
+
+    char out[64];
+    const int lookups = 100000;
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < lookups; i++) {
+        tool_registry_execute("remote_tool_199", "{}", out, sizeof(out));
+    }
+    double exec_ns = (double)(esp_timer_get_time() - t0) * 1000.0 / lookups;
+
+    BENCH("schema render (miss): %.1f us", miss_us);
+    BENCH("schema acquire+release (hit): %.0f ns", hit_ns);
+    BENCH("provider render per request without cache: %.1f us", uncached_us);
+    BENCH("indexed dispatch of tool %d of %d: %.0f ns", PROVIDER_TOOLS, PROVIDER_TOOLS, exec_ns);
+}
+
+int main(void)
+{
+    tool_registry_init();
+    tool_registry_register_provider(&s_fake_provider);
+
+    test_pinned_blob_survives_rebuilds();
+    test_blob_contents();
+    test_dispatch();
+    test_render_outside_lock();
+    test_concurrent_churn();
+    bench_schema_cache();
+    return host_test_result("test_tool_registry");
+}
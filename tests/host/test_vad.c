@@ -0,0 +1,369 @@
+/*
+ * VAD over labelled WAV fixtures, fed in mic-read blocks as
+ * record_utterance does: utterances found, false starts, frame accuracy
+ * against the labels and how long after the labelled end the endpoint
+ * fires. Ends with CPU per frame.
+ *
+ * The fixtures are generated: syllables of formant-filtered pulse trains
+ * with fricatives and gaps between them, over a quiet room, a fan hum,
+ * broadband hiss, a quiet room that turns into a fan part way, and soft
+ * speech. They are written out as 16-bit WAV and read back like any other
+ * recording. More recordings can be passed on the command line, each
+ * with a .txt beside it holding one "start end" sample pair per line.
+ */
+#include "host_test.h"
+#include "audio/vad.h"
+#include "mimi_config.h"
+#include "esp_timer.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RATE        24000
+#define BLOCK       512                 /* samples per mic read */
+#define SECONDS     40
+#define MAX_SEGS    32
+
+typedef struct {
+    size_t start, end;                  /* samples */
+} seg_t;
+
+typedef struct {
+    const char *name;
+    int noise;
+    double speech_level;
+    int min_found;                      /* labelled utterances that must start */
+    int max_false;
+    int min_acc_pct;
+    int end_max_ms;                     /* 0 = endpoint plus one mic read */
+} fixture_t;
+
+enum { NOISE_QUIET, NOISE_FAN, NOISE_HISS, NOISE_STEP };
+
+static const fixture_t s_fixtures[] = {
+    {"quiet", NOISE_QUIET, 14000, 6, 0, 90},
+    {"fan",   NOISE_FAN,   14000, 5, 0, 90},
+    {"hiss",  NOISE_HISS,  14000, 4, 0, 70},
+    /* An utterance across the step holds until the floor has crept up
+     * to the fan, well inside the recording cap */
+    {"step",  NOISE_STEP,  14000, 4, 1, 75, MIMI_VOICE_MAX_RECORD_MS / 2},
+    {"soft",  NOISE_QUIET, 4500,  6, 0, 90},
+};
+#define FIXTURE_COUNT   (sizeof(s_fixtures) / sizeof(s_fixtures[0]))
+
+/* ── Fixture generation ───────────────────────────────────────── */
+
+static uint32_t s_rng;
+
+static double urand(void)
+{
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return (s_rng >> 8) / 16777216.0;
+}
+
+static double grand(void)
+{
+    double u = urand() + 1e-12, v = urand();
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+/* Two-pole resonator, one formant */
+typedef struct {
+    double b0, a1, a2, y1, y2;
+} reso_t;
+
+static void reso_set(reso_t *r, double hz, double bw)
+{
+    double radius = exp(-M_PI * bw / RATE);
+    *r = (reso_t){.b0 = 1 - radius, .a1 = 2 * radius * cos(2 * M_PI * hz / RATE), .a2 = -radius * radius};
+}
+
+static double reso(reso_t *r, double x)
+{
+    double y = r->b0 * x + r->a1 * r->y1 + r->a2 * r->y2;
+    r->y2 = r->y1;
+    r->y1 = y;
+    return y;
+}
+
+/* One utterance of 1.2-3.2 s from `at`; returns where it ends */
+static size_t utterance(double *buf, size_t at, size_t max, double level)
+{
+    size_t t = at;
+    size_t end = at + (size_t)((1.2 + urand() * 2.0) * RATE);
+    while (t < end && t < max) {
+        if (urand() < 0.25) {                   /* fricative: differenced noise */
+            size_t len = (size_t)((0.05 + urand() * 0.07) * RATE);
+            double prev = 0;
+            for (size_t i = 0; i < len && t < max; i++, t++) {
+                double x = grand();
+                buf[t] += (x - prev) * level * 0.5 * sin(M_PI * i / len);
+                prev = x;
+            }
+        }
+        size_t len = (size_t)((0.12 + urand() * 0.15) * RATE);
+        double f0 = 100 + urand() * 120, phase = 0;
+        double gain = level * (0.6 + 0.8 * urand());
+        reso_t f1, f2;
+        reso_set(&f1, 400 + urand() * 500, 80);
+        reso_set(&f2, 1100 + urand() * 1200, 120);
+        for (size_t i = 0; i < len && t < max; i++, t++) {
+            double pulse = 0;
+            phase += f0 / RATE;
+            if (phase >= 1) {
+                phase -= 1;
+                pulse = 1;
+            }
+            buf[t] += (reso(&f1, pulse) * 8 + reso(&f2, pulse) * 4) * gain * sin(M_PI * i / len);
+        }
+        t += (size_t)((0.03 + urand() * 0.09) * RATE);     /* gap inside a word */
+    }
+    return t < max ? t : max;
+}
+
+static double noise_sample(int kind, size_t i, double *lp)
+{
+    double x = grand();
+    double hum = 400 * sin(2 * M_PI * 100 * i / RATE);
+    switch (kind) {
+    case NOISE_FAN:
+        *lp += 0.05 * (x - *lp);
+        return 4000 * *lp + hum + 200 * sin(2 * M_PI * 200 * i / RATE);
+    case NOISE_HISS:
+        return 900 * x;
+    case NOISE_STEP:
+        *lp += 0.05 * (x - *lp);
+        return i < (size_t)SECONDS * RATE * 3 / 8 ? 60 * x : 4000 * *lp + hum;
+    default:
+        return 60 * x;
+    }
+}
+
+static void put32(FILE *f, uint32_t v)
+{
+    fwrite(&v, 4, 1, f);
+}
+
+static void put16(FILE *f, uint16_t v)
+{
+    fwrite(&v, 2, 1, f);
+}
+
+static void write_wav(const char *path, const int16_t *pcm, size_t n)
+{
+    FILE *f = fopen(path, "wb");
+    fwrite("RIFF", 1, 4, f);
+    put32(f, 36 + n * 2);
+    fwrite("WAVEfmt ", 1, 8, f);
+    put32(f, 16);
+    put16(f, 1);                    /* PCM */
+    put16(f, 1);                    /* mono */
+    put32(f, RATE);
+    put32(f, RATE * 2);
+    put16(f, 2);
+    put16(f, 16);
+    fwrite("data", 1, 4, f);
+    put32(f, n * 2);
+    fwrite(pcm, 2, n, f);
+    fclose(f);
+}
+
+static void generate(const char *dir, int index)
+{
+    const fixture_t *fx = &s_fixtures[index];
+    size_t n = (size_t)SECONDS * RATE;
+    double *buf = calloc(n, sizeof(double));
+    s_rng = 1234 + index;
+
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s.txt", dir, fx->name);
+    FILE *labels = fopen(path, "w");
+    for (size_t t = 3 * RATE; t + 4 * RATE < n;) {
+        size_t end = utterance(buf, t, n, fx->speech_level);
+        fprintf(labels, "%zu %zu\n", t, end);
+        t = end + (size_t)((2.5 + urand() * 2.5) * RATE);
+    }
+    fclose(labels);
+
+    int16_t *pcm = malloc(n * sizeof(int16_t));
+    double lp = 0;
+    for (size_t i = 0; i < n; i++) {
+        double v = buf[i] + noise_sample(fx->noise, i, &lp);
+        pcm[i] = (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+    }
+    snprintf(path, sizeof(path), "%s/%s.wav", dir, fx->name);
+    write_wav(path, pcm, n);
+    free(pcm);
+    free(buf);
+}
+
+/* ── Reading recordings back ──────────────────────────────────── */
+
+/* 16-bit mono PCM samples of a WAV file; other chunks are skipped */
+static int16_t *read_wav(const char *path, size_t *n, uint32_t *rate)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    uint8_t hdr[12], chunk[8];
+    int16_t *pcm = NULL;
+    bool pcm16 = false;
+    if (fread(hdr, 1, 12, f) != 12 || memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0) {
+        fclose(f);
+        return NULL;
+    }
+    while (!pcm && fread(chunk, 1, 8, f) == 8) {
+        uint32_t len = chunk[4] | chunk[5] << 8 | chunk[6] << 16 | (uint32_t)chunk[7] << 24;
+        if (memcmp(chunk, "fmt ", 4) == 0 && len >= 16) {
+            uint8_t fmt[16];
+            if (fread(fmt, 1, 16, f) != 16) break;
+            *rate = fmt[4] | fmt[5] << 8 | fmt[6] << 16 | (uint32_t)fmt[7] << 24;
+            pcm16 = fmt[0] == 1 && fmt[2] == 1 && fmt[14] == 16;
+            fseek(f, (long)(len - 16 + (len & 1)), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0 && pcm16) {
+            *n = len / 2;
+            pcm = malloc(*n * sizeof(int16_t) + 1);
+            *n = fread(pcm, 2, *n, f);
+        } else {
+            fseek(f, (long)(len + (len & 1)), SEEK_CUR);
+        }
+    }
+    fclose(f);
+    return pcm;
+}
+
+static int read_labels(const char *wav_path, seg_t *segs)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%.*s.txt", (int)(strlen(wav_path) - 4), wav_path);
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    int count = 0;
+    while (count < MAX_SEGS && fscanf(f, "%zu %zu", &segs[count].start, &segs[count].end) == 2) count++;
+    fclose(f);
+    return count;
+}
+
+static int seg_at(const seg_t *segs, int count, size_t i)
+{
+    for (int k = 0; k < count; k++) {
+        if (i >= segs[k].start && i < segs[k].end) return k;
+    }
+    return -1;
+}
+
+/* ── Scoring ──────────────────────────────────────────────────── */
+
+typedef struct {
+    int labelled, found, false_starts, endpoints;
+    int acc_pct;
+    double end_avg_ms, end_max_ms;
+    int64_t us;
+    long frames;
+} score_t;
+
+static bool score(const char *path, score_t *s)
+{
+    size_t n = 0;
+    uint32_t rate = 0;
+    int16_t *pcm = read_wav(path, &n, &rate);
+    seg_t segs[MAX_SEGS];
+    memset(s, 0, sizeof(*s));
+    s->labelled = read_labels(path, segs);
+    if (!pcm || !rate || !s->labelled) {
+        free(pcm);
+        return false;
+    }
+
+    vad_config_t cfg;
+    vad_config_default(&cfg, rate);
+    vad_t vad;
+    vad_init(&vad, &cfg, 0);
+
+    bool found[MAX_SEGS] = {0};
+    int current = -1;
+    long agree = 0, blocks = 0;
+    double end_sum = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (size_t i = 0; i + BLOCK <= n; i += BLOCK) {
+        vad_event_t ev = vad_process(&vad, pcm + i, BLOCK);
+        size_t at = i + BLOCK;
+        int k = seg_at(segs, s->labelled, at);
+        if (ev == VAD_EVENT_START) {
+            if (k >= 0) found[k] = true;
+            else s->false_starts++;
+            current = k;
+        } else if (ev == VAD_EVENT_END) {
+            if (current >= 0) {
+                double ms = ((double)at - (double)segs[current].end) * 1000 / rate;
+                end_sum += ms;
+                if (ms > s->end_max_ms) s->end_max_ms = ms;
+                s->endpoints++;
+            }
+            current = -1;
+        }
+        agree += (k >= 0) == vad_in_speech(&vad);
+        blocks++;
+    }
+    s->us = esp_timer_get_time() - t0;
+    s->frames = (long)(n / (rate * cfg.frame_ms / 1000));
+
+    for (int k = 0; k < s->labelled; k++) s->found += found[k];
+    s->acc_pct = blocks ? (int)(100 * agree / blocks) : 0;
+    s->end_avg_ms = s->endpoints ? end_sum / s->endpoints : 0;
+    free(pcm);
+    return true;
+}
+
+static void report(const char *name, const score_t *s)
+{
+    BENCH("%-8s %d/%d utterances, %d false starts, frame accuracy %3d%%, endpoint +%3.0f ms avg (max %3.0f)",
+          name, s->found, s->labelled, s->false_starts, s->acc_pct, s->end_avg_ms, s->end_max_ms);
+}
+
+int main(int argc, char **argv)
+{
+    char dir[] = "/tmp/mimi_vad.XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+
+    int64_t us = 0;
+    long frames = 0;
+    for (size_t i = 0; i < FIXTURE_COUNT; i++) {
+        const fixture_t *fx = &s_fixtures[i];
+        generate(dir, (int)i);
+        char path[128];
+        snprintf(path, sizeof(path), "%s/%s.wav", dir, fx->name);
+        score_t s;
+        CHECK(score(path, &s));
+        report(fx->name, &s);
+        us += s.us;
+        frames += s.frames;
+
+        CHECK(s.found >= fx->min_found);
+        CHECK(s.false_starts <= fx->max_false);
+        CHECK(s.acc_pct >= fx->min_acc_pct);
+        /* Every utterance that started also ended, the endpoint after it */
+        CHECK_EQ_INT(s.endpoints, s.found);
+        CHECK(s.end_avg_ms >= MIMI_VOICE_ENDPOINT_MS - MIMI_VAD_HANGOVER_MS);
+        CHECK(s.end_max_ms <= (fx->end_max_ms ? fx->end_max_ms : MIMI_VOICE_ENDPOINT_MS + 100));
+
+        remove(path);
+        snprintf(path, sizeof(path), "%s/%s.txt", dir, fx->name);
+        remove(path);
+    }
+    rmdir(dir);
+
+    for (int a = 1; a < argc; a++) {
+        score_t s;
+        if (!score(argv[a], &s)) {
+            BENCH("%s: not 16-bit mono PCM WAV or no labels", argv[a]);
+            continue;
+        }
+        report(argv[a], &s);
+    }
+
+    BENCH("CPU: %.0f ns per %d ms frame on the host", frames ? us * 1000.0 / frames : 0.0, MIMI_VAD_FRAME_MS);
+    return host_test_result("test_vad");
+}
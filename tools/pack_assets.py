@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""Pack a directory into the read-only "assets" partition image.
+
+Layout (little endian), read by main/assets/asset_store.c:
+
+    header   magic 'MAST', version, entry count, total size,
+             CRC32 of everything after the header
+    index    one 64-byte entry per file, sorted by name:
+             name[40], offset, stored size, raw size, etag, flags, reserved
+    blobs    file contents, 4-byte aligned; gzip'd when that is smaller
+
+The etag is the CRC32 of the raw content, so it changes only when the
+file does.
+
+Usage: pack_assets.py <asset_dir> <out.bin> [--size <partition bytes>]
+"""
+
+import argparse
+import gzip
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = 0x5453414D          # 'MAST'
+VERSION = 1
+HEADER = struct.Struct('<IHHII')
+ENTRY = struct.Struct('<40sIIIIII')
+NAME_MAX = 39
+FLAG_GZIP = 1 << 0
+
+# Already compressed, or too small to be worth it
+STORE_EXT = {'.png', '.jpg', '.jpeg', '.gif', '.webp', '.gz', '.mp3', '.woff2'}
+
+
+def align4(n):
+    return (n + 3) & ~3
+
+
+def collect(root):
+    files = []
+    for base, dirs, names in os.walk(root):
+        dirs.sort()
+        for name in sorted(names):
+            if name.startswith('.'):
+                continue
+            path = os.path.join(base, name)
+            rel = os.path.relpath(path, root).replace(os.sep, '/')
+            if len(rel.encode()) > NAME_MAX:
+                sys.exit(f'pack_assets: name too long (max {NAME_MAX}): {rel}')
+            with open(path, 'rb') as f:
+                files.append((rel, f.read()))
+    files.sort(key=lambda item: item[0].encode())
+    return files
+
+
+def pack(files):
+    index_end = HEADER.size + ENTRY.size * len(files)
+    offset = align4(index_end)
+    entries = []
+    blobs = bytearray()
+
+    for name, raw in files:
+        stored, flags = raw, 0
+        if os.path.splitext(name)[1].lower() not in STORE_EXT:
+            gz = gzip.compress(raw, compresslevel=9, mtime=0)
+            if len(gz) < len(raw):
+                stored, flags = gz, FLAG_GZIP
+        entries.append(ENTRY.pack(name.encode(), offset, len(stored), len(raw),
+                                  zlib.crc32(raw), flags, 0))
+        blobs += stored
+        blobs += b'\0' * (align4(len(stored)) - len(stored))
+        offset += align4(len(stored))
+
+    body = b''.join(entries)
+    body += b'\0' * (align4(index_end) - index_end)
+    body += blobs
+    total = HEADER.size + len(body)
+    return HEADER.pack(MAGIC, VERSION, len(files), total, zlib.crc32(body)) + body
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('asset_dir')
+    ap.add_argument('output')
+    ap.add_argument('--size', type=lambda s: int(s, 0), default=0,
+                    help='partition size; fail if the image does not fit')
+    args = ap.parse_args()
+
+    files = collect(args.asset_dir)
+    image = pack(files)
+    if args.size and len(image) > args.size:
+        sys.exit(f'pack_assets: image is {len(image)} bytes, partition holds {args.size}')
+
+    with open(args.output, 'wb') as f:
+        f.write(image)
+
+    raw = sum(len(data) for _, data in files)
+    print(f'pack_assets: {len(files)} files, {raw} -> {len(image)} bytes')
+
+
+if __name__ == '__main__':
+    main()